@@ -0,0 +1,98 @@
+#pragma once
+
+#include "level_pivot/projection.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace level_pivot {
+
+class PivotRow;
+
+/**
+ * Comparison applied to one attr value
+ *
+ * Values are stable: they're stored as integers in plan trees.
+ */
+enum class AttrFilterOp {
+    EQ = 0,
+    LT = 1,
+    LE = 2,
+    GT = 3,
+    GE = 4,
+    IN = 5,
+    IS_NULL = 6,
+    IS_NOT_NULL = 7,
+    PREFIX = 8  // LIKE 'prefix%', starts_with(); TEXT only
+};
+
+/**
+ * Get the SQL spelling of an AttrFilterOp ("=", "IN", "IS NULL", ...)
+ */
+const char* attr_filter_op_name(AttrFilterOp op);
+
+/**
+ * Pushed-down predicates on attr columns, checked on raw values
+ *
+ * Lets the scanner drop rows before any Datum conversion. Checks compare
+ * the stored strings directly: TEXT values by bytes, INTEGER and BIGINT
+ * values numerically. A missing key is NULL, so it fails every comparison
+ * and passes only IS NULL.
+ *
+ * The filter may only reject rows PostgreSQL would reject too, as the
+ * quals are still evaluated normally on the rows we return. A stored
+ * value that doesn't parse as a plain decimal integer therefore passes,
+ * leaving PostgreSQL to report (or accept) it as usual.
+ */
+class AttrFilter {
+public:
+    /**
+     * Add a predicate; all added predicates must hold (AND)
+     *
+     * @param slot Attr slot (index into Projection::attr_columns())
+     * @param type Column type, which picks the comparison
+     * @param op Comparison
+     * @param values One operand for comparisons, the list for IN, none for
+     *        the NULL tests
+     * @return false if the predicate can't be checked on raw values (a
+     *         comparison on a type other than TEXT/INTEGER/BIGINT, a
+     *         PREFIX on a type other than TEXT, wrong operand count, or an
+     *         operand that isn't an integer); nothing is added then
+     */
+    bool add(size_t slot, PgType type, AttrFilterOp op,
+             const std::vector<std::string>& values);
+
+    bool empty() const { return predicates_.empty(); }
+    size_t size() const { return predicates_.size(); }
+
+    /**
+     * Check a row against every predicate
+     */
+    bool matches(const PivotRow& row) const;
+
+private:
+    struct Predicate {
+        size_t slot;
+        AttrFilterOp op;
+        PgType type;
+        std::vector<std::string> text;   // TEXT operands (sorted for IN)
+        std::vector<int64_t> ints;       // INTEGER/BIGINT operands (sorted for IN)
+    };
+
+    std::vector<Predicate> predicates_;
+
+    static bool matches_value(const Predicate& pred, std::string_view value);
+};
+
+/**
+ * Parse a stored integer the way the filter compares it
+ *
+ * Accepts an optional '-' and decimal digits only, within the range of
+ * type (INTEGER or BIGINT).
+ *
+ * @return false if value isn't such an integer
+ */
+bool parse_filter_integer(std::string_view value, PgType type, int64_t& out);
+
+} // namespace level_pivot
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * Allocation-free map from attr name to attr slot
+ *
+ * Built once per projection and probed for every LevelDB key scanned, so
+ * lookups take a string_view and never construct a std::string.
+ *
+ * Small column sets (up to LINEAR_MAX names) are bucketed by name length
+ * and compared with memcmp; most probes only touch one or two names.
+ * Larger sets use a hash-and-displace perfect hash: names are grouped into
+ * buckets, and each bucket gets a displacement chosen at build time so
+ * every name lands in its own table cell. A lookup is one hash, one
+ * displacement read and one memcmp against the candidate.
+ */
+class AttrLookup {
+public:
+    static constexpr size_t LINEAR_MAX = 8;
+
+    AttrLookup() = default;
+
+    /**
+     * @param names Attr names; a name's index is its slot. Must be distinct.
+     */
+    explicit AttrLookup(const std::vector<std::string>& names);
+
+    /**
+     * Slot for an attr name, or -1 if the name isn't in the set
+     */
+    int find(std::string_view name) const {
+        if (name.size() >= by_length_.size()) {
+            return -1;
+        }
+        if (!table_.empty()) {
+            uint64_t h = hash(name, seed_);
+            int slot = table_[cell(h, displacements_[bucket(h)])];
+            return slot >= 0 && matches(static_cast<size_t>(slot), name) ? slot : -1;
+        }
+        for (int slot : by_length_[name.size()]) {
+            if (matches(static_cast<size_t>(slot), name)) {
+                return slot;
+            }
+        }
+        return -1;
+    }
+
+    bool contains(std::string_view name) const { return find(name) >= 0; }
+
+    size_t size() const { return names_.size(); }
+
+    /**
+     * True if the perfect-hash table is in use (vs. length buckets)
+     */
+    bool is_hashed() const { return !table_.empty(); }
+
+    /**
+     * Seeded word-at-a-time hash with a murmur3 finalizer, so the high bits
+     * used for bucketing are as well mixed as the low ones
+     */
+    static uint64_t hash(std::string_view name, uint64_t seed) {
+        const char* p = name.data();
+        size_t len = name.size();
+        uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+
+        // Whole words, then the last 8 bytes (overlapping) or, for short
+        // names, two overlapping 4-byte or three single-byte reads
+        if (len >= 8) {
+            for (size_t off = 0; off + 8 < len; off += 8) {
+                h = (h ^ load64(p + off)) * 0xff51afd7ed558ccdULL;
+                h ^= h >> 32;
+            }
+            h ^= load64(p + len - 8);
+        } else if (len >= 4) {
+            h ^= load32(p) | (static_cast<uint64_t>(load32(p + len - 4)) << 32);
+        } else if (len > 0) {
+            h ^= static_cast<uint64_t>(static_cast<unsigned char>(p[0])) |
+                 (static_cast<uint64_t>(static_cast<unsigned char>(p[len / 2])) << 8) |
+                 (static_cast<uint64_t>(static_cast<unsigned char>(p[len - 1])) << 16);
+        }
+
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    std::vector<std::string> names_;          // By slot
+    std::vector<std::vector<int>> by_length_;  // Slots grouped by name length
+    std::vector<int> table_;                  // Perfect hash cells, -1 = empty
+    std::vector<uint32_t> displacements_;     // Per bucket
+    uint64_t table_mask_ = 0;
+    unsigned bucket_shift_ = 64;
+    uint64_t seed_ = 0;
+
+    // High bits pick the bucket; the low and middle words give the cell
+    // and an odd step, so two names collide for every displacement only
+    // if both words match
+    size_t bucket(uint64_t h) const {
+        return bucket_shift_ >= 64 ? 0 : static_cast<size_t>(h >> bucket_shift_);
+    }
+
+    size_t cell(uint64_t h, uint32_t displacement) const {
+        uint64_t base = static_cast<uint32_t>(h);
+        uint64_t step = ((h >> 24) & 0xffffffffULL) | 1;
+        return static_cast<size_t>((base + displacement * step) & table_mask_);
+    }
+
+    static uint64_t load64(const char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32_t load32(const char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    bool matches(size_t slot, std::string_view name) const {
+        const std::string& candidate = names_[slot];
+        return candidate.size() == name.size() &&
+               std::memcmp(candidate.data(), name.data(), name.size()) == 0;
+    }
+
+    bool try_build_table(uint64_t seed);
+};
+
+} // namespace level_pivot
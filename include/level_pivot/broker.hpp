@@ -0,0 +1,287 @@
+#pragma once
+
+#include "level_pivot/connection_manager.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * Requests a backend sends to the broker
+ *
+ * Values are part of the wire format.
+ */
+enum class BrokerOp : uint8_t {
+    OPEN = 1,              // path, create_if_missing, tuning options -> db id
+    GET = 2,               // db, snapshot, key -> found, value
+    WRITE = 3,             // db, ops -> (nothing)
+    APPROXIMATE_SIZE = 4,  // db, start, limit -> bytes
+    CURSOR_OPEN = 5,       // db, snapshot, scan flags -> cursor id
+    CURSOR_READ = 6,       // cursor, position, key, max entries -> chunk
+    SNAPSHOT = 7,          // db -> snapshot id
+    PROPERTY = 8           // db, name -> found, value
+};
+
+/**
+ * Kinds of broker objects a request can release
+ *
+ * Values are part of the wire format.
+ */
+enum class BrokerRelease : uint8_t {
+    CURSOR = 0,
+    SNAPSHOT = 1
+};
+
+/**
+ * Where a CURSOR_READ starts, and so which way it reads
+ */
+enum class CursorPosition : uint8_t {
+    SEEK = 0,      // First key >= key, forward
+    FIRST = 1,     // First key, forward
+    LAST = 2,      // Last key, backward
+    AFTER = 3,     // First key > key, forward
+    BEFORE = 4,    // Last key < key, backward
+    CONTINUE = 5   // Where the previous read stopped, same direction
+};
+
+/**
+ * Chunk sizes for cursor reads
+ *
+ * A cursor's first read after a seek asks for a few entries, so point
+ * lookups and skip-scan seeks stay cheap; each following read doubles the
+ * request up to the maximum. The broker also ends a chunk once it holds
+ * BROKER_MAX_CHUNK_BYTES of keys and values.
+ */
+constexpr uint32_t BROKER_FIRST_CHUNK_ENTRIES = 16;
+constexpr uint32_t BROKER_MAX_CHUNK_ENTRIES = 4096;
+constexpr size_t BROKER_MAX_CHUNK_BYTES = 256 * 1024;
+
+/**
+ * Builds a broker message
+ *
+ * Integers are written in native byte order: both ends run on the same
+ * host. Strings are a 32-bit length followed by the bytes.
+ */
+class BrokerMessageWriter {
+public:
+    void put_u8(uint8_t value) { data_.push_back(static_cast<char>(value)); }
+    void put_u32(uint32_t value) { put_raw(&value, sizeof(value)); }
+    void put_u64(uint64_t value) { put_raw(&value, sizeof(value)); }
+    void put_string(std::string_view value);
+
+    /**
+     * Write a placeholder u32 and return its offset, for counts that are
+     * only known after the items are written
+     */
+    size_t reserve_u32();
+    void patch_u32(size_t offset, uint32_t value);
+
+    size_t size() const { return data_.size(); }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+
+    void put_raw(const void* bytes, size_t size) {
+        data_.append(static_cast<const char*>(bytes), size);
+    }
+};
+
+/**
+ * Reads a broker message written by BrokerMessageWriter
+ *
+ * Throws LevelDBError if the message ends early. Strings are views into
+ * the message, valid as long as it is.
+ */
+class BrokerMessageReader {
+public:
+    explicit BrokerMessageReader(std::string_view data) : data_(data) {}
+
+    uint8_t get_u8();
+    uint32_t get_u32();
+    uint64_t get_u64();
+    std::string_view get_string();
+
+    bool at_end() const { return pos_ == data_.size(); }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+
+    const char* take(size_t size);
+};
+
+/**
+ * Message channel from this backend to the broker
+ *
+ * Implemented over shm_mq in the extension module; tests use an
+ * in-process loopback. Requests are answered in order, one at a time.
+ */
+class BrokerTransport {
+public:
+    virtual ~BrokerTransport() = default;
+
+    /**
+     * Make sure a session with the broker is up
+     *
+     * @return Session id; it changes whenever a new session had to be
+     *         started, which voids every db and cursor id of the old one
+     * @throws LevelDBError if the broker can't be reached
+     */
+    virtual uint64_t connect() = 0;
+
+    /**
+     * Send a request and wait for its reply
+     *
+     * @throws LevelDBError if the session broke; the next connect()
+     *         starts a new one
+     */
+    virtual std::string call(const std::string& request) = 0;
+};
+
+/**
+ * One database on the broker, as seen from a backend
+ *
+ * LevelDBConnection delegates to this when the broker owns the databases.
+ * The database is opened on the broker at first use, and again after the
+ * session is restarted.
+ */
+class BrokerClient : public std::enable_shared_from_this<BrokerClient> {
+public:
+    BrokerClient(std::shared_ptr<BrokerTransport> transport, const ConnectionOptions& options);
+
+    std::optional<std::string> get(const std::string& key);
+    void write(leveldb::WriteBatch* batch);
+    uint64_t approximate_size(const std::string& start, const std::string& limit);
+    std::optional<std::string> property(const std::string& name);
+
+    /**
+     * Open a cursor on the broker
+     *
+     * The cursor reads from the pinned snapshot, or else from one implicit
+     * LevelDB snapshot like a local iterator, and fetches entries in chunks.
+     */
+    std::unique_ptr<leveldb::Iterator> new_iterator(const ScanOptions& scan);
+
+    /**
+     * Take a snapshot on the broker that get() and new cursors read from
+     *
+     * If the session is lost while it is pinned, reads throw LevelDBError
+     * until it is unpinned, rather than silently see newer data.
+     */
+    void pin_snapshot();
+
+    /**
+     * Drop the pinned snapshot; the broker frees it with the next request
+     *
+     * Never talks to the broker, like release_cursor().
+     */
+    void unpin_snapshot();
+
+    /**
+     * Send a request on behalf of a cursor opened in session
+     *
+     * @return Reply with the status byte checked
+     * @throws LevelDBError if the session has changed since
+     */
+    std::string cursor_call(uint64_t session, BrokerMessageWriter& request);
+
+    /**
+     * Forget a cursor; the broker closes it with the next request
+     *
+     * Called from iterator destructors, which may run during error
+     * cleanup, so this never talks to the broker itself.
+     */
+    void release_cursor(uint64_t session, uint32_t cursor);
+
+    /**
+     * Start a request: pending releases, then the op
+     */
+    BrokerMessageWriter start_request(BrokerOp op);
+
+private:
+    std::shared_ptr<BrokerTransport> transport_;
+    ConnectionOptions options_;
+    uint64_t session_ = 0;
+    uint32_t db_ = 0;
+    bool open_ = false;
+    uint32_t snapshot_ = 0;  // Pinned snapshot id; 0 = none
+    uint64_t snapshot_session_ = 0;
+    std::vector<std::pair<BrokerRelease, uint32_t>> pending_releases_;
+
+    /** Connect, (re)opening the database if the session is new */
+    void ensure_open();
+
+    /** Id of the pinned snapshot to read from, after ensure_open() */
+    uint32_t read_snapshot() const;
+
+    /** Send a request and check the reply's status byte */
+    std::string call(const BrokerMessageWriter& request);
+};
+
+/**
+ * The broker's side: runs requests against the databases it owns
+ *
+ * Knows nothing about how messages arrive; the background worker feeds
+ * it one request at a time per session. Databases are opened once, by
+ * path, and stay open for the broker's lifetime; the options of the
+ * first OPEN for a path win, as with ConnectionManager.
+ */
+class BrokerService {
+public:
+    /**
+     * State of one backend's session: its databases, snapshots and open
+     * cursors
+     */
+    class Session {
+    private:
+        friend class BrokerService;
+
+        struct Snapshot {
+            std::shared_ptr<LevelDBConnection> database;
+            std::unique_ptr<LevelDBSnapshot> snapshot;
+        };
+
+        struct Cursor {
+            LevelDBIterator iterator;
+            bool backward = false;
+        };
+
+        // Declared so snapshots go before their databases, and cursors first
+        std::vector<std::shared_ptr<LevelDBConnection>> databases_;
+        std::unordered_map<uint32_t, Snapshot> snapshots_;
+        std::unordered_map<uint32_t, Cursor> cursors_;
+        uint32_t next_snapshot_ = 1;
+        uint32_t next_cursor_ = 1;
+    };
+
+    /**
+     * Handle one request
+     *
+     * Failures, including malformed requests, become error replies; the
+     * session stays usable.
+     *
+     * @return Reply to send back
+     */
+    std::string handle(Session& session, std::string_view request);
+
+    size_t database_count() const { return databases_.size(); }
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<LevelDBConnection>> databases_;
+
+    void dispatch(Session& session, BrokerOp op, BrokerMessageReader& in,
+                  BrokerMessageWriter& out);
+    void open(Session& session, BrokerMessageReader& in, BrokerMessageWriter& out);
+    void read_cursor(Session& session, BrokerMessageReader& in, BrokerMessageWriter& out);
+    LevelDBConnection& database(Session& session, uint32_t id);
+    const LevelDBSnapshot* snapshot(Session& session, uint32_t id);
+};
+
+} // namespace level_pivot
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * The rows of one table a transaction changed, summarized for a NOTIFY
+ * payload
+ *
+ * Entries are row identities (capture values in pattern order; for raw
+ * tables, the key). Past max_rows entries the set trades precision for
+ * size: entries are cut to their leading identity values, one column at
+ * a time, until few enough distinct prefixes remain, and an entry then
+ * stands for every row under its prefix. Cut all the way down, the set
+ * becomes "the whole table". A summary never misses a changed row.
+ */
+class ChangeSet {
+public:
+    explicit ChangeSet(size_t max_rows = 100);
+
+    /**
+     * Record a changed row by its identity values
+     */
+    void add(const std::vector<std::string>& identity);
+
+    /**
+     * Record a changed raw-table key
+     */
+    void add_key(std::string_view key);
+
+    /**
+     * Record that any row may have changed
+     */
+    void add_all();
+
+    /**
+     * Record everything other records
+     */
+    void merge(const ChangeSet& other);
+
+    bool empty() const { return !all_ && entries_.empty(); }
+    bool whole_table() const { return all_; }
+
+    /**
+     * Entries recorded, each an identity or leading part of one
+     */
+    const std::set<std::vector<std::string>>& entries() const { return entries_; }
+
+    /**
+     * Render as JSON, shorter than max_bytes
+     *
+     * {"rows":[["admins","u1"],["staff"]]} lists the entries; an entry
+     * shorter than the identity covers every row under that prefix.
+     * {"all":true} means any row. Entries are summarized further, as for
+     * max_rows, until the text fits.
+     */
+    std::string payload(size_t max_bytes) const;
+
+private:
+    size_t max_rows_;
+    size_t depth_ = static_cast<size_t>(-1);  // Longest entry kept
+    bool all_ = false;
+    std::set<std::vector<std::string>> entries_;
+
+    void insert(std::vector<std::string> entry);
+    void shrink(size_t max_rows);
+};
+
+} // namespace level_pivot
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "level_pivot/error.hpp"
+#include "level_pivot/pending_writes.hpp"
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <memory>
@@ -10,8 +12,11 @@
 
 // Forward declarations
 namespace leveldb {
+    class Cache;
     class DB;
+    class FilterPolicy;
     class Iterator;
+    class Snapshot;
     struct Options;
     struct ReadOptions;
     struct WriteOptions;
@@ -21,8 +26,38 @@ namespace leveldb {
 
 namespace level_pivot {
 
+class BrokerClient;
+class BrokerTransport;
+
+/**
+ * Block compression for a database's table files
+ *
+ * Values are part of the broker wire format. ZSTD needs a LevelDB built
+ * with zstd support (LEVEL_PIVOT_HAVE_ZSTD).
+ */
+enum class Compression : uint8_t {
+    NONE = 0,
+    SNAPPY = 1,
+    ZSTD = 2
+};
+
+/**
+ * Parse a compression option value ("none", "snappy" or "zstd")
+ */
+std::optional<Compression> parse_compression(std::string_view name);
+
+/**
+ * True if this build can open databases with the given compression
+ */
+bool compression_supported(Compression compression);
+
 /**
  * Options for opening a LevelDB connection
+ *
+ * The tuning options below only take effect for the process that opens
+ * the database: the first connection to a path (or the broker's first
+ * OPEN) decides them. Defaults match LevelDB's, except for the bloom
+ * filter.
  */
 struct ConnectionOptions {
     std::string db_path;
@@ -31,6 +66,45 @@ struct ConnectionOptions {
     size_t block_cache_size = 8 * 1024 * 1024;  // 8MB default
     size_t write_buffer_size = 4 * 1024 * 1024;  // 4MB default
     bool use_write_batch = true;  // Use WriteBatch for atomic operations
+
+    int bloom_bits_per_key = 10;  // Bloom filter bits per key; 0 = no filter
+    size_t block_size = 4 * 1024;  // Uncompressed bytes per data block
+    int max_open_files = 1000;  // Table files kept open
+    Compression compression = Compression::SNAPPY;
+    size_t max_file_size = 2 * 1024 * 1024;  // Bytes per table file before a new one
+};
+
+/**
+ * How an iterator reads blocks from disk
+ */
+struct ScanOptions {
+    bool fill_cache = true;         // Keep blocks read in the block cache
+    bool verify_checksums = false;  // Check every block read against its checksum
+    size_t prefetch_batch = 0;      // Keys per batch read ahead on a background
+                                    // thread (see prefetch_iterator.hpp); 0 reads
+                                    // on the caller's thread. Local databases only
+};
+
+/**
+ * RAII wrapper for a LevelDB snapshot
+ *
+ * Reads given the snapshot see the database as it was when the snapshot
+ * was taken. Must not outlive the database it came from.
+ */
+class LevelDBSnapshot {
+public:
+    explicit LevelDBSnapshot(leveldb::DB* db);
+    ~LevelDBSnapshot();
+
+    // Non-copyable
+    LevelDBSnapshot(const LevelDBSnapshot&) = delete;
+    LevelDBSnapshot& operator=(const LevelDBSnapshot&) = delete;
+
+    const leveldb::Snapshot* get() const { return snapshot_; }
+
+private:
+    leveldb::DB* db_;
+    const leveldb::Snapshot* snapshot_;
 };
 
 /**
@@ -38,7 +112,17 @@ struct ConnectionOptions {
  */
 class LevelDBIterator {
 public:
-    LevelDBIterator(leveldb::DB* db);
+    /**
+     * @param snapshot Read as of this snapshot; null reads the latest data
+     */
+    LevelDBIterator(leveldb::DB* db, const leveldb::Snapshot* snapshot = nullptr,
+                    const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Wrap an existing iterator (e.g. a broker cursor)
+     */
+    explicit LevelDBIterator(std::unique_ptr<leveldb::Iterator> iter);
+
     ~LevelDBIterator();
 
     // Move-only
@@ -49,7 +133,9 @@ public:
 
     void seek(const std::string& key);
     void seek_to_first();
+    void seek_to_last();
     void next();
+    void prev();
     bool valid() const;
     std::string key() const;
     std::string value() const;
@@ -70,6 +156,15 @@ public:
      */
     std::string_view value_view() const;
 
+    /**
+     * Add the time spent in every later seek and step to *ns
+     *
+     * For EXPLAIN ANALYZE: reading the clock around each step costs about
+     * as much as a step over cached blocks, so iterators aren't timed
+     * unless asked. *ns must outlive the iterator.
+     */
+    void time_moves(uint64_t* ns);
+
 private:
     std::unique_ptr<leveldb::Iterator> iter_;
 };
@@ -83,6 +178,14 @@ class LevelDBWriteBatch;
 class LevelDBConnection {
 public:
     explicit LevelDBConnection(const ConnectionOptions& options);
+
+    /**
+     * Connect to a database owned by the broker process instead of opening
+     * it here. Reads and writes become requests over the transport.
+     */
+    LevelDBConnection(const ConnectionOptions& options,
+                      std::shared_ptr<BrokerTransport> broker);
+
     ~LevelDBConnection();
 
     // Non-copyable
@@ -90,11 +193,17 @@ public:
     LevelDBConnection& operator=(const LevelDBConnection&) = delete;
 
     /**
-     * Get a value by key
+     * Get a value by key, as of the pinned snapshot if there is one, with
+     * any pending write to it applied
      * @return Value string, or std::nullopt if key not found
      */
     std::optional<std::string> get(const std::string& key);
 
+    /**
+     * Get a value by key as of snapshot (null: latest); local only
+     */
+    std::optional<std::string> get(const std::string& key, const LevelDBSnapshot* snapshot);
+
     /**
      * Put a key-value pair
      */
@@ -106,15 +215,110 @@ public:
     void del(const std::string& key);
 
     /**
-     * Create an iterator for range scans
+     * Apply a batch of puts and deletes atomically
+     */
+    void write(leveldb::WriteBatch* batch);
+
+    /**
+     * Create an iterator for range scans, reading from the pinned
+     * snapshot if there is one, merged with the pending writes
+     */
+    LevelDBIterator iterator(const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Create an iterator reading as of snapshot (null: latest); local only
+     */
+    LevelDBIterator iterator(const LevelDBSnapshot* snapshot,
+                             const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Take a new snapshot; local only
      */
-    LevelDBIterator iterator();
+    std::unique_ptr<LevelDBSnapshot> snapshot();
+
+    /**
+     * Pin a snapshot for this connection's reads
+     *
+     * Until the matching release_snapshot(), get() and new iterators see
+     * the database as of the first acquire. Pins nest: the snapshot is
+     * dropped when the last one is released. Writes are not affected.
+     */
+    void acquire_snapshot();
+    void release_snapshot();
+
+    /**
+     * Identifies the pinned snapshot; 0 when none is pinned
+     *
+     * Iterators made under the same nonzero epoch read the same data, so
+     * a rescan can keep its iterator and just seek. A buffered write moves
+     * the epoch on, since new iterators would also see it.
+     */
+    uint64_t snapshot_epoch() const { return snapshot_epoch_; }
 
     /**
      * Create a write batch for atomic operations
      */
     LevelDBWriteBatch create_batch();
 
+    /**
+     * Hold this connection's writes in memory until commit_pending_writes()
+     *
+     * Until then, put(), del() and write() add to the pending writes
+     * instead of LevelDB, and get() and iterator() read them over the
+     * database. When the pending writes would pass limit bytes, overflow
+     * decides: FAIL throws and leaves them as they were; SPILL writes them
+     * to LevelDB and starts over. Does nothing if already buffering.
+     */
+    void buffer_writes(size_t limit, OverflowAction overflow);
+
+    /**
+     * Check if writes are being held by buffer_writes()
+     */
+    bool buffering_writes() const { return pending_ != nullptr; }
+
+    /**
+     * Write the pending writes to LevelDB as one batch and stop buffering
+     * @return Number of keys written or deleted
+     */
+    size_t commit_pending_writes();
+
+    /**
+     * Drop the pending writes and stop buffering; never throws
+     */
+    void discard_pending_writes();
+
+    /**
+     * Open, release or roll back a savepoint of the pending writes, for a
+     * subtransaction at nesting level (see PendingWrites); no-ops when
+     * not buffering
+     */
+    void savepoint(int level);
+    void release_savepoint(int level);
+    void rollback_savepoint(int level);
+
+    /**
+     * Times the pending writes were spilled since buffering began
+     */
+    uint64_t spill_count() const { return spills_; }
+
+    /**
+     * Estimate the on-disk size of keys in [start, limit)
+     *
+     * Wraps LevelDB's GetApproximateSizes. The result counts compressed
+     * bytes in SSTables only; data still in the memtable is not included.
+     * An empty limit means "to the end of the keyspace".
+     */
+    uint64_t approximate_size(const std::string& start, const std::string& limit);
+
+    /**
+     * Get one of LevelDB's properties, e.g. "leveldb.stats" (compaction
+     * stats per level), "leveldb.sstables" (the table files) or
+     * "leveldb.approximate-memory-usage" (memtables and block cache)
+     *
+     * @return Its value, or std::nullopt if LevelDB doesn't know the name
+     */
+    std::optional<std::string> property(const std::string& name);
+
     /**
      * Get the database path
      */
@@ -126,16 +330,38 @@ public:
     bool is_read_only() const { return read_only_; }
 
     /**
-     * Get raw DB pointer (for advanced use)
+     * Check if the database is reached through the broker
+     */
+    bool is_brokered() const { return broker_ != nullptr; }
+
+    /**
+     * Get raw DB pointer (for advanced use); null when brokered
      */
     leveldb::DB* raw() { return db_; }
 
 private:
+    // The cache and filter policy must outlive db_, so they're declared first
+    std::unique_ptr<leveldb::Cache> block_cache_;
+    std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
     leveldb::DB* db_ = nullptr;
+    std::shared_ptr<BrokerClient> broker_;
     std::string path_;
     bool read_only_;
 
+    std::unique_ptr<LevelDBSnapshot> pinned_;  // Local pinned snapshot
+    int snapshot_refs_ = 0;
+    uint64_t snapshot_epoch_ = 0;
+    uint64_t epochs_used_ = 0;
+
+    std::unique_ptr<PendingWrites> pending_;  // Set while buffering writes
+    size_t pending_limit_ = 0;
+    OverflowAction overflow_ = OverflowAction::FAIL;
+    uint64_t spills_ = 0;
+
     void check_write_allowed();
+    void write_through(leveldb::WriteBatch* batch);
+    void repin_snapshot();
+    void buffer_batch(leveldb::WriteBatch* batch);
 };
 
 /**
@@ -231,6 +457,20 @@ public:
      */
     size_t connection_count() const;
 
+    /**
+     * Route new connections through the broker
+     *
+     * Set once at load time when the broker is enabled; connections made
+     * afterwards send their requests over transport instead of opening
+     * LevelDB in this process.
+     */
+    void set_broker(std::shared_ptr<BrokerTransport> transport);
+
+    /**
+     * Check if connections go through the broker
+     */
+    bool uses_broker() const;
+
 private:
     ConnectionManager() = default;
     ~ConnectionManager();
@@ -241,6 +481,7 @@ private:
 
     mutable std::mutex mutex_;
     std::unordered_map<unsigned int, std::shared_ptr<LevelDBConnection>> connections_;
+    std::shared_ptr<BrokerTransport> broker_;
 };
 
 } // namespace level_pivot
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "level_pivot/identity_ranges.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include "level_pivot/key_parser.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * One group produced by GroupCounter
+ */
+struct GroupCount {
+    std::vector<std::string> group_values;  // Leading capture values
+    int64_t count = 0;                      // Identities in the group
+};
+
+/**
+ * Counts pivot rows in key ranges, grouped by their leading captures
+ *
+ * Backs COUNT(*) and GROUP BY pushdown: keys are only parsed and their
+ * identities compared, nothing is pivoted, copied or converted. A row is
+ * a run of keys with one identity, exactly as PivotScanner assembles
+ * them, so the counts match what a scan would return. Keys sort by their
+ * leading captures, so each group's keys are contiguous and groups
+ * stream out one at a time.
+ *
+ * When every capture precedes {attr}, a row's keys share a prefix: after
+ * a row's first key the counter tries one next() and, if still inside
+ * the row, seeks past it.
+ */
+class GroupCounter {
+public:
+    /**
+     * @param group_captures Leading captures to group by (at most those
+     *        before {attr}); 0 counts everything as one group
+     */
+    GroupCounter(const KeyParser& parser, std::shared_ptr<LevelDBConnection> connection,
+                 size_t group_captures);
+
+    /**
+     * Read settings for the scan; applies from the next begin_scan()
+     */
+    void set_scan_options(const ScanOptions& options) { scan_options_ = options; }
+
+    /**
+     * Begin counting the rows in sorted, non-overlapping key ranges
+     *
+     * @param ranges As built by build_identity_ranges()
+     */
+    void begin_scan(const std::vector<KeyRange>& ranges);
+
+    /**
+     * Count the next group
+     *
+     * Groups with no rows never appear, except that with no group
+     * captures there is always exactly one group, as for an aggregate
+     * without GROUP BY.
+     *
+     * @return The group, valid until the next call; nullptr when done
+     */
+    const GroupCount* next_group();
+
+    /**
+     * Scan statistics
+     */
+    struct Stats {
+        size_t keys_scanned = 0;  // Keys read within the ranges
+        size_t rows_counted = 0;  // Identities counted
+        size_t seeks = 0;         // Seeks past a row's remaining keys
+    };
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    const KeyParser& parser_;
+    std::shared_ptr<LevelDBConnection> connection_;
+    size_t group_captures_;
+    bool seek_supported_;
+    ScanOptions scan_options_;
+
+    std::unique_ptr<LevelDBIterator> iterator_;
+    std::vector<KeyRange> ranges_;
+    size_t range_index_ = 0;
+    Stats stats_;
+
+    ParsedKeyView parsed_;
+    std::vector<std::string> identity_;  // Current row's capture values
+    bool has_identity_ = false;
+    GroupCount current_;
+    GroupCount emitted_;
+    bool has_group_ = false;
+    bool emitted_any_ = false;
+    std::string seek_target_;
+
+    bool is_within_range(std::string_view key) const;
+    bool next_range();
+    bool same_identity() const;
+    bool same_group() const;
+    void start_group();
+    void count_row();
+    void skip_row();
+    const GroupCount* emit_group();
+};
+
+} // namespace level_pivot
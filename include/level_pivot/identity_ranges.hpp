@@ -0,0 +1,131 @@
+#pragma once
+
+#include "level_pivot/key_parser.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * Pushed-down conditions on one identity column (capture)
+ *
+ * All set fields must hold. Bounds compare capture values bytewise and
+ * are treated as inclusive; a strict bound only makes the scanned range
+ * slightly wider, and the quals are rechecked on every row anyway.
+ */
+struct IdentityConstraint {
+    std::vector<std::string> values;   // Allowed values (= or IN); empty = any
+    std::optional<std::string> lower;  // value >= lower
+    std::optional<std::string> upper;  // value <= upper
+    std::optional<std::string> prefix; // value starts with prefix
+
+    bool has_values() const { return !values.empty(); }
+    bool has_bounds() const { return lower.has_value() || upper.has_value(); }
+    bool has_prefix() const { return prefix.has_value(); }
+};
+
+/**
+ * A half-open LevelDB key range [start, end)
+ */
+struct KeyRange {
+    std::string start;
+    std::string end;  // Exclusive; empty = unbounded
+
+    bool operator==(const KeyRange& other) const {
+        return start == other.start && end == other.end;
+    }
+};
+
+/**
+ * Default cap on the ranges produced from IN-list combinations
+ */
+constexpr size_t MAX_IDENTITY_RANGES = 1024;
+
+/**
+ * Turn identity constraints into sorted, non-overlapping key ranges
+ *
+ * Walks the captures in pattern order. Each leading capture with allowed
+ * values multiplies the ranges (one prefix per combination of values);
+ * the first capture with only bounds and/or a prefix narrows each key
+ * prefix to a range;
+ * the first capture with neither ends the walk, as does {attr}, since
+ * later captures aren't part of the key prefix. If another set of values
+ * would push the count over max_ranges, the walk stops before it.
+ *
+ * Every key of a matching row lies inside the result; some keys of
+ * non-matching rows may too. Values are placed in keys verbatim, so
+ * equality only narrows correctly for columns stored exactly as written
+ * (the same assumption as prefix pushdown).
+ *
+ * @param parser Parser for the table's key pattern
+ * @param constraints Per capture, in pattern order (may be shorter)
+ * @param max_ranges Cap on the number of ranges
+ * @return Ranges in key order; empty if the constraints can't match
+ */
+std::vector<KeyRange> build_identity_ranges(const KeyParser& parser,
+                                            const std::vector<IdentityConstraint>& constraints,
+                                            size_t max_ranges = MAX_IDENTITY_RANGES);
+
+/**
+ * The identities the constraints allow, when every capture is bound
+ *
+ * Applies only if each capture has allowed values (= or IN); the result
+ * is every combination of them that passes the bounds, without
+ * duplicates, ordered by value tuple (not necessarily key order).
+ *
+ * @param parser Parser for the table's key pattern
+ * @param constraints Per capture, in pattern order
+ * @param max_identities Cap on the number of combinations
+ * @return Capture values per identity, in pattern order; std::nullopt if
+ *         some capture isn't bound or there would be too many
+ */
+std::optional<std::vector<std::vector<std::string>>>
+build_point_identities(const KeyParser& parser,
+                       const std::vector<IdentityConstraint>& constraints,
+                       size_t max_identities = MAX_IDENTITY_RANGES);
+
+/**
+ * Captures before {attr}; only those are part of the key prefix that
+ * build_prefix() produces, so only they can narrow a scan
+ */
+size_t captures_before_attr(const KeyPattern& pattern);
+
+/**
+ * True if scanning for a capture value prefix selects exactly the rows
+ * whose value starts with it; for a whole value (= or IN), the rows
+ * whose value equals it
+ *
+ * The parser ends a capture at the first occurrence of the literal after
+ * it, so a prefix or value containing that literal's first byte could
+ * match keys whose parsed value is shorter than it. Captures not followed
+ * by a literal, or after {attr}, never qualify.
+ *
+ * @param pattern The table's key pattern
+ * @param capture_index Index of the capture, in pattern order
+ * @param prefix The value prefix
+ */
+bool prefix_selects_exactly(const KeyPattern& pattern, size_t capture_index,
+                            const std::string& prefix);
+
+/**
+ * The single range covering all keys under a prefix
+ */
+KeyRange prefix_range(const std::string& prefix);
+
+/**
+ * The parts of ranges that lie within [start, end)
+ *
+ * Used to scan one shard of a parallel scan: only keys both in the
+ * shard and in the scan's ranges are read.
+ *
+ * @param ranges Sorted, non-overlapping ranges
+ * @param start First key kept (empty = no lower limit)
+ * @param end Exclusive end (empty = no upper limit)
+ * @return The clipped ranges, empty ones dropped, in key order
+ */
+std::vector<KeyRange> clip_key_ranges(const std::vector<KeyRange>& ranges,
+                                      const std::string& start,
+                                      const std::string& end);
+
+} // namespace level_pivot
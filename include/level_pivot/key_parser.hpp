@@ -100,6 +100,36 @@ public:
      */
     std::optional<ParsedKeyView> parse_view(std::string_view key) const;
 
+    /**
+     * Parse a key into an existing ParsedKeyView
+     *
+     * Same as parse_view(), but reuses out's capture vector so scanning
+     * loops parse every key without allocating. out is unspecified when
+     * the key doesn't match.
+     *
+     * @param key The LevelDB key to parse
+     * @param out Receives views into key
+     * @return true if the key matches the pattern
+     */
+    bool parse_view_into(std::string_view key, ParsedKeyView& out) const;
+
+    /**
+     * Parse only the part of a key from {attr} on
+     *
+     * For scanners that already know the key's bytes before attr_pos
+     * match a key they parsed in full, where {attr} began at attr_pos:
+     * the captures are then the same and only the attr and the rest of
+     * the pattern are left to check. Captures after {attr} are checked
+     * but not extracted.
+     *
+     * @param key The LevelDB key to parse
+     * @param attr_pos Offset of the attr in key
+     * @param attr Receives a view into key
+     * @return true if the rest of the key matches the pattern
+     */
+    bool parse_attr_view(std::string_view key, size_t attr_pos,
+                         std::string_view& attr) const;
+
     /**
      * Build a key from capture values and attr name
      *
@@ -111,6 +141,21 @@ public:
     std::string build(const std::vector<std::string>& capture_values,
                       const std::string& attr_name) const;
 
+    /**
+     * Build a key into an existing buffer
+     *
+     * Same as build(), but overwrites out in place so callers writing many
+     * keys can reuse one allocation.
+     *
+     * @param out Buffer to receive the key (previous contents discarded)
+     * @param capture_values Values for each capture segment (in pattern order)
+     * @param attr_name The attr value (column name)
+     * @throws std::invalid_argument if capture_values size doesn't match pattern
+     */
+    void build_into(std::string& out,
+                    const std::vector<std::string>& capture_values,
+                    const std::string& attr_name) const;
+
     /**
      * Build a key using named captures
      *
@@ -148,20 +193,24 @@ public:
      */
     bool starts_with_prefix(const std::string& key) const;
 
+    /**
+     * Compute the exclusive upper bound of a prefix range
+     *
+     * Returns the smallest key that sorts after every key starting with
+     * prefix (e.g. "users##" -> "users#$"). Returns an empty string if no
+     * such key exists (empty prefix, or prefix made only of 0xFF bytes).
+     */
+    static std::string prefix_successor(const std::string& prefix);
+
 private:
     KeyPattern pattern_;
     size_t estimated_key_size_;  // Pre-computed estimate for build() reserve
 
-    // SIMD parser for uniform delimiter patterns (optional)
-    // Stored as unique_ptr to keep SimdKeyParser's storage stable
-    // (since it stores string_view to its own strings)
+    // SIMD parser for patterns ending in {attr} (optional)
     std::unique_ptr<SimdKeyParser> simd_parser_;
-    std::string simd_prefix_;      // Owned storage for SIMD prefix
-    std::string simd_delimiter_;   // Owned storage for SIMD delimiter
 
     void compute_estimated_key_size();
     void try_init_simd_parser();
-    std::optional<std::string> try_get_uniform_delimiter() const;
 };
 
 } // namespace level_pivot
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Forward declarations
+namespace leveldb {
+    class Iterator;
+    class WriteBatch;
+}
+
+namespace level_pivot {
+
+/**
+ * What a connection does when its pending writes outgrow their limit
+ */
+enum class OverflowAction {
+    FAIL,   // Reject the write that would pass the limit
+    SPILL   // Write what is pending to LevelDB and keep buffering
+};
+
+/**
+ * Writes held in memory until their transaction commits
+ *
+ * An ordered overlay of key -> value, where a missing value is a pending
+ * delete. Later writes to a key replace earlier ones, so committing writes
+ * each key once. Reads see the overlay through find() and overlay(),
+ * which merges it over an iterator of the database.
+ *
+ * Iterators share the entries they were made from; a write while one is
+ * open copies the entries first, so open iterators keep reading the
+ * overlay as it was when they were made.
+ *
+ * Savepoints let a subtransaction's writes be undone: while one is open,
+ * the first write to each key records what the key held before, and
+ * rolling back restores those records. Savepoints are identified by the
+ * subtransaction's nesting level; level 1 is the transaction itself and
+ * needs none.
+ */
+class PendingWrites {
+public:
+    PendingWrites();
+
+    void put(const std::string& key, const std::string& value);
+    void del(const std::string& key);
+
+    /**
+     * Add every operation of batch, in order
+     */
+    void apply(const leveldb::WriteBatch& batch);
+
+    /**
+     * Look up a pending write
+     * @return null if key has none; else its value, or std::nullopt for a delete
+     */
+    const std::optional<std::string>* find(const std::string& key) const;
+
+    /**
+     * Append the pending writes to batch in key order
+     */
+    void fill(leveldb::WriteBatch* batch) const;
+
+    /**
+     * Drop all pending writes; open savepoints are kept
+     *
+     * Rolling one back afterwards still restores the keys it recorded
+     * with a pending write before it began; keys it wrote first are
+     * gone from the overlay and stay as cleared.
+     */
+    void clear();
+
+    /**
+     * Open a savepoint for level, unless the innermost one is already
+     * at level; writes from here on are undone by rollback_savepoint()
+     */
+    void savepoint(int level);
+
+    /**
+     * End level's savepoint keeping its writes; they become part of the
+     * enclosing level's savepoint, if that level isn't the transaction
+     */
+    void release_savepoint(int level);
+
+    /**
+     * Undo the writes made since level's savepoint and close it
+     */
+    void rollback_savepoint(int level);
+
+    /**
+     * Number of open savepoints
+     */
+    size_t savepoint_count() const { return savepoints_.size(); }
+
+    /**
+     * Wrap base so it also returns pending puts and skips pending deletes
+     */
+    std::unique_ptr<leveldb::Iterator> overlay(std::unique_ptr<leveldb::Iterator> base) const;
+
+    /**
+     * Number of keys with a pending write
+     */
+    size_t size() const { return entries_->size(); }
+    bool empty() const { return entries_->empty(); }
+
+    /**
+     * Approximate memory held, counting keys, values and per-entry overhead
+     */
+    size_t bytes() const { return bytes_; }
+
+    /**
+     * Upper bound on what applying batch adds to bytes()
+     */
+    static size_t batch_bytes(const leveldb::WriteBatch& batch);
+
+    /**
+     * Per-key bookkeeping counted by bytes() on top of key and value
+     */
+    static constexpr size_t ENTRY_OVERHEAD = 64;
+
+    using Entries = std::map<std::string, std::optional<std::string>>;
+
+private:
+    // A key's entry before a savepoint's first write to it
+    struct Prior {
+        bool present;                      // False: the key had no entry
+        std::optional<std::string> value;  // The entry, if present
+    };
+
+    struct Savepoint {
+        int level;
+        std::map<std::string, Prior> undo;
+    };
+
+    std::shared_ptr<Entries> entries_;
+    size_t bytes_ = 0;
+    std::vector<Savepoint> savepoints_;  // Innermost last
+
+    Entries& writable();
+    void set(const std::string& key, std::optional<std::string> value);
+    void restore(const std::string& key, const Prior& prior);
+};
+
+} // namespace level_pivot
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "level_pivot/projection.hpp"
+#include "level_pivot/attr_filter.hpp"
+#include "level_pivot/identity_ranges.hpp"
 #include "level_pivot/connection_manager.hpp"
 #include "level_pivot/type_converter.hpp"
 #include <vector>
 #include <optional>
 #include <memory>
-#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include <string_view>
 
 // Forward declarations for PostgreSQL types
 extern "C" {
@@ -17,14 +21,112 @@ namespace level_pivot {
 
 /**
  * A single row of pivoted data
+ *
+ * Values are stored back to back in one byte arena and referenced by
+ * offset/length, so building a row costs no allocations once the buffer
+ * has grown to fit. Identity values are in pattern capture order; attr
+ * values are in slots indexed by Projection::attr_column_index. reset()
+ * empties the row but keeps all capacity for the next one.
  */
-struct PivotRow {
-    std::vector<std::string> identity_values;  // Values for identity columns
-    std::unordered_map<std::string, std::string> attr_values;  // attr -> value
+class PivotRow {
+public:
+    PivotRow() = default;
+    PivotRow(size_t identity_count, size_t attr_slot_count) {
+        reset(identity_count, attr_slot_count);
+    }
+
+    /**
+     * Clear all values, keeping allocated capacity
+     */
+    void reset(size_t identity_count, size_t attr_slot_count) {
+        arena_.clear();
+        identity_.assign(identity_count, Span{});
+        attrs_.assign(attr_slot_count, Span{});
+    }
+
+    void set_identity(size_t index, std::string_view value) {
+        identity_[index] = append(value);
+    }
+
+    void set_attr(size_t slot, std::string_view value) {
+        attrs_[slot] = append(value);
+    }
+
+    size_t identity_count() const { return identity_.size(); }
+    size_t attr_slot_count() const { return attrs_.size(); }
+
+    std::string_view identity_value(size_t index) const {
+        return view(identity_[index]);
+    }
+
+    /**
+     * True if the row has a value for the attr slot (its key existed)
+     */
+    bool has_attr(size_t slot) const {
+        return attrs_[slot].offset != Span::absent;
+    }
+
+    std::string_view attr_value(size_t slot) const {
+        return view(attrs_[slot]);
+    }
+
+    /**
+     * Compare identity values with parsed key captures
+     */
+    bool identity_matches(const std::vector<std::string_view>& captures) const {
+        if (captures.size() != identity_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < identity_.size(); ++i) {
+            if (view(identity_[i]) != captures[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
 
     bool operator==(const PivotRow& other) const {
-        return identity_values == other.identity_values &&
-               attr_values == other.attr_values;
+        if (identity_.size() != other.identity_.size() ||
+            attrs_.size() != other.attrs_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < identity_.size(); ++i) {
+            if (identity_value(i) != other.identity_value(i)) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < attrs_.size(); ++i) {
+            if (has_attr(i) != other.has_attr(i) ||
+                attr_value(i) != other.attr_value(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Span {
+        static constexpr uint32_t absent = UINT32_MAX;
+        uint32_t offset = absent;
+        uint32_t length = 0;
+    };
+
+    std::string arena_;
+    std::vector<Span> identity_;
+    std::vector<Span> attrs_;
+
+    Span append(std::string_view value) {
+        Span span{static_cast<uint32_t>(arena_.size()),
+                  static_cast<uint32_t>(value.size())};
+        arena_.append(value.data(), value.size());
+        return span;
+    }
+
+    std::string_view view(const Span& span) const {
+        if (span.offset == Span::absent) {
+            return {};
+        }
+        return std::string_view(arena_.data() + span.offset, span.length);
     }
 };
 
@@ -33,6 +135,38 @@ struct PivotRow {
  */
 class PivotScanner {
 public:
+    /**
+     * When to seek past attr keys the query doesn't need
+     *
+     * Skip-scanning only applies when every capture precedes {attr} in the
+     * pattern, so that an identity's keys are contiguous and sorted by
+     * attr name.
+     */
+    enum class SkipScan {
+        OFF,     // Always step through every key
+        AUTO,    // Decide from the first rows' attrs-per-identity
+        ALWAYS   // Seek whenever unneeded keys follow
+    };
+
+    /**
+     * How begin_point_lookups() fetches each identity's row
+     */
+    enum class PointLookup {
+        SEEK,  // Seek to the identity's keys, stop once the needed attrs are read
+        GET    // One get() per needed attr key
+    };
+
+    /**
+     * Rows sampled before AUTO decides whether to skip-scan
+     */
+    static constexpr size_t SKIP_SCAN_SAMPLE_ROWS = 32;
+
+    /**
+     * Rough cost of a LevelDB seek in next() calls; AUTO skip-scans when
+     * each seek is expected to save more steps than this
+     */
+    static constexpr size_t SEEK_COST_IN_NEXTS = 4;
+
     /**
      * Create a scanner for the given projection and connection
      *
@@ -54,12 +188,118 @@ public:
      */
     void begin_scan(const std::vector<std::string>& prefix_values);
 
+    /**
+     * Begin scanning one shard of a prefix range (parallel scans)
+     *
+     * Shard bounds should lie on identity boundaries (see
+     * compute_shard_boundaries) so that no row spans two shards.
+     *
+     * @param prefix_values Values for some identity columns (in order)
+     * @param shard_start First key of the shard (empty = start of prefix range)
+     * @param shard_end Exclusive end of the shard (empty = end of prefix range)
+     */
+    void begin_scan(const std::vector<std::string>& prefix_values,
+                    const std::string& shard_start,
+                    const std::string& shard_end);
+
+    /**
+     * Begin scanning a list of key ranges, one after another
+     *
+     * Ranges must be sorted and non-overlapping, as build_identity_ranges
+     * returns them. A row never spans two ranges: leaving a range ends the
+     * current row. An empty list scans nothing.
+     *
+     * @param ranges Key ranges in key order
+     */
+    void begin_scan_ranges(const std::vector<KeyRange>& ranges);
+
+    /**
+     * Begin fetching the rows of fully specified identities
+     *
+     * SEEK scans each identity's key range, as begin_scan_ranges() would,
+     * but ends it as soon as the needed attrs are in; it requires every
+     * capture to precede {attr} (see supports_point_seek()). GET builds
+     * the needed attr keys and gets them directly, which assumes a row
+     * has no attrs beyond the projection's attr columns: it exists if any
+     * of their keys does.
+     *
+     * @param identities Capture values per identity, in pattern order
+     */
+    void begin_point_lookups(const std::vector<std::vector<std::string>>& identities,
+                             PointLookup mode);
+
+    /**
+     * True if an identity's keys are contiguous, as PointLookup::SEEK needs
+     */
+    bool supports_point_seek() const { return skip_supported_; }
+
     /**
      * Fetch the next pivoted row
      *
-     * @return The next row, or std::nullopt if no more rows
+     * The row lives in a buffer owned by the scanner and is overwritten by
+     * the next call to next_row(), seek_to(), begin_scan() or end_scan();
+     * copy it if it has to outlive that.
+     *
+     * @return The next row, or nullptr if no more rows
+     */
+    const PivotRow* next_row();
+
+    /**
+     * Reposition a running scan at key (used by ANALYZE sampling)
+     *
+     * Discards any partially accumulated row and skips the identity found
+     * at key, since its leading attrs may sort before key. Does nothing if
+     * the scan is already at or past key, so ascending seeks never return
+     * the same row twice.
+     *
+     * @param key Target key within the scan's prefix range
+     */
+    void seek_to(const std::string& key);
+
+    /**
+     * Set pushed-down attr predicates; next_row() skips rows that fail them
+     */
+    void set_filter(AttrFilter filter) { filter_ = std::move(filter); }
+
+    /**
+     * Set how the scan reads blocks (cache filling, checksums); takes
+     * effect at begin_scan()
+     */
+    void set_scan_options(const ScanOptions& scan) {
+        scan_options_ = scan;
+        iterator_.reset();
+    }
+
+    /**
+     * Time the scan's phases into stats() (read_ns, parse_ns); takes
+     * effect at begin_scan()
+     *
+     * Off by default: it reads the clock twice per key.
      */
-    std::optional<PivotRow> next_row();
+    void set_timing(bool timing) {
+        timing_ = timing;
+        iterator_.reset();
+    }
+
+    /**
+     * Set the skip-scan mode (default AUTO); takes effect at begin_scan()
+     */
+    void set_skip_scan(SkipScan mode) { skip_scan_mode_ = mode; }
+
+    /**
+     * Scan in descending key order; takes effect at begin_scan()
+     *
+     * Ranges and point lookups are visited last to first and each row
+     * is assembled from its last key back to its first, so rows come out
+     * in exactly the reverse of the forward order. Skip-scanning only
+     * runs forwards and seek_to() is not supported.
+     */
+    void set_reverse(bool reverse) { reverse_ = reverse; }
+
+    /**
+     * True if the running scan is seeking past unneeded attr keys
+     */
+    bool skip_scan_active() const { return skip_active_; }
 
     /**
      * Re-scan from the beginning (same filter)
@@ -78,6 +318,24 @@ public:
         size_t keys_scanned = 0;
         size_t rows_returned = 0;
         size_t keys_skipped = 0;  // Keys that didn't match pattern
+        size_t seeks = 0;         // Skip-scan seeks past unneeded attr keys
+        size_t rows_filtered = 0; // Rows dropped by the attr filter
+        size_t gets = 0;          // Point-lookup gets (GET mode)
+        size_t bytes_read = 0;    // Bytes of the keys scanned and the values kept
+
+        // With set_timing() only
+        uint64_t read_ns = 0;     // In LevelDB: seeks, steps and gets
+        uint64_t parse_ns = 0;    // Matching keys against the pattern
+
+        /**
+         * Average pattern-matching keys per emitted row (before any
+         * skip-scanning, this is the attrs-per-identity count)
+         */
+        double keys_per_row() const {
+            size_t rows = rows_returned + rows_filtered;
+            return rows == 0 ? 0.0 :
+                static_cast<double>(keys_scanned - keys_skipped) / rows;
+        }
     };
 
     const Stats& stats() const { return stats_; }
@@ -86,26 +344,65 @@ private:
     const Projection& projection_;
     std::shared_ptr<LevelDBConnection> connection_;
     std::unique_ptr<LevelDBIterator> iterator_;
-    std::string prefix_;
+    uint64_t iterator_epoch_ = 0;  // connection_->snapshot_epoch() iterator_ was made under
+    ScanOptions scan_options_;
+    bool timing_ = false;
+    std::vector<KeyRange> ranges_;
+    size_t range_index_ = 0;  // Range being scanned; ranges_.size() when done
+    bool reverse_ = false;    // ranges_ (and point_identities_) are stored
+                              // last first, and keys read with prev()
     Stats stats_;
 
-    // Current row accumulation state
-    std::optional<std::vector<std::string>> current_identity_;
-    std::unordered_map<std::string, std::string> current_attrs_;
+    // Point lookups: each SEEK range holds one identity, and GET mode
+    // walks point_identities_ instead of iterating
+    bool point_ranges_ = false;
+    bool point_gets_ = false;
+    std::vector<std::vector<std::string>> point_identities_;
+    size_t point_index_ = 0;
+    size_t needed_found_ = 0;  // Needed attrs read into current_
 
-    bool is_within_prefix(const std::string& key) const;
-    bool is_within_prefix_view(std::string_view key) const;
-    void accumulate_row();
-    std::optional<PivotRow> emit_current_row();
+    // Row buffers: current_ accumulates while emitted_ holds the row last
+    // returned by next_row(); they swap on emit so neither is reallocated
+    PivotRow current_;
+    PivotRow emitted_;
+    bool has_current_ = false;
+    ParsedKeyView parsed_;  // Reused for every key
+    AttrFilter filter_;
+
+    // The current row's key prefix (everything before {attr}); kept when
+    // skip_supported_, as then it alone tells one row's keys from the next
+    std::string row_prefix_;
 
-    // Helper to convert string_view identity to owned strings
-    static std::vector<std::string> materialize_identity(
-        const std::vector<std::string_view>& views);
+    // Skip-scan state: needed attr names in byte order and a reused seek
+    // target
+    SkipScan skip_scan_mode_ = SkipScan::AUTO;
+    bool skip_supported_ = false;
+    bool skip_active_ = false;
+    std::vector<std::string> needed_attrs_;
+    std::string seek_target_;
 
-    // Helper to compare owned identity with parsed views
-    static bool identity_matches(
-        const std::vector<std::string>& identity,
-        const std::vector<std::string_view>& views);
+    // How a key relates to the row being accumulated
+    enum class KeyMatch {
+        NO_MATCH,  // Doesn't match the pattern
+        SAME_ROW,  // Another attr of the current row
+        NEW_ROW    // First key of a new identity
+    };
+
+    bool is_within_range_view(std::string_view key) const;
+    void position_at_range();
+    bool next_range();
+    void step();
+    const PivotRow* assemble_row();
+    const PivotRow* next_point_get();
+    KeyMatch classify_key(std::string_view key);
+    KeyMatch timed_classify_key(std::string_view key);
+    std::optional<std::string> get_key(const std::string& key);
+    void start_row(const std::vector<std::string_view>& identity);
+    void accumulate_row();
+    void advance();
+    void decide_skip_scan();
+    const PivotRow* emit_current_row();
+    void clear_current();
 };
 
 /**
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+// Forward declarations
+namespace leveldb {
+    class Iterator;
+}
+
+namespace level_pivot {
+
+/**
+ * Batches the prefetching reader keeps ready ahead of the caller
+ */
+constexpr size_t PREFETCH_DEPTH = 4;
+
+/**
+ * Wrap base so that a background thread reads ahead of the caller
+ *
+ * After a seek, the thread copies key/value pairs out of base in
+ * batches of up to batch_keys (small at first, doubling up to
+ * batch_keys, so short reads don't wait on a large batch) and keeps up
+ * to depth batches ready, in the direction of the last move. The caller
+ * then steps through a batch without touching LevelDB, while the thread
+ * reads, decompresses and copies the next ones. A forward seek that
+ * lands inside the batches already read is answered from them.
+ *
+ * base must be a plain LevelDB iterator, safe to read on another thread
+ * while the caller does other work, and must not be used by anyone
+ * else. The thread never calls into PostgreSQL and blocks all signals.
+ * An exception thrown while it reads is rethrown by the caller's seek or
+ * step that reaches the point where reading stopped.
+ */
+std::unique_ptr<leveldb::Iterator> make_prefetch_iterator(
+    std::unique_ptr<leveldb::Iterator> base, size_t batch_keys,
+    size_t depth = PREFETCH_DEPTH);
+
+} // namespace level_pivot
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "level_pivot/attr_lookup.hpp"
 #include "level_pivot/key_pattern.hpp"
 #include "level_pivot/key_parser.hpp"
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -24,9 +26,17 @@ enum class PgType {
     TIMESTAMPTZ,
     DATE,
     JSONB,
-    BYTEA
+    BYTEA,
+    FLOAT8
 };
 
+/**
+ * Parses a stored value as a PostgreSQL Datum of one type
+ *
+ * Returns a Datum (uintptr_t); see TypeConverter::converter_for.
+ */
+using DatumConverter = uintptr_t (*)(std::string_view value);
+
 /**
  * Convert a PostgreSQL type OID to PgType
  */
@@ -111,9 +121,7 @@ public:
      * Check if an attr name is in this projection
      */
     bool has_attr(std::string_view attr_name) const {
-        // unordered_set::count doesn't support heterogeneous lookup in C++17,
-        // so we need to construct a temporary string for the lookup
-        return attr_names_.count(std::string(attr_name)) > 0;
+        return attr_lookup_.contains(attr_name);
     }
 
     /**
@@ -123,10 +131,12 @@ public:
     int identity_column_index(const std::string& capture_name) const;
 
     /**
-     * Get the column index for an attr column by attr name
-     * Returns -1 if not found
+     * Get the attr slot (index into attr_columns()) for an attr name
+     * Returns -1 if not found. Allocation-free; called once per key scanned.
      */
-    int attr_column_index(const std::string& attr_name) const;
+    int attr_column_index(std::string_view attr_name) const {
+        return attr_lookup_.find(attr_name);
+    }
 
     /**
      * Get the number of columns
@@ -136,11 +146,11 @@ public:
     /**
      * Get the identity value index for a column (O(1) lookup)
      *
-     * For identity columns, returns the index into PivotRow::identity_values
+     * For identity columns, returns the index of the PivotRow identity value
      * For non-identity columns, returns -1
      *
      * @param column_index Index into columns()
-     * @return Index into identity_values, or -1 if not identity
+     * @return Identity value index, or -1 if not identity
      */
     int column_to_identity_index(size_t column_index) const {
         if (column_index < column_to_identity_index_.size()) {
@@ -149,6 +159,67 @@ public:
         return -1;
     }
 
+    /**
+     * Get the attr slot for a column (O(1) lookup)
+     *
+     * For attr columns, returns the index into attr_columns(), which is
+     * also the slot in PivotRow's attr values
+     * For identity columns, returns -1
+     *
+     * @param column_index Index into columns()
+     * @return Attr slot, or -1 if identity
+     */
+    int column_to_attr_index(size_t column_index) const {
+        if (column_index < column_to_attr_index_.size()) {
+            return column_to_attr_index_[column_index];
+        }
+        return -1;
+    }
+
+    /**
+     * Restrict the columns a scan has to produce
+     *
+     * Columns not listed read back as NULL: scanners skip their attr
+     * values and DatumBuilder skips their conversion. Identity values are
+     * still parsed from every key since they define row boundaries. By
+     * default every column is needed.
+     *
+     * @param attnums Attribute numbers of the needed columns
+     */
+    void set_needed_columns(const std::vector<int>& attnums);
+
+    /**
+     * Check whether a column (index into columns()) is needed
+     */
+    bool column_needed(size_t column_index) const {
+        return column_needed_[column_index];
+    }
+
+    /**
+     * Set the converter for each column (in columns() order)
+     *
+     * Converters need PostgreSQL, so the FDW picks them when it builds the
+     * projection (TypeConverter::converters_for) rather than the
+     * constructor; DatumBuilder then never dispatches on type per cell.
+     */
+    void set_converters(std::vector<DatumConverter> converters) {
+        converters_ = std::move(converters);
+    }
+
+    /**
+     * Get a column's converter, or nullptr if none were set
+     */
+    DatumConverter converter(size_t column_index) const {
+        return column_index < converters_.size() ? converters_[column_index] : nullptr;
+    }
+
+    /**
+     * Check whether an attr slot is needed
+     */
+    bool attr_slot_needed(size_t slot) const {
+        return attr_slot_needed_[slot];
+    }
+
 private:
     KeyParser parser_;
     std::vector<ColumnDef> columns_;
@@ -158,10 +229,14 @@ private:
     std::unordered_map<int, size_t> column_attnum_index_;
     std::unordered_set<std::string> attr_names_;
     std::vector<int> column_to_identity_index_;  // -1 for non-identity columns
+    std::vector<int> column_to_attr_index_;      // -1 for identity columns
+    std::vector<bool> column_needed_;            // By column index
+    std::vector<bool> attr_slot_needed_;         // By attr slot
+    std::vector<DatumConverter> converters_;     // By column index, may be empty
 
-    // O(1) lookup maps for identity and attr column indices
+    // O(1) lookups for identity and attr column indices
     std::unordered_map<std::string, int> identity_name_to_index_;
-    std::unordered_map<std::string, int> attr_name_to_index_;
+    AttrLookup attr_lookup_;  // attr name -> attr slot
 
     void build_indexes();
     void validate() const;
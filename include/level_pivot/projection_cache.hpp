@@ -0,0 +1,87 @@
+#pragma once
+
+#include "level_pivot/projection.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * A projection checked out of a ProjectionCache
+ */
+struct CachedProjection {
+    std::unique_ptr<Projection> projection;
+    uint64_t generation = 0;  // The table's cache generation at checkout
+};
+
+/**
+ * Backend-local cache of built projections, keyed by table OID
+ *
+ * Building a Projection parses the key pattern, sets up the key parser
+ * and indexes every column. That is cheap once but dominates scans that
+ * read a row or two. A scan checks a projection out, has it to itself
+ * (set_needed_columns() is per scan) and hands it back when done, so the
+ * next scan of the table starts from a built one.
+ *
+ * Invalidating a table drops its idle projections; those still checked
+ * out are stale and get discarded on release instead of reused.
+ *
+ * Scans run on the backend's main thread only, so there is no locking.
+ */
+class ProjectionCache {
+public:
+    using Builder = std::function<std::unique_ptr<Projection>()>;
+
+    /**
+     * Idle projections kept per table; more are only needed while that
+     * many scans of the table run at once
+     */
+    static constexpr size_t MAX_IDLE_PER_TABLE = 4;
+
+    static ProjectionCache& instance();
+
+    /**
+     * Check out a projection of a table
+     *
+     * @param table_oid The foreign table
+     * @param build Called to build one when none is idle
+     */
+    CachedProjection acquire(unsigned int table_oid, const Builder& build);
+
+    /**
+     * Hand a checked-out projection back for reuse
+     *
+     * Every column is needed again afterwards. Projections checked out
+     * before the table was invalidated are destroyed instead.
+     */
+    void release(unsigned int table_oid, CachedProjection cached);
+
+    /**
+     * Forget a table's projections, e.g. after ALTER FOREIGN TABLE
+     */
+    void invalidate(unsigned int table_oid);
+
+    /**
+     * Forget every table's projections
+     */
+    void clear();
+
+    /**
+     * Number of idle projections held for a table
+     */
+    size_t idle_count(unsigned int table_oid) const;
+
+private:
+    struct Entry {
+        uint64_t generation = 0;
+        std::vector<std::unique_ptr<Projection>> idle;
+    };
+
+    std::unordered_map<unsigned int, Entry> entries_;
+    uint64_t next_generation_ = 1;  // Never reused, so stale checkouts can't match
+};
+
+} // namespace level_pivot
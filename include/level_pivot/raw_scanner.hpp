@@ -36,6 +36,28 @@ struct RawScanBounds {
      */
     bool is_past_upper_bound(std::string_view key) const;
 
+    /**
+     * Check if a key is before the lower bound (ends a reverse scan)
+     */
+    bool is_before_lower_bound(std::string_view key) const;
+
+    /**
+     * Narrow the lower bound to key; ignored if the current one is
+     * already at least as tight
+     */
+    void add_lower_bound(const std::string& key, bool inclusive);
+
+    /**
+     * Narrow the upper bound to key; ignored if the current one is
+     * already at least as tight
+     */
+    void add_upper_bound(const std::string& key, bool inclusive);
+
+    /**
+     * Narrow the bounds to keys starting with prefix
+     */
+    void add_prefix(const std::string& prefix);
+
     /**
      * Check if this is an exact match query
      */
@@ -51,10 +73,13 @@ struct RawScanBounds {
 
 /**
  * A single raw key-value row
+ *
+ * Views of the scanner's iterator position, valid until the scanner's
+ * next call
  */
 struct RawRow {
-    std::string key;
-    std::string value;
+    std::string_view key;
+    std::string_view value;
 };
 
 /**
@@ -79,12 +104,38 @@ public:
      */
     void begin_scan(const RawScanBounds& bounds);
 
+    /**
+     * Set how the scan reads blocks (cache filling, checksums); takes
+     * effect at begin_scan()
+     */
+    void set_scan_options(const ScanOptions& scan) {
+        scan_options_ = scan;
+        iterator_.reset();
+    }
+
+    /**
+     * Scan in descending key order; takes effect at begin_scan()
+     */
+    void set_reverse(bool reverse) { reverse_ = reverse; }
+
+    /**
+     * Time the iterator's moves into stats().read_ns; takes effect at
+     * begin_scan()
+     */
+    void set_timing(bool timing) {
+        timing_ = timing;
+        iterator_.reset();
+    }
+
     /**
      * Fetch the next row
      *
-     * @return The next key-value pair, or std::nullopt if no more rows
+     * The key and value are not copied; the iterator only moves on at the
+     * following call.
+     *
+     * @return The next key-value pair, or nullptr if no more rows
      */
-    std::optional<RawRow> next_row();
+    const RawRow* next_row();
 
     /**
      * Re-scan from the beginning (same bounds)
@@ -101,6 +152,9 @@ public:
      */
     struct Stats {
         size_t keys_scanned = 0;
+        size_t rows_returned = 0;
+        size_t bytes_read = 0;  // Bytes of the keys scanned and the values returned
+        uint64_t read_ns = 0;   // In LevelDB seeks and steps (set_timing() only)
     };
 
     const Stats& stats() const { return stats_; }
@@ -108,9 +162,18 @@ public:
 private:
     std::shared_ptr<LevelDBConnection> connection_;
     std::unique_ptr<LevelDBIterator> iterator_;
+    uint64_t iterator_epoch_ = 0;  // connection_->snapshot_epoch() iterator_ was made under
+    ScanOptions scan_options_;
     RawScanBounds bounds_;
     Stats stats_;
+    RawRow row_;
     bool exact_match_returned_ = false;  // For single-row exact match queries
+    bool step_pending_ = false;          // row_ views the iterator; step before reading on
+    bool reverse_ = false;
+    bool timing_ = false;
+
+    void seek_to_upper_bound();
+    void step();
 };
 
 } // namespace level_pivot
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "level_pivot/change_set.hpp"
 #include "level_pivot/connection_manager.hpp"
 #include "level_pivot/error.hpp"
+#include "level_pivot/raw_scanner.hpp"
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace level_pivot {
 
@@ -13,6 +16,7 @@ namespace level_pivot {
 struct RawWriteResult {
     size_t keys_written = 0;
     size_t keys_deleted = 0;
+    size_t rows = 0;  // Rows matched (range operations only)
 };
 
 /**
@@ -42,6 +46,21 @@ public:
      */
     RawWriteResult insert(const std::string& key, const std::string& value);
 
+    /**
+     * Insert several key-value pairs in one WriteBatch
+     *
+     * Uses the writer's batch when batched, otherwise a temporary batch
+     * committed before returning.
+     *
+     * @param keys Keys to write (first count entries are used)
+     * @param values Values, parallel to keys
+     * @param count Number of pairs
+     * @return Write result
+     */
+    RawWriteResult insert_batch(const std::vector<std::string>& keys,
+                                const std::vector<std::string>& values,
+                                size_t count);
+
     /**
      * Update the value for an existing key
      *
@@ -61,6 +80,33 @@ public:
      */
     RawWriteResult remove(const std::string& key);
 
+    /**
+     * Delete every key within bounds, in one iterator pass
+     *
+     * @param bounds Keys to delete
+     * @param scan How the pass reads blocks
+     * @return Write result
+     */
+    RawWriteResult remove_range(const RawScanBounds& bounds,
+                                const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Overwrite the value of every key within bounds, in one iterator pass
+     *
+     * @param bounds Keys to update
+     * @param value The new value
+     * @param scan How the pass reads blocks
+     * @return Write result
+     */
+    RawWriteResult update_range(const RawScanBounds& bounds, const std::string& value,
+                                const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Record every key written from now on in changes (null stops
+     * recording)
+     */
+    void track_changes(ChangeSet* changes) { changes_ = changes; }
+
     /**
      * Check if this writer is using batched mode
      */
@@ -84,9 +130,14 @@ public:
 private:
     std::shared_ptr<LevelDBConnection> connection_;
     std::unique_ptr<LevelDBWriteBatch> batch_;
+    ChangeSet* changes_ = nullptr;  // Keys written, for NOTIFY payloads
 
     void do_put(const std::string& key, const std::string& value);
     void do_del(const std::string& key);
+
+    // Shared pass of remove_range (value null) and update_range
+    RawWriteResult modify_range(const RawScanBounds& bounds, const std::string* value,
+                                const ScanOptions& scan);
 };
 
 } // namespace level_pivot
@@ -2,6 +2,8 @@
 
 #include "level_pivot/key_parser.hpp"
 #include "level_pivot/connection_manager.hpp"
+#include "level_pivot/projection.hpp"
+#include <functional>
 #include <vector>
 #include <unordered_set>
 #include <string>
@@ -15,7 +17,9 @@ namespace level_pivot {
 struct DiscoveredAttr {
     std::string name;
     size_t sample_count = 0;     // Number of times this attr was seen
-    std::string sample_value;    // Sample value for type inference
+    std::string sample_value;    // First value seen
+    std::vector<std::string> samples;  // Up to sample_size values seen
+    PgType inferred_type = PgType::TEXT;  // Narrowest type every sample parses as
 };
 
 /**
@@ -34,6 +38,8 @@ struct DiscoveryOptions {
     size_t max_keys = 10000;     // Maximum keys to scan
     size_t sample_size = 100;    // Number of samples per attr
     std::string prefix_filter;   // Optional prefix to filter keys
+    size_t probes = 1;           // Seek positions spread over the key range
+    size_t threads = 1;          // Probes read concurrently on this many threads
 };
 
 /**
@@ -41,6 +47,12 @@ struct DiscoveryOptions {
  *
  * Scans LevelDB to find all unique attr values matching the pattern,
  * supporting IMPORT FOREIGN SCHEMA functionality.
+ *
+ * With one probe, keys are read in order from the start of the range.
+ * With more, the range is cut into that many parts of about equal size
+ * on disk, and each probe reads its share of max_keys from the start of
+ * its part, so a large database is sampled throughout instead of only at
+ * its first prefix.
  */
 class SchemaDiscovery {
 public:
@@ -81,21 +93,59 @@ public:
      * This is a best-effort heuristic.
      *
      * @param sample_count Number of keys to sample
+     * @param probes Seek positions the samples are spread over
+     * @param threads Threads the probes are read on
      * @return Suggested pattern string, or nullopt if cannot infer
      */
-    std::optional<std::string> infer_pattern(size_t sample_count = 100);
+    std::optional<std::string> infer_pattern(size_t sample_count = 100,
+                                             size_t probes = 1,
+                                             size_t threads = 1);
+
+    /**
+     * Start keys cutting [start, limit) into parts of about equal size
+     *
+     * The first is always start. Sizes come from LevelDB's approximate
+     * sizes; where those see nothing (data still in the memtable), each
+     * part's start is a random key within its share of the key range.
+     * An empty limit means the end of the key space. Fewer than parts
+     * keys come back when the range is too small to cut.
+     */
+    std::vector<std::string> split_points(const std::string& start,
+                                          const std::string& limit,
+                                          size_t parts);
 
 private:
     std::shared_ptr<LevelDBConnection> connection_;
 
+    /**
+     * Reads a probe's keys: the iterator is positioned at the probe's
+     * start; keys from end on belong to the next probe
+     */
+    using Probe = std::function<void(size_t probe, LevelDBIterator& iter,
+                                     const std::string& end)>;
+
+    void run_probes(const std::string& start, const std::string& limit,
+                    size_t probes, size_t threads, const Probe& probe);
+
     // Common delimiters to look for when inferring patterns
     static constexpr const char* COMMON_DELIMITERS[] = {
         "##", "::", "//", "__", ":", "/", ".", "-", "_"
     };
 };
 
+/**
+ * Narrowest type every sample parses as, or TEXT
+ *
+ * Checks INTEGER, BIGINT, NUMERIC, BOOLEAN (true/false), DATE,
+ * TIMESTAMP, TIMESTAMPTZ and JSONB, in the formats their input functions
+ * accept most commonly. No samples gives TEXT.
+ */
+PgType infer_type(const std::vector<std::string>& samples);
+
 /**
  * Generate SQL for creating a foreign table based on discovery
+ *
+ * Attr columns get their inferred types unless use_text_type is set.
  */
 std::string generate_foreign_table_sql(
     const std::string& table_name,
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "level_pivot/attr_filter.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include "level_pivot/key_parser.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * The attr values an index lookup selects
+ *
+ * Built from the pushed-down predicates on one indexed column, ANDed:
+ * = and IN give a list of exact values, each found with one seek; the
+ * range operators and PREFIX give one byte-order range of entries. Values
+ * compare as bytes (the planner only pushes ranges of C-collated text).
+ */
+struct IndexLookup {
+    std::optional<std::vector<std::string>> values;  // Sorted; set by = and IN
+    std::optional<std::string> lower;
+    bool lower_inclusive = true;
+    std::optional<std::string> upper;
+    bool upper_inclusive = true;
+    std::optional<std::string> prefix;
+
+    /**
+     * AND in a predicate
+     *
+     * @return false if the operator can't be answered from the index
+     *         (IS NULL, IS NOT NULL, or a missing operand); nothing is
+     *         added then
+     */
+    bool add(AttrFilterOp op, const std::vector<std::string>& operands);
+
+    /**
+     * True once any predicate has been added
+     */
+    bool empty() const { return !values && !lower && !upper && !prefix; }
+
+    /**
+     * Check a value against every predicate added
+     */
+    bool matches(std::string_view value) const;
+};
+
+/**
+ * Writer-maintained secondary index on attr values
+ *
+ * Each non-NULL value of an indexed attr has one entry pointing back at
+ * its row:
+ *
+ *   idx##<table>##<attr>##<value>##<identity>
+ *
+ * where <identity> is the row's capture values joined by "##". The entry's
+ * value holds the same captures, each as a uint32 length and its bytes,
+ * so entries decode without splitting on a delimiter that values may
+ * contain; the key is rebuilt from them to check the split.
+ *
+ * The Writer keeps entries in step with its puts and deletes, in the same
+ * WriteBatch. Entries can go stale (a row overwritten by INSERT, or
+ * changed by another program), never missing for rows the writer wrote,
+ * so readers recheck the rows they fetch. rebuild() recreates the entries
+ * from the table's keys.
+ */
+class SecondaryIndex {
+public:
+    /**
+     * @param table Name of the index, the <table> segment of its keys
+     * @param attrs Attr names to index
+     */
+    SecondaryIndex(std::string table, std::vector<std::string> attrs);
+
+    /**
+     * Split an index_attrs option ("email, name") into attr names
+     *
+     * @return The trimmed names; empty if any name is empty
+     */
+    static std::vector<std::string> parse_attr_list(const std::string& option);
+
+    const std::string& table() const { return table_; }
+    const std::vector<std::string>& attrs() const { return attrs_; }
+
+    /**
+     * Check if an attr is indexed
+     */
+    bool indexes(std::string_view attr) const;
+
+    /**
+     * "idx##<table>##", the prefix of every entry of this index
+     */
+    std::string table_prefix() const;
+
+    /**
+     * "idx##<table>##<attr>##", the prefix of one attr's entries
+     */
+    std::string attr_prefix(std::string_view attr) const;
+
+    /**
+     * Build the entry for one attr value of a row
+     *
+     * @param attr Indexed attr name
+     * @param value The attr's stored value
+     * @param identity The row's capture values, in pattern order
+     * @param key Set to the entry's key
+     * @param entry_value Set to the entry's value
+     */
+    void build_entry(std::string_view attr, std::string_view value,
+                     const std::vector<std::string>& identity,
+                     std::string& key, std::string& entry_value) const;
+
+    /**
+     * Build just the key of an entry, for deleting it
+     */
+    std::string entry_key(std::string_view attr, std::string_view value,
+                          const std::vector<std::string>& identity) const;
+
+    /**
+     * Find the identities of rows whose attr value matches a lookup
+     *
+     * @param connection Connection to read from
+     * @param attr Indexed attr name
+     * @param lookup Values to find; an empty lookup finds nothing
+     * @param scan How the lookup reads blocks
+     * @return Distinct identities, sorted
+     */
+    std::vector<std::vector<std::string>> lookup(LevelDBConnection& connection,
+                                                 std::string_view attr,
+                                                 const IndexLookup& lookup,
+                                                 const ScanOptions& scan = ScanOptions()) const;
+
+    /**
+     * Counts from rebuild()
+     */
+    struct RebuildResult {
+        size_t entries_deleted = 0;
+        size_t entries_written = 0;
+    };
+
+    /**
+     * Delete every entry of this index and write new ones from the
+     * table's keys
+     *
+     * Writes go out in WriteBatches of batch_keys operations, so the
+     * rebuild isn't atomic: lookups running alongside it can miss rows.
+     *
+     * @param connection Writable connection
+     * @param parser The table's key parser
+     * @param batch_keys Operations per WriteBatch
+     */
+    RebuildResult rebuild(LevelDBConnection& connection, const KeyParser& parser,
+                          size_t batch_keys = 10000) const;
+
+private:
+    std::string table_;
+    std::vector<std::string> attrs_;
+
+    /**
+     * Decode the entry at key under prefix (an attr_prefix())
+     *
+     * @return false if the entry isn't well formed
+     */
+    static bool decode_entry(std::string_view key, std::string_view entry_value,
+                             size_t prefix_size, std::string_view& value,
+                             std::vector<std::string>& identity);
+};
+
+} // namespace level_pivot
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 #include <vector>
 #include <optional>
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 
@@ -14,6 +16,11 @@
 #endif
 #endif
 
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define LEVEL_PIVOT_AARCH64 1
+#include <arm_neon.h>
+#endif
+
 namespace level_pivot {
 
 // =============================================================================
@@ -25,6 +32,8 @@ namespace detail {
 struct CpuFeatures {
     bool has_sse2 = false;
     bool has_avx2 = false;
+    bool has_avx512bw = false;  // With AVX-512F and OS support for its registers
+    bool has_neon = false;      // Always present on AArch64
 
     static const CpuFeatures& get() {
         static const CpuFeatures instance = detect();
@@ -39,26 +48,48 @@ private:
         int cpuInfo[4];
         __cpuid(cpuInfo, 0);
         int nIds = cpuInfo[0];
+        bool os_saves_zmm = false;
 
         if (nIds >= 1) {
             __cpuid(cpuInfo, 1);
             f.has_sse2 = (cpuInfo[3] & (1 << 26)) != 0;
+            if ((cpuInfo[2] & (1 << 27)) != 0) {  // OSXSAVE
+                os_saves_zmm = (_xgetbv(0) & 0xE6) == 0xE6;
+            }
         }
         if (nIds >= 7) {
             __cpuidex(cpuInfo, 7, 0);
             f.has_avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+            f.has_avx512bw = os_saves_zmm &&
+                             (cpuInfo[1] & (1 << 16)) != 0 &&   // AVX-512F
+                             (cpuInfo[1] & (1 << 30)) != 0;     // AVX-512BW
         }
 #else
-        // GCC/Clang
+        // GCC/Clang; these also check the OS saves the wider registers
         __builtin_cpu_init();
         f.has_sse2 = __builtin_cpu_supports("sse2");
         f.has_avx2 = __builtin_cpu_supports("avx2");
+        f.has_avx512bw = __builtin_cpu_supports("avx512f") &&
+                         __builtin_cpu_supports("avx512bw");
+#endif
 #endif
+#if defined(LEVEL_PIVOT_AARCH64)
+        f.has_neon = true;
 #endif
         return f;
     }
 };
 
+inline unsigned count_trailing_zeros(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long bit_pos;
+    _BitScanForward64(&bit_pos, mask);
+    return static_cast<unsigned>(bit_pos);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
 } // namespace detail
 
 // =============================================================================
@@ -67,177 +98,424 @@ private:
 
 namespace detail {
 
-// Scalar implementation (always available)
-inline void find_delimiters_scalar(
-    const char* data, size_t len, size_t start,
-    char d0, char d1, size_t delim_len,
-    size_t* positions, size_t& count, size_t max_count)
-{
-    if (delim_len == 2) {
-        size_t i = start;
-        count = 0;
-        while (i + 1 < len && count < max_count) {
-            if (data[i] == d0 && data[i + 1] == d1) {
+/**
+ * Delimiter occurrences found so far in one key
+ *
+ * Matches never overlap: each starts at or after the end of the one
+ * before, so the positions are those a left-to-right find() loop would
+ * return. Kernels compare a vector of bytes against the delimiter's first
+ * byte and a vector delim_len - 1 further on against its last; each lane
+ * set in both is a candidate, and the bytes between are checked here.
+ */
+struct DelimiterMatches {
+    const char* data;
+    size_t len;
+    const char* delim;
+    size_t delim_len;
+    size_t* positions;
+    size_t max_count;
+    size_t count = 0;
+    size_t next = 0;  // Earliest start for the next match
+
+    DelimiterMatches(const char* data, size_t len, size_t start,
+                     const char* delim, size_t delim_len,
+                     size_t* positions, size_t max_count)
+        : data(data), len(len), delim(delim), delim_len(delim_len),
+          positions(positions), max_count(max_count), next(start) {}
+
+    bool full() const { return count >= max_count; }
+
+    /**
+     * Record candidates at base + lane, one mask bit per lane every
+     * 2^lane_shift bits (x86 movemasks use 0, NEON's narrowed masks 2)
+     */
+    void add_candidates(uint64_t mask, size_t base, unsigned lane_shift) {
+        while (mask && !full()) {
+            size_t pos = base + (count_trailing_zeros(mask) >> lane_shift);
+            mask &= mask - 1;
+            if (pos >= next &&
+                (delim_len <= 2 ||
+                 std::memcmp(data + pos + 1, delim + 1, delim_len - 2) == 0)) {
+                positions[count++] = pos;
+                next = pos + delim_len;
+            }
+        }
+    }
+
+    // Bytes from `from` on without vectors (short keys and tails)
+    void scan_tail(size_t from) {
+        size_t i = std::max(from, next);
+        while (i + delim_len <= len && !full()) {
+            const void* hit = std::memchr(data + i, delim[0], len - delim_len + 1 - i);
+            if (!hit) {
+                break;
+            }
+            i = static_cast<size_t>(static_cast<const char*>(hit) - data);
+            if (std::memcmp(data + i, delim, delim_len) == 0) {
                 positions[count++] = i;
-                i += 2;
+                i += delim_len;
             } else {
                 ++i;
             }
         }
-    } else {
-        // General case - use string_view::find
-        std::string_view key(data, len);
-        std::string_view delim(&d0, delim_len);
-        size_t pos = start;
-        count = 0;
-        while ((pos = key.find(delim, pos)) != std::string_view::npos && count < max_count) {
-            positions[count++] = pos;
-            pos += delim_len;
-        }
+    }
+};
+
+// Scalar implementation (always available)
+inline void find_delimiters_scalar(
+    const char* data, size_t len, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t& count, size_t max_count)
+{
+    DelimiterMatches matches(data, len, start, delim, delim_len, positions, max_count);
+    if (delim_len > 0) {
+        matches.scan_tail(start);
+    }
+    count = matches.count;
+}
+
+inline void find_delimiters_batch_scalar(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count)
+{
+    for (size_t k = 0; k < num_keys; ++k) {
+        find_delimiters_scalar(keys[k].data(), keys[k].size(), start, delim, delim_len,
+                               positions + k * max_count, counts[k], max_count);
     }
 }
 
 #if defined(LEVEL_PIVOT_X86_64)
 
-// SSE2 implementation
 #if defined(_MSC_VER)
-inline void find_delimiters_sse2(
+#define LEVEL_PIVOT_TARGET(isa)
 #else
-__attribute__((target("sse2")))
-inline void find_delimiters_sse2(
+#define LEVEL_PIVOT_TARGET(isa) __attribute__((target(isa)))
 #endif
+
+// SSE2 implementation
+LEVEL_PIVOT_TARGET("sse2")
+inline void find_in_sse2(DelimiterMatches& m, size_t start, __m128i first, __m128i last) {
+    const size_t last_off = m.delim_len - 1;
+    size_t i = start;
+
+    while (i + last_off + 16 <= m.len && !m.full()) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m.data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m.data + i + last_off));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last));
+        m.add_candidates(static_cast<uint32_t>(_mm_movemask_epi8(eq)), i, 0);
+        i += 16;
+    }
+    m.scan_tail(i);
+}
+
+LEVEL_PIVOT_TARGET("sse2")
+inline void find_delimiters_sse2(
     const char* data, size_t len, size_t start,
-    char d0, char d1, size_t delim_len,
+    const char* delim, size_t delim_len,
     size_t* positions, size_t& count, size_t max_count)
 {
-    if (delim_len != 2) {
-        find_delimiters_scalar(data, len, start, d0, d1, delim_len, positions, count, max_count);
+    DelimiterMatches matches(data, len, start, delim, delim_len, positions, max_count);
+    if (delim_len > 0) {
+        find_in_sse2(matches, start, _mm_set1_epi8(delim[0]), _mm_set1_epi8(delim[delim_len - 1]));
+    }
+    count = matches.count;
+}
+
+LEVEL_PIVOT_TARGET("sse2")
+inline void find_delimiters_batch_sse2(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count)
+{
+    if (delim_len == 0) {
+        std::fill(counts, counts + num_keys, 0);
         return;
     }
+    __m128i first = _mm_set1_epi8(delim[0]);
+    __m128i last = _mm_set1_epi8(delim[delim_len - 1]);
+    for (size_t k = 0; k < num_keys; ++k) {
+        DelimiterMatches matches(keys[k].data(), keys[k].size(), start, delim, delim_len,
+                                 positions + k * max_count, max_count);
+        find_in_sse2(matches, start, first, last);
+        counts[k] = matches.count;
+    }
+}
 
-    __m128i vd0 = _mm_set1_epi8(d0);
+// AVX2 implementation
+LEVEL_PIVOT_TARGET("avx2")
+inline void find_in_avx2(DelimiterMatches& m, size_t start, __m256i first, __m256i last) {
+    const size_t last_off = m.delim_len - 1;
     size_t i = start;
-    count = 0;
 
-    while (i + 16 <= len && count < max_count) {
-        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
-        __m128i eq0 = _mm_cmpeq_epi8(chunk, vd0);
-        uint32_t mask0 = static_cast<uint32_t>(_mm_movemask_epi8(eq0));
+    while (i + last_off + 32 <= m.len && !m.full()) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m.data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m.data + i + last_off));
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last));
+        m.add_candidates(static_cast<uint32_t>(_mm256_movemask_epi8(eq)), i, 0);
+        i += 32;
+    }
+    m.scan_tail(i);
+}
 
-        while (mask0 && count < max_count) {
-#if defined(_MSC_VER)
-            unsigned long bit_pos;
-            _BitScanForward(&bit_pos, mask0);
-#else
-            uint32_t bit_pos = static_cast<uint32_t>(__builtin_ctz(mask0));
-#endif
-            size_t pos = i + bit_pos;
+LEVEL_PIVOT_TARGET("avx2")
+inline void find_delimiters_avx2(
+    const char* data, size_t len, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t& count, size_t max_count)
+{
+    DelimiterMatches matches(data, len, start, delim, delim_len, positions, max_count);
+    if (delim_len > 0) {
+        find_in_avx2(matches, start, _mm256_set1_epi8(delim[0]),
+                     _mm256_set1_epi8(delim[delim_len - 1]));
+    }
+    count = matches.count;
+}
 
-            if (pos + 1 < len && data[pos + 1] == d1) {
-                positions[count++] = pos;
-            }
-            mask0 &= mask0 - 1;
-        }
-        i += 16;
+LEVEL_PIVOT_TARGET("avx2")
+inline void find_delimiters_batch_avx2(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count)
+{
+    if (delim_len == 0) {
+        std::fill(counts, counts + num_keys, 0);
+        return;
+    }
+    __m256i first = _mm256_set1_epi8(delim[0]);
+    __m256i last = _mm256_set1_epi8(delim[delim_len - 1]);
+    for (size_t k = 0; k < num_keys; ++k) {
+        DelimiterMatches matches(keys[k].data(), keys[k].size(), start, delim, delim_len,
+                                 positions + k * max_count, max_count);
+        find_in_avx2(matches, start, first, last);
+        counts[k] = matches.count;
     }
+}
 
-    // Handle tail
-    while (i + 1 < len && count < max_count) {
-        if (data[i] == d0 && data[i + 1] == d1) {
-            positions[count++] = i;
-        }
-        ++i;
+/**
+ * AVX-512BW implementation
+ *
+ * Masked loads read only the lanes that hold candidate starts and never
+ * fault on the lanes left out, so keys shorter than a vector and the end
+ * of longer ones are searched in vector registers too, with no scalar
+ * tail.
+ */
+LEVEL_PIVOT_TARGET("avx512f,avx512bw")
+inline void find_in_avx512(DelimiterMatches& m, size_t start, __m512i first, __m512i last) {
+    const size_t last_off = m.delim_len - 1;
+    size_t i = start;
+
+    while (i + m.delim_len <= m.len && !m.full()) {
+        size_t candidates = std::min<size_t>(64, m.len - last_off - i);
+        __mmask64 lanes = candidates == 64 ? ~0ULL : (1ULL << candidates) - 1;
+        __m512i a = _mm512_maskz_loadu_epi8(lanes, m.data + i);
+        __m512i b = _mm512_maskz_loadu_epi8(lanes, m.data + i + last_off);
+        __mmask64 eq = _mm512_mask_cmpeq_epi8_mask(
+            _mm512_mask_cmpeq_epi8_mask(lanes, a, first), b, last);
+        m.add_candidates(static_cast<uint64_t>(eq), i, 0);
+        i += 64;
     }
 }
 
-// AVX2 implementation
-#if defined(_MSC_VER)
-inline void find_delimiters_avx2(
-#else
-__attribute__((target("avx2")))
-inline void find_delimiters_avx2(
-#endif
+LEVEL_PIVOT_TARGET("avx512f,avx512bw")
+inline void find_delimiters_avx512bw(
     const char* data, size_t len, size_t start,
-    char d0, char d1, size_t delim_len,
+    const char* delim, size_t delim_len,
     size_t* positions, size_t& count, size_t max_count)
 {
-    if (delim_len != 2) {
-        find_delimiters_scalar(data, len, start, d0, d1, delim_len, positions, count, max_count);
+    DelimiterMatches matches(data, len, start, delim, delim_len, positions, max_count);
+    if (delim_len > 0) {
+        find_in_avx512(matches, start, _mm512_set1_epi8(delim[0]),
+                       _mm512_set1_epi8(delim[delim_len - 1]));
+    }
+    count = matches.count;
+}
+
+LEVEL_PIVOT_TARGET("avx512f,avx512bw")
+inline void find_delimiters_batch_avx512bw(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count)
+{
+    if (delim_len == 0) {
+        std::fill(counts, counts + num_keys, 0);
         return;
     }
+    __m512i first = _mm512_set1_epi8(delim[0]);
+    __m512i last = _mm512_set1_epi8(delim[delim_len - 1]);
+    for (size_t k = 0; k < num_keys; ++k) {
+        DelimiterMatches matches(keys[k].data(), keys[k].size(), start, delim, delim_len,
+                                 positions + k * max_count, max_count);
+        find_in_avx512(matches, start, first, last);
+        counts[k] = matches.count;
+    }
+}
 
-    __m256i vd0 = _mm256_set1_epi8(d0);
-    size_t i = start;
-    count = 0;
+#undef LEVEL_PIVOT_TARGET
 
-    while (i + 32 <= len && count < max_count) {
-        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
-        __m256i eq0 = _mm256_cmpeq_epi8(chunk, vd0);
-        uint32_t mask0 = static_cast<uint32_t>(_mm256_movemask_epi8(eq0));
+#endif // LEVEL_PIVOT_X86_64
 
-        while (mask0 && count < max_count) {
-#if defined(_MSC_VER)
-            unsigned long bit_pos;
-            _BitScanForward(&bit_pos, mask0);
-#else
-            uint32_t bit_pos = static_cast<uint32_t>(__builtin_ctz(mask0));
-#endif
-            size_t pos = i + bit_pos;
+#if defined(LEVEL_PIVOT_AARCH64)
 
-            if (pos + 1 < len && data[pos + 1] == d1) {
-                positions[count++] = pos;
-            }
-            mask0 &= mask0 - 1;
-        }
-        i += 32;
+/**
+ * NEON implementation
+ *
+ * NEON has no movemask; narrowing each 16-bit lane pair by 4 bits packs
+ * the comparison into 4 bits per byte in a 64-bit mask. Keeping one bit
+ * of each nibble leaves one bit per byte lane, 4 bits apart.
+ */
+inline void find_in_neon(DelimiterMatches& m, size_t start, uint8x16_t first, uint8x16_t last) {
+    const size_t last_off = m.delim_len - 1;
+    size_t i = start;
+
+    while (i + last_off + 16 <= m.len && !m.full()) {
+        uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(m.data + i));
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(m.data + i + last_off));
+        uint8x16_t eq = vandq_u8(vceqq_u8(a, first), vceqq_u8(b, last));
+        uint8x8_t packed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(packed), 0) & 0x8888888888888888ULL;
+        m.add_candidates(mask >> 3, i, 2);
+        i += 16;
     }
+    m.scan_tail(i);
+}
 
-    // Handle tail with SSE2 or scalar
-    while (i + 1 < len && count < max_count) {
-        if (data[i] == d0 && data[i + 1] == d1) {
-            positions[count++] = i;
-        }
-        ++i;
+inline void find_delimiters_neon(
+    const char* data, size_t len, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t& count, size_t max_count)
+{
+    DelimiterMatches matches(data, len, start, delim, delim_len, positions, max_count);
+    if (delim_len > 0) {
+        find_in_neon(matches, start, vdupq_n_u8(static_cast<uint8_t>(delim[0])),
+                     vdupq_n_u8(static_cast<uint8_t>(delim[delim_len - 1])));
     }
+    count = matches.count;
 }
 
-#endif // LEVEL_PIVOT_X86_64
+inline void find_delimiters_batch_neon(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count)
+{
+    if (delim_len == 0) {
+        std::fill(counts, counts + num_keys, 0);
+        return;
+    }
+    uint8x16_t first = vdupq_n_u8(static_cast<uint8_t>(delim[0]));
+    uint8x16_t last = vdupq_n_u8(static_cast<uint8_t>(delim[delim_len - 1]));
+    for (size_t k = 0; k < num_keys; ++k) {
+        DelimiterMatches matches(keys[k].data(), keys[k].size(), start, delim, delim_len,
+                                 positions + k * max_count, max_count);
+        find_in_neon(matches, start, first, last);
+        counts[k] = matches.count;
+    }
+}
+
+#endif // LEVEL_PIVOT_AARCH64
 
 // Function pointer type for delimiter finding
 using FindDelimitersFn = void(*)(
     const char* data, size_t len, size_t start,
-    char d0, char d1, size_t delim_len,
+    const char* delim, size_t delim_len,
     size_t* positions, size_t& count, size_t max_count);
 
+// Same for a block of keys: key k's matches go to positions[k * max_count]
+using FindDelimitersBatchFn = void(*)(
+    const std::string_view* keys, size_t num_keys, size_t start,
+    const char* delim, size_t delim_len,
+    size_t* positions, size_t* counts, size_t max_count);
+
+/**
+ * A delimiter kernel for one instruction set
+ */
+struct DelimiterKernel {
+    const char* name;
+    FindDelimitersFn find;
+    FindDelimitersBatchFn find_batch;
+};
+
 // Runtime dispatcher - selects best implementation once
-inline FindDelimitersFn select_find_delimiters() {
+inline DelimiterKernel select_delimiter_kernel() {
 #if defined(LEVEL_PIVOT_X86_64)
     const auto& cpu = CpuFeatures::get();
-    if (cpu.has_avx2) return find_delimiters_avx2;
-    if (cpu.has_sse2) return find_delimiters_sse2;
+    if (cpu.has_avx512bw) {
+        return {"AVX-512BW", find_delimiters_avx512bw, find_delimiters_batch_avx512bw};
+    }
+    if (cpu.has_avx2) return {"AVX2", find_delimiters_avx2, find_delimiters_batch_avx2};
+    if (cpu.has_sse2) return {"SSE2", find_delimiters_sse2, find_delimiters_batch_sse2};
 #endif
-    return find_delimiters_scalar;
+#if defined(LEVEL_PIVOT_AARCH64)
+    return {"NEON", find_delimiters_neon, find_delimiters_batch_neon};
+#else
+    return {"scalar", find_delimiters_scalar, find_delimiters_batch_scalar};
+#endif
+}
+
+// Global kernel - selected once on first use
+inline const DelimiterKernel& get_delimiter_kernel() {
+    static const DelimiterKernel kernel = select_delimiter_kernel();
+    return kernel;
+}
+
+inline FindDelimitersFn select_find_delimiters() {
+    return select_delimiter_kernel().find;
 }
 
-// Global function pointer - initialized once on first use
 inline FindDelimitersFn get_find_delimiters() {
-    static const FindDelimitersFn fn = select_find_delimiters();
-    return fn;
+    return get_delimiter_kernel().find;
+}
+
+/**
+ * Every kernel this CPU can run, scalar first (for tests and benchmarks)
+ */
+inline std::vector<DelimiterKernel> available_delimiter_kernels() {
+    std::vector<DelimiterKernel> kernels = {
+        {"scalar", find_delimiters_scalar, find_delimiters_batch_scalar}};
+#if defined(LEVEL_PIVOT_X86_64)
+    const auto& cpu = CpuFeatures::get();
+    if (cpu.has_sse2) {
+        kernels.push_back({"SSE2", find_delimiters_sse2, find_delimiters_batch_sse2});
+    }
+    if (cpu.has_avx2) {
+        kernels.push_back({"AVX2", find_delimiters_avx2, find_delimiters_batch_avx2});
+    }
+    if (cpu.has_avx512bw) {
+        kernels.push_back({"AVX-512BW", find_delimiters_avx512bw, find_delimiters_batch_avx512bw});
+    }
+#endif
+#if defined(LEVEL_PIVOT_AARCH64)
+    kernels.push_back({"NEON", find_delimiters_neon, find_delimiters_batch_neon});
+#endif
+    return kernels;
 }
 
 } // namespace detail
 
 /**
- * SIMD-optimized key parser for patterns with a single repeated delimiter
+ * SIMD-optimized key parser for patterns whose captures and attr are
+ * separated by literals
  *
- * This is a specialized fast-path for common patterns like:
+ * This is a specialized fast-path for patterns like:
  *   prefix##capture1##capture2##...##attr
+ *   prefix/capture1::capture2/attr
  *
- * Uses runtime CPU detection to select SSE2/AVX2/scalar implementation.
- * Detection happens once at startup; subsequent calls have zero overhead.
+ * A key is the literal prefix, then each capture followed by its
+ * separator, then the attr, which runs to the end of the key. As in
+ * KeyParser's generic path, each capture ends at the first occurrence of
+ * its separator, and captures and the attr must not be empty.
+ *
+ * When every separator is the same, one kernel call finds them all;
+ * otherwise each is searched for in turn from the end of the last.
+ *
+ * Uses runtime CPU detection to select an AVX-512BW/AVX2/SSE2, NEON or
+ * scalar kernel. Detection happens once at startup; subsequent calls
+ * have zero overhead.
  */
 class SimdKeyParser {
 public:
+    static constexpr size_t MAX_CAPTURES = 16;
+
     /**
      * Result of SIMD parsing - zero-copy views into original key
      */
@@ -255,73 +533,44 @@ public:
      * @param num_captures Number of capture segments (not including attr)
      */
     SimdKeyParser(std::string_view prefix, std::string_view delimiter, size_t num_captures)
-        : prefix_(prefix)
-        , delimiter_(delimiter)
-        , num_captures_(num_captures)
-        , num_delimiters_(num_captures + 1)
-        , find_delimiters_(detail::get_find_delimiters())
+        : SimdKeyParser(std::string(prefix) + std::string(delimiter),
+                        std::vector<std::string>(num_captures, std::string(delimiter)))
     {
     }
 
     /**
-     * Parse a key using SIMD-accelerated delimiter search
+     * Create a parser for a pattern with any separators
+     *
+     * @param prefix Literal text before the first capture, including any
+     *               delimiter (e.g., "users##"; may be empty)
+     * @param separators Literal after each capture, in order (one per
+     *                   capture, none empty; at most MAX_CAPTURES)
      */
-    std::optional<Result> parse(std::string_view key) const {
-        // Quick prefix check
-        if (key.size() < prefix_.size() + delimiter_.size() * num_delimiters_) {
-            return std::nullopt;
-        }
-
-        if (!prefix_.empty()) {
-            if (key.substr(0, prefix_.size()) != prefix_) {
-                return std::nullopt;
-            }
-        }
-
-        // Find all delimiter positions using runtime-selected SIMD
-        size_t search_start = prefix_.size();
-        size_t delim_stack[17];
-        size_t delim_count = 0;
-
-        find_delimiters_(
-            key.data(), key.size(), search_start,
-            delimiter_[0], delimiter_.size() > 1 ? delimiter_[1] : '\0', delimiter_.size(),
-            delim_stack, delim_count, num_delimiters_ + 1);
-
-        // Validate we found exactly the right number of delimiters
-        if (delim_count != num_delimiters_) {
-            return std::nullopt;
+    SimdKeyParser(std::string prefix, std::vector<std::string> separators)
+        : prefix_(std::move(prefix))
+        , separators_(std::move(separators))
+        , num_captures_(separators_.size())
+        , min_key_size_(prefix_.size() + 1)
+        , kernel_(&detail::get_delimiter_kernel())
+    {
+        uniform_ = true;
+        for (const auto& separator : separators_) {
+            min_key_size_ += separator.size() + 1;
+            uniform_ = uniform_ && separator == separators_.front();
         }
+    }
 
-        // Extract captures and attr
+    /**
+     * Parse a key using SIMD-accelerated delimiter search
+     */
+    std::optional<Result> parse(std::string_view key) const {
+        std::string_view captures[MAX_CAPTURES];
         Result result;
-        result.prefix = key.substr(0, prefix_.size());
-        result.captures.reserve(num_captures_);
-
-        size_t pos = prefix_.size();
-
-        // First delimiter should be right after prefix
-        if (delim_stack[0] != pos) {
+        if (!parse_fast(key, captures, result.attr)) {
             return std::nullopt;
         }
-        pos += delimiter_.size();
-
-        // Extract each capture
-        for (size_t i = 0; i < num_captures_; ++i) {
-            size_t end = delim_stack[i + 1];
-            if (end <= pos) {
-                return std::nullopt;  // Empty capture
-            }
-            result.captures.push_back(key.substr(pos, end - pos));
-            pos = end + delimiter_.size();
-        }
-
-        // Remaining is attr
-        if (pos >= key.size()) {
-            return std::nullopt;  // Empty attr
-        }
-        result.attr = key.substr(pos);
-
+        result.prefix = key.substr(0, prefix_.size());
+        result.captures.assign(captures, captures + num_captures_);
         return result;
     }
 
@@ -332,71 +581,135 @@ public:
     bool parse_fast(std::string_view key,
                     std::string_view* captures,  // Pre-allocated array
                     std::string_view& attr) const {
-        // Quick prefix check
-        if (key.size() < prefix_.size() + delimiter_.size() * num_delimiters_) {
+        if (!matches_prefix(key)) {
             return false;
         }
 
-        if (!prefix_.empty()) {
-            if (key.substr(0, prefix_.size()) != prefix_) {
-                return false;
+        size_t delim_stack[MAX_CAPTURES];
+        size_t delim_count = 0;
+
+        if (uniform_) {
+            if (num_captures_ > 0) {
+                const std::string& delim = separators_.front();
+                kernel_->find(key.data(), key.size(), prefix_.size(),
+                             delim.data(), delim.size(),
+                             delim_stack, delim_count, num_captures_);
+            }
+        } else {
+            size_t pos = prefix_.size();
+            for (; delim_count < num_captures_; ++delim_count) {
+                const std::string& delim = separators_[delim_count];
+                size_t found = 0;
+                kernel_->find(key.data(), key.size(), pos, delim.data(), delim.size(),
+                             &delim_stack[delim_count], found, 1);
+                if (found == 0) {
+                    return false;
+                }
+                pos = delim_stack[delim_count] + delim.size();
             }
         }
 
-        size_t search_start = prefix_.size();
-        size_t delim_stack[17];
-        size_t delim_count = 0;
+        return split(key, delim_stack, delim_count, captures, attr);
+    }
+
+    /**
+     * Parse a block of keys at once
+     *
+     * Fills captures[k * capture_count() ...] and attrs[k] for each key
+     * k that parses, and sets matched[k]. The kernel is dispatched and its
+     * delimiter vectors set up once for the block rather than per key,
+     * which is most of the cost for short keys.
+     *
+     * @return Number of keys that parsed
+     */
+    size_t parse_batch(const std::string_view* keys, size_t num_keys,
+                       std::string_view* captures, std::string_view* attrs,
+                       bool* matched) const {
+        if (!uniform_ || num_captures_ == 0) {
+            size_t parsed = 0;
+            for (size_t k = 0; k < num_keys; ++k) {
+                matched[k] = parse_fast(keys[k], captures + k * num_captures_, attrs[k]);
+                parsed += matched[k];
+            }
+            return parsed;
+        }
 
-        find_delimiters_(
-            key.data(), key.size(), search_start,
-            delimiter_[0], delimiter_.size() > 1 ? delimiter_[1] : '\0', delimiter_.size(),
-            delim_stack, delim_count, num_delimiters_ + 1);
+        constexpr size_t BLOCK = 64;
+        size_t positions[BLOCK * MAX_CAPTURES];
+        size_t counts[BLOCK];
+        std::string_view block[BLOCK];
+        const std::string& delim = separators_.front();
+        size_t parsed = 0;
 
-        if (delim_count != num_delimiters_) {
-            return false;
+        for (size_t base = 0; base < num_keys; base += BLOCK) {
+            size_t n = std::min(BLOCK, num_keys - base);
+
+            // Keys failing the prefix check are searched as empty keys
+            for (size_t k = 0; k < n; ++k) {
+                block[k] = matches_prefix(keys[base + k]) ? keys[base + k] : std::string_view();
+            }
+            kernel_->find_batch(block, n, prefix_.size(), delim.data(), delim.size(),
+                               positions, counts, num_captures_);
+
+            for (size_t k = 0; k < n; ++k) {
+                size_t key = base + k;
+                matched[key] = !block[k].empty() &&
+                               split(block[k], positions + k * num_captures_, counts[k],
+                                     captures + key * num_captures_, attrs[key]);
+                parsed += matched[key];
+            }
         }
+        return parsed;
+    }
 
-        size_t pos = prefix_.size();
-        if (delim_stack[0] != pos) {
+    size_t capture_count() const { return num_captures_; }
+
+    /**
+     * Get the name of the SIMD implementation being used
+     */
+    static const char* implementation_name() {
+        return detail::get_delimiter_kernel().name;
+    }
+
+private:
+    std::string prefix_;
+    std::vector<std::string> separators_;
+    size_t num_captures_;
+    size_t min_key_size_;  // Prefix, separators and one byte per capture and attr
+    bool uniform_ = true;  // All separators the same
+    const detail::DelimiterKernel* kernel_;
+
+    bool matches_prefix(std::string_view key) const {
+        return key.size() >= min_key_size_ &&
+               std::memcmp(key.data(), prefix_.data(), prefix_.size()) == 0;
+    }
+
+    /**
+     * Cut the key at the separators found; false unless all were found
+     * and no capture or the attr is empty
+     */
+    bool split(std::string_view key, const size_t* delims, size_t delim_count,
+               std::string_view* captures, std::string_view& attr) const {
+        if (delim_count != num_captures_) {
             return false;
         }
-        pos += delimiter_.size();
 
+        size_t pos = prefix_.size();
         for (size_t i = 0; i < num_captures_; ++i) {
-            size_t end = delim_stack[i + 1];
+            size_t end = delims[i];
             if (end <= pos) {
-                return false;
+                return false;  // Empty capture
             }
             captures[i] = key.substr(pos, end - pos);
-            pos = end + delimiter_.size();
+            pos = end + separators_[i].size();
         }
 
         if (pos >= key.size()) {
-            return false;
+            return false;  // Empty attr
         }
         attr = key.substr(pos);
-
         return true;
     }
-
-    /**
-     * Get the name of the SIMD implementation being used
-     */
-    static const char* implementation_name() {
-#if defined(LEVEL_PIVOT_X86_64)
-        const auto& cpu = detail::CpuFeatures::get();
-        if (cpu.has_avx2) return "AVX2";
-        if (cpu.has_sse2) return "SSE2";
-#endif
-        return "scalar";
-    }
-
-private:
-    std::string_view prefix_;
-    std::string_view delimiter_;
-    size_t num_captures_;
-    size_t num_delimiters_;
-    detail::FindDelimitersFn find_delimiters_;
 };
 
 } // namespace level_pivot
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * Activity counters for one foreign table
+ *
+ * A scan or modify adds up its own counts here and hands them to
+ * TableMetrics when it ends. Every field is a uint64_t counter; the
+ * shared table relies on that to add them field by field.
+ */
+struct TableCounters {
+    uint64_t scans = 0;           // Scans begun, rescans included
+    uint64_t keys_scanned = 0;    // Keys read within the scans' ranges
+    uint64_t keys_skipped = 0;    // Keys read that didn't match the pattern
+    uint64_t seeks = 0;           // Skip-scan and row seeks
+    uint64_t gets = 0;            // Point-lookup gets
+    uint64_t rows_returned = 0;
+    uint64_t bytes_read = 0;      // Key bytes scanned and value bytes kept
+    uint64_t rows_inserted = 0;
+    uint64_t rows_updated = 0;
+    uint64_t rows_deleted = 0;
+    uint64_t keys_written = 0;    // Puts
+    uint64_t keys_deleted = 0;    // Deletes
+    uint64_t write_batches = 0;   // WriteBatches committed
+    uint64_t batch_keys = 0;      // Puts and deletes in those batches
+
+    TableCounters& operator+=(const TableCounters& other);
+
+    bool empty() const;
+};
+
+/**
+ * Cumulative TableCounters per table, shared between processes
+ *
+ * A fixed number of slots, each claimed by the first table that records
+ * into it and kept by that table from then on. Everything is a lock-free
+ * atomic, so the table can live in shared memory and be updated by any
+ * number of backends at once: create() builds it in place in a block of
+ * memory_size() bytes. Readers see each counter exactly, but a table's
+ * counters may be read in the middle of another backend's add().
+ *
+ * Tables are identified by a nonzero 64-bit id (the extension uses the
+ * database and relation OIDs).
+ */
+class TableMetrics {
+public:
+    /**
+     * Bytes create() needs for capacity slots
+     */
+    static size_t memory_size(size_t capacity);
+
+    /**
+     * Build an empty table in memory (memory_size(capacity) bytes,
+     * 8-byte aligned)
+     */
+    static TableMetrics* create(void* memory, size_t capacity);
+
+    /**
+     * Add counters to a table's totals
+     *
+     * @return false if the table has no slot and none is left; the
+     *         counters are dropped
+     */
+    bool add(uint64_t table, const TableCounters& counters);
+
+    /**
+     * Every table with a slot and its totals, in slot order
+     */
+    std::vector<std::pair<uint64_t, TableCounters>> read() const;
+
+    /**
+     * Zero every table's totals; tables keep their slots
+     */
+    void reset();
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    static constexpr size_t COUNTER_COUNT = sizeof(TableCounters) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> table;  // 0 = free
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+    };
+
+    size_t capacity_;
+
+    explicit TableMetrics(size_t capacity) : capacity_(capacity) {}
+
+    Slot* slots();
+    const Slot* slots() const;
+    Slot* find_slot(uint64_t table);
+};
+
+} // namespace level_pivot
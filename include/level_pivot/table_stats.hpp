@@ -0,0 +1,186 @@
+#pragma once
+
+#include "level_pivot/key_parser.hpp"
+#include "level_pivot/raw_scanner.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace level_pivot {
+
+/**
+ * Planner-facing size estimate for a scan range
+ */
+struct SizeEstimate {
+    double rows = 0;              // Estimated rows (distinct identities, or raw keys)
+    double keys = 0;              // Estimated LevelDB keys visited by the scan
+    double keys_per_row = 1;      // Average attr keys per identity
+    double avg_identity_width = 0;  // Average bytes of all capture values per row
+    double avg_value_width = 0;   // Average bytes per value
+    uint64_t approximate_bytes = 0;  // GetApproximateSizes over the range
+    bool exact = false;           // True if the sample covered the entire range
+};
+
+/**
+ * Options controlling the sampled scan
+ */
+struct SamplingOptions {
+    size_t max_sample_keys = 2000;  // Keys read before extrapolating
+};
+
+/**
+ * Estimates row counts and widths for query planning
+ *
+ * Combines LevelDB's GetApproximateSizes over the scan range with a short
+ * sampled scan from the start of the range. The sample gives bytes-per-key,
+ * keys-per-row and value widths; the approximate size scales those up to
+ * the whole range. Small ranges that fit in the sample are counted exactly.
+ */
+class SizeEstimator {
+public:
+    explicit SizeEstimator(std::shared_ptr<LevelDBConnection> connection);
+
+    /**
+     * Estimate a pivot scan over the given identity prefix
+     *
+     * @param parser Key parser for the table's pattern
+     * @param prefix_values Leading identity values pushed down (may be empty)
+     * @param options Sampling options
+     */
+    SizeEstimate estimate_pivot(const KeyParser& parser,
+                                const std::vector<std::string>& prefix_values,
+                                const SamplingOptions& options = {});
+
+    /**
+     * Estimate a raw scan over the given bounds
+     */
+    SizeEstimate estimate_raw(const RawScanBounds& bounds,
+                              const SamplingOptions& options = {});
+
+private:
+    std::shared_ptr<LevelDBConnection> connection_;
+};
+
+/**
+ * Finds keys at given fractions of a key range, for sampling
+ *
+ * ANALYZE reads short runs of rows from positions spread across the table
+ * instead of scanning all of it. Positions are located by bisecting on
+ * GetApproximateSizes so they follow the on-disk data distribution; if the
+ * range has no SSTable data yet (memtable only) they fall back to linear
+ * interpolation between the first and last keys.
+ */
+class KeyspaceSampler {
+public:
+    /**
+     * @param connection LevelDB connection
+     * @param first First key of the range (inclusive)
+     * @param last Last key of the range (inclusive)
+     */
+    KeyspaceSampler(std::shared_ptr<LevelDBConnection> connection,
+                    std::string first, std::string last);
+
+    /**
+     * Create a sampler over the keys starting with prefix
+     *
+     * @return nullopt if no key starts with prefix
+     */
+    static std::optional<KeyspaceSampler> for_prefix(
+        std::shared_ptr<LevelDBConnection> connection, const std::string& prefix);
+
+    /**
+     * Key at roughly the given fraction (0..1) of the range's data
+     */
+    std::string key_at(double fraction) const;
+
+    /**
+     * Interpolate between two keys in byte order
+     *
+     * Uses the 8 bytes following their common prefix as a big-endian
+     * integer; monotonic in fraction.
+     */
+    static std::string interpolate(const std::string& lo, const std::string& hi,
+                                   double fraction);
+
+    const std::string& first() const { return first_; }
+    const std::string& last() const { return last_; }
+    uint64_t total_bytes() const { return total_bytes_; }
+
+private:
+    std::shared_ptr<LevelDBConnection> connection_;
+    std::string first_;
+    std::string last_;
+    uint64_t total_bytes_;
+};
+
+/**
+ * Split a pivot scan range into shards for parallel scanning
+ *
+ * Split points are spread by data volume (KeyspaceSampler) and then moved
+ * back to the start of the identity they land in, so every identity's keys
+ * fall inside a single shard. Each returned boundary is the start of one
+ * shard and the exclusive end of the previous one; the first shard starts
+ * at the range start and the last runs to the range end.
+ *
+ * @param connection LevelDB connection
+ * @param parser Key parser for the table's pattern
+ * @param prefix_values Leading identity values pushed down (may be empty)
+ * @param shard_count Desired number of shards
+ * @return Strictly increasing boundaries; fewer than shard_count - 1 if
+ *         the range has too few identities
+ */
+std::vector<std::string> compute_shard_boundaries(
+    std::shared_ptr<LevelDBConnection> connection,
+    const KeyParser& parser,
+    const std::vector<std::string>& prefix_values,
+    size_t shard_count);
+
+/**
+ * Backend-local cache of size estimates
+ *
+ * Planning the same query shape repeatedly should not re-sample LevelDB
+ * every time, so estimates are cached per relation and scan prefix for a
+ * short time. Writes through the FDW invalidate the relation's entries.
+ */
+class SizeEstimateCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SizeEstimateCache(std::chrono::seconds ttl = std::chrono::seconds(60));
+
+    static SizeEstimateCache& instance();
+
+    /**
+     * Look up a cached estimate; returns nullopt if missing or expired
+     */
+    std::optional<SizeEstimate> lookup(unsigned int relid, const std::string& range_key,
+                                       Clock::time_point now = Clock::now());
+
+    void store(unsigned int relid, const std::string& range_key,
+               const SizeEstimate& estimate, Clock::time_point now = Clock::now());
+
+    /**
+     * Drop all estimates for a relation (called after modifications)
+     */
+    void invalidate(unsigned int relid);
+
+    void clear();
+
+private:
+    struct Entry {
+        SizeEstimate estimate;
+        Clock::time_point stored_at;
+    };
+
+    std::chrono::seconds ttl_;
+    std::mutex mutex_;
+    std::unordered_map<unsigned int, std::unordered_map<std::string, Entry>> entries_;
+};
+
+} // namespace level_pivot
@@ -2,6 +2,8 @@
 
 #include "level_pivot/projection.hpp"
 #include <string>
+#include <string_view>
+#include <vector>
 
 // Forward declarations for PostgreSQL types
 extern "C" {
@@ -31,10 +33,27 @@ private:
  * Converts between LevelDB string values and PostgreSQL Datum types
  *
  * Uses PostgreSQL's built-in type input/output functions for consistent
- * behavior with the database's native parsing and formatting.
+ * behavior with the database's native parsing and formatting. Reads of
+ * the common types parse in place and only defer to the input function
+ * for forms they don't handle themselves.
  */
 class TypeConverter {
 public:
+    /**
+     * Get the converter for values of a type
+     *
+     * Values are never NULL (an absent key is), so converters always
+     * return a Datum; they throw TypeConversionError or ereport on bad
+     * input.
+     */
+    static DatumConverter converter_for(PgType type);
+
+    /**
+     * Get the converter for each of a projection's columns, in columns()
+     * order, for Projection::set_converters()
+     */
+    static std::vector<DatumConverter> converters_for(const Projection& projection);
+
     /**
      * Convert a string value to a PostgreSQL Datum
      *
@@ -44,7 +63,7 @@ public:
      * @return The converted Datum (undefined if is_null is true)
      * @throws TypeConversionError if conversion fails
      */
-    static Datum string_to_datum(const std::string& value, PgType type, bool& is_null);
+    static Datum string_to_datum(std::string_view value, PgType type, bool& is_null);
 
     /**
      * Convert a PostgreSQL Datum to a string for storage in LevelDB
@@ -60,7 +79,7 @@ public:
      * Check if a string represents a null value
      * Empty strings are not considered NULL by default
      */
-    static bool is_null_string(const std::string& value);
+    static bool is_null_string(std::string_view value);
 };
 
 } // namespace level_pivot
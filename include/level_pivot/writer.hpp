@@ -1,8 +1,12 @@
 #pragma once
 
 #include "level_pivot/projection.hpp"
+#include "level_pivot/change_set.hpp"
 #include "level_pivot/connection_manager.hpp"
+#include "level_pivot/identity_ranges.hpp"
+#include "level_pivot/secondary_index.hpp"
 #include "level_pivot/type_converter.hpp"
+#include <optional>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -20,6 +24,16 @@ namespace level_pivot {
 struct WriteResult {
     size_t keys_written = 0;
     size_t keys_deleted = 0;
+    size_t rows = 0;  // Rows matched (range operations only)
+};
+
+/**
+ * One SET clause of a range update: the attr's new stored value, or
+ * std::nullopt to set it NULL (delete its key)
+ */
+struct AttrAssignment {
+    std::string attr_name;
+    std::optional<std::string> value;
 };
 
 /**
@@ -29,6 +43,9 @@ struct WriteResult {
  *   - INSERT: Creates Put for each non-null attr column
  *   - UPDATE: Updates changed attr keys, deletes keys set to NULL
  *   - DELETE: Removes all attr keys matching the identity
+ *
+ * With a SecondaryIndex set, each of these also puts or deletes the index
+ * entries of the indexed attrs it changes, through the same batch.
  */
 class Writer {
 public:
@@ -63,6 +80,20 @@ public:
      */
     WriteResult insert(Datum* values, bool* nulls);
 
+    /**
+     * Insert several rows at once
+     *
+     * All keys for the rows go into one WriteBatch: the writer's own batch
+     * when batched, otherwise a temporary one committed before returning.
+     * Identity and key buffers are reused across rows.
+     *
+     * @param values Per-row Datum arrays (each indexed by column attnum - 1)
+     * @param nulls Per-row null flag arrays
+     * @param count Number of rows
+     * @return Write result summed over all rows
+     */
+    WriteResult insert_batch(Datum* const* values, bool* const* nulls, size_t count);
+
     /**
      * Update an existing row
      *
@@ -96,6 +127,52 @@ public:
      */
     WriteResult remove_by_identity(const std::vector<std::string>& identity_values);
 
+    /**
+     * Delete every row with keys in the given ranges
+     *
+     * One iterator pass over the ranges: each key that parses under the
+     * pattern is deleted, without materializing rows. The caller must
+     * make sure the ranges hold only rows it means to delete (see
+     * build_identity_ranges); keys of other patterns are left alone.
+     * Every capture must precede {attr}, so that a row's keys are
+     * adjacent; other patterns throw LevelPivotError.
+     *
+     * @param ranges Sorted, non-overlapping key ranges
+     * @param scan How the pass reads blocks
+     * @return Write result; rows counts distinct identities
+     */
+    WriteResult remove_ranges(const std::vector<KeyRange>& ranges,
+                              const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Apply the same assignments to every row with keys in the given ranges
+     *
+     * One iterator pass over the ranges finds the row identities; each
+     * row then gets a put (or a delete, for NULL) per assignment.
+     * Identity columns can't be assigned, since their keys would move.
+     * As with remove_ranges, every capture must precede {attr}.
+     *
+     * @param ranges Sorted, non-overlapping key ranges
+     * @param assignments Attr values to write to each row
+     * @param scan How the pass reads blocks
+     * @return Write result; rows counts distinct identities
+     */
+    WriteResult update_ranges(const std::vector<KeyRange>& ranges,
+                              const std::vector<AttrAssignment>& assignments,
+                              const ScanOptions& scan = ScanOptions());
+
+    /**
+     * Record the identity of every row written from now on in changes
+     * (null stops recording)
+     */
+    void track_changes(ChangeSet* changes) { changes_ = changes; }
+
+    /**
+     * Maintain index's entries from now on (null stops); index must
+     * outlive the writer's use of it
+     */
+    void set_index(const SecondaryIndex* index) { index_ = index; }
+
     /**
      * Check if this writer is using batched mode
      */
@@ -120,6 +197,8 @@ private:
     const Projection& projection_;
     std::shared_ptr<LevelDBConnection> connection_;
     std::unique_ptr<LevelDBWriteBatch> batch_;  // Optional batch for atomic writes
+    ChangeSet* changes_ = nullptr;  // Rows written, for NOTIFY payloads
+    const SecondaryIndex* index_ = nullptr;  // Entries kept in step, if set
 
     // Helper methods for routing writes to batch or connection
     void do_put(const std::string& key, const std::string& value);
@@ -134,12 +213,39 @@ private:
     // Extract identity column values from Datum array
     std::vector<std::string> extract_identity(Datum* values, bool* nulls) const;
 
+    // Same as extract_identity, but fills an existing vector in place
+    void extract_identity_into(Datum* values, bool* nulls,
+                               std::vector<std::string>& identity) const;
+
     // Extract all attr info in a single pass (replaces extract_attrs + get_null_attrs)
     ExtractedAttrs extract_all_attrs(Datum* values, bool* nulls) const;
 
-    // Find all existing keys for an identity
+    // Shared pass of remove_ranges (assignments null) and update_ranges
+    WriteResult modify_ranges(const std::vector<KeyRange>& ranges,
+                              const std::vector<AttrAssignment>* assignments,
+                              const ScanOptions& scan);
+
+    // Put or delete the index entry for one attr value (no-op if the attr
+    // isn't indexed), into batch or else through do_put/do_del; counts go
+    // to result
+    void put_index_entry(std::string_view attr, std::string_view value,
+                         const std::vector<std::string>& identity,
+                         LevelDBWriteBatch* batch, WriteResult& result);
+    void del_index_entry(std::string_view attr, std::string_view value,
+                         const std::vector<std::string>& identity,
+                         LevelDBWriteBatch* batch, WriteResult& result);
+
+    // An indexed attr's stored value, as found while scanning a row's keys
+    struct IndexedValue {
+        std::string attr;
+        std::string value;
+    };
+
+    // Find all existing keys for an identity, and the values of its
+    // indexed attrs if indexed is given
     std::vector<std::string> find_keys_for_identity(
-        const std::vector<std::string>& identity_values) const;
+        const std::vector<std::string>& identity_values,
+        std::vector<IndexedValue>* indexed = nullptr) const;
 };
 
 } // namespace level_pivot
@@ -16,6 +16,75 @@ RETURNS void
 AS 'MODULE_PATHNAME'
 LANGUAGE C STRICT;
 
+-- Cumulative per-table activity, summed over all backends
+CREATE FUNCTION level_pivot_stats(
+    OUT relid oid,
+    OUT scans bigint,
+    OUT keys_scanned bigint,
+    OUT keys_skipped bigint,
+    OUT seeks bigint,
+    OUT gets bigint,
+    OUT rows_returned bigint,
+    OUT bytes_read bigint,
+    OUT rows_inserted bigint,
+    OUT rows_updated bigint,
+    OUT rows_deleted bigint,
+    OUT keys_written bigint,
+    OUT keys_deleted bigint,
+    OUT write_batches bigint,
+    OUT batch_keys bigint)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+CREATE FUNCTION level_pivot_stats_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+REVOKE EXECUTE ON FUNCTION level_pivot_stats_reset() FROM PUBLIC;
+
+-- LevelDB's own properties for a server's database
+CREATE FUNCTION level_pivot_db_properties(
+    server name,
+    OUT property text,
+    OUT value text)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+-- Recreate a pivot table's secondary index entries (index_attrs)
+CREATE FUNCTION level_pivot_rebuild_index(regclass)
+RETURNS bigint
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+-- level_pivot_stats() with table names and derived ratios
+CREATE VIEW level_pivot_table_stats AS
+SELECT s.relid,
+       n.nspname AS schemaname,
+       c.relname,
+       s.scans,
+       s.keys_scanned,
+       s.keys_skipped,
+       s.seeks,
+       s.gets,
+       s.rows_returned,
+       s.bytes_read,
+       round(s.keys_scanned::numeric / nullif(s.rows_returned, 0), 2) AS keys_per_row,
+       s.rows_inserted,
+       s.rows_updated,
+       s.rows_deleted,
+       s.keys_written,
+       s.keys_deleted,
+       s.write_batches,
+       round(s.batch_keys::numeric / nullif(s.write_batches, 0), 1) AS avg_batch_keys
+FROM level_pivot_stats() s
+JOIN pg_class c ON c.oid = s.relid
+JOIN pg_namespace n ON n.oid = c.relnamespace;
+
+GRANT SELECT ON level_pivot_table_stats TO PUBLIC;
+
 -- Create the Foreign Data Wrapper
 CREATE FOREIGN DATA WRAPPER level_pivot
     HANDLER level_pivot_fdw_handler
@@ -41,6 +110,8 @@ FOREIGN TABLE OPTIONS:
   key_pattern      - Key pattern with {name} placeholders (required)
                      Example: ''users##{group}##{id}##{attr}''
   prefix_filter    - Optional prefix to filter keys
+  index_attrs      - Attr columns with writer-maintained secondary
+                     indexes; see level_pivot_rebuild_index()
 
 EXAMPLE:
   CREATE SERVER my_leveldb
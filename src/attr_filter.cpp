@@ -0,0 +1,164 @@
+/**
+ * attr_filter.cpp - Checks pushed-down attr predicates on raw values
+ *
+ * A query like WHERE status = 'active' used to build a full tuple for
+ * every identity, only for the executor to throw most of them away. The
+ * scanner now runs these predicates against the row's string values as
+ * soon as the row is assembled, so rejected rows never reach
+ * DatumBuilder.
+ *
+ * PostgreSQL still rechecks every qual, so a check here only has to be
+ * conservative: it may keep a row PostgreSQL would drop, never the
+ * reverse. Integer comparisons that can't parse the stored value keep
+ * the row for the same reason.
+ */
+
+#include "level_pivot/attr_filter.hpp"
+#include "level_pivot/pivot_scanner.hpp"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+namespace level_pivot {
+
+const char* attr_filter_op_name(AttrFilterOp op) {
+    switch (op) {
+        case AttrFilterOp::EQ: return "=";
+        case AttrFilterOp::LT: return "<";
+        case AttrFilterOp::LE: return "<=";
+        case AttrFilterOp::GT: return ">";
+        case AttrFilterOp::GE: return ">=";
+        case AttrFilterOp::IN: return "IN";
+        case AttrFilterOp::IS_NULL: return "IS NULL";
+        case AttrFilterOp::IS_NOT_NULL: return "IS NOT NULL";
+        case AttrFilterOp::PREFIX: return "^@";
+    }
+    return "?";
+}
+
+bool parse_filter_integer(std::string_view value, PgType type, int64_t& out) {
+    const char* first = value.data();
+    const char* last = value.data() + value.size();
+    auto [ptr, ec] = std::from_chars(first, last, out);
+    if (ec != std::errc() || ptr != last) {
+        return false;
+    }
+    if (type == PgType::INTEGER) {
+        return out >= std::numeric_limits<int32_t>::min() &&
+               out <= std::numeric_limits<int32_t>::max();
+    }
+    return true;
+}
+
+bool AttrFilter::add(size_t slot, PgType type, AttrFilterOp op,
+                     const std::vector<std::string>& values) {
+    bool null_test = op == AttrFilterOp::IS_NULL || op == AttrFilterOp::IS_NOT_NULL;
+    if (!null_test &&
+        type != PgType::TEXT && type != PgType::INTEGER && type != PgType::BIGINT) {
+        return false;
+    }
+    if (op == AttrFilterOp::PREFIX && type != PgType::TEXT) {
+        return false;
+    }
+
+    switch (op) {
+        case AttrFilterOp::IS_NULL:
+        case AttrFilterOp::IS_NOT_NULL:
+            if (!values.empty()) {
+                return false;
+            }
+            break;
+        case AttrFilterOp::IN:
+            // An empty IN list can't come from SQL; don't guess at it
+            if (values.empty()) {
+                return false;
+            }
+            break;
+        default:
+            if (values.size() != 1) {
+                return false;
+            }
+            break;
+    }
+
+    Predicate pred{slot, op, type, {}, {}};
+    if (null_test) {
+        // Only presence is checked
+    } else if (type == PgType::TEXT) {
+        pred.text = values;
+        std::sort(pred.text.begin(), pred.text.end());
+    } else {
+        // Operands may be wider than the column (int4col = 5000000000), so
+        // they're always parsed as BIGINT
+        pred.ints.reserve(values.size());
+        for (const auto& value : values) {
+            int64_t parsed;
+            if (!parse_filter_integer(value, PgType::BIGINT, parsed)) {
+                return false;
+            }
+            pred.ints.push_back(parsed);
+        }
+        std::sort(pred.ints.begin(), pred.ints.end());
+    }
+
+    predicates_.push_back(std::move(pred));
+    return true;
+}
+
+bool AttrFilter::matches(const PivotRow& row) const {
+    for (const auto& pred : predicates_) {
+        bool present = row.has_attr(pred.slot);
+        if (pred.op == AttrFilterOp::IS_NULL) {
+            if (present) {
+                return false;
+            }
+        } else if (pred.op == AttrFilterOp::IS_NOT_NULL) {
+            if (!present) {
+                return false;
+            }
+        } else if (!present || !matches_value(pred, row.attr_value(pred.slot))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compares with three-way results so every operator shares one switch
+ */
+bool AttrFilter::matches_value(const Predicate& pred, std::string_view value) {
+    int cmp;
+    if (pred.type == PgType::TEXT) {
+        if (pred.op == AttrFilterOp::IN) {
+            return std::binary_search(pred.text.begin(), pred.text.end(), value,
+                                      [](std::string_view a, std::string_view b) {
+                                          return a < b;
+                                      });
+        }
+        if (pred.op == AttrFilterOp::PREFIX) {
+            return value.compare(0, pred.text[0].size(), pred.text[0]) == 0;
+        }
+        cmp = value.compare(pred.text[0]);
+    } else {
+        int64_t parsed;
+        if (!parse_filter_integer(value, pred.type, parsed)) {
+            return true;  // Let PostgreSQL's input function decide
+        }
+        if (pred.op == AttrFilterOp::IN) {
+            return std::binary_search(pred.ints.begin(), pred.ints.end(), parsed);
+        }
+        int64_t operand = pred.ints[0];
+        cmp = parsed < operand ? -1 : (parsed > operand ? 1 : 0);
+    }
+
+    switch (pred.op) {
+        case AttrFilterOp::EQ: return cmp == 0;
+        case AttrFilterOp::LT: return cmp < 0;
+        case AttrFilterOp::LE: return cmp <= 0;
+        case AttrFilterOp::GT: return cmp > 0;
+        case AttrFilterOp::GE: return cmp >= 0;
+        default: return true;
+    }
+}
+
+} // namespace level_pivot
@@ -0,0 +1,133 @@
+/**
+ * attr_lookup.cpp - Builds the attr name -> slot lookup used while scanning
+ *
+ * The perfect hash follows the hash-and-displace scheme: hash every name,
+ * group names into buckets of about four by the hash's high bits, then
+ * place buckets largest first. For each bucket we try displacements
+ * 0, 1, 2, ... until all of its names land in free cells; an odd step
+ * means every displacement below the table size gives a distinct layout. The table has
+ * at least 1.25 cells per name, so late buckets still find room quickly.
+ * If a seed produces two names that can never be separated, the build
+ * retries with another seed. Building happens once per query, so the
+ * search cost doesn't matter.
+ */
+
+#include "level_pivot/attr_lookup.hpp"
+#include <algorithm>
+
+namespace level_pivot {
+
+namespace {
+
+constexpr int MAX_SEEDS = 32;
+constexpr size_t NAMES_PER_BUCKET = 4;
+
+size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+unsigned log2_of(size_t power_of_two) {
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < power_of_two) {
+        ++bits;
+    }
+    return bits;
+}
+
+} // anonymous namespace
+
+AttrLookup::AttrLookup(const std::vector<std::string>& names) : names_(names) {
+    size_t max_len = 0;
+    for (const auto& name : names_) {
+        max_len = std::max(max_len, name.size());
+    }
+
+    // Length buckets double as a cheap reject for over-long names
+    by_length_.resize(names_.empty() ? 0 : max_len + 1);
+    for (size_t slot = 0; slot < names_.size(); ++slot) {
+        by_length_[names_[slot].size()].push_back(static_cast<int>(slot));
+    }
+
+    if (names_.size() <= LINEAR_MAX) {
+        return;
+    }
+
+    // Fall back to length buckets if no seed works (not expected in
+    // practice for distinct names)
+    for (int i = 0; i < MAX_SEEDS; ++i) {
+        uint64_t seed = 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(i + 1);
+        if (try_build_table(seed)) {
+            return;
+        }
+    }
+    table_.clear();
+    displacements_.clear();
+}
+
+bool AttrLookup::try_build_table(uint64_t seed) {
+    size_t n = names_.size();
+    size_t table_size = next_power_of_two(n + n / 4 + 1);
+    size_t bucket_count = next_power_of_two((n + NAMES_PER_BUCKET - 1) / NAMES_PER_BUCKET);
+
+    table_.assign(table_size, -1);
+    table_mask_ = table_size - 1;
+    bucket_shift_ = 64 - log2_of(bucket_count);
+    seed_ = seed;
+    displacements_.assign(bucket_count, 0);
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::vector<size_t>> buckets(bucket_count);
+    for (size_t slot = 0; slot < n; ++slot) {
+        hashes[slot] = hash(names_[slot], seed);
+        buckets[bucket(hashes[slot])].push_back(slot);
+    }
+
+    std::vector<size_t> order(bucket_count);
+    for (size_t b = 0; b < bucket_count; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<size_t> cells;
+    for (size_t b : order) {
+        const auto& members = buckets[b];
+        if (members.empty()) {
+            break;
+        }
+
+        // The step is odd and the table a power of two, so displacements
+        // past table_size only repeat earlier cells
+        bool placed = false;
+        for (uint32_t d = 0; d < table_size && !placed; ++d) {
+            cells.clear();
+            placed = true;
+            for (size_t slot : members) {
+                size_t c = cell(hashes[slot], d);
+                if (table_[c] >= 0 ||
+                    std::find(cells.begin(), cells.end(), c) != cells.end()) {
+                    placed = false;
+                    break;
+                }
+                cells.push_back(c);
+            }
+            if (placed) {
+                displacements_[b] = d;
+                for (size_t i = 0; i < members.size(); ++i) {
+                    table_[cells[i]] = static_cast<int>(members[i]);
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace level_pivot
@@ -0,0 +1,625 @@
+/**
+ * broker.cpp - LevelDB access through a broker process
+ *
+ * LevelDB locks its directory, so only one process can have a database
+ * open. With the broker enabled, a background worker owns every database
+ * and backends send it requests instead:
+ *
+ *   backend                                 broker
+ *   LevelDBConnection -> BrokerClient  ==>  BrokerService -> LevelDBConnection
+ *   LevelDBIterator  -> BrokerIterator ==>  Session cursor -> LevelDBIterator
+ *
+ * Every request is [release count][(kind, id) to release...][op][arguments];
+ * every reply is [status][payload], where an error payload is the message.
+ * Scans stream back in chunks, so a backend holds at most one chunk per
+ * cursor. Cursors live on the broker, which keeps each scan on a single
+ * LevelDB iterator and therefore a single snapshot; a backend can also pin
+ * a snapshot on the broker and read every get and cursor from it.
+ *
+ * The transport (shm_mq in the extension, a loopback in tests) lives
+ * outside this file, which keeps it free of PostgreSQL headers.
+ */
+
+#include "level_pivot/broker.hpp"
+#include <leveldb/iterator.h>
+#include <leveldb/write_batch.h>
+#include <algorithm>
+#include <cstring>
+
+namespace level_pivot {
+
+namespace {
+
+constexpr uint8_t REPLY_OK = 0;
+constexpr uint8_t REPLY_ERROR = 1;
+
+constexpr uint8_t BATCH_DELETE = 0;
+constexpr uint8_t BATCH_PUT = 1;
+
+// CURSOR_OPEN scan flags
+constexpr uint8_t SCAN_FILL_CACHE = 1;
+constexpr uint8_t SCAN_VERIFY_CHECKSUMS = 2;
+
+/**
+ * Serializes a WriteBatch's operations into a WRITE request
+ */
+class BatchEncoder : public leveldb::WriteBatch::Handler {
+public:
+    explicit BatchEncoder(BrokerMessageWriter& out)
+        : out_(out), count_offset_(out.reserve_u32()) {}
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value) override {
+        out_.put_u8(BATCH_PUT);
+        out_.put_string(std::string_view(key.data(), key.size()));
+        out_.put_string(std::string_view(value.data(), value.size()));
+        ++count_;
+    }
+
+    void Delete(const leveldb::Slice& key) override {
+        out_.put_u8(BATCH_DELETE);
+        out_.put_string(std::string_view(key.data(), key.size()));
+        ++count_;
+    }
+
+    void finish() { out_.patch_u32(count_offset_, count_); }
+
+private:
+    BrokerMessageWriter& out_;
+    size_t count_offset_;
+    uint32_t count_ = 0;
+};
+
+leveldb::Slice to_slice(std::string_view view) {
+    return leveldb::Slice(view.data(), view.size());
+}
+
+/**
+ * Iterator over a broker cursor
+ *
+ * Holds the current chunk and moves within it; stepping off either end
+ * fetches the next chunk. Entries are views into the reply buffer, so a
+ * chunk costs one allocation however many entries it has.
+ */
+class BrokerIterator : public leveldb::Iterator {
+public:
+    BrokerIterator(std::shared_ptr<BrokerClient> client, uint64_t session, uint32_t cursor)
+        : client_(std::move(client)), session_(session), cursor_(cursor) {}
+
+    ~BrokerIterator() override {
+        client_->release_cursor(session_, cursor_);
+    }
+
+    bool Valid() const override { return pos_ < entries_.size(); }
+
+    void SeekToFirst() override { fetch(CursorPosition::FIRST, {}); }
+    void SeekToLast() override { fetch(CursorPosition::LAST, {}); }
+    void Seek(const leveldb::Slice& target) override {
+        fetch(CursorPosition::SEEK, std::string_view(target.data(), target.size()));
+    }
+
+    void Next() override {
+        if (backward_) {
+            // Entries run in descending order; the next key is behind us
+            if (pos_ > 0) {
+                --pos_;
+            } else {
+                fetch(CursorPosition::AFTER, entries_[pos_].first);
+            }
+        } else if (++pos_ == entries_.size() && !exhausted_) {
+            fetch(CursorPosition::CONTINUE, {});
+        }
+    }
+
+    void Prev() override {
+        if (!backward_) {
+            if (pos_ > 0) {
+                --pos_;
+            } else {
+                fetch(CursorPosition::BEFORE, entries_[pos_].first);
+            }
+        } else if (++pos_ == entries_.size() && !exhausted_) {
+            fetch(CursorPosition::CONTINUE, {});
+        }
+    }
+
+    leveldb::Slice key() const override { return to_slice(entries_[pos_].first); }
+    leveldb::Slice value() const override { return to_slice(entries_[pos_].second); }
+
+    // Failures are thrown as LevelDBError when they happen
+    leveldb::Status status() const override { return leveldb::Status::OK(); }
+
+private:
+    std::shared_ptr<BrokerClient> client_;
+    uint64_t session_;
+    uint32_t cursor_;
+
+    std::string chunk_;
+    std::vector<std::pair<std::string_view, std::string_view>> entries_;
+    size_t pos_ = 0;
+    bool backward_ = false;
+    bool exhausted_ = true;
+    uint32_t chunk_entries_ = BROKER_FIRST_CHUNK_ENTRIES;
+
+    void fetch(CursorPosition position, std::string_view key) {
+        switch (position) {
+            case CursorPosition::CONTINUE:
+                chunk_entries_ = std::min(chunk_entries_ * 2, BROKER_MAX_CHUNK_ENTRIES);
+                break;
+            case CursorPosition::LAST:
+            case CursorPosition::BEFORE:
+                backward_ = true;
+                chunk_entries_ = BROKER_FIRST_CHUNK_ENTRIES;
+                break;
+            default:
+                backward_ = false;
+                chunk_entries_ = BROKER_FIRST_CHUNK_ENTRIES;
+                break;
+        }
+
+        BrokerMessageWriter request = client_->start_request(BrokerOp::CURSOR_READ);
+        request.put_u32(cursor_);
+        request.put_u8(static_cast<uint8_t>(position));
+        request.put_string(key);
+        request.put_u32(chunk_entries_);
+
+        // key may point into chunk_, so it's only replaced after the call
+        std::string reply = client_->cursor_call(session_, request);
+        chunk_ = std::move(reply);
+        entries_.clear();
+        pos_ = 0;
+
+        BrokerMessageReader in(std::string_view(chunk_).substr(1));
+        uint32_t count = in.get_u32();
+        entries_.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string_view entry_key = in.get_string();
+            std::string_view entry_value = in.get_string();
+            entries_.emplace_back(entry_key, entry_value);
+        }
+        exhausted_ = in.get_u8() != 0;
+    }
+};
+
+} // anonymous namespace
+
+// BrokerMessageWriter / BrokerMessageReader
+
+void BrokerMessageWriter::put_string(std::string_view value) {
+    put_u32(static_cast<uint32_t>(value.size()));
+    data_.append(value.data(), value.size());
+}
+
+size_t BrokerMessageWriter::reserve_u32() {
+    size_t offset = data_.size();
+    put_u32(0);
+    return offset;
+}
+
+void BrokerMessageWriter::patch_u32(size_t offset, uint32_t value) {
+    std::memcpy(&data_[offset], &value, sizeof(value));
+}
+
+const char* BrokerMessageReader::take(size_t size) {
+    if (data_.size() - pos_ < size) {
+        throw LevelDBError("truncated broker message");
+    }
+    const char* p = data_.data() + pos_;
+    pos_ += size;
+    return p;
+}
+
+uint8_t BrokerMessageReader::get_u8() {
+    return static_cast<uint8_t>(*take(1));
+}
+
+uint32_t BrokerMessageReader::get_u32() {
+    uint32_t value;
+    std::memcpy(&value, take(sizeof(value)), sizeof(value));
+    return value;
+}
+
+uint64_t BrokerMessageReader::get_u64() {
+    uint64_t value;
+    std::memcpy(&value, take(sizeof(value)), sizeof(value));
+    return value;
+}
+
+std::string_view BrokerMessageReader::get_string() {
+    uint32_t size = get_u32();
+    return std::string_view(take(size), size);
+}
+
+// BrokerClient
+
+BrokerClient::BrokerClient(std::shared_ptr<BrokerTransport> transport,
+                           const ConnectionOptions& options)
+    : transport_(std::move(transport)), options_(options) {}
+
+BrokerMessageWriter BrokerClient::start_request(BrokerOp op) {
+    BrokerMessageWriter request;
+    request.put_u32(static_cast<uint32_t>(pending_releases_.size()));
+    for (const auto& [kind, id] : pending_releases_) {
+        request.put_u8(static_cast<uint8_t>(kind));
+        request.put_u32(id);
+    }
+    request.put_u8(static_cast<uint8_t>(op));
+    return request;
+}
+
+std::string BrokerClient::call(const BrokerMessageWriter& request) {
+    std::string reply = transport_->call(request.data());
+    // The releases went out with the request
+    pending_releases_.clear();
+
+    BrokerMessageReader in(reply);
+    if (in.get_u8() != REPLY_OK) {
+        throw LevelDBError(std::string(in.get_string()));
+    }
+    return reply;
+}
+
+void BrokerClient::ensure_open() {
+    uint64_t session = transport_->connect();
+    if (open_ && session == session_) {
+        return;
+    }
+
+    // A new session has none of our cursors or snapshots left to release
+    open_ = false;
+    session_ = session;
+    pending_releases_.clear();
+
+    BrokerMessageWriter request = start_request(BrokerOp::OPEN);
+    request.put_string(options_.db_path);
+    request.put_u8(options_.create_if_missing ? 1 : 0);
+    request.put_u64(options_.block_cache_size);
+    request.put_u64(options_.write_buffer_size);
+    request.put_u32(static_cast<uint32_t>(options_.bloom_bits_per_key));
+    request.put_u64(options_.block_size);
+    request.put_u32(static_cast<uint32_t>(options_.max_open_files));
+    request.put_u8(static_cast<uint8_t>(options_.compression));
+    request.put_u64(options_.max_file_size);
+
+    std::string reply = call(request);
+    db_ = BrokerMessageReader(std::string_view(reply).substr(1)).get_u32();
+    open_ = true;
+}
+
+std::optional<std::string> BrokerClient::get(const std::string& key) {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::GET);
+    request.put_u32(db_);
+    request.put_u32(read_snapshot());
+    request.put_string(key);
+
+    std::string reply = call(request);
+    BrokerMessageReader in(std::string_view(reply).substr(1));
+    if (in.get_u8() == 0) {
+        return std::nullopt;
+    }
+    return std::string(in.get_string());
+}
+
+void BrokerClient::write(leveldb::WriteBatch* batch) {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::WRITE);
+    request.put_u32(db_);
+
+    BatchEncoder encoder(request);
+    leveldb::Status status = batch->Iterate(&encoder);
+    if (!status.ok()) {
+        throw LevelDBError("WriteBatch encode failed: " + status.ToString());
+    }
+    encoder.finish();
+
+    call(request);
+}
+
+uint64_t BrokerClient::approximate_size(const std::string& start, const std::string& limit) {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::APPROXIMATE_SIZE);
+    request.put_u32(db_);
+    request.put_string(start);
+    request.put_string(limit);
+
+    std::string reply = call(request);
+    return BrokerMessageReader(std::string_view(reply).substr(1)).get_u64();
+}
+
+std::optional<std::string> BrokerClient::property(const std::string& name) {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::PROPERTY);
+    request.put_u32(db_);
+    request.put_string(name);
+
+    std::string reply = call(request);
+    BrokerMessageReader in(std::string_view(reply).substr(1));
+    if (in.get_u8() == 0) {
+        return std::nullopt;
+    }
+    return std::string(in.get_string());
+}
+
+std::unique_ptr<leveldb::Iterator> BrokerClient::new_iterator(const ScanOptions& scan) {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::CURSOR_OPEN);
+    request.put_u32(db_);
+    request.put_u32(read_snapshot());
+    request.put_u8((scan.fill_cache ? SCAN_FILL_CACHE : 0) |
+                   (scan.verify_checksums ? SCAN_VERIFY_CHECKSUMS : 0));
+
+    std::string reply = call(request);
+    uint32_t cursor = BrokerMessageReader(std::string_view(reply).substr(1)).get_u32();
+    return std::make_unique<BrokerIterator>(shared_from_this(), session_, cursor);
+}
+
+void BrokerClient::pin_snapshot() {
+    ensure_open();
+    BrokerMessageWriter request = start_request(BrokerOp::SNAPSHOT);
+    request.put_u32(db_);
+
+    std::string reply = call(request);
+    snapshot_ = BrokerMessageReader(std::string_view(reply).substr(1)).get_u32();
+    snapshot_session_ = session_;
+}
+
+void BrokerClient::unpin_snapshot() {
+    if (snapshot_ != 0 && open_ && snapshot_session_ == session_) {
+        pending_releases_.emplace_back(BrokerRelease::SNAPSHOT, snapshot_);
+    }
+    snapshot_ = 0;
+}
+
+uint32_t BrokerClient::read_snapshot() const {
+    if (snapshot_ != 0 && snapshot_session_ != session_) {
+        throw LevelDBError("connection to the broker was reset, losing the statement's snapshot");
+    }
+    return snapshot_;
+}
+
+std::string BrokerClient::cursor_call(uint64_t session, BrokerMessageWriter& request) {
+    if (transport_->connect() != session || session != session_) {
+        throw LevelDBError("connection to the broker was reset during the scan");
+    }
+    return call(request);
+}
+
+void BrokerClient::release_cursor(uint64_t session, uint32_t cursor) {
+    if (open_ && session == session_) {
+        pending_releases_.emplace_back(BrokerRelease::CURSOR, cursor);
+    }
+}
+
+// BrokerService
+
+std::string BrokerService::handle(Session& session, std::string_view request) {
+    BrokerMessageWriter out;
+    out.put_u8(REPLY_OK);
+
+    try {
+        BrokerMessageReader in(request);
+        uint32_t releases = in.get_u32();
+        for (uint32_t i = 0; i < releases; ++i) {
+            auto kind = static_cast<BrokerRelease>(in.get_u8());
+            uint32_t id = in.get_u32();
+            if (kind == BrokerRelease::SNAPSHOT) {
+                session.snapshots_.erase(id);
+            } else {
+                session.cursors_.erase(id);
+            }
+        }
+        dispatch(session, static_cast<BrokerOp>(in.get_u8()), in, out);
+    } catch (const std::exception& e) {
+        BrokerMessageWriter error;
+        error.put_u8(REPLY_ERROR);
+        error.put_string(e.what());
+        return error.data();
+    }
+
+    return out.data();
+}
+
+void BrokerService::dispatch(Session& session, BrokerOp op, BrokerMessageReader& in,
+                             BrokerMessageWriter& out) {
+    switch (op) {
+        case BrokerOp::OPEN:
+            open(session, in, out);
+            break;
+
+        case BrokerOp::GET: {
+            LevelDBConnection& db = database(session, in.get_u32());
+            const LevelDBSnapshot* snap = snapshot(session, in.get_u32());
+            auto value = db.get(std::string(in.get_string()), snap);
+            out.put_u8(value ? 1 : 0);
+            if (value) {
+                out.put_string(*value);
+            }
+            break;
+        }
+
+        case BrokerOp::WRITE: {
+            LevelDBConnection& db = database(session, in.get_u32());
+            leveldb::WriteBatch batch;
+            uint32_t count = in.get_u32();
+            for (uint32_t i = 0; i < count; ++i) {
+                uint8_t type = in.get_u8();
+                leveldb::Slice key = to_slice(in.get_string());
+                if (type == BATCH_PUT) {
+                    batch.Put(key, to_slice(in.get_string()));
+                } else {
+                    batch.Delete(key);
+                }
+            }
+            db.write(&batch);
+            break;
+        }
+
+        case BrokerOp::APPROXIMATE_SIZE: {
+            LevelDBConnection& db = database(session, in.get_u32());
+            std::string start(in.get_string());
+            std::string limit(in.get_string());
+            out.put_u64(db.approximate_size(start, limit));
+            break;
+        }
+
+        case BrokerOp::PROPERTY: {
+            LevelDBConnection& db = database(session, in.get_u32());
+            auto value = db.property(std::string(in.get_string()));
+            out.put_u8(value ? 1 : 0);
+            if (value) {
+                out.put_string(*value);
+            }
+            break;
+        }
+
+        case BrokerOp::CURSOR_OPEN: {
+            LevelDBConnection& db = database(session, in.get_u32());
+            const LevelDBSnapshot* snap = snapshot(session, in.get_u32());
+            uint8_t flags = in.get_u8();
+            ScanOptions scan;
+            scan.fill_cache = (flags & SCAN_FILL_CACHE) != 0;
+            scan.verify_checksums = (flags & SCAN_VERIFY_CHECKSUMS) != 0;
+            uint32_t id = session.next_cursor_++;
+            session.cursors_.emplace(id, Session::Cursor{db.iterator(snap, scan)});
+            out.put_u32(id);
+            break;
+        }
+
+        case BrokerOp::SNAPSHOT: {
+            uint32_t db_id = in.get_u32();
+            LevelDBConnection& db = database(session, db_id);
+            uint32_t id = session.next_snapshot_++;
+            session.snapshots_.emplace(
+                id, Session::Snapshot{session.databases_[db_id], db.snapshot()});
+            out.put_u32(id);
+            break;
+        }
+
+        case BrokerOp::CURSOR_READ:
+            read_cursor(session, in, out);
+            break;
+
+        default:
+            throw LevelDBError("unknown broker request " +
+                               std::to_string(static_cast<int>(op)));
+    }
+}
+
+void BrokerService::open(Session& session, BrokerMessageReader& in, BrokerMessageWriter& out) {
+    ConnectionOptions options;
+    options.db_path = std::string(in.get_string());
+    options.create_if_missing = in.get_u8() != 0;
+    options.block_cache_size = in.get_u64();
+    options.write_buffer_size = in.get_u64();
+    options.bloom_bits_per_key = static_cast<int>(in.get_u32());
+    options.block_size = in.get_u64();
+    options.max_open_files = static_cast<int>(in.get_u32());
+    options.compression = static_cast<Compression>(in.get_u8());
+    options.max_file_size = in.get_u64();
+    // Read-only servers are enforced by the backend's LevelDBConnection
+    options.read_only = false;
+
+    auto it = databases_.find(options.db_path);
+    if (it == databases_.end()) {
+        it = databases_.emplace(options.db_path,
+                                std::make_shared<LevelDBConnection>(options)).first;
+    }
+
+    session.databases_.push_back(it->second);
+    out.put_u32(static_cast<uint32_t>(session.databases_.size() - 1));
+}
+
+/**
+ * Position the cursor, then read up to the requested number of entries in
+ * its direction. The iterator is left on the first entry not sent, which
+ * is where CONTINUE picks up.
+ */
+void BrokerService::read_cursor(Session& session, BrokerMessageReader& in,
+                                BrokerMessageWriter& out) {
+    uint32_t id = in.get_u32();
+    auto position = static_cast<CursorPosition>(in.get_u8());
+    std::string key(in.get_string());
+    uint32_t max_entries = std::min(in.get_u32(), BROKER_MAX_CHUNK_ENTRIES);
+
+    auto it = session.cursors_.find(id);
+    if (it == session.cursors_.end()) {
+        throw LevelDBError("unknown broker cursor " + std::to_string(id));
+    }
+    auto& cursor = it->second;
+    LevelDBIterator& iter = cursor.iterator;
+
+    switch (position) {
+        case CursorPosition::SEEK:
+            iter.seek(key);
+            cursor.backward = false;
+            break;
+        case CursorPosition::FIRST:
+            iter.seek_to_first();
+            cursor.backward = false;
+            break;
+        case CursorPosition::LAST:
+            iter.seek_to_last();
+            cursor.backward = true;
+            break;
+        case CursorPosition::AFTER:
+            iter.seek(key);
+            if (iter.valid() && iter.key_view() == key) {
+                iter.next();
+            }
+            cursor.backward = false;
+            break;
+        case CursorPosition::BEFORE:
+            iter.seek(key);
+            if (iter.valid()) {
+                iter.prev();
+            } else {
+                iter.seek_to_last();
+            }
+            cursor.backward = true;
+            break;
+        case CursorPosition::CONTINUE:
+            break;
+        default:
+            throw LevelDBError("unknown cursor position");
+    }
+
+    size_t count_offset = out.reserve_u32();
+    uint32_t count = 0;
+    size_t bytes = 0;
+    while (iter.valid() && count < max_entries && bytes < BROKER_MAX_CHUNK_BYTES) {
+        std::string_view entry_key = iter.key_view();
+        std::string_view entry_value = iter.value_view();
+        out.put_string(entry_key);
+        out.put_string(entry_value);
+        bytes += entry_key.size() + entry_value.size();
+        ++count;
+
+        if (cursor.backward) {
+            iter.prev();
+        } else {
+            iter.next();
+        }
+    }
+    out.patch_u32(count_offset, count);
+    out.put_u8(iter.valid() ? 0 : 1);
+}
+
+LevelDBConnection& BrokerService::database(Session& session, uint32_t id) {
+    if (id >= session.databases_.size()) {
+        throw LevelDBError("unknown broker database " + std::to_string(id));
+    }
+    return *session.databases_[id];
+}
+
+const LevelDBSnapshot* BrokerService::snapshot(Session& session, uint32_t id) {
+    if (id == 0) {
+        return nullptr;
+    }
+    auto it = session.snapshots_.find(id);
+    if (it == session.snapshots_.end()) {
+        throw LevelDBError("unknown broker snapshot " + std::to_string(id));
+    }
+    return it->second.snapshot.get();
+}
+
+} // namespace level_pivot
@@ -0,0 +1,504 @@
+/**
+ * broker_worker.cpp - Background worker that owns LevelDB for all backends
+ *
+ * LevelDB's LOCK file lets one process open a database, so without help
+ * only one backend at a time can use a level_pivot server. With
+ *
+ *   shared_preload_libraries = 'level_pivot'
+ *   level_pivot.broker = on
+ *
+ * the postmaster starts a "level_pivot broker" worker that opens the
+ * databases, and every backend reaches them through it (see broker.cpp
+ * for the protocol).
+ *
+ * Each backend creates a DSM segment holding two shm_mq rings, one for
+ * requests and one for replies, and posts its handle in a slot of a small
+ * shared array; setting the broker's latch makes it attach. The broker
+ * then polls every attached queue without blocking, answering one request
+ * per backend per pass, so a long scan can't starve other sessions: scans
+ * stream in bounded chunks. Replies that don't fit in the ring are sent in
+ * pieces as the backend drains it.
+ *
+ * A backend whose call fails mid-way (query cancel, broker exit) drops its
+ * segment at once, as the queues may hold half a message, and starts a
+ * new session on its next call. The broker notices the detach and frees
+ * the session's cursors.
+ */
+
+// PostgreSQL headers must come first for Windows compatibility
+extern "C" {
+#include "postgres.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/wait_event.h"
+}
+
+#include "level_pivot/broker.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/* Size of each of a backend's two queues */
+#define BROKER_QUEUE_SIZE ((Size) 256 * 1024)
+
+typedef enum BrokerSlotState
+{
+    BROKER_SLOT_FREE,
+    BROKER_SLOT_PENDING,   /* Posted by a backend, not yet attached */
+    BROKER_SLOT_ACTIVE     /* Attached by the broker */
+} BrokerSlotState;
+
+typedef struct BrokerSlot
+{
+    BrokerSlotState state;
+    dsm_handle  handle;
+} BrokerSlot;
+
+typedef struct BrokerShared
+{
+    slock_t     mutex;          /* Protects everything below */
+    PGPROC     *broker;         /* NULL while the broker isn't running */
+    int         nslots;
+    BrokerSlot  slots[FLEXIBLE_ARRAY_MEMBER];
+} BrokerShared;
+
+static bool broker_enabled = false;
+static BrokerShared *broker_shared = NULL;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+extern "C" {
+PGDLLEXPORT void level_pivot_broker_main(Datum main_arg);
+void levelPivotBrokerInit(void);
+}
+
+static Size
+broker_shmem_size(void)
+{
+    return add_size(offsetof(BrokerShared, slots),
+                    mul_size(MaxBackends, sizeof(BrokerSlot)));
+}
+
+static void
+broker_shmem_request(void)
+{
+    if (prev_shmem_request_hook)
+        prev_shmem_request_hook();
+
+    RequestAddinShmemSpace(broker_shmem_size());
+}
+
+static void
+broker_shmem_startup(void)
+{
+    bool found;
+
+    if (prev_shmem_startup_hook)
+        prev_shmem_startup_hook();
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    broker_shared = (BrokerShared *) ShmemInitStruct("level_pivot broker",
+                                                     broker_shmem_size(),
+                                                     &found);
+    if (!found)
+    {
+        SpinLockInit(&broker_shared->mutex);
+        broker_shared->broker = NULL;
+        broker_shared->nslots = MaxBackends;
+        for (int i = 0; i < broker_shared->nslots; i++)
+        {
+            broker_shared->slots[i].state = BROKER_SLOT_FREE;
+            broker_shared->slots[i].handle = DSM_HANDLE_INVALID;
+        }
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+static void
+release_slot(int slot)
+{
+    SpinLockAcquire(&broker_shared->mutex);
+    broker_shared->slots[slot].state = BROKER_SLOT_FREE;
+    broker_shared->slots[slot].handle = DSM_HANDLE_INVALID;
+    SpinLockRelease(&broker_shared->mutex);
+}
+
+namespace {
+
+/**
+ * Backend side: one session with the broker over a pair of shm_mq queues
+ */
+class ShmBrokerTransport : public level_pivot::BrokerTransport {
+public:
+    uint64_t connect() override;
+    std::string call(const std::string& request) override;
+
+private:
+    dsm_segment *segment_ = nullptr;
+    shm_mq_handle *requests_ = nullptr;
+    shm_mq_handle *replies_ = nullptr;
+    uint64_t session_ = 0;
+
+    void disconnect();
+};
+
+uint64_t
+ShmBrokerTransport::connect()
+{
+    if (segment_)
+        return session_;
+
+    SpinLockAcquire(&broker_shared->mutex);
+    PGPROC *broker = broker_shared->broker;
+    SpinLockRelease(&broker_shared->mutex);
+
+    if (broker == NULL)
+        throw level_pivot::LevelDBError("the level_pivot broker is not running");
+
+    /* Queues and handles live as long as the session, not the query */
+    MemoryContext old_context = MemoryContextSwitchTo(TopMemoryContext);
+
+    dsm_segment *segment = dsm_create(2 * BROKER_QUEUE_SIZE, 0);
+    dsm_pin_mapping(segment);
+
+    char *base = (char *) dsm_segment_address(segment);
+    shm_mq *requests = shm_mq_create(base, BROKER_QUEUE_SIZE);
+    shm_mq *replies = shm_mq_create(base + BROKER_QUEUE_SIZE, BROKER_QUEUE_SIZE);
+    shm_mq_set_sender(requests, MyProc);
+    shm_mq_set_receiver(replies, MyProc);
+    requests_ = shm_mq_attach(requests, segment, NULL);
+    replies_ = shm_mq_attach(replies, segment, NULL);
+    segment_ = segment;
+
+    MemoryContextSwitchTo(old_context);
+
+    int slot = -1;
+    SpinLockAcquire(&broker_shared->mutex);
+    for (int i = 0; i < broker_shared->nslots; i++)
+    {
+        if (broker_shared->slots[i].state == BROKER_SLOT_FREE)
+        {
+            broker_shared->slots[i].state = BROKER_SLOT_PENDING;
+            broker_shared->slots[i].handle = dsm_segment_handle(segment);
+            slot = i;
+            break;
+        }
+    }
+    broker = broker_shared->broker;
+    SpinLockRelease(&broker_shared->mutex);
+
+    if (slot < 0)
+    {
+        disconnect();
+        throw level_pivot::LevelDBError("no free level_pivot broker slots");
+    }
+    if (broker != NULL)
+        SetLatch(&broker->procLatch);
+
+    return ++session_;
+}
+
+std::string
+ShmBrokerTransport::call(const std::string& request)
+{
+    shm_mq_result result;
+    Size size = 0;
+    void *data = NULL;
+
+    PG_TRY();
+    {
+        result = shm_mq_send(requests_, request.size(), request.data(), false, true);
+        if (result == SHM_MQ_SUCCESS)
+            result = shm_mq_receive(replies_, &size, &data, false);
+    }
+    PG_CATCH();
+    {
+        /* The queues may hold half a message; never reuse them */
+        disconnect();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    if (result != SHM_MQ_SUCCESS)
+    {
+        disconnect();
+        throw level_pivot::LevelDBError("lost connection to the level_pivot broker");
+    }
+
+    return std::string(static_cast<const char *>(data), size);
+}
+
+void
+ShmBrokerTransport::disconnect()
+{
+    if (requests_)
+        shm_mq_detach(requests_);
+    if (replies_)
+        shm_mq_detach(replies_);
+    if (segment_)
+        dsm_detach(segment_);
+
+    requests_ = nullptr;
+    replies_ = nullptr;
+    segment_ = nullptr;
+}
+
+/**
+ * Broker side: one attached backend
+ */
+struct BrokerPeer {
+    int slot;
+    dsm_segment *segment;
+    shm_mq_handle *requests;
+    shm_mq_handle *replies;
+    level_pivot::BrokerService::Session session;
+    std::string reply;          /* Reply still being sent */
+    bool sending = false;
+};
+
+/**
+ * Attach to every segment backends have posted since the last pass
+ */
+void
+attach_pending_peers(std::vector<std::unique_ptr<BrokerPeer>>& peers)
+{
+    for (int i = 0; i < broker_shared->nslots; i++)
+    {
+        dsm_handle handle = DSM_HANDLE_INVALID;
+
+        SpinLockAcquire(&broker_shared->mutex);
+        if (broker_shared->slots[i].state == BROKER_SLOT_PENDING)
+        {
+            broker_shared->slots[i].state = BROKER_SLOT_ACTIVE;
+            handle = broker_shared->slots[i].handle;
+        }
+        SpinLockRelease(&broker_shared->mutex);
+
+        if (handle == DSM_HANDLE_INVALID)
+            continue;
+
+        /* NULL if the backend already gave up and detached */
+        dsm_segment *segment = dsm_attach(handle);
+        if (segment == NULL)
+        {
+            release_slot(i);
+            continue;
+        }
+
+        char *base = (char *) dsm_segment_address(segment);
+        shm_mq *requests = (shm_mq *) base;
+        shm_mq *replies = (shm_mq *) (base + BROKER_QUEUE_SIZE);
+        shm_mq_set_receiver(requests, MyProc);
+        shm_mq_set_sender(replies, MyProc);
+
+        auto peer = std::make_unique<BrokerPeer>();
+        peer->slot = i;
+        peer->segment = segment;
+        peer->requests = shm_mq_attach(requests, segment, NULL);
+        peer->replies = shm_mq_attach(replies, segment, NULL);
+        peers.push_back(std::move(peer));
+    }
+}
+
+void
+detach_peer(BrokerPeer& peer)
+{
+    shm_mq_detach(peer.requests);
+    shm_mq_detach(peer.replies);
+    dsm_detach(peer.segment);
+    release_slot(peer.slot);
+}
+
+/**
+ * Move one peer along without blocking: take a request if none is being
+ * answered, then push out as much of the reply as fits.
+ *
+ * @return false once the backend has gone away
+ */
+bool
+serve_peer(BrokerPeer& peer, level_pivot::BrokerService& service, bool *progressed)
+{
+    shm_mq_result result;
+
+    if (!peer.sending)
+    {
+        Size size;
+        void *data;
+
+        result = shm_mq_receive(peer.requests, &size, &data, true);
+        if (result == SHM_MQ_WOULD_BLOCK)
+            return true;
+        if (result == SHM_MQ_DETACHED)
+            return false;
+
+        peer.reply = service.handle(peer.session,
+                                    std::string_view(static_cast<const char *>(data), size));
+        peer.sending = true;
+        *progressed = true;
+    }
+
+    /* A partly sent reply must be resent with the same arguments */
+    result = shm_mq_send(peer.replies, peer.reply.size(), peer.reply.data(), true, true);
+    if (result == SHM_MQ_DETACHED)
+        return false;
+    if (result == SHM_MQ_SUCCESS)
+    {
+        peer.sending = false;
+        peer.reply.clear();
+        *progressed = true;
+    }
+    return true;
+}
+
+void
+run_broker()
+{
+    level_pivot::BrokerService service;
+    std::vector<std::unique_ptr<BrokerPeer>> peers;
+
+    while (!ShutdownRequestPending)
+    {
+        bool progressed = false;
+
+        if (ConfigReloadPending)
+        {
+            ConfigReloadPending = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        attach_pending_peers(peers);
+
+        for (auto it = peers.begin(); it != peers.end();)
+        {
+            if (serve_peer(**it, service, &progressed))
+            {
+                ++it;
+            }
+            else
+            {
+                detach_peer(**it);
+                it = peers.erase(it);
+            }
+        }
+
+        if (!progressed)
+        {
+            (void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+                             -1L, PG_WAIT_EXTENSION);
+            ResetLatch(MyLatch);
+        }
+
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    for (auto& peer : peers)
+        detach_peer(*peer);
+}
+
+void
+broker_shutdown(int code, Datum arg)
+{
+    SpinLockAcquire(&broker_shared->mutex);
+    broker_shared->broker = NULL;
+    SpinLockRelease(&broker_shared->mutex);
+}
+
+} // anonymous namespace
+
+/**
+ * Entry point of the broker worker.
+ *
+ * Slots still marked active belong to a broker that exited; their
+ * backends saw the detach and will post new segments.
+ */
+void
+level_pivot_broker_main(Datum main_arg)
+{
+    pqsignal(SIGHUP, SignalHandlerForConfigReload);
+    pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+    BackgroundWorkerUnblockSignals();
+
+    before_shmem_exit(broker_shutdown, (Datum) 0);
+
+    SpinLockAcquire(&broker_shared->mutex);
+    for (int i = 0; i < broker_shared->nslots; i++)
+    {
+        if (broker_shared->slots[i].state == BROKER_SLOT_ACTIVE)
+        {
+            broker_shared->slots[i].state = BROKER_SLOT_FREE;
+            broker_shared->slots[i].handle = DSM_HANDLE_INVALID;
+        }
+    }
+    broker_shared->broker = MyProc;
+    SpinLockRelease(&broker_shared->mutex);
+
+    elog(LOG, "level_pivot broker started");
+
+    try {
+        run_broker();
+    } catch (const std::exception& e) {
+        /* Exits; the postmaster starts a new broker */
+        ereport(ERROR,
+            (errcode(ERRCODE_INTERNAL_ERROR),
+             errmsg("level_pivot broker: %s", e.what())));
+    }
+
+    proc_exit(0);
+}
+
+/**
+ * Called from _PG_init: define the GUC and, when preloaded with the broker
+ * enabled, reserve shared memory, register the worker and route this
+ * process's connections through it.
+ */
+void
+levelPivotBrokerInit(void)
+{
+    DefineCustomBoolVariable("level_pivot.broker",
+                             "Serve LevelDB to all backends from one background worker.",
+                             "Lets any number of sessions use the same LevelDB database. "
+                             "Requires level_pivot in shared_preload_libraries.",
+                             &broker_enabled,
+                             false,
+                             PGC_POSTMASTER,
+                             0,
+                             NULL, NULL, NULL);
+
+    if (!process_shared_preload_libraries_in_progress || !broker_enabled)
+        return;
+
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = broker_shmem_request;
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = broker_shmem_startup;
+
+    BackgroundWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+    worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+    worker.bgw_restart_time = 5;
+    snprintf(worker.bgw_name, BGW_MAXLEN, "level_pivot broker");
+    snprintf(worker.bgw_type, BGW_MAXLEN, "level_pivot broker");
+    snprintf(worker.bgw_library_name, MAXPGPATH, "level_pivot");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "level_pivot_broker_main");
+    worker.bgw_main_arg = (Datum) 0;
+    worker.bgw_notify_pid = 0;
+    RegisterBackgroundWorker(&worker);
+
+    level_pivot::ConnectionManager::instance().set_broker(
+        std::make_shared<ShmBrokerTransport>());
+}
@@ -0,0 +1,165 @@
+/**
+ * change_set.cpp - Summaries of changed rows for NOTIFY payloads
+ *
+ * A LISTEN client that only learns "users changed" has to re-read the
+ * whole table. The payload instead names the identities that changed, so
+ * a cache can drop just those entries. Large changes would not fit in a
+ * NOTIFY (PostgreSQL caps payloads just under 8kB) and would cost more to
+ * build than they save, so the set summarizes itself by identity prefix
+ * as it grows: first (group, id) pairs, then whole groups, then the table.
+ */
+
+#include "level_pivot/change_set.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace level_pivot {
+
+namespace {
+
+void append_json_string(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+std::string render(const std::set<std::vector<std::string>>& entries) {
+    std::string out = "{\"rows\":[";
+    bool first_entry = true;
+    for (const auto& entry : entries) {
+        if (!first_entry) {
+            out.push_back(',');
+        }
+        first_entry = false;
+        out.push_back('[');
+        for (size_t i = 0; i < entry.size(); ++i) {
+            if (i > 0) {
+                out.push_back(',');
+            }
+            append_json_string(out, entry[i]);
+        }
+        out.push_back(']');
+    }
+    out += "]}";
+    return out;
+}
+
+const char ALL_PAYLOAD[] = "{\"all\":true}";
+
+} // namespace
+
+ChangeSet::ChangeSet(size_t max_rows) : max_rows_(max_rows) {}
+
+void ChangeSet::add(const std::vector<std::string>& identity) {
+    if (all_) {
+        return;
+    }
+    if (identity.size() <= depth_) {
+        insert(identity);
+    } else {
+        insert(std::vector<std::string>(identity.begin(), identity.begin() + depth_));
+    }
+}
+
+void ChangeSet::add_key(std::string_view key) {
+    if (all_) {
+        return;
+    }
+    insert({std::string(key)});
+}
+
+void ChangeSet::add_all() {
+    all_ = true;
+    entries_.clear();
+}
+
+void ChangeSet::merge(const ChangeSet& other) {
+    if (other.all_) {
+        add_all();
+        return;
+    }
+    for (const auto& entry : other.entries_) {
+        add(entry);
+    }
+}
+
+void ChangeSet::insert(std::vector<std::string> entry) {
+    if (entry.empty()) {
+        add_all();
+        return;
+    }
+    entries_.insert(std::move(entry));
+    if (entries_.size() > max_rows_) {
+        shrink(max_rows_);
+    }
+}
+
+/**
+ * Cuts every entry one identity value shorter per round. The set is
+ * ordered, so entries sharing a prefix are adjacent and collapse into
+ * one as they are cut.
+ */
+void ChangeSet::shrink(size_t max_rows) {
+    while (!all_ && entries_.size() > max_rows) {
+        size_t longest = 0;
+        for (const auto& entry : entries_) {
+            longest = std::max(longest, entry.size());
+        }
+        if (longest <= 1) {
+            add_all();
+            return;
+        }
+        depth_ = longest - 1;
+        std::set<std::vector<std::string>> cut;
+        for (const auto& entry : entries_) {
+            if (entry.size() <= depth_) {
+                cut.insert(entry);
+            } else {
+                cut.emplace(entry.begin(), entry.begin() + depth_);
+            }
+        }
+        entries_ = std::move(cut);
+    }
+}
+
+std::string ChangeSet::payload(size_t max_bytes) const {
+    if (all_) {
+        return ALL_PAYLOAD;
+    }
+    std::string out = render(entries_);
+    if (out.size() < max_bytes) {
+        return out;
+    }
+
+    ChangeSet summary = *this;
+    while (!summary.all_) {
+        summary.shrink(summary.entries_.size() - 1);
+        if (summary.all_) {
+            break;
+        }
+        out = render(summary.entries_);
+        if (out.size() < max_bytes) {
+            return out;
+        }
+    }
+    return ALL_PAYLOAD;
+}
+
+} // namespace level_pivot
@@ -10,29 +10,121 @@
  * Connection pooling is important because LevelDB only allows one process
  * to open a database at a time. By caching connections per server OID,
  * multiple foreign tables pointing to the same LevelDB can share a connection.
+ * When the broker is enabled, connections forward to it instead (see
+ * broker.cpp), so any number of backends can use the same database.
  */
 
 #include "level_pivot/connection_manager.hpp"
+#include "level_pivot/broker.hpp"
+#include "level_pivot/prefetch_iterator.hpp"
 #include <leveldb/db.h>
 #include <leveldb/cache.h>
+#include <leveldb/filter_policy.h>
 #include <leveldb/options.h>
 #include <leveldb/iterator.h>
 #include <leveldb/write_batch.h>
+#include <chrono>
 #include <string_view>
 
 namespace level_pivot {
 
+namespace {
+
+/**
+ * Passes every call through to the wrapped iterator, adding the time its
+ * seeks and steps take to a counter
+ */
+class TimedIterator : public leveldb::Iterator {
+public:
+    TimedIterator(std::unique_ptr<leveldb::Iterator> base, uint64_t* ns)
+        : base_(std::move(base)), ns_(ns) {}
+
+    bool Valid() const override { return base_->Valid(); }
+    void SeekToFirst() override { timed([this] { base_->SeekToFirst(); }); }
+    void SeekToLast() override { timed([this] { base_->SeekToLast(); }); }
+    void Seek(const leveldb::Slice& target) override {
+        timed([this, &target] { base_->Seek(target); });
+    }
+    void Next() override { timed([this] { base_->Next(); }); }
+    void Prev() override { timed([this] { base_->Prev(); }); }
+    leveldb::Slice key() const override { return base_->key(); }
+    leveldb::Slice value() const override { return base_->value(); }
+    leveldb::Status status() const override { return base_->status(); }
+
+private:
+    std::unique_ptr<leveldb::Iterator> base_;
+    uint64_t* ns_;
+
+    template <typename Move>
+    void timed(Move move) {
+        auto start = std::chrono::steady_clock::now();
+        move();
+        *ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+} // anonymous namespace
+
+std::optional<Compression> parse_compression(std::string_view name) {
+    if (name == "none") {
+        return Compression::NONE;
+    }
+    if (name == "snappy") {
+        return Compression::SNAPPY;
+    }
+    if (name == "zstd") {
+        return Compression::ZSTD;
+    }
+    return std::nullopt;
+}
+
+bool compression_supported([[maybe_unused]] Compression compression) {
+#ifdef LEVEL_PIVOT_HAVE_ZSTD
+    return true;
+#else
+    return compression != Compression::ZSTD;
+#endif
+}
+
+// LevelDBSnapshot implementation
+
+LevelDBSnapshot::LevelDBSnapshot(leveldb::DB* db)
+    : db_(db), snapshot_(db->GetSnapshot()) {}
+
+LevelDBSnapshot::~LevelDBSnapshot() {
+    db_->ReleaseSnapshot(snapshot_);
+}
+
 // LevelDBIterator implementation
 
 /**
- * Creates an iterator with caching enabled.
+ * Creates an iterator, by default with caching enabled.
  * fill_cache=true populates the block cache as we scan, which helps
- * subsequent queries that access the same blocks.
+ * subsequent queries that access the same blocks; bulk scans turn it off
+ * so they don't evict the blocks point lookups depend on.
+ *
+ * LevelDB copies the snapshot's sequence number into the iterator, so the
+ * snapshot may be released while the iterator is still in use. With
+ * prefetch_batch set, the iterator is read ahead on a thread of its own.
  */
-LevelDBIterator::LevelDBIterator(leveldb::DB* db) {
+LevelDBIterator::LevelDBIterator(leveldb::DB* db, const leveldb::Snapshot* snapshot,
+                                 const ScanOptions& scan) {
     leveldb::ReadOptions options;
-    options.fill_cache = true;
+    options.fill_cache = scan.fill_cache;
+    options.verify_checksums = scan.verify_checksums;
+    options.snapshot = snapshot;
     iter_.reset(db->NewIterator(options));
+    if (scan.prefetch_batch > 0) {
+        iter_ = make_prefetch_iterator(std::move(iter_), scan.prefetch_batch);
+    }
+}
+
+LevelDBIterator::LevelDBIterator(std::unique_ptr<leveldb::Iterator> iter)
+    : iter_(std::move(iter)) {}
+
+void LevelDBIterator::time_moves(uint64_t* ns) {
+    iter_ = std::make_unique<TimedIterator>(std::move(iter_), ns);
 }
 
 LevelDBIterator::~LevelDBIterator() = default;
@@ -53,10 +145,18 @@ void LevelDBIterator::seek_to_first() {
     iter_->SeekToFirst();
 }
 
+void LevelDBIterator::seek_to_last() {
+    iter_->SeekToLast();
+}
+
 void LevelDBIterator::next() {
     iter_->Next();
 }
 
+void LevelDBIterator::prev() {
+    iter_->Prev();
+}
+
 bool LevelDBIterator::valid() const {
     return iter_->Valid();
 }
@@ -137,10 +237,8 @@ void LevelDBWriteBatch::del(const std::string& key) {
 }
 
 /**
- * Applies all accumulated operations atomically to LevelDB.
- * sync=false means we don't wait for fsync - the OS buffer cache
- * provides durability for most crash scenarios. For critical data,
- * consider enabling sync or using external durability guarantees.
+ * Applies all accumulated operations atomically to LevelDB, through the
+ * connection so brokered connections send the batch as one request.
  */
 void LevelDBWriteBatch::commit() {
     if (committed_) {
@@ -148,13 +246,7 @@ void LevelDBWriteBatch::commit() {
     }
 
     if (connection_ && batch_ && pending_count_ > 0) {
-        leveldb::WriteOptions options;
-        options.sync = false;
-
-        leveldb::Status status = connection_->raw()->Write(options, batch_.get());
-        if (!status.ok()) {
-            throw LevelDBError("WriteBatch commit failed: " + status.ToString());
-        }
+        connection_->write(batch_.get());
     }
 
     committed_ = true;
@@ -188,18 +280,54 @@ bool LevelDBWriteBatch::has_pending() const {
  * write_buffer_size: Memory used for buffering writes before flushing.
  *   Larger values improve write throughput but increase memory usage.
  *
+ * filter_policy: A bloom filter per table file lets get() of an absent key
+ *   skip reading the file's data blocks. LevelDB only consults filters on
+ *   get(); a filter on key prefixes would not speed up seeks, since
+ *   iterators never check filters, so the filter is on whole keys. Files
+ *   written without a filter are still read normally.
+ *
+ * block_size, max_open_files, compression, max_file_size: Passed through;
+ *   LevelDB clamps out-of-range values to its limits.
+ *
  * Note: LevelDB doesn't support true read-only mode, so we track it
  * ourselves and reject writes if read_only=true.
  */
 LevelDBConnection::LevelDBConnection(const ConnectionOptions& options)
     : path_(options.db_path), read_only_(options.read_only) {
 
+    if (!compression_supported(options.compression)) {
+        throw LevelDBError("LevelDB was built without zstd support");
+    }
+
     leveldb::Options db_options;
     db_options.create_if_missing = options.create_if_missing;
     db_options.write_buffer_size = options.write_buffer_size;
+    db_options.block_size = options.block_size;
+    db_options.max_open_files = options.max_open_files;
+    db_options.max_file_size = options.max_file_size;
+
+    switch (options.compression) {
+        case Compression::NONE:
+            db_options.compression = leveldb::kNoCompression;
+            break;
+        case Compression::SNAPPY:
+            db_options.compression = leveldb::kSnappyCompression;
+            break;
+        case Compression::ZSTD:
+#ifdef LEVEL_PIVOT_HAVE_ZSTD
+            db_options.compression = leveldb::kZstdCompression;
+#endif
+            break;
+    }
 
     if (options.block_cache_size > 0) {
-        db_options.block_cache = leveldb::NewLRUCache(options.block_cache_size);
+        block_cache_.reset(leveldb::NewLRUCache(options.block_cache_size));
+        db_options.block_cache = block_cache_.get();
+    }
+
+    if (options.bloom_bits_per_key > 0) {
+        filter_policy_.reset(leveldb::NewBloomFilterPolicy(options.bloom_bits_per_key));
+        db_options.filter_policy = filter_policy_.get();
     }
 
     leveldb::Status status = leveldb::DB::Open(db_options, path_, &db_);
@@ -210,13 +338,34 @@ LevelDBConnection::LevelDBConnection(const ConnectionOptions& options)
     }
 }
 
+LevelDBConnection::LevelDBConnection(const ConnectionOptions& options,
+                                     std::shared_ptr<BrokerTransport> broker)
+    : broker_(std::make_shared<BrokerClient>(std::move(broker), options)),
+      path_(options.db_path), read_only_(options.read_only) {}
+
 LevelDBConnection::~LevelDBConnection() {
+    // A snapshot must be released before its database closes
+    pinned_.reset();
     delete db_;
 }
 
 std::optional<std::string> LevelDBConnection::get(const std::string& key) {
+    if (pending_) {
+        if (const auto* pending = pending_->find(key)) {
+            return *pending;
+        }
+    }
+    if (broker_) {
+        return broker_->get(key);
+    }
+    return get(key, pinned_.get());
+}
+
+std::optional<std::string> LevelDBConnection::get(const std::string& key,
+                                                  const LevelDBSnapshot* snapshot) {
     std::string value;
     leveldb::ReadOptions options;
+    options.snapshot = snapshot ? snapshot->get() : nullptr;
 
     leveldb::Status status = db_->Get(options, key, &value);
 
@@ -234,6 +383,20 @@ std::optional<std::string> LevelDBConnection::get(const std::string& key) {
 void LevelDBConnection::put(const std::string& key, const std::string& value) {
     check_write_allowed();
 
+    if (pending_) {
+        leveldb::WriteBatch batch;
+        batch.Put(key, value);
+        buffer_batch(&batch);
+        return;
+    }
+
+    if (broker_) {
+        leveldb::WriteBatch batch;
+        batch.Put(key, value);
+        broker_->write(&batch);
+        return;
+    }
+
     leveldb::WriteOptions options;
     options.sync = false;  // Don't fsync each write for performance
 
@@ -247,6 +410,20 @@ void LevelDBConnection::put(const std::string& key, const std::string& value) {
 void LevelDBConnection::del(const std::string& key) {
     check_write_allowed();
 
+    if (pending_) {
+        leveldb::WriteBatch batch;
+        batch.Delete(key);
+        buffer_batch(&batch);
+        return;
+    }
+
+    if (broker_) {
+        leveldb::WriteBatch batch;
+        batch.Delete(key);
+        broker_->write(&batch);
+        return;
+    }
+
     leveldb::WriteOptions options;
     options.sync = false;
 
@@ -257,8 +434,93 @@ void LevelDBConnection::del(const std::string& key) {
     }
 }
 
-LevelDBIterator LevelDBConnection::iterator() {
-    return LevelDBIterator(db_);
+/**
+ * sync=false means we don't wait for fsync - the OS buffer cache
+ * provides durability for most crash scenarios. For critical data,
+ * consider enabling sync or using external durability guarantees.
+ */
+void LevelDBConnection::write(leveldb::WriteBatch* batch) {
+    if (pending_) {
+        buffer_batch(batch);
+        return;
+    }
+    write_through(batch);
+}
+
+void LevelDBConnection::write_through(leveldb::WriteBatch* batch) {
+    if (broker_) {
+        broker_->write(batch);
+        return;
+    }
+
+    leveldb::WriteOptions options;
+    options.sync = false;
+
+    leveldb::Status status = db_->Write(options, batch);
+    if (!status.ok()) {
+        throw LevelDBError("WriteBatch commit failed: " + status.ToString());
+    }
+}
+
+LevelDBIterator LevelDBConnection::iterator(const ScanOptions& scan) {
+    if (pending_ && !pending_->empty()) {
+        std::unique_ptr<leveldb::Iterator> base;
+        if (broker_) {
+            base = broker_->new_iterator(scan);
+        } else {
+            leveldb::ReadOptions options;
+            options.fill_cache = scan.fill_cache;
+            options.verify_checksums = scan.verify_checksums;
+            options.snapshot = pinned_ ? pinned_->get() : nullptr;
+            base.reset(db_->NewIterator(options));
+            // Only the database side is read ahead; the overlay merges
+            // pending_ in on this thread
+            if (scan.prefetch_batch > 0) {
+                base = make_prefetch_iterator(std::move(base), scan.prefetch_batch);
+            }
+        }
+        return LevelDBIterator(pending_->overlay(std::move(base)));
+    }
+    if (broker_) {
+        return LevelDBIterator(broker_->new_iterator(scan));
+    }
+    return iterator(pinned_.get(), scan);
+}
+
+LevelDBIterator LevelDBConnection::iterator(const LevelDBSnapshot* snapshot,
+                                            const ScanOptions& scan) {
+    return LevelDBIterator(db_, snapshot ? snapshot->get() : nullptr, scan);
+}
+
+std::unique_ptr<LevelDBSnapshot> LevelDBConnection::snapshot() {
+    return std::make_unique<LevelDBSnapshot>(db_);
+}
+
+void LevelDBConnection::acquire_snapshot() {
+    if (snapshot_refs_ == 0) {
+        if (broker_) {
+            broker_->pin_snapshot();
+        } else {
+            pinned_ = snapshot();
+        }
+        snapshot_epoch_ = ++epochs_used_;
+    }
+    ++snapshot_refs_;
+}
+
+/**
+ * May run during error cleanup; neither path talks to the broker or
+ * throws.
+ */
+void LevelDBConnection::release_snapshot() {
+    if (snapshot_refs_ == 0 || --snapshot_refs_ > 0) {
+        return;
+    }
+    if (broker_) {
+        broker_->unpin_snapshot();
+    }
+    pinned_.reset();
+    snapshot_epoch_ = 0;
 }
 
 LevelDBWriteBatch LevelDBConnection::create_batch() {
@@ -266,6 +528,155 @@ LevelDBWriteBatch LevelDBConnection::create_batch() {
     return LevelDBWriteBatch(this);
 }
 
+void LevelDBConnection::buffer_writes(size_t limit, OverflowAction overflow) {
+    check_write_allowed();
+    if (pending_) {
+        return;
+    }
+    pending_ = std::make_unique<PendingWrites>();
+    pending_limit_ = limit;
+    overflow_ = overflow;
+    spills_ = 0;
+}
+
+/**
+ * The pending writes go out as one WriteBatch, so the transaction's
+ * writes to this database land atomically.
+ */
+size_t LevelDBConnection::commit_pending_writes() {
+    if (!pending_) {
+        return 0;
+    }
+    std::unique_ptr<PendingWrites> pending = std::move(pending_);
+    if (pending->empty()) {
+        return 0;
+    }
+    leveldb::WriteBatch batch;
+    pending->fill(&batch);
+    write_through(&batch);
+    return pending->size();
+}
+
+void LevelDBConnection::discard_pending_writes() {
+    pending_.reset();
+}
+
+void LevelDBConnection::savepoint(int level) {
+    if (pending_) {
+        pending_->savepoint(level);
+    }
+}
+
+void LevelDBConnection::release_savepoint(int level) {
+    if (pending_) {
+        pending_->release_savepoint(level);
+    }
+}
+
+/**
+ * Runs during subtransaction abort, so it never talks to the broker; the
+ * restored entries are only in memory.
+ */
+void LevelDBConnection::rollback_savepoint(int level) {
+    if (!pending_) {
+        return;
+    }
+    pending_->rollback_savepoint(level);
+
+    // Iterators made before the rollback still see the undone writes
+    if (snapshot_epoch_ != 0) {
+        snapshot_epoch_ = ++epochs_used_;
+    }
+}
+
+/**
+ * The size check comes first, so a FAIL leaves the pending writes
+ * exactly as they were before the rejected write. A spill gives up
+ * atomicity for what it writes, which is what SPILL was chosen for; a
+ * batch too big to buffer on its own is written straight through.
+ *
+ * Writes that reach LevelDB leave the overlay, so a pinned snapshot
+ * taken before them would hide them from the rest of the statement; the
+ * snapshot is taken again after them.
+ */
+void LevelDBConnection::buffer_batch(leveldb::WriteBatch* batch) {
+    size_t incoming = PendingWrites::batch_bytes(*batch);
+    bool buffer = true;
+    bool wrote_through = false;
+    if (pending_->bytes() + incoming > pending_limit_) {
+        if (overflow_ == OverflowAction::FAIL) {
+            throw LevelPivotError("pending writes would exceed the limit of " +
+                                  std::to_string(pending_limit_) + " bytes");
+        }
+        if (!pending_->empty()) {
+            leveldb::WriteBatch spill;
+            pending_->fill(&spill);
+            write_through(&spill);
+            pending_->clear();
+            wrote_through = true;
+        }
+        ++spills_;
+        buffer = incoming <= pending_limit_;
+    }
+    if (buffer) {
+        pending_->apply(*batch);
+    } else {
+        write_through(batch);
+        wrote_through = true;
+    }
+
+    if (wrote_through && snapshot_refs_ > 0) {
+        repin_snapshot();
+    }
+
+    // Iterators made before this write don't see it
+    if (snapshot_epoch_ != 0) {
+        snapshot_epoch_ = ++epochs_used_;
+    }
+}
+
+/**
+ * Replace the pinned snapshot with a new one, keeping its pins
+ */
+void LevelDBConnection::repin_snapshot() {
+    if (broker_) {
+        broker_->unpin_snapshot();
+        broker_->pin_snapshot();
+    } else {
+        pinned_ = snapshot();
+    }
+}
+
+/**
+ * GetApproximateSizes needs a concrete limit key. For an open-ended range
+ * we use a run of 0xFF bytes, which sorts after any realistic key.
+ */
+uint64_t LevelDBConnection::approximate_size(const std::string& start,
+                                             const std::string& limit) {
+    if (broker_) {
+        return broker_->approximate_size(start, limit);
+    }
+
+    static const std::string end_of_keyspace(16, '\xFF');
+
+    leveldb::Range range(start, limit.empty() ? end_of_keyspace : limit);
+    uint64_t size = 0;
+    db_->GetApproximateSizes(&range, 1, &size);
+    return size;
+}
+
+std::optional<std::string> LevelDBConnection::property(const std::string& name) {
+    if (broker_) {
+        return broker_->property(name);
+    }
+
+    std::string value;
+    if (!db_->GetProperty(name, &value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
 void LevelDBConnection::check_write_allowed() {
     if (read_only_) {
         throw LevelDBError("Cannot write to read-only connection");
@@ -307,7 +718,8 @@ std::shared_ptr<LevelDBConnection> ConnectionManager::get_connection(
         return it->second;
     }
 
-    auto conn = std::make_shared<LevelDBConnection>(options);
+    auto conn = broker_ ? std::make_shared<LevelDBConnection>(options, broker_)
+                        : std::make_shared<LevelDBConnection>(options);
     connections_[server_oid] = conn;
     return conn;
 }
@@ -327,4 +739,14 @@ size_t ConnectionManager::connection_count() const {
     return connections_.size();
 }
 
+void ConnectionManager::set_broker(std::shared_ptr<BrokerTransport> transport) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    broker_ = std::move(transport);
+}
+
+bool ConnectionManager::uses_broker() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return broker_ != nullptr;
+}
+
 } // namespace level_pivot
@@ -5,19 +5,31 @@
  * the full query lifecycle for both pivot and raw table modes:
  *
  * QUERY PLANNING (GetForeignRelSize, GetForeignPaths, GetForeignPlan):
- *   - Estimates row counts for cost-based optimization
+ *   - Estimates row counts and widths by sampling LevelDB (cached briefly)
  *   - Creates access paths (currently just sequential scan)
  *   - Extracts pushable WHERE clauses (identity column equalities)
  *
  * SCAN EXECUTION (BeginForeignScan, IterateForeignScan, EndForeignScan):
- *   - BeginForeignScan: Opens LevelDB connection, creates scanner
+ *   - BeginForeignScan: Opens LevelDB connection, pins the statement's
+ *     snapshot on it, creates scanner
  *   - IterateForeignScan: Returns rows one at a time
  *   - EndForeignScan: Closes scanner, releases resources
+ *   - *DSMForeignScan: Shares identity-aligned shards for parallel scans
  *
  * DML EXECUTION (BeginForeignModify, ExecForeignInsert/Update/Delete):
  *   - Translates SQL DML to LevelDB put/delete operations
+ *   - ExecForeignBatchInsert writes batch_size rows per LevelDB write
  *   - Uses WriteBatch for atomicity when configured
- *   - Sends NOTIFY on table modification
+ *   - At level_pivot.write_scope = transaction, holds the writes until
+ *     PRE_COMMIT (dropping them on abort), with reads merging them in
+ *   - Sends one NOTIFY per changed table at commit, optionally naming the
+ *     changed rows
+ *   - *DirectModify: UPDATE/DELETE whose quals the key ranges settle run
+ *     as one pass over the ranges, with no per-row callbacks
+ *
+ * STATISTICS (AnalyzeForeignTable, AcquireSampleRows):
+ *   - Samples rows for ANALYZE, seeking to random key-space positions on
+ *     large tables instead of reading everything
  *
  * SCHEMA IMPORT (ImportForeignSchema):
  *   - Analyzes existing LevelDB data to infer table structure
@@ -32,9 +44,12 @@ extern "C" {
 #include "postgres.h"
 #include "fmgr.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_foreign_server.h"
 #include "catalog/pg_foreign_table.h"
 #include "catalog/pg_operator.h"
@@ -43,38 +58,69 @@ extern "C" {
 #include "commands/defrem.h"
 #include "commands/explain.h"
 #include "commands/explain_format.h"
+#include "commands/vacuum.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/appendinfo.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
+#include "parser/parse_oper.h"
 #include "parser/parsetree.h"
+#include "port/atomics.h"
+#include "storage/dsm_registry.h"
+#include "storage/shm_toc.h"
+#include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/guc.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/pg_locale.h"
 #include "utils/rel.h"
+#include "utils/sampling.h"
+#include "utils/selfuncs.h"
 #include "utils/syscache.h"
 }
 
 #include "level_pivot/key_pattern.hpp"
 #include "level_pivot/key_parser.hpp"
 #include "level_pivot/projection.hpp"
+#include "level_pivot/projection_cache.hpp"
 #include "level_pivot/pivot_scanner.hpp"
+#include "level_pivot/group_counter.hpp"
 #include "level_pivot/raw_scanner.hpp"
 #include "level_pivot/raw_writer.hpp"
+#include "level_pivot/change_set.hpp"
 #include "level_pivot/connection_manager.hpp"
 #include "level_pivot/type_converter.hpp"
 #include "level_pivot/writer.hpp"
 #include "level_pivot/schema_discovery.hpp"
+#include "level_pivot/secondary_index.hpp"
+#include "level_pivot/table_metrics.hpp"
+#include "level_pivot/table_stats.hpp"
 #include "level_pivot/error.hpp"
 #include "level_pivot/pg_memory.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <cstring>
 
 namespace {
@@ -89,6 +135,92 @@ using BoolTempArray = level_pivot::TempArray<bool, 64>;
  * RAW: Direct key-value access, each key is one row */
 enum class TableMode { PIVOT, RAW };
 
+/*
+ * Indexes of the items in a ForeignScan's fdw_private list, which
+ * GetForeignPlan builds and the executor callbacks read with list_nth.
+ */
+enum FdwScanPrivateIndex
+{
+    /*
+     * Pushed-down predicates:
+     *   pivot mode: identity column predicates, each a list of
+     *     (attnum, AttrFilterOp, value...)
+     *   raw mode: flat (BTStrategy Integer, value String) pairs on the
+     *     key column
+     */
+    FdwScanPrivatePredicates,
+    /* Integer attnums of the columns the query reads (pivot mode) */
+    FdwScanPrivateNeededAttrs,
+    /*
+     * Attr column predicates the scanner checks on raw values (pivot
+     * mode), each a list of (attnum, AttrFilterOp, value...)
+     */
+    FdwScanPrivateAttrFilters,
+    /*
+     * Boolean: the planner expects the scan to read the whole table, and
+     * more than the block cache holds (fill_cache = auto turns caching off)
+     */
+    FdwScanPrivateBulkScan,
+    /*
+     * Integer attnums of identity columns bound by join parameters
+     * (pivot mode); fdw_exprs holds the matching value expressions
+     */
+    FdwScanPrivateParamAttnums,
+    /* Boolean: scan in descending key order (both modes) */
+    FdwScanPrivateReverse,
+    /*
+     * Boolean: the scan applies the query's LIMIT and OFFSET, the last
+     * two fdw_exprs (both modes; see add_limit_path)
+     */
+    FdwScanPrivateLimit,
+    /*
+     * Integer: attnum of the indexed column whose secondary index
+     * entries select the rows, or 0 to read the key ranges (pivot mode;
+     * see add_index_path)
+     */
+    FdwScanPrivateIndexAttnum
+};
+
+/*
+ * Indexes of the items in the fdw_private list of an aggregate scan, the
+ * scanrelid 0 ForeignScan built for a path from GetForeignUpperPaths.
+ * The path's fdw_private has the same layout.
+ */
+enum FdwAggPrivateIndex
+{
+    /*
+     * Identity predicates as in FdwScanPrivatePredicates (= and IN, and
+     * one exact PREFIX; see exact_identity_predicates)
+     */
+    FdwAggPrivatePredicates,
+    /* Integer: leading captures the rows are grouped by */
+    FdwAggPrivateGroupCaptures,
+    /*
+     * Per fdw_scan_tlist entry, Integer: the capture index of a grouping
+     * column, or -1 for a row count
+     */
+    FdwAggPrivateOutputs,
+    /* Boolean: as FdwScanPrivateBulkScan */
+    FdwAggPrivateBulkScan
+};
+
+/*
+ * Indexes of the items in the fdw_private list of a ForeignScan that
+ * PlanDirectModify turned into a set-based UPDATE or DELETE. fdw_exprs
+ * holds the UPDATE's new values, one per assignment.
+ */
+enum FdwDirectModifyPrivateIndex
+{
+    /* Pushed-down predicates as in FdwScanPrivatePredicates */
+    FdwDirectModifyPrivatePredicates,
+    /* UPDATE only: Integer attnum of each assigned column */
+    FdwDirectModifyPrivateTargetAttrs,
+    /* Boolean: count the rows in es_processed (the ModifyTable's canSetTag) */
+    FdwDirectModifyPrivateSetProcessed,
+    /* Boolean: as FdwScanPrivateBulkScan */
+    FdwDirectModifyPrivateBulkScan
+};
+
 TableMode get_table_mode(ForeignTable *table)
 {
     ListCell *cell;
@@ -105,6 +237,61 @@ TableMode get_table_mode(ForeignTable *table)
     return TableMode::PIVOT;  /* Default */
 }
 
+/*
+ * Projections built by earlier statements are reused until ALTER changes
+ * the table's columns (relcache invalidation) or its options
+ * (pg_foreign_table syscache invalidation)
+ */
+static void
+projection_cache_relcache_callback(Datum arg, Oid relid)
+{
+    if (OidIsValid(relid))
+        level_pivot::ProjectionCache::instance().invalidate(relid);
+    else
+        level_pivot::ProjectionCache::instance().clear();
+}
+
+/* The hash value doesn't name the table; option changes are rare */
+static void
+projection_cache_syscache_callback(Datum arg, int cacheid, uint32 hashvalue)
+{
+    level_pivot::ProjectionCache::instance().clear();
+}
+
+/*
+ * Owns a projection checked out of the ProjectionCache and hands it back on
+ * reset or destruction; otherwise it behaves like a unique_ptr.
+ */
+class ProjectionHandle {
+public:
+    ProjectionHandle() : relid_(InvalidOid) {}
+    ProjectionHandle(Oid relid, level_pivot::CachedProjection cached)
+        : relid_(relid), cached_(std::move(cached)) {}
+    ProjectionHandle(ProjectionHandle&& other) = default;
+    ~ProjectionHandle() { reset(); }
+
+    ProjectionHandle& operator=(ProjectionHandle&& other) {
+        reset();
+        relid_ = other.relid_;
+        cached_ = std::move(other.cached_);
+        return *this;
+    }
+
+    void reset() {
+        if (cached_.projection)
+            level_pivot::ProjectionCache::instance().release(relid_, std::move(cached_));
+        cached_.projection.reset();
+    }
+
+    level_pivot::Projection *operator->() const { return cached_.projection.get(); }
+    level_pivot::Projection& operator*() const { return *cached_.projection; }
+    explicit operator bool() const { return cached_.projection != nullptr; }
+
+private:
+    Oid relid_;
+    level_pivot::CachedProjection cached_;
+};
+
 /**
  * Base class for FDW state structures.
  *
@@ -116,9 +303,11 @@ TableMode get_table_mode(ForeignTable *table)
  */
 struct FdwStateBase {
     std::shared_ptr<level_pivot::LevelDBConnection> connection;
+    TableMode mode;  // Kept so per-row callbacks skip the catalog lookup
     bool cleaned_up;
+    level_pivot::TableCounters metrics;  // Recorded for level_pivot_stats() at the end
 
-    FdwStateBase() : cleaned_up(false) {}
+    FdwStateBase() : mode(TableMode::PIVOT), cleaned_up(false) {}
     virtual ~FdwStateBase() = default;
 
 protected:
@@ -135,11 +324,26 @@ protected:
     }
 };
 
-/* Base struct for scan state (adds temp_context) */
+/* Base struct for scan state (adds temp_context and a pushed-down LIMIT) */
 struct ScanStateBase : FdwStateBase {
     MemoryContext temp_context;
 
-    ScanStateBase() : temp_context(nullptr) {}
+    /* LIMIT and OFFSET (FdwScanPrivateLimit), evaluated at the first row */
+    ExprState *limit_count;
+    ExprState *limit_offset;
+    bool limit_pending;
+    int64 rows_left;    // Rows still to return; -1 = no limit
+    int64 offset_left;  // Rows still to skip
+
+    /* EXPLAIN ANALYZE with timing: the scanner times its phases too */
+    bool timing;
+    instr_time convert_time;  // Building Datums from rows
+
+    ScanStateBase()
+        : temp_context(nullptr), limit_count(nullptr), limit_offset(nullptr),
+          limit_pending(false), rows_left(-1), offset_left(0), timing(false) {
+        INSTR_TIME_SET_ZERO(convert_time);
+    }
 };
 
 /* Base struct for modify state (adds NOTIFY support) */
@@ -148,15 +352,71 @@ struct ModifyStateBase : FdwStateBase {
     std::string table_name;
     bool has_modifications;
     bool use_write_batch;
+    int batch_size;  // Rows per ExecForeignBatchInsert call
+    bool track_changes;  // Writer records changed rows in changes
+    level_pivot::ChangeSet changes;
+
+    ModifyStateBase()
+        : has_modifications(false), use_write_batch(true), batch_size(1),
+          track_changes(false) {}
+};
+
+/*
+ * Shared state for a parallel pivot scan, stored in the DSM segment.
+ *
+ * The leader splits the scan range into shards at identity boundaries;
+ * each participant claims the next shard by bumping next_shard. The
+ * nshards - 1 boundaries follow the header, each as a uint32 length
+ * followed by the key bytes.
+ */
+struct LevelPivotParallelState {
+    pg_atomic_uint32 next_shard;
+    uint32 nshards;
+    char bounds[FLEXIBLE_ARRAY_MEMBER];
+};
 
-    ModifyStateBase() : has_modifications(false), use_write_batch(true) {}
+/* An identity column bound per outer row by a join parameter */
+struct IdentityParam {
+    ExprState *expr;
+    Oid typoutput;   /* Output function turning the value into key text */
+    size_t capture;  /* Capture index in pattern order */
 };
 
 /* Scan state structure */
 struct LevelPivotScanState : ScanStateBase {
-    std::unique_ptr<level_pivot::Projection> projection;
+    ProjectionHandle projection;
     std::unique_ptr<level_pivot::PivotScanner> scanner;
     std::vector<std::string> prefix_values;  // Pushdown filter values
+    std::vector<level_pivot::KeyRange> ranges;  // Key ranges from identity predicates
+
+    /* Set when every capture is bound; the identities replace ranges */
+    std::optional<level_pivot::PivotScanner::PointLookup> point_lookup;
+    std::vector<std::vector<std::string>> point_identities;
+    bool fixed_attrs;
+
+    /* Set when the plan reads a secondary index; its matches are looked up */
+    std::unique_ptr<level_pivot::SecondaryIndex> index;
+    std::string index_attr;
+    level_pivot::IndexLookup index_lookup;
+    level_pivot::PivotScanner::PointLookup index_mode;
+    level_pivot::ScanOptions index_scan;
+    uint64_t index_matches;
+
+    /* Parameterized scans redo the ranges for each outer row */
+    std::vector<level_pivot::IdentityConstraint> constraints;  // From constants
+    std::vector<IdentityParam> params;
+    ExprContext *econtext;
+    bool params_pending;  // Bind params before the next row
+
+    /* Parallel scan: shards come from pstate instead of one full scan */
+    std::vector<std::string> shard_bounds;  // Computed by the leader
+    LevelPivotParallelState *pstate;
+    bool shard_active;
+
+    LevelPivotScanState()
+        : fixed_attrs(false), index_mode(level_pivot::PivotScanner::PointLookup::SEEK),
+          index_matches(0), econtext(nullptr), params_pending(false),
+          pstate(nullptr), shard_active(false) {}
 
     ~LevelPivotScanState() { cleanup(); }
 
@@ -167,6 +427,7 @@ struct LevelPivotScanState : ScanStateBase {
         if (scanner)
             scanner->end_scan();
         scanner.reset();
+        index.reset();
         projection.reset();
         cleanup_connection();
         // Note: temp_context is a child of scan_ctx, will be deleted with parent
@@ -177,6 +438,8 @@ struct LevelPivotScanState : ScanStateBase {
 struct RawScanState : ScanStateBase {
     std::unique_ptr<level_pivot::RawScanner> scanner;
     level_pivot::RawScanBounds bounds;
+    AttrNumber key_attnum = InvalidAttrNumber;    // 'key' column, if any
+    AttrNumber value_attnum = InvalidAttrNumber;  // 'value' column, if any
 
     ~RawScanState() { cleanup(); }
 
@@ -191,13 +454,40 @@ struct RawScanState : ScanStateBase {
     }
 };
 
+/* Aggregate scan state: counts rows per group instead of building them */
+struct AggregateScanState : ScanStateBase {
+    ProjectionHandle projection;
+    std::unique_ptr<level_pivot::GroupCounter> counter;
+    std::vector<level_pivot::KeyRange> ranges;  // Key ranges from identity predicates
+
+    /* Per output column: capture index, or -1 for the count */
+    std::vector<int> outputs;
+    std::vector<level_pivot::DatumConverter> output_converters;  // nullptr for the count
+
+    ~AggregateScanState() { cleanup(); }
+
+    void cleanup() {
+        if (!begin_cleanup())
+            return;
+
+        counter.reset();  // Refers to projection's parser
+        projection.reset();
+        cleanup_connection();
+    }
+};
+
 /* Modify state structure */
 struct LevelPivotModifyState : ModifyStateBase {
-    std::unique_ptr<level_pivot::Projection> projection;
+    ProjectionHandle projection;
+    std::unique_ptr<level_pivot::SecondaryIndex> index;  // Kept up by writer
     std::unique_ptr<level_pivot::Writer> writer;
     int num_cols;
     AttrNumber *attr_map;  // Maps foreign column attnums to local slot positions
 
+    /* Per-row slot arrays handed to Writer::insert_batch, reused across batches */
+    std::vector<Datum *> batch_values;
+    std::vector<bool *> batch_nulls;
+
     LevelPivotModifyState() : num_cols(0), attr_map(nullptr) {}
 
     ~LevelPivotModifyState() { cleanup(); }
@@ -211,6 +501,7 @@ struct LevelPivotModifyState : ModifyStateBase {
             writer->discard_batch();
         }
         writer.reset();
+        index.reset();
         projection.reset();
         cleanup_connection();
     }
@@ -222,6 +513,10 @@ struct RawModifyState : ModifyStateBase {
     AttrNumber key_attnum;    // Attribute number of the 'key' column
     AttrNumber value_attnum;  // Attribute number of the 'value' column
 
+    /* Key/value strings for batch inserts, reused so their buffers persist */
+    std::vector<std::string> batch_keys;
+    std::vector<std::string> batch_values;
+
     RawModifyState() : key_attnum(0), value_attnum(0) {}
 
     ~RawModifyState() { cleanup(); }
@@ -238,469 +533,3285 @@ struct RawModifyState : ModifyStateBase {
     }
 };
 
-/**
- * Builds NOTIFY channel name from schema and table.
- *
- * Format: {schema}_{table}_changed
- * This allows clients to LISTEN for changes to specific tables.
- * PostgreSQL limits channel names to 63 characters.
+/*
+ * Direct modify state: an UPDATE or DELETE run as one pass over the key
+ * ranges, instead of a scan feeding per-row ExecForeignUpdate/Delete
  */
-static std::string
-build_notify_channel(const std::string& schema_name, const std::string& table_name)
-{
-    std::string channel = schema_name + "_" + table_name + "_changed";
+struct DirectModifyState : ModifyStateBase {
+    CmdType operation;
+    bool set_processed;
+    bool done;
+
+    /* Pivot mode */
+    ProjectionHandle projection;
+    std::unique_ptr<level_pivot::SecondaryIndex> index;  // Kept up by writer
+    std::unique_ptr<level_pivot::Writer> writer;
+    std::vector<level_pivot::KeyRange> ranges;
 
-    if (channel.length() > 63)
-        channel = channel.substr(0, 63);
+    /* Raw mode */
+    std::unique_ptr<level_pivot::RawWriter> raw_writer;
+    level_pivot::RawScanBounds bounds;
+    AttrNumber value_attnum;
 
-    return channel;
-}
+    /* UPDATE: assigned columns and their value expressions (fdw_exprs) */
+    std::vector<AttrNumber> target_attrs;
+    std::vector<ExprState *> target_exprs;
+
+    level_pivot::ScanOptions scan_options;
+    size_t rows;
+    size_t keys_written;
+    size_t keys_deleted;
+
+    DirectModifyState()
+        : operation(CMD_UNKNOWN), set_processed(false), done(false), value_attnum(0),
+          rows(0), keys_written(0), keys_deleted(0) {}
+
+    ~DirectModifyState() { cleanup(); }
+
+    void cleanup() {
+        if (!begin_cleanup())
+            return;
+
+        if (writer && writer->is_batched())
+            writer->discard_batch();
+        if (raw_writer && raw_writer->is_batched())
+            raw_writer->discard_batch();
+        writer.reset();
+        raw_writer.reset();
+        index.reset();
+        projection.reset();
+        cleanup_connection();
+    }
+};
+
+/*
+ * Per-table counters behind level_pivot_stats(), shared by all backends in
+ * a named DSM segment made by the first backend to need it, so they work
+ * without shared_preload_libraries. Each table's slot is keyed by its
+ * database and relation OIDs.
+ */
+constexpr size_t TABLE_METRICS_SLOTS = 2048;
+
+static level_pivot::TableMetrics *table_metrics = nullptr;
 
-/* Helper function for NOTIFY support */
 static void
-send_table_changed_notify(const std::string& schema_name, const std::string& table_name)
+init_table_metrics(void *ptr)
 {
-    std::string channel = build_notify_channel(schema_name, table_name);
-    Async_Notify(channel.c_str(), NULL);
+    level_pivot::TableMetrics::create(ptr, TABLE_METRICS_SLOTS);
 }
 
-/* Helper functions */
-
-level_pivot::ConnectionOptions
-get_server_options(ForeignServer *server)
+static level_pivot::TableMetrics *
+get_table_metrics(void)
 {
-    level_pivot::ConnectionOptions options;
-    ListCell *cell;
-
-    foreach(cell, server->options)
-    {
-        DefElem *def = (DefElem *) lfirst(cell);
-
-        if (strcmp(def->defname, "db_path") == 0)
-            options.db_path = defGetString(def);
-        else if (strcmp(def->defname, "read_only") == 0)
-            options.read_only = defGetBoolean(def);
-        else if (strcmp(def->defname, "create_if_missing") == 0)
-            options.create_if_missing = defGetBoolean(def);
-        else if (strcmp(def->defname, "block_cache_size") == 0)
-            options.block_cache_size = strtoul(defGetString(def), NULL, 10);
-        else if (strcmp(def->defname, "write_buffer_size") == 0)
-            options.write_buffer_size = strtoul(defGetString(def), NULL, 10);
-        else if (strcmp(def->defname, "use_write_batch") == 0)
-            options.use_write_batch = defGetBoolean(def);
+    if (table_metrics == nullptr) {
+        bool found;
+        table_metrics = static_cast<level_pivot::TableMetrics *>(
+            GetNamedDSMSegment("level_pivot table metrics",
+                               level_pivot::TableMetrics::memory_size(TABLE_METRICS_SLOTS),
+                               init_table_metrics, &found));
     }
+    return table_metrics;
+}
 
-    return options;
+/* Add a finished scan's or modify's counts to its table's totals */
+static void
+record_table_metrics(Oid relid, level_pivot::TableCounters& metrics)
+{
+    if (metrics.empty())
+        return;
+    get_table_metrics()->add((static_cast<uint64_t>(MyDatabaseId) << 32) | relid, metrics);
+    metrics = level_pivot::TableCounters();
 }
 
-std::string
-get_table_option(ForeignTable *table, const char *name)
+/*
+ * Scanners restart their stats with every scan, so a scan state adds them
+ * to its metrics just before each restart and once more at the end
+ */
+static void
+add_scan_counts(level_pivot::TableCounters& metrics,
+                const level_pivot::PivotScanner::Stats& stats)
 {
-    ListCell *cell;
+    metrics.keys_scanned += stats.keys_scanned;
+    metrics.keys_skipped += stats.keys_skipped;
+    metrics.seeks += stats.seeks;
+    metrics.gets += stats.gets;
+    metrics.rows_returned += stats.rows_returned;
+    metrics.bytes_read += stats.bytes_read;
+}
 
-    foreach(cell, table->options)
-    {
-        DefElem *def = (DefElem *) lfirst(cell);
-        if (strcmp(def->defname, name) == 0)
-            return defGetString(def);
-    }
+static void
+add_scan_counts(level_pivot::TableCounters& metrics,
+                const level_pivot::RawScanner::Stats& stats)
+{
+    metrics.keys_scanned += stats.keys_scanned;
+    metrics.rows_returned += stats.rows_returned;
+    metrics.bytes_read += stats.bytes_read;
+}
 
-    return "";
+static void
+add_scan_counts(level_pivot::TableCounters& metrics,
+                const level_pivot::GroupCounter::Stats& stats)
+{
+    metrics.keys_scanned += stats.keys_scanned;
+    metrics.seeks += stats.seeks;
 }
 
-std::unique_ptr<level_pivot::Projection>
-build_projection_from_relation(Relation rel, const std::string& key_pattern)
+/* Works for WriteResult and RawWriteResult */
+template <typename Result>
+static void
+add_write_counts(level_pivot::TableCounters& metrics, const Result& result)
 {
-    level_pivot::KeyPattern pattern(key_pattern);
-    TupleDesc tupdesc = RelationGetDescr(rel);
+    metrics.keys_written += result.keys_written;
+    metrics.keys_deleted += result.keys_deleted;
+}
 
-    std::vector<level_pivot::ColumnDef> columns;
-    columns.reserve(tupdesc->natts);
+/* A WriteBatch of keys keys is about to be committed */
+static void
+add_batch_counts(level_pivot::TableCounters& metrics, size_t keys)
+{
+    if (keys == 0)
+        return;
+    metrics.write_batches++;
+    metrics.batch_keys += keys;
+}
 
-    const auto& capture_names = pattern.capture_names();
+/*
+ * level_pivot.snapshot: how long a connection's reads share one LevelDB
+ * snapshot. Reads within a statement always do; at transaction scope the
+ * snapshot is also kept for later statements, until the transaction ends
+ * or writes to that connection.
+ */
+enum class SnapshotScope { STATEMENT, TRANSACTION };
 
-    for (int i = 0; i < tupdesc->natts; i++)
-    {
-        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+int snapshot_scope = static_cast<int>(SnapshotScope::STATEMENT);
 
-        if (attr->attisdropped)
-            continue;
+const struct config_enum_entry snapshot_scope_options[] = {
+    {"statement", static_cast<int>(SnapshotScope::STATEMENT), false},
+    {"transaction", static_cast<int>(SnapshotScope::TRANSACTION), false},
+    {NULL, 0, false}
+};
 
-        level_pivot::ColumnDef col;
-        col.name = NameStr(attr->attname);
-        col.type = level_pivot::pg_type_from_oid(attr->atttypid);
-        col.attnum = attr->attnum;
+/*
+ * Connections a statement has pinned snapshots on.
+ *
+ * Allocated in the statement's es_query_cxt, so the pins are released
+ * when the executor state goes away, on success or error alike.
+ */
+struct StatementSnapshots;
 
-        // Check if this is an identity column
-        col.is_identity = false;
-        for (const auto& cap_name : capture_names)
-        {
-            if (col.name == cap_name)
-            {
-                col.is_identity = true;
-                break;
-            }
-        }
+std::unordered_map<EState *, StatementSnapshots *> statement_snapshots;
 
-        columns.push_back(col);
+struct StatementSnapshots {
+    EState *estate;
+    std::vector<std::shared_ptr<level_pivot::LevelDBConnection>> connections;
+
+    explicit StatementSnapshots(EState *estate) : estate(estate) {}
+
+    ~StatementSnapshots() {
+        for (auto& connection : connections)
+            connection->release_snapshot();
+        statement_snapshots.erase(estate);
     }
+};
 
-    return std::make_unique<level_pivot::Projection>(pattern, std::move(columns));
-}
+/* Connections holding a transaction-scope pin, released at transaction end */
+std::vector<std::shared_ptr<level_pivot::LevelDBConnection>> transaction_snapshots;
+
+/*
+ * level_pivot.write_scope: when a connection's writes reach LevelDB. At
+ * statement scope each statement's write batch is committed as it ends;
+ * at transaction scope the batches are held in memory, read back by the
+ * transaction's own scans, and written as one batch at commit.
+ * level_pivot.pending_write_limit (kB) caps what a connection holds, and
+ * level_pivot.pending_write_overflow says what passing it does.
+ */
+enum class WriteScope { STATEMENT, TRANSACTION };
+
+int write_scope = static_cast<int>(WriteScope::STATEMENT);
+int pending_write_limit = 64 * 1024;
+int pending_write_overflow = static_cast<int>(level_pivot::OverflowAction::FAIL);
+
+const struct config_enum_entry write_scope_options[] = {
+    {"statement", static_cast<int>(WriteScope::STATEMENT), false},
+    {"transaction", static_cast<int>(WriteScope::TRANSACTION), false},
+    {NULL, 0, false}
+};
+
+const struct config_enum_entry pending_write_overflow_options[] = {
+    {"error", static_cast<int>(level_pivot::OverflowAction::FAIL), false},
+    {"spill", static_cast<int>(level_pivot::OverflowAction::SPILL), false},
+    {NULL, 0, false}
+};
+
+/* Connections holding writes for the current transaction */
+std::vector<std::shared_ptr<level_pivot::LevelDBConnection>> transaction_writes;
+
+/*
+ * level_pivot.fill_cache and level_pivot.verify_checksums: how scans read
+ * blocks, unless the table's fill_cache / verify_checksums options say
+ * otherwise. auto fills the cache except on bulk scans, so a full export
+ * doesn't evict the blocks point lookups rely on.
+ */
+enum class FillCache { OFF, ON, AUTO };
+
+int fill_cache_mode = static_cast<int>(FillCache::AUTO);
+bool verify_checksums = false;
+
+const struct config_enum_entry fill_cache_options[] = {
+    {"auto", static_cast<int>(FillCache::AUTO), false},
+    {"on", static_cast<int>(FillCache::ON), false},
+    {"off", static_cast<int>(FillCache::OFF), false},
+    {"true", static_cast<int>(FillCache::ON), true},
+    {"false", static_cast<int>(FillCache::OFF), true},
+    {NULL, 0, false}
+};
+
+/*
+ * level_pivot.prefetch and level_pivot.prefetch_batch_size: whether scans
+ * of local databases read LevelDB ahead on a background thread while the
+ * backend builds tuples, and how many keys each read-ahead batch holds,
+ * unless the table's prefetch / prefetch_batch_size options say
+ * otherwise. auto prefetches bulk scans only, where the thread start pays
+ * for itself. The thread never calls into PostgreSQL.
+ */
+int prefetch_mode = static_cast<int>(FillCache::OFF);
+int prefetch_batch_size = 256;
+
+/*
+ * level_pivot.notify_payload: whether change notifications say which rows
+ * changed. Past level_pivot.notify_max_rows rows a table's changes are
+ * summarized by identity prefix, down to "the whole table".
+ */
+bool notify_payload = false;
+int notify_max_rows = 100;
+
+/* async.c's limit on a payload, terminating NUL included */
+#ifndef NOTIFY_PAYLOAD_MAX_LENGTH
+#define NOTIFY_PAYLOAD_MAX_LENGTH (BLCKSZ - NAMEDATALEN - 128)
+#endif
+
+/*
+ * Tables the transaction changed, keyed by (schema, table), each NOTIFYed
+ * once at commit
+ */
+std::map<std::pair<std::string, std::string>, level_pivot::ChangeSet> transaction_changes;
 
 /**
- * Parse fdw_private list and build prefix values for filter pushdown.
+ * Builds NOTIFY channel name from schema and table.
  *
- * @param fdw_private List of (attnum, value) pairs from GetForeignPlan
- * @param projection Table projection to get identity column order
- * @return Vector of prefix values in identity column order
+ * Format: {schema}_{table}_changed
+ * This allows clients to LISTEN for changes to specific tables.
+ * PostgreSQL limits channel names to 63 characters.
  */
-static std::vector<std::string>
-build_prefix_from_fdw_private(List *fdw_private,
-                              const level_pivot::Projection& projection)
+static std::string
+build_notify_channel(const std::string& schema_name, const std::string& table_name)
 {
-    /* Parse fdw_private into attnum->value map */
-    std::unordered_map<AttrNumber, std::string> filter_values;
+    std::string channel = schema_name + "_" + table_name + "_changed";
+
+    if (channel.length() > 63)
+        channel = channel.substr(0, 63);
 
-    ListCell *lc = list_head(fdw_private);
-    while (lc != NULL)
+    return channel;
+}
+
+/**
+ * Makes connection read from one snapshot for the rest of the statement.
+ *
+ * Called before a scan or writer opens its first iterator, so every scan
+ * of the statement, and the key lookups of its UPDATEs and DELETEs, see
+ * the database as of the statement's first access to it. Calls from
+ * nested statements (e.g. SQL functions) add a pin to a snapshot that is
+ * already held and so keep reading from the outer one.
+ */
+static void
+use_statement_snapshot(EState *estate,
+                       const std::shared_ptr<level_pivot::LevelDBConnection>& connection)
+{
+    if (snapshot_scope == static_cast<int>(SnapshotScope::TRANSACTION) &&
+        std::find(transaction_snapshots.begin(), transaction_snapshots.end(),
+                  connection) == transaction_snapshots.end())
     {
-        AttrNumber attnum = intVal(lfirst(lc));
-        lc = lnext(fdw_private, lc);
-        if (lc == NULL)
-            break;
-        char *value = strVal(lfirst(lc));
-        lc = lnext(fdw_private, lc);
-        filter_values[attnum] = std::string(value);
+        transaction_snapshots.reserve(transaction_snapshots.size() + 1);
+        connection->acquire_snapshot();
+        transaction_snapshots.push_back(connection);
     }
 
-    /*
-     * Build prefix_values in identity column order.
-     * Only include leading consecutive columns - stop at first missing one.
-     */
-    std::vector<std::string> prefix_values;
-    const auto& identity_cols = projection.identity_columns();
-
-    for (const auto* col : identity_cols)
+    StatementSnapshots *snapshots;
+    auto it = statement_snapshots.find(estate);
+    if (it != statement_snapshots.end())
     {
-        auto it = filter_values.find(col->attnum);
-        if (it != filter_values.end())
-            prefix_values.push_back(it->second);
-        else
-            break;  /* Stop at first missing identity column */
+        snapshots = it->second;
+    }
+    else
+    {
+        snapshots = level_pivot::pg_construct<StatementSnapshots>(estate->es_query_cxt, estate);
+        statement_snapshots.emplace(estate, snapshots);
     }
 
-    return prefix_values;
+    auto& connections = snapshots->connections;
+    if (std::find(connections.begin(), connections.end(), connection) != connections.end())
+        return;
+
+    connections.reserve(connections.size() + 1);
+    connection->acquire_snapshot();
+    connections.push_back(connection);
 }
 
 /**
- * Check if a clause is a pushable equality condition on an identity column.
- *
- * For filter pushdown, we only support simple "column = constant" expressions
- * where the column is an identity column (part of the key pattern).
- *
+ * Drops connection's transaction-scope snapshot after a write, so the
+ * transaction's next statement sees what it wrote. The current
+ * statement keeps its own pin until it ends.
+ */
+static void
+release_transaction_snapshot(const std::shared_ptr<level_pivot::LevelDBConnection>& connection)
+{
+    auto it = std::find(transaction_snapshots.begin(), transaction_snapshots.end(),
+                        connection);
+    if (it == transaction_snapshots.end())
+        return;
+
+    (*it)->release_snapshot();
+    transaction_snapshots.erase(it);
+}
+
+/**
+ * Starts holding connection's writes until the transaction commits, if
+ * level_pivot.write_scope asks for it. Called before a writer's first
+ * write; later statements of the transaction add to the same buffer.
+ * Inside a subtransaction the writes also go under a savepoint, which
+ * level_pivot_subxact_callback rolls back if the subtransaction aborts.
+ */
+static void
+use_transaction_writes(const std::shared_ptr<level_pivot::LevelDBConnection>& connection)
+{
+    if (write_scope == static_cast<int>(WriteScope::TRANSACTION) &&
+        !connection->buffering_writes())
+    {
+        transaction_writes.reserve(transaction_writes.size() + 1);
+        connection->buffer_writes(static_cast<size_t>(pending_write_limit) * 1024,
+                                  static_cast<level_pivot::OverflowAction>(pending_write_overflow));
+        transaction_writes.push_back(connection);
+    }
+
+    int level = GetCurrentTransactionNestLevel();
+    if (level > 1)
+        connection->savepoint(level);
+}
+
+static void
+discard_transaction_writes()
+{
+    for (auto& connection : transaction_writes)
+        connection->discard_pending_writes();
+    transaction_writes.clear();
+}
+
+/**
+ * Writes each connection's pending writes as one batch. Runs in
+ * PRE_COMMIT, where an error still aborts the transaction: the abort
+ * then discards the connections not yet written, but those already
+ * written stay written, as LevelDB has no cross-database commit.
+ */
+static void
+commit_transaction_writes()
+{
+    PG_TRY_CPP({
+        for (auto& connection : transaction_writes)
+            connection->commit_pending_writes();
+    });
+    transaction_writes.clear();
+}
+
+static void send_transaction_notifies();
+
+/**
+ * Commits or discards transaction-scope writes and change notifications,
+ * and ends transaction-scope snapshots with the transaction that took
+ * them.
+ */
+static void
+level_pivot_xact_callback(XactEvent event, void *arg)
+{
+    switch (event)
+    {
+        case XACT_EVENT_PRE_COMMIT:
+            commit_transaction_writes();
+            send_transaction_notifies();
+            break;
+        case XACT_EVENT_PRE_PREPARE:
+            if (!transaction_writes.empty())
+                ereport(ERROR,
+                        (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                         errmsg("level_pivot: cannot PREPARE a transaction "
+                                "with pending writes"),
+                         errhint("Set level_pivot.write_scope to statement.")));
+            /* PostgreSQL then refuses to PREPARE, as for any NOTIFY */
+            send_transaction_notifies();
+            break;
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PARALLEL_ABORT:
+            discard_transaction_writes();
+            transaction_changes.clear();
+            /* fall through */
+        case XACT_EVENT_COMMIT:
+        case XACT_EVENT_PARALLEL_COMMIT:
+        case XACT_EVENT_PREPARE:
+            for (auto& connection : transaction_snapshots)
+                connection->release_snapshot();
+            transaction_snapshots.clear();
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Keeps the pending writes in step with subtransactions: an aborted one's
+ * writes are undone (ROLLBACK TO SAVEPOINT, or an exception block), a
+ * committed one's stay for its parent. Both events arrive while the
+ * subtransaction is still the current one.
+ */
+static void
+level_pivot_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+                             SubTransactionId parentSubid, void *arg)
+{
+    int level = GetCurrentTransactionNestLevel();
+
+    switch (event)
+    {
+        case SUBXACT_EVENT_COMMIT_SUB:
+            PG_TRY_CPP({
+                for (auto& connection : transaction_writes)
+                    connection->release_savepoint(level);
+            });
+            break;
+        case SUBXACT_EVENT_ABORT_SUB:
+            PG_TRY_CPP({
+                for (auto& connection : transaction_writes)
+                    connection->rollback_savepoint(level);
+            });
+            break;
+        default:
+            break;
+    }
+}
+
+/* Helper functions for NOTIFY support */
+
+/**
+ * Has writer record the rows it changes in state->changes, if
+ * notifications carry them
+ */
+template <typename WriterT>
+static void
+track_changes(ModifyStateBase *state, WriterT& writer)
+{
+    if (!notify_payload)
+        return;
+
+    state->changes = level_pivot::ChangeSet(static_cast<size_t>(notify_max_rows));
+    state->track_changes = true;
+    writer.track_changes(&state->changes);
+}
+
+/**
+ * Adds a statement's changes to its table's notification. Rows changed
+ * without being tracked count as the whole table.
+ */
+static void
+note_table_changed(const ModifyStateBase *state)
+{
+    auto key = std::make_pair(state->schema_name, state->table_name);
+    auto it = transaction_changes.find(key);
+    if (it == transaction_changes.end())
+        it = transaction_changes.emplace(
+            key, level_pivot::ChangeSet(static_cast<size_t>(notify_max_rows))).first;
+
+    if (state->track_changes && !state->changes.empty())
+        it->second.merge(state->changes);
+    else
+        it->second.add_all();
+}
+
+/**
+ * Sends one NOTIFY per table the transaction changed. Runs before
+ * PostgreSQL queues the transaction's notifications, after the
+ * transaction's pending writes reach LevelDB.
+ */
+static void
+send_transaction_notifies()
+{
+    auto changes = std::move(transaction_changes);
+    transaction_changes.clear();
+
+    for (const auto& [table, changed] : changes)
+    {
+        std::string channel = build_notify_channel(table.first, table.second);
+        if (notify_payload)
+        {
+            std::string payload = changed.payload(NOTIFY_PAYLOAD_MAX_LENGTH);
+            Async_Notify(channel.c_str(), payload.c_str());
+        }
+        else
+        {
+            Async_Notify(channel.c_str(), NULL);
+        }
+    }
+}
+
+/* Helper functions */
+
+/**
+ * Parses a size option: a byte count, optionally with a K, M or G suffix
+ * (as accepted by fdw_validator.cpp).
+ */
+static size_t
+parse_size_option(DefElem *def)
+{
+    char *end;
+    size_t size = strtoull(defGetString(def), &end, 10);
+
+    switch (*end)
+    {
+        case 'g':
+        case 'G':
+            size <<= 10;
+            /* fall through */
+        case 'm':
+        case 'M':
+            size <<= 10;
+            /* fall through */
+        case 'k':
+        case 'K':
+            size <<= 10;
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
+level_pivot::ConnectionOptions
+get_server_options(ForeignServer *server)
+{
+    level_pivot::ConnectionOptions options;
+    ListCell *cell;
+
+    foreach(cell, server->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+
+        if (strcmp(def->defname, "db_path") == 0)
+            options.db_path = defGetString(def);
+        else if (strcmp(def->defname, "read_only") == 0)
+            options.read_only = defGetBoolean(def);
+        else if (strcmp(def->defname, "create_if_missing") == 0)
+            options.create_if_missing = defGetBoolean(def);
+        else if (strcmp(def->defname, "block_cache_size") == 0)
+            options.block_cache_size = parse_size_option(def);
+        else if (strcmp(def->defname, "write_buffer_size") == 0)
+            options.write_buffer_size = parse_size_option(def);
+        else if (strcmp(def->defname, "use_write_batch") == 0)
+            options.use_write_batch = defGetBoolean(def);
+        else if (strcmp(def->defname, "bloom_bits_per_key") == 0)
+            options.bloom_bits_per_key = strtol(defGetString(def), NULL, 10);
+        else if (strcmp(def->defname, "block_size") == 0)
+            options.block_size = parse_size_option(def);
+        else if (strcmp(def->defname, "max_open_files") == 0)
+            options.max_open_files = strtol(defGetString(def), NULL, 10);
+        else if (strcmp(def->defname, "compression") == 0)
+            options.compression = level_pivot::parse_compression(defGetString(def))
+                .value_or(level_pivot::Compression::SNAPPY);
+        else if (strcmp(def->defname, "max_file_size") == 0)
+            options.max_file_size = parse_size_option(def);
+    }
+
+    return options;
+}
+
+std::string
+get_table_option(ForeignTable *table, const char *name)
+{
+    ListCell *cell;
+
+    foreach(cell, table->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, name) == 0)
+            return defGetString(def);
+    }
+
+    return "";
+}
+
+/**
+ * Reads batch_size for a foreign table; the table option overrides the
+ * server option, and the default of 1 disables batch inserts.
+ */
+static int
+get_batch_size_option(ForeignTable *table, ForeignServer *server)
+{
+    int batch_size = 1;
+    ListCell *cell;
+
+    foreach(cell, server->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "batch_size") == 0)
+            batch_size = strtol(defGetString(def), NULL, 10);
+    }
+
+    foreach(cell, table->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "batch_size") == 0)
+            batch_size = strtol(defGetString(def), NULL, 10);
+    }
+
+    return batch_size;
+}
+
+/**
+ * Parse an on/off/auto table option (fill_cache, prefetch)
+ */
+static int
+get_auto_option(DefElem *def)
+{
+    if (strcmp(defGetString(def), "auto") == 0)
+        return static_cast<int>(FillCache::AUTO);
+    return static_cast<int>(defGetBoolean(def) ? FillCache::ON : FillCache::OFF);
+}
+
+/**
+ * Read settings for a scan of table, from the table's fill_cache,
+ * verify_checksums, prefetch and prefetch_batch_size options or else the
+ * GUCs. bulk_scan comes from fdw_private (FdwScanPrivateBulkScan) and
+ * decides fill_cache = auto and prefetch = auto.
+ */
+static level_pivot::ScanOptions
+get_scan_options(ForeignTable *table, bool bulk_scan)
+{
+    int fill_cache = fill_cache_mode;
+    bool verify = verify_checksums;
+    int prefetch = prefetch_mode;
+    int batch = prefetch_batch_size;
+    ListCell *cell;
+
+    foreach(cell, table->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "fill_cache") == 0)
+            fill_cache = get_auto_option(def);
+        else if (strcmp(def->defname, "verify_checksums") == 0)
+            verify = defGetBoolean(def);
+        else if (strcmp(def->defname, "prefetch") == 0)
+            prefetch = get_auto_option(def);
+        else if (strcmp(def->defname, "prefetch_batch_size") == 0)
+            batch = strtol(defGetString(def), NULL, 10);
+    }
+
+    level_pivot::ScanOptions scan;
+    if (fill_cache == static_cast<int>(FillCache::AUTO))
+        scan.fill_cache = !bulk_scan;
+    else
+        scan.fill_cache = fill_cache == static_cast<int>(FillCache::ON);
+    scan.verify_checksums = verify;
+    if (prefetch == static_cast<int>(FillCache::ON) ||
+        (prefetch == static_cast<int>(FillCache::AUTO) && bulk_scan))
+        scan.prefetch_batch = static_cast<size_t>(batch);
+    return scan;
+}
+
+/**
+ * True if the table declares fixed_attrs: rows never carry attrs beyond
+ * its attr columns, which point lookups by get() rely on.
+ */
+static bool
+get_fixed_attrs_option(ForeignTable *table)
+{
+    ListCell *cell;
+
+    foreach(cell, table->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "fixed_attrs") == 0)
+            return defGetBoolean(def);
+    }
+    return false;
+}
+
+/**
+ * True if the table sets sorted_identities 'true': its identity values
+ * sort the same way as the keys holding them (see scan_pathkeys). Off by
+ * default, since a value holding a byte below the delimiter after it
+ * ("a b" before "##") breaks the order, and every ordered plan over the
+ * scan would then return wrong rows.
+ */
+static bool
+get_sorted_identities_option(ForeignTable *table)
+{
+    ListCell *cell;
+
+    foreach(cell, table->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "sorted_identities") == 0)
+            return defGetBoolean(def);
+    }
+    return false;
+}
+
+/* get_scan_options for a planned scan */
+static level_pivot::ScanOptions
+get_plan_scan_options(ForeignTable *table, ForeignScan *fsplan)
+{
+    return get_scan_options(table,
+        boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateBulkScan)));
+}
+
+std::unique_ptr<level_pivot::Projection>
+build_projection_from_relation(Relation rel, const std::string& key_pattern)
+{
+    level_pivot::KeyPattern pattern(key_pattern);
+    TupleDesc tupdesc = RelationGetDescr(rel);
+
+    std::vector<level_pivot::ColumnDef> columns;
+    columns.reserve(tupdesc->natts);
+
+    const auto& capture_names = pattern.capture_names();
+
+    for (int i = 0; i < tupdesc->natts; i++)
+    {
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+        if (attr->attisdropped)
+            continue;
+
+        level_pivot::ColumnDef col;
+        col.name = NameStr(attr->attname);
+        col.type = level_pivot::pg_type_from_oid(attr->atttypid);
+        col.attnum = attr->attnum;
+
+        // Check if this is an identity column
+        col.is_identity = false;
+        for (const auto& cap_name : capture_names)
+        {
+            if (col.name == cap_name)
+            {
+                col.is_identity = true;
+                break;
+            }
+        }
+
+        columns.push_back(col);
+    }
+
+    auto projection = std::make_unique<level_pivot::Projection>(pattern, std::move(columns));
+    projection->set_converters(level_pivot::TypeConverter::converters_for(*projection));
+    return projection;
+}
+
+/**
+ * Check a projection of rel out of the ProjectionCache, building it if none
+ * is idle
+ */
+static ProjectionHandle
+acquire_projection(Relation rel, const std::string& key_pattern)
+{
+    Oid relid = RelationGetRelid(rel);
+    return ProjectionHandle(relid, level_pivot::ProjectionCache::instance().acquire(relid, [&] {
+        return build_projection_from_relation(rel, key_pattern);
+    }));
+}
+
+/**
+ * Collect the attnums a scan must produce: everything in the target list
+ * plus anything the local quals reference.
+ *
+ * A whole-row reference (as added for UPDATE/DELETE) needs every column.
+ *
+ * @return List of Integer attnums, in attnum order
+ */
+static List *
+needed_column_attnums(RelOptInfo *baserel, List *scan_clauses, int natts)
+{
+    Bitmapset *attrs_used = NULL;
+    pull_varattnos((Node *) baserel->reltarget->exprs, baserel->relid,
+                   &attrs_used);
+
+    ListCell *lc;
+    foreach(lc, scan_clauses)
+    {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+        pull_varattnos((Node *) rinfo->clause, baserel->relid, &attrs_used);
+    }
+
+    bool whole_row = bms_is_member(0 - FirstLowInvalidHeapAttributeNumber,
+                                   attrs_used);
+
+    List *needed = NIL;
+    for (int attnum = 1; attnum <= natts; attnum++)
+    {
+        if (whole_row ||
+            bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber, attrs_used))
+            needed = lappend(needed, makeInteger(attnum));
+    }
+    return needed;
+}
+
+/**
+ * Convert a List of Integer nodes to a vector of ints
+ */
+static std::vector<int>
+int_list_to_vector(List *list)
+{
+    std::vector<int> values;
+    values.reserve(list_length(list));
+
+    ListCell *lc;
+    foreach(lc, list)
+        values.push_back(intVal(lfirst(lc)));
+    return values;
+}
+
+/**
+ * Collect pushed-down identity predicates per capture.
+ *
+ * Repeated = / IN conditions on one column are intersected; if nothing
+ * is left the column is treated as unconstrained, which only widens the
+ * scan (the quals are rechecked on every row). Bounds and prefixes are
+ * kept for text columns only, since keys order capture values as text.
+ *
+ * @param predicates List of (attnum, AttrFilterOp, value...) from GetForeignPlan
+ * @param projection Table projection
+ * @return One constraint per capture, in pattern order
+ */
+static std::vector<level_pivot::IdentityConstraint>
+build_identity_constraints(List *predicates,
+                           const level_pivot::Projection& projection)
+{
+    const auto& capture_names = projection.parser().pattern().capture_names();
+    std::vector<level_pivot::IdentityConstraint> constraints(capture_names.size());
+
+    ListCell *lc;
+    foreach(lc, predicates)
+    {
+        List *pred = (List *) lfirst(lc);
+        int attnum = intVal(linitial(pred));
+        auto op = static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred)));
+
+        const level_pivot::ColumnDef *col = projection.column_by_attnum(attnum);
+        if (col == nullptr || !col->is_identity)
+            continue;
+        auto pos = std::find(capture_names.begin(), capture_names.end(), col->name);
+        if (pos == capture_names.end())
+            continue;
+        auto& constraint = constraints[pos - capture_names.begin()];
+
+        std::vector<std::string> values;
+        ListCell *vc;
+        for_each_from(vc, pred, 2)
+            values.emplace_back(strVal(lfirst(vc)));
+        if (values.empty())
+            continue;
+
+        bool text = col->type == level_pivot::PgType::TEXT;
+        switch (op) {
+            case level_pivot::AttrFilterOp::EQ:
+            case level_pivot::AttrFilterOp::IN:
+                if (constraint.has_values()) {
+                    std::vector<std::string> both;
+                    for (const auto& value : values) {
+                        if (std::find(constraint.values.begin(), constraint.values.end(),
+                                      value) != constraint.values.end())
+                            both.push_back(value);
+                    }
+                    values = std::move(both);
+                }
+                constraint.values = std::move(values);
+                break;
+            case level_pivot::AttrFilterOp::GT:
+            case level_pivot::AttrFilterOp::GE:
+                if (text && (!constraint.lower || values[0] > *constraint.lower))
+                    constraint.lower = values[0];
+                break;
+            case level_pivot::AttrFilterOp::LT:
+            case level_pivot::AttrFilterOp::LE:
+                if (text && (!constraint.upper || values[0] < *constraint.upper))
+                    constraint.upper = values[0];
+                break;
+            case level_pivot::AttrFilterOp::PREFIX:
+                /* Of two prefixes, keep the longer; any conflict is rechecked */
+                if (text && (!constraint.prefix || values[0].size() > constraint.prefix->size()))
+                    constraint.prefix = values[0];
+                break;
+            default:
+                break;
+        }
+    }
+
+    return constraints;
+}
+
+/**
+ * Leading identity values fixed by single-value equalities, as used for
+ * parallel shard splitting
+ */
+static std::vector<std::string>
+leading_prefix_values(const std::vector<level_pivot::IdentityConstraint>& constraints)
+{
+    std::vector<std::string> prefix_values;
+    for (const auto& constraint : constraints) {
+        if (constraint.values.size() != 1)
+            break;  /* Stop at first identity column without one value */
+        prefix_values.push_back(constraint.values[0]);
+    }
+    return prefix_values;
+}
+
+/**
+ * Work out what a pivot scan reads under the given constraints: point
+ * lookups when every capture is bound, otherwise the identity key ranges
+ */
+static void
+plan_pivot_scan(LevelPivotScanState *state,
+                const std::vector<level_pivot::IdentityConstraint>& constraints)
+{
+    const level_pivot::KeyParser& parser = state->projection->parser();
+    state->ranges = level_pivot::build_identity_ranges(parser, constraints);
+    state->prefix_values = leading_prefix_values(constraints);
+    state->point_lookup.reset();
+    state->point_identities.clear();
+
+    /* With every capture bound, look the rows up one by one */
+    auto identities = level_pivot::build_point_identities(parser, constraints);
+    if (identities) {
+        using PointLookup = level_pivot::PivotScanner::PointLookup;
+        if (state->fixed_attrs && !state->projection->attr_columns().empty())
+            state->point_lookup = PointLookup::GET;
+        else if (state->scanner->supports_point_seek())
+            state->point_lookup = PointLookup::SEEK;
+        state->point_identities = std::move(*identities);
+    }
+}
+
+static void
+begin_pivot_scan(LevelPivotScanState *state)
+{
+    add_scan_counts(state->metrics, state->scanner->stats());
+    state->metrics.scans++;
+    if (state->point_lookup) {
+        state->scanner->begin_point_lookups(state->point_identities,
+                                            *state->point_lookup);
+    } else if (state->index) {
+        /* Rows the index names; the quals drop any it names wrongly */
+        state->point_identities = state->index->lookup(
+            *state->connection, state->index_attr, state->index_lookup, state->index_scan);
+        state->index_matches += state->point_identities.size();
+        state->scanner->begin_point_lookups(state->point_identities, state->index_mode);
+    } else {
+        state->scanner->begin_scan_ranges(state->ranges);
+    }
+}
+
+/**
+ * (Re)start a pivot scan. Join parameters may not be set yet when
+ * BeginForeignScan runs, so parameterized scans bind them at the first
+ * row instead (see bind_identity_params).
+ */
+static void
+start_pivot_scan(LevelPivotScanState *state)
+{
+    if (!state->params.empty()) {
+        state->params_pending = true;
+        return;
+    }
+    begin_pivot_scan(state);
+}
+
+/**
+ * Evaluate the join parameters for the current outer row and start the
+ * scan on the identities they select.
+ *
+ * A parameter replaces any constant values for its column: the quals are
+ * rechecked on every row, so rows of a contradicting value are dropped
+ * there. A NULL parameter matches nothing.
+ */
+static void
+bind_identity_params(LevelPivotScanState *state)
+{
+    std::vector<level_pivot::IdentityConstraint> constraints = state->constraints;
+    bool matches = true;
+
+    MemoryContext oldctx = MemoryContextSwitchTo(state->econtext->ecxt_per_tuple_memory);
+    for (const IdentityParam& param : state->params) {
+        bool isnull;
+        Datum value = ExecEvalExpr(param.expr, state->econtext, &isnull);
+        if (isnull) {
+            matches = false;
+            break;
+        }
+        constraints[param.capture].values = {
+            std::string(OidOutputFunctionCall(param.typoutput, value))};
+    }
+    MemoryContextSwitchTo(oldctx);
+
+    plan_pivot_scan(state, constraints);
+    if (!matches) {
+        state->ranges.clear();
+        state->point_lookup.reset();
+    }
+    begin_pivot_scan(state);
+}
+
+/**
+ * Check if a clause is a pushable equality condition on an identity column.
+ *
+ * For filter pushdown, we only support simple "column = constant" expressions
+ * where the column is an identity column (part of the key pattern).
+ *
+ * @param clause The expression to check
+ * @param baserel The relation being scanned
+ * @param identity_attnums Attribute numbers of identity columns
+ * @param out_attnum Output: the attribute number of the matched column
+ * @param out_value Output: the constant value (must be pfree'd by caller)
+ * @return true if this is a pushable equality condition
+ */
+static bool
+is_pushable_equality(Expr *clause, RelOptInfo *baserel,
+                     const std::vector<AttrNumber>& identity_attnums,
+                     AttrNumber *out_attnum, char **out_value)
+{
+    /* Must be an OpExpr */
+    if (!IsA(clause, OpExpr))
+        return false;
+
+    OpExpr *op = (OpExpr *) clause;
+
+    /* Must have exactly 2 arguments */
+    if (list_length(op->args) != 2)
+        return false;
+
+    /* Check for equality operator by looking up the operator */
+    HeapTuple opertup = SearchSysCache1(OPEROID, ObjectIdGetDatum(op->opno));
+    if (!HeapTupleIsValid(opertup))
+        return false;
+
+    Form_pg_operator operform = (Form_pg_operator) GETSTRUCT(opertup);
+    bool is_equality = (operform->oprresult == BOOLOID &&
+                        strcmp(NameStr(operform->oprname), "=") == 0);
+    ReleaseSysCache(opertup);
+
+    if (!is_equality)
+        return false;
+
+    Expr *left = (Expr *) linitial(op->args);
+    Expr *right = (Expr *) lsecond(op->args);
+
+    /* Look for Var = Const pattern (either direction) */
+    Var *var = NULL;
+    Const *constval = NULL;
+
+    if (IsA(left, Var) && IsA(right, Const)) {
+        var = (Var *) left;
+        constval = (Const *) right;
+    } else if (IsA(left, Const) && IsA(right, Var)) {
+        var = (Var *) right;
+        constval = (Const *) left;
+    } else {
+        return false;
+    }
+
+    /* Check if var is from this relation */
+    if (var->varno != baserel->relid)
+        return false;
+
+    /* Check if this is an identity column */
+    bool is_identity = false;
+    for (AttrNumber id_attnum : identity_attnums) {
+        if (var->varattno == id_attnum) {
+            is_identity = true;
+            break;
+        }
+    }
+    if (!is_identity)
+        return false;
+
+    /* Must not be NULL */
+    if (constval->constisnull)
+        return false;
+
+    /* Convert Datum to string based on type */
+    char *value = NULL;
+    Oid typid = constval->consttype;
+
+    if (typid == TEXTOID || typid == VARCHAROID || typid == BPCHAROID) {
+        value = TextDatumGetCString(constval->constvalue);
+    } else if (typid == INT4OID) {
+        int32 intval = DatumGetInt32(constval->constvalue);
+        value = psprintf("%d", intval);
+    } else if (typid == INT8OID) {
+        int64 intval = DatumGetInt64(constval->constvalue);
+        value = psprintf("%ld", (long) intval);
+    } else {
+        /* For other types, use output function */
+        Oid typoutput;
+        bool typIsVarlena;
+        getTypeOutputInfo(typid, &typoutput, &typIsVarlena);
+        value = OidOutputFunctionCall(typoutput, constval->constvalue);
+    }
+
+    *out_attnum = var->varattno;
+    *out_value = value;
+    return true;
+}
+
+/**
+ * Map a boolean comparison operator to its btree strategy by name.
+ *
+ * @return BTEqualStrategyNumber etc., or 0 if not =, <, <=, > or >=
+ */
+static int
+comparison_strategy(Oid opno)
+{
+    HeapTuple opertup = SearchSysCache1(OPEROID, ObjectIdGetDatum(opno));
+    if (!HeapTupleIsValid(opertup))
+        return 0;
+
+    Form_pg_operator operform = (Form_pg_operator) GETSTRUCT(opertup);
+    const char *oprname = NameStr(operform->oprname);
+    int strat = 0;
+
+    if (operform->oprresult != BOOLOID)
+        strat = 0;
+    else if (strcmp(oprname, "=") == 0)
+        strat = BTEqualStrategyNumber;
+    else if (strcmp(oprname, "<") == 0)
+        strat = BTLessStrategyNumber;
+    else if (strcmp(oprname, "<=") == 0)
+        strat = BTLessEqualStrategyNumber;
+    else if (strcmp(oprname, ">") == 0)
+        strat = BTGreaterStrategyNumber;
+    else if (strcmp(oprname, ">=") == 0)
+        strat = BTGreaterEqualStrategyNumber;
+
+    ReleaseSysCache(opertup);
+    return strat;
+}
+
+/**
+ * Flip a btree strategy for Const op Var, so it reads as Var op Const
+ */
+static int
+commute_strategy(int strategy)
+{
+    switch (strategy) {
+        case BTLessStrategyNumber:
+            return BTGreaterStrategyNumber;
+        case BTLessEqualStrategyNumber:
+            return BTGreaterEqualStrategyNumber;
+        case BTGreaterStrategyNumber:
+            return BTLessStrategyNumber;
+        case BTGreaterEqualStrategyNumber:
+            return BTLessEqualStrategyNumber;
+        default:
+            return strategy;  /* BTEqualStrategyNumber stays the same */
+    }
+}
+
+/**
+ * Check if a clause is "identity column = expression" where the
+ * expression can be computed before scanning: it doesn't read this
+ * relation, isn't volatile and isn't a Const (those are pushed directly,
+ * see is_pushable_equality). Join clauses are of this form, with outer
+ * Vars at path time and nestloop Params once the plan is built.
+ *
+ * @param out_attnum Output: the identity column's attribute number
+ * @return The expression, or NULL if the clause doesn't qualify
+ */
+static Expr *
+identity_equality_operand(PlannerInfo *root, Expr *clause, RelOptInfo *baserel,
+                          const std::vector<AttrNumber>& identity_attnums,
+                          AttrNumber *out_attnum)
+{
+    if (!IsA(clause, OpExpr))
+        return NULL;
+
+    OpExpr *op = (OpExpr *) clause;
+    if (list_length(op->args) != 2 ||
+        comparison_strategy(op->opno) != BTEqualStrategyNumber)
+        return NULL;
+
+    Expr *left = (Expr *) linitial(op->args);
+    Expr *right = (Expr *) lsecond(op->args);
+    Var *var;
+    Expr *other;
+
+    if (IsA(left, Var) && ((Var *) left)->varno == baserel->relid) {
+        var = (Var *) left;
+        other = right;
+    } else if (IsA(right, Var) && ((Var *) right)->varno == baserel->relid) {
+        var = (Var *) right;
+        other = left;
+    } else {
+        return NULL;
+    }
+
+    if (var->varattno <= 0 ||
+        std::find(identity_attnums.begin(), identity_attnums.end(), var->varattno)
+            == identity_attnums.end())
+        return NULL;
+
+    if (IsA(other, Const) ||
+        bms_is_member(baserel->relid, pull_varnos(root, (Node *) other)) ||
+        contain_volatile_functions((Node *) other))
+        return NULL;
+
+    *out_attnum = var->varattno;
+    return other;
+}
+
+/**
+ * generate_implied_equalities_for_column callback: is em the identity
+ * column whose attnum arg points to?
+ */
+static bool
+ec_member_is_identity(PlannerInfo *root, RelOptInfo *rel,
+                      EquivalenceClass *ec, EquivalenceMember *em, void *arg)
+{
+    AttrNumber attnum = *static_cast<AttrNumber *>(arg);
+    Var *var = (Var *) em->em_expr;
+
+    return IsA(var, Var) && var->varno == rel->relid &&
+           var->varattno == attnum && var->varlevelsup == 0;
+}
+
+/**
+ * Extract raw key predicate from a comparison clause.
+ *
+ * For raw tables, we support predicates on the 'key' column:
+ *   - key = 'value' (exact match)
+ *   - key > 'value', key >= 'value' (lower bound)
+ *   - key < 'value', key <= 'value' (upper bound)
+ *
  * @param clause The expression to check
  * @param baserel The relation being scanned
- * @param identity_attnums Attribute numbers of identity columns
- * @param out_attnum Output: the attribute number of the matched column
- * @param out_value Output: the constant value (must be pfree'd by caller)
- * @return true if this is a pushable equality condition
+ * @param key_attnum Attribute number of the 'key' column
+ * @param strategy Output: BTLessStrategyNumber, BTLessEqualStrategyNumber,
+ *                 BTEqualStrategyNumber, BTGreaterEqualStrategyNumber, or BTGreaterStrategyNumber
+ * @param value Output: the constant value (must be pfree'd by caller)
+ * @return true if this is a pushable key predicate
+ */
+static bool
+extract_raw_key_predicate(Expr *clause, RelOptInfo *baserel,
+                          AttrNumber key_attnum,
+                          int *strategy, char **value)
+{
+    /* Must be an OpExpr */
+    if (!IsA(clause, OpExpr))
+        return false;
+
+    OpExpr *op = (OpExpr *) clause;
+
+    /* Must have exactly 2 arguments */
+    if (list_length(op->args) != 2)
+        return false;
+
+    /* Determine strategy from operator name */
+    int strat = comparison_strategy(op->opno);
+    bool swap_operands = false;
+
+    if (strat == 0)
+        return false;
+
+    Expr *left = (Expr *) linitial(op->args);
+    Expr *right = (Expr *) lsecond(op->args);
+
+    /* Look for Var op Const pattern (either direction) */
+    Var *var = NULL;
+    Const *constval = NULL;
+
+    if (IsA(left, Var) && IsA(right, Const)) {
+        var = (Var *) left;
+        constval = (Const *) right;
+    } else if (IsA(left, Const) && IsA(right, Var)) {
+        var = (Var *) right;
+        constval = (Const *) left;
+        swap_operands = true;
+    } else {
+        return false;
+    }
+
+    /* Check if var is from this relation and is the key column */
+    if (var->varno != baserel->relid || var->varattno != key_attnum)
+        return false;
+
+    /* Must not be NULL */
+    if (constval->constisnull)
+        return false;
+
+    /* If operands were swapped, flip the comparison direction */
+    if (swap_operands)
+        strat = commute_strategy(strat);
+
+    /* Convert Datum to string */
+    char *val = NULL;
+    Oid typid = constval->consttype;
+
+    if (typid == TEXTOID || typid == VARCHAROID || typid == BPCHAROID) {
+        val = TextDatumGetCString(constval->constvalue);
+    } else {
+        /* For other types, use output function */
+        Oid typoutput;
+        bool typIsVarlena;
+        getTypeOutputInfo(typid, &typoutput, &typIsVarlena);
+        val = OidOutputFunctionCall(typoutput, constval->constvalue);
+    }
+
+    *strategy = strat;
+    *value = val;
+    return true;
+}
+
+/**
+ * Return the Var a filter operand refers to if it is one of the given
+ * columns of this relation, or NULL.
+ *
+ * Binary-compatible casts (varchar to text) are looked through.
+ */
+static Var *
+attr_filter_var(Node *node, RelOptInfo *baserel,
+                const std::vector<AttrNumber>& attr_attnums)
+{
+    while (node != NULL && IsA(node, RelabelType))
+        node = (Node *) ((RelabelType *) node)->arg;
+
+    if (node == NULL || !IsA(node, Var))
+        return NULL;
+
+    Var *var = (Var *) node;
+    if (var->varno != baserel->relid)
+        return NULL;
+
+    for (AttrNumber attnum : attr_attnums) {
+        if (var->varattno == attnum)
+            return var;
+    }
+    return NULL;
+}
+
+/**
+ * Check that values of typid compare the way AttrFilter compares the
+ * stored strings: bytewise for text, numerically for integers.
+ *
+ * Text equality needs a deterministic collation, and text ordering the
+ * C collation. bpchar is left out since it ignores trailing spaces.
+ */
+static bool
+attr_filter_comparable(Oid typid, Oid collid, bool ordering)
+{
+    if (typid == INT4OID || typid == INT8OID)
+        return true;
+
+    if (typid != TEXTOID && typid != VARCHAROID)
+        return false;
+
+    if (!OidIsValid(collid))
+        return false;
+
+    pg_locale_t locale = pg_newlocale_from_collation(collid);
+    return ordering ? locale->collate_is_c : locale->deterministic;
+}
+
+/**
+ * Check if a clause restricts one of the given text columns to a prefix,
+ * and extract it:
+ *   - col LIKE 'prefix%...' (the literal run before the first wildcard)
+ *   - starts_with(col, 'prefix') and col ^@ 'prefix'
+ *
+ * The executor still checks the clause on every row, so whatever of a
+ * LIKE pattern follows the first wildcard needs no handling here.
+ *
+ * @param exact Output: true if the prefix alone decides the clause
+ *              (starts_with, or LIKE 'prefix%')
+ * @return The column's Var if this is a pushable prefix predicate, or NULL
+ */
+static Var *
+extract_prefix_predicate(Expr *clause, RelOptInfo *baserel,
+                         const std::vector<AttrNumber>& attnums,
+                         std::string *prefix, bool *exact)
+{
+    Oid funcid;
+    Oid collid;
+    List *args;
+
+    if (IsA(clause, OpExpr)) {
+        OpExpr *op = (OpExpr *) clause;
+        funcid = get_opcode(op->opno);
+        collid = op->inputcollid;
+        args = op->args;
+    } else if (IsA(clause, FuncExpr)) {
+        FuncExpr *func = (FuncExpr *) clause;
+        funcid = func->funcid;
+        collid = func->inputcollid;
+        args = func->args;
+    } else {
+        return NULL;
+    }
+
+    bool like = funcid == F_TEXTLIKE;
+    if ((!like && funcid != F_STARTS_WITH) || list_length(args) != 2)
+        return NULL;
+
+    /* The column must be the string tested, not the pattern */
+    Var *var = attr_filter_var((Node *) linitial(args), baserel, attnums);
+    Node *right = (Node *) lsecond(args);
+    if (var == NULL)
+        return NULL;
+    if (!IsA(right, Const) || ((Const *) right)->constisnull)
+        return NULL;
+
+    /* Only a deterministic collation makes the prefix a byte prefix */
+    if (!attr_filter_comparable(var->vartype, collid, false) ||
+        (var->vartype != TEXTOID && var->vartype != VARCHAROID))
+        return NULL;
+
+    text *pattern = DatumGetTextPP(((Const *) right)->constvalue);
+    const char *chars = VARDATA_ANY(pattern);
+    size_t len = VARSIZE_ANY_EXHDR(pattern);
+
+    std::string result;
+    if (like) {
+        /*
+         * Server encodings never use ASCII bytes inside multibyte
+         * characters, so wildcards and escapes can be found bytewise
+         */
+        size_t i = 0;
+        for (; i < len && chars[i] != '%' && chars[i] != '_'; i++) {
+            if (chars[i] == '\\' && ++i == len)
+                break;
+            result += chars[i];
+        }
+
+        size_t rest = i;
+        while (rest < len && chars[rest] == '%')
+            rest++;
+        *exact = i < len && rest == len;
+    } else {
+        result.assign(chars, len);
+        *exact = true;
+    }
+
+    /* An empty prefix bounds nothing */
+    if (result.empty())
+        return NULL;
+
+    *prefix = std::move(result);
+    return var;
+}
+
+/**
+ * Check if a clause restricts the raw 'key' column to a prefix, and
+ * extract it (see extract_prefix_predicate)
+ */
+static bool
+extract_raw_key_prefix(Expr *clause, RelOptInfo *baserel, AttrNumber key_attnum,
+                       std::string *prefix, bool *exact)
+{
+    return extract_prefix_predicate(clause, baserel, {key_attnum}, prefix, exact) != NULL;
+}
+
+/**
+ * Convert a text or integer Datum to a C string, or NULL for other types
+ */
+static char *
+attr_filter_value(Datum value, Oid typid)
+{
+    switch (typid) {
+        case TEXTOID:
+        case VARCHAROID:
+            return TextDatumGetCString(value);
+        case INT2OID:
+            return psprintf("%d", (int) DatumGetInt16(value));
+        case INT4OID:
+            return psprintf("%d", DatumGetInt32(value));
+        case INT8OID:
+            return psprintf(INT64_FORMAT, DatumGetInt64(value));
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Extract a predicate on one of the given columns that the scanner can
+ * check on raw values, before any tuple is built. Used for attr columns
+ * (AttrFilter) and for identity columns (key ranges).
+ *
+ * Recognized (text/varchar, integer and bigint columns):
+ *   - col = Const, col < Const, ... (either operand order)
+ *   - col IN (...), i.e. col = ANY(array Const)
+ *   - col LIKE 'prefix%...', starts_with(col, 'prefix') (text/varchar)
+ *   - col IS NULL, col IS NOT NULL (any column type)
+ *
+ * The clause stays in scan_clauses, so PostgreSQL still rechecks it.
+ *
+ * @return List of (attnum Integer, AttrFilterOp Integer, value String...),
+ *         or NIL if the clause can't be pushed
+ */
+static List *
+extract_attr_predicate(Expr *clause, RelOptInfo *baserel,
+                       const std::vector<AttrNumber>& attr_attnums)
+{
+    if (IsA(clause, NullTest)) {
+        NullTest *nt = (NullTest *) clause;
+        Var *var = attr_filter_var((Node *) nt->arg, baserel, attr_attnums);
+        if (var == NULL || nt->argisrow)
+            return NIL;
+
+        auto op = nt->nulltesttype == IS_NULL ?
+            level_pivot::AttrFilterOp::IS_NULL :
+            level_pivot::AttrFilterOp::IS_NOT_NULL;
+        return list_make2(makeInteger(var->varattno),
+                          makeInteger(static_cast<int>(op)));
+    }
+
+    if (IsA(clause, ScalarArrayOpExpr)) {
+        ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+        if (!saop->useOr || list_length(saop->args) != 2 ||
+            comparison_strategy(saop->opno) != BTEqualStrategyNumber)
+            return NIL;
+
+        Var *var = attr_filter_var((Node *) linitial(saop->args), baserel,
+                                   attr_attnums);
+        Node *arg = (Node *) lsecond(saop->args);
+        if (var == NULL || !IsA(arg, Const) || ((Const *) arg)->constisnull ||
+            !attr_filter_comparable(var->vartype, saop->inputcollid, false))
+            return NIL;
+
+        ArrayType *array = DatumGetArrayTypeP(((Const *) arg)->constvalue);
+        Oid elemtype = ARR_ELEMTYPE(array);
+        int16 typlen;
+        bool typbyval;
+        char typalign;
+        get_typlenbyvalalign(elemtype, &typlen, &typbyval, &typalign);
+
+        Datum *elems;
+        bool *elem_nulls;
+        int nelems;
+        deconstruct_array(array, elemtype, typlen, typbyval, typalign,
+                          &elems, &elem_nulls, &nelems);
+
+        List *pred = list_make2(makeInteger(var->varattno),
+                                makeInteger(static_cast<int>(level_pivot::AttrFilterOp::IN)));
+        for (int i = 0; i < nelems; i++) {
+            /* NULL elements never match, so they can be dropped */
+            if (elem_nulls[i])
+                continue;
+            char *value = attr_filter_value(elems[i], elemtype);
+            if (value == NULL)
+                return NIL;
+            pred = lappend(pred, makeString(value));
+        }
+        return list_length(pred) > 2 ? pred : NIL;
+    }
+
+    std::string prefix;
+    bool exact;
+    Var *prefix_var = extract_prefix_predicate(clause, baserel, attr_attnums,
+                                               &prefix, &exact);
+    if (prefix_var != NULL)
+        return list_make3(makeInteger(prefix_var->varattno),
+                          makeInteger(static_cast<int>(level_pivot::AttrFilterOp::PREFIX)),
+                          makeString(pstrdup(prefix.c_str())));
+
+    if (!IsA(clause, OpExpr))
+        return NIL;
+
+    OpExpr *op = (OpExpr *) clause;
+    if (list_length(op->args) != 2)
+        return NIL;
+
+    int strategy = comparison_strategy(op->opno);
+    if (strategy == 0)
+        return NIL;
+
+    Node *left = (Node *) linitial(op->args);
+    Node *right = (Node *) lsecond(op->args);
+    Var *var = attr_filter_var(left, baserel, attr_attnums);
+    Node *other = right;
+    if (var == NULL) {
+        var = attr_filter_var(right, baserel, attr_attnums);
+        other = left;
+        strategy = commute_strategy(strategy);
+    }
+    if (var == NULL || !IsA(other, Const) || ((Const *) other)->constisnull)
+        return NIL;
+
+    bool ordering = strategy != BTEqualStrategyNumber;
+    if (!attr_filter_comparable(var->vartype, op->inputcollid, ordering))
+        return NIL;
+
+    Const *constval = (Const *) other;
+    char *value = attr_filter_value(constval->constvalue, constval->consttype);
+    if (value == NULL)
+        return NIL;
+
+    level_pivot::AttrFilterOp filter_op;
+    switch (strategy) {
+        case BTLessStrategyNumber:
+            filter_op = level_pivot::AttrFilterOp::LT;
+            break;
+        case BTLessEqualStrategyNumber:
+            filter_op = level_pivot::AttrFilterOp::LE;
+            break;
+        case BTGreaterStrategyNumber:
+            filter_op = level_pivot::AttrFilterOp::GT;
+            break;
+        case BTGreaterEqualStrategyNumber:
+            filter_op = level_pivot::AttrFilterOp::GE;
+            break;
+        default:
+            filter_op = level_pivot::AttrFilterOp::EQ;
+            break;
+    }
+
+    return list_make3(makeInteger(var->varattno),
+                      makeInteger(static_cast<int>(filter_op)),
+                      makeString(value));
+}
+
+/**
+ * Build the scanner's AttrFilter from pushed-down attr predicates.
+ *
+ * Predicates on columns the projection doesn't have as attrs, or that
+ * AttrFilter can't check for the column's type, are left to PostgreSQL.
+ */
+static level_pivot::AttrFilter
+build_attr_filter(List *attr_filters, const level_pivot::Projection& projection)
+{
+    level_pivot::AttrFilter filter;
+
+    ListCell *lc;
+    foreach(lc, attr_filters)
+    {
+        List *pred = (List *) lfirst(lc);
+        int attnum = intVal(linitial(pred));
+        auto op = static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred)));
+
+        std::vector<std::string> values;
+        ListCell *vc;
+        for_each_from(vc, pred, 2)
+            values.emplace_back(strVal(lfirst(vc)));
+
+        const level_pivot::ColumnDef *col = projection.column_by_attnum(attnum);
+        if (col == nullptr || col->is_identity)
+            continue;
+        int slot = projection.attr_column_index(std::string_view(col->name));
+        if (slot < 0)
+            continue;
+
+        filter.add(static_cast<size_t>(slot), col->type, op, values);
+    }
+
+    return filter;
+}
+
+/* Predicate list strategy for a key prefix, after the btree strategies */
+constexpr int RAW_KEY_PREFIX_STRATEGY = BTMaxStrategyNumber + 1;
+
+/**
+ * Build RawScanBounds from pushed-down key predicates.
+ *
+ * @param predicates List of (strategy, value) pairs, strategy being a
+ *        BTStrategy constant or RAW_KEY_PREFIX_STRATEGY
+ */
+static level_pivot::RawScanBounds
+build_raw_bounds_from_predicates(List *predicates)
+{
+    level_pivot::RawScanBounds bounds;
+
+    /* Process (strategy, value) pairs */
+    ListCell *cell = list_head(predicates);
+    while (cell != NULL)
+    {
+        int strategy = intVal(lfirst(cell));
+        cell = lnext(predicates, cell);
+        if (cell == NULL)
+            break;
+        char *value = strVal(lfirst(cell));
+        cell = lnext(predicates, cell);
+
+        switch (strategy) {
+            case BTEqualStrategyNumber:
+                bounds.exact_key = std::string(value);
+                break;
+            case BTLessStrategyNumber:
+                bounds.add_upper_bound(value, false);
+                break;
+            case BTLessEqualStrategyNumber:
+                bounds.add_upper_bound(value, true);
+                break;
+            case BTGreaterStrategyNumber:
+                bounds.add_lower_bound(value, false);
+                break;
+            case BTGreaterEqualStrategyNumber:
+                bounds.add_lower_bound(value, true);
+                break;
+            case RAW_KEY_PREFIX_STRATEGY:
+                bounds.add_prefix(value);
+                break;
+        }
+    }
+
+    return bounds;
+}
+
+/**
+ * Find the attribute number of a column by name in a relation.
+ */
+static AttrNumber
+find_column_attnum(Relation rel, const char *name)
+{
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    for (int i = 0; i < tupdesc->natts; i++) {
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+        if (attr->attisdropped)
+            continue;
+        if (strcmp(NameStr(attr->attname), name) == 0)
+            return attr->attnum;
+    }
+    return InvalidAttrNumber;
+}
+
+/**
+ * The table's secondary index: index_attrs names the attr columns it
+ * covers, and index_name (default: the table's name) the <table> segment
+ * of its keys. nullptr if the table declares none.
+ */
+static std::unique_ptr<level_pivot::SecondaryIndex>
+get_secondary_index(ForeignTable *table, Relation rel, const level_pivot::KeyPattern& pattern)
+{
+    std::string option = get_table_option(table, "index_attrs");
+    if (option.empty())
+        return nullptr;
+
+    std::vector<std::string> attrs = level_pivot::SecondaryIndex::parse_attr_list(option);
+    const auto& capture_names = pattern.capture_names();
+    for (const auto& attr : attrs) {
+        if (find_column_attnum(rel, attr.c_str()) == InvalidAttrNumber ||
+            std::find(capture_names.begin(), capture_names.end(), attr) != capture_names.end())
+            throw level_pivot::LevelPivotError(
+                "index_attrs entry \"" + attr + "\" is not an attr column of \"" +
+                RelationGetRelationName(rel) + "\"");
+    }
+
+    std::string name = get_table_option(table, "index_name");
+    if (name.empty())
+        name = RelationGetRelationName(rel);
+    return std::make_unique<level_pivot::SecondaryIndex>(std::move(name), std::move(attrs));
+}
+
+/**
+ * Check if an index lookup can answer a predicate on an indexed column.
+ * Entries hold the stored bytes and lookups use the constant's canonical
+ * text, which only agree for text columns: an integer written as "007"
+ * would never be found by = 7. Other types read the table instead.
+ */
+static bool
+index_answers(level_pivot::AttrFilterOp op, bool text)
+{
+    if (!text)
+        return false;
+    switch (op) {
+        case level_pivot::AttrFilterOp::EQ:
+        case level_pivot::AttrFilterOp::IN:
+        case level_pivot::AttrFilterOp::LT:
+        case level_pivot::AttrFilterOp::LE:
+        case level_pivot::AttrFilterOp::GT:
+        case level_pivot::AttrFilterOp::GE:
+        case level_pivot::AttrFilterOp::PREFIX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Set up the secondary index lookup of an index path (add_index_path)
+ * from the pushed-down predicates on its column. Without usable ones the
+ * scan reads its key ranges as usual.
+ */
+static void
+init_index_lookup(LevelPivotScanState *state, ForeignTable *table, Relation rel,
+                  ForeignScan *fsplan, AttrNumber attnum)
+{
+    const level_pivot::ColumnDef *col = state->projection->column_by_attnum(attnum);
+    if (col == nullptr || col->is_identity)
+        return;
+
+    auto index = get_secondary_index(table, rel, state->projection->parser().pattern());
+    if (!index || !index->indexes(col->name))
+        return;
+
+    using PointLookup = level_pivot::PivotScanner::PointLookup;
+    if (state->fixed_attrs)
+        state->index_mode = PointLookup::GET;
+    else if (state->scanner->supports_point_seek())
+        state->index_mode = PointLookup::SEEK;
+    else
+        return;
+
+    List *attr_filters = (List *) list_nth(fsplan->fdw_private, FdwScanPrivateAttrFilters);
+    ListCell *lc;
+    foreach(lc, attr_filters)
+    {
+        List *pred = (List *) lfirst(lc);
+        if (intVal(linitial(pred)) != attnum)
+            continue;
+        auto op = static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred)));
+        if (!index_answers(op, col->type == level_pivot::PgType::TEXT))
+            continue;
+
+        std::vector<std::string> values;
+        ListCell *vc;
+        for_each_from(vc, pred, 2)
+            values.emplace_back(strVal(lfirst(vc)));
+        state->index_lookup.add(op, values);
+    }
+    if (state->index_lookup.empty())
+        return;
+
+    state->index = std::move(index);
+    state->index_attr = col->name;
+    state->index_scan = get_plan_scan_options(table, fsplan);
+    state->index_scan.prefetch_batch = 0;  /* Lookups read a few entries each */
+}
+
+/*
+ * Converts a text or bytea datum into a reusable string without a palloc'd
+ * copy. Both are plain varlenas, so bytea values keep every byte, NULs
+ * included.
+ */
+static void
+assign_text_datum(std::string& out, Datum datum)
+{
+    text *t = DatumGetTextPP(datum);
+    out.assign(VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t));
+}
+
+/*
+ * Builds a text or bytea datum holding bytes, in the current memory
+ * context. This is the inverse of assign_text_datum: no terminator, no
+ * strlen, and binary values pass through unchanged.
+ */
+static Datum
+varlena_datum(std::string_view bytes)
+{
+    struct varlena *result = (struct varlena *) palloc(VARHDRSZ + bytes.size());
+    SET_VARSIZE(result, VARHDRSZ + bytes.size());
+    memcpy(VARDATA(result), bytes.data(), bytes.size());
+    return PointerGetDatum(result);
+}
+
+/* Shards per parallel participant; extra shards even out skewed ranges */
+constexpr int PARALLEL_SHARDS_PER_PARTICIPANT = 4;
+
+/**
+ * Claim the next unscanned shard and start the scanner on it.
+ *
+ * A shard scans only the parts of the scan's identity ranges that fall
+ * inside it; shards holding none are skipped. Point lookups aren't split:
+ * whoever claims shard 0 does them all, and the other shards are empty.
+ *
+ * @return false once every shard has been claimed
+ */
+static bool
+claim_next_shard(LevelPivotScanState *state)
+{
+    LevelPivotParallelState *pstate = state->pstate;
+
+    for (;;) {
+        uint32 shard = pg_atomic_fetch_add_u32(&pstate->next_shard, 1);
+        if (shard >= pstate->nshards)
+            return false;
+
+        if (state->point_lookup || state->index) {
+            if (shard != 0)
+                continue;
+            begin_pivot_scan(state);
+            state->shard_active = true;
+            return true;
+        }
+
+        /* Shard i runs from boundary i-1 to boundary i */
+        std::string start;
+        std::string end;
+        const char *ptr = pstate->bounds;
+        for (uint32 i = 0; i < pstate->nshards - 1 && i <= shard; i++) {
+            uint32 len;
+            memcpy(&len, ptr, sizeof(uint32));
+            ptr += sizeof(uint32);
+            if (i + 1 == shard)
+                start.assign(ptr, len);
+            if (i == shard)
+                end.assign(ptr, len);
+            ptr += len;
+        }
+
+        auto ranges = level_pivot::clip_key_ranges(state->ranges, start, end);
+        if (ranges.empty())
+            continue;
+
+        add_scan_counts(state->metrics, state->scanner->stats());
+        state->metrics.scans++;
+        state->scanner->begin_scan_ranges(ranges);
+        state->shard_active = true;
+        return true;
+    }
+}
+
+/**
+ * Next pivoted row, moving on to newly claimed shards in parallel scans.
+ */
+static const level_pivot::PivotRow *
+next_pivot_row(LevelPivotScanState *state)
+{
+    if (state->params_pending) {
+        state->params_pending = false;
+        bind_identity_params(state);
+    }
+
+    if (!state->pstate)
+        return state->scanner->next_row();
+
+    for (;;) {
+        if (state->shard_active) {
+            const level_pivot::PivotRow *row = state->scanner->next_row();
+            if (row)
+                return row;
+            state->shard_active = false;
+        }
+        if (!claim_next_shard(state))
+            return nullptr;
+    }
+}
+
+/**
+ * Whether EXPLAIN ANALYZE wants this scan's phases timed. Timing costs a
+ * clock read per iterator move, so it is only done with TIMING on.
+ */
+static bool
+scan_timing(ForeignScanState *node)
+{
+    return node->ss.ps.instrument != nullptr && node->ss.ps.instrument->need_timer;
+}
+
+/**
+ * Set up a scan's pushed-down LIMIT and OFFSET (FdwScanPrivateLimit), if
+ * it has them
+ */
+static void
+init_scan_limit(ScanStateBase *state, ForeignScanState *node)
+{
+    ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+    if (!boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateLimit)))
+        return;
+
+    int nexprs = list_length(fsplan->fdw_exprs);
+    state->limit_count = ExecInitExpr((Expr *) list_nth(fsplan->fdw_exprs, nexprs - 2),
+                                      (PlanState *) node);
+    state->limit_offset = ExecInitExpr((Expr *) list_nth(fsplan->fdw_exprs, nexprs - 1),
+                                       (PlanState *) node);
+    state->limit_pending = true;
+}
+
+/**
+ * Evaluate LIMIT and OFFSET for the scan about to start, with the checks
+ * and errors of ExecLimit. Deferred to the first row, like join
+ * parameters, since they may be Params set later.
+ */
+static void
+bind_scan_limit(ScanStateBase *state, ExprContext *econtext)
+{
+    state->limit_pending = false;
+
+    bool isnull;
+    Datum value = ExecEvalExprSwitchContext(state->limit_offset, econtext, &isnull);
+    state->offset_left = isnull ? 0 : DatumGetInt64(value);
+    if (state->offset_left < 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_ROW_COUNT_IN_RESULT_OFFSET_CLAUSE),
+                 errmsg("OFFSET must not be negative")));
+
+    value = ExecEvalExprSwitchContext(state->limit_count, econtext, &isnull);
+    state->rows_left = isnull ? -1 : DatumGetInt64(value);
+    if (!isnull && state->rows_left < 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_ROW_COUNT_IN_LIMIT_CLAUSE),
+                 errmsg("LIMIT must not be negative")));
+}
+
+/**
+ * Planner state passed from GetForeignRelSize to GetForeignPaths via
+ * baserel->fdw_private. Lives in planner memory, so it must stay POD.
+ */
+struct LevelPivotRelInfo {
+    double keys;  /* Estimated LevelDB keys visited by the scan */
+    double rows;  /* Estimated rows in the scanned range, before local quals */
+};
+
+/**
+ * Attribute numbers of identity columns in key pattern order.
+ *
+ * Prefix pushdown needs pattern order (the order values appear in the key),
+ * which can differ from column order. Captures without a matching column
+ * get InvalidAttrNumber so callers stop extending the prefix there.
+ */
+static std::vector<AttrNumber>
+identity_attnums_in_pattern_order(Relation rel, const level_pivot::KeyPattern& pattern)
+{
+    std::vector<AttrNumber> attnums;
+    attnums.reserve(pattern.capture_count());
+    for (const auto& cap_name : pattern.capture_names())
+        attnums.push_back(find_column_attnum(rel, cap_name.c_str()));
+    return attnums;
+}
+
+/**
+ * Cache key identifying a raw scan range. Values are length-prefixed so
+ * arbitrary key bytes can't make two different ranges collide.
+ */
+static std::string
+raw_range_key(const level_pivot::RawScanBounds& bounds)
+{
+    auto append = [](std::string& out, char tag, const std::optional<std::string>& v) {
+        if (!v.has_value())
+            return;
+        out += tag;
+        out += std::to_string(v->size());
+        out += ':';
+        out += *v;
+    };
+
+    std::string key;
+    append(key, '=', bounds.exact_key);
+    append(key, bounds.lower_inclusive ? '[' : '(', bounds.lower_bound);
+    append(key, bounds.upper_inclusive ? ']' : ')', bounds.upper_bound);
+    return key;
+}
+
+/**
+ * Sample LevelDB for the scan range of baserel and update its row count,
+ * width and relinfo->keys. Leaves the defaults in place if the table has
+ * no key pattern or LevelDB can't be read.
+ */
+static void
+estimate_rel_size(PlannerInfo *root, RelOptInfo *baserel, Oid foreigntableid,
+                  LevelPivotRelInfo *relinfo)
+{
+    ForeignTable *table = GetForeignTable(foreigntableid);
+    ForeignServer *server = GetForeignServer(table->serverid);
+    TableMode mode = get_table_mode(table);
+
+    std::unique_ptr<level_pivot::KeyParser> parser;
+    std::vector<AttrNumber> identity_attnums;
+    std::vector<std::string> prefix_values;
+    level_pivot::RawScanBounds bounds;
+    std::string range_key;
+    List *local_conds = NIL;
+    ListCell *cell;
+
+    Relation rel = table_open(foreigntableid, NoLock);
+
+    if (mode == TableMode::RAW) {
+        /* Collect key bounds in the predicate layout GetForeignPlan uses */
+        AttrNumber key_attnum = find_column_attnum(rel, "key");
+        List *bounds_list = NIL;
+
+        foreach(cell, baserel->baserestrictinfo) {
+            RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+            int strategy;
+            char *value;
+            std::string prefix;
+            bool exact;
+            if (key_attnum != InvalidAttrNumber &&
+                extract_raw_key_predicate(rinfo->clause, baserel, key_attnum,
+                                          &strategy, &value)) {
+                bounds_list = lappend(bounds_list, makeInteger(strategy));
+                bounds_list = lappend(bounds_list, makeString(value));
+            } else if (key_attnum != InvalidAttrNumber &&
+                       extract_raw_key_prefix(rinfo->clause, baserel, key_attnum,
+                                              &prefix, &exact)) {
+                bounds_list = lappend(bounds_list, makeInteger(RAW_KEY_PREFIX_STRATEGY));
+                bounds_list = lappend(bounds_list, makeString(pstrdup(prefix.c_str())));
+                if (!exact)
+                    local_conds = lappend(local_conds, rinfo);
+            } else {
+                local_conds = lappend(local_conds, rinfo);
+            }
+        }
+
+        bounds = build_raw_bounds_from_predicates(bounds_list);
+        range_key = raw_range_key(bounds);
+    } else {
+        std::string key_pattern = get_table_option(table, "key_pattern");
+        if (key_pattern.empty()) {
+            table_close(rel, NoLock);
+            return;
+        }
+
+        parser = std::make_unique<level_pivot::KeyParser>(key_pattern);
+        identity_attnums = identity_attnums_in_pattern_order(rel, parser->pattern());
+
+        /* Find pushable equalities, remembering which clause supplied each */
+        std::unordered_map<AttrNumber, std::pair<std::string, RestrictInfo *>> filters;
+        std::vector<RestrictInfo *> unpushed;
+
+        foreach(cell, baserel->baserestrictinfo) {
+            RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+            AttrNumber attnum;
+            char *value;
+            if (is_pushable_equality(rinfo->clause, baserel, identity_attnums,
+                                     &attnum, &value) &&
+                filters.find(attnum) == filters.end()) {
+                filters[attnum] = {std::string(value), rinfo};
+            } else {
+                unpushed.push_back(rinfo);
+            }
+        }
+
+        /* Only leading identity values narrow the range; the rest stay local */
+        for (AttrNumber attnum : identity_attnums) {
+            auto it = filters.find(attnum);
+            if (it == filters.end())
+                break;
+            prefix_values.push_back(it->second.first);
+            filters.erase(it);
+        }
+        for (const auto& entry : filters)
+            local_conds = lappend(local_conds, entry.second.second);
+        for (RestrictInfo *rinfo : unpushed)
+            local_conds = lappend(local_conds, rinfo);
+
+        range_key = parser->build_prefix(prefix_values);
+    }
+
+    table_close(rel, NoLock);
+
+    auto& cache = level_pivot::SizeEstimateCache::instance();
+    std::optional<level_pivot::SizeEstimate> est = cache.lookup(foreigntableid, range_key);
+
+    if (!est) {
+        try {
+            auto connection = level_pivot::ConnectionManager::instance()
+                .get_connection(server->serverid, get_server_options(server));
+            level_pivot::SizeEstimator estimator(connection);
+
+            if (mode == TableMode::RAW)
+                est = estimator.estimate_raw(bounds);
+            else
+                est = estimator.estimate_pivot(*parser, prefix_values);
+
+            cache.store(foreigntableid, range_key, *est);
+        } catch (const level_pivot::LevelDBError& e) {
+            elog(DEBUG1, "level_pivot: size estimate unavailable: %s", e.what());
+            return;
+        }
+    }
+
+    Selectivity selectivity = clauselist_selectivity(root, local_conds,
+                                                     baserel->relid,
+                                                     JOIN_INNER, NULL);
+    baserel->rows = clamp_row_est(est->rows * selectivity);
+    baserel->pages = (BlockNumber) std::min<double>(
+        std::ceil((double) est->approximate_bytes / BLCKSZ), MaxBlockNumber);
+    relinfo->keys = est->keys;
+    relinfo->rows = est->rows;
+
+    /* Empty ranges say nothing about widths; keep PostgreSQL's defaults */
+    if (est->keys <= 0)
+        return;
+
+    double width;
+    if (mode == TableMode::RAW) {
+        width = est->avg_identity_width + est->avg_value_width;
+    } else {
+        /* Each attr column in the target list contributes one value */
+        int attr_cols = 0;
+        foreach(cell, baserel->reltarget->exprs) {
+            Node *expr = (Node *) lfirst(cell);
+            if (!IsA(expr, Var))
+                continue;
+            AttrNumber attnum = ((Var *) expr)->varattno;
+            if (std::find(identity_attnums.begin(), identity_attnums.end(), attnum)
+                    == identity_attnums.end())
+                attr_cols++;
+        }
+        width = est->avg_identity_width +
+                est->avg_value_width * std::min<double>(attr_cols, est->keys_per_row);
+    }
+    baserel->reltarget->width = (int) std::ceil(width);
+}
+
+/**
+ * Pathkeys for the order a scan returns rows in: pivot rows ascend by
+ * the captures before {attr}, raw rows by key; a reverse scan (descending)
+ * returns them the other way round.
+ *
+ * Only columns whose comparison is bytewise (text or varchar in the C
+ * collation) qualify, and the pathkeys stop at the first column that
+ * doesn't or that the query has no use for sorting by. Columns fixed to
+ * one value are skipped. Pivot key order also needs identity values
+ * free of bytes that sort below the literal after them (a space before
+ * "##", say), which tables promise with sorted_identities 'true'.
+ */
+static List *
+scan_pathkeys(PlannerInfo *root, RelOptInfo *baserel, Oid foreigntableid,
+              bool descending)
+{
+    ForeignTable *table = GetForeignTable(foreigntableid);
+    Relation rel = table_open(foreigntableid, NoLock);
+
+    std::vector<AttrNumber> order_attnums;
+    if (get_table_mode(table) == TableMode::RAW) {
+        order_attnums.push_back(find_column_attnum(rel, "key"));
+    } else {
+        std::string key_pattern = get_table_option(table, "key_pattern");
+        if (!key_pattern.empty() && get_sorted_identities_option(table)) {
+            level_pivot::KeyPattern pattern(key_pattern);
+            order_attnums = identity_attnums_in_pattern_order(rel, pattern);
+            order_attnums.resize(level_pivot::captures_before_attr(pattern));
+        }
+    }
+
+    List *pathkeys = NIL;
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    for (AttrNumber attnum : order_attnums) {
+        if (attnum == InvalidAttrNumber)
+            break;
+
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, attnum - 1);
+        if ((attr->atttypid != TEXTOID && attr->atttypid != VARCHAROID) ||
+            !attr_filter_comparable(attr->atttypid, attr->attcollation, true))
+            break;
+
+        Oid ltop;
+        Oid gtop;
+        get_sort_group_operators(attr->atttypid, true, false, true,
+                                 &ltop, NULL, &gtop, NULL);
+        Oid sortop = descending ? gtop : ltop;
+        Var *var = makeVar(baserel->relid, attnum, attr->atttypid, attr->atttypmod,
+                           attr->attcollation, 0);
+        List *key = build_expression_pathkey(root, (Expr *) var, sortop,
+                                             baserel->relids, false);
+        if (key == NIL)
+            break;  /* No query clause sorts or merges on it */
+
+        PathKey *pathkey = linitial_node(PathKey, key);
+        if (!EC_MUST_BE_REDUNDANT(pathkey->pk_eclass))
+            pathkeys = lappend(pathkeys, pathkey);
+    }
+    table_close(rel, NoLock);
+
+    return truncate_useless_pathkeys(root, baserel, pathkeys);
+}
+
+/**
+ * Number of leading captures (before {attr}) with bound[i] set: how much
+ * of the key prefix a scan can seek to
  */
-static bool
-is_pushable_equality(Expr *clause, RelOptInfo *baserel,
-                     const std::vector<AttrNumber>& identity_attnums,
-                     AttrNumber *out_attnum, char **out_value)
+static size_t
+leading_bound_captures(const std::vector<bool>& bound, size_t prefix_captures)
 {
-    /* Must be an OpExpr */
-    if (!IsA(clause, OpExpr))
-        return false;
+    size_t count = 0;
+    while (count < bound.size() && count < prefix_captures && bound[count])
+        count++;
+    return count;
+}
 
-    OpExpr *op = (OpExpr *) clause;
+/**
+ * Add parameterized paths for equality join clauses on identity columns
+ * of a pivot table.
+ *
+ * Candidate clauses come from the rel's join clauses and from equivalence
+ * classes, as in postgres_fdw; each distinct set of outer rels gets one
+ * path, whose clauses are collected by get_baserel_parampathinfo. A path
+ * is only worth adding if its parameters extend the leading run of bound
+ * captures, since only that run narrows the key range.
+ *
+ * Each execution is one seek, costed like a random page read, plus the
+ * keys under the bound prefix: rel_keys, the sampled key estimate from
+ * GetForeignRelSize, scaled by the selectivity of the join clauses.
+ */
+static void
+add_parameterized_paths(PlannerInfo *root, RelOptInfo *baserel, Oid foreigntableid,
+                        double rel_keys)
+{
+    ForeignTable *table = GetForeignTable(foreigntableid);
+    std::string key_pattern = get_table_option(table, "key_pattern");
+    if (key_pattern.empty())
+        return;
 
-    /* Must have exactly 2 arguments */
-    if (list_length(op->args) != 2)
-        return false;
+    level_pivot::KeyPattern pattern(key_pattern);
+    size_t prefix_captures = level_pivot::captures_before_attr(pattern);
+    Relation rel = table_open(foreigntableid, NoLock);
+    std::vector<AttrNumber> identity_attnums = identity_attnums_in_pattern_order(rel, pattern);
+    table_close(rel, NoLock);
+
+    auto capture_of = [&](AttrNumber attnum) {
+        return std::find(identity_attnums.begin(), identity_attnums.end(), attnum) -
+               identity_attnums.begin();
+    };
+
+    /* Captures the rel's own quals bind with = or IN */
+    std::vector<bool> bound(identity_attnums.size(), false);
+    ListCell *cell;
+    foreach(cell, baserel->baserestrictinfo) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        AttrNumber attnum;
+        char *value;
+        if (is_pushable_equality(rinfo->clause, baserel, identity_attnums,
+                                 &attnum, &value)) {
+            bound[capture_of(attnum)] = true;
+            continue;
+        }
+        List *pred = extract_attr_predicate(rinfo->clause, baserel, identity_attnums);
+        if (pred != NIL &&
+            static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred))) ==
+                level_pivot::AttrFilterOp::IN)
+            bound[capture_of(intVal(linitial(pred)))] = true;
+    }
+    size_t base_leading = leading_bound_captures(bound, prefix_captures);
+
+    /* Join clauses that could bind an identity column */
+    List *candidates = NIL;
+    foreach(cell, baserel->joininfo) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        AttrNumber attnum;
+        if (join_clause_is_movable_to(rinfo, baserel) &&
+            identity_equality_operand(root, rinfo->clause, baserel,
+                                      identity_attnums, &attnum) != NULL)
+            candidates = lappend(candidates, rinfo);
+    }
+    if (baserel->has_eclass_joins) {
+        for (AttrNumber attnum : identity_attnums) {
+            if (attnum == InvalidAttrNumber)
+                continue;
+            candidates = list_concat(candidates,
+                generate_implied_equalities_for_column(root, baserel,
+                                                       ec_member_is_identity,
+                                                       &attnum,
+                                                       baserel->lateral_referencers));
+        }
+    }
 
-    /* Check for equality operator by looking up the operator */
-    HeapTuple opertup = SearchSysCache1(OPEROID, ObjectIdGetDatum(op->opno));
-    if (!HeapTupleIsValid(opertup))
-        return false;
+    /* One path per distinct set of outer rels */
+    List *outer_sets = NIL;
+    foreach(cell, candidates) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        Relids required_outer = bms_union(rinfo->clause_relids, baserel->lateral_relids);
+        required_outer = bms_del_member(required_outer, baserel->relid);
+        if (bms_is_empty(required_outer))
+            continue;
 
-    Form_pg_operator operform = (Form_pg_operator) GETSTRUCT(opertup);
-    bool is_equality = (operform->oprresult == BOOLOID &&
-                        strcmp(NameStr(operform->oprname), "=") == 0);
-    ReleaseSysCache(opertup);
+        bool seen = false;
+        ListCell *oc;
+        foreach(oc, outer_sets) {
+            if (bms_equal((Relids) lfirst(oc), required_outer)) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen)
+            outer_sets = lappend(outer_sets, required_outer);
+    }
 
-    if (!is_equality)
-        return false;
+    foreach(cell, outer_sets) {
+        Relids required_outer = (Relids) lfirst(cell);
+        ParamPathInfo *ppi = get_baserel_parampathinfo(root, baserel, required_outer);
+
+        std::vector<bool> param_bound = bound;
+        ListCell *pc;
+        foreach(pc, ppi->ppi_clauses) {
+            RestrictInfo *rinfo = lfirst_node(RestrictInfo, pc);
+            AttrNumber attnum;
+            if (identity_equality_operand(root, rinfo->clause, baserel,
+                                          identity_attnums, &attnum) != NULL)
+                param_bound[capture_of(attnum)] = true;
+        }
+        if (leading_bound_captures(param_bound, prefix_captures) <= base_leading)
+            continue;
 
-    Expr *left = (Expr *) linitial(op->args);
-    Expr *right = (Expr *) lsecond(op->args);
+        Selectivity selectivity = clauselist_selectivity(root, ppi->ppi_clauses,
+                                                         baserel->relid,
+                                                         JOIN_INNER, NULL);
+        double keys = clamp_row_est(rel_keys * selectivity);
+        Cost startup_cost = random_page_cost;
+        Cost total_cost = startup_cost + keys * 0.01 + ppi->ppi_rows * cpu_tuple_cost;
+
+        add_path(baserel, (Path *)
+                 create_foreignscan_path(root, baserel,
+                                        NULL,
+                                        ppi->ppi_rows,
+                                        0,
+                                        startup_cost,
+                                        total_cost,
+                                        NIL,
+                                        required_outer,
+                                        NULL,
+                                        NIL,
+                                        NIL));
+    }
+}
 
-    /* Look for Var = Const pattern (either direction) */
-    Var *var = NULL;
-    Const *constval = NULL;
+/**
+ * Add a path that reads the table's secondary index (see
+ * get_secondary_index) for quals on an indexed column, then looks up the
+ * rows it names one by one.
+ *
+ * The column whose quals match the fewest rows is used. Each match costs
+ * an index entry read and a row lookup, a seek plus the row's keys (or
+ * gets, with fixed_attrs); rows can only be looked up by seeking when
+ * every capture precedes {attr}, so other tables need fixed_attrs.
+ * Entries may be stale, so every qual stays in place for the recheck.
+ */
+static void
+add_index_path(PlannerInfo *root, RelOptInfo *baserel, Oid foreigntableid,
+               const LevelPivotRelInfo *relinfo)
+{
+    ForeignTable *table = GetForeignTable(foreigntableid);
+    std::string key_pattern = get_table_option(table, "key_pattern");
+    if (key_pattern.empty() || get_table_option(table, "index_attrs").empty())
+        return;
 
-    if (IsA(left, Var) && IsA(right, Const)) {
-        var = (Var *) left;
-        constval = (Const *) right;
-    } else if (IsA(left, Const) && IsA(right, Var)) {
-        var = (Var *) right;
-        constval = (Const *) left;
-    } else {
-        return false;
+    level_pivot::KeyPattern pattern(key_pattern);
+    if (!get_fixed_attrs_option(table) &&
+        level_pivot::captures_before_attr(pattern) != pattern.capture_names().size())
+        return;
+
+    Relation rel = table_open(foreigntableid, NoLock);
+    std::unique_ptr<level_pivot::SecondaryIndex> index =
+        get_secondary_index(table, rel, pattern);
+    std::vector<AttrNumber> index_attnums;
+    std::vector<bool> text_columns;
+    for (const auto& attr : index->attrs()) {
+        AttrNumber attnum = find_column_attnum(rel, attr.c_str());
+        Oid typid = TupleDescAttr(RelationGetDescr(rel), attnum - 1)->atttypid;
+        index_attnums.push_back(attnum);
+        text_columns.push_back(typid == TEXTOID || typid == VARCHAROID);
     }
+    table_close(rel, NoLock);
 
-    /* Check if var is from this relation */
-    if (var->varno != baserel->relid)
-        return false;
+    /* The quals each column's index entries can answer */
+    std::vector<List *> index_clauses(index_attnums.size(), NIL);
+    ListCell *cell;
+    foreach(cell, baserel->baserestrictinfo) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        List *pred = extract_attr_predicate(rinfo->clause, baserel, index_attnums);
+        if (pred == NIL)
+            continue;
+        size_t i = std::find(index_attnums.begin(), index_attnums.end(),
+                             intVal(linitial(pred))) - index_attnums.begin();
+        if (index_answers(static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred))),
+                          text_columns[i]))
+            index_clauses[i] = lappend(index_clauses[i], rinfo);
+    }
 
-    /* Check if this is an identity column */
-    bool is_identity = false;
-    for (AttrNumber id_attnum : identity_attnums) {
-        if (var->varattno == id_attnum) {
-            is_identity = true;
-            break;
+    AttrNumber best_attnum = InvalidAttrNumber;
+    double best_matches = 0;
+    for (size_t i = 0; i < index_attnums.size(); i++) {
+        if (index_clauses[i] == NIL)
+            continue;
+        Selectivity selectivity = clauselist_selectivity(root, index_clauses[i],
+                                                         baserel->relid,
+                                                         JOIN_INNER, NULL);
+        double matches = clamp_row_est(relinfo->rows * selectivity);
+        if (best_attnum == InvalidAttrNumber || matches < best_matches) {
+            best_attnum = index_attnums[i];
+            best_matches = matches;
         }
     }
-    if (!is_identity)
+    if (best_attnum == InvalidAttrNumber)
+        return;
+
+    double keys_per_row = relinfo->keys / std::max(relinfo->rows, 1.0);
+    double lookup_keys = level_pivot::PivotScanner::SEEK_COST_IN_NEXTS + keys_per_row;
+    Cost startup_cost = 10 + best_matches * 0.01;
+    Cost total_cost = startup_cost + best_matches * lookup_keys * 0.01 +
+                      baserel->rows * cpu_tuple_cost;
+
+    add_path(baserel, (Path *)
+             create_foreignscan_path(root, baserel,
+                                    NULL,
+                                    baserel->rows,
+                                    0,
+                                    startup_cost,
+                                    total_cost,
+                                    NIL,     /* rows come in lookup order */
+                                    baserel->lateral_relids,
+                                    NULL,
+                                    NIL,
+                                    list_make2(makeBoolean(false),  /* not reverse */
+                                               makeInteger(best_attnum))));
+}
+
+/**
+ * Capture index of the identity column expr refers to, or -1 if expr
+ * isn't an identity column of rel
+ */
+static int
+identity_capture(Expr *expr, RelOptInfo *rel,
+                 const std::vector<AttrNumber>& identity_attnums)
+{
+    while (expr != NULL && IsA(expr, RelabelType))
+        expr = ((RelabelType *) expr)->arg;
+
+    if (expr == NULL || !IsA(expr, Var))
+        return -1;
+
+    Var *var = (Var *) expr;
+    if (var->varno != rel->relid || var->varlevelsup != 0 || var->varattno <= 0)
+        return -1;
+
+    auto pos = std::find(identity_attnums.begin(), identity_attnums.end(), var->varattno);
+    return pos == identity_attnums.end() ? -1 : pos - identity_attnums.begin();
+}
+
+/**
+ * True if expr is count(*) or count(identity column) with no DISTINCT,
+ * ORDER BY or FILTER: the number of rows in its group, since identities
+ * are never NULL
+ */
+static bool
+is_pushable_count(Expr *expr, RelOptInfo *rel,
+                  const std::vector<AttrNumber>& identity_attnums)
+{
+    if (!IsA(expr, Aggref))
         return false;
 
-    /* Must not be NULL */
-    if (constval->constisnull)
+    Aggref *agg = (Aggref *) expr;
+    if (agg->aggdistinct != NIL || agg->aggorder != NIL || agg->aggfilter != NULL ||
+        agg->agglevelsup != 0 || agg->aggkind != AGGKIND_NORMAL ||
+        agg->aggsplit != AGGSPLIT_SIMPLE)
         return false;
 
-    /* Convert Datum to string based on type */
-    char *value = NULL;
-    Oid typid = constval->consttype;
+    if (agg->aggfnoid == F_COUNT_)
+        return agg->aggstar;
+    if (agg->aggfnoid != F_COUNT_ANY || list_length(agg->args) != 1)
+        return false;
 
-    if (typid == TEXTOID || typid == VARCHAROID || typid == BPCHAROID) {
-        value = TextDatumGetCString(constval->constvalue);
-    } else if (typid == INT4OID) {
-        int32 intval = DatumGetInt32(constval->constvalue);
-        value = psprintf("%d", intval);
-    } else if (typid == INT8OID) {
-        int64 intval = DatumGetInt64(constval->constvalue);
-        value = psprintf("%ld", (long) intval);
-    } else {
-        /* For other types, use output function */
-        Oid typoutput;
-        bool typIsVarlena;
-        getTypeOutputInfo(typid, &typoutput, &typIsVarlena);
-        value = OidOutputFunctionCall(typoutput, constval->constvalue);
+    TargetEntry *arg = linitial_node(TargetEntry, agg->args);
+    return identity_capture(arg->expr, rel, identity_attnums) >= 0;
+}
+
+/**
+ * The identity predicates all of rel's quals amount to, when every qual
+ * is an = or IN on the captures before {attr}, they bind a leading run of
+ * them, each once, and stay within the range cap of build_identity_ranges.
+ * The capture right after the run may also carry one prefix (LIKE
+ * 'prefix%', starts_with). The prefix and every = or IN value must pass
+ * prefix_selects_exactly(): 'a##b' as a group's value would also match
+ * the keys of group 'a', id 'b'.
+ * The key ranges then select exactly the rows the quals accept, so a path
+ * can leave nothing above the scan to drop rows.
+ *
+ * @param predicates Output: the quals as FdwScanPrivatePredicates entries
+ * @return false if some qual isn't settled by the key ranges
+ */
+static bool
+exact_identity_predicates(RelOptInfo *rel, const std::vector<AttrNumber>& identity_attnums,
+                          const level_pivot::KeyPattern& pattern, List **predicates)
+{
+    size_t prefix_captures = level_pivot::captures_before_attr(pattern);
+    std::vector<bool> bound(identity_attnums.size(), false);
+    double combinations = 1;
+    int prefix_capture = -1;
+    *predicates = NIL;
+
+    ListCell *cell;
+    foreach(cell, rel->baserestrictinfo) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        if (rinfo->pseudoconstant)
+            return false;
+
+        List *pred = extract_attr_predicate(rinfo->clause, rel, identity_attnums);
+        if (pred == NIL)
+            return false;
+        auto op = static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred)));
+        size_t capture = std::find(identity_attnums.begin(), identity_attnums.end(),
+                                   (AttrNumber) intVal(linitial(pred))) -
+                         identity_attnums.begin();
+        if (capture >= prefix_captures)
+            return false;
+
+        if (op == level_pivot::AttrFilterOp::PREFIX) {
+            std::string prefix;
+            bool exact;
+            extract_prefix_predicate(rinfo->clause, rel, identity_attnums, &prefix, &exact);
+            if (!exact || prefix_capture >= 0 ||
+                !level_pivot::prefix_selects_exactly(pattern, capture, prefix))
+                return false;
+            prefix_capture = static_cast<int>(capture);
+            *predicates = lappend(*predicates, pred);
+            continue;
+        }
+
+        if (op != level_pivot::AttrFilterOp::EQ && op != level_pivot::AttrFilterOp::IN)
+            return false;
+        if (bound[capture])
+            return false;
+        /* A value holding the delimiter after it would reach other rows */
+        ListCell *vc;
+        for_each_from(vc, pred, 2) {
+            if (!level_pivot::prefix_selects_exactly(pattern, capture, strVal(lfirst(vc))))
+                return false;
+        }
+        bound[capture] = true;
+        combinations *= list_length(pred) - 2;
+        *predicates = lappend(*predicates, pred);
     }
 
-    *out_attnum = var->varattno;
-    *out_value = value;
-    return true;
+    size_t leading = leading_bound_captures(bound, prefix_captures);
+    size_t bound_count = static_cast<size_t>(std::count(bound.begin(), bound.end(), true));
+    return leading == bound_count &&
+           (prefix_capture < 0 || static_cast<size_t>(prefix_capture) == leading) &&
+           combinations <= level_pivot::MAX_IDENTITY_RANGES;
 }
 
 /**
- * Extract raw key predicate from a comparison clause.
+ * True if all of a raw table's quals are key comparisons that
+ * RawScanBounds applies exactly: one =, or any number of bounds and
+ * prefixes (LIKE 'prefix%', starts_with), compared bytewise (text or
+ * varchar key, C collation for ranges)
+ */
+static bool
+exact_raw_key_predicates(RelOptInfo *rel, Relation relation)
+{
+    AttrNumber key_attnum = find_column_attnum(relation, "key");
+    if (key_attnum == InvalidAttrNumber)
+        return rel->baserestrictinfo == NIL;
+
+    Form_pg_attribute key_attr = TupleDescAttr(RelationGetDescr(relation), key_attnum - 1);
+    if (key_attr->atttypid != TEXTOID && key_attr->atttypid != VARCHAROID)
+        return rel->baserestrictinfo == NIL;
+
+    bool has_equal = false;
+    bool has_range = false;
+    ListCell *cell;
+    foreach(cell, rel->baserestrictinfo) {
+        RestrictInfo *rinfo = lfirst_node(RestrictInfo, cell);
+        int strategy;
+        char *value;
+        std::string prefix;
+        bool exact;
+        if (rinfo->pseudoconstant)
+            return false;
+
+        if (extract_raw_key_prefix(rinfo->clause, rel, key_attnum, &prefix, &exact)) {
+            if (!exact)
+                return false;
+            has_range = true;
+            continue;
+        }
+        if (!extract_raw_key_predicate(rinfo->clause, rel, key_attnum, &strategy, &value))
+            return false;
+        pfree(value);
+
+        /* Bounds intersect, but a second = would replace the first */
+        bool equal = strategy == BTEqualStrategyNumber;
+        if ((equal && has_equal) ||
+            !attr_filter_comparable(key_attr->atttypid,
+                                    ((OpExpr *) rinfo->clause)->inputcollid,
+                                    !equal))
+            return false;
+        (equal ? has_equal : has_range) = true;
+    }
+    return !(has_equal && has_range);
+}
+
+/**
+ * Add a path computing a pivot table's aggregates from its keys, for
+ * queries like SELECT group_name, count(*) ... GROUP BY group_name.
  *
- * For raw tables, we support predicates on the 'key' column:
- *   - key = 'value' (exact match)
- *   - key > 'value', key >= 'value' (lower bound)
- *   - key < 'value', key <= 'value' (upper bound)
+ * Applies when every aggregate is a row count (is_pushable_count), the
+ * GROUP BY columns are exactly the first k captures before {attr}, and
+ * every WHERE clause is an = or IN on the leading captures: there are no
+ * quals above the scan to drop rows, so the key ranges must select
+ * exactly the matching rows. GroupCounter then counts identities without
+ * building rows. Anything else (HAVING, grouping sets, other aggregates
+ * or expressions) is left to the Agg node.
  *
- * @param clause The expression to check
- * @param baserel The relation being scanned
- * @param key_attnum Attribute number of the 'key' column
- * @param strategy Output: BTLessStrategyNumber, BTLessEqualStrategyNumber,
- *                 BTEqualStrategyNumber, BTGreaterEqualStrategyNumber, or BTGreaterStrategyNumber
- * @param value Output: the constant value (must be pfree'd by caller)
- * @return true if this is a pushable key predicate
+ * The path reads the same keys as the scan it replaces but produces one
+ * tuple per group.
  */
-static bool
-extract_raw_key_predicate(Expr *clause, RelOptInfo *baserel,
-                          AttrNumber key_attnum,
-                          int *strategy, char **value)
+static void
+add_aggregate_path(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *grouped_rel,
+                   GroupPathExtraData *extra)
 {
-    /* Must be an OpExpr */
-    if (!IsA(clause, OpExpr))
-        return false;
+    Query *parse = root->parse;
+    if (parse->groupingSets != NIL || root->hasHavingQual || parse->hasTargetSRFs ||
+        extra->patype != PARTITIONWISE_AGGREGATE_NONE ||
+        input_rel->reloptkind != RELOPT_BASEREL || input_rel->lateral_relids != NULL ||
+        IS_DUMMY_REL(input_rel))
+        return;
 
-    OpExpr *op = (OpExpr *) clause;
+    RangeTblEntry *rte = planner_rt_fetch(input_rel->relid, root);
+    LevelPivotRelInfo *relinfo = (LevelPivotRelInfo *) input_rel->fdw_private;
+    if (rte->inh || relinfo == NULL)
+        return;
 
-    /* Must have exactly 2 arguments */
-    if (list_length(op->args) != 2)
-        return false;
+    ForeignTable *table = GetForeignTable(rte->relid);
+    std::string key_pattern = get_table_option(table, "key_pattern");
+    if (get_table_mode(table) != TableMode::PIVOT || key_pattern.empty())
+        return;
 
-    /* Look up the operator */
-    HeapTuple opertup = SearchSysCache1(OPEROID, ObjectIdGetDatum(op->opno));
-    if (!HeapTupleIsValid(opertup))
-        return false;
+    level_pivot::KeyPattern pattern(key_pattern);
+    size_t prefix_captures = level_pivot::captures_before_attr(pattern);
+    Relation rel = table_open(rte->relid, NoLock);
+    std::vector<AttrNumber> identity_attnums = identity_attnums_in_pattern_order(rel, pattern);
+    table_close(rel, NoLock);
 
-    Form_pg_operator operform = (Form_pg_operator) GETSTRUCT(opertup);
+    List *predicates = NIL;
+    if (!exact_identity_predicates(input_rel, identity_attnums, pattern, &predicates))
+        return;
 
-    /* Check if result is boolean */
-    if (operform->oprresult != BOOLOID) {
-        ReleaseSysCache(opertup);
-        return false;
+    /* GROUP BY must name the first group_captures captures */
+    std::vector<bool> grouped(identity_attnums.size(), false);
+    List *group_exprs = NIL;
+    ListCell *cell;
+    foreach(cell, parse->groupClause) {
+        SortGroupClause *sgc = lfirst_node(SortGroupClause, cell);
+        Expr *expr = (Expr *) get_sortgroupclause_expr(sgc, parse->targetList);
+        int capture = identity_capture(expr, input_rel, identity_attnums);
+        if (capture < 0 || static_cast<size_t>(capture) >= prefix_captures)
+            return;
+        grouped[capture] = true;
+        group_exprs = lappend(group_exprs, expr);
     }
+    size_t group_captures = leading_bound_captures(grouped, prefix_captures);
+    if (static_cast<size_t>(std::count(grouped.begin(), grouped.end(), true)) !=
+        group_captures)
+        return;
 
-    /* Determine strategy from operator name */
-    const char *oprname = NameStr(operform->oprname);
-    int strat = 0;
-    bool swap_operands = false;
+    /* Outputs: grouping columns and counts only */
+    PathTarget *target = root->upper_targets[UPPERREL_GROUP_AGG];
+    List *outputs = NIL;
+    foreach(cell, target->exprs) {
+        Expr *expr = (Expr *) lfirst(cell);
+        int capture = identity_capture(expr, input_rel, identity_attnums);
+        if (capture >= 0 && static_cast<size_t>(capture) < group_captures)
+            outputs = lappend(outputs, makeInteger(capture));
+        else if (is_pushable_count(expr, input_rel, identity_attnums))
+            outputs = lappend(outputs, makeInteger(-1));
+        else
+            return;
+    }
 
-    if (strcmp(oprname, "=") == 0)
-        strat = BTEqualStrategyNumber;
-    else if (strcmp(oprname, "<") == 0)
-        strat = BTLessStrategyNumber;
-    else if (strcmp(oprname, "<=") == 0)
-        strat = BTLessEqualStrategyNumber;
-    else if (strcmp(oprname, ">") == 0)
-        strat = BTGreaterStrategyNumber;
-    else if (strcmp(oprname, ">=") == 0)
-        strat = BTGreaterEqualStrategyNumber;
-    else {
-        ReleaseSysCache(opertup);
-        return false;
+    double groups = group_captures == 0 ? 1 :
+        estimate_num_groups(root, group_exprs, input_rel->rows, NULL, NULL);
+    Cost startup_cost = 10;
+    Cost total_cost = startup_cost + relinfo->keys * 0.01 + groups * cpu_tuple_cost;
+
+    ForeignServer *server = GetForeignServer(table->serverid);
+    bool bulk_scan = predicates == NIL &&
+        (double) input_rel->pages * BLCKSZ >
+            (double) get_server_options(server).block_cache_size;
+
+    List *fdw_private = list_make4(predicates, makeInteger((int) group_captures),
+                                   outputs, makeBoolean(bulk_scan));
+
+    add_path(grouped_rel, (Path *)
+             create_foreign_upper_path(root, grouped_rel,
+                                       target,
+                                       groups,
+                                       0,       /* disabled_nodes */
+                                       startup_cost,
+                                       total_cost,
+                                       NIL,     /* no pathkeys */
+                                       NULL,    /* no extra plan */
+                                       NIL,     /* no fdw_restrictinfo */
+                                       fdw_private));
+}
+
+/**
+ * Add a path applying the query's LIMIT and OFFSET inside the scan, for
+ * queries like SELECT ... WHERE group_name = 'x' ORDER BY id LIMIT 10.
+ *
+ * Applies to a query on this table alone, with no grouping, DISTINCT or
+ * locking, when the scan settles every qual exactly (so each row it
+ * returns is a row of the result) and returns rows in the ORDER BY order,
+ * forwards or backwards. The scan then skips the OFFSET rows without
+ * building tuples, returns the LIMIT rows and lets go of its iterator,
+ * with no Limit node above. The plan is the same base-rel ForeignScan as
+ * any other, with the LIMIT and OFFSET expressions appended to fdw_exprs;
+ * the path's fdw_private is (reverse, scan relid).
+ */
+static void
+add_limit_path(PlannerInfo *root, RelOptInfo *final_rel, FinalPathExtraData *extra)
+{
+    Query *parse = root->parse;
+    if (!extra->limit_needed || parse->commandType != CMD_SELECT ||
+        parse->limitOption == LIMIT_OPTION_WITH_TIES || parse->rowMarks != NIL ||
+        parse->hasAggs || parse->hasWindowFuncs || parse->hasTargetSRFs ||
+        parse->groupClause != NIL || parse->groupingSets != NIL ||
+        parse->distinctClause != NIL || root->hasHavingQual ||
+        root->hasPseudoConstantQuals ||
+        bms_membership(root->all_baserels) != BMS_SINGLETON)
+        return;
+
+    RelOptInfo *baserel = find_base_rel(root, bms_singleton_member(root->all_baserels));
+    LevelPivotRelInfo *relinfo = (LevelPivotRelInfo *) baserel->fdw_private;
+    if (baserel->reloptkind != RELOPT_BASEREL || baserel->lateral_relids != NULL ||
+        IS_DUMMY_REL(baserel) || baserel->fdwroutine != final_rel->fdwroutine ||
+        relinfo == NULL)
+        return;
+
+    RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
+    if (rte->inh)
+        return;
+
+    /* System columns would need fsSystemCol, which only base rels get */
+    PathTarget *target = root->upper_targets[UPPERREL_FINAL];
+    List *vars = pull_var_clause((Node *) target->exprs, PVC_RECURSE_PLACEHOLDERS);
+    ListCell *cell;
+    foreach(cell, vars) {
+        if (IsA(lfirst(cell), Var) && ((Var *) lfirst(cell))->varattno < 0)
+            return;
+    }
+
+    ForeignTable *table = GetForeignTable(rte->relid);
+    Relation rel = table_open(rte->relid, NoLock);
+    bool exact;
+    if (get_table_mode(table) == TableMode::RAW) {
+        exact = exact_raw_key_predicates(baserel, rel);
+    } else {
+        std::string key_pattern = get_table_option(table, "key_pattern");
+        exact = false;
+        if (!key_pattern.empty()) {
+            level_pivot::KeyPattern pattern(key_pattern);
+            List *predicates;
+            exact = exact_identity_predicates(
+                baserel, identity_attnums_in_pattern_order(rel, pattern), pattern,
+                &predicates);
+        }
+    }
+    table_close(rel, NoLock);
+    if (!exact)
+        return;
+
+    /* The scan has to produce the ORDER BY order itself */
+    bool reverse = false;
+    if (root->sort_pathkeys != NIL &&
+        !pathkeys_contained_in(root->sort_pathkeys,
+                               scan_pathkeys(root, baserel, rte->relid, false))) {
+        if (!pathkeys_contained_in(root->sort_pathkeys,
+                                   scan_pathkeys(root, baserel, rte->relid, true)))
+            return;
+        reverse = true;
     }
 
-    ReleaseSysCache(opertup);
+    /* count_est and offset_est are 0 when absent, -1 when not constant */
+    double offset = extra->offset_est > 0 ? (double) extra->offset_est : 0;
+    double count = extra->count_est > 0 ? (double) extra->count_est : baserel->rows;
+    double fetched = Min(baserel->rows, offset + count);
+    double rows = clamp_row_est(fetched - Min(offset, fetched));
+
+    /* Skipped rows cost their keys but no tuples */
+    double keys_per_row = relinfo->keys / clamp_row_est(baserel->rows);
+    double key_cost = reverse ? 0.015 : 0.01;
+    Cost startup_cost = 10 + Min(offset, fetched) * keys_per_row * key_cost;
+    Cost total_cost = 10 + fetched * keys_per_row * key_cost + rows * cpu_tuple_cost;
+
+    add_path(final_rel, (Path *)
+             create_foreign_upper_path(root, final_rel,
+                                       target,
+                                       rows,
+                                       0,       /* disabled_nodes */
+                                       startup_cost,
+                                       total_cost,
+                                       root->sort_pathkeys,
+                                       NULL,    /* no extra plan */
+                                       NIL,     /* no fdw_restrictinfo */
+                                       list_make2(makeBoolean(reverse),
+                                                  makeInteger(baserel->relid))));
+}
 
-    Expr *left = (Expr *) linitial(op->args);
-    Expr *right = (Expr *) lsecond(op->args);
+/**
+ * The table an aggregate scan reads. With scanrelid 0 the executor
+ * doesn't open it; it is the plan's only base rel.
+ */
+static Oid
+aggregate_scan_relid(ForeignScanState *node)
+{
+    ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+    int rtindex = bms_next_member(fsplan->fs_base_relids, -1);
+    return exec_rt_fetch(rtindex, node->ss.ps.state)->relid;
+}
 
-    /* Look for Var op Const pattern (either direction) */
-    Var *var = NULL;
-    Const *constval = NULL;
+/**
+ * BeginForeignScan for a pushed-down aggregate: count the rows in the
+ * identity key ranges with a GroupCounter
+ */
+static void
+begin_aggregate_scan(ForeignScanState *node)
+{
+    EState *estate = node->ss.ps.state;
+    ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+    Oid relid = aggregate_scan_relid(node);
+    ForeignTable *table = GetForeignTable(relid);
+    ForeignServer *server = GetForeignServer(table->serverid);
 
-    if (IsA(left, Var) && IsA(right, Const)) {
-        var = (Var *) left;
-        constval = (Const *) right;
-    } else if (IsA(left, Const) && IsA(right, Var)) {
-        var = (Var *) right;
-        constval = (Const *) left;
-        swap_operands = true;
-    } else {
-        return false;
+    MemoryContext scan_ctx = AllocSetContextCreate(estate->es_query_cxt,
+                                                   "level_pivot scan",
+                                                   ALLOCSET_DEFAULT_SIZES);
+    auto state = level_pivot::pg_construct<AggregateScanState>(scan_ctx);
+
+    Relation rel = table_open(relid, NoLock);
+    state->projection = acquire_projection(rel, get_table_option(table, "key_pattern"));
+    table_close(rel, NoLock);
+
+    state->connection = level_pivot::ConnectionManager::instance()
+        .get_connection(server->serverid, get_server_options(server));
+    state->temp_context = AllocSetContextCreate(scan_ctx,
+                                                "level_pivot temp",
+                                                ALLOCSET_DEFAULT_SIZES);
+
+    const level_pivot::KeyParser& parser = state->projection->parser();
+    state->counter = std::make_unique<level_pivot::GroupCounter>(
+        parser, state->connection,
+        intVal(list_nth(fsplan->fdw_private, FdwAggPrivateGroupCaptures)));
+    state->counter->set_scan_options(get_scan_options(table,
+        boolVal(list_nth(fsplan->fdw_private, FdwAggPrivateBulkScan))));
+
+    state->ranges = level_pivot::build_identity_ranges(parser,
+        build_identity_constraints(
+            (List *) list_nth(fsplan->fdw_private, FdwAggPrivatePredicates),
+            *state->projection));
+
+    const auto& capture_names = parser.pattern().capture_names();
+    ListCell *lc;
+    foreach(lc, (List *) list_nth(fsplan->fdw_private, FdwAggPrivateOutputs)) {
+        int capture = intVal(lfirst(lc));
+        state->outputs.push_back(capture);
+        state->output_converters.push_back(capture < 0 ? nullptr :
+            level_pivot::TypeConverter::converter_for(
+                state->projection->column(capture_names[capture])->type));
     }
 
-    /* Check if var is from this relation and is the key column */
-    if (var->varno != baserel->relid || var->varattno != key_attnum)
-        return false;
+    /* Read from the statement's snapshot, rescans included */
+    use_statement_snapshot(estate, state->connection);
 
-    /* Must not be NULL */
-    if (constval->constisnull)
-        return false;
+    state->counter->begin_scan(state->ranges);
+    state->metrics.scans++;
+    node->fdw_state = state;
+}
 
-    /* If operands were swapped, flip the comparison direction */
-    if (swap_operands) {
-        switch (strat) {
-            case BTLessStrategyNumber:
-                strat = BTGreaterStrategyNumber;
-                break;
-            case BTLessEqualStrategyNumber:
-                strat = BTGreaterEqualStrategyNumber;
-                break;
-            case BTGreaterStrategyNumber:
-                strat = BTLessStrategyNumber;
-                break;
-            case BTGreaterEqualStrategyNumber:
-                strat = BTLessEqualStrategyNumber;
-                break;
-            /* BTEqualStrategyNumber stays the same */
+/**
+ * Fill slot with the next group's columns and count, or leave it empty
+ * when there are no more groups
+ */
+static void
+next_aggregate_row(AggregateScanState *state, TupleTableSlot *slot)
+{
+    const level_pivot::GroupCount *group = state->counter->next_group();
+    if (group == nullptr)
+        return;
+
+    /* The slot's values stay valid until the next group */
+    MemoryContextReset(state->temp_context);
+    MemoryContext oldctx = MemoryContextSwitchTo(state->temp_context);
+
+    Datum *values = slot->tts_values;
+    bool *nulls = slot->tts_isnull;
+    for (size_t i = 0; i < state->outputs.size(); i++) {
+        int capture = state->outputs[i];
+        if (capture < 0) {
+            values[i] = Int64GetDatum(group->count);
+            nulls[i] = false;
+        } else {
+            values[i] = state->output_converters[i](group->group_values[capture]);
+            nulls[i] = false;
         }
     }
 
-    /* Convert Datum to string */
-    char *val = NULL;
-    Oid typid = constval->consttype;
+    MemoryContextSwitchTo(oldctx);
+    ExecStoreVirtualTuple(slot);
+}
 
-    if (typid == TEXTOID || typid == VARCHAROID || typid == BPCHAROID) {
-        val = TextDatumGetCString(constval->constvalue);
+/* ANALYZE reads a run of this many rows at each sampled position */
+constexpr int ANALYZE_ROWS_PER_SEEK = 5;
+
+/* Tables estimated below targrows times this are sampled by a full scan */
+constexpr double ANALYZE_FULL_SCAN_FACTOR = 10;
+
+/**
+ * Reservoir of sample rows for ANALYZE.
+ *
+ * Uses Vitter's reservoir algorithm via PostgreSQL's sampling helpers,
+ * the same way file_fdw and postgres_fdw fill their samples.
+ */
+struct AnalyzeSample {
+    HeapTuple *rows;
+    int targrows;
+    int numrows;
+    double samplerows;  /* Rows offered to the reservoir so far */
+    double rowstoskip;
+    ReservoirStateData rstate;
+};
+
+static void
+analyze_sample_init(AnalyzeSample *sample, HeapTuple *rows, int targrows)
+{
+    sample->rows = rows;
+    sample->targrows = targrows;
+    sample->numrows = 0;
+    sample->samplerows = 0;
+    sample->rowstoskip = -1;
+    reservoir_init_selection_state(&sample->rstate, targrows);
+}
+
+/* Offer one row to the reservoir; the tuple is formed in CurrentMemoryContext */
+static void
+analyze_sample_add(AnalyzeSample *sample, TupleDesc tupdesc, Datum *values, bool *nulls)
+{
+    int pos = -1;
+
+    if (sample->numrows < sample->targrows) {
+        pos = sample->numrows++;
     } else {
-        /* For other types, use output function */
-        Oid typoutput;
-        bool typIsVarlena;
-        getTypeOutputInfo(typid, &typoutput, &typIsVarlena);
-        val = OidOutputFunctionCall(typoutput, constval->constvalue);
+        if (sample->rowstoskip < 0)
+            sample->rowstoskip = reservoir_get_next_S(&sample->rstate,
+                                                      sample->samplerows,
+                                                      sample->targrows);
+        if (sample->rowstoskip <= 0) {
+            pos = (int) (sample->targrows * sampler_random_fract(&sample->rstate.randstate));
+            heap_freetuple(sample->rows[pos]);
+        }
+        sample->rowstoskip -= 1;
     }
 
-    *strategy = strat;
-    *value = val;
-    return true;
+    if (pos >= 0)
+        sample->rows[pos] = heap_form_tuple(tupdesc, values, nulls);
+
+    sample->samplerows += 1;
 }
 
-/**
- * Build RawScanBounds from fdw_private list.
- *
- * fdw_private format for raw tables:
- *   - First element: Integer marker (-1 for raw mode)
- *   - Subsequent pairs: (strategy, value) for each predicate
+/*
+ * Number of seek positions for a sampled ANALYZE, or 0 to scan everything.
+ * Exact or small estimates mean a full scan is cheap and unbiased.
  */
-static level_pivot::RawScanBounds
-build_raw_bounds_from_fdw_private(List *fdw_private)
+static int
+analyze_seek_count(const level_pivot::SizeEstimate& est, int targrows)
 {
-    level_pivot::RawScanBounds bounds;
+    if (est.exact || est.rows <= targrows * ANALYZE_FULL_SCAN_FACTOR)
+        return 0;
+    return (targrows + ANALYZE_ROWS_PER_SEEK - 1) / ANALYZE_ROWS_PER_SEEK;
+}
 
-    if (fdw_private == NIL)
-        return bounds;
+/*
+ * Stratified seek fraction: one random position within the i-th of n
+ * equal slices of the data, so the sample covers the whole key range.
+ */
+static double
+analyze_seek_fraction(AnalyzeSample *sample, int i, int n)
+{
+    return (i + sampler_random_fract(&sample->rstate.randstate)) / n;
+}
 
-    ListCell *cell = list_head(fdw_private);
+/*
+ * C++ state of one ANALYZE sample pass. It is built with pg_construct in
+ * the pass's memory context rather than on the stack: vacuum_delay_point()
+ * and the type input functions can ereport out of the pass, and the
+ * context's reset callback then still closes the scanner's iterator and
+ * drops the connection when the aborted transaction frees the context.
+ */
+struct PivotSampleState {
+    std::shared_ptr<level_pivot::LevelDBConnection> connection;
+    std::unique_ptr<level_pivot::Projection> projection;
+    std::optional<level_pivot::KeyspaceSampler> keyspace;
+    std::optional<level_pivot::PivotScanner> scanner;
+};
 
-    /* Skip the mode marker */
-    if (cell != NULL) {
-        int marker = intVal(lfirst(cell));
-        if (marker != -1)
-            return bounds;  /* Not a raw mode private list */
-        cell = lnext(fdw_private, cell);
-    }
+struct RawSampleState {
+    std::shared_ptr<level_pivot::LevelDBConnection> connection;
+    std::optional<level_pivot::KeyspaceSampler> keyspace;
+    std::optional<level_pivot::RawScanner> scanner;
+    level_pivot::RawScanBounds bounds;
+    std::string last_key;
+};
 
-    /* Process (strategy, value) pairs */
-    while (cell != NULL)
-    {
-        int strategy = intVal(lfirst(cell));
-        cell = lnext(fdw_private, cell);
-        if (cell == NULL)
-            break;
-        char *value = strVal(lfirst(cell));
-        cell = lnext(fdw_private, cell);
+/**
+ * Sample a pivot table for ANALYZE.
+ *
+ * Small tables are scanned in full. Large ones are sampled by seeking the
+ * PivotScanner to stratified random positions in the key space (located
+ * with KeyspaceSampler) and reading a short run of rows at each, so ANALYZE
+ * reads roughly targrows rows instead of the whole table.
+ */
+static int
+acquire_pivot_sample_rows(Relation rel, ForeignTable *table, ForeignServer *server,
+                          AnalyzeSample *sample, double *totalrows)
+{
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    MemoryContext sample_ctx = CurrentMemoryContext;
+    MemoryContext state_ctx = AllocSetContextCreate(sample_ctx,
+                                                    "level_pivot analyze",
+                                                    ALLOCSET_DEFAULT_SIZES);
+    MemoryContext temp_ctx = AllocSetContextCreate(state_ctx,
+                                                   "level_pivot analyze rows",
+                                                   ALLOCSET_DEFAULT_SIZES);
+    auto state = level_pivot::pg_construct<PivotSampleState>(state_ctx);
+
+    state->connection = level_pivot::ConnectionManager::instance()
+        .get_connection(server->serverid, get_server_options(server));
+    state->projection = build_projection_from_relation(
+        rel, get_table_option(table, "key_pattern"));
+    const level_pivot::Projection& projection = *state->projection;
+
+    level_pivot::SizeEstimate est = level_pivot::SizeEstimator(state->connection)
+        .estimate_pivot(projection.parser(), {});
+
+    int seeks = analyze_seek_count(est, sample->targrows);
+    if (seeks > 0)
+        state->keyspace = level_pivot::KeyspaceSampler::for_prefix(
+            state->connection, projection.parser().build_prefix());
+
+    DatumTempArray values(tupdesc->natts);
+    BoolTempArray nulls(tupdesc->natts);
+
+    /* Convert in the temp context, then copy into a sample tuple */
+    auto add_row = [&](const level_pivot::PivotRow& row) {
+        MemoryContext oldctx = MemoryContextSwitchTo(temp_ctx);
+        memset(nulls.data(), true, tupdesc->natts * sizeof(bool));
+        level_pivot::DatumBuilder::build_datums(row, projection,
+                                                 values.data(), nulls.data());
+        MemoryContextSwitchTo(oldctx);
+
+        analyze_sample_add(sample, tupdesc, values.data(), nulls.data());
+        MemoryContextReset(temp_ctx);
+    };
+
+    level_pivot::PivotScanner& scanner = state->scanner.emplace(projection, state->connection);
+    scanner.begin_scan();
+
+    if (!state->keyspace) {
+        while (auto row = scanner.next_row()) {
+            vacuum_delay_point(true);
+            add_row(*row);
+        }
+        *totalrows = sample->samplerows;
+    } else {
+        for (int i = 0; i < seeks; i++) {
+            vacuum_delay_point(true);
+            scanner.seek_to(state->keyspace->key_at(analyze_seek_fraction(sample, i, seeks)));
 
-        switch (strategy) {
-            case BTEqualStrategyNumber:
-                bounds.exact_key = std::string(value);
-                break;
-            case BTLessStrategyNumber:
-                bounds.upper_bound = std::string(value);
-                bounds.upper_inclusive = false;
-                break;
-            case BTLessEqualStrategyNumber:
-                bounds.upper_bound = std::string(value);
-                bounds.upper_inclusive = true;
-                break;
-            case BTGreaterStrategyNumber:
-                bounds.lower_bound = std::string(value);
-                bounds.lower_inclusive = false;
-                break;
-            case BTGreaterEqualStrategyNumber:
-                bounds.lower_bound = std::string(value);
-                bounds.lower_inclusive = true;
-                break;
+            for (int n = 0; n < ANALYZE_ROWS_PER_SEEK; n++) {
+                auto row = scanner.next_row();
+                if (!row)
+                    break;
+                add_row(*row);
+            }
         }
+        *totalrows = std::max(est.rows, sample->samplerows);
     }
 
-    return bounds;
+    scanner.end_scan();
+    MemoryContextDelete(state_ctx);
+    return sample->numrows;
 }
 
 /**
- * Find the attribute number of a column by name in a relation.
+ * Sample a raw table for ANALYZE.
+ *
+ * Same strategy as pivot tables; each seek restarts the RawScanner with a
+ * lower bound, skipping positions we have already read past.
  */
-static AttrNumber
-find_column_attnum(Relation rel, const char *name)
+static int
+acquire_raw_sample_rows(Relation rel, ForeignServer *server,
+                        AnalyzeSample *sample, double *totalrows)
 {
     TupleDesc tupdesc = RelationGetDescr(rel);
-    for (int i = 0; i < tupdesc->natts; i++) {
-        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
-        if (attr->attisdropped)
-            continue;
-        if (strcmp(NameStr(attr->attname), name) == 0)
-            return attr->attnum;
+    AttrNumber key_attnum = find_column_attnum(rel, "key");
+    AttrNumber value_attnum = find_column_attnum(rel, "value");
+
+    MemoryContext sample_ctx = CurrentMemoryContext;
+    MemoryContext state_ctx = AllocSetContextCreate(sample_ctx,
+                                                    "level_pivot analyze",
+                                                    ALLOCSET_DEFAULT_SIZES);
+    MemoryContext temp_ctx = AllocSetContextCreate(state_ctx,
+                                                   "level_pivot analyze rows",
+                                                   ALLOCSET_DEFAULT_SIZES);
+    auto state = level_pivot::pg_construct<RawSampleState>(state_ctx);
+
+    state->connection = level_pivot::ConnectionManager::instance()
+        .get_connection(server->serverid, get_server_options(server));
+
+    level_pivot::SizeEstimate est = level_pivot::SizeEstimator(state->connection)
+        .estimate_raw(level_pivot::RawScanBounds{});
+
+    int seeks = analyze_seek_count(est, sample->targrows);
+    if (seeks > 0)
+        state->keyspace = level_pivot::KeyspaceSampler::for_prefix(state->connection, "");
+
+    DatumTempArray values(tupdesc->natts);
+    BoolTempArray nulls(tupdesc->natts);
+
+    auto add_row = [&](const level_pivot::RawRow& row) {
+        MemoryContext oldctx = MemoryContextSwitchTo(temp_ctx);
+        memset(nulls.data(), true, tupdesc->natts * sizeof(bool));
+        if (key_attnum != InvalidAttrNumber) {
+            values[key_attnum - 1] = varlena_datum(row.key);
+            nulls[key_attnum - 1] = false;
+        }
+        if (value_attnum != InvalidAttrNumber) {
+            values[value_attnum - 1] = varlena_datum(row.value);
+            nulls[value_attnum - 1] = false;
+        }
+        MemoryContextSwitchTo(oldctx);
+
+        analyze_sample_add(sample, tupdesc, values.data(), nulls.data());
+        MemoryContextReset(temp_ctx);
+    };
+
+    level_pivot::RawScanner& scanner = state->scanner.emplace(state->connection);
+
+    if (!state->keyspace) {
+        scanner.begin_scan(state->bounds);
+        while (auto row = scanner.next_row()) {
+            vacuum_delay_point(true);
+            add_row(*row);
+        }
+        *totalrows = sample->samplerows;
+    } else {
+        bool have_last = false;
+
+        for (int i = 0; i < seeks; i++) {
+            vacuum_delay_point(true);
+
+            level_pivot::RawScanBounds& bounds = state->bounds;
+            bounds.lower_bound = state->keyspace->key_at(analyze_seek_fraction(sample, i, seeks));
+            bounds.lower_inclusive = true;
+            if (have_last && *bounds.lower_bound <= state->last_key) {
+                bounds.lower_bound = state->last_key;
+                bounds.lower_inclusive = false;
+            }
+            scanner.begin_scan(bounds);
+
+            for (int n = 0; n < ANALYZE_ROWS_PER_SEEK; n++) {
+                auto row = scanner.next_row();
+                if (!row)
+                    break;
+                add_row(*row);
+                state->last_key = row->key;
+                have_last = true;
+            }
+        }
+        *totalrows = std::max(est.rows, sample->samplerows);
     }
-    return InvalidAttrNumber;
+
+    scanner.end_scan();
+    MemoryContextDelete(state_ctx);
+    return sample->numrows;
 }
 
 } // anonymous namespace
@@ -708,37 +3819,80 @@ find_column_attnum(Relation rel, const char *name)
 extern "C" {
 
 /*
- * GetForeignRelSize - Estimate row count for query planning.
+ * GetForeignRelSize - Estimate row count and width for query planning.
+ *
+ * The scan range is narrowed by the same predicates GetForeignPlan pushes
+ * down (leading identity equalities in pivot mode, key bounds in raw mode).
+ * SizeEstimator combines LevelDB's approximate size of that range with a
+ * short sampled scan to estimate keys, rows and widths; see table_stats.cpp.
+ * Estimates are cached per backend for a short time so that repeated
+ * planning doesn't re-sample. Quals that aren't pushed down scale the row
+ * count via clauselist_selectivity.
  *
- * PostgreSQL uses this for cost estimation. A more accurate estimate
- * would sample LevelDB, but 1000 is a reasonable default that doesn't
- * add overhead. The actual row count doesn't affect correctness.
+ * If LevelDB can't be read at plan time we keep the old 1000-row guess
+ * rather than failing the plan; BeginForeignScan will report the error.
  */
 void
 levelPivotGetForeignRelSize(PlannerInfo *root,
                             RelOptInfo *baserel,
                             Oid foreigntableid)
 {
-    baserel->rows = 1000;  /* TODO: could sample for better estimates */
+    LevelPivotRelInfo *relinfo = (LevelPivotRelInfo *) palloc0(sizeof(LevelPivotRelInfo));
+    relinfo->keys = 1000;
+    relinfo->rows = 1000;
+    baserel->fdw_private = relinfo;
+    baserel->rows = 1000;
+
+    PG_TRY_CPP({
+        estimate_rel_size(root, baserel, foreigntableid, relinfo);
+    });
 }
 
 /*
- * GetForeignPaths - Create access path for the foreign table.
+ * GetForeignPaths - Create access paths for the foreign table.
+ *
+ * The main path scans the range left by the pushed-down quals. Pivot
+ * tables also get parameterized paths for equality joins on identity
+ * columns (see add_parameterized_paths): inside a nested loop each outer
+ * row's values become a key prefix to seek to, like an index lookup.
  *
- * Currently we only support sequential scan. Future optimization could add:
- *   - Index path when filtering on identity columns (uses LevelDB prefix seek)
- *   - Parameterized paths for nested loop joins
+ * Cost model: startup_cost + (keys * per_key_cost) + (rows * cpu_tuple_cost)
+ * The scan visits every LevelDB key in the range, so iteration cost follows
+ * the key estimate from GetForeignRelSize; pivot rows span several keys.
+ * The per_key_cost (0.01) is a rough estimate for LevelDB iteration.
  *
- * Cost model: startup_cost + (rows * per_row_cost)
- * The per_row_cost (0.01) is a rough estimate for LevelDB iteration.
+ * The main path is sorted by the leading identity columns (raw tables: by
+ * key) where their order is bytewise; see scan_pathkeys. ORDER BY, merge
+ * joins and GroupAggregate on them then need no Sort, and a LIMIT above
+ * the scan stops it after the rows it needs. A second path scans
+ * backwards for descending orders (its fdw_private is the Boolean
+ * FdwScanPrivateReverse), so "latest N" queries read only N rows.
+ *
+ * Pivot tables with index_attrs also get a path that reads the secondary
+ * index for quals on an indexed column; see add_index_path.
+ *
+ * Pivot tables also get a partial path for parallel plans when the rel is
+ * parallel-safe. Its costs are divided among participants the same way
+ * PostgreSQL divides parallel seq scan costs.
  */
 void
 levelPivotGetForeignPaths(PlannerInfo *root,
                           RelOptInfo *baserel,
                           Oid foreigntableid)
 {
+    LevelPivotRelInfo *relinfo = (LevelPivotRelInfo *) baserel->fdw_private;
+    double keys = relinfo ? relinfo->keys : baserel->rows;
+
     Cost startup_cost = 10;
-    Cost total_cost = startup_cost + baserel->rows * 0.01;
+    Cost total_cost = startup_cost + keys * 0.01 + baserel->rows * cpu_tuple_cost;
+
+    /* Rows come out in key order, so sorting on it is free */
+    List *pathkeys = NIL;
+    List *reverse_pathkeys = NIL;
+    PG_TRY_CPP({
+        pathkeys = scan_pathkeys(root, baserel, foreigntableid, false);
+        reverse_pathkeys = scan_pathkeys(root, baserel, foreigntableid, true);
+    });
 
     add_path(baserel, (Path *)
              create_foreignscan_path(root, baserel,
@@ -747,23 +3901,131 @@ levelPivotGetForeignPaths(PlannerInfo *root,
                                     0,       /* disabled_nodes */
                                     startup_cost,
                                     total_cost,
-                                    NIL,     /* no pathkeys (unsorted) */
+                                    pathkeys,
                                     baserel->lateral_relids,
                                     NULL,    /* no extra plan */
                                     NIL,     /* no fdw_restrictinfo */
                                     NIL));   /* no fdw_private yet */
+
+    /* The same scan backwards; LevelDB's prev() costs more than next() */
+    if (reverse_pathkeys != NIL) {
+        add_path(baserel, (Path *)
+                 create_foreignscan_path(root, baserel,
+                                        NULL,
+                                        baserel->rows,
+                                        0,
+                                        startup_cost,
+                                        startup_cost + keys * 0.015 +
+                                            baserel->rows * cpu_tuple_cost,
+                                        reverse_pathkeys,
+                                        baserel->lateral_relids,
+                                        NULL,
+                                        NIL,
+                                        list_make1(makeBoolean(true))));  /* reverse */
+    }
+
+    if (get_table_mode(GetForeignTable(foreigntableid)) == TableMode::PIVOT) {
+        PG_TRY_CPP({
+            add_parameterized_paths(root, baserel, foreigntableid, keys);
+            if (relinfo)
+                add_index_path(root, baserel, foreigntableid, relinfo);
+        });
+    }
+
+    if (!baserel->consider_parallel || baserel->lateral_relids != NULL ||
+        get_table_mode(GetForeignTable(foreigntableid)) != TableMode::PIVOT)
+        return;
+
+    int workers = compute_parallel_worker(baserel, baserel->pages, -1,
+                                          max_parallel_workers_per_gather);
+    if (workers <= 0)
+        return;
+
+    /* Matches get_parallel_divisor() in costsize.c */
+    double divisor = workers;
+    if (parallel_leader_participation) {
+        double leader_contribution = 1.0 - (0.3 * workers);
+        if (leader_contribution > 0)
+            divisor += leader_contribution;
+    }
+
+    double partial_rows = clamp_row_est(baserel->rows / divisor);
+    Cost partial_total = startup_cost + (keys * 0.01) / divisor +
+                         partial_rows * cpu_tuple_cost;
+
+    ForeignPath *partial = create_foreignscan_path(root, baserel,
+                                                   NULL,
+                                                   partial_rows,
+                                                   0,
+                                                   startup_cost,
+                                                   partial_total,
+                                                   NIL,
+                                                   NULL,
+                                                   NULL,
+                                                   NIL,
+                                                   NIL);
+    partial->path.parallel_aware = true;
+    partial->path.parallel_safe = true;
+    partial->path.parallel_workers = workers;
+    add_partial_path(baserel, (Path *) partial);
+}
+
+/*
+ * GetForeignUpperPaths - Push simple aggregates and LIMIT into the scan.
+ *
+ * count(*), alone or grouped by leading identity columns, is answered by
+ * counting identities in the key ranges without building any rows; see
+ * add_aggregate_path for when that applies. The resulting ForeignScan has
+ * scanrelid 0 and outputs the grouping columns and counts directly.
+ *
+ * LIMIT and OFFSET are applied by the scan itself when every row it
+ * returns belongs to the result, in order; see add_limit_path.
+ */
+void
+levelPivotGetForeignUpperPaths(PlannerInfo *root,
+                               UpperRelationKind stage,
+                               RelOptInfo *input_rel,
+                               RelOptInfo *output_rel,
+                               void *extra)
+{
+    if (stage == UPPERREL_GROUP_AGG) {
+        PG_TRY_CPP({
+            add_aggregate_path(root, input_rel, output_rel, (GroupPathExtraData *) extra);
+        });
+    } else if (stage == UPPERREL_FINAL) {
+        PG_TRY_CPP({
+            add_limit_path(root, output_rel, (FinalPathExtraData *) extra);
+        });
+    }
 }
 
 /*
  * GetForeignPlan - Build the final scan plan with pushed-down predicates.
  *
  * This is where filter pushdown happens. We scan WHERE clauses looking for:
- *   - Pivot mode: "identity_column = constant" (uses LevelDB prefix seek)
+ *   - Pivot mode: "identity_column = constant", IN lists and ranges (uses
+ *     one LevelDB seek per key range)
  *   - Raw mode: "key op constant" where op is =, <, <=, >, >= (uses seek + bounds)
  *
- * Pushed predicates are stored in fdw_private for use by BeginForeignScan:
- *   - Pivot mode: [(attnum, value), ...] pairs
- *   - Raw mode: [-1, (strategy, value), ...] with BTStrategy constants
+ * Pushed predicates are stored in fdw_private for use by BeginForeignScan
+ * (see FdwScanPrivateIndex for the layout):
+ *   - Pivot mode: [(attnum, op, value...), ...] for =, IN and ranges on
+ *     identity columns, which BeginForeignScan turns into key ranges
+ *   - Raw mode: [(strategy, value), ...] with BTStrategy constants
+ *
+ * In pivot mode "identity_column = expression" clauses whose value is
+ * only known at run time (nestloop Params of a parameterized path) put
+ * the expression in fdw_exprs and its column in fdw_private; the scan
+ * re-evaluates them on every rescan.
+ *
+ * In pivot mode fdw_private also lists the columns the query needs, so
+ * the scan can skip copying and converting the others, and the attr column
+ * predicates the scanner can check before building tuples. Both modes
+ * record whether the scan is a bulk scan: no key predicates, and a table
+ * estimated larger than the server's block cache.
+ *
+ * A path from add_limit_path is planned as a scan of its base rel, plus
+ * the LIMIT and OFFSET expressions at the end of fdw_exprs.
  *
  * Non-pushable predicates remain in scan_clauses for PostgreSQL to evaluate.
  */
@@ -777,7 +4039,48 @@ levelPivotGetForeignPlan(PlannerInfo *root,
                          Plan *outer_plan)
 {
     Index scan_relid = baserel->relid;
-    List *fdw_private = NIL;
+    List *predicates = NIL;
+    List *needed_attrs = NIL;
+    List *attr_filters = NIL;
+    List *param_attnums = NIL;
+    List *fdw_exprs = NIL;
+
+    /*
+     * Pushed-down LIMIT: a plain scan of the base rel (add_limit_path made
+     * sure its quals all reach the scanner exactly) that also evaluates
+     * the LIMIT and OFFSET
+     */
+    if (IS_UPPER_REL(baserel) && baserel == fetch_upper_rel(root, UPPERREL_FINAL, NULL)) {
+        RelOptInfo *scanrel = find_base_rel(root, intVal(lsecond(best_path->fdw_private)));
+        Query *parse = root->parse;
+        ForeignScan *plan = levelPivotGetForeignPlan(root, scanrel,
+                                                     planner_rt_fetch(scanrel->relid, root)->relid,
+                                                     best_path, tlist,
+                                                     scanrel->baserestrictinfo,
+                                                     outer_plan);
+        Node *no_value = (Node *) makeNullConst(INT8OID, -1, InvalidOid);
+        plan->fdw_exprs = lappend(plan->fdw_exprs,
+                                  parse->limitCount ? parse->limitCount : no_value);
+        plan->fdw_exprs = lappend(plan->fdw_exprs,
+                                  parse->limitOffset ? parse->limitOffset : no_value);
+        lfirst(list_nth_cell(plan->fdw_private, FdwScanPrivateLimit)) = makeBoolean(true);
+        return plan;
+    }
+
+    /*
+     * Pushed-down aggregate: no base rel is scanned, the tuples are the
+     * path's target (grouping columns and counts); fdw_private comes from
+     * add_aggregate_path
+     */
+    if (IS_UPPER_REL(baserel))
+        return make_foreignscan(tlist,
+                               NIL,
+                               0,
+                               NIL,
+                               best_path->fdw_private,
+                               make_tlist_from_pathtarget(best_path->path.pathtarget),
+                               NIL,
+                               outer_plan);
 
     ForeignTable *table = GetForeignTable(foreigntableid);
     TableMode mode = get_table_mode(table);
@@ -792,9 +4095,6 @@ levelPivotGetForeignPlan(PlannerInfo *root,
         table_close(rel, NoLock);
 
         if (key_attnum != InvalidAttrNumber) {
-            /* Mark this as raw mode with -1 */
-            fdw_private = lappend(fdw_private, makeInteger(-1));
-
             /* Extract key predicates from scan_clauses */
             ListCell *cell;
             foreach(cell, scan_clauses) {
@@ -803,10 +4103,17 @@ levelPivotGetForeignPlan(PlannerInfo *root,
 
                 int strategy;
                 char *value;
+                std::string prefix;
+                bool exact;
                 if (extract_raw_key_predicate(clause, baserel, key_attnum,
                                               &strategy, &value)) {
-                    fdw_private = lappend(fdw_private, makeInteger(strategy));
-                    fdw_private = lappend(fdw_private, makeString(pstrdup(value)));
+                    predicates = lappend(predicates, makeInteger(strategy));
+                    predicates = lappend(predicates, makeString(pstrdup(value)));
+                } else if (extract_raw_key_prefix(clause, baserel, key_attnum,
+                                                  &prefix, &exact)) {
+                    /* The clause itself stays in the quals for the recheck */
+                    predicates = lappend(predicates, makeInteger(RAW_KEY_PREFIX_STRATEGY));
+                    predicates = lappend(predicates, makeString(pstrdup(prefix.c_str())));
                 }
             }
         }
@@ -824,21 +4131,28 @@ levelPivotGetForeignPlan(PlannerInfo *root,
             Relation rel = table_open(rte->relid, NoLock);
             TupleDesc tupdesc = RelationGetDescr(rel);
 
-            /* Collect attnums of identity columns */
+            /* Collect attnums of identity and attr columns */
             std::vector<AttrNumber> identity_attnums;
+            std::vector<AttrNumber> attr_attnums;
             for (int i = 0; i < tupdesc->natts; i++) {
                 Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
                 if (attr->attisdropped)
                     continue;
 
                 std::string col_name = NameStr(attr->attname);
+                bool is_identity = false;
                 for (const auto& cap_name : capture_names) {
                     if (col_name == cap_name) {
-                        identity_attnums.push_back(attr->attnum);
+                        is_identity = true;
                         break;
                     }
                 }
+                if (is_identity)
+                    identity_attnums.push_back(attr->attnum);
+                else
+                    attr_attnums.push_back(attr->attnum);
             }
+            needed_attrs = needed_column_attnums(baserel, scan_clauses, tupdesc->natts);
             table_close(rel, NoLock);
 
             /* Extract pushable equality conditions from scan_clauses */
@@ -851,10 +4165,43 @@ levelPivotGetForeignPlan(PlannerInfo *root,
                 char *value;
                 if (is_pushable_equality(clause, baserel, identity_attnums,
                                          &attnum, &value)) {
-                    /* Store (attnum, value) pair in fdw_private */
-                    fdw_private = lappend(fdw_private, makeInteger(attnum));
-                    fdw_private = lappend(fdw_private, makeString(pstrdup(value)));
+                    predicates = lappend(predicates, list_make3(
+                        makeInteger(attnum),
+                        makeInteger(static_cast<int>(level_pivot::AttrFilterOp::EQ)),
+                        makeString(pstrdup(value))));
+                    continue;
                 }
+
+                /*
+                 * Join clauses of parameterized paths (and other computed
+                 * values) are evaluated at scan time and bind the column
+                 */
+                Expr *param_expr = identity_equality_operand(root, clause, baserel,
+                                                             identity_attnums, &attnum);
+                if (param_expr != NULL) {
+                    param_attnums = lappend(param_attnums, makeInteger(attnum));
+                    fdw_exprs = lappend(fdw_exprs, param_expr);
+                    continue;
+                }
+
+                /* IN lists and ranges on identity columns become key ranges */
+                List *identity_pred = extract_attr_predicate(clause, baserel,
+                                                             identity_attnums);
+                if (identity_pred != NIL) {
+                    auto op = static_cast<level_pivot::AttrFilterOp>(
+                        intVal(lsecond(identity_pred)));
+                    /* Identities are never NULL; leave null tests alone */
+                    if (op != level_pivot::AttrFilterOp::IS_NULL &&
+                        op != level_pivot::AttrFilterOp::IS_NOT_NULL)
+                        predicates = lappend(predicates, identity_pred);
+                    continue;
+                }
+
+                /* Attr predicates are checked by the scanner on raw values */
+                List *attr_pred = extract_attr_predicate(clause, baserel,
+                                                         attr_attnums);
+                if (attr_pred != NIL)
+                    attr_filters = lappend(attr_filters, attr_pred);
             }
         }
     }
@@ -862,10 +4209,33 @@ levelPivotGetForeignPlan(PlannerInfo *root,
     /* Remove pseudoconstant clauses - all clauses still checked by PostgreSQL */
     scan_clauses = extract_actual_clauses(scan_clauses, false);
 
+    /*
+     * An index path of this rel (add_index_path) names its column; the
+     * LIMIT path's private list, passed down above, is (reverse, relid)
+     */
+    int index_attnum = 0;
+    if (best_path->path.parent == baserel && list_length(best_path->fdw_private) > 1)
+        index_attnum = intVal(lsecond(best_path->fdw_private));
+
+    /* Reading all of a table that doesn't fit would only churn the cache */
+    ForeignServer *server = GetForeignServer(table->serverid);
+    bool bulk_scan = predicates == NIL && param_attnums == NIL && index_attnum == 0 &&
+        (double) baserel->pages * BLCKSZ >
+            (double) get_server_options(server).block_cache_size;
+
+    bool reverse = best_path->fdw_private != NIL &&
+        boolVal(linitial(best_path->fdw_private));
+
+    List *fdw_private = list_make5(predicates, needed_attrs, attr_filters,
+                                   makeBoolean(bulk_scan), param_attnums);
+    fdw_private = lappend(fdw_private, makeBoolean(reverse));
+    fdw_private = lappend(fdw_private, makeBoolean(false));  /* no LIMIT */
+    fdw_private = lappend(fdw_private, makeInteger(index_attnum));
+
     return make_foreignscan(tlist,
                            scan_clauses,
                            scan_relid,
-                           NIL,         /* no expressions to evaluate */
+                           fdw_exprs,   /* identity values bound at scan time */
                            fdw_private, /* pushed filter info */
                            NIL,         /* no custom tlist */
                            NIL,         /* no remote quals */
@@ -889,6 +4259,13 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
     if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
         return;
 
+    if (((ForeignScan *) node->ss.ps.plan)->scan.scanrelid == 0) {
+        PG_TRY_CPP({
+            begin_aggregate_scan(node);
+        });
+        return;
+    }
+
     PG_TRY_CPP({
         EState *estate = node->ss.ps.state;
         Relation rel = node->ss.ss_currentRelation;
@@ -908,6 +4285,7 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
         if (mode == TableMode::RAW) {
             /* Raw mode: use RawScanner */
             auto state = level_pivot::pg_construct<RawScanState>(scan_ctx);
+            state->mode = TableMode::RAW;
 
             /* Get connection */
             state->connection = level_pivot::ConnectionManager::instance()
@@ -916,17 +4294,28 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
             /* Create scanner */
             state->scanner = std::make_unique<level_pivot::RawScanner>(
                 state->connection);
+            state->scanner->set_scan_options(get_plan_scan_options(table, fsplan));
+            state->scanner->set_reverse(
+                boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateReverse)));
+            state->timing = scan_timing(node);
+            state->scanner->set_timing(state->timing);
 
-            /* Create temp memory context */
-            state->temp_context = AllocSetContextCreate(scan_ctx,
-                                                        "level_pivot temp",
-                                                        ALLOCSET_DEFAULT_SIZES);
+            /* Find key and value columns once rather than per row */
+            state->key_attnum = find_column_attnum(rel, "key");
+            state->value_attnum = find_column_attnum(rel, "value");
 
-            /* Build bounds from fdw_private */
-            state->bounds = build_raw_bounds_from_fdw_private(fsplan->fdw_private);
+            init_scan_limit(state, node);
+
+            /* Build bounds from pushed-down key predicates */
+            state->bounds = build_raw_bounds_from_predicates(
+                (List *) list_nth(fsplan->fdw_private, FdwScanPrivatePredicates));
+
+            /* Read from the statement's snapshot, rescans included */
+            use_statement_snapshot(estate, state->connection);
 
             /* Begin scan with bounds */
             state->scanner->begin_scan(state->bounds);
+            state->metrics.scans++;
 
             node->fdw_state = state;
         } else {
@@ -936,7 +4325,7 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
             auto state = level_pivot::pg_construct<LevelPivotScanState>(scan_ctx);
 
             /* Build projection from table definition */
-            state->projection = build_projection_from_relation(rel, key_pattern);
+            state->projection = acquire_projection(rel, key_pattern);
 
             /* Get connection */
             state->connection = level_pivot::ConnectionManager::instance()
@@ -945,18 +4334,73 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
             /* Create scanner */
             state->scanner = std::make_unique<level_pivot::PivotScanner>(
                 *state->projection, state->connection);
+            state->scanner->set_scan_options(get_plan_scan_options(table, fsplan));
+            state->scanner->set_reverse(
+                boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateReverse)));
+            state->timing = scan_timing(node);
+            state->scanner->set_timing(state->timing);
 
             /* Create temp memory context as child of scan context */
             state->temp_context = AllocSetContextCreate(scan_ctx,
                                                         "level_pivot temp",
                                                         ALLOCSET_DEFAULT_SIZES);
 
-            /* Build prefix values from fdw_private for filter pushdown */
-            state->prefix_values = build_prefix_from_fdw_private(
-                fsplan->fdw_private, *state->projection);
+            /* Only copy and convert the columns the query reads */
+            state->projection->set_needed_columns(int_list_to_vector(
+                (List *) list_nth(fsplan->fdw_private, FdwScanPrivateNeededAttrs)));
+
+            /* Turn identity predicates into key ranges for the scan */
+            state->fixed_attrs = get_fixed_attrs_option(table);
+            state->constraints = build_identity_constraints(
+                (List *) list_nth(fsplan->fdw_private, FdwScanPrivatePredicates),
+                *state->projection);
+            plan_pivot_scan(state, state->constraints);
+
+            /* Join parameters bind more identity columns per outer row */
+            const auto& capture_names =
+                state->projection->parser().pattern().capture_names();
+            List *param_attnums = (List *) list_nth(fsplan->fdw_private,
+                                                    FdwScanPrivateParamAttnums);
+            ListCell *attnum_cell;
+            ListCell *expr_cell;
+            forboth(attnum_cell, param_attnums, expr_cell, fsplan->fdw_exprs)
+            {
+                Expr *expr = (Expr *) lfirst(expr_cell);
+                const level_pivot::ColumnDef *col =
+                    state->projection->column_by_attnum(intVal(lfirst(attnum_cell)));
+                if (col == nullptr)
+                    continue;
+                auto pos = std::find(capture_names.begin(), capture_names.end(),
+                                     col->name);
+                if (pos == capture_names.end())
+                    continue;
+
+                IdentityParam param;
+                bool is_varlena;
+                param.expr = ExecInitExpr(expr, (PlanState *) node);
+                getTypeOutputInfo(exprType((Node *) expr), &param.typoutput, &is_varlena);
+                param.capture = pos - capture_names.begin();
+                state->params.push_back(param);
+            }
+            state->econtext = node->ss.ps.ps_ExprContext;
+            init_scan_limit(state, node);
+
+            /* Rows failing attr predicates are dropped before conversion */
+            state->scanner->set_filter(build_attr_filter(
+                (List *) list_nth(fsplan->fdw_private, FdwScanPrivateAttrFilters),
+                *state->projection));
 
-            /* Begin scan with prefix filter */
-            state->scanner->begin_scan(state->prefix_values);
+            /* An index path finds its rows through the secondary index */
+            int index_attnum = intVal(list_nth(fsplan->fdw_private,
+                                               FdwScanPrivateIndexAttnum));
+            if (index_attnum != 0)
+                init_index_lookup(state, table, rel, fsplan, index_attnum);
+
+            /* Read from the statement's snapshot, rescans included */
+            use_statement_snapshot(estate, state->connection);
+
+            /* Begin scan over the pushed-down key ranges */
+            start_pivot_scan(state);
 
             node->fdw_state = state;
         }
@@ -970,6 +4414,7 @@ levelPivotBeginForeignScan(ForeignScanState *node, int eflags)
  *   - Uses temp_context that's reset per row (avoids palloc accumulation)
  *   - PivotScanner uses zero-copy string_views until row is complete
  *   - DatumBuilder pre-computes column index mappings
+ *   - Raw rows view the iterator; their varlenas are its bytes copied once
  *
  * Returns an empty slot (ExecClearTuple) to signal end of scan.
  */
@@ -977,25 +4422,51 @@ TupleTableSlot *
 levelPivotIterateForeignScan(ForeignScanState *node)
 {
     TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
-    Relation rel = node->ss.ss_currentRelation;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
 
     ExecClearTuple(slot);  /* Signal no more rows if we return early */
 
+    if (((ForeignScan *) node->ss.ps.plan)->scan.scanrelid == 0) {
+        auto state = static_cast<AggregateScanState *>(node->fdw_state);
+        PG_TRY_CPP_RETURN({
+            next_aggregate_row(state, slot);
+            return slot;
+        }, slot);
+    }
+
+    TableMode mode = static_cast<FdwStateBase *>(node->fdw_state)->mode;
+
     if (mode == TableMode::RAW) {
         /* Raw mode iteration */
         auto state = static_cast<RawScanState *>(node->fdw_state);
+        if (state->limit_pending)
+            bind_scan_limit(state, node->ss.ps.ps_ExprContext);
+
+        PG_TRY_CPP_RETURN({
+            /* Past the LIMIT: let go of the iterator and its blocks */
+            if (state->rows_left == 0) {
+                state->scanner->end_scan();
+                return slot;
+            }
+            for (; state->offset_left > 0; --state->offset_left) {
+                if (!state->scanner->next_row())
+                    break;
+            }
 
-        PG_TRY_CPP_RETURN({
             auto row = state->scanner->next_row();
             if (!row)
                 return slot;
+            if (state->rows_left > 0)
+                --state->rows_left;
+
+            /*
+             * Build tuple - raw tables have 2 columns: key, value. The
+             * varlenas are filled straight from the iterator's bytes in the
+             * per-tuple context, which the executor resets before fetching
+             * the next row.
+             */
+            MemoryContext oldctx = MemoryContextSwitchTo(
+                node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
 
-            /* Switch to temp context for value conversion */
-            MemoryContext oldctx = MemoryContextSwitchTo(state->temp_context);
-
-            /* Build tuple - raw tables have 2 columns: key, value */
             TupleDesc tupdesc = slot->tts_tupleDescriptor;
             Datum *values = slot->tts_values;
             bool *nulls = slot->tts_isnull;
@@ -1003,24 +4474,16 @@ levelPivotIterateForeignScan(ForeignScanState *node)
             /* Initialize all to NULL */
             memset(nulls, true, tupdesc->natts * sizeof(bool));
 
-            /* Find key and value columns and set their values */
-            for (int i = 0; i < tupdesc->natts; i++) {
-                Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
-                if (attr->attisdropped)
-                    continue;
-
-                const char *colname = NameStr(attr->attname);
-                if (strcmp(colname, "key") == 0) {
-                    values[i] = CStringGetTextDatum(row->key.c_str());
-                    nulls[i] = false;
-                } else if (strcmp(colname, "value") == 0) {
-                    values[i] = CStringGetTextDatum(row->value.c_str());
-                    nulls[i] = false;
-                }
+            if (state->key_attnum != InvalidAttrNumber) {
+                values[state->key_attnum - 1] = varlena_datum(row->key);
+                nulls[state->key_attnum - 1] = false;
+            }
+            if (state->value_attnum != InvalidAttrNumber) {
+                values[state->value_attnum - 1] = varlena_datum(row->value);
+                nulls[state->value_attnum - 1] = false;
             }
 
             MemoryContextSwitchTo(oldctx);
-            MemoryContextReset(state->temp_context);
 
             ExecStoreVirtualTuple(slot);
             return slot;
@@ -1028,13 +4491,28 @@ levelPivotIterateForeignScan(ForeignScanState *node)
     } else {
         /* Pivot mode iteration */
         auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+        if (state->limit_pending)
+            bind_scan_limit(state, node->ss.ps.ps_ExprContext);
 
         PG_TRY_CPP_RETURN({
-            auto row = state->scanner->next_row();
+            if (state->rows_left == 0) {
+                state->scanner->end_scan();
+                return slot;
+            }
+            /* OFFSET rows are assembled but never converted */
+            for (; state->offset_left > 0; --state->offset_left) {
+                if (!next_pivot_row(state))
+                    break;
+            }
+
+            auto row = next_pivot_row(state);
             if (!row)
                 return slot;
+            if (state->rows_left > 0)
+                --state->rows_left;
 
-            /* Switch to temp context for value conversion */
+            /* The slot's values stay valid until the next row */
+            MemoryContextReset(state->temp_context);
             MemoryContext oldctx = MemoryContextSwitchTo(state->temp_context);
 
             /* Build tuple */
@@ -1046,11 +4524,20 @@ levelPivotIterateForeignScan(ForeignScanState *node)
             memset(nulls, true, tupdesc->natts * sizeof(bool));
 
             /* Fill in values using DatumBuilder */
-            level_pivot::DatumBuilder::build_datums(*row, *state->projection,
-                                                     values, nulls);
+            if (state->timing) {
+                instr_time start;
+                instr_time end;
+                INSTR_TIME_SET_CURRENT(start);
+                level_pivot::DatumBuilder::build_datums(*row, *state->projection,
+                                                         values, nulls);
+                INSTR_TIME_SET_CURRENT(end);
+                INSTR_TIME_ACCUM_DIFF(state->convert_time, end, start);
+            } else {
+                level_pivot::DatumBuilder::build_datums(*row, *state->projection,
+                                                         values, nulls);
+            }
 
             MemoryContextSwitchTo(oldctx);
-            MemoryContextReset(state->temp_context);
 
             ExecStoreVirtualTuple(slot);
             return slot;
@@ -1065,19 +4552,32 @@ levelPivotIterateForeignScan(ForeignScanState *node)
 void
 levelPivotReScanForeignScan(ForeignScanState *node)
 {
-    Relation rel = node->ss.ss_currentRelation;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
+    if (((ForeignScan *) node->ss.ps.plan)->scan.scanrelid == 0) {
+        auto state = static_cast<AggregateScanState *>(node->fdw_state);
+        PG_TRY_CPP({
+            add_scan_counts(state->metrics, state->counter->stats());
+            state->metrics.scans++;
+            state->counter->begin_scan(state->ranges);
+        });
+        return;
+    }
+
+    TableMode mode = static_cast<FdwStateBase *>(node->fdw_state)->mode;
 
     if (mode == TableMode::RAW) {
         auto state = static_cast<RawScanState *>(node->fdw_state);
+        state->limit_pending = state->limit_count != nullptr;
         PG_TRY_CPP({
+            add_scan_counts(state->metrics, state->scanner->stats());
+            state->metrics.scans++;
             state->scanner->rescan();
         });
     } else {
         auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+        state->limit_pending = state->limit_count != nullptr;
         PG_TRY_CPP({
-            state->scanner->begin_scan(state->prefix_values);
+            start_pivot_scan(state);
+            state->shard_active = false;  /* Parallel: claim shards afresh */
         });
     }
 }
@@ -1092,20 +4592,202 @@ levelPivotEndForeignScan(ForeignScanState *node)
     if (!node->fdw_state)
         return;
 
-    Relation rel = node->ss.ss_currentRelation;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
+    if (((ForeignScan *) node->ss.ps.plan)->scan.scanrelid == 0) {
+        auto state = static_cast<AggregateScanState *>(node->fdw_state);
+        if (state->counter)
+            add_scan_counts(state->metrics, state->counter->stats());
+        record_table_metrics(aggregate_scan_relid(node), state->metrics);
+        state->cleanup();
+        node->fdw_state = nullptr;
+        return;
+    }
+
+    TableMode mode = static_cast<FdwStateBase *>(node->fdw_state)->mode;
+    Oid relid = RelationGetRelid(node->ss.ss_currentRelation);
 
     if (mode == TableMode::RAW) {
         auto state = static_cast<RawScanState *>(node->fdw_state);
+        if (state->scanner)
+            add_scan_counts(state->metrics, state->scanner->stats());
+        record_table_metrics(relid, state->metrics);
         state->cleanup();
     } else {
         auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+        if (state->scanner)
+            add_scan_counts(state->metrics, state->scanner->stats());
+        record_table_metrics(relid, state->metrics);
         state->cleanup();
     }
     node->fdw_state = nullptr;
 }
 
+/**
+ * Format (attnum, AttrFilterOp, value...) predicates for EXPLAIN, e.g.
+ * "status = 'active', id IN ('a', 'b')"
+ */
+static std::string
+describe_filter_predicates(List *filters, TupleDesc tupdesc)
+{
+    std::string desc;
+
+    ListCell *lc;
+    foreach(lc, filters) {
+        List *pred = (List *) lfirst(lc);
+        AttrNumber attnum = intVal(linitial(pred));
+        auto op = static_cast<level_pivot::AttrFilterOp>(intVal(lsecond(pred)));
+
+        if (!desc.empty())
+            desc += ", ";
+        desc += NameStr(TupleDescAttr(tupdesc, attnum - 1)->attname);
+        desc += " ";
+        desc += level_pivot::attr_filter_op_name(op);
+
+        bool is_list = op == level_pivot::AttrFilterOp::IN;
+        ListCell *vc;
+        if (is_list)
+            desc += " (";
+        for_each_from(vc, pred, 2) {
+            if (foreach_current_index(vc) > 2)
+                desc += ", ";
+            else if (!is_list)
+                desc += " ";
+            desc += "'";
+            desc += strVal(lfirst(vc));
+            desc += "'";
+        }
+        if (is_list)
+            desc += ")";
+    }
+
+    return desc;
+}
+
+/**
+ * Format raw key predicates ((strategy, value) pairs) for EXPLAIN, e.g.
+ * "key>='a', key<'b'"
+ */
+static std::string
+describe_raw_predicates(List *predicates)
+{
+    std::string bounds_desc;
+
+    ListCell *cell = list_head(predicates);
+    while (cell != NULL) {
+        int strategy = intVal(lfirst(cell));
+        cell = lnext(predicates, cell);
+        if (cell == NULL)
+            break;
+        char *value = strVal(lfirst(cell));
+        cell = lnext(predicates, cell);
+
+        const char *op;
+        switch (strategy) {
+            case BTEqualStrategyNumber:
+                op = "=";
+                break;
+            case BTLessStrategyNumber:
+                op = "<";
+                break;
+            case BTLessEqualStrategyNumber:
+                op = "<=";
+                break;
+            case BTGreaterStrategyNumber:
+                op = ">";
+                break;
+            case BTGreaterEqualStrategyNumber:
+                op = ">=";
+                break;
+            case RAW_KEY_PREFIX_STRATEGY:
+                op = "^@";
+                break;
+            default:
+                continue;
+        }
+
+        if (!bounds_desc.empty())
+            bounds_desc += ", ";
+        bounds_desc += "key";
+        bounds_desc += op;
+        bounds_desc += "'";
+        bounds_desc += value;
+        bounds_desc += "'";
+    }
+
+    return bounds_desc;
+}
+
+/**
+ * EXPLAIN output for a pushed-down aggregate, e.g.
+ *   Relations: Aggregate on (users)
+ *   LevelDB Group Key: group_name
+ */
+static void
+explain_aggregate_scan(ForeignScanState *node, ExplainState *es)
+{
+    auto state = static_cast<AggregateScanState *>(node->fdw_state);
+    ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+    Oid relid = aggregate_scan_relid(node);
+    ForeignTable *table = GetForeignTable(relid);
+
+    Relation rel = table_open(relid, NoLock);
+    std::string relations = "Aggregate on (";
+    relations += RelationGetRelationName(rel);
+    relations += ")";
+    ExplainPropertyText("Relations", relations.c_str(), es);
+
+    level_pivot::KeyPattern pattern(get_table_option(table, "key_pattern"));
+    int group_captures = intVal(list_nth(fsplan->fdw_private, FdwAggPrivateGroupCaptures));
+    if (group_captures > 0) {
+        std::string keys;
+        for (int i = 0; i < group_captures; i++) {
+            if (!keys.empty())
+                keys += ", ";
+            keys += pattern.capture_names()[i];
+        }
+        ExplainPropertyText("LevelDB Group Key", keys.c_str(), es);
+    }
+
+    List *predicates = (List *) list_nth(fsplan->fdw_private, FdwAggPrivatePredicates);
+    if (predicates != NIL) {
+        std::string filters = describe_filter_predicates(predicates, RelationGetDescr(rel));
+        ExplainPropertyText("LevelDB Identity Filter", filters.c_str(), es);
+    }
+    table_close(rel, NoLock);
+
+    if (state && state->counter) {
+        const auto& stats = state->counter->stats();
+        ExplainPropertyInteger("LevelDB Keys Scanned", NULL, stats.keys_scanned, es);
+        ExplainPropertyInteger("LevelDB Rows Counted", NULL, stats.rows_counted, es);
+        if (stats.seeks > 0)
+            ExplainPropertyInteger("LevelDB Row Seeks", NULL, stats.seeks, es);
+    }
+
+    if (!get_scan_options(table,
+            boolVal(list_nth(fsplan->fdw_private, FdwAggPrivateBulkScan))).fill_cache)
+        ExplainPropertyBool("LevelDB Fill Cache", false, es);
+}
+
+/**
+ * EXPLAIN output for a pushed-down LIMIT: its constant values, e.g.
+ *   LevelDB Limit: 10
+ *   LevelDB Offset: 20
+ * or "parameter" for values only known at run time
+ */
+static void
+explain_scan_limit(ForeignScan *fsplan, ExplainState *es)
+{
+    int nexprs = list_length(fsplan->fdw_exprs);
+    const char *labels[] = {"LevelDB Limit", "LevelDB Offset"};
+    for (int i = 0; i < 2; i++) {
+        Node *expr = (Node *) list_nth(fsplan->fdw_exprs, nexprs - 2 + i);
+        if (!IsA(expr, Const))
+            ExplainPropertyText(labels[i], "parameter", es);
+        else if (!((Const *) expr)->constisnull)
+            ExplainPropertyInteger(labels[i], NULL,
+                                   DatumGetInt64(((Const *) expr)->constvalue), es);
+    }
+}
+
 /*
  * ExplainForeignScan
  *      Print additional EXPLAIN output
@@ -1113,6 +4795,11 @@ levelPivotEndForeignScan(ForeignScanState *node)
 void
 levelPivotExplainForeignScan(ForeignScanState *node, ExplainState *es)
 {
+    if (((ForeignScan *) node->ss.ps.plan)->scan.scanrelid == 0) {
+        explain_aggregate_scan(node, es);
+        return;
+    }
+
     Relation rel = node->ss.ss_currentRelation;
     ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
     TableMode mode = get_table_mode(table);
@@ -1122,108 +4809,71 @@ levelPivotExplainForeignScan(ForeignScanState *node, ExplainState *es)
         /* Raw mode: show key bounds */
         auto state = static_cast<RawScanState *>(node->fdw_state);
 
-        if (fsplan->fdw_private != NIL) {
-            List *fdw_private = fsplan->fdw_private;
-            ListCell *cell = list_head(fdw_private);
-
-            /* Check for raw mode marker */
-            if (cell != NULL && intVal(lfirst(cell)) == -1) {
-                cell = lnext(fdw_private, cell);
-
-                std::string bounds_desc;
-                while (cell != NULL) {
-                    int strategy = intVal(lfirst(cell));
-                    cell = lnext(fdw_private, cell);
-                    if (cell == NULL)
-                        break;
-                    char *value = strVal(lfirst(cell));
-                    cell = lnext(fdw_private, cell);
-
-                    if (!bounds_desc.empty())
-                        bounds_desc += ", ";
-
-                    switch (strategy) {
-                        case BTEqualStrategyNumber:
-                            bounds_desc += "key='";
-                            bounds_desc += value;
-                            bounds_desc += "'";
-                            break;
-                        case BTLessStrategyNumber:
-                            bounds_desc += "key<'";
-                            bounds_desc += value;
-                            bounds_desc += "'";
-                            break;
-                        case BTLessEqualStrategyNumber:
-                            bounds_desc += "key<='";
-                            bounds_desc += value;
-                            bounds_desc += "'";
-                            break;
-                        case BTGreaterStrategyNumber:
-                            bounds_desc += "key>'";
-                            bounds_desc += value;
-                            bounds_desc += "'";
-                            break;
-                        case BTGreaterEqualStrategyNumber:
-                            bounds_desc += "key>='";
-                            bounds_desc += value;
-                            bounds_desc += "'";
-                            break;
-                    }
-                }
-
-                if (!bounds_desc.empty()) {
-                    ExplainPropertyText("LevelDB Key Bounds", bounds_desc.c_str(), es);
-                }
-            }
-        }
+        List *predicates = (List *) list_nth(fsplan->fdw_private,
+                                             FdwScanPrivatePredicates);
+        std::string bounds_desc = describe_raw_predicates(predicates);
+        if (!bounds_desc.empty())
+            ExplainPropertyText("LevelDB Key Bounds", bounds_desc.c_str(), es);
 
         if (state && state->scanner) {
             const auto& stats = state->scanner->stats();
             ExplainPropertyInteger("LevelDB Keys Scanned", NULL,
                                   stats.keys_scanned, es);
+            ExplainPropertyInteger("LevelDB Bytes Read", "bytes",
+                                  stats.bytes_read, es);
+            if (state->timing)
+                ExplainPropertyFloat("LevelDB Read Time", "ms",
+                                     stats.read_ns / 1e6, 3, es);
         }
     } else {
         /* Pivot mode */
         auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
 
-        if (fsplan->fdw_private != NIL) {
-            TupleDesc tupdesc = RelationGetDescr(rel);
-
-            std::string filters;
-            List *fdw_private = fsplan->fdw_private;
-            ListCell *cell = list_head(fdw_private);
-
-            while (cell != NULL) {
-                AttrNumber attnum = intVal(lfirst(cell));
-                cell = lnext(fdw_private, cell);
-                if (cell == NULL)
-                    break;
-                char *value = strVal(lfirst(cell));
-                cell = lnext(fdw_private, cell);
-
-                /* Find column name for this attnum */
-                const char *colname = NULL;
-                for (int i = 0; i < tupdesc->natts; i++) {
-                    Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
-                    if (attr->attnum == attnum) {
-                        colname = NameStr(attr->attname);
-                        break;
-                    }
-                }
+        TupleDesc tupdesc = RelationGetDescr(rel);
+        List *predicates = (List *) list_nth(fsplan->fdw_private,
+                                             FdwScanPrivatePredicates);
+        List *attr_filters = (List *) list_nth(fsplan->fdw_private,
+                                               FdwScanPrivateAttrFilters);
+
+        if (predicates != NIL) {
+            std::string filters = describe_filter_predicates(predicates, tupdesc);
+            ExplainPropertyText("LevelDB Identity Filter", filters.c_str(), es);
+            if (state && state->point_lookup)
+                ExplainPropertyText("LevelDB Point Lookup",
+                    *state->point_lookup ==
+                        level_pivot::PivotScanner::PointLookup::GET ? "get" : "seek",
+                    es);
+            else if (state)
+                ExplainPropertyInteger("LevelDB Key Ranges", NULL,
+                                      state->ranges.size(), es);
+        }
 
-                if (colname) {
-                    if (!filters.empty())
-                        filters += ", ";
-                    filters += colname;
-                    filters += "='";
-                    filters += value;
-                    filters += "'";
-                }
+        List *param_attnums = (List *) list_nth(fsplan->fdw_private,
+                                                FdwScanPrivateParamAttnums);
+        if (param_attnums != NIL) {
+            std::string params;
+            ListCell *lc;
+            foreach(lc, param_attnums) {
+                if (!params.empty())
+                    params += ", ";
+                params += NameStr(TupleDescAttr(tupdesc, intVal(lfirst(lc)) - 1)->attname);
             }
+            ExplainPropertyText("LevelDB Identity Params", params.c_str(), es);
+        }
 
-            if (!filters.empty()) {
-                ExplainPropertyText("LevelDB Prefix Filter", filters.c_str(), es);
-            }
+        int index_attnum = intVal(list_nth(fsplan->fdw_private, FdwScanPrivateIndexAttnum));
+        if (index_attnum != 0) {
+            ExplainPropertyText("LevelDB Index Lookup",
+                                NameStr(TupleDescAttr(tupdesc, index_attnum - 1)->attname),
+                                es);
+            if (state && state->index)
+                ExplainPropertyInteger("LevelDB Index Matches", NULL,
+                                      state->index_matches, es);
+        }
+
+        if (attr_filters != NIL) {
+            std::string filters = describe_filter_predicates(attr_filters, tupdesc);
+            ExplainPropertyText("LevelDB Attr Filter", filters.c_str(), es);
         }
 
         if (state && state->scanner)
@@ -1235,10 +4885,159 @@ levelPivotExplainForeignScan(ForeignScanState *node, ExplainState *es)
                                   stats.keys_skipped, es);
             ExplainPropertyInteger("Rows Returned", NULL,
                                   stats.rows_returned, es);
+            if (attr_filters != NIL)
+                ExplainPropertyInteger("LevelDB Rows Filtered", NULL,
+                                      stats.rows_filtered, es);
+            if (stats.gets > 0)
+                ExplainPropertyInteger("LevelDB Point Gets", NULL,
+                                      stats.gets, es);
+            if (state->scanner->skip_scan_active() || stats.seeks > 0)
+                ExplainPropertyInteger("LevelDB Skip-Scan Seeks", NULL,
+                                      stats.seeks, es);
+            ExplainPropertyInteger("LevelDB Bytes Read", "bytes",
+                                  stats.bytes_read, es);
+
+            /* Where the scan's time went, with EXPLAIN (ANALYZE, TIMING) */
+            if (state->timing) {
+                ExplainPropertyFloat("LevelDB Read Time", "ms",
+                                     stats.read_ns / 1e6, 3, es);
+                ExplainPropertyFloat("Key Parse Time", "ms",
+                                     stats.parse_ns / 1e6, 3, es);
+                ExplainPropertyFloat("Datum Conversion Time", "ms",
+                                     INSTR_TIME_GET_MILLISEC(state->convert_time), 3, es);
+            }
+        }
+    }
+
+    if (boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateReverse)))
+        ExplainPropertyText("LevelDB Scan Direction", "backward", es);
+
+    if (boolVal(list_nth(fsplan->fdw_private, FdwScanPrivateLimit)))
+        explain_scan_limit(fsplan, es);
+
+    /* Only shown when off, which is the unusual case */
+    if (!get_plan_scan_options(table, fsplan).fill_cache)
+        ExplainPropertyBool("LevelDB Fill Cache", false, es);
+}
+
+/*
+ * IsForeignScanParallelSafe - Can this scan run inside parallel workers?
+ *
+ * Parallel workers are separate processes, and LevelDB allows only one
+ * process at a time to hold a database open (its LOCK file), so without
+ * the broker a worker's open would fail while the leader has the database
+ * open. Through the broker every participant reads the same database.
+ *
+ * Each participant reads from its own statement snapshot, taken as it
+ * starts, so a transaction-scope snapshot can't be shared with workers;
+ * nor can writes the transaction holds in the leader's memory.
+ */
+bool
+levelPivotIsForeignScanParallelSafe(PlannerInfo *root,
+                                    RelOptInfo *rel,
+                                    RangeTblEntry *rte)
+{
+    return level_pivot::ConnectionManager::instance().uses_broker() &&
+           snapshot_scope == static_cast<int>(SnapshotScope::STATEMENT) &&
+           write_scope == static_cast<int>(WriteScope::STATEMENT) &&
+           transaction_writes.empty();
+}
+
+/*
+ * EstimateDSMForeignScan - Split the scan into shards and size the DSM.
+ *
+ * Runs in the leader after BeginForeignScan. The range under the pushed
+ * prefix is cut at identity boundaries so no row spans two shards; we
+ * make several shards per participant so faster workers take more.
+ */
+Size
+levelPivotEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+    auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+    Size size = offsetof(LevelPivotParallelState, bounds);
+
+    if (!state)
+        return size;
+
+    /* A plan made before the transaction began holding writes */
+    if (state->connection->buffering_writes())
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("level_pivot: cannot scan in parallel while the "
+                        "transaction holds pending writes"),
+                 errhint("Set max_parallel_workers_per_gather to 0, or "
+                         "level_pivot.write_scope to statement.")));
+
+    PG_TRY_CPP({
+        size_t shards = (size_t) (pcxt->nworkers + 1) * PARALLEL_SHARDS_PER_PARTICIPANT;
+        state->shard_bounds = level_pivot::compute_shard_boundaries(
+            state->connection, state->projection->parser(),
+            state->prefix_values, shards);
+    });
+
+    for (const auto& bound : state->shard_bounds)
+        size = add_size(size, sizeof(uint32) + bound.size());
+    return size;
+}
+
+/*
+ * InitializeDSMForeignScan - Publish the shards to shared memory.
+ */
+void
+levelPivotInitializeDSMForeignScan(ForeignScanState *node,
+                                   ParallelContext *pcxt,
+                                   void *coordinate)
+{
+    auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+    auto pstate = static_cast<LevelPivotParallelState *>(coordinate);
+
+    pg_atomic_init_u32(&pstate->next_shard, 0);
+    pstate->nshards = state ? state->shard_bounds.size() + 1 : 1;
+
+    if (state) {
+        char *ptr = pstate->bounds;
+        for (const auto& bound : state->shard_bounds) {
+            uint32 len = bound.size();
+            memcpy(ptr, &len, sizeof(uint32));
+            ptr += sizeof(uint32);
+            memcpy(ptr, bound.data(), len);
+            ptr += len;
         }
+
+        /* The leader participates too, claiming shards like a worker */
+        state->pstate = pstate;
+        state->shard_active = false;
     }
 }
 
+/*
+ * ReInitializeDSMForeignScan - Reset shard claims before a rescan.
+ */
+void
+levelPivotReInitializeDSMForeignScan(ForeignScanState *node,
+                                     ParallelContext *pcxt,
+                                     void *coordinate)
+{
+    auto pstate = static_cast<LevelPivotParallelState *>(coordinate);
+    pg_atomic_write_u32(&pstate->next_shard, 0);
+}
+
+/*
+ * InitializeWorkerForeignScan - Attach a worker to the shared shard list.
+ */
+void
+levelPivotInitializeWorkerForeignScan(ForeignScanState *node,
+                                      shm_toc *toc,
+                                      void *coordinate)
+{
+    auto state = static_cast<LevelPivotScanState *>(node->fdw_state);
+    if (!state)
+        return;
+
+    state->pstate = static_cast<LevelPivotParallelState *>(coordinate);
+    state->shard_active = false;
+}
+
 /*
  * AddForeignUpdateTargets - Tell PostgreSQL what we need to identify rows.
  *
@@ -1311,17 +5110,24 @@ levelPivotBeginForeignModify(ModifyTableState *mtstate,
         if (mode == TableMode::RAW) {
             /* Raw mode: use RawWriter */
             auto state = level_pivot::pg_construct<RawModifyState>(modify_ctx);
+            state->mode = TableMode::RAW;
 
             /* Get connection */
             state->connection = level_pivot::ConnectionManager::instance()
                 .get_connection(server->serverid, conn_options);
 
-            /* Store write batch setting */
+            /* Find existing keys as of the statement's snapshot */
+            use_statement_snapshot(estate, state->connection);
+            use_transaction_writes(state->connection);
+
+            /* Store write batch settings */
             state->use_write_batch = conn_options.use_write_batch;
+            state->batch_size = get_batch_size_option(table, server);
 
             /* Create writer */
             state->writer = std::make_unique<level_pivot::RawWriter>(
                 state->connection, conn_options.use_write_batch);
+            track_changes(state, *state->writer);
 
             /* Find key and value columns */
             state->key_attnum = find_column_attnum(rel, "key");
@@ -1339,14 +5145,19 @@ levelPivotBeginForeignModify(ModifyTableState *mtstate,
             auto state = level_pivot::pg_construct<LevelPivotModifyState>(modify_ctx);
 
             /* Build projection */
-            state->projection = build_projection_from_relation(rel, key_pattern);
+            state->projection = acquire_projection(rel, key_pattern);
 
             /* Get connection */
             state->connection = level_pivot::ConnectionManager::instance()
                 .get_connection(server->serverid, conn_options);
 
-            /* Store write batch setting */
+            /* Find existing keys as of the statement's snapshot */
+            use_statement_snapshot(estate, state->connection);
+            use_transaction_writes(state->connection);
+
+            /* Store write batch settings */
             state->use_write_batch = conn_options.use_write_batch;
+            state->batch_size = get_batch_size_option(table, server);
 
             /* Create writer - with or without batch depending on options */
             if (conn_options.use_write_batch) {
@@ -1358,6 +5169,13 @@ levelPivotBeginForeignModify(ModifyTableState *mtstate,
                 state->writer = std::make_unique<level_pivot::Writer>(
                     *state->projection, state->connection);
             }
+            track_changes(state, *state->writer);
+
+            /* The writer keeps the table's index entries in step */
+            state->index = get_secondary_index(table, rel,
+                                               state->projection->parser().pattern());
+            if (state->index)
+                state->writer->set_index(state->index.get());
 
             /* Store column count */
             TupleDesc tupdesc = RelationGetDescr(rel);
@@ -1382,29 +5200,198 @@ levelPivotExecForeignInsert(EState *estate,
                             TupleTableSlot *slot,
                             TupleTableSlot *planSlot)
 {
-    Relation rel = rinfo->ri_RelationDesc;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
+    TableMode mode = static_cast<FdwStateBase *>(rinfo->ri_FdwState)->mode;
+
+    if (mode == TableMode::RAW) {
+        auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP_RETURN({
+            slot_getallattrs(slot);
+
+            /* Extract key and value from slot */
+            int key_idx = state->key_attnum - 1;
+            int val_idx = state->value_attnum - 1;
+
+            if (slot->tts_isnull[key_idx])
+                elog(ERROR, "key column cannot be NULL");
+
+            std::string key;
+            assign_text_datum(key, slot->tts_values[key_idx]);
+            std::string value;
+            if (!slot->tts_isnull[val_idx])
+                assign_text_datum(value, slot->tts_values[val_idx]);
+
+            add_write_counts(state->metrics, state->writer->insert(key, value));
+            state->metrics.rows_inserted++;
+            state->has_modifications = true;
+            return slot;
+        }, slot);
+    } else {
+        auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP_RETURN({
+            slot_getallattrs(slot);
+            add_write_counts(state->metrics,
+                             state->writer->insert(slot->tts_values, slot->tts_isnull));
+            state->metrics.rows_inserted++;
+            state->has_modifications = true;
+            return slot;
+        }, slot);
+    }
+}
+
+/*
+ * GetForeignModifyBatchSize
+ *      Report how many rows ExecForeignBatchInsert should receive at once
+ *
+ * Batching is disabled when the executor needs each inserted row back
+ * immediately: for RETURNING, and for AFTER ROW insert triggers.
+ */
+int
+levelPivotGetForeignModifyBatchSize(ResultRelInfo *rinfo)
+{
+    ForeignTable *table = GetForeignTable(RelationGetRelid(rinfo->ri_RelationDesc));
+    int batch_size;
+
+    /* EXPLAIN without ANALYZE skips BeginForeignModify */
+    if (!rinfo->ri_FdwState)
+        batch_size = get_batch_size_option(table, GetForeignServer(table->serverid));
+    else if (get_table_mode(table) == TableMode::RAW)
+        batch_size = static_cast<RawModifyState *>(rinfo->ri_FdwState)->batch_size;
+    else
+        batch_size = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState)->batch_size;
+
+    if (rinfo->ri_projectReturning != NULL ||
+        (rinfo->ri_TrigDesc && rinfo->ri_TrigDesc->trig_insert_after_row))
+        return 1;
+
+    return batch_size;
+}
+
+/*
+ * ExecForeignBatchInsert
+ *      Insert several rows into the foreign table with one WriteBatch
+ *
+ * All rows go into one LevelDB write, so a bulk INSERT ... SELECT pays the
+ * per-write cost once per batch instead of once per row.
+ */
+TupleTableSlot **
+levelPivotExecForeignBatchInsert(EState *estate,
+                                 ResultRelInfo *rinfo,
+                                 TupleTableSlot **slots,
+                                 TupleTableSlot **planSlots,
+                                 int *numSlots)
+{
+    TableMode mode = static_cast<FdwStateBase *>(rinfo->ri_FdwState)->mode;
+    int nrows = *numSlots;
+
+    if (mode == TableMode::RAW) {
+        auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP({
+            int key_idx = state->key_attnum - 1;
+            int val_idx = state->value_attnum - 1;
+
+            if (state->batch_keys.size() < static_cast<size_t>(nrows)) {
+                state->batch_keys.resize(nrows);
+                state->batch_values.resize(nrows);
+            }
+
+            for (int i = 0; i < nrows; i++) {
+                TupleTableSlot *slot = slots[i];
+                slot_getallattrs(slot);
+
+                if (slot->tts_isnull[key_idx])
+                    elog(ERROR, "key column cannot be NULL");
+
+                assign_text_datum(state->batch_keys[i], slot->tts_values[key_idx]);
+                if (slot->tts_isnull[val_idx])
+                    state->batch_values[i].clear();
+                else
+                    assign_text_datum(state->batch_values[i], slot->tts_values[val_idx]);
+            }
+
+            auto result = state->writer->insert_batch(state->batch_keys,
+                                                      state->batch_values, nrows);
+            add_write_counts(state->metrics, result);
+            if (!state->use_write_batch)
+                add_batch_counts(state->metrics, result.keys_written + result.keys_deleted);
+            state->metrics.rows_inserted += nrows;
+            state->has_modifications = true;
+        });
+    } else {
+        auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP({
+            state->batch_values.resize(nrows);
+            state->batch_nulls.resize(nrows);
+
+            for (int i = 0; i < nrows; i++) {
+                slot_getallattrs(slots[i]);
+                state->batch_values[i] = slots[i]->tts_values;
+                state->batch_nulls[i] = slots[i]->tts_isnull;
+            }
+
+            auto result = state->writer->insert_batch(state->batch_values.data(),
+                                                      state->batch_nulls.data(), nrows);
+            add_write_counts(state->metrics, result);
+            if (!state->use_write_batch)
+                add_batch_counts(state->metrics, result.keys_written + result.keys_deleted);
+            state->metrics.rows_inserted += nrows;
+            state->has_modifications = true;
+        });
+    }
+
+    return slots;
+}
+
+/*
+ * ExecForeignUpdate
+ *      Update a row in the foreign table
+ */
+TupleTableSlot *
+levelPivotExecForeignUpdate(EState *estate,
+                            ResultRelInfo *rinfo,
+                            TupleTableSlot *slot,
+                            TupleTableSlot *planSlot)
+{
+    TableMode mode = static_cast<FdwStateBase *>(rinfo->ri_FdwState)->mode;
 
     if (mode == TableMode::RAW) {
         auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
 
         PG_TRY_CPP_RETURN({
-            slot_getallattrs(slot);
+            /* Get the old row from the wholerow junk attribute */
+            bool isnull;
+            Datum datum = ExecGetJunkAttribute(planSlot,
+                              rinfo->ri_RowIdAttNo,
+                              &isnull);
 
-            /* Extract key and value from slot */
-            int key_idx = state->key_attnum - 1;
-            int val_idx = state->value_attnum - 1;
+            if (isnull)
+                elog(ERROR, "wholerow is NULL");
 
-            if (slot->tts_isnull[key_idx])
+            HeapTupleHeader oldtup = DatumGetHeapTupleHeader(datum);
+
+            /* Extract key from old row */
+            int key_idx = state->key_attnum;
+            bool key_null;
+            Datum key_datum = GetAttributeByNum(oldtup, key_idx, &key_null);
+
+            if (key_null)
                 elog(ERROR, "key column cannot be NULL");
 
-            std::string key = TextDatumGetCString(slot->tts_values[key_idx]);
-            std::string value;
+            std::string key = TextDatumGetCString(key_datum);
+
+            /* Get new value from slot */
+            slot_getallattrs(slot);
+            int val_idx = state->value_attnum - 1;
+
+            std::string new_value;
             if (!slot->tts_isnull[val_idx])
-                value = TextDatumGetCString(slot->tts_values[val_idx]);
+                assign_text_datum(new_value, slot->tts_values[val_idx]);
 
-            state->writer->insert(key, value);
+            add_write_counts(state->metrics, state->writer->update(key, new_value));
+            state->metrics.rows_updated++;
             state->has_modifications = true;
             return slot;
         }, slot);
@@ -1412,8 +5399,33 @@ levelPivotExecForeignInsert(EState *estate,
         auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
 
         PG_TRY_CPP_RETURN({
+            /* Get the old row from the wholerow junk attribute */
+            bool isnull;
+            Datum datum = ExecGetJunkAttribute(planSlot,
+                              rinfo->ri_RowIdAttNo,
+                              &isnull);
+
+            if (isnull)
+                elog(ERROR, "wholerow is NULL");
+
+            HeapTupleHeader oldtup = DatumGetHeapTupleHeader(datum);
+
+            /* Extract old values using stack-based TempArray */
+            DatumTempArray old_values(state->num_cols);
+            BoolTempArray old_nulls(state->num_cols);
+
+            for (int i = 0; i < state->num_cols; i++)
+            {
+                old_values[i] = GetAttributeByNum(oldtup, i + 1, &old_nulls[i]);
+            }
+
+            /* Get new values from slot */
             slot_getallattrs(slot);
-            state->writer->insert(slot->tts_values, slot->tts_isnull);
+
+            add_write_counts(state->metrics,
+                             state->writer->update(old_values.data(), old_nulls.data(),
+                                                   slot->tts_values, slot->tts_isnull));
+            state->metrics.rows_updated++;
             state->has_modifications = true;
             return slot;
         }, slot);
@@ -1421,18 +5433,16 @@ levelPivotExecForeignInsert(EState *estate,
 }
 
 /*
- * ExecForeignUpdate
- *      Update a row in the foreign table
+ * ExecForeignDelete
+ *      Delete a row from the foreign table
  */
 TupleTableSlot *
-levelPivotExecForeignUpdate(EState *estate,
+levelPivotExecForeignDelete(EState *estate,
                             ResultRelInfo *rinfo,
                             TupleTableSlot *slot,
                             TupleTableSlot *planSlot)
 {
-    Relation rel = rinfo->ri_RelationDesc;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
+    TableMode mode = static_cast<FdwStateBase *>(rinfo->ri_FdwState)->mode;
 
     if (mode == TableMode::RAW) {
         auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
@@ -1458,24 +5468,17 @@ levelPivotExecForeignUpdate(EState *estate,
                 elog(ERROR, "key column cannot be NULL");
 
             std::string key = TextDatumGetCString(key_datum);
-
-            /* Get new value from slot */
-            slot_getallattrs(slot);
-            int val_idx = state->value_attnum - 1;
-
-            std::string new_value;
-            if (!slot->tts_isnull[val_idx])
-                new_value = TextDatumGetCString(slot->tts_values[val_idx]);
-
-            state->writer->update(key, new_value);
+            add_write_counts(state->metrics, state->writer->remove(key));
+            state->metrics.rows_deleted++;
             state->has_modifications = true;
+
             return slot;
         }, slot);
     } else {
         auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
 
         PG_TRY_CPP_RETURN({
-            /* Get the old row from the wholerow junk attribute */
+            /* Get the row from the wholerow junk attribute */
             bool isnull;
             Datum datum = ExecGetJunkAttribute(planSlot,
                               rinfo->ri_RowIdAttNo,
@@ -1486,182 +5489,645 @@ levelPivotExecForeignUpdate(EState *estate,
 
             HeapTupleHeader oldtup = DatumGetHeapTupleHeader(datum);
 
-            /* Extract old values using stack-based TempArray */
-            DatumTempArray old_values(state->num_cols);
-            BoolTempArray old_nulls(state->num_cols);
+            /* Extract values using stack-based TempArray */
+            DatumTempArray values(state->num_cols);
+            BoolTempArray nulls(state->num_cols);
 
             for (int i = 0; i < state->num_cols; i++)
             {
-                old_values[i] = GetAttributeByNum(oldtup, i + 1, &old_nulls[i]);
+                values[i] = GetAttributeByNum(oldtup, i + 1, &nulls[i]);
+            }
+
+            add_write_counts(state->metrics, state->writer->remove(values.data(), nulls.data()));
+            state->metrics.rows_deleted++;
+            state->has_modifications = true;
+
+            return slot;
+        }, slot);
+    }
+}
+
+/*
+ * EndForeignModify - Commit changes and clean up.
+ *
+ * This is called after the last row modification. Key responsibilities:
+ *   1. Commit WriteBatch (applies all accumulated operations atomically)
+ *   2. Note the table's changes for its NOTIFY at transaction commit
+ *   3. Release writer and connection resources
+ *
+ * NOTIFY is sent once per table per transaction, at commit, so listeners
+ * see consistent data and aren't woken per statement.
+ */
+void
+levelPivotEndForeignModify(EState *estate, ResultRelInfo *rinfo)
+{
+    if (!rinfo->ri_FdwState)
+        return;
+
+    Relation rel = rinfo->ri_RelationDesc;
+    TableMode mode = static_cast<FdwStateBase *>(rinfo->ri_FdwState)->mode;
+
+    if (mode == TableMode::RAW) {
+        auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP({
+            /* Commit makes all accumulated operations visible atomically */
+            if (state->writer && state->use_write_batch) {
+                add_batch_counts(state->metrics, state->writer->pending_count());
+                state->writer->commit_batch();
+            }
+
+            /* NOTIFY at commit lets LISTEN clients react to changes */
+            if (state->has_modifications) {
+                note_table_changed(state);
+                level_pivot::SizeEstimateCache::instance().invalidate(RelationGetRelid(rel));
+                release_transaction_snapshot(state->connection);
+            }
+        });
+
+        record_table_metrics(RelationGetRelid(rel), state->metrics);
+        state->cleanup();
+    } else {
+        auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
+
+        PG_TRY_CPP({
+            /* Commit batch if using batched writes */
+            if (state->writer && state->use_write_batch) {
+                add_batch_counts(state->metrics, state->writer->pending_count());
+                state->writer->commit_batch();
+            }
+
+            /* Note changes for NOTIFY and drop stale size estimates */
+            if (state->has_modifications) {
+                note_table_changed(state);
+                level_pivot::SizeEstimateCache::instance().invalidate(RelationGetRelid(rel));
+                release_transaction_snapshot(state->connection);
+            }
+        });
+
+        record_table_metrics(RelationGetRelid(rel), state->metrics);
+        state->cleanup();
+    }
+    rinfo->ri_FdwState = nullptr;
+}
+
+/*
+ * IsForeignRelUpdatable
+ *      Check if the foreign table supports INSERT/UPDATE/DELETE
+ */
+int
+levelPivotIsForeignRelUpdatable(Relation rel)
+{
+    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
+    ForeignServer *server = GetForeignServer(table->serverid);
+
+    /* Check if server is read-only */
+    ListCell *cell;
+    foreach(cell, server->options)
+    {
+        DefElem *def = (DefElem *) lfirst(cell);
+        if (strcmp(def->defname, "read_only") == 0)
+        {
+            if (defGetBoolean(def))
+                return 0;  /* Read-only, no modifications allowed */
+        }
+    }
+
+    /* Default: allow all operations */
+    return (1 << CMD_INSERT) | (1 << CMD_UPDATE) | (1 << CMD_DELETE);
+}
+
+/**
+ * The ForeignScan of rtindex feeding a ModifyTable: its direct child, or
+ * the subplan_index'th child of an Append below it (possibly under a
+ * Result computing the new values). Anything deeper means local joins,
+ * which rule out a direct modify.
+ */
+static ForeignScan *
+find_modifytable_subplan(ModifyTable *plan, Index rtindex, int subplan_index)
+{
+    Plan *subplan = outerPlan(plan);
+
+    if (IsA(subplan, Result) && outerPlan(subplan) != NULL &&
+        IsA(outerPlan(subplan), Append))
+        subplan = outerPlan(subplan);
+    if (IsA(subplan, Append)) {
+        Append *append = (Append *) subplan;
+        if (subplan_index >= list_length(append->appendplans))
+            return NULL;
+        subplan = (Plan *) list_nth(append->appendplans, subplan_index);
+    }
+
+    if (!IsA(subplan, ForeignScan))
+        return NULL;
+    ForeignScan *fscan = (ForeignScan *) subplan;
+    return bms_is_member(rtindex, fscan->fs_base_relids) ? fscan : NULL;
+}
+
+/*
+ * Walker for is_row_independent: true on anything whose value can differ
+ * between rows (columns, subqueries, executor-internal params)
+ */
+static bool
+row_dependent_walker(Node *node, void *context)
+{
+    if (node == NULL)
+        return false;
+    if (IsA(node, Var) || IsA(node, SubLink) || IsA(node, SubPlan) ||
+        IsA(node, AlternativeSubPlan))
+        return true;
+    if (IsA(node, Param) && ((Param *) node)->paramkind != PARAM_EXTERN)
+        return true;
+    return expression_tree_walker(node, row_dependent_walker, context);
+}
+
+/**
+ * True if expr has one value for the whole statement: constants, bind
+ * parameters and non-volatile functions of them
+ */
+static bool
+is_row_independent(Expr *expr)
+{
+    return !row_dependent_walker((Node *) expr, NULL) &&
+           !contain_volatile_functions((Node *) expr);
+}
+
+/**
+ * PlanDirectModify's checks; see levelPivotPlanDirectModify
+ */
+static bool
+plan_direct_modify(PlannerInfo *root, ModifyTable *plan, Index resultRelation,
+                   int subplan_index)
+{
+    CmdType operation = plan->operation;
+    if (operation != CMD_UPDATE && operation != CMD_DELETE)
+        return false;
+
+    /* Rows are never built, so there is nothing to return */
+    if (plan->returningLists != NIL)
+        return false;
+
+    /* A plain scan of the table: no join parameters, LIMIT or ordering */
+    ForeignScan *fscan = find_modifytable_subplan(plan, resultRelation, subplan_index);
+    if (fscan == NULL || fscan->scan.scanrelid != resultRelation ||
+        fscan->fdw_exprs != NIL ||
+        boolVal(list_nth(fscan->fdw_private, FdwScanPrivateReverse)) ||
+        boolVal(list_nth(fscan->fdw_private, FdwScanPrivateLimit)))
+        return false;
+
+    RelOptInfo *baserel = root->simple_rel_array[resultRelation];
+    RangeTblEntry *rte = planner_rt_fetch(resultRelation, root);
+    ForeignTable *table = GetForeignTable(rte->relid);
+    TableMode mode = get_table_mode(table);
+    Relation rel = table_open(rte->relid, NoLock);
+    TupleDesc tupdesc = RelationGetDescr(rel);
+
+    /* Every qual must be settled by the key ranges */
+    bool pushable;
+    List *predicates = NIL;
+    std::vector<AttrNumber> identity_attnums;
+    if (mode == TableMode::RAW) {
+        pushable = exact_raw_key_predicates(baserel, rel);
+        predicates = (List *) list_nth(fscan->fdw_private, FdwScanPrivatePredicates);
+    } else {
+        std::string key_pattern = get_table_option(table, "key_pattern");
+        pushable = !key_pattern.empty();
+        if (pushable) {
+            /* Writer::modify_ranges needs each row's keys to be adjacent */
+            level_pivot::KeyPattern pattern(key_pattern);
+            identity_attnums = identity_attnums_in_pattern_order(rel, pattern);
+            pushable = level_pivot::captures_before_attr(pattern) ==
+                           pattern.capture_names().size() &&
+                       exact_identity_predicates(baserel, identity_attnums, pattern,
+                                                 &predicates);
+        }
+    }
+
+    /*
+     * UPDATE: every new value must be the same for all rows, and go to an
+     * attr column (pivot) or the text value column (raw); identity and key
+     * changes move keys, which the per-row path handles
+     */
+    List *target_attrs = NIL;
+    List *target_exprs = NIL;
+    if (pushable && operation == CMD_UPDATE) {
+        AttrNumber value_attnum = find_column_attnum(rel, "value");
+        List *processed_tlist;
+        List *update_colnos;
+        get_translated_update_targetlist(root, resultRelation,
+                                         &processed_tlist, &update_colnos);
+
+        ListCell *tle_cell;
+        ListCell *colno_cell;
+        forboth(tle_cell, processed_tlist, colno_cell, update_colnos) {
+            TargetEntry *tle = lfirst_node(TargetEntry, tle_cell);
+            AttrNumber attnum = lfirst_int(colno_cell);
+
+            bool assignable;
+            if (attnum <= InvalidAttrNumber)
+                assignable = false;
+            else if (mode == TableMode::RAW)
+                assignable = attnum == value_attnum &&
+                    (TupleDescAttr(tupdesc, attnum - 1)->atttypid == TEXTOID ||
+                     TupleDescAttr(tupdesc, attnum - 1)->atttypid == VARCHAROID);
+            else
+                assignable = std::find(identity_attnums.begin(), identity_attnums.end(),
+                                       attnum) == identity_attnums.end();
+
+            if (!assignable || !is_row_independent(tle->expr)) {
+                pushable = false;
+                break;
+            }
+            target_attrs = lappend_int(target_attrs, attnum);
+            target_exprs = lappend(target_exprs, copyObject(tle->expr));
+        }
+    }
+    table_close(rel, NoLock);
+
+    if (!pushable)
+        return false;
+
+    fscan->operation = operation;
+    fscan->resultRelation = resultRelation;
+    fscan->fdw_exprs = target_exprs;
+    fscan->fdw_private = list_make4(predicates,
+                                    target_attrs,
+                                    makeBoolean(plan->canSetTag),
+                                    list_nth(fscan->fdw_private, FdwScanPrivateBulkScan));
+
+    /* The key ranges hold exactly the matching rows; nothing is left to check */
+    fscan->scan.plan.qual = NIL;
+    return true;
+}
+
+/*
+ * PlanDirectModify - Run an UPDATE or DELETE as one pass over the keys.
+ *
+ * Applies when the key ranges settle all of the statement's quals (the
+ * same test aggregate and LIMIT pushdown use: = and IN on leading
+ * identity columns, an exact LIKE 'prefix%' after them, or raw key
+ * comparisons), a pivot table's captures all precede {attr} so each
+ * row's keys are adjacent, there's no RETURNING, and an UPDATE only
+ * assigns values that are the same for every row to attr (or raw value)
+ * columns.
+ *
+ * The scan below the ModifyTable then becomes the whole statement:
+ * instead of building each row for PostgreSQL to hand back to
+ * ExecForeignUpdate/Delete, the writer walks the ranges once and batches
+ * the puts and deletes. Anything else keeps the per-row path.
+ */
+bool
+levelPivotPlanDirectModify(PlannerInfo *root,
+                           ModifyTable *plan,
+                           Index resultRelation,
+                           int subplan_index)
+{
+    PG_TRY_CPP_RETURN({
+        return plan_direct_modify(root, plan, resultRelation, subplan_index);
+    }, false);
+    return false;
+}
+
+/*
+ * BeginDirectModify - Set up the writer and key ranges of a direct modify.
+ *
+ * Like BeginForeignModify: a writable connection reading from the
+ * statement's snapshot, and a WriteBatch when use_write_batch is on.
+ */
+void
+levelPivotBeginDirectModify(ForeignScanState *node, int eflags)
+{
+    if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+        return;
+
+    PG_TRY_CPP({
+        EState *estate = node->ss.ps.state;
+        ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+        Relation rel = node->resultRelInfo->ri_RelationDesc;
+        ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
+        ForeignServer *server = GetForeignServer(table->serverid);
+        TableMode mode = get_table_mode(table);
+
+        auto conn_options = get_server_options(server);
+        conn_options.read_only = false;  /* Need write access */
+
+        MemoryContext modify_ctx = AllocSetContextCreate(estate->es_query_cxt,
+                                                         "level_pivot direct modify",
+                                                         ALLOCSET_DEFAULT_SIZES);
+        auto state = level_pivot::pg_construct<DirectModifyState>(modify_ctx);
+        state->mode = mode;
+        state->operation = fsplan->operation;
+        state->set_processed = boolVal(list_nth(fsplan->fdw_private,
+                                                FdwDirectModifyPrivateSetProcessed));
+        state->scan_options = get_scan_options(table,
+            boolVal(list_nth(fsplan->fdw_private, FdwDirectModifyPrivateBulkScan)));
+        state->use_write_batch = conn_options.use_write_batch;
+        state->schema_name = get_namespace_name(RelationGetNamespace(rel));
+        state->table_name = RelationGetRelationName(rel);
+
+        state->connection = level_pivot::ConnectionManager::instance()
+            .get_connection(server->serverid, conn_options);
+
+        /* Find the rows as of the statement's snapshot */
+        use_statement_snapshot(estate, state->connection);
+        use_transaction_writes(state->connection);
+
+        List *predicates = (List *) list_nth(fsplan->fdw_private,
+                                             FdwDirectModifyPrivatePredicates);
+        if (mode == TableMode::RAW) {
+            state->bounds = build_raw_bounds_from_predicates(predicates);
+            state->value_attnum = find_column_attnum(rel, "value");
+            state->raw_writer = std::make_unique<level_pivot::RawWriter>(
+                state->connection, conn_options.use_write_batch);
+            track_changes(state, *state->raw_writer);
+        } else {
+            state->projection = acquire_projection(rel, get_table_option(table, "key_pattern"));
+            state->ranges = level_pivot::build_identity_ranges(
+                state->projection->parser(),
+                build_identity_constraints(predicates, *state->projection));
+
+            if (conn_options.use_write_batch) {
+                auto batch = std::make_unique<level_pivot::LevelDBWriteBatch>(
+                    state->connection->create_batch());
+                state->writer = std::make_unique<level_pivot::Writer>(
+                    *state->projection, state->connection, std::move(batch));
+            } else {
+                state->writer = std::make_unique<level_pivot::Writer>(
+                    *state->projection, state->connection);
             }
+            track_changes(state, *state->writer);
 
-            /* Get new values from slot */
-            slot_getallattrs(slot);
+            state->index = get_secondary_index(table, rel,
+                                               state->projection->parser().pattern());
+            if (state->index)
+                state->writer->set_index(state->index.get());
+        }
 
-            state->writer->update(old_values.data(), old_nulls.data(),
-                                 slot->tts_values, slot->tts_isnull);
+        /* New values are evaluated once, when the pass runs */
+        List *target_attrs = (List *) list_nth(fsplan->fdw_private,
+                                               FdwDirectModifyPrivateTargetAttrs);
+        ListCell *attr_cell;
+        ListCell *expr_cell;
+        forboth(attr_cell, target_attrs, expr_cell, fsplan->fdw_exprs) {
+            state->target_attrs.push_back((AttrNumber) lfirst_int(attr_cell));
+            state->target_exprs.push_back(ExecInitExpr((Expr *) lfirst(expr_cell),
+                                                       (PlanState *) node));
+        }
 
-            state->has_modifications = true;
-            return slot;
-        }, slot);
-    }
+        node->fdw_state = state;
+    });
 }
 
-/*
- * ExecForeignDelete
- *      Delete a row from the foreign table
+/**
+ * Evaluate the UPDATE's new values and run the writer over the ranges
  */
-TupleTableSlot *
-levelPivotExecForeignDelete(EState *estate,
-                            ResultRelInfo *rinfo,
-                            TupleTableSlot *slot,
-                            TupleTableSlot *planSlot)
+static void
+run_direct_modify(ForeignScanState *node, DirectModifyState *state)
 {
-    Relation rel = rinfo->ri_RelationDesc;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
-
-    if (mode == TableMode::RAW) {
-        auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
+    ExprContext *econtext = node->ss.ps.ps_ExprContext;
+    bool remove = state->operation == CMD_DELETE;
 
-        PG_TRY_CPP_RETURN({
-            /* Get the old row from the wholerow junk attribute */
-            bool isnull;
-            Datum datum = ExecGetJunkAttribute(planSlot,
-                              rinfo->ri_RowIdAttNo,
-                              &isnull);
+    if (state->mode == TableMode::RAW) {
+        level_pivot::RawWriteResult result;
+        if (remove) {
+            result = state->raw_writer->remove_range(state->bounds, state->scan_options);
+        } else {
+            /* Only the value column can be assigned; NULL stores "" */
+            std::string value;
+            for (ExprState *expr : state->target_exprs) {
+                bool isnull;
+                Datum datum = ExecEvalExpr(expr, econtext, &isnull);
+                value.clear();
+                if (!isnull)
+                    assign_text_datum(value, datum);
+            }
+            result = state->raw_writer->update_range(state->bounds, value,
+                                                     state->scan_options);
+        }
+        state->rows = result.rows;
+        state->keys_written = result.keys_written;
+        state->keys_deleted = result.keys_deleted;
+        add_write_counts(state->metrics, result);
+    } else {
+        level_pivot::WriteResult result;
+        if (remove) {
+            result = state->writer->remove_ranges(state->ranges, state->scan_options);
+        } else {
+            std::vector<level_pivot::AttrAssignment> assignments;
+            assignments.reserve(state->target_attrs.size());
+            for (size_t i = 0; i < state->target_attrs.size(); i++) {
+                const level_pivot::ColumnDef *col =
+                    state->projection->column_by_attnum(state->target_attrs[i]);
+                if (col == nullptr || col->is_identity)
+                    throw level_pivot::LevelPivotError("direct update of a non-attr column");
+
+                bool isnull;
+                Datum datum = ExecEvalExpr(state->target_exprs[i], econtext, &isnull);
+                level_pivot::AttrAssignment assignment;
+                assignment.attr_name = col->name;
+                if (!isnull)
+                    assignment.value = level_pivot::TypeConverter::datum_to_string(
+                        datum, col->type, false);
+                assignments.push_back(std::move(assignment));
+            }
+            result = state->writer->update_ranges(state->ranges, assignments,
+                                                  state->scan_options);
+        }
+        state->rows = result.rows;
+        state->keys_written = result.keys_written;
+        state->keys_deleted = result.keys_deleted;
+        add_write_counts(state->metrics, result);
+    }
 
-            if (isnull)
-                elog(ERROR, "wholerow is NULL");
+    state->has_modifications = state->rows > 0;
+    (remove ? state->metrics.rows_deleted : state->metrics.rows_updated) += state->rows;
+}
 
-            HeapTupleHeader oldtup = DatumGetHeapTupleHeader(datum);
+/*
+ * IterateDirectModify - Run the whole UPDATE or DELETE on the first call.
+ *
+ * No rows come back (there's no RETURNING); the count goes to
+ * es_processed for the command tag and to the node's instrumentation
+ * for EXPLAIN ANALYZE.
+ */
+TupleTableSlot *
+levelPivotIterateDirectModify(ForeignScanState *node)
+{
+    auto state = static_cast<DirectModifyState *>(node->fdw_state);
+    TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
 
-            /* Extract key from old row */
-            int key_idx = state->key_attnum;
-            bool key_null;
-            Datum key_datum = GetAttributeByNum(oldtup, key_idx, &key_null);
+    if (state && !state->done) {
+        PG_TRY_CPP({
+            run_direct_modify(node, state);
+        });
+        state->done = true;
 
-            if (key_null)
-                elog(ERROR, "key column cannot be NULL");
+        if (state->set_processed)
+            node->ss.ps.state->es_processed += state->rows;
+        if (node->ss.ps.instrument)
+            node->ss.ps.instrument->tuplecount += state->rows;
+    }
 
-            std::string key = TextDatumGetCString(key_datum);
-            state->writer->remove(key);
-            state->has_modifications = true;
+    return ExecClearTuple(slot);
+}
 
-            return slot;
-        }, slot);
-    } else {
-        auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
+/*
+ * EndDirectModify - Commit the batch and note changes, as EndForeignModify does
+ */
+void
+levelPivotEndDirectModify(ForeignScanState *node)
+{
+    auto state = static_cast<DirectModifyState *>(node->fdw_state);
+    if (!state)
+        return;
 
-        PG_TRY_CPP_RETURN({
-            /* Get the row from the wholerow junk attribute */
-            bool isnull;
-            Datum datum = ExecGetJunkAttribute(planSlot,
-                              rinfo->ri_RowIdAttNo,
-                              &isnull);
+    PG_TRY_CPP({
+        if (state->use_write_batch) {
+            if (state->writer) {
+                add_batch_counts(state->metrics, state->writer->pending_count());
+                state->writer->commit_batch();
+            }
+            if (state->raw_writer) {
+                add_batch_counts(state->metrics, state->raw_writer->pending_count());
+                state->raw_writer->commit_batch();
+            }
+        }
 
-            if (isnull)
-                elog(ERROR, "wholerow is NULL");
+        if (state->has_modifications) {
+            note_table_changed(state);
+            level_pivot::SizeEstimateCache::instance().invalidate(
+                RelationGetRelid(node->resultRelInfo->ri_RelationDesc));
+            release_transaction_snapshot(state->connection);
+        }
+    });
 
-            HeapTupleHeader oldtup = DatumGetHeapTupleHeader(datum);
+    record_table_metrics(RelationGetRelid(node->resultRelInfo->ri_RelationDesc),
+                         state->metrics);
+    state->cleanup();
+    node->fdw_state = nullptr;
+}
 
-            /* Extract values using stack-based TempArray */
-            DatumTempArray values(state->num_cols);
-            BoolTempArray nulls(state->num_cols);
+/*
+ * ExplainDirectModify
+ *      The predicates and assigned columns; with ANALYZE, what was written
+ */
+void
+levelPivotExplainDirectModify(ForeignScanState *node, ExplainState *es)
+{
+    ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+    Relation rel = node->ss.ss_currentRelation;
+    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
+    TupleDesc tupdesc = RelationGetDescr(rel);
 
-            for (int i = 0; i < state->num_cols; i++)
-            {
-                values[i] = GetAttributeByNum(oldtup, i + 1, &nulls[i]);
-            }
+    List *predicates = (List *) list_nth(fsplan->fdw_private,
+                                         FdwDirectModifyPrivatePredicates);
+    if (get_table_mode(table) == TableMode::RAW) {
+        std::string bounds_desc = describe_raw_predicates(predicates);
+        if (!bounds_desc.empty())
+            ExplainPropertyText("LevelDB Key Bounds", bounds_desc.c_str(), es);
+    } else if (predicates != NIL) {
+        std::string filters = describe_filter_predicates(predicates, tupdesc);
+        ExplainPropertyText("LevelDB Identity Filter", filters.c_str(), es);
+    }
 
-            state->writer->remove(values.data(), nulls.data());
-            state->has_modifications = true;
+    List *target_attrs = (List *) list_nth(fsplan->fdw_private,
+                                           FdwDirectModifyPrivateTargetAttrs);
+    if (target_attrs != NIL) {
+        std::string columns;
+        ListCell *lc;
+        foreach(lc, target_attrs) {
+            if (!columns.empty())
+                columns += ", ";
+            columns += NameStr(TupleDescAttr(tupdesc, lfirst_int(lc) - 1)->attname);
+        }
+        ExplainPropertyText("LevelDB Assigned Columns", columns.c_str(), es);
+    }
 
-            return slot;
-        }, slot);
+    auto state = static_cast<DirectModifyState *>(node->fdw_state);
+    if (state && state->done) {
+        ExplainPropertyInteger("LevelDB Rows Modified", NULL, state->rows, es);
+        ExplainPropertyInteger("LevelDB Keys Written", NULL, state->keys_written, es);
+        ExplainPropertyInteger("LevelDB Keys Deleted", NULL, state->keys_deleted, es);
     }
+
+    /* Only shown when off, which is the unusual case */
+    if (!get_scan_options(table,
+            boolVal(list_nth(fsplan->fdw_private, FdwDirectModifyPrivateBulkScan))).fill_cache)
+        ExplainPropertyBool("LevelDB Fill Cache", false, es);
 }
 
 /*
- * EndForeignModify - Commit changes and clean up.
- *
- * This is called after the last row modification. Key responsibilities:
- *   1. Commit WriteBatch (applies all accumulated operations atomically)
- *   2. Send NOTIFY if any modifications occurred
- *   3. Release writer and connection resources
+ * AcquireSampleRows - Collect up to targrows sample rows for ANALYZE.
  *
- * NOTIFY is sent after commit so listeners see consistent data.
+ * Rows are built with the same converters as IterateForeignScan, so the
+ * statistics describe exactly what queries see. LevelDB has no dead rows.
+ * Cached planner size estimates are dropped so the next plan re-samples.
  */
-void
-levelPivotEndForeignModify(EState *estate, ResultRelInfo *rinfo)
+int
+levelPivotAcquireSampleRows(Relation relation, int elevel,
+                            HeapTuple *rows, int targrows,
+                            double *totalrows, double *totaldeadrows)
 {
-    if (!rinfo->ri_FdwState)
-        return;
-
-    Relation rel = rinfo->ri_RelationDesc;
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    TableMode mode = get_table_mode(table);
-
-    if (mode == TableMode::RAW) {
-        auto state = static_cast<RawModifyState *>(rinfo->ri_FdwState);
+    int numrows = 0;
+    *totalrows = 0;
+    *totaldeadrows = 0;
 
-        PG_TRY_CPP({
-            /* Commit makes all accumulated operations visible atomically */
-            if (state->writer && state->use_write_batch) {
-                state->writer->commit_batch();
-            }
+    PG_TRY_CPP({
+        ForeignTable *table = GetForeignTable(RelationGetRelid(relation));
+        ForeignServer *server = GetForeignServer(table->serverid);
 
-            /* NOTIFY lets LISTEN clients react to changes */
-            if (state->has_modifications) {
-                send_table_changed_notify(state->schema_name, state->table_name);
-            }
-        });
+        AnalyzeSample sample;
+        analyze_sample_init(&sample, rows, targrows);
 
-        state->cleanup();
-    } else {
-        auto state = static_cast<LevelPivotModifyState *>(rinfo->ri_FdwState);
+        if (get_table_mode(table) == TableMode::RAW)
+            numrows = acquire_raw_sample_rows(relation, server, &sample, totalrows);
+        else
+            numrows = acquire_pivot_sample_rows(relation, table, server,
+                                                &sample, totalrows);
 
-        PG_TRY_CPP({
-            /* Commit batch if using batched writes */
-            if (state->writer && state->use_write_batch) {
-                state->writer->commit_batch();
-            }
+        level_pivot::SizeEstimateCache::instance().invalidate(RelationGetRelid(relation));
+    });
 
-            /* Send NOTIFY if modifications occurred */
-            if (state->has_modifications) {
-                send_table_changed_notify(state->schema_name, state->table_name);
-            }
-        });
+    ereport(elevel,
+            (errmsg("\"%s\": LevelDB range contains %.0f rows; %d rows in sample",
+                    RelationGetRelationName(relation), *totalrows, numrows)));
 
-        state->cleanup();
-    }
-    rinfo->ri_FdwState = nullptr;
+    return numrows;
 }
 
 /*
- * IsForeignRelUpdatable
- *      Check if the foreign table supports INSERT/UPDATE/DELETE
+ * AnalyzeForeignTable - Enable ANALYZE for level_pivot tables.
+ *
+ * LevelDB has no pages, so totalpages is derived from the approximate
+ * on-disk size of the table's key range. It only feeds ANALYZE's progress
+ * reporting and relpages; the actual sampling is in AcquireSampleRows.
  */
-int
-levelPivotIsForeignRelUpdatable(Relation rel)
+bool
+levelPivotAnalyzeForeignTable(Relation relation,
+                              AcquireSampleRowsFunc *func,
+                              BlockNumber *totalpages)
 {
-    ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
-    ForeignServer *server = GetForeignServer(table->serverid);
+    *func = levelPivotAcquireSampleRows;
+    *totalpages = 1;
 
-    /* Check if server is read-only */
-    ListCell *cell;
-    foreach(cell, server->options)
-    {
-        DefElem *def = (DefElem *) lfirst(cell);
-        if (strcmp(def->defname, "read_only") == 0)
-        {
-            if (defGetBoolean(def))
-                return 0;  /* Read-only, no modifications allowed */
-        }
-    }
+    PG_TRY_CPP({
+        ForeignTable *table = GetForeignTable(RelationGetRelid(relation));
+        ForeignServer *server = GetForeignServer(table->serverid);
 
-    /* Default: allow all operations */
-    return (1 << CMD_INSERT) | (1 << CMD_UPDATE) | (1 << CMD_DELETE);
+        auto connection = level_pivot::ConnectionManager::instance()
+            .get_connection(server->serverid, get_server_options(server));
+
+        std::string start;
+        if (get_table_mode(table) == TableMode::PIVOT)
+            start = level_pivot::KeyParser(get_table_option(table, "key_pattern")).build_prefix();
+
+        uint64_t bytes = connection->approximate_size(
+            start, level_pivot::KeyParser::prefix_successor(start));
+        *totalpages = (BlockNumber) std::max<uint64_t>(
+            1, std::min<uint64_t>(bytes / BLCKSZ, MaxBlockNumber));
+    });
+
+    return true;
 }
 
 /*
@@ -1676,6 +6142,14 @@ levelPivotIsForeignRelUpdatable(Relation rel)
  *   4. Scan for all attr names (the {attr} values)
  *   5. Generate CREATE FOREIGN TABLE with discovered columns
  *
+ * Both samples are spread over the whole key range rather than read from
+ * its start (see SchemaDiscovery::run_probes), so a large database is not
+ * judged by its first prefix. IMPORT options:
+ *   sample_keys     keys read for attr discovery (default 10000)
+ *   sample_probes   seek positions those reads are spread over (default 64)
+ *   sample_threads  threads the probes are read on (default 4)
+ *   infer_types     type attr columns from their sampled values (default true)
+ *
  * This is a best-effort heuristic. Complex key structures may need
  * manual table definitions.
  */
@@ -1683,6 +6157,43 @@ List *
 levelPivotImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
 {
     List *commands = NIL;
+    level_pivot::DiscoveryOptions opts;
+    bool infer_types = true;
+    ListCell *lc;
+
+    opts.probes = 64;
+    opts.threads = 4;
+
+    foreach(lc, stmt->options)
+    {
+        DefElem *def = (DefElem *) lfirst(lc);
+        size_t *count;
+
+        if (strcmp(def->defname, "infer_types") == 0)
+        {
+            infer_types = defGetBoolean(def);
+            continue;
+        }
+        else if (strcmp(def->defname, "sample_keys") == 0)
+            count = &opts.max_keys;
+        else if (strcmp(def->defname, "sample_probes") == 0)
+            count = &opts.probes;
+        else if (strcmp(def->defname, "sample_threads") == 0)
+            count = &opts.threads;
+        else
+            ereport(ERROR,
+                    (errcode(ERRCODE_FDW_INVALID_OPTION_NAME),
+                     errmsg("invalid option \"%s\"", def->defname),
+                     errhint("Valid options are: sample_keys, sample_probes, "
+                             "sample_threads, infer_types")));
+
+        int64 value = defGetInt64(def);
+        if (value < 1)
+            ereport(ERROR,
+                    (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                     errmsg("option \"%s\" must be at least 1", def->defname)));
+        *count = (size_t) value;
+    }
 
     PG_TRY_CPP_RETURN({
         ForeignServer *server = GetForeignServer(serverOid);
@@ -1694,13 +6205,11 @@ levelPivotImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
         level_pivot::SchemaDiscovery discovery(connection);
 
         /* Infer pattern by analyzing key structure across samples */
-        auto pattern_str = discovery.infer_pattern(1000);
+        auto pattern_str = discovery.infer_pattern(1000, opts.probes, opts.threads);
 
         if (pattern_str)
         {
             level_pivot::KeyPattern pattern(*pattern_str);
-            level_pivot::DiscoveryOptions opts;
-            opts.max_keys = 10000;
 
             auto result = discovery.discover(pattern, opts);
 
@@ -1710,7 +6219,7 @@ levelPivotImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
                 server->servername,
                 *pattern_str,
                 result,
-                true);
+                !infer_types);
 
             commands = lappend(commands, makeString(pstrdup(sql.c_str())));
         }
@@ -1719,4 +6228,310 @@ levelPivotImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
     }, NIL);
 }
 
+/**
+ * level_pivot_stats() - Cumulative counters for each foreign table of the
+ * current database, one row per table that has been scanned or modified
+ * since the server started or the stats were last reset
+ */
+Datum
+levelPivotStats(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    InitMaterializedSRF(fcinfo, 0);
+
+    std::vector<std::pair<uint64_t, level_pivot::TableCounters>> tables;
+    PG_TRY_CPP({
+        tables = get_table_metrics()->read();
+    });
+
+    for (const auto& [id, counters] : tables) {
+        if ((id >> 32) != MyDatabaseId)
+            continue;
+
+        const level_pivot::TableCounters& c = counters;
+        Datum values[15];
+        bool nulls[15] = {false};
+        values[0] = ObjectIdGetDatum(static_cast<Oid>(id & 0xFFFFFFFF));
+        values[1] = Int64GetDatum(c.scans);
+        values[2] = Int64GetDatum(c.keys_scanned);
+        values[3] = Int64GetDatum(c.keys_skipped);
+        values[4] = Int64GetDatum(c.seeks);
+        values[5] = Int64GetDatum(c.gets);
+        values[6] = Int64GetDatum(c.rows_returned);
+        values[7] = Int64GetDatum(c.bytes_read);
+        values[8] = Int64GetDatum(c.rows_inserted);
+        values[9] = Int64GetDatum(c.rows_updated);
+        values[10] = Int64GetDatum(c.rows_deleted);
+        values[11] = Int64GetDatum(c.keys_written);
+        values[12] = Int64GetDatum(c.keys_deleted);
+        values[13] = Int64GetDatum(c.write_batches);
+        values[14] = Int64GetDatum(c.batch_keys);
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+    }
+
+    return (Datum) 0;
+}
+
+/**
+ * level_pivot_stats_reset() - Zero every table's counters, in all databases
+ */
+Datum
+levelPivotStatsReset(PG_FUNCTION_ARGS)
+{
+    PG_TRY_CPP({
+        get_table_metrics()->reset();
+    });
+    PG_RETURN_VOID();
+}
+
+/* LevelDB properties level_pivot_db_properties() reports, when present */
+static const char *const DB_PROPERTIES[] = {
+    "leveldb.stats",
+    "leveldb.sstables",
+    "leveldb.approximate-memory-usage",
+    "leveldb.num-files-at-level0",
+    "leveldb.num-files-at-level1",
+    "leveldb.num-files-at-level2",
+    "leveldb.num-files-at-level3",
+    "leveldb.num-files-at-level4",
+    "leveldb.num-files-at-level5",
+    "leveldb.num-files-at-level6",
+};
+
+/* Error out unless server belongs to the level_pivot wrapper */
+static void
+check_level_pivot_server(ForeignServer *server)
+{
+    ForeignDataWrapper *fdw = GetForeignDataWrapper(server->fdwid);
+    const char *handler = OidIsValid(fdw->fdwhandler) ? get_func_name(fdw->fdwhandler) : NULL;
+    if (handler == NULL || strcmp(handler, "level_pivot_fdw_handler") != 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_WRONG_OBJECT_TYPE),
+                 errmsg("server \"%s\" is not a level_pivot server",
+                        server->servername)));
+}
+
+/**
+ * level_pivot_db_properties(server) - LevelDB's own view of a server's
+ * database: compaction stats per level, the sstables and memory usage.
+ * Opens the database if no query has yet; needs USAGE on the server.
+ */
+Datum
+levelPivotDbProperties(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    ForeignServer *server = GetForeignServerByName(NameStr(*PG_GETARG_NAME(0)), false);
+    check_level_pivot_server(server);
+
+    AclResult aclresult = object_aclcheck(ForeignServerRelationId, server->serverid,
+                                          GetUserId(), ACL_USAGE);
+    if (aclresult != ACLCHECK_OK)
+        aclcheck_error(aclresult, OBJECT_FOREIGN_SERVER, server->servername);
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    std::vector<std::pair<const char *, std::string>> properties;
+    PG_TRY_CPP({
+        auto connection = level_pivot::ConnectionManager::instance()
+            .get_connection(server->serverid, get_server_options(server));
+        for (const char *name : DB_PROPERTIES) {
+            auto value = connection->property(name);
+            if (value)
+                properties.emplace_back(name, std::move(*value));
+        }
+    });
+
+    for (const auto& [name, value] : properties) {
+        Datum values[2];
+        bool nulls[2] = {false, false};
+        values[0] = CStringGetTextDatum(name);
+        values[1] = varlena_datum(value);
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+    }
+
+    return (Datum) 0;
+}
+
+/**
+ * level_pivot_rebuild_index(table) - Recreate a pivot table's secondary
+ * index entries (index_attrs) from its keys, for data written before the
+ * index was declared or by other programs. Needs UPDATE on the table,
+ * whose writes it blocks while it runs. Returns the entries written.
+ */
+Datum
+levelPivotRebuildIndex(PG_FUNCTION_ARGS)
+{
+    Oid relid = PG_GETARG_OID(0);
+
+    if (get_rel_relkind(relid) != RELKIND_FOREIGN_TABLE)
+        ereport(ERROR,
+                (errcode(ERRCODE_WRONG_OBJECT_TYPE),
+                 errmsg("\"%s\" is not a foreign table", get_rel_name(relid))));
+
+    AclResult aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_UPDATE);
+    if (aclresult != ACLCHECK_OK)
+        aclcheck_error(aclresult, OBJECT_FOREIGN_TABLE, get_rel_name(relid));
+
+    ForeignTable *table = GetForeignTable(relid);
+    ForeignServer *server = GetForeignServer(table->serverid);
+    check_level_pivot_server(server);
+
+    if (get_table_mode(table) != TableMode::PIVOT ||
+        get_table_option(table, "index_attrs").empty())
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("foreign table \"%s\" has no secondary index", get_rel_name(relid)),
+                 errhint("Set the index_attrs option of a pivot table.")));
+
+    if (get_server_options(server).read_only)
+        ereport(ERROR,
+                (errcode(ERRCODE_FDW_ERROR),
+                 errmsg("server \"%s\" is read-only", server->servername)));
+
+    /* ShareLock keeps INSERT, UPDATE and DELETE out until the rebuild ends */
+    Relation rel = table_open(relid, ShareLock);
+    int64 written = 0;
+    PG_TRY_CPP({
+        ProjectionHandle projection = acquire_projection(rel, get_table_option(table, "key_pattern"));
+        auto index = get_secondary_index(table, rel, projection->parser().pattern());
+        auto connection = level_pivot::ConnectionManager::instance()
+            .get_connection(server->serverid, get_server_options(server));
+        written = static_cast<int64>(index->rebuild(*connection, projection->parser())
+                                         .entries_written);
+    });
+    table_close(rel, NoLock);
+
+    PG_RETURN_INT64(written);
+}
+
+/**
+ * Called from _PG_init: define the scan and write GUCs, hook transaction
+ * end for transaction-scope snapshots and writes and invalidate cached
+ * projections on ALTER.
+ */
+void
+levelPivotScanInit(void)
+{
+    DefineCustomEnumVariable("level_pivot.snapshot",
+                             "How long reads of a LevelDB database share one snapshot.",
+                             "statement gives each statement a consistent view; "
+                             "transaction keeps it for the rest of the transaction, "
+                             "until the transaction writes to that database.",
+                             &snapshot_scope,
+                             static_cast<int>(SnapshotScope::STATEMENT),
+                             snapshot_scope_options,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomEnumVariable("level_pivot.fill_cache",
+                             "Whether scans keep the blocks they read in the LevelDB block cache.",
+                             "auto turns caching off for scans expected to read a whole "
+                             "table larger than the cache. The fill_cache table option "
+                             "overrides this.",
+                             &fill_cache_mode,
+                             static_cast<int>(FillCache::AUTO),
+                             fill_cache_options,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomBoolVariable("level_pivot.verify_checksums",
+                             "Verify the checksum of every LevelDB block scans read.",
+                             "The verify_checksums table option overrides this.",
+                             &verify_checksums,
+                             false,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomEnumVariable("level_pivot.prefetch",
+                             "Whether scans read LevelDB ahead on a background thread.",
+                             "The thread fetches and decompresses the next keys while the "
+                             "backend builds tuples from the previous ones. auto does this "
+                             "for scans expected to read a whole table. Brokered databases "
+                             "are never prefetched. The prefetch table option overrides this.",
+                             &prefetch_mode,
+                             static_cast<int>(FillCache::OFF),
+                             fill_cache_options,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomIntVariable("level_pivot.prefetch_batch_size",
+                            "Keys per batch a prefetching scan reads ahead.",
+                            "Up to four batches are kept ready. The prefetch_batch_size "
+                            "table option overrides this.",
+                            &prefetch_batch_size,
+                            256,
+                            1,
+                            1024 * 1024,
+                            PGC_USERSET,
+                            0,
+                            NULL, NULL, NULL);
+
+    DefineCustomBoolVariable("level_pivot.notify_payload",
+                             "Say which rows changed in change notifications.",
+                             "The payload is JSON listing changed row identities, "
+                             "summarized by prefix past level_pivot.notify_max_rows.",
+                             &notify_payload,
+                             false,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomIntVariable("level_pivot.notify_max_rows",
+                            "Rows a change notification lists before summarizing them.",
+                            NULL,
+                            &notify_max_rows,
+                            100,
+                            1,
+                            100000,
+                            PGC_USERSET,
+                            0,
+                            NULL, NULL, NULL);
+
+    DefineCustomEnumVariable("level_pivot.write_scope",
+                             "When writes to a LevelDB database are committed.",
+                             "statement commits each statement's writes as it ends; "
+                             "transaction holds them in memory, visible to the "
+                             "transaction's own reads, and commits them at COMMIT.",
+                             &write_scope,
+                             static_cast<int>(WriteScope::STATEMENT),
+                             write_scope_options,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    DefineCustomIntVariable("level_pivot.pending_write_limit",
+                            "Memory each LevelDB database's pending writes may use.",
+                            "Applies when level_pivot.write_scope is transaction.",
+                            &pending_write_limit,
+                            64 * 1024,
+                            1,
+                            INT_MAX / 1024,
+                            PGC_USERSET,
+                            GUC_UNIT_KB,
+                            NULL, NULL, NULL);
+
+    DefineCustomEnumVariable("level_pivot.pending_write_overflow",
+                             "What a write past level_pivot.pending_write_limit does.",
+                             "error fails it, aborting the transaction; spill commits "
+                             "the pending writes early and keeps buffering, giving up "
+                             "atomicity for what was spilled.",
+                             &pending_write_overflow,
+                             static_cast<int>(level_pivot::OverflowAction::FAIL),
+                             pending_write_overflow_options,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    RegisterXactCallback(level_pivot_xact_callback, NULL);
+    RegisterSubXactCallback(level_pivot_subxact_callback, NULL);
+
+    CacheRegisterRelcacheCallback(projection_cache_relcache_callback, (Datum) 0);
+    CacheRegisterSyscacheCallback(FOREIGNTABLEREL, projection_cache_syscache_callback,
+                                  (Datum) 0);
+}
+
 } /* extern "C" */
@@ -10,11 +10,30 @@
  *   - block_cache_size: LevelDB block cache size (supports K/M/G suffixes)
  *   - write_buffer_size: LevelDB write buffer size
  *   - use_write_batch: Enable atomic batched writes (default true)
+ *   - batch_size: Rows per batch insert (default 1, table can override)
+ *   - bloom_bits_per_key: Bloom filter bits per key (default 10, 0 = none)
+ *   - block_size, max_file_size: LevelDB block and table file sizes
+ *   - max_open_files: Table files LevelDB keeps open
+ *   - compression: 'none', 'snappy' (default) or 'zstd'
  *
  * Table options (CREATE FOREIGN TABLE ... OPTIONS):
  *   - key_pattern (required for pivot mode): Key pattern with placeholders
  *   - prefix_filter: Optional prefix to filter keys
  *   - table_mode: 'pivot' (default) or 'raw'
+ *   - batch_size: Rows per batch insert, overrides the server setting
+ *   - fill_cache: 'true', 'false' or 'auto'; overrides level_pivot.fill_cache
+ *   - verify_checksums: Check block checksums on scans; overrides
+ *     level_pivot.verify_checksums
+ *   - prefetch: 'true', 'false' or 'auto'; overrides level_pivot.prefetch
+ *   - prefetch_batch_size: Keys per read-ahead batch; overrides
+ *     level_pivot.prefetch_batch_size
+ *   - fixed_attrs: Rows have no attrs beyond the declared columns, so
+ *     point lookups may get attr keys directly
+ *   - sorted_identities: Identity values sort like their keys, so scans
+ *     count as ordered by the leading identity columns (default false)
+ *   - index_attrs: Comma-separated attr columns the writer keeps secondary
+ *     index entries for
+ *   - index_name: Name in the index's keys (default: the table's name)
  *
  * Validation catches errors early with helpful error messages.
  */
@@ -29,9 +48,12 @@ extern "C" {
 #include "catalog/pg_foreign_table.h"
 }
 
+#include "level_pivot/connection_manager.hpp"
 #include "level_pivot/key_pattern.hpp"
+#include "level_pivot/secondary_index.hpp"
 #include <string>
 #include <unordered_set>
+#include <climits>
 #include <cstring>
 
 namespace {
@@ -43,14 +65,29 @@ const std::unordered_set<std::string> server_options = {
     "create_if_missing",
     "block_cache_size",
     "write_buffer_size",
-    "use_write_batch"
+    "use_write_batch",
+    "batch_size",
+    "bloom_bits_per_key",
+    "block_size",
+    "max_open_files",
+    "compression",
+    "max_file_size"
 };
 
 /* Whitelist of valid FOREIGN TABLE options */
 const std::unordered_set<std::string> table_options = {
     "key_pattern",
     "prefix_filter",
-    "table_mode"
+    "table_mode",
+    "batch_size",
+    "fill_cache",
+    "verify_checksums",
+    "prefetch",
+    "prefetch_batch_size",
+    "fixed_attrs",
+    "sorted_identities",
+    "index_attrs",
+    "index_name"
 };
 
 /**
@@ -78,6 +115,36 @@ bool is_valid_size(const char* value) {
     return num >= 0;
 }
 
+/**
+ * Validates positive integer option values (batch_size).
+ * No suffixes; the value must fit in an int.
+ */
+bool is_valid_positive_int(const char* value) {
+    char* end;
+    long long num = strtoll(value, &end, 10);
+    return end != value && *end == '\0' && num > 0 && num <= INT_MAX;
+}
+
+/**
+ * Validates non-negative integer option values (bloom_bits_per_key).
+ */
+bool is_valid_non_negative_int(const char* value) {
+    char* end;
+    long long num = strtoll(value, &end, 10);
+    return end != value && *end == '\0' && num >= 0 && num <= INT_MAX;
+}
+
+/* Shared check for batch_size, accepted on both servers and tables */
+void validate_batch_size(DefElem* def, const char* value) {
+    if (!is_valid_positive_int(value))
+    {
+        ereport(ERROR,
+            (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+             errmsg("invalid value for %s: \"%s\"", def->defname, value),
+             errhint("Use a positive integer")));
+    }
+}
+
 } // anonymous namespace
 
 extern "C" {
@@ -110,7 +177,8 @@ void levelPivotValidateOptions(List *options_list, Oid catalog)
                      errmsg("invalid option \"%s\" for SERVER", def->defname),
                      errhint("Valid options are: db_path, read_only, "
                             "create_if_missing, block_cache_size, write_buffer_size, "
-                            "use_write_batch")));
+                            "use_write_batch, batch_size, bloom_bits_per_key, "
+                            "block_size, max_open_files, compression, max_file_size")));
             }
 
             const char* value = defGetString(def);
@@ -136,7 +204,8 @@ void levelPivotValidateOptions(List *options_list, Oid catalog)
                          errhint("Use 'true' or 'false'")));
                 }
             }
-            else if (name == "block_cache_size" || name == "write_buffer_size")
+            else if (name == "block_cache_size" || name == "write_buffer_size" ||
+                     name == "block_size" || name == "max_file_size")
             {
                 if (!is_valid_size(value))
                 {
@@ -147,6 +216,48 @@ void levelPivotValidateOptions(List *options_list, Oid catalog)
                          errhint("Use a positive integer, optionally with K/M/G suffix")));
                 }
             }
+            else if (name == "batch_size")
+            {
+                validate_batch_size(def, value);
+            }
+            else if (name == "max_open_files")
+            {
+                if (!is_valid_positive_int(value))
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for %s: \"%s\"", def->defname, value),
+                         errhint("Use a positive integer")));
+                }
+            }
+            else if (name == "bloom_bits_per_key")
+            {
+                if (!is_valid_non_negative_int(value))
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for %s: \"%s\"", def->defname, value),
+                         errhint("Use a non-negative integer; 0 disables the bloom filter")));
+                }
+            }
+            else if (name == "compression")
+            {
+                auto compression = level_pivot::parse_compression(value);
+                if (!compression)
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for compression: \"%s\"", value),
+                         errhint("Valid values are 'none', 'snappy' or 'zstd'")));
+                }
+                if (!level_pivot::compression_supported(*compression))
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("compression \"%s\" is not supported", value),
+                         errdetail("level_pivot was built against a LevelDB without zstd support.")));
+                }
+            }
         }
         else if (catalog == ForeignTableRelationId)
         {
@@ -156,7 +267,10 @@ void levelPivotValidateOptions(List *options_list, Oid catalog)
                 ereport(ERROR,
                     (errcode(ERRCODE_FDW_INVALID_OPTION_NAME),
                      errmsg("invalid option \"%s\" for FOREIGN TABLE", def->defname),
-                     errhint("Valid options are: key_pattern, prefix_filter, table_mode")));
+                     errhint("Valid options are: key_pattern, prefix_filter, table_mode, "
+                            "batch_size, fill_cache, verify_checksums, prefetch, "
+                            "prefetch_batch_size, fixed_attrs, sorted_identities, "
+                            "index_attrs, index_name")));
             }
 
             const char* value = defGetString(def);
@@ -194,6 +308,62 @@ void levelPivotValidateOptions(List *options_list, Oid catalog)
                          errhint("Valid values are 'raw' or 'pivot'")));
                 }
             }
+            else if (name == "batch_size")
+            {
+                validate_batch_size(def, value);
+            }
+            else if (name == "fill_cache" || name == "prefetch")
+            {
+                if (!is_valid_bool(value) && strcmp(value, "auto") != 0)
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for %s: \"%s\"", def->defname, value),
+                         errhint("Use 'true', 'false' or 'auto'")));
+                }
+            }
+            else if (name == "prefetch_batch_size")
+            {
+                if (!is_valid_positive_int(value) || strtol(value, NULL, 10) > 1024 * 1024)
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for prefetch_batch_size: \"%s\"", value),
+                         errhint("Use a key count between 1 and 1048576")));
+                }
+            }
+            else if (name == "index_attrs")
+            {
+                if (level_pivot::SecondaryIndex::parse_attr_list(value).empty())
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for index_attrs: \"%s\"", value),
+                         errhint("Use a comma-separated list of attr column names")));
+                }
+            }
+            else if (name == "index_name")
+            {
+                if (*value == '\0' || strstr(value, "##") != NULL)
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for index_name: \"%s\"", value),
+                         errhint("Use a non-empty name without \"##\"")));
+                }
+            }
+            else if (name == "verify_checksums" || name == "fixed_attrs" ||
+                     name == "sorted_identities")
+            {
+                if (!is_valid_bool(value))
+                {
+                    ereport(ERROR,
+                        (errcode(ERRCODE_FDW_INVALID_ATTRIBUTE_VALUE),
+                         errmsg("invalid value for %s: \"%s\"",
+                               def->defname, value),
+                         errhint("Use 'true' or 'false'")));
+                }
+            }
         }
     }
 
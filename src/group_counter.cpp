@@ -0,0 +1,206 @@
+/**
+ * group_counter.cpp - Streaming COUNT(*) over pivot rows
+ *
+ * SELECT count(*) ... GROUP BY group_name through a regular scan builds
+ * every pivot row, converts it to a tuple and hands it to an Agg node.
+ * None of that is needed to count rows: a row starts wherever a key's
+ * identity differs from the previous key's, and a group ends where its
+ * leading capture values change. Both comparisons are on views into the
+ * current key.
+ *
+ * Only the current row's identity is copied, since the iterator's key
+ * memory doesn't survive next().
+ */
+
+#include "level_pivot/group_counter.hpp"
+
+namespace level_pivot {
+
+GroupCounter::GroupCounter(const KeyParser& parser,
+                           std::shared_ptr<LevelDBConnection> connection,
+                           size_t group_captures)
+    : parser_(parser),
+      connection_(std::move(connection)),
+      group_captures_(group_captures),
+      seek_supported_(parser.pattern().has_attr() &&
+                      captures_before_attr(parser.pattern()) ==
+                          parser.pattern().capture_names().size()) {}
+
+void GroupCounter::begin_scan(const std::vector<KeyRange>& ranges) {
+    stats_ = Stats{};
+    ranges_ = ranges;
+    range_index_ = 0;
+    has_identity_ = false;
+    has_group_ = false;
+    emitted_any_ = false;
+
+    iterator_ = std::make_unique<LevelDBIterator>(connection_->iterator(scan_options_));
+    if (ranges_.empty()) {
+        return;
+    }
+    if (ranges_[0].start.empty()) {
+        iterator_->seek_to_first();
+    } else {
+        iterator_->seek(ranges_[0].start);
+    }
+}
+
+const GroupCount* GroupCounter::next_group() {
+    while (iterator_ && iterator_->valid()) {
+        std::string_view key = iterator_->key_view();
+        if (!is_within_range(key)) {
+            if (!next_range()) {
+                break;
+            }
+            continue;
+        }
+
+        ++stats_.keys_scanned;
+        if (!parser_.parse_view_into(key, parsed_)) {
+            iterator_->next();
+            continue;
+        }
+
+        // Another key of the row just counted
+        if (has_identity_ && same_identity()) {
+            iterator_->next();
+            continue;
+        }
+
+        const GroupCount* finished = nullptr;
+        if (has_group_ && !same_group()) {
+            finished = emit_group();
+        }
+        if (!has_group_) {
+            start_group();
+        }
+        count_row();
+        skip_row();
+        if (finished) {
+            return finished;
+        }
+    }
+
+    if (has_group_) {
+        return emit_group();
+    }
+    if (group_captures_ == 0 && !emitted_any_) {
+        emitted_any_ = true;
+        emitted_.group_values.clear();
+        emitted_.count = 0;
+        return &emitted_;
+    }
+    return nullptr;
+}
+
+/**
+ * Keys are only read at or after the current range's start, as in
+ * PivotScanner
+ */
+bool GroupCounter::is_within_range(std::string_view key) const {
+    if (range_index_ >= ranges_.size()) {
+        return false;
+    }
+    const std::string& end = ranges_[range_index_].end;
+    return end.empty() || key < end;
+}
+
+bool GroupCounter::next_range() {
+    if (range_index_ < ranges_.size()) {
+        ++range_index_;
+    }
+    if (range_index_ >= ranges_.size()) {
+        return false;
+    }
+
+    const std::string& start = ranges_[range_index_].start;
+    if (iterator_->valid() && iterator_->key_view() < start) {
+        iterator_->seek(start);
+    }
+    return true;
+}
+
+bool GroupCounter::same_identity() const {
+    const auto& values = parsed_.capture_values;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i] != identity_[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GroupCounter::same_group() const {
+    for (size_t i = 0; i < group_captures_; ++i) {
+        if (parsed_.capture_values[i] != current_.group_values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GroupCounter::start_group() {
+    current_.group_values.resize(group_captures_);
+    for (size_t i = 0; i < group_captures_; ++i) {
+        current_.group_values[i].assign(parsed_.capture_values[i]);
+    }
+    current_.count = 0;
+    has_group_ = true;
+}
+
+void GroupCounter::count_row() {
+    const auto& values = parsed_.capture_values;
+    identity_.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        identity_[i].assign(values[i]);
+    }
+    has_identity_ = true;
+    ++current_.count;
+    ++stats_.rows_counted;
+}
+
+/**
+ * Moves past the row whose first key is current. The next key often
+ * starts the next row already (narrow rows), so try that before seeking.
+ */
+void GroupCounter::skip_row() {
+    if (!seek_supported_) {
+        iterator_->next();
+        return;
+    }
+
+    // Resolve before next(), which invalidates parsed_'s views
+    std::string_view key = iterator_->key_view();
+    seek_target_.assign(key.data(),
+                        static_cast<size_t>(parsed_.attr_name.data() - key.data()));
+
+    iterator_->next();
+    if (!iterator_->valid()) {
+        return;
+    }
+    key = iterator_->key_view();
+    if (key.size() < seek_target_.size() ||
+        key.compare(0, seek_target_.size(), seek_target_) != 0) {
+        return;
+    }
+
+    seek_target_ = KeyParser::prefix_successor(seek_target_);
+    if (seek_target_.empty()) {
+        return;  // No successor; the remaining keys are stepped through
+    }
+    iterator_->seek(seek_target_);
+    ++stats_.seeks;
+}
+
+/**
+ * Hands the current group out by swapping buffers, so the next group
+ * reuses the capacity of the one before it
+ */
+const GroupCount* GroupCounter::emit_group() {
+    std::swap(current_, emitted_);
+    has_group_ = false;
+    emitted_any_ = true;
+    return &emitted_;
+}
+
+} // namespace level_pivot
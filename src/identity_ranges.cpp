@@ -0,0 +1,260 @@
+/**
+ * identity_ranges.cpp - Key ranges for identity column predicates
+ *
+ * Prefix pushdown turns "group_name = 'admins'" into one seek, but only
+ * for equality on a leading run of captures. Here IN lists and ranges
+ * become a list of key ranges instead:
+ *
+ *   group_name IN ('admins', 'staff')   ->  [users##admins##, users##admins#$)
+ *                                           [users##staff##,  users##staff#$)
+ *   group_name = 'a' AND id >= 'u5'     ->  [users##a##u5,    users##a#$)
+ *   group_name LIKE 'adm%'              ->  [users##adm,      users##adn)
+ *
+ * Key order isn't quite value order: a value's keys continue with the
+ * delimiter after it, so "a" + "##..." can sort after "a!". Lower bounds
+ * are safe as-is (every value >= L has keys >= prefix + L), but an upper
+ * bound U must also cover the keys of every proper prefix of U, which is
+ * why upper_range_end() checks each one.
+ */
+
+#include "level_pivot/identity_ranges.hpp"
+#include <algorithm>
+#include <variant>
+
+namespace level_pivot {
+
+namespace {
+
+/**
+ * Exclusive end covering the keys of every value <= upper under the
+ * prefix built from values
+ */
+std::string upper_range_end(const KeyParser& parser, std::vector<std::string>& values,
+                            const std::string& upper) {
+    std::string end = KeyParser::prefix_successor(parser.build_prefix(values) + upper);
+    if (end.empty()) {
+        return end;
+    }
+
+    for (size_t len = 1; len < upper.size(); ++len) {
+        values.push_back(upper.substr(0, len));
+        std::string candidate = KeyParser::prefix_successor(parser.build_prefix(values));
+        values.pop_back();
+        if (candidate.empty()) {
+            return candidate;
+        }
+        end = std::max(end, candidate);
+    }
+    return end;
+}
+
+/**
+ * Allowed values that also satisfy the bounds, sorted and deduplicated
+ */
+std::vector<std::string> allowed_values(const IdentityConstraint& constraint) {
+    std::vector<std::string> values;
+    for (const auto& value : constraint.values) {
+        if (constraint.lower && value < *constraint.lower) {
+            continue;
+        }
+        if (constraint.upper && value > *constraint.upper) {
+            continue;
+        }
+        if (constraint.prefix && value.compare(0, constraint.prefix->size(), *constraint.prefix) != 0) {
+            continue;
+        }
+        values.push_back(value);
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
+
+bool overlaps_or_touches(const KeyRange& earlier, const KeyRange& later) {
+    return earlier.end.empty() || later.start <= earlier.end;
+}
+
+/**
+ * The earlier of two exclusive ends, where empty means unbounded
+ */
+std::string min_end(const std::string& a, const std::string& b) {
+    if (a.empty()) {
+        return b;
+    }
+    if (b.empty()) {
+        return a;
+    }
+    return std::min(a, b);
+}
+
+} // anonymous namespace
+
+size_t captures_before_attr(const KeyPattern& pattern) {
+    size_t count = 0;
+    for (const auto& segment : pattern.segments()) {
+        if (std::holds_alternative<AttrSegment>(segment)) {
+            break;
+        }
+        if (std::holds_alternative<CaptureSegment>(segment)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::optional<std::vector<std::vector<std::string>>>
+build_point_identities(const KeyParser& parser,
+                       const std::vector<IdentityConstraint>& constraints,
+                       size_t max_identities) {
+    size_t capture_count = parser.pattern().capture_names().size();
+    if (constraints.size() < capture_count) {
+        return std::nullopt;
+    }
+
+    std::vector<std::vector<std::string>> identities(1);
+    for (size_t i = 0; i < capture_count; ++i) {
+        if (!constraints[i].has_values()) {
+            return std::nullopt;
+        }
+        std::vector<std::string> values = allowed_values(constraints[i]);
+        if (identities.size() * values.size() > max_identities) {
+            return std::nullopt;
+        }
+
+        std::vector<std::vector<std::string>> expanded;
+        expanded.reserve(identities.size() * values.size());
+        for (const auto& identity : identities) {
+            for (const auto& value : values) {
+                expanded.push_back(identity);
+                expanded.back().push_back(value);
+            }
+        }
+        identities = std::move(expanded);
+    }
+
+    return identities;
+}
+
+bool prefix_selects_exactly(const KeyPattern& pattern, size_t capture_index,
+                            const std::string& prefix) {
+    const auto& segments = pattern.segments();
+    size_t seen = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (std::holds_alternative<AttrSegment>(segments[i])) {
+            return false;
+        }
+        if (!std::holds_alternative<CaptureSegment>(segments[i])) {
+            continue;
+        }
+        if (seen++ != capture_index) {
+            continue;
+        }
+        if (i + 1 >= segments.size()) {
+            return false;
+        }
+        const auto* literal = std::get_if<LiteralSegment>(&segments[i + 1]);
+        if (!literal || literal->text.empty()) {
+            return false;
+        }
+        return prefix.find(literal->text[0]) == std::string::npos;
+    }
+    return false;
+}
+
+KeyRange prefix_range(const std::string& prefix) {
+    return KeyRange{prefix, KeyParser::prefix_successor(prefix)};
+}
+
+std::vector<KeyRange> build_identity_ranges(const KeyParser& parser,
+                                            const std::vector<IdentityConstraint>& constraints,
+                                            size_t max_ranges) {
+    size_t capture_count = captures_before_attr(parser.pattern());
+    std::vector<std::vector<std::string>> prefixes(1);
+    std::vector<KeyRange> ranges;
+    bool bounded = false;
+
+    for (size_t i = 0; i < constraints.size() && i < capture_count; ++i) {
+        const auto& constraint = constraints[i];
+
+        if (constraint.has_values()) {
+            std::vector<std::string> values = allowed_values(constraint);
+            if (values.empty()) {
+                return {};
+            }
+            if (prefixes.size() * values.size() > max_ranges) {
+                break;
+            }
+
+            std::vector<std::vector<std::string>> expanded;
+            expanded.reserve(prefixes.size() * values.size());
+            for (const auto& prefix : prefixes) {
+                for (const auto& value : values) {
+                    expanded.push_back(prefix);
+                    expanded.back().push_back(value);
+                }
+            }
+            prefixes = std::move(expanded);
+            continue;
+        }
+
+        if (constraint.has_bounds() || constraint.has_prefix()) {
+            if (constraint.lower && constraint.upper && *constraint.lower > *constraint.upper) {
+                return {};
+            }
+            for (auto& prefix : prefixes) {
+                std::string base = parser.build_prefix(prefix);
+                KeyRange range = prefix_range(constraint.prefix ? base + *constraint.prefix : base);
+                if (constraint.lower) {
+                    range.start = std::max(range.start, base + *constraint.lower);
+                }
+                if (constraint.upper) {
+                    range.end = min_end(range.end, upper_range_end(parser, prefix, *constraint.upper));
+                }
+                ranges.push_back(std::move(range));
+            }
+            bounded = true;
+        }
+        break;
+    }
+
+    if (!bounded) {
+        for (const auto& prefix : prefixes) {
+            ranges.push_back(prefix_range(parser.build_prefix(prefix)));
+        }
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const KeyRange& a, const KeyRange& b) {
+        return a.start < b.start;
+    });
+
+    std::vector<KeyRange> merged;
+    for (auto& range : ranges) {
+        if (!range.end.empty() && range.start >= range.end) {
+            continue;
+        }
+        if (!merged.empty() && overlaps_or_touches(merged.back(), range)) {
+            auto& last = merged.back();
+            if (!last.end.empty() && (range.end.empty() || range.end > last.end)) {
+                last.end = range.end;
+            }
+            continue;
+        }
+        merged.push_back(std::move(range));
+    }
+    return merged;
+}
+
+std::vector<KeyRange> clip_key_ranges(const std::vector<KeyRange>& ranges,
+                                      const std::string& start,
+                                      const std::string& end) {
+    std::vector<KeyRange> clipped;
+    for (const auto& range : ranges) {
+        KeyRange part{std::max(range.start, start), min_end(range.end, end)};
+        if (part.end.empty() || part.start < part.end) {
+            clipped.push_back(std::move(part));
+        }
+    }
+    return clipped;
+}
+
+} // namespace level_pivot
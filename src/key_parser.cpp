@@ -10,7 +10,8 @@
  * The parser also builds keys from values (for INSERT/UPDATE/DELETE operations).
  *
  * Performance optimizations:
- *   - SIMD-accelerated parsing for uniform delimiter patterns (AVX2/SSE2)
+ *   - SIMD-accelerated parsing for patterns ending in {attr}
+ *     (AVX-512BW/AVX2/SSE2/NEON)
  *   - Zero-copy parse_view() returns string_views into the original key
  *   - Pre-computed key size estimates reduce allocations
  */
@@ -93,9 +94,9 @@ struct ParsePolicy<ParsedKeyView> {
  * (either at the next literal or end of string).
  */
 template<typename ResultType>
-std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view key) {
+bool parse_into(const KeyPattern& pattern, std::string_view key, ResultType& result) {
     const auto& segments = pattern.segments();
-    ResultType result;
+    result.capture_values.clear();
     result.capture_values.reserve(pattern.capture_count());
 
     size_t key_pos = 0;
@@ -108,7 +109,7 @@ std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view
             const auto& literal = std::get<LiteralSegment>(segment);
 
             if (key.compare(key_pos, literal.text.size(), literal.text) != 0) {
-                return std::nullopt;
+                return false;
             }
             key_pos += literal.text.size();
 
@@ -122,7 +123,7 @@ std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view
                 const auto& next_literal = std::get<LiteralSegment>(segments[seg_idx + 1]);
                 end_pos = key.find(next_literal.text, key_pos);
                 if (end_pos == std::string_view::npos) {
-                    return std::nullopt;
+                    return false;
                 }
             } else {
                 end_pos = key.size();
@@ -130,7 +131,7 @@ std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view
 
             // Empty captures are invalid - they'd create ambiguous keys
             if (end_pos == key_pos) {
-                return std::nullopt;
+                return false;
             }
 
             ParsePolicy<ResultType>::add_capture(result, key, key_pos, end_pos - key_pos);
@@ -144,14 +145,14 @@ std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view
                 const auto& next_literal = std::get<LiteralSegment>(segments[seg_idx + 1]);
                 end_pos = key.find(next_literal.text, key_pos);
                 if (end_pos == std::string_view::npos) {
-                    return std::nullopt;
+                    return false;
                 }
             } else {
                 end_pos = key.size();
             }
 
             if (end_pos == key_pos) {
-                return std::nullopt;
+                return false;
             }
 
             ParsePolicy<ResultType>::set_attr(result, key, key_pos, end_pos - key_pos);
@@ -160,10 +161,15 @@ std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view
     }
 
     // Ensure we consumed the entire key - leftover chars mean pattern mismatch
-    if (key_pos != key.size()) {
+    return key_pos == key.size();
+}
+
+template<typename ResultType>
+std::optional<ResultType> parse_impl(const KeyPattern& pattern, std::string_view key) {
+    ResultType result;
+    if (!parse_into(pattern, key, result)) {
         return std::nullopt;
     }
-
     return result;
 }
 
@@ -179,23 +185,78 @@ std::optional<ParsedKey> KeyParser::parse(const std::string& key) const {
  * falling back to the generic implementation otherwise.
  */
 std::optional<ParsedKeyView> KeyParser::parse_view(std::string_view key) const {
-    // SIMD path: uses vectorized delimiter detection for patterns like
-    // "prefix##{a}##{b}##{attr}" where all delimiters are "##"
+    ParsedKeyView result;
+    if (!parse_view_into(key, result)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+/**
+ * Scanners call this once per key with the same ParsedKeyView, so after
+ * the first key the capture vector already has capacity and parsing does
+ * not touch the allocator.
+ */
+bool KeyParser::parse_view_into(std::string_view key, ParsedKeyView& out) const {
+    // SIMD path: vectorized search for the literals between captures,
+    // for patterns like "prefix##{a}##{b}##{attr}"
     if (simd_parser_) {
-        std::string_view captures[16];  // Stack-allocated, max 16 captures
+        std::string_view captures[SimdKeyParser::MAX_CAPTURES];
         std::string_view attr;
-        if (simd_parser_->parse_fast(key, captures, attr)) {
-            ParsedKeyView result;
-            result.capture_values.reserve(pattern_.capture_count());
-            for (size_t i = 0; i < pattern_.capture_count(); ++i) {
-                result.capture_values.push_back(captures[i]);
+        if (!simd_parser_->parse_fast(key, captures, attr)) {
+            return false;
+        }
+        out.capture_values.assign(captures, captures + pattern_.capture_count());
+        out.attr_name = attr;
+        return true;
+    }
+    return parse_into(pattern_, key, out);
+}
+
+/**
+ * The same walk as parse_into(), started at the attr segment
+ */
+bool KeyParser::parse_attr_view(std::string_view key, size_t attr_pos,
+                                std::string_view& attr) const {
+    const auto& segments = pattern_.segments();
+    if (pattern_.attr_index() < 0 || attr_pos > key.size()) {
+        return false;
+    }
+
+    size_t key_pos = attr_pos;
+    for (size_t seg_idx = static_cast<size_t>(pattern_.attr_index());
+         seg_idx < segments.size(); ++seg_idx) {
+        const auto& segment = segments[seg_idx];
+
+        if (std::holds_alternative<LiteralSegment>(segment)) {
+            const auto& literal = std::get<LiteralSegment>(segment);
+            if (key.compare(key_pos, literal.text.size(), literal.text) != 0) {
+                return false;
             }
-            result.attr_name = attr;
-            return result;
+            key_pos += literal.text.size();
+            continue;
         }
-        return std::nullopt;
+
+        size_t end_pos;
+        if (seg_idx + 1 < segments.size()) {
+            const auto& next_literal = std::get<LiteralSegment>(segments[seg_idx + 1]);
+            end_pos = key.find(next_literal.text, key_pos);
+            if (end_pos == std::string_view::npos) {
+                return false;
+            }
+        } else {
+            end_pos = key.size();
+        }
+        if (end_pos == key_pos) {
+            return false;
+        }
+        if (std::holds_alternative<AttrSegment>(segment)) {
+            attr = key.substr(key_pos, end_pos - key_pos);
+        }
+        key_pos = end_pos;
     }
-    return parse_impl<ParsedKeyView>(pattern_, key);
+
+    return key_pos == key.size();
 }
 
 /**
@@ -205,6 +266,18 @@ std::optional<ParsedKeyView> KeyParser::parse_view(std::string_view key) const {
  */
 std::string KeyParser::build(const std::vector<std::string>& capture_values,
                              const std::string& attr_name) const {
+    std::string result;
+    build_into(result, capture_values, attr_name);
+    return result;
+}
+
+/**
+ * Shared implementation for build(). Clearing rather than reassigning keeps
+ * out's capacity, so batch writers building thousands of keys allocate once.
+ */
+void KeyParser::build_into(std::string& out,
+                           const std::vector<std::string>& capture_values,
+                           const std::string& attr_name) const {
     if (capture_values.size() != pattern_.capture_count()) {
         throw std::invalid_argument(
             "Expected " + std::to_string(pattern_.capture_count()) +
@@ -215,14 +288,14 @@ std::string KeyParser::build(const std::vector<std::string>& capture_values,
         throw std::invalid_argument("attr_name cannot be empty");
     }
 
-    std::string result;
-    result.reserve(estimated_key_size_);
+    out.clear();
+    out.reserve(estimated_key_size_);
     size_t capture_idx = 0;
 
     // Reassemble the key by walking segments and substituting values
     for (const auto& segment : pattern_.segments()) {
         if (std::holds_alternative<LiteralSegment>(segment)) {
-            result += std::get<LiteralSegment>(segment).text;
+            out += std::get<LiteralSegment>(segment).text;
         } else if (std::holds_alternative<CaptureSegment>(segment)) {
             if (capture_values[capture_idx].empty()) {
                 throw std::invalid_argument(
@@ -230,14 +303,12 @@ std::string KeyParser::build(const std::vector<std::string>& capture_values,
                     std::get<CaptureSegment>(segment).name +
                     "' cannot be empty");
             }
-            result += capture_values[capture_idx];
+            out += capture_values[capture_idx];
             ++capture_idx;
         } else if (std::holds_alternative<AttrSegment>(segment)) {
-            result += attr_name;
+            out += attr_name;
         }
     }
-
-    return result;
 }
 
 /**
@@ -305,65 +376,61 @@ bool KeyParser::starts_with_prefix(const std::string& key) const {
 }
 
 /**
- * Checks if the pattern uses a single, uniform delimiter between all segments.
- * SIMD parsing can only be used for uniform delimiters because it searches
- * for a single delimiter pattern across the entire key.
- *
- * Examples:
- *   "prefix##{a}##{b}##{attr}" -> returns "##"
- *   "prefix##{a}__{b}##{attr}" -> returns nullopt (mixed ## and __)
+ * Increments the last byte that isn't 0xFF and drops everything after it.
+ * Bytes compare as unsigned in LevelDB's default comparator, so this gives
+ * the tightest exclusive bound for a prefix range.
  */
-std::optional<std::string> KeyParser::try_get_uniform_delimiter() const {
-    std::string delimiter;
-    bool first_literal = true;
-
-    for (size_t i = 0; i < pattern_.segments().size(); ++i) {
-        const auto& seg = pattern_.segments()[i];
-
-        if (std::holds_alternative<LiteralSegment>(seg)) {
-            const auto& lit = std::get<LiteralSegment>(seg).text;
-
-            // Skip the prefix - it's not a delimiter between captures
-            if (first_literal && i == 0) {
-                first_literal = false;
-                continue;
-            }
-
-            if (delimiter.empty()) {
-                delimiter = lit;
-            } else if (delimiter != lit) {
-                return std::nullopt;  // Non-uniform delimiters
-            }
-        } else {
-            if (first_literal) {
-                first_literal = false;
-            }
+std::string KeyParser::prefix_successor(const std::string& prefix) {
+    std::string result = prefix;
+    while (!result.empty()) {
+        unsigned char last = static_cast<unsigned char>(result.back());
+        if (last != 0xFF) {
+            result.back() = static_cast<char>(last + 1);
+            return result;
         }
+        result.pop_back();
     }
-
-    return delimiter.empty() ? std::nullopt : std::optional(delimiter);
+    return result;
 }
 
 /**
  * Initialize SIMD parser if the pattern supports it.
  * SIMD parsing provides ~3-5x speedup for key parsing by using vectorized
  * delimiter detection instead of byte-by-byte scanning.
+ *
+ * SimdKeyParser takes the literal before the first capture as the prefix
+ * and the literal after each capture as its separator, so any pattern of
+ * the form "prefix{a}sep{b}sep...{attr}" qualifies, whether or not the
+ * separators are alike (e.g. "users##{a}##{b}##{attr}" or
+ * "{tenant}:{env}/{attr}").
  */
 void KeyParser::try_init_simd_parser() {
-    auto uniform_delim = try_get_uniform_delimiter();
-    if (!uniform_delim) {
-        return;  // Non-uniform delimiters, can't use SIMD
+    const auto& segments = pattern_.segments();
+
+    // SimdKeyParser reads the last segment as {attr}
+    if (pattern_.attr_index() != static_cast<int>(segments.size()) - 1 ||
+        pattern_.capture_count() > SimdKeyParser::MAX_CAPTURES) {
+        return;
     }
 
-    // Store owned copies - SIMD parser needs stable string_views
-    simd_prefix_ = pattern_.literal_prefix();
-    simd_delimiter_ = *uniform_delim;
+    std::string prefix;
+    std::vector<std::string> separators;
+    size_t i = 0;
+    if (i < segments.size() && std::holds_alternative<LiteralSegment>(segments[i])) {
+        prefix = std::get<LiteralSegment>(segments[i]).text;
+        ++i;
+    }
+
+    // Captures, each followed by its separator, up to the attr
+    for (; i + 1 < segments.size(); i += 2) {
+        if (!std::holds_alternative<CaptureSegment>(segments[i]) ||
+            !std::holds_alternative<LiteralSegment>(segments[i + 1])) {
+            return;
+        }
+        separators.push_back(std::get<LiteralSegment>(segments[i + 1]).text);
+    }
 
-    simd_parser_ = std::make_unique<SimdKeyParser>(
-        simd_prefix_,
-        simd_delimiter_,
-        pattern_.capture_count()
-    );
+    simd_parser_ = std::make_unique<SimdKeyParser>(std::move(prefix), std::move(separators));
 }
 
 } // namespace level_pivot
@@ -164,7 +164,7 @@ bool KeyPattern::has_capture(const std::string& name) const {
 /**
  * Returns the position of a capture in the capture_names_ list.
  * This index maps directly to the order captures appear in parsed keys,
- * which is essential for building PivotRow::identity_values correctly.
+ * which is essential for building PivotRow identity values correctly.
  */
 int KeyPattern::capture_index(const std::string& name) const {
     auto it = std::find(capture_names_.begin(), capture_names_.end(), name);
@@ -5,11 +5,20 @@
  *   1. Registers the extension with PG_MODULE_MAGIC
  *   2. Exports handler and validator functions via PG_FUNCTION_INFO_V1
  *   3. Wires up the FdwRoutine with all callback implementations
+ *   4. Defines the GUCs and sets up the optional LevelDB broker worker
+ *      in _PG_init
+ *   5. Exports the monitoring functions (level_pivot_stats and friends)
  *
  * The FdwRoutine structure tells PostgreSQL which functions to call for:
  *   - Planning: GetForeignRelSize, GetForeignPaths, GetForeignPlan
+ *   - Aggregate pushdown: GetForeignUpperPaths
  *   - Scanning: BeginForeignScan, IterateForeignScan, EndForeignScan
- *   - Modifying: BeginForeignModify, ExecForeignInsert/Update/Delete
+ *   - Parallel scans: IsForeignScanParallelSafe, *DSMForeignScan
+ *   - Modifying: BeginForeignModify, ExecForeignInsert/Update/Delete,
+ *     ExecForeignBatchInsert
+ *   - Direct modify: PlanDirectModify, *DirectModify (set-based UPDATE and
+ *     DELETE without per-row callbacks)
+ *   - Statistics: AnalyzeForeignTable
  *   - Schema import: ImportForeignSchema
  *
  * Actual implementations are in fdw_handler.cpp to keep this file focused
@@ -20,6 +29,7 @@
 extern "C" {
 #include "postgres.h"
 #include "fmgr.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
@@ -28,6 +38,7 @@ extern "C" {
 #include "optimizer/pathnode.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "utils/guc.h"
 #include "utils/rel.h"
 
 PG_MODULE_MAGIC;
@@ -39,6 +50,20 @@ extern Datum level_pivot_fdw_validator(PG_FUNCTION_ARGS);
 PG_FUNCTION_INFO_V1(level_pivot_fdw_handler);
 PG_FUNCTION_INFO_V1(level_pivot_fdw_validator);
 
+/* Monitoring functions */
+extern Datum level_pivot_stats(PG_FUNCTION_ARGS);
+extern Datum level_pivot_stats_reset(PG_FUNCTION_ARGS);
+extern Datum level_pivot_db_properties(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(level_pivot_stats);
+PG_FUNCTION_INFO_V1(level_pivot_stats_reset);
+PG_FUNCTION_INFO_V1(level_pivot_db_properties);
+
+/* Secondary index maintenance */
+extern Datum level_pivot_rebuild_index(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(level_pivot_rebuild_index);
+
 /* FDW callback declarations (implemented in fdw_handler.cpp) */
 extern void levelPivotGetForeignRelSize(PlannerInfo *root,
                                         RelOptInfo *baserel,
@@ -53,6 +78,11 @@ extern ForeignScan *levelPivotGetForeignPlan(PlannerInfo *root,
                                              List *tlist,
                                              List *scan_clauses,
                                              Plan *outer_plan);
+extern void levelPivotGetForeignUpperPaths(PlannerInfo *root,
+                                           UpperRelationKind stage,
+                                           RelOptInfo *input_rel,
+                                           RelOptInfo *output_rel,
+                                           void *extra);
 extern void levelPivotBeginForeignScan(ForeignScanState *node, int eflags);
 extern TupleTableSlot *levelPivotIterateForeignScan(ForeignScanState *node);
 extern void levelPivotReScanForeignScan(ForeignScanState *node);
@@ -61,6 +91,21 @@ extern void levelPivotEndForeignScan(ForeignScanState *node);
 extern void levelPivotExplainForeignScan(ForeignScanState *node,
                                          ExplainState *es);
 
+extern bool levelPivotIsForeignScanParallelSafe(PlannerInfo *root,
+                                                RelOptInfo *rel,
+                                                RangeTblEntry *rte);
+extern Size levelPivotEstimateDSMForeignScan(ForeignScanState *node,
+                                             ParallelContext *pcxt);
+extern void levelPivotInitializeDSMForeignScan(ForeignScanState *node,
+                                               ParallelContext *pcxt,
+                                               void *coordinate);
+extern void levelPivotReInitializeDSMForeignScan(ForeignScanState *node,
+                                                 ParallelContext *pcxt,
+                                                 void *coordinate);
+extern void levelPivotInitializeWorkerForeignScan(ForeignScanState *node,
+                                                  shm_toc *toc,
+                                                  void *coordinate);
+
 extern void levelPivotAddForeignUpdateTargets(PlannerInfo *root,
                                               Index rtindex,
                                               RangeTblEntry *target_rte,
@@ -78,6 +123,12 @@ extern TupleTableSlot *levelPivotExecForeignInsert(EState *estate,
                                                    ResultRelInfo *rinfo,
                                                    TupleTableSlot *slot,
                                                    TupleTableSlot *planSlot);
+extern int levelPivotGetForeignModifyBatchSize(ResultRelInfo *rinfo);
+extern TupleTableSlot **levelPivotExecForeignBatchInsert(EState *estate,
+                                                         ResultRelInfo *rinfo,
+                                                         TupleTableSlot **slots,
+                                                         TupleTableSlot **planSlots,
+                                                         int *numSlots);
 extern TupleTableSlot *levelPivotExecForeignUpdate(EState *estate,
                                                    ResultRelInfo *rinfo,
                                                    TupleTableSlot *slot,
@@ -89,14 +140,63 @@ extern TupleTableSlot *levelPivotExecForeignDelete(EState *estate,
 extern void levelPivotEndForeignModify(EState *estate, ResultRelInfo *rinfo);
 extern int levelPivotIsForeignRelUpdatable(Relation rel);
 
+extern bool levelPivotPlanDirectModify(PlannerInfo *root,
+                                       ModifyTable *plan,
+                                       Index resultRelation,
+                                       int subplan_index);
+extern void levelPivotBeginDirectModify(ForeignScanState *node, int eflags);
+extern TupleTableSlot *levelPivotIterateDirectModify(ForeignScanState *node);
+extern void levelPivotEndDirectModify(ForeignScanState *node);
+extern void levelPivotExplainDirectModify(ForeignScanState *node,
+                                          ExplainState *es);
+
+extern int levelPivotAcquireSampleRows(Relation relation, int elevel,
+                                       HeapTuple *rows, int targrows,
+                                       double *totalrows,
+                                       double *totaldeadrows);
+extern bool levelPivotAnalyzeForeignTable(Relation relation,
+                                          AcquireSampleRowsFunc *func,
+                                          BlockNumber *totalpages);
+
 extern List *levelPivotImportForeignSchema(ImportForeignSchemaStmt *stmt,
                                            Oid serverOid);
 
 /* Validator function (implemented in fdw_validator.cpp) */
 extern void levelPivotValidateOptions(List *options_list, Oid catalog);
 
+/* Scan GUCs and transaction hook (implemented in fdw_handler.cpp) */
+extern void levelPivotScanInit(void);
+
+/* Monitoring (implemented in fdw_handler.cpp) */
+extern Datum levelPivotStats(PG_FUNCTION_ARGS);
+extern Datum levelPivotStatsReset(PG_FUNCTION_ARGS);
+extern Datum levelPivotDbProperties(PG_FUNCTION_ARGS);
+
+/* Secondary indexes (implemented in fdw_handler.cpp) */
+extern Datum levelPivotRebuildIndex(PG_FUNCTION_ARGS);
+
+/* Broker GUC and worker registration (implemented in broker_worker.cpp) */
+extern void levelPivotBrokerInit(void);
+
+void _PG_init(void);
+
 } /* extern "C" */
 
+/**
+ * Module load hook.
+ *
+ * Defines the level_pivot.* GUCs and sets up the broker; when the library
+ * is in shared_preload_libraries this runs in the postmaster, early enough
+ * to reserve shared memory and register the background worker.
+ */
+void
+_PG_init(void)
+{
+    levelPivotScanInit();
+    levelPivotBrokerInit();
+    MarkGUCPrefixReserved("level_pivot");
+}
+
 /**
  * FDW handler function - called by PostgreSQL to get our callback table.
  *
@@ -116,6 +216,9 @@ level_pivot_fdw_handler(PG_FUNCTION_ARGS)
     fdwroutine->GetForeignPaths = levelPivotGetForeignPaths;
     fdwroutine->GetForeignPlan = levelPivotGetForeignPlan;
 
+    /* Aggregate pushdown: count rows per group from the keys */
+    fdwroutine->GetForeignUpperPaths = levelPivotGetForeignUpperPaths;
+
     /* Scan execution: iterate through rows from LevelDB */
     fdwroutine->BeginForeignScan = levelPivotBeginForeignScan;
     fdwroutine->IterateForeignScan = levelPivotIterateForeignScan;
@@ -125,16 +228,35 @@ level_pivot_fdw_handler(PG_FUNCTION_ARGS)
     /* EXPLAIN output enhancement */
     fdwroutine->ExplainForeignScan = levelPivotExplainForeignScan;
 
+    /* Parallel scan: workers claim identity-aligned key range shards */
+    fdwroutine->IsForeignScanParallelSafe = levelPivotIsForeignScanParallelSafe;
+    fdwroutine->EstimateDSMForeignScan = levelPivotEstimateDSMForeignScan;
+    fdwroutine->InitializeDSMForeignScan = levelPivotInitializeDSMForeignScan;
+    fdwroutine->ReInitializeDSMForeignScan = levelPivotReInitializeDSMForeignScan;
+    fdwroutine->InitializeWorkerForeignScan = levelPivotInitializeWorkerForeignScan;
+
     /* DML operations: INSERT, UPDATE, DELETE */
     fdwroutine->AddForeignUpdateTargets = levelPivotAddForeignUpdateTargets;
     fdwroutine->PlanForeignModify = levelPivotPlanForeignModify;
     fdwroutine->BeginForeignModify = levelPivotBeginForeignModify;
     fdwroutine->ExecForeignInsert = levelPivotExecForeignInsert;
+    fdwroutine->GetForeignModifyBatchSize = levelPivotGetForeignModifyBatchSize;
+    fdwroutine->ExecForeignBatchInsert = levelPivotExecForeignBatchInsert;
     fdwroutine->ExecForeignUpdate = levelPivotExecForeignUpdate;
     fdwroutine->ExecForeignDelete = levelPivotExecForeignDelete;
     fdwroutine->EndForeignModify = levelPivotEndForeignModify;
     fdwroutine->IsForeignRelUpdatable = levelPivotIsForeignRelUpdatable;
 
+    /* UPDATE/DELETE settled by the key ranges run as one pass, no per-row calls */
+    fdwroutine->PlanDirectModify = levelPivotPlanDirectModify;
+    fdwroutine->BeginDirectModify = levelPivotBeginDirectModify;
+    fdwroutine->IterateDirectModify = levelPivotIterateDirectModify;
+    fdwroutine->EndDirectModify = levelPivotEndDirectModify;
+    fdwroutine->ExplainDirectModify = levelPivotExplainDirectModify;
+
+    /* ANALYZE support: sampled rows feed pg_statistic */
+    fdwroutine->AnalyzeForeignTable = levelPivotAnalyzeForeignTable;
+
     /* IMPORT FOREIGN SCHEMA support for auto-discovery */
     fdwroutine->ImportForeignSchema = levelPivotImportForeignSchema;
 
@@ -160,3 +282,38 @@ level_pivot_fdw_validator(PG_FUNCTION_ARGS)
 
     PG_RETURN_VOID();
 }
+
+/**
+ * Per-table scan and write counters, summed over all backends since the
+ * server started (or the last level_pivot_stats_reset()).
+ */
+Datum
+level_pivot_stats(PG_FUNCTION_ARGS)
+{
+    return levelPivotStats(fcinfo);
+}
+
+Datum
+level_pivot_stats_reset(PG_FUNCTION_ARGS)
+{
+    return levelPivotStatsReset(fcinfo);
+}
+
+/**
+ * LevelDB's internal properties (compaction stats, sstables, memory) for
+ * one server's database.
+ */
+Datum
+level_pivot_db_properties(PG_FUNCTION_ARGS)
+{
+    return levelPivotDbProperties(fcinfo);
+}
+
+/**
+ * Recreate a pivot table's secondary index entries from its keys.
+ */
+Datum
+level_pivot_rebuild_index(PG_FUNCTION_ARGS)
+{
+    return levelPivotRebuildIndex(fcinfo);
+}
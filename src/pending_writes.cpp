@@ -0,0 +1,353 @@
+/**
+ * pending_writes.cpp - In-memory overlay of a transaction's writes
+ *
+ * With level_pivot.write_scope = transaction, a connection holds its
+ * writes here until the transaction commits, then writes them to LevelDB
+ * as one batch. Until then, reads on the connection must see them, so
+ * get() consults the overlay first and iterators are wrapped in an
+ * OverlayIterator.
+ *
+ * OverlayIterator merges two sorted sources, the database iterator and
+ * the overlay's map, in the manner of LevelDB's own MergingIterator. When
+ * both hold a key, the overlay wins; a pending delete hides the key from
+ * both. Each child is kept at the next key to return in the current
+ * direction, so moving the same way costs one step, and changing
+ * direction costs one seek.
+ */
+
+#include "level_pivot/pending_writes.hpp"
+#include <leveldb/iterator.h>
+#include <leveldb/write_batch.h>
+#include <iterator>
+
+namespace level_pivot {
+
+namespace {
+
+class OverlayIterator : public leveldb::Iterator {
+public:
+    using Entries = PendingWrites::Entries;
+
+    OverlayIterator(std::unique_ptr<leveldb::Iterator> base,
+                    std::shared_ptr<const Entries> entries)
+        : base_(std::move(base)), entries_(std::move(entries)),
+          pos_(entries_->end()) {}
+
+    bool Valid() const override { return current_ != Source::NONE; }
+
+    void SeekToFirst() override {
+        base_->SeekToFirst();
+        pos_ = entries_->begin();
+        pos_valid_ = pos_ != entries_->end();
+        forward_ = true;
+        find_smallest();
+    }
+
+    void SeekToLast() override {
+        base_->SeekToLast();
+        pos_valid_ = !entries_->empty();
+        if (pos_valid_) {
+            pos_ = std::prev(entries_->end());
+        }
+        forward_ = false;
+        find_largest();
+    }
+
+    void Seek(const leveldb::Slice& target) override {
+        base_->Seek(target);
+        pos_ = entries_->lower_bound(target.ToString());
+        pos_valid_ = pos_ != entries_->end();
+        forward_ = true;
+        find_smallest();
+    }
+
+    void Next() override {
+        if (!forward_) {
+            // Put both children after the current key
+            std::string current = key().ToString();
+            base_->Seek(current);
+            if (base_->Valid() && base_->key() == leveldb::Slice(current)) {
+                base_->Next();
+            }
+            pos_ = entries_->upper_bound(current);
+            pos_valid_ = pos_ != entries_->end();
+            forward_ = true;
+        } else {
+            step_forward();
+        }
+        find_smallest();
+    }
+
+    void Prev() override {
+        if (forward_) {
+            // Put both children before the current key
+            std::string current = key().ToString();
+            base_->Seek(current);
+            if (base_->Valid()) {
+                base_->Prev();
+            } else {
+                base_->SeekToLast();
+            }
+            pos_ = entries_->lower_bound(current);
+            pos_valid_ = pos_ != entries_->begin();
+            if (pos_valid_) {
+                --pos_;
+            }
+            forward_ = false;
+        } else {
+            step_backward();
+        }
+        find_largest();
+    }
+
+    leveldb::Slice key() const override {
+        return current_ == Source::OVERLAY ? leveldb::Slice(pos_->first) : base_->key();
+    }
+
+    leveldb::Slice value() const override {
+        return current_ == Source::OVERLAY ? leveldb::Slice(*pos_->second) : base_->value();
+    }
+
+    leveldb::Status status() const override { return base_->status(); }
+
+private:
+    enum class Source { NONE, BASE, OVERLAY };
+
+    std::unique_ptr<leveldb::Iterator> base_;
+    std::shared_ptr<const Entries> entries_;
+    Entries::const_iterator pos_;
+    bool pos_valid_ = false;
+    bool forward_ = true;
+    Source current_ = Source::NONE;
+
+    bool base_at_overlay() const {
+        return base_->Valid() && base_->key() == leveldb::Slice(pos_->first);
+    }
+
+    // Move past the current key; the overlay's entry shadows base's
+    void step_forward() {
+        if (current_ == Source::OVERLAY) {
+            if (base_at_overlay()) {
+                base_->Next();
+            }
+            ++pos_;
+            pos_valid_ = pos_ != entries_->end();
+        } else {
+            base_->Next();
+        }
+    }
+
+    void step_backward() {
+        if (current_ == Source::OVERLAY) {
+            if (base_at_overlay()) {
+                base_->Prev();
+            }
+            pos_valid_ = pos_ != entries_->begin();
+            if (pos_valid_) {
+                --pos_;
+            }
+        } else {
+            base_->Prev();
+        }
+    }
+
+    void find_smallest() {
+        while (pos_valid_ &&
+               (!base_->Valid() || leveldb::Slice(pos_->first).compare(base_->key()) <= 0)) {
+            current_ = Source::OVERLAY;
+            if (pos_->second) {
+                return;
+            }
+            step_forward();  // A pending delete hides the key
+        }
+        current_ = base_->Valid() ? Source::BASE : Source::NONE;
+    }
+
+    void find_largest() {
+        while (pos_valid_ &&
+               (!base_->Valid() || leveldb::Slice(pos_->first).compare(base_->key()) >= 0)) {
+            current_ = Source::OVERLAY;
+            if (pos_->second) {
+                return;
+            }
+            step_backward();  // A pending delete hides the key
+        }
+        current_ = base_->Valid() ? Source::BASE : Source::NONE;
+    }
+};
+
+class BatchApplier : public leveldb::WriteBatch::Handler {
+public:
+    explicit BatchApplier(PendingWrites& pending) : pending_(pending) {}
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value) override {
+        pending_.put(key.ToString(), value.ToString());
+    }
+
+    void Delete(const leveldb::Slice& key) override {
+        pending_.del(key.ToString());
+    }
+
+private:
+    PendingWrites& pending_;
+};
+
+class BatchSizer : public leveldb::WriteBatch::Handler {
+public:
+    size_t bytes = 0;
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value) override {
+        bytes += key.size() + value.size() + PendingWrites::ENTRY_OVERHEAD;
+    }
+
+    void Delete(const leveldb::Slice& key) override {
+        bytes += key.size() + PendingWrites::ENTRY_OVERHEAD;
+    }
+};
+
+} // namespace
+
+PendingWrites::PendingWrites() : entries_(std::make_shared<Entries>()) {}
+
+void PendingWrites::put(const std::string& key, const std::string& value) {
+    set(key, value);
+}
+
+void PendingWrites::del(const std::string& key) {
+    set(key, std::nullopt);
+}
+
+void PendingWrites::set(const std::string& key, std::optional<std::string> value) {
+    Entries& entries = writable();
+    if (!savepoints_.empty()) {
+        auto [undo, first] = savepoints_.back().undo.try_emplace(key, Prior{false, std::nullopt});
+        if (first) {
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                undo->second = Prior{true, it->second};
+            }
+        }
+    }
+    size_t added = value ? value->size() : 0;
+    auto [it, inserted] = entries.try_emplace(key);
+    if (inserted) {
+        bytes_ += key.size() + ENTRY_OVERHEAD;
+    } else if (it->second) {
+        bytes_ -= it->second->size();
+    }
+    it->second = std::move(value);
+    bytes_ += added;
+}
+
+void PendingWrites::apply(const leveldb::WriteBatch& batch) {
+    BatchApplier applier(*this);
+    batch.Iterate(&applier);
+}
+
+const std::optional<std::string>* PendingWrites::find(const std::string& key) const {
+    auto it = entries_->find(key);
+    return it == entries_->end() ? nullptr : &it->second;
+}
+
+void PendingWrites::fill(leveldb::WriteBatch* batch) const {
+    for (const auto& [key, value] : *entries_) {
+        if (value) {
+            batch->Put(key, *value);
+        } else {
+            batch->Delete(key);
+        }
+    }
+}
+
+void PendingWrites::clear() {
+    if (entries_.use_count() > 1) {
+        entries_ = std::make_shared<Entries>();
+    } else {
+        entries_->clear();
+    }
+    bytes_ = 0;
+}
+
+void PendingWrites::savepoint(int level) {
+    if (savepoints_.empty() || savepoints_.back().level < level) {
+        savepoints_.push_back(Savepoint{level, {}});
+    }
+}
+
+/**
+ * The enclosing level may have no savepoint of its own, when it made no
+ * writes before this one began; the savepoint then just moves out to it.
+ * Where it has one, that savepoint's older records win.
+ */
+void PendingWrites::release_savepoint(int level) {
+    if (savepoints_.empty() || savepoints_.back().level != level) {
+        return;
+    }
+    Savepoint released = std::move(savepoints_.back());
+    savepoints_.pop_back();
+    if (level - 1 <= 1) {
+        return;
+    }
+    if (savepoints_.empty() || savepoints_.back().level != level - 1) {
+        released.level = level - 1;
+        savepoints_.push_back(std::move(released));
+        return;
+    }
+    auto& undo = savepoints_.back().undo;
+    for (auto& [key, prior] : released.undo) {
+        undo.try_emplace(key, std::move(prior));
+    }
+}
+
+/**
+ * Keys the enclosing savepoint hasn't recorded had the same entry when
+ * this one began as when the enclosing one did, so restoring them needs
+ * no record there.
+ */
+void PendingWrites::rollback_savepoint(int level) {
+    if (savepoints_.empty() || savepoints_.back().level != level) {
+        return;
+    }
+    Savepoint rolled_back = std::move(savepoints_.back());
+    savepoints_.pop_back();
+    for (const auto& [key, prior] : rolled_back.undo) {
+        restore(key, prior);
+    }
+}
+
+void PendingWrites::restore(const std::string& key, const Prior& prior) {
+    Entries& entries = writable();
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        bytes_ -= key.size() + ENTRY_OVERHEAD + (it->second ? it->second->size() : 0);
+        entries.erase(it);
+    }
+    if (prior.present) {
+        bytes_ += key.size() + ENTRY_OVERHEAD + (prior.value ? prior.value->size() : 0);
+        entries.emplace(key, prior.value);
+    }
+}
+
+std::unique_ptr<leveldb::Iterator> PendingWrites::overlay(
+        std::unique_ptr<leveldb::Iterator> base) const {
+    return std::make_unique<OverlayIterator>(std::move(base), entries_);
+}
+
+size_t PendingWrites::batch_bytes(const leveldb::WriteBatch& batch) {
+    BatchSizer sizer;
+    batch.Iterate(&sizer);
+    return sizer.bytes;
+}
+
+/**
+ * Copy-on-write: open overlay iterators hold the entries too, and must
+ * not see (or be invalidated by) writes made after they were opened.
+ */
+PendingWrites::Entries& PendingWrites::writable() {
+    if (entries_.use_count() > 1) {
+        entries_ = std::make_shared<Entries>(*entries_);
+    }
+    return *entries_;
+}
+
+} // namespace level_pivot
@@ -15,18 +15,82 @@
  *
  * The scanner maintains state across next_row() calls, accumulating attrs
  * until the identity changes, then emitting a complete row.
+ *
+ * Row boundaries: when every capture precedes {attr}, all of an
+ * identity's keys share the bytes before {attr}, and keys with those
+ * bytes share its captures. So the scanner keeps that prefix for the
+ * current row and tells a key of the same row by one memcmp, parsing
+ * only its attr; captures are split out just once per row, from the key
+ * that starts it. Other patterns compare captures field by field.
+ *
+ * Skip-scanning: an identity's keys share the prefix before {attr} and
+ * sort by attr name, so when a query needs only some attrs the scanner
+ * can seek from one needed attr straight to the next, and from the last
+ * one to the end of the identity, instead of stepping through the keys
+ * in between. Seeks cost several next() calls, so in AUTO mode the
+ * scanner first measures keys per identity and only skip-scans when rows
+ * are wide relative to the needed attr set.
+ *
+ * Point lookups: when the query fixes every capture, each identity is one
+ * row. SEEK mode scans each identity's range but leaves it as soon as the
+ * needed attrs are read; GET mode skips iteration and gets the needed
+ * attr keys directly.
+ *
+ * Reverse scans walk the same ranges from the end with prev(). A row's
+ * keys are just as contiguous backwards, so rows are still assembled by
+ * watching for the identity to change; the attrs simply arrive last
+ * first.
  */
 
 #include "level_pivot/pivot_scanner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <variant>
 
 namespace level_pivot {
 
+namespace {
+
+/**
+ * Every capture must precede {attr}, so that the key prefix before {attr}
+ * identifies the row and its keys sort by attr name
+ */
+bool pattern_supports_skip_scan(const KeyPattern& pattern) {
+    bool seen_attr = false;
+    for (const auto& segment : pattern.segments()) {
+        if (std::holds_alternative<AttrSegment>(segment)) {
+            seen_attr = true;
+        } else if (seen_attr && std::holds_alternative<CaptureSegment>(segment)) {
+            return false;
+        }
+    }
+    return seen_attr;
+}
+
+/**
+ * In-place KeyParser::prefix_successor, so seeks reuse one buffer
+ */
+void make_prefix_successor(std::string& prefix) {
+    while (!prefix.empty()) {
+        unsigned char last = static_cast<unsigned char>(prefix.back());
+        if (last != 0xFF) {
+            prefix.back() = static_cast<char>(last + 1);
+            return;
+        }
+        prefix.pop_back();
+    }
+}
+
+} // anonymous namespace
+
 PivotScanner::PivotScanner(const Projection& projection,
                            std::shared_ptr<LevelDBConnection> connection)
-    : projection_(projection), connection_(std::move(connection)) {}
+    : projection_(projection), connection_(std::move(connection)),
+      skip_supported_(pattern_supports_skip_scan(projection.parser().pattern())) {}
 
 void PivotScanner::begin_scan() {
-    begin_scan({});
+    begin_scan(std::vector<std::string>{});
 }
 
 /**
@@ -36,24 +100,151 @@ void PivotScanner::begin_scan() {
  * instead of O(all keys).
  */
 void PivotScanner::begin_scan(const std::vector<std::string>& prefix_values) {
-    stats_ = Stats{};
-    current_identity_.reset();
-    current_attrs_.clear();
+    begin_scan(prefix_values, "", "");
+}
 
+/**
+ * A shard narrows the prefix range further: we seek to the later of the
+ * prefix and shard_start, and stop at shard_end as if the prefix ended.
+ */
+void PivotScanner::begin_scan(const std::vector<std::string>& prefix_values,
+                              const std::string& shard_start,
+                              const std::string& shard_end) {
     // Build prefix from provided filter values for efficient seeking
-    prefix_ = projection_.parser().build_prefix(prefix_values);
+    KeyRange range = prefix_range(projection_.parser().build_prefix(prefix_values));
+    if (shard_start > range.start) {
+        range.start = shard_start;
+    }
+    if (!shard_end.empty() && (range.end.empty() || shard_end < range.end)) {
+        range.end = shard_end;
+    }
+    begin_scan_ranges({range});
+}
 
-    iterator_ = std::make_unique<LevelDBIterator>(connection_->iterator());
+/**
+ * Every scan is a list of ranges; a prefix scan is just a list of one.
+ * We seek to the first range here and move between ranges in
+ * next_range() as each one runs out.
+ */
+void PivotScanner::begin_scan_ranges(const std::vector<KeyRange>& ranges) {
+    stats_ = Stats{};
+    clear_current();
+    point_ranges_ = false;
+    point_gets_ = false;
+
+    // The needed attr set is fixed for the scan; keep it in key order so
+    // the next needed attr after any key is one binary search away
+    needed_attrs_.clear();
+    const auto& attr_columns = projection_.attr_columns();
+    for (size_t slot = 0; slot < attr_columns.size(); ++slot) {
+        if (projection_.attr_slot_needed(slot)) {
+            needed_attrs_.push_back(attr_columns[slot]->name);
+        }
+    }
+    std::sort(needed_attrs_.begin(), needed_attrs_.end());
+    skip_active_ = skip_supported_ && skip_scan_mode_ == SkipScan::ALWAYS && !reverse_;
 
-    if (prefix_.empty()) {
-        iterator_->seek_to_first();
+    ranges_ = ranges;
+    if (reverse_) {
+        std::reverse(ranges_.begin(), ranges_.end());
+    }
+    range_index_ = 0;
+    // An iterator made under the same pinned snapshot still sees the same
+    // data, so a rescan just seeks it rather than opening a new one
+    uint64_t epoch = connection_->snapshot_epoch();
+    if (!iterator_ || epoch == 0 || epoch != iterator_epoch_) {
+        iterator_ = std::make_unique<LevelDBIterator>(connection_->iterator(scan_options_));
+        iterator_epoch_ = epoch;
+        if (timing_) {
+            iterator_->time_moves(&stats_.read_ns);
+        }
+    }
+
+    if (ranges_.empty()) {
+        return;
+    }
+    position_at_range();
+}
+
+/**
+ * Seeks to the first key of the current range in scan order: its start,
+ * or in reverse its last key before the exclusive end
+ */
+void PivotScanner::position_at_range() {
+    const KeyRange& range = ranges_[range_index_];
+    if (!reverse_) {
+        if (range.start.empty()) {
+            iterator_->seek_to_first();
+        } else {
+            iterator_->seek(range.start);
+        }
+        return;
+    }
+
+    if (range.end.empty()) {
+        iterator_->seek_to_last();
+        return;
+    }
+    iterator_->seek(range.end);
+    if (iterator_->valid()) {
+        iterator_->prev();
     } else {
-        iterator_->seek(prefix_);
+        iterator_->seek_to_last();
+    }
+}
+
+/**
+ * SEEK mode is a range scan with one range per identity, sorted since
+ * value order isn't always key order. GET mode needs no iterator.
+ */
+void PivotScanner::begin_point_lookups(const std::vector<std::vector<std::string>>& identities,
+                                       PointLookup mode) {
+    if (mode == PointLookup::SEEK) {
+        std::vector<KeyRange> ranges;
+        ranges.reserve(identities.size());
+        for (const auto& identity : identities) {
+            ranges.push_back(prefix_range(projection_.parser().build_prefix(identity)));
+        }
+        std::sort(ranges.begin(), ranges.end(), [](const KeyRange& a, const KeyRange& b) {
+            return a.start < b.start;
+        });
+        begin_scan_ranges(ranges);
+        point_ranges_ = true;
+        return;
+    }
+
+    stats_ = Stats{};
+    clear_current();
+    ranges_.clear();
+    range_index_ = 0;
+    point_ranges_ = false;
+    point_gets_ = true;
+    point_identities_ = identities;
+    if (reverse_) {
+        std::reverse(point_identities_.begin(), point_identities_.end());
     }
+    point_index_ = 0;
 }
 
 /**
- * Returns the next pivoted row, or nullopt when exhausted.
+ * Returns the next row that passes the attr filter. Rows that fail are
+ * dropped here, before the caller converts any of their values.
+ */
+const PivotRow* PivotScanner::next_row() {
+    const PivotRow* row;
+    while ((row = assemble_row()) != nullptr) {
+        if (filter_.empty() || filter_.matches(*row)) {
+            return row;
+        }
+        // emit_current_row() counted it as returned
+        --stats_.rows_returned;
+        ++stats_.rows_filtered;
+    }
+    return nullptr;
+}
+
+/**
+ * Returns the next pivoted row, or nullptr when exhausted.
  *
  * The state machine works as follows:
  *   1. Read keys sequentially from LevelDB
@@ -65,159 +256,401 @@ void PivotScanner::begin_scan(const std::vector<std::string>& prefix_values) {
  * This streaming approach means we never load all keys into memory -
  * we only hold one row's worth of attrs at a time.
  */
-std::optional<PivotRow> PivotScanner::next_row() {
+const PivotRow* PivotScanner::assemble_row() {
+    if (point_gets_) {
+        return next_point_get();
+    }
+
     while (iterator_ && iterator_->valid()) {
         // Zero-copy: get key as string_view to avoid allocation
         std::string_view key_sv = iterator_->key_view();
 
-        // Stop scanning when we leave the prefix range.
-        // LevelDB iteration is sorted, so all matching keys are contiguous.
-        if (!is_within_prefix_view(key_sv)) {
-            if (current_identity_.has_value()) {
-                return emit_current_row();
+        // Leaving a range (prefix, shard, or one of several identity
+        // ranges) ends the current row. LevelDB iteration is sorted, so
+        // each range's keys are contiguous.
+        if (!is_within_range_view(key_sv)) {
+            const PivotRow* row = emit_current_row();
+            if (row || !next_range()) {
+                return row;
             }
-            return std::nullopt;
+            continue;
         }
 
         ++stats_.keys_scanned;
+        stats_.bytes_read += key_sv.size();
 
         // Parse the key to extract identity values and attr name.
         // Keys that don't match the pattern are skipped (e.g., other tables' data).
-        auto parsed = projection_.parser().parse_view(key_sv);
-        if (!parsed) {
+        KeyMatch match = timing_ ? timed_classify_key(key_sv) : classify_key(key_sv);
+        if (match == KeyMatch::NO_MATCH) {
             ++stats_.keys_skipped;
-            iterator_->next();
+            step();
             continue;
         }
 
-        if (!current_identity_.has_value()) {
-            // First key - start accumulating a new row
-            current_identity_ = materialize_identity(parsed->capture_values);
-            current_attrs_.clear();
-        } else if (!identity_matches(*current_identity_, parsed->capture_values)) {
-            // Identity changed - emit the completed row and start a new one.
-            // We return immediately here to yield the row to the caller.
-            auto row = emit_current_row();
-            current_identity_ = materialize_identity(parsed->capture_values);
-            current_attrs_.clear();
-
-            // Don't lose this key's attr - add it to the new row
-            std::string_view attr_name = parsed->attr_name;
-            if (projection_.has_attr(attr_name)) {
-                current_attrs_[std::string(attr_name)] = std::string(iterator_->value_view());
+        if (match == KeyMatch::NEW_ROW) {
+            if (!has_current_) {
+                // First key - start accumulating a new row
+                start_row(parsed_.capture_values);
+            } else {
+                // Identity changed - emit the completed row and start a new
+                // one. We return immediately to yield the row to the caller.
+                const PivotRow* row = emit_current_row();
+                start_row(parsed_.capture_values);
+
+                // Don't lose this key's attr - add it to the new row
+                accumulate_row();
+                advance();
+                return row;
             }
+        }
+
+        // Same identity - accumulate this attr into the current row
+        accumulate_row();
 
-            iterator_->next();
+        // A point range holds one identity, so once its needed attrs are
+        // in, the rest of its keys can't change the row
+        if (point_ranges_ && needed_found_ == needed_attrs_.size()) {
+            const PivotRow* row = emit_current_row();
+            next_range();
             return row;
         }
 
-        // Same identity - accumulate this attr into the current row.
-        // Only accumulate attrs that are in our projection (table columns).
-        std::string_view attr_name = parsed->attr_name;
-        if (projection_.has_attr(attr_name)) {
-            current_attrs_[std::string(attr_name)] = std::string(iterator_->value_view());
+        advance();
+    }
+
+    // End of iteration - emit any remaining accumulated row
+    return emit_current_row();
+}
+
+/**
+ * Gets the needed attr keys of each identity in turn. When none of them
+ * exists the row may still exist through its other attr columns, so those
+ * are tried until one is found.
+ */
+const PivotRow* PivotScanner::next_point_get() {
+    const auto& attr_columns = projection_.attr_columns();
+    const KeyParser& parser = projection_.parser();
+
+    while (point_index_ < point_identities_.size()) {
+        const auto& identity = point_identities_[point_index_++];
+        current_.reset(identity.size(), attr_columns.size());
+        for (size_t i = 0; i < identity.size(); ++i) {
+            current_.set_identity(i, identity[i]);
         }
 
-        iterator_->next();
+        bool found = false;
+        for (size_t slot = 0; slot < attr_columns.size(); ++slot) {
+            if (!projection_.attr_slot_needed(slot)) {
+                continue;
+            }
+            ++stats_.gets;
+            std::string key = parser.build(identity, attr_columns[slot]->name);
+            auto value = get_key(key);
+            if (value) {
+                current_.set_attr(slot, *value);
+                ++stats_.keys_scanned;
+                stats_.bytes_read += key.size() + value->size();
+                found = true;
+            }
+        }
+        for (size_t slot = 0; !found && slot < attr_columns.size(); ++slot) {
+            if (projection_.attr_slot_needed(slot)) {
+                continue;
+            }
+            ++stats_.gets;
+            found = get_key(parser.build(identity, attr_columns[slot]->name)).has_value();
+        }
+
+        if (found) {
+            has_current_ = true;
+            return emit_current_row();
+        }
     }
+    return nullptr;
+}
 
-    // End of iteration - emit any remaining accumulated row
-    if (current_identity_.has_value()) {
-        return emit_current_row();
+/**
+ * Seeking lands somewhere inside an identity's run of keys, so the row
+ * there would be missing attrs. We drop it and stop at the next identity,
+ * where next_row() picks up a complete row.
+ */
+void PivotScanner::seek_to(const std::string& key) {
+    if (!iterator_ || !iterator_->valid() || iterator_->key_view() >= key) {
+        return;
+    }
+
+    clear_current();
+    iterator_->seek(key);
+
+    // The skipped identity is tracked in current_ and cleared on the way out
+    while (iterator_->valid()) {
+        std::string_view key_sv = iterator_->key_view();
+        if (!is_within_range_view(key_sv)) {
+            break;
+        }
+
+        KeyMatch match = timing_ ? timed_classify_key(key_sv) : classify_key(key_sv);
+        if (match == KeyMatch::NO_MATCH) {
+            ++stats_.keys_skipped;
+        } else if (!has_current_) {
+            start_row(parsed_.capture_values);
+        } else if (match == KeyMatch::NEW_ROW) {
+            break;
+        }
+
+        ++stats_.keys_scanned;
+        stats_.bytes_read += key_sv.size();
+        iterator_->next();
     }
 
-    return std::nullopt;
+    clear_current();
 }
 
 void PivotScanner::rescan() {
-    begin_scan({});
+    begin_scan(std::vector<std::string>{});
 }
 
 void PivotScanner::end_scan() {
     iterator_.reset();
-    current_identity_.reset();
-    current_attrs_.clear();
+    clear_current();
 }
 
-bool PivotScanner::is_within_prefix(const std::string& key) const {
-    if (prefix_.empty()) {
-        return true;
+/**
+ * Forward scans only ever read keys at or after the current range's
+ * start, so the end is the only bound left to check; reverse scans
+ * likewise only need the start.
+ */
+bool PivotScanner::is_within_range_view(std::string_view key) const {
+    if (range_index_ >= ranges_.size()) {
+        return false;
+    }
+    const KeyRange& range = ranges_[range_index_];
+    if (reverse_) {
+        return key >= range.start;
     }
-    return key.compare(0, prefix_.size(), prefix_) == 0;
+    return range.end.empty() || key < range.end;
 }
 
-bool PivotScanner::is_within_prefix_view(std::string_view key) const {
-    if (prefix_.empty()) {
-        return true;
+/**
+ * Moves on to the next range, seeking only if its start is ahead of the
+ * iterator (skip-scan seeks may already have carried it further).
+ *
+ * @return false once every range is done
+ */
+bool PivotScanner::next_range() {
+    if (range_index_ < ranges_.size()) {
+        ++range_index_;
     }
-    if (key.size() < prefix_.size()) {
+    if (range_index_ >= ranges_.size()) {
         return false;
     }
-    return key.substr(0, prefix_.size()) == prefix_;
+
+    if (reverse_) {
+        // Between ranges the iterator can still be above this one's end
+        const std::string& end = ranges_[range_index_].end;
+        if (iterator_->valid() && !end.empty() && iterator_->key_view() >= end) {
+            position_at_range();
+        }
+        return true;
+    }
+
+    const std::string& start = ranges_[range_index_].start;
+    if (iterator_->valid() && iterator_->key_view() < start) {
+        iterator_->seek(start);
+    }
+    return true;
 }
 
 /**
- * Converts string_views (pointing into LevelDB's memory) into owned strings.
- * We must do this before calling iterator_->next() because LevelDB may
- * invalidate the previous key's memory.
+ * Moves to the following key in scan order
  */
-std::vector<std::string> PivotScanner::materialize_identity(
-    const std::vector<std::string_view>& views) {
-    std::vector<std::string> result;
-    result.reserve(views.size());
-    for (const auto& sv : views) {
-        result.emplace_back(sv);
-    }
-    return result;
+void PivotScanner::step() {
+    if (reverse_) {
+        iterator_->prev();
+    } else {
+        iterator_->next();
+    }
 }
 
 /**
- * Compares owned identity strings with parsed string_views without allocation.
- * This is called for every key to detect row boundaries.
+ * A key that starts with the current row's prefix belongs to the row if
+ * the rest of it parses; one that doesn't is a new identity or no match
+ * at all. Only the attr is parsed for a key of the current row, so
+ * parsed_.capture_values is left pointing at an earlier key: it is only
+ * valid after NEW_ROW.
  */
-bool PivotScanner::identity_matches(
-    const std::vector<std::string>& identity,
-    const std::vector<std::string_view>& views) {
-    if (identity.size() != views.size()) {
-        return false;
+PivotScanner::KeyMatch PivotScanner::classify_key(std::string_view key) {
+    const KeyParser& parser = projection_.parser();
+
+    if (!skip_supported_) {
+        if (!parser.parse_view_into(key, parsed_)) {
+            return KeyMatch::NO_MATCH;
+        }
+        return has_current_ && current_.identity_matches(parsed_.capture_values)
+            ? KeyMatch::SAME_ROW : KeyMatch::NEW_ROW;
+    }
+
+    size_t prefix_len = row_prefix_.size();
+    if (has_current_ && key.size() > prefix_len &&
+        std::memcmp(key.data(), row_prefix_.data(), prefix_len) == 0) {
+        return parser.parse_attr_view(key, prefix_len, parsed_.attr_name)
+            ? KeyMatch::SAME_ROW : KeyMatch::NO_MATCH;
+    }
+    return parser.parse_view_into(key, parsed_) ? KeyMatch::NEW_ROW : KeyMatch::NO_MATCH;
+}
+
+PivotScanner::KeyMatch PivotScanner::timed_classify_key(std::string_view key) {
+    auto start = std::chrono::steady_clock::now();
+    KeyMatch match = classify_key(key);
+    stats_.parse_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return match;
+}
+
+/**
+ * Point gets count as LevelDB time like the iterator's moves
+ */
+std::optional<std::string> PivotScanner::get_key(const std::string& key) {
+    if (!timing_) {
+        return connection_->get(key);
     }
+    auto start = std::chrono::steady_clock::now();
+    auto value = connection_->get(key);
+    stats_.read_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return value;
+}
+
+/**
+ * Copies the identity out of the key into current_'s arena. This must
+ * happen before iterator_->next() because LevelDB may invalidate the
+ * previous key's memory.
+ */
+void PivotScanner::start_row(const std::vector<std::string_view>& identity) {
+    current_.reset(identity.size(), projection_.attr_columns().size());
     for (size_t i = 0; i < identity.size(); ++i) {
-        if (identity[i] != views[i]) {
-            return false;
-        }
+        current_.set_identity(i, identity[i]);
+    }
+    has_current_ = true;
+    needed_found_ = 0;
+
+    // parsed_.attr_name points into the current key, just past the prefix
+    if (skip_supported_) {
+        std::string_view key = iterator_->key_view();
+        row_prefix_.assign(key.data(),
+                           static_cast<size_t>(parsed_.attr_name.data() - key.data()));
     }
-    return true;
 }
 
 /**
- * Packages accumulated identity and attrs into a PivotRow and resets state.
- * Uses std::move to transfer ownership efficiently.
+ * Stores the current key's value in its attr slot. The attr name is
+ * resolved to a slot once here; attrs not in the projection (keys for
+ * columns the table doesn't declare) and attrs the query doesn't need
+ * are ignored, so their values are never copied.
  */
-std::optional<PivotRow> PivotScanner::emit_current_row() {
-    if (!current_identity_.has_value()) {
-        return std::nullopt;
+void PivotScanner::accumulate_row() {
+    int slot = projection_.attr_column_index(parsed_.attr_name);
+    if (slot >= 0 && projection_.attr_slot_needed(static_cast<size_t>(slot))) {
+        std::string_view value = iterator_->value_view();
+        current_.set_attr(static_cast<size_t>(slot), value);
+        stats_.bytes_read += value.size();
+        ++needed_found_;
+    }
+}
+
+/**
+ * Moves past the current key. Without skip-scanning that's a plain next().
+ * Otherwise we still try one next() first, since the following key is
+ * often the one we want (needed attrs adjacent, or a new identity), and
+ * only seek if it is an unneeded attr of the current row: to the next
+ * needed attr, or past the row once no needed attr remains.
+ */
+void PivotScanner::advance() {
+    if (!skip_active_ || !has_current_) {
+        step();
+        return;
+    }
+
+    // Resolve before next(), which invalidates parsed_'s views
+    auto next_needed = std::upper_bound(needed_attrs_.begin(), needed_attrs_.end(),
+                                        parsed_.attr_name);
+
+    iterator_->next();
+    if (!iterator_->valid()) {
+        return;
+    }
+
+    std::string_view key = iterator_->key_view();
+    if (key.size() < row_prefix_.size() ||
+        key.compare(0, row_prefix_.size(), row_prefix_) != 0) {
+        return;  // Already at the next identity
+    }
+
+    seek_target_.assign(row_prefix_);
+    if (next_needed == needed_attrs_.end()) {
+        make_prefix_successor(seek_target_);
+        if (seek_target_.empty()) {
+            return;  // Prefix of all 0xFF bytes has no successor
+        }
+    } else if (key.substr(row_prefix_.size()) < *next_needed) {
+        seek_target_ += *next_needed;
+    } else {
+        return;  // Landed on or past the next needed attr
     }
 
-    PivotRow row;
-    row.identity_values = std::move(*current_identity_);
-    row.attr_values = std::move(current_attrs_);
+    iterator_->seek(seek_target_);
+    ++stats_.seeks;
+}
+
+/**
+ * AUTO mode: after the sample rows, skip-scan if the unneeded keys per row
+ * outweigh the seeks needed to jump them. A row needs at most one seek per
+ * needed attr plus one to leave it, and each needed attr accounts for at
+ * most one of the row's keys.
+ */
+void PivotScanner::decide_skip_scan() {
+    double needed = static_cast<double>(needed_attrs_.size());
+    double unneeded_per_row = stats_.keys_per_row() - needed;
+    double seeks_per_row = needed + 1;
+    skip_active_ = unneeded_per_row > SEEK_COST_IN_NEXTS * seeks_per_row;
+}
 
+/**
+ * Hands the accumulated row to the caller by swapping buffers, so the
+ * next row reuses the capacity of the one before it.
+ */
+const PivotRow* PivotScanner::emit_current_row() {
+    if (!has_current_) {
+        return nullptr;
+    }
+
+    std::swap(current_, emitted_);
+    has_current_ = false;
     ++stats_.rows_returned;
 
-    current_identity_.reset();
-    current_attrs_.clear();
+    if (skip_supported_ && skip_scan_mode_ == SkipScan::AUTO && !reverse_ &&
+        stats_.rows_returned + stats_.rows_filtered == SKIP_SCAN_SAMPLE_ROWS) {
+        decide_skip_scan();
+    }
 
-    return row;
+    return &emitted_;
+}
+
+void PivotScanner::clear_current() {
+    has_current_ = false;
 }
 
 /**
  * DatumBuilder converts PivotRows into PostgreSQL Datum arrays for tuple building.
  *
- * The challenge is mapping between two orderings:
- *   - PivotRow::identity_values are ordered by pattern capture order
+ * The challenge is mapping between orderings:
+ *   - PivotRow identity values are ordered by pattern capture order
+ *   - PivotRow attr values are ordered by attr slot
  *   - PostgreSQL tuple expects values in column attnum order
  *
- * We use pre-computed column_to_identity_index for O(1) mapping.
+ * We use pre-computed column_to_identity_index and column_to_attr_index
+ * for O(1) mapping.
  */
 void DatumBuilder::build_datums(const PivotRow& row,
                                 const Projection& projection,
@@ -228,29 +661,44 @@ void DatumBuilder::build_datums(const PivotRow& row,
     for (size_t i = 0; i < columns.size(); ++i) {
         const auto& col = columns[i];
 
+        // Columns the query doesn't reference are left NULL unconverted
+        if (!projection.column_needed(i)) {
+            nulls[i] = true;
+            values[i] = (Datum)0;
+            continue;
+        }
+
+        // Identity values and attr slots are both found by pre-computed
+        // index, so there are no name lookups per cell
+        std::string_view value;
+        bool present = false;
         if (col.is_identity) {
-            // Identity column: look up value by pre-computed index into identity_values.
-            // This avoids name-based lookup for every cell.
             int identity_idx = projection.column_to_identity_index(i);
             if (identity_idx >= 0 &&
-                static_cast<size_t>(identity_idx) < row.identity_values.size()) {
-                values[i] = TypeConverter::string_to_datum(
-                    row.identity_values[identity_idx], col.type, nulls[i]);
-            } else {
-                nulls[i] = true;
-                values[i] = (Datum)0;
+                static_cast<size_t>(identity_idx) < row.identity_count()) {
+                value = row.identity_value(identity_idx);
+                present = true;
             }
         } else {
-            // Attr column: look up by column name in attr_values map.
-            // Missing attrs are NULL (that attr key didn't exist in LevelDB).
-            auto it = row.attr_values.find(col.name);
-            if (it != row.attr_values.end()) {
-                values[i] = TypeConverter::string_to_datum(it->second, col.type, nulls[i]);
-            } else {
-                nulls[i] = true;
-                values[i] = (Datum)0;
+            // Missing attrs are NULL (that attr key didn't exist in LevelDB)
+            int slot = projection.column_to_attr_index(i);
+            if (slot >= 0 && static_cast<size_t>(slot) < row.attr_slot_count() &&
+                row.has_attr(slot)) {
+                value = row.attr_value(slot);
+                present = true;
             }
         }
+
+        if (!present) {
+            nulls[i] = true;
+            values[i] = (Datum)0;
+        } else if (DatumConverter convert = projection.converter(i)) {
+            // Converters read the row's bytes in place, no copy per cell
+            nulls[i] = false;
+            values[i] = convert(value);
+        } else {
+            values[i] = TypeConverter::string_to_datum(value, col.type, nulls[i]);
+        }
     }
 }
 
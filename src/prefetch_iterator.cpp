@@ -0,0 +1,396 @@
+/**
+ * prefetch_iterator.cpp - Reads a LevelDB iterator ahead on a background thread
+ *
+ * A scan alternates between LevelDB (finding, reading and decompressing
+ * blocks) and PostgreSQL (converting values and forming tuples), all on
+ * the backend's one thread. PrefetchIterator moves the LevelDB half onto
+ * a reader thread: it walks the wrapped iterator and copies key/value
+ * pairs into batches, keeping a few batches ready, while the caller
+ * steps through the previous one. Cold-cache scans, which wait on reads
+ * and decompression, gain the most.
+ *
+ * The two threads never touch the wrapped iterator at once. Moving
+ * within the batches needs no locking; whenever the caller has to
+ * reposition the wrapped iterator (a seek outside the batches, or a
+ * change of direction) it first pauses the reader, waits for it to put
+ * down the iterator, drops the batches read so far and restarts it from
+ * the new position. Batches are recycled, so their buffers keep their
+ * capacity for the rest of the scan.
+ *
+ * An exception on the reader thread (std::bad_alloc growing a batch,
+ * say) must not escape it, or std::terminate takes the backend down. It
+ * ends the read instead, in a last batch that carries it, and is
+ * rethrown on the caller's thread when the caller reaches that batch.
+ */
+
+#include "level_pivot/prefetch_iterator.hpp"
+#include <leveldb/iterator.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace level_pivot {
+
+namespace {
+
+// The first batch after a seek; later ones double up to batch_keys
+constexpr size_t FIRST_BATCH_KEYS = 16;
+
+// Batches end early past this many bytes, so wide values don't make the
+// ready batches hold depth * batch_keys of them
+constexpr size_t BATCH_BYTES = 1024 * 1024;
+
+/**
+ * Key/value pairs copied out of the wrapped iterator, in the order it
+ * returned them
+ */
+struct Batch {
+    struct Entry {
+        size_t offset;  // Key, then value, start here in data
+        size_t key_size;
+        size_t value_size;
+    };
+
+    std::string data;
+    std::vector<Entry> entries;
+    bool last = false;        // The wrapped iterator ran out after these
+    leveldb::Status status;   // Its status when it ran out
+    std::exception_ptr error; // Thrown while reading; the batch is empty
+
+    void clear() {
+        data.clear();
+        entries.clear();
+        last = false;
+        status = leveldb::Status();
+        error = nullptr;
+    }
+
+    void add(const leveldb::Slice& key, const leveldb::Slice& value) {
+        entries.push_back({data.size(), key.size(), value.size()});
+        data.append(key.data(), key.size());
+        data.append(value.data(), value.size());
+    }
+
+    size_t size() const { return entries.size(); }
+
+    leveldb::Slice key(size_t i) const {
+        return leveldb::Slice(data.data() + entries[i].offset, entries[i].key_size);
+    }
+
+    leveldb::Slice value(size_t i) const {
+        const Entry& entry = entries[i];
+        return leveldb::Slice(data.data() + entry.offset + entry.key_size, entry.value_size);
+    }
+};
+
+class PrefetchIterator : public leveldb::Iterator {
+public:
+    PrefetchIterator(std::unique_ptr<leveldb::Iterator> base, size_t batch_keys, size_t depth)
+        : base_(std::move(base)), batch_keys_(std::max<size_t>(batch_keys, 1)),
+          depth_(std::max<size_t>(depth, 1)) {}
+
+    ~PrefetchIterator() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutdown_ = true;
+        }
+        work_cv_.notify_all();
+        if (reader_.joinable()) {
+            reader_.join();
+        }
+    }
+
+    bool Valid() const override { return valid_; }
+
+    void SeekToFirst() override {
+        pause();
+        base_->SeekToFirst();
+        restart(true);
+    }
+
+    void SeekToLast() override {
+        pause();
+        base_->SeekToLast();
+        restart(false);
+    }
+
+    void Seek(const leveldb::Slice& target) override {
+        if (forward_ && valid_ && cur_.key(pos_).compare(target) <= 0 &&
+            seek_within_batches(target)) {
+            return;
+        }
+        pause();
+        base_->Seek(target);
+        restart(true);
+    }
+
+    void Next() override {
+        if (!forward_) {
+            turn(true);
+            return;
+        }
+        step();
+    }
+
+    void Prev() override {
+        if (forward_) {
+            turn(false);
+            return;
+        }
+        step();
+    }
+
+    leveldb::Slice key() const override { return cur_.key(pos_); }
+    leveldb::Slice value() const override { return cur_.value(pos_); }
+    leveldb::Status status() const override { return cur_.status; }
+
+private:
+    std::unique_ptr<leveldb::Iterator> base_;
+    const size_t batch_keys_;
+    const size_t depth_;
+
+    // Caller's position: batches are in the order of the current
+    // direction, so both Next() and Prev() step forward through them
+    Batch cur_;
+    size_t pos_ = 0;
+    bool valid_ = false;
+    bool forward_ = true;
+
+    // Shared with the reader, under mutex_
+    std::mutex mutex_;
+    std::condition_variable work_cv_;   // Reader waits for room or a restart
+    std::condition_variable ready_cv_;  // Caller waits for a batch or a pause
+    std::deque<Batch> ready_;
+    std::vector<Batch> spare_;
+    bool running_ = false;    // The reader may use base_
+    bool busy_ = false;       // The reader is using base_
+    bool exhausted_ = false;  // The last batch has been queued
+    bool shutdown_ = false;
+    bool read_forward_ = true;
+    size_t next_batch_keys_ = 0;
+    std::thread reader_;
+
+    /**
+     * Stops the reader and drops its batches; base_ is the caller's
+     * until restart()
+     */
+    void pause() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+        ready_cv_.wait(lock, [this] { return !busy_; });
+        while (!ready_.empty()) {
+            spare_.push_back(std::move(ready_.front()));
+            ready_.pop_front();
+        }
+        exhausted_ = false;
+    }
+
+    /**
+     * Sets the reader going from base_'s position and waits for the
+     * first batch
+     */
+    void restart(bool forward) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            read_forward_ = forward;
+            next_batch_keys_ = std::min(FIRST_BATCH_KEYS, batch_keys_);
+            running_ = true;
+            if (!reader_.joinable()) {
+                start_reader();
+            }
+        }
+        work_cv_.notify_one();
+        forward_ = forward;
+        take_batch();
+    }
+
+    /**
+     * Reading the other way starts from the neighbour of the current key,
+     * found with one seek
+     */
+    void turn(bool forward) {
+        std::string current = key().ToString();
+        pause();
+        base_->Seek(current);
+        if (forward) {
+            if (base_->Valid() && base_->key() == leveldb::Slice(current)) {
+                base_->Next();
+            }
+        } else if (base_->Valid()) {
+            base_->Prev();
+        } else {
+            base_->SeekToLast();
+        }
+        restart(forward);
+    }
+
+    void step() {
+        if (++pos_ < cur_.size()) {
+            return;
+        }
+        if (cur_.last) {
+            valid_ = false;
+            return;
+        }
+        take_batch();
+    }
+
+    /**
+     * Moves cur_ to the first key at or after target if the batches read
+     * so far reach it. Skip-scans and nearby point seeks mostly land here.
+     *
+     * @return false if target lies past them
+     */
+    bool seek_within_batches(const leveldb::Slice& target) {
+        for (;;) {
+            size_t lo = pos_;
+            size_t hi = cur_.size();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (cur_.key(mid).compare(target) < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo < cur_.size()) {
+                pos_ = lo;
+                return true;
+            }
+            if (cur_.last) {
+                pos_ = cur_.size();
+                valid_ = false;
+                return true;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (ready_.empty()) {
+                    return false;
+                }
+            }
+            take_batch();
+        }
+    }
+
+    /**
+     * Replaces cur_ with the next ready batch, waiting for the reader if
+     * there is none yet; rethrows what the reader threw reading it
+     */
+    void take_batch() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_cv_.wait(lock, [this] { return !ready_.empty(); });
+            spare_.push_back(std::move(cur_));
+            cur_ = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        work_cv_.notify_one();
+        pos_ = 0;
+        valid_ = cur_.size() > 0;
+        if (cur_.error) {
+            std::rethrow_exception(cur_.error);
+        }
+    }
+
+    /**
+     * The reader inherits the signal mask it is started with. Blocking
+     * everything leaves PostgreSQL's signals to the backend's own thread.
+     */
+    void start_reader() {
+#ifndef _WIN32
+        sigset_t all;
+        sigset_t saved;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &saved);
+        try {
+            reader_ = std::thread(&PrefetchIterator::read_ahead, this);
+        } catch (...) {
+            pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+            throw;
+        }
+        pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+#else
+        reader_ = std::thread(&PrefetchIterator::read_ahead, this);
+#endif
+    }
+
+    /**
+     * Reader thread: fills batches while there is room and the caller
+     * hasn't paused it
+     */
+    void read_ahead() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_cv_.wait(lock, [this] {
+                return shutdown_ || (running_ && !exhausted_ && ready_.size() < depth_);
+            });
+            if (shutdown_) {
+                return;
+            }
+
+            Batch batch;
+            if (!spare_.empty()) {
+                batch = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            size_t limit = next_batch_keys_;
+            next_batch_keys_ = std::min(next_batch_keys_ * 2, batch_keys_);
+            bool forward = read_forward_;
+            busy_ = true;
+            lock.unlock();
+
+            try {
+                fill(batch, limit, forward);
+            } catch (...) {
+                batch.clear();
+                batch.last = true;
+                batch.error = std::current_exception();
+            }
+
+            lock.lock();
+            busy_ = false;
+            if (running_) {
+                exhausted_ = batch.last;
+                ready_.push_back(std::move(batch));
+            } else {
+                spare_.push_back(std::move(batch));
+            }
+            ready_cv_.notify_all();
+        }
+    }
+
+    void fill(Batch& batch, size_t limit, bool forward) {
+        batch.clear();
+        while (batch.size() < limit && batch.data.size() < BATCH_BYTES && base_->Valid()) {
+            batch.add(base_->key(), base_->value());
+            if (forward) {
+                base_->Next();
+            } else {
+                base_->Prev();
+            }
+        }
+        if (!base_->Valid()) {
+            batch.last = true;
+            batch.status = base_->status();
+        }
+    }
+};
+
+} // anonymous namespace
+
+std::unique_ptr<leveldb::Iterator> make_prefetch_iterator(
+    std::unique_ptr<leveldb::Iterator> base, size_t batch_keys, size_t depth) {
+    return std::make_unique<PrefetchIterator>(std::move(base), batch_keys, depth);
+}
+
+} // namespace level_pivot
@@ -27,6 +27,7 @@ namespace pg_oid {
     constexpr unsigned int BYTEAOID = 17;
     constexpr unsigned int INT4OID = 23;
     constexpr unsigned int INT8OID = 20;
+    constexpr unsigned int FLOAT8OID = 701;
     constexpr unsigned int TEXTOID = 25;
     constexpr unsigned int NUMERICOID = 1700;
     constexpr unsigned int TIMESTAMPOID = 1114;
@@ -52,6 +53,8 @@ PgType pg_type_from_oid(unsigned int oid) {
             return PgType::INTEGER;
         case pg_oid::INT8OID:
             return PgType::BIGINT;
+        case pg_oid::FLOAT8OID:
+            return PgType::FLOAT8;
         case pg_oid::TEXTOID:
         case pg_oid::VARCHAROID:
         case pg_oid::BPCHAROID:
@@ -83,6 +86,7 @@ const char* pg_type_name(PgType type) {
         case PgType::DATE: return "DATE";
         case PgType::JSONB: return "JSONB";
         case PgType::BYTEA: return "BYTEA";
+        case PgType::FLOAT8: return "FLOAT8";
     }
     return "UNKNOWN";
 }
@@ -98,9 +102,11 @@ Projection::Projection(const KeyPattern& pattern, std::vector<ColumnDef> columns
  * We need fast lookups because:
  *   - column_to_identity_index_: Maps column position to identity value index
  *     (used by DatumBuilder to fill identity columns from PivotRow)
+ *   - column_to_attr_index_: Maps column position to attr slot, likewise
  *   - identity_name_to_index_: Maps capture name to column index
- *   - attr_name_to_index_: Maps attr name to column index
- *   - attr_names_: Set for fast "is this an attr?" checks during scanning
+ *   - attr_lookup_: Maps attr name to attr slot without allocating; this
+ *     runs for every key scanned, so it's a specialized structure
+ *   - attr_names_: Set of attr names, for callers that want the whole set
  */
 void Projection::build_indexes() {
     identity_columns_.clear();
@@ -110,8 +116,10 @@ void Projection::build_indexes() {
     attr_names_.clear();
     column_to_identity_index_.clear();
     column_to_identity_index_.resize(columns_.size(), -1);
+    column_to_attr_index_.clear();
+    column_to_attr_index_.resize(columns_.size(), -1);
     identity_name_to_index_.clear();
-    attr_name_to_index_.clear();
+    std::vector<std::string> attr_slot_names;
 
     // Map capture names to their index in the parsed key's capture_values array.
     // This ordering comes from the pattern and must match parse results.
@@ -141,11 +149,38 @@ void Projection::build_indexes() {
             }
         } else {
             // Attr columns have their name used as the {attr} value in keys
-            attr_name_to_index_[col.name] = static_cast<int>(attr_columns_.size());
+            attr_slot_names.push_back(col.name);
+            column_to_attr_index_[i] = static_cast<int>(attr_columns_.size());
             attr_columns_.push_back(&columns_[i]);
             attr_names_.insert(col.name);
         }
     }
+
+    attr_lookup_ = AttrLookup(attr_slot_names);
+
+    column_needed_.assign(columns_.size(), true);
+    attr_slot_needed_.assign(attr_columns_.size(), true);
+}
+
+/**
+ * Marks only the listed columns as needed. Attnums that aren't columns of
+ * this projection (system columns, dropped columns) are ignored.
+ */
+void Projection::set_needed_columns(const std::vector<int>& attnums) {
+    column_needed_.assign(columns_.size(), false);
+    attr_slot_needed_.assign(attr_columns_.size(), false);
+
+    for (int attnum : attnums) {
+        auto it = column_attnum_index_.find(attnum);
+        if (it == column_attnum_index_.end()) {
+            continue;
+        }
+        column_needed_[it->second] = true;
+        int slot = column_to_attr_index_[it->second];
+        if (slot >= 0) {
+            attr_slot_needed_[slot] = true;
+        }
+    }
 }
 
 /**
@@ -229,9 +264,4 @@ int Projection::identity_column_index(const std::string& capture_name) const {
     return it != identity_name_to_index_.end() ? it->second : -1;
 }
 
-int Projection::attr_column_index(const std::string& attr_name) const {
-    auto it = attr_name_to_index_.find(attr_name);
-    return it != attr_name_to_index_.end() ? it->second : -1;
-}
-
 } // namespace level_pivot
@@ -0,0 +1,70 @@
+/**
+ * projection_cache.cpp - Reuse of built projections across scans
+ *
+ * Each table's entry carries a generation number, handed out with every
+ * projection checked out. Invalidation removes the entry, so a later
+ * checkout creates a new one with a fresh generation while projections
+ * from before still carry the old one and are dropped when released.
+ */
+
+#include "level_pivot/projection_cache.hpp"
+
+namespace level_pivot {
+
+ProjectionCache& ProjectionCache::instance() {
+    static ProjectionCache cache;
+    return cache;
+}
+
+CachedProjection ProjectionCache::acquire(unsigned int table_oid, const Builder& build) {
+    auto it = entries_.find(table_oid);
+    if (it == entries_.end()) {
+        it = entries_.emplace(table_oid, Entry{}).first;
+        it->second.generation = next_generation_++;
+    }
+
+    CachedProjection cached;
+    cached.generation = it->second.generation;
+    if (!it->second.idle.empty()) {
+        cached.projection = std::move(it->second.idle.back());
+        it->second.idle.pop_back();
+    } else {
+        cached.projection = build();
+    }
+    return cached;
+}
+
+void ProjectionCache::release(unsigned int table_oid, CachedProjection cached) {
+    if (!cached.projection) {
+        return;
+    }
+    auto it = entries_.find(table_oid);
+    if (it == entries_.end() || it->second.generation != cached.generation ||
+        it->second.idle.size() >= MAX_IDLE_PER_TABLE) {
+        return;
+    }
+
+    std::vector<int> all_columns;
+    all_columns.reserve(cached.projection->column_count());
+    for (const auto& col : cached.projection->columns()) {
+        all_columns.push_back(col.attnum);
+    }
+    cached.projection->set_needed_columns(all_columns);
+
+    it->second.idle.push_back(std::move(cached.projection));
+}
+
+void ProjectionCache::invalidate(unsigned int table_oid) {
+    entries_.erase(table_oid);
+}
+
+void ProjectionCache::clear() {
+    entries_.clear();
+}
+
+size_t ProjectionCache::idle_count(unsigned int table_oid) const {
+    auto it = entries_.find(table_oid);
+    return it == entries_.end() ? 0 : it->second.idle.size();
+}
+
+} // namespace level_pivot
@@ -12,10 +12,12 @@
  *   - lower/upper bounds: range scans (WHERE key >= 'a' AND key < 'b')
  *
  * LevelDB's sorted key order makes range scans efficient - we seek
- * to the start and iterate until we exit the range.
+ * to the start and iterate until we exit the range. Reverse scans seek
+ * to the end instead and iterate backwards.
  */
 
 #include "level_pivot/raw_scanner.hpp"
+#include "level_pivot/key_parser.hpp"
 
 namespace level_pivot {
 
@@ -93,6 +95,63 @@ bool RawScanBounds::is_past_upper_bound(std::string_view key) const {
     }
 }
 
+/**
+ * Mirror of is_past_upper_bound() for reverse scans
+ */
+bool RawScanBounds::is_before_lower_bound(std::string_view key) const {
+    if (exact_key.has_value()) {
+        return key < *exact_key;
+    }
+    if (!lower_bound.has_value()) {
+        return false;
+    }
+
+    int cmp = key.compare(*lower_bound);
+    if (lower_inclusive) {
+        return cmp < 0;
+    } else {
+        return cmp <= 0;
+    }
+}
+
+/**
+ * Bounds from several predicates intersect: a lower bound only replaces
+ * the current one if it is greater, or equal and exclusive.
+ */
+void RawScanBounds::add_lower_bound(const std::string& key, bool inclusive) {
+    if (lower_bound.has_value()) {
+        int cmp = key.compare(*lower_bound);
+        if (cmp < 0 || (cmp == 0 && (inclusive || !lower_inclusive))) {
+            return;
+        }
+    }
+    lower_bound = key;
+    lower_inclusive = inclusive;
+}
+
+void RawScanBounds::add_upper_bound(const std::string& key, bool inclusive) {
+    if (upper_bound.has_value()) {
+        int cmp = key.compare(*upper_bound);
+        if (cmp > 0 || (cmp == 0 && (inclusive || !upper_inclusive))) {
+            return;
+        }
+    }
+    upper_bound = key;
+    upper_inclusive = inclusive;
+}
+
+/**
+ * A prefix is the range [prefix, successor). Prefixes of only 0xFF bytes
+ * have no successor and leave the upper bound open.
+ */
+void RawScanBounds::add_prefix(const std::string& prefix) {
+    add_lower_bound(prefix, true);
+    std::string end = KeyParser::prefix_successor(prefix);
+    if (!end.empty()) {
+        add_upper_bound(end, false);
+    }
+}
+
 // RawScanner implementation
 
 RawScanner::RawScanner(std::shared_ptr<LevelDBConnection> connection)
@@ -110,8 +169,23 @@ void RawScanner::begin_scan(const RawScanBounds& bounds) {
     stats_ = Stats{};
     bounds_ = bounds;
     exact_match_returned_ = false;
+    step_pending_ = false;
 
-    iterator_ = std::make_unique<LevelDBIterator>(connection_->iterator());
+    // An iterator made under the same pinned snapshot still sees the same
+    // data, so a rescan just seeks it rather than opening a new one
+    uint64_t epoch = connection_->snapshot_epoch();
+    if (!iterator_ || epoch == 0 || epoch != iterator_epoch_) {
+        iterator_ = std::make_unique<LevelDBIterator>(connection_->iterator(scan_options_));
+        iterator_epoch_ = epoch;
+        if (timing_) {
+            iterator_->time_moves(&stats_.read_ns);
+        }
+    }
+
+    if (reverse_ && !bounds_.is_exact_match()) {
+        seek_to_upper_bound();
+        return;
+    }
 
     std::string seek_key = bounds_.seek_start();
     if (seek_key.empty()) {
@@ -130,19 +204,37 @@ void RawScanner::begin_scan(const RawScanBounds& bounds) {
 }
 
 /**
- * Returns the next key-value pair, or nullopt when exhausted.
+ * Positions a reverse scan on the last key within the upper bound
+ */
+void RawScanner::seek_to_upper_bound() {
+    if (!bounds_.upper_bound.has_value()) {
+        iterator_->seek_to_last();
+        return;
+    }
+
+    iterator_->seek(*bounds_.upper_bound);
+    if (!iterator_->valid()) {
+        iterator_->seek_to_last();
+    } else if (bounds_.is_past_upper_bound(iterator_->key_view())) {
+        iterator_->prev();
+    }
+}
+
+/**
+ * Returns the next key-value pair, or nullptr when exhausted.
  *
  * Exact match queries (WHERE key = 'X') return at most one row.
  * Range queries iterate until upper bound is exceeded.
  *
- * We copy key and value into RawRow because LevelDB's iterator
- * invalidates previous data on next().
+ * The row views the iterator's key and value rather than copying them,
+ * since LevelDB invalidates both on next(). Moving past a returned row
+ * is therefore left to the following call.
  */
-std::optional<RawRow> RawScanner::next_row() {
+const RawRow* RawScanner::next_row() {
     // Exact match: O(log N) seek + single key check
     if (bounds_.is_exact_match()) {
         if (exact_match_returned_) {
-            return std::nullopt;
+            return nullptr;
         }
         exact_match_returned_ = true;
 
@@ -150,39 +242,54 @@ std::optional<RawRow> RawScanner::next_row() {
             std::string_view key_sv = iterator_->key_view();
             if (key_sv == *bounds_.exact_key) {
                 ++stats_.keys_scanned;
-                return RawRow{
-                    std::string(key_sv),
-                    std::string(iterator_->value_view())
-                };
+                row_ = RawRow{key_sv, iterator_->value_view()};
+                stats_.bytes_read += key_sv.size() + row_.value.size();
+                ++stats_.rows_returned;
+                return &row_;
             }
         }
-        return std::nullopt;
+        return nullptr;
     }
 
-    // Range or unbounded scan: iterate until exhausted or past upper bound
+    if (step_pending_) {
+        step_pending_ = false;
+        step();
+    }
+
+    // Range or unbounded scan: iterate until exhausted or past the bound
+    // the scan runs towards
     while (iterator_ && iterator_->valid()) {
         std::string_view key_sv = iterator_->key_view();
 
         // Early termination: sorted keys mean we're done
-        if (bounds_.is_past_upper_bound(key_sv)) {
-            return std::nullopt;
+        if (reverse_ ? bounds_.is_before_lower_bound(key_sv)
+                     : bounds_.is_past_upper_bound(key_sv)) {
+            return nullptr;
         }
 
         ++stats_.keys_scanned;
+        stats_.bytes_read += key_sv.size();
 
         if (bounds_.is_within_bounds(key_sv)) {
-            RawRow row{
-                std::string(key_sv),
-                std::string(iterator_->value_view())
-            };
-            iterator_->next();
-            return row;
+            row_ = RawRow{key_sv, iterator_->value_view()};
+            stats_.bytes_read += row_.value.size();
+            ++stats_.rows_returned;
+            step_pending_ = true;
+            return &row_;
         }
 
-        iterator_->next();
+        step();
     }
 
-    return std::nullopt;
+    return nullptr;
+}
+
+void RawScanner::step() {
+    if (reverse_) {
+        iterator_->prev();
+    } else {
+        iterator_->next();
+    }
 }
 
 void RawScanner::rescan() {
@@ -191,6 +298,7 @@ void RawScanner::rescan() {
 
 void RawScanner::end_scan() {
     iterator_.reset();
+    step_pending_ = false;
 }
 
 } // namespace level_pivot
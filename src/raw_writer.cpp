@@ -11,6 +11,7 @@
  */
 
 #include "level_pivot/raw_writer.hpp"
+#include <optional>
 
 namespace level_pivot {
 
@@ -40,6 +41,40 @@ RawWriteResult RawWriter::insert(const std::string& key, const std::string& valu
     RawWriteResult result;
     do_put(key, value);
     result.keys_written = 1;
+    if (changes_) {
+        changes_->add_key(key);
+    }
+    return result;
+}
+
+/**
+ * Batched INSERT: all pairs go into one WriteBatch so a multi-row insert
+ * costs one LevelDB write instead of one per row. Without a statement
+ * batch, a temporary batch covers just these rows.
+ */
+RawWriteResult RawWriter::insert_batch(const std::vector<std::string>& keys,
+                                       const std::vector<std::string>& values,
+                                       size_t count) {
+    RawWriteResult result;
+
+    std::optional<LevelDBWriteBatch> local_batch;
+    if (!batch_) {
+        local_batch.emplace(connection_->create_batch());
+    }
+    LevelDBWriteBatch& batch = batch_ ? *batch_ : *local_batch;
+
+    for (size_t i = 0; i < count; ++i) {
+        batch.put(keys[i], values[i]);
+        if (changes_) {
+            changes_->add_key(keys[i]);
+        }
+    }
+    result.keys_written = count;
+
+    if (local_batch) {
+        local_batch->commit();
+    }
+
     return result;
 }
 
@@ -52,6 +87,9 @@ RawWriteResult RawWriter::update(const std::string& key, const std::string& new_
     RawWriteResult result;
     do_put(key, new_value);
     result.keys_written = 1;
+    if (changes_) {
+        changes_->add_key(key);
+    }
     return result;
 }
 
@@ -63,6 +101,61 @@ RawWriteResult RawWriter::remove(const std::string& key) {
     RawWriteResult result;
     do_del(key);
     result.keys_deleted = 1;
+    if (changes_) {
+        changes_->add_key(key);
+    }
+    return result;
+}
+
+RawWriteResult RawWriter::remove_range(const RawScanBounds& bounds, const ScanOptions& scan) {
+    return modify_range(bounds, nullptr, scan);
+}
+
+RawWriteResult RawWriter::update_range(const RawScanBounds& bounds, const std::string& value,
+                                       const ScanOptions& scan) {
+    return modify_range(bounds, &value, scan);
+}
+
+/**
+ * Set-based DELETE/UPDATE: scan the bounds once and write each key found
+ * into one batch, rather than having PostgreSQL fetch every row and hand
+ * it back. The key buffer is reused across rows.
+ */
+RawWriteResult RawWriter::modify_range(const RawScanBounds& bounds, const std::string* value,
+                                       const ScanOptions& scan) {
+    RawWriteResult result;
+
+    std::optional<LevelDBWriteBatch> local_batch;
+    if (!batch_) {
+        local_batch.emplace(connection_->create_batch());
+    }
+    LevelDBWriteBatch& batch = batch_ ? *batch_ : *local_batch;
+
+    RawScanner scanner(connection_);
+    scanner.set_scan_options(scan);
+    scanner.begin_scan(bounds);
+
+    std::string key;
+    while (const RawRow* row = scanner.next_row()) {
+        key.assign(row->key);
+        if (value) {
+            batch.put(key, *value);
+            ++result.keys_written;
+        } else {
+            batch.del(key);
+            ++result.keys_deleted;
+        }
+        ++result.rows;
+        if (changes_) {
+            changes_->add_key(key);
+        }
+    }
+    scanner.end_scan();
+
+    if (local_batch) {
+        local_batch->commit();
+    }
+
     return result;
 }
 
@@ -8,23 +8,224 @@
  *   - discover(): Scans keys matching a pattern to find attr names
  *   - list_prefixes(): Finds common key prefixes (potential table names)
  *   - infer_pattern(): Guesses the key pattern from data samples
+ *   - infer_type(): Picks a column type that fits the sampled values
  *   - generate_foreign_table_sql(): Creates DDL from discovery results
  *
+ * Reading the first N keys of a large database only ever sees its first
+ * prefix. discover() and infer_pattern() can instead spread their reads
+ * over probes: the range is cut where LevelDB's approximate sizes say
+ * equal shares of the data begin, and each probe seeks to its cut and
+ * reads a short run of keys. Probes can run on several threads.
+ *
  * Used by: IMPORT FOREIGN SCHEMA command in PostgreSQL
  */
 
 #include "level_pivot/schema_discovery.hpp"
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstring>
+#include <future>
+#include <limits>
+#include <random>
 #include <sstream>
 #include <unordered_map>
 #include <regex>
 
 namespace level_pivot {
 
+namespace {
+
+// Bisection steps per split point; each is one approximate-size lookup
+constexpr int BISECT_STEPS = 24;
+
+// Split points are reproducible for a given database
+constexpr unsigned SPLIT_SEED = 20240601;
+
+// Probe iterators open at once; each pins its current blocks, so any
+// number of probes is read this many at a time
+constexpr size_t MAX_OPEN_PROBES = 64;
+
+bool before_end(std::string_view key, const std::string& end) {
+    return end.empty() || key < std::string_view(end);
+}
+
+/**
+ * The key a fraction of the way from a to b (a < b), treating the eight
+ * bytes after their common prefix as a big-endian number
+ */
+std::string key_between(const std::string& a, const std::string& b, double fraction) {
+    size_t common = 0;
+    while (common < a.size() && common < b.size() && a[common] == b[common]) {
+        ++common;
+    }
+    auto tail = [common](const std::string& key) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            value <<= 8;
+            if (common + i < key.size()) {
+                value |= static_cast<unsigned char>(key[common + i]);
+            }
+        }
+        return value;
+    };
+    uint64_t from = tail(a);
+    uint64_t to = tail(b);
+    uint64_t value = from + static_cast<uint64_t>(
+        static_cast<long double>(to - from) * fraction);
+
+    std::string key = a.substr(0, common);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        key.push_back(static_cast<char>(value >> shift));
+    }
+    while (key.size() > common && key.back() == '\0') {
+        key.pop_back();
+    }
+    return key;
+}
+
+/**
+ * The narrower of two prefixes, or nullopt if no key has both
+ */
+std::optional<std::string> narrower_prefix(const std::string& a, const std::string& b) {
+    if (a.compare(0, b.size(), b) == 0) {
+        return a;
+    }
+    if (b.compare(0, a.size(), a) == 0) {
+        return b;
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
 SchemaDiscovery::SchemaDiscovery(std::shared_ptr<LevelDBConnection> connection)
     : connection_(std::move(connection)) {}
 
+/**
+ * Interpolates between the range's first and last keys rather than its
+ * bounds, since keys seldom use every byte value a prefix allows. Each
+ * split point is found by bisecting on approximate_size(first, point).
+ */
+std::vector<std::string> SchemaDiscovery::split_points(const std::string& start,
+                                                       const std::string& limit,
+                                                       size_t parts) {
+    std::vector<std::string> points = {start};
+    if (parts <= 1) {
+        return points;
+    }
+
+    std::string first;
+    std::string last;
+    {
+        auto iter = connection_->iterator();
+        iter.seek(start);
+        if (!iter.valid() || !before_end(iter.key_view(), limit)) {
+            return points;
+        }
+        first = iter.key();
+
+        if (limit.empty()) {
+            iter.seek_to_last();
+        } else {
+            iter.seek(limit);
+            if (iter.valid()) {
+                iter.prev();
+            } else {
+                iter.seek_to_last();
+            }
+        }
+        if (!iter.valid()) {
+            return points;
+        }
+        last = iter.key();
+    }
+    if (first >= last) {
+        return points;
+    }
+
+    uint64_t total = connection_->approximate_size(first, last);
+    std::minstd_rand rng(SPLIT_SEED);
+    std::uniform_real_distribution<double> within(0.0, 1.0);
+    double low = 0.0;
+
+    for (size_t i = 1; i < parts; ++i) {
+        double fraction;
+        if (total > 0) {
+            uint64_t target = static_cast<uint64_t>(
+                static_cast<long double>(total) * i / parts);
+            double high = 1.0;
+            for (int step = 0; step < BISECT_STEPS; ++step) {
+                double mid = (low + high) / 2;
+                if (connection_->approximate_size(first, key_between(first, last, mid)) < target) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            fraction = high;
+        } else {
+            // Nothing on disk yet: a random point within the i-th share
+            fraction = (i + within(rng)) / parts;
+        }
+
+        std::string point = key_between(first, last, fraction);
+        if (point > points.back()) {
+            points.push_back(std::move(point));
+        }
+    }
+    return points;
+}
+
+/**
+ * Opens the probes' iterators on this thread, since the connection
+ * itself is not thread-safe; LevelDB iterators can then each be read on
+ * a thread of their own. Brokered connections share one socket, so their
+ * probes always run here in turn. At most MAX_OPEN_PROBES iterators are
+ * open at a time, however many probes were asked for.
+ */
+void SchemaDiscovery::run_probes(const std::string& start, const std::string& limit,
+                                 size_t probes, size_t threads, const Probe& probe) {
+    std::vector<std::string> points = split_points(start, limit, probes);
+
+    std::vector<LevelDBIterator> iters;
+    for (size_t first = 0; first < points.size(); first += MAX_OPEN_PROBES) {
+        size_t count = std::min(MAX_OPEN_PROBES, points.size() - first);
+        iters.clear();
+        iters.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            iters.push_back(connection_->iterator());
+        }
+
+        auto read = [&](size_t i) {
+            size_t p = first + i;
+            iters[i].seek(points[p]);
+            probe(p, iters[i], p + 1 < points.size() ? points[p + 1] : limit);
+        };
+
+        size_t workers = connection_->is_brokered() ? 1 : std::min(threads, count);
+        if (workers <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                read(i);
+            }
+            continue;
+        }
+
+        std::vector<std::future<void>> running;
+        running.reserve(workers);
+        for (size_t w = 0; w < workers; ++w) {
+            running.push_back(std::async(std::launch::async, [&, w] {
+                for (size_t i = w; i < count; i += workers) {
+                    read(i);
+                }
+            }));
+        }
+        for (auto& worker : running) {
+            worker.get();
+        }
+    }
+}
+
 /**
  * Scans LevelDB keys matching a pattern to discover attr column names.
  *
@@ -35,70 +236,92 @@ SchemaDiscovery::SchemaDiscovery(std::shared_ptr<LevelDBConnection> connection)
  *   - prefix_filter: only scan keys starting with this prefix
  *   - max_keys: stop after scanning this many keys (default 10000)
  *   - sample_size: store this many sample values per attr
+ *   - probes, threads: spread the scan over the range (see run_probes)
+ *
+ * Each probe counts into its own map, so threads share nothing until
+ * the maps are merged in probe order.
  */
 DiscoveryResult SchemaDiscovery::discover(const KeyPattern& pattern,
                                           const DiscoveryOptions& options) {
     DiscoveryResult result;
     KeyParser parser(pattern);
 
-    std::unordered_map<std::string, DiscoveredAttr> attr_map;
-
-    auto iter = connection_->iterator();
-
-    if (options.prefix_filter.empty()) {
-        std::string prefix = pattern.literal_prefix();
-        if (prefix.empty()) {
-            iter.seek_to_first();
-        } else {
-            iter.seek(prefix);
-        }
-    } else {
-        iter.seek(options.prefix_filter);
+    auto start = narrower_prefix(pattern.literal_prefix(), options.prefix_filter);
+    if (!start) {
+        return result;
     }
+    std::string limit = start->empty() ? std::string() : KeyParser::prefix_successor(*start);
+
+    size_t probes = std::clamp<size_t>(options.probes, 1, std::max<size_t>(options.max_keys, 1));
+    size_t keys_per_probe = options.max_keys / probes;
+
+    struct ProbeResult {
+        std::unordered_map<std::string, DiscoveredAttr> attrs;
+        size_t keys_scanned = 0;
+        size_t keys_matched = 0;
+    };
+    std::vector<ProbeResult> probe_results(probes);
+
+    run_probes(*start, limit, probes, options.threads,
+               [&](size_t i, LevelDBIterator& iter, const std::string& end) {
+        ProbeResult& out = probe_results[i];
+        while (iter.valid() && out.keys_scanned < keys_per_probe) {
+            std::string_view key = iter.key_view();
+            if (!before_end(key, end)) {
+                break;
+            }
+            ++out.keys_scanned;
+
+            auto parsed = parser.parse_view(key);
+            if (parsed) {
+                ++out.keys_matched;
+
+                std::string name(parsed->attr_name);
+                auto& attr = out.attrs[name];
+                attr.name = std::move(name);
+                ++attr.sample_count;
+                if (attr.samples.size() < options.sample_size) {
+                    attr.samples.push_back(iter.value());
+                }
+            }
 
-    while (iter.valid() && result.keys_scanned < options.max_keys) {
-        std::string key = iter.key();
-
-        // Check prefix filter
-        if (!options.prefix_filter.empty() &&
-            key.compare(0, options.prefix_filter.size(), options.prefix_filter) != 0) {
-            break;
-        }
-
-        // Check pattern prefix
-        if (!parser.starts_with_prefix(key)) {
-            break;
+            iter.next();
         }
+    });
 
-        ++result.keys_scanned;
-
-        // Try to parse
-        auto parsed = parser.parse(key);
-        if (parsed) {
-            ++result.keys_matched;
-
-            auto& attr = attr_map[parsed->attr_name];
-            attr.name = parsed->attr_name;
-            ++attr.sample_count;
-
-            // Store a sample value if we haven't reached the limit
-            if (attr.sample_count <= options.sample_size && attr.sample_value.empty()) {
-                attr.sample_value = iter.value();
+    std::unordered_map<std::string, DiscoveredAttr> attr_map;
+    for (auto& probe : probe_results) {
+        result.keys_scanned += probe.keys_scanned;
+        result.keys_matched += probe.keys_matched;
+        for (auto& [name, found] : probe.attrs) {
+            auto& attr = attr_map[name];
+            attr.name = name;
+            attr.sample_count += found.sample_count;
+            for (auto& value : found.samples) {
+                if (attr.samples.size() >= options.sample_size) {
+                    break;
+                }
+                attr.samples.push_back(std::move(value));
             }
         }
-
-        iter.next();
     }
 
     // Convert map to vector and sort by frequency
     result.attrs.reserve(attr_map.size());
     for (auto& [name, attr] : attr_map) {
+        if (!attr.samples.empty()) {
+            attr.sample_value = attr.samples.front();
+        }
+        attr.inferred_type = infer_type(attr.samples);
         result.attrs.push_back(std::move(attr));
     }
 
     std::sort(result.attrs.begin(), result.attrs.end(),
               [](const DiscoveredAttr& a, const DiscoveredAttr& b) {
-                  return a.sample_count > b.sample_count;
+                  if (a.sample_count != b.sample_count) {
+                      return a.sample_count > b.sample_count;
+                  }
+                  return a.name < b.name;
               });
 
     return result;
@@ -173,25 +396,39 @@ std::vector<std::string> SchemaDiscovery::list_prefixes(size_t depth,
  * Attempts to infer a key pattern from sample data.
  *
  * Algorithm:
- *   1. Sample N keys from the database
+ *   1. Sample N keys from the database, spread over the given probes
  *   2. Count occurrences of common delimiters (##, ::, /, etc.)
  *   3. Pick the most common delimiter
- *   4. Split keys by that delimiter
+ *   4. Split keys by that delimiter; the most common segment count
+ *      gives the key structure
  *   5. Identify which segments are constant vs variable
  *   6. Generate pattern with {colN} for variables, {attr} for last
  *
  * Returns nullopt if the database is empty or no pattern is detectable.
  */
-std::optional<std::string> SchemaDiscovery::infer_pattern(size_t sample_count) {
+std::optional<std::string> SchemaDiscovery::infer_pattern(size_t sample_count,
+                                                          size_t probes,
+                                                          size_t threads) {
+    probes = std::clamp<size_t>(probes, 1, std::max<size_t>(sample_count, 1));
+    size_t keys_per_probe = sample_count / probes;
+    std::vector<std::vector<std::string>> probe_samples(probes);
+
+    run_probes(std::string(), std::string(), probes, threads,
+               [&](size_t i, LevelDBIterator& iter, const std::string& end) {
+        auto& out = probe_samples[i];
+        while (iter.valid() && out.size() < keys_per_probe &&
+               before_end(iter.key_view(), end)) {
+            out.push_back(iter.key());
+            iter.next();
+        }
+    });
+
     std::vector<std::string> samples;
     samples.reserve(sample_count);
-
-    auto iter = connection_->iterator();
-    iter.seek_to_first();
-
-    while (iter.valid() && samples.size() < sample_count) {
-        samples.push_back(iter.key());
-        iter.next();
+    for (auto& keys : probe_samples) {
+        for (auto& key : keys) {
+            samples.push_back(std::move(key));
+        }
     }
 
     if (samples.empty()) {
@@ -226,18 +463,42 @@ std::optional<std::string> SchemaDiscovery::infer_pattern(size_t sample_count) {
         return std::nullopt;
     }
 
-    // Split first key by delimiter and create pattern
-    const auto& first_key = samples[0];
-    std::vector<std::string> parts;
-    size_t start = 0;
-    size_t pos;
+    auto split = [&best_delim](const std::string& key) {
+        std::vector<std::string> key_parts;
+        size_t start = 0;
+        size_t pos;
+        while ((pos = key.find(best_delim, start)) != std::string::npos) {
+            key_parts.push_back(key.substr(start, pos - start));
+            start = pos + best_delim.size();
+        }
+        if (start < key.size()) {
+            key_parts.push_back(key.substr(start));
+        }
+        return key_parts;
+    };
 
-    while ((pos = first_key.find(best_delim, start)) != std::string::npos) {
-        parts.push_back(first_key.substr(start, pos - start));
-        start = pos + best_delim.size();
+    // Samples from across the database may come from several tables;
+    // follow the structure most of them share, starting from the first
+    // key that has it
+    std::unordered_map<size_t, size_t> part_counts;
+    for (const auto& key : samples) {
+        ++part_counts[split(key).size()];
     }
-    if (start < first_key.size()) {
-        parts.push_back(first_key.substr(start));
+    size_t common_parts = 0;
+    size_t common_count = 0;
+    for (const auto& [count, keys] : part_counts) {
+        if (keys > common_count || (keys == common_count && count < common_parts)) {
+            common_parts = count;
+            common_count = keys;
+        }
+    }
+
+    std::vector<std::string> parts;
+    for (const auto& key : samples) {
+        parts = split(key);
+        if (parts.size() == common_parts) {
+            break;
+        }
     }
 
     if (parts.size() < 2) {
@@ -250,16 +511,7 @@ std::optional<std::string> SchemaDiscovery::infer_pattern(size_t sample_count) {
     std::vector<std::unordered_set<std::string>> part_values(parts.size());
 
     for (const auto& key : samples) {
-        std::vector<std::string> key_parts;
-        start = 0;
-
-        while ((pos = key.find(best_delim, start)) != std::string::npos) {
-            key_parts.push_back(key.substr(start, pos - start));
-            start = pos + best_delim.size();
-        }
-        if (start < key.size()) {
-            key_parts.push_back(key.substr(start));
-        }
+        std::vector<std::string> key_parts = split(key);
 
         // Only analyze keys with the same structure (same number of parts)
         if (key_parts.size() == parts.size()) {
@@ -294,12 +546,219 @@ std::optional<std::string> SchemaDiscovery::infer_pattern(size_t sample_count) {
     return pattern.str();
 }
 
+namespace {
+
+// Types a value parses as, one bit per candidate
+enum TypeBit : unsigned {
+    BOOLEAN_BIT = 1 << 0,
+    INTEGER_BIT = 1 << 1,
+    BIGINT_BIT = 1 << 2,
+    NUMERIC_BIT = 1 << 3,
+    DATE_BIT = 1 << 4,
+    TIMESTAMP_BIT = 1 << 5,
+    TIMESTAMPTZ_BIT = 1 << 6,
+    JSONB_BIT = 1 << 7,
+};
+
+bool all_digits(std::string_view s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(),
+                                     [](unsigned char c) { return std::isdigit(c); });
+}
+
+bool equals_ignore_case(std::string_view s, std::string_view word) {
+    return s.size() == word.size() &&
+           std::equal(s.begin(), s.end(), word.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+// [+-]digits[.digits][e[+-]digits], with a digit on some side of the point
+bool is_decimal(std::string_view s) {
+    auto is_digit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+    size_t i = 0;
+    if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+        ++i;
+    }
+    size_t digits = 0;
+    for (; i < s.size() && is_digit(s[i]); ++i) {
+        ++digits;
+    }
+    if (i < s.size() && s[i] == '.') {
+        for (++i; i < s.size() && is_digit(s[i]); ++i) {
+            ++digits;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+        ++i;
+        if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+            ++i;
+        }
+        return all_digits(s.substr(i));
+    }
+    return i == s.size();
+}
+
+// YYYY-MM-DD
+bool is_date(std::string_view s) {
+    return s.size() == 10 && s[4] == '-' && s[7] == '-' &&
+           all_digits(s.substr(0, 4)) && all_digits(s.substr(5, 2)) && all_digits(s.substr(8, 2));
+}
+
+/**
+ * YYYY-MM-DD[T ]HH:MM:SS[.fff]; sets zoned if followed by Z or an
+ * offset ([+-]HH[:MM])
+ */
+bool is_timestamp(std::string_view s, bool& zoned) {
+    if (s.size() < 19 || !is_date(s.substr(0, 10)) || (s[10] != 'T' && s[10] != ' ') ||
+        s[13] != ':' || s[16] != ':' || !all_digits(s.substr(11, 2)) ||
+        !all_digits(s.substr(14, 2)) || !all_digits(s.substr(17, 2))) {
+        return false;
+    }
+    std::string_view rest = s.substr(19);
+    if (!rest.empty() && rest[0] == '.') {
+        size_t digits = 1;
+        while (digits < rest.size() && std::isdigit(static_cast<unsigned char>(rest[digits]))) {
+            ++digits;
+        }
+        if (digits == 1) {
+            return false;
+        }
+        rest.remove_prefix(digits);
+    }
+    zoned = !rest.empty();
+    if (rest.empty() || rest == "Z") {
+        return true;
+    }
+    if (rest[0] != '+' && rest[0] != '-') {
+        return false;
+    }
+    rest.remove_prefix(1);
+    return (rest.size() == 2 && all_digits(rest)) ||
+           (rest.size() == 4 && all_digits(rest)) ||
+           (rest.size() == 5 && rest[2] == ':' && all_digits(rest.substr(0, 2)) &&
+            all_digits(rest.substr(3)));
+}
+
+/**
+ * An object or array whose brackets balance outside strings. Not a full
+ * JSON check; jsonb_in has the last word when the column is read.
+ */
+bool looks_like_json(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) {
+        s.remove_suffix(1);
+    }
+    if (s.size() < 2 || !((s.front() == '{' && s.back() == '}') ||
+                          (s.front() == '[' && s.back() == ']'))) {
+        return false;
+    }
+    std::string open;
+    bool in_string = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (in_string) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            open.push_back(c);
+        } else if (c == '}' || c == ']') {
+            if (open.empty() || open.back() != (c == '}' ? '{' : '[')) {
+                return false;
+            }
+            open.pop_back();
+            if (open.empty() && i + 1 != s.size()) {
+                return false;
+            }
+        }
+    }
+    return open.empty() && !in_string;
+}
+
+unsigned type_bits(std::string_view value) {
+    unsigned bits = 0;
+    if (equals_ignore_case(value, "true") || equals_ignore_case(value, "false")) {
+        bits |= BOOLEAN_BIT;
+    }
+    int64_t number;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (ec == std::errc{} && ptr == value.data() + value.size()) {
+        bits |= BIGINT_BIT | NUMERIC_BIT;
+        if (number >= std::numeric_limits<int32_t>::min() &&
+            number <= std::numeric_limits<int32_t>::max()) {
+            bits |= INTEGER_BIT;
+        }
+    } else if (is_decimal(value)) {
+        bits |= NUMERIC_BIT;
+    }
+    bool zoned = false;
+    if (is_date(value)) {
+        bits |= DATE_BIT | TIMESTAMP_BIT | TIMESTAMPTZ_BIT;
+    } else if (is_timestamp(value, zoned)) {
+        bits |= TIMESTAMPTZ_BIT;
+        if (!zoned) {
+            bits |= TIMESTAMP_BIT;
+        }
+    }
+    if (looks_like_json(value)) {
+        bits |= JSONB_BIT;
+    }
+    return bits;
+}
+
+} // namespace
+
+/**
+ * Intersects the types each sample parses as and takes the narrowest
+ * left. A database holding "12" and "12.5" under one attr gets NUMERIC;
+ * one also holding "n/a" gets TEXT.
+ */
+PgType infer_type(const std::vector<std::string>& samples) {
+    if (samples.empty()) {
+        return PgType::TEXT;
+    }
+    unsigned bits = ~0u;
+    for (const auto& value : samples) {
+        bits &= type_bits(value);
+        if (bits == 0) {
+            return PgType::TEXT;
+        }
+    }
+
+    static constexpr std::pair<unsigned, PgType> preference[] = {
+        {BOOLEAN_BIT, PgType::BOOLEAN},
+        {INTEGER_BIT, PgType::INTEGER},
+        {BIGINT_BIT, PgType::BIGINT},
+        {NUMERIC_BIT, PgType::NUMERIC},
+        {DATE_BIT, PgType::DATE},
+        {TIMESTAMP_BIT, PgType::TIMESTAMP},
+        {TIMESTAMPTZ_BIT, PgType::TIMESTAMPTZ},
+        {JSONB_BIT, PgType::JSONB},
+    };
+    for (const auto& [bit, type] : preference) {
+        if (bits & bit) {
+            return type;
+        }
+    }
+    return PgType::TEXT;
+}
+
 /**
  * Generates a CREATE FOREIGN TABLE statement from discovery results.
  *
  * Identity columns come from the pattern's capture names (e.g., {id}, {group}).
- * Attr columns come from the discovered attr names in the data.
- * All columns default to TEXT type (type inference is reserved for future).
+ * Attr columns come from the discovered attr names in the data, typed
+ * as inferred from their sampled values unless use_text_type is set.
+ * Identity columns are always TEXT.
  *
  * Example output:
  *   CREATE FOREIGN TABLE users (
@@ -317,8 +776,6 @@ std::string generate_foreign_table_sql(
     const DiscoveryResult& discovery,
     bool use_text_type) {
 
-    (void)use_text_type;  // Reserved for future type inference
-
     std::ostringstream sql;
 
     sql << "CREATE FOREIGN TABLE " << table_name << " (\n";
@@ -340,7 +797,8 @@ std::string generate_foreign_table_sql(
     for (const auto& attr : discovery.attrs) {
         if (!first) sql << ",\n";
         first = false;
-        sql << "    " << attr.name << " TEXT";
+        sql << "    " << attr.name << " "
+            << pg_type_name(use_text_type ? PgType::TEXT : attr.inferred_type);
     }
 
     sql << "\n)\n";
@@ -0,0 +1,418 @@
+/**
+ * secondary_index.cpp - Index entries on attr values, and lookups by them
+ *
+ * Without an index, "find the user with this email" reads every row of
+ * the table, since only identity values are part of the keys. An index
+ * entry puts the value in the key instead, so a lookup is one seek per
+ * value and the rows come from point lookups on the identities it finds.
+ *
+ * Entries of one attr sort by value, but not strictly: the "##" after
+ * the value means a value followed by bytes below '#' ("Ann Lee") sorts
+ * before its own prefix ("Ann"). Equality lookups don't care, since they
+ * seek to the value and its separator; range lookups widen their end (see
+ * range_end) and check each decoded value instead.
+ */
+
+#include "level_pivot/secondary_index.hpp"
+#include "level_pivot/error.hpp"
+#include <algorithm>
+
+namespace level_pivot {
+
+namespace {
+
+constexpr std::string_view INDEX_KEY_PREFIX = "idx##";
+constexpr std::string_view INDEX_SEPARATOR = "##";
+
+void append_u32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+uint32_t read_u32(std::string_view in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(in[i]);
+    }
+    return value;
+}
+
+void append_joined(std::string& out, const std::vector<std::string>& identity) {
+    for (size_t i = 0; i < identity.size(); ++i) {
+        if (i > 0) {
+            out += INDEX_SEPARATOR;
+        }
+        out += identity[i];
+    }
+}
+
+size_t joined_size(const std::vector<std::string>& identity) {
+    size_t size = identity.empty() ? 0 : (identity.size() - 1) * INDEX_SEPARATOR.size();
+    for (const auto& value : identity) {
+        size += value.size();
+    }
+    return size;
+}
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\n");
+    return s.substr(start, end - start + 1);
+}
+
+/**
+ * Exclusive end of the entries whose value is at most upper. Entries of
+ * values that are proper prefixes of upper can sort after upper itself
+ * when upper continues with a byte at or below '#', so the range ends
+ * after everything starting with upper's bytes up to the first such byte.
+ */
+std::string range_end(const std::string& prefix, const std::string& upper) {
+    size_t keep = 0;
+    while (keep < upper.size() && static_cast<unsigned char>(upper[keep]) > '#') {
+        ++keep;
+    }
+    return KeyParser::prefix_successor(prefix + upper.substr(0, keep));
+}
+
+} // anonymous namespace
+
+bool IndexLookup::add(AttrFilterOp op, const std::vector<std::string>& operands) {
+    if (op == AttrFilterOp::IS_NULL || op == AttrFilterOp::IS_NOT_NULL || operands.empty()) {
+        return false;
+    }
+
+    switch (op) {
+        case AttrFilterOp::EQ:
+        case AttrFilterOp::IN: {
+            std::vector<std::string> list = op == AttrFilterOp::EQ
+                ? std::vector<std::string>{operands.front()} : operands;
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            if (values) {
+                // Both lists must hold
+                std::vector<std::string> both;
+                std::set_intersection(values->begin(), values->end(),
+                                      list.begin(), list.end(),
+                                      std::back_inserter(both));
+                list = std::move(both);
+            }
+            values = std::move(list);
+            break;
+        }
+        case AttrFilterOp::GT:
+        case AttrFilterOp::GE: {
+            bool inclusive = op == AttrFilterOp::GE;
+            const std::string& bound = operands.front();
+            if (!lower || bound > *lower || (bound == *lower && !inclusive)) {
+                lower = bound;
+                lower_inclusive = inclusive;
+            }
+            break;
+        }
+        case AttrFilterOp::LT:
+        case AttrFilterOp::LE: {
+            bool inclusive = op == AttrFilterOp::LE;
+            const std::string& bound = operands.front();
+            if (!upper || bound < *upper || (bound == *upper && !inclusive)) {
+                upper = bound;
+                upper_inclusive = inclusive;
+            }
+            break;
+        }
+        case AttrFilterOp::PREFIX:
+            // The longer of two prefixes implies the other, if they agree
+            if (!prefix || operands.front().size() > prefix->size()) {
+                if (prefix && operands.front().compare(0, prefix->size(), *prefix) != 0) {
+                    values = std::vector<std::string>();  // Contradiction
+                }
+                prefix = operands.front();
+            } else if (prefix->compare(0, operands.front().size(), operands.front()) != 0) {
+                values = std::vector<std::string>();
+            }
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool IndexLookup::matches(std::string_view value) const {
+    if (values && !std::binary_search(values->begin(), values->end(), value)) {
+        return false;
+    }
+    if (lower) {
+        int cmp = value.compare(*lower);
+        if (cmp < 0 || (cmp == 0 && !lower_inclusive)) {
+            return false;
+        }
+    }
+    if (upper) {
+        int cmp = value.compare(*upper);
+        if (cmp > 0 || (cmp == 0 && !upper_inclusive)) {
+            return false;
+        }
+    }
+    if (prefix && value.substr(0, prefix->size()) != *prefix) {
+        return false;
+    }
+    return true;
+}
+
+SecondaryIndex::SecondaryIndex(std::string table, std::vector<std::string> attrs)
+    : table_(std::move(table)), attrs_(std::move(attrs)) {
+    if (table_.empty()) {
+        throw LevelPivotError("secondary index needs a table name");
+    }
+}
+
+std::vector<std::string> SecondaryIndex::parse_attr_list(const std::string& option) {
+    std::vector<std::string> attrs;
+    size_t start = 0;
+    while (true) {
+        size_t comma = option.find(',', start);
+        std::string name = trim(option.substr(start, comma == std::string::npos
+                                                         ? std::string::npos
+                                                         : comma - start));
+        if (name.empty()) {
+            return {};
+        }
+        if (std::find(attrs.begin(), attrs.end(), name) == attrs.end()) {
+            attrs.push_back(std::move(name));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return attrs;
+}
+
+bool SecondaryIndex::indexes(std::string_view attr) const {
+    return std::find(attrs_.begin(), attrs_.end(), attr) != attrs_.end();
+}
+
+std::string SecondaryIndex::table_prefix() const {
+    std::string prefix(INDEX_KEY_PREFIX);
+    prefix += table_;
+    prefix += INDEX_SEPARATOR;
+    return prefix;
+}
+
+std::string SecondaryIndex::attr_prefix(std::string_view attr) const {
+    std::string prefix = table_prefix();
+    prefix += attr;
+    prefix += INDEX_SEPARATOR;
+    return prefix;
+}
+
+void SecondaryIndex::build_entry(std::string_view attr, std::string_view value,
+                                 const std::vector<std::string>& identity,
+                                 std::string& key, std::string& entry_value) const {
+    key = entry_key(attr, value, identity);
+
+    entry_value.clear();
+    for (const auto& capture : identity) {
+        append_u32(entry_value, static_cast<uint32_t>(capture.size()));
+        entry_value += capture;
+    }
+}
+
+std::string SecondaryIndex::entry_key(std::string_view attr, std::string_view value,
+                                      const std::vector<std::string>& identity) const {
+    std::string key = attr_prefix(attr);
+    key.reserve(key.size() + value.size() + INDEX_SEPARATOR.size() + joined_size(identity));
+    key += value;
+    key += INDEX_SEPARATOR;
+    append_joined(key, identity);
+    return key;
+}
+
+bool SecondaryIndex::decode_entry(std::string_view key, std::string_view entry_value,
+                                  size_t prefix_size, std::string_view& value,
+                                  std::vector<std::string>& identity) {
+    identity.clear();
+    while (!entry_value.empty()) {
+        if (entry_value.size() < 4) {
+            return false;
+        }
+        uint32_t size = read_u32(entry_value);
+        entry_value.remove_prefix(4);
+        if (entry_value.size() < size) {
+            return false;
+        }
+        identity.emplace_back(entry_value.substr(0, size));
+        entry_value.remove_prefix(size);
+    }
+
+    // The key must end in "##" and the joined identity
+    size_t tail = INDEX_SEPARATOR.size() + joined_size(identity);
+    if (key.size() < prefix_size + tail) {
+        return false;
+    }
+    size_t value_size = key.size() - prefix_size - tail;
+    std::string_view rest = key.substr(prefix_size + value_size);
+    if (rest.substr(0, INDEX_SEPARATOR.size()) != INDEX_SEPARATOR) {
+        return false;
+    }
+    rest.remove_prefix(INDEX_SEPARATOR.size());
+    for (size_t i = 0; i < identity.size(); ++i) {
+        if (i > 0) {
+            if (rest.substr(0, INDEX_SEPARATOR.size()) != INDEX_SEPARATOR) {
+                return false;
+            }
+            rest.remove_prefix(INDEX_SEPARATOR.size());
+        }
+        if (rest.substr(0, identity[i].size()) != identity[i]) {
+            return false;
+        }
+        rest.remove_prefix(identity[i].size());
+    }
+
+    value = key.substr(prefix_size, value_size);
+    return true;
+}
+
+std::vector<std::vector<std::string>> SecondaryIndex::lookup(
+    LevelDBConnection& connection, std::string_view attr,
+    const IndexLookup& lookup, const ScanOptions& scan) const {
+
+    std::vector<std::vector<std::string>> identities;
+    if (lookup.empty() || (lookup.values && lookup.values->empty())) {
+        return identities;
+    }
+
+    const std::string prefix = attr_prefix(attr);
+    auto iter = connection.iterator(scan);
+    std::string_view value;
+    std::vector<std::string> identity;
+
+    // Visit [start, end) and keep the entries whose value matches
+    auto collect = [&](const std::string& start, const std::string& end) {
+        for (iter.seek(start); iter.valid(); iter.next()) {
+            std::string_view key = iter.key_view();
+            if (!end.empty() && key >= end) {
+                break;
+            }
+            if (decode_entry(key, iter.value_view(), prefix.size(), value, identity) &&
+                lookup.matches(value)) {
+                identities.push_back(identity);
+            }
+        }
+    };
+
+    if (lookup.values) {
+        // One seek per value, to the value and its separator
+        for (const auto& exact : *lookup.values) {
+            std::string start = prefix + exact;
+            start += INDEX_SEPARATOR;
+            collect(start, KeyParser::prefix_successor(start));
+        }
+    } else {
+        std::string start = prefix;
+        std::string end = KeyParser::prefix_successor(prefix);
+        if (lookup.lower) {
+            start = std::max(start, prefix + *lookup.lower);
+        }
+        if (lookup.prefix) {
+            start = std::max(start, prefix + *lookup.prefix);
+            end = std::min(end, KeyParser::prefix_successor(prefix + *lookup.prefix));
+        }
+        if (lookup.upper) {
+            end = std::min(end, range_end(prefix, *lookup.upper));
+        }
+        if (end.empty() || start < end) {
+            collect(start, end);
+        }
+    }
+
+    std::sort(identities.begin(), identities.end());
+    identities.erase(std::unique(identities.begin(), identities.end()), identities.end());
+    return identities;
+}
+
+/**
+ * Two passes: drop every entry under the index's prefix, then walk the
+ * table's keys and write an entry per indexed attr key. Each pass reads
+ * through an iterator opened before its own writes, so the table pass
+ * never meets the entries it writes.
+ */
+SecondaryIndex::RebuildResult SecondaryIndex::rebuild(LevelDBConnection& connection,
+                                                      const KeyParser& parser,
+                                                      size_t batch_keys) const {
+    RebuildResult result;
+    batch_keys = std::max<size_t>(batch_keys, 1);
+
+    std::optional<LevelDBWriteBatch> batch;
+    auto flush = [&](bool last) {
+        if (batch && (last || batch->pending_count() >= batch_keys)) {
+            batch->commit();
+            batch.reset();
+        }
+    };
+
+    const std::string prefix = table_prefix();
+    const std::string prefix_end = KeyParser::prefix_successor(prefix);
+    ScanOptions bulk;
+    bulk.fill_cache = false;
+
+    {
+        auto iter = connection.iterator(bulk);
+        for (iter.seek(prefix); iter.valid(); iter.next()) {
+            std::string_view key = iter.key_view();
+            if (key >= prefix_end) {
+                break;
+            }
+            if (!batch) {
+                batch.emplace(connection.create_batch());
+            }
+            batch->del(std::string(key));
+            ++result.entries_deleted;
+            flush(false);
+        }
+        flush(true);
+    }
+
+    const std::string table_start = parser.build_prefix();
+    const std::string table_end = KeyParser::prefix_successor(table_start);
+    auto iter = connection.iterator(bulk);
+    ParsedKeyView parsed;
+    std::vector<std::string> identity;
+    std::string key;
+    std::string entry_value;
+
+    if (table_start.empty()) {
+        iter.seek_to_first();
+    } else {
+        iter.seek(table_start);
+    }
+    for (; iter.valid(); iter.next()) {
+        std::string_view table_key = iter.key_view();
+        if (!table_end.empty() && table_key >= table_end) {
+            break;
+        }
+        // An index sharing the table's key space mustn't index itself
+        if (table_key.substr(0, prefix.size()) == prefix) {
+            continue;
+        }
+        if (!parser.parse_view_into(table_key, parsed) || !indexes(parsed.attr_name)) {
+            continue;
+        }
+        identity.assign(parsed.capture_values.begin(), parsed.capture_values.end());
+        build_entry(parsed.attr_name, iter.value_view(), identity, key, entry_value);
+        if (!batch) {
+            batch.emplace(connection.create_batch());
+        }
+        batch->put(key, entry_value);
+        ++result.entries_written;
+        flush(false);
+    }
+    flush(true);
+
+    return result;
+}
+
+} // namespace level_pivot
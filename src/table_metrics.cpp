@@ -0,0 +1,158 @@
+/**
+ * table_metrics.cpp - Cumulative per-table activity counters
+ *
+ * The extension keeps one TableMetrics in a shared memory segment, so the
+ * counts add up over every backend. A table's slot is found by hashing
+ * its id and probing forward; a free slot is claimed with a compare-and-
+ * swap, so two backends recording a new table at once end up in the same
+ * slot. Slots are never given back: a dropped table keeps its slot until
+ * the server restarts, which is why the table is sized well above the
+ * number of foreign tables a database usually has.
+ */
+
+#include "level_pivot/table_metrics.hpp"
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace level_pivot {
+
+static_assert(std::is_trivially_copyable_v<TableCounters> &&
+              sizeof(TableCounters) % sizeof(uint64_t) == 0,
+              "TableCounters must hold only uint64_t counters");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared counters need lock-free 64-bit atomics");
+
+namespace {
+
+using CounterArray = uint64_t[sizeof(TableCounters) / sizeof(uint64_t)];
+
+constexpr size_t header_size() {
+    return (sizeof(TableMetrics) + alignof(std::max_align_t) - 1) /
+           alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+
+/** splitmix64's finalizer; OIDs are sequential, so spread them out */
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // anonymous namespace
+
+TableCounters& TableCounters::operator+=(const TableCounters& other) {
+    CounterArray mine;
+    CounterArray theirs;
+    std::memcpy(mine, this, sizeof(mine));
+    std::memcpy(theirs, &other, sizeof(theirs));
+    for (size_t i = 0; i < std::extent_v<CounterArray>; ++i) {
+        mine[i] += theirs[i];
+    }
+    std::memcpy(this, mine, sizeof(mine));
+    return *this;
+}
+
+bool TableCounters::empty() const {
+    CounterArray values;
+    std::memcpy(values, this, sizeof(values));
+    for (uint64_t value : values) {
+        if (value != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t TableMetrics::memory_size(size_t capacity) {
+    return header_size() + capacity * sizeof(Slot);
+}
+
+TableMetrics* TableMetrics::create(void* memory, size_t capacity) {
+    auto* metrics = new (memory) TableMetrics(capacity);
+    Slot* slots = metrics->slots();
+    for (size_t i = 0; i < capacity; ++i) {
+        Slot* slot = new (&slots[i]) Slot;
+        slot->table.store(0, std::memory_order_relaxed);
+        for (auto& counter : slot->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+    return metrics;
+}
+
+TableMetrics::Slot* TableMetrics::slots() {
+    return reinterpret_cast<Slot*>(reinterpret_cast<char*>(this) + header_size());
+}
+
+const TableMetrics::Slot* TableMetrics::slots() const {
+    return reinterpret_cast<const Slot*>(reinterpret_cast<const char*>(this) + header_size());
+}
+
+TableMetrics::Slot* TableMetrics::find_slot(uint64_t table) {
+    if (capacity_ == 0 || table == 0) {
+        return nullptr;
+    }
+    size_t start = mix(table) % capacity_;
+    for (size_t i = 0; i < capacity_; ++i) {
+        Slot& slot = slots()[(start + i) % capacity_];
+        uint64_t owner = slot.table.load(std::memory_order_acquire);
+        if (owner == 0) {
+            // On failure owner is the table that got there first
+            slot.table.compare_exchange_strong(owner, table, std::memory_order_acq_rel);
+            if (owner == 0) {
+                return &slot;
+            }
+        }
+        if (owner == table) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool TableMetrics::add(uint64_t table, const TableCounters& counters) {
+    Slot* slot = find_slot(table);
+    if (slot == nullptr) {
+        return false;
+    }
+    CounterArray values;
+    std::memcpy(values, &counters, sizeof(values));
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        if (values[i] != 0) {
+            slot->counters[i].fetch_add(values[i], std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+std::vector<std::pair<uint64_t, TableCounters>> TableMetrics::read() const {
+    std::vector<std::pair<uint64_t, TableCounters>> tables;
+    for (size_t i = 0; i < capacity_; ++i) {
+        const Slot& slot = slots()[i];
+        uint64_t table = slot.table.load(std::memory_order_acquire);
+        if (table == 0) {
+            continue;
+        }
+        CounterArray values;
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            values[c] = slot.counters[c].load(std::memory_order_relaxed);
+        }
+        TableCounters counters;
+        std::memcpy(&counters, values, sizeof(values));
+        tables.emplace_back(table, counters);
+    }
+    return tables;
+}
+
+void TableMetrics::reset() {
+    for (size_t i = 0; i < capacity_; ++i) {
+        for (auto& counter : slots()[i].counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace level_pivot
@@ -0,0 +1,422 @@
+/**
+ * table_stats.cpp - Row count and width estimates for query planning
+ *
+ * PostgreSQL's planner needs row counts and tuple widths to choose join
+ * orders and join methods. LevelDB has no row counts, but it can tell us
+ * roughly how many bytes a key range occupies (GetApproximateSizes). We
+ * combine that with a short sampled scan from the start of the range:
+ *
+ *   bytes per key  = sampled (key + value) bytes / sampled keys
+ *   total keys     = approximate range bytes / bytes per key
+ *   keys per row   = sampled matching keys / sampled distinct identities
+ *   rows           = total keys * match ratio / keys per row
+ *
+ * If the whole range fits inside the sample we skip the extrapolation and
+ * report exact counts. GetApproximateSizes reports compressed SSTable bytes
+ * and ignores the memtable, so extrapolated counts lean low; the sample size
+ * is used as a floor.
+ */
+
+#include "level_pivot/table_stats.hpp"
+#include <algorithm>
+#include <string_view>
+
+namespace level_pivot {
+
+namespace {
+
+bool same_identity(const std::vector<std::string>& identity,
+                   const std::vector<std::string_view>& views) {
+    if (identity.size() != views.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < identity.size(); ++i) {
+        if (identity[i] != views[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool has_prefix(std::string_view key, const std::string& prefix) {
+    return key.size() >= prefix.size() && key.substr(0, prefix.size()) == prefix;
+}
+
+} // anonymous namespace
+
+SizeEstimator::SizeEstimator(std::shared_ptr<LevelDBConnection> connection)
+    : connection_(std::move(connection)) {}
+
+/**
+ * Samples the start of the identity prefix range and extrapolates to the
+ * whole range. Pushed-down identity prefixes shrink both the approximate
+ * size and the sampled range, so filtered scans get smaller estimates.
+ */
+SizeEstimate SizeEstimator::estimate_pivot(const KeyParser& parser,
+                                           const std::vector<std::string>& prefix_values,
+                                           const SamplingOptions& options) {
+    SizeEstimate est;
+
+    std::string prefix = parser.build_prefix(prefix_values);
+    std::string limit = KeyParser::prefix_successor(prefix);
+    est.approximate_bytes = connection_->approximate_size(prefix, limit);
+
+    auto iter = connection_->iterator();
+    if (prefix.empty()) {
+        iter.seek_to_first();
+    } else {
+        iter.seek(prefix);
+    }
+
+    size_t scanned = 0;
+    size_t matched = 0;
+    size_t identities = 0;
+    uint64_t entry_bytes = 0;
+    uint64_t value_bytes = 0;
+    uint64_t identity_bytes = 0;
+    std::vector<std::string> last_identity;
+    bool exhausted = true;
+
+    while (iter.valid()) {
+        std::string_view key = iter.key_view();
+        if (!has_prefix(key, prefix)) {
+            break;
+        }
+        if (scanned >= options.max_sample_keys) {
+            exhausted = false;
+            break;
+        }
+
+        ++scanned;
+        std::string_view value = iter.value_view();
+        entry_bytes += key.size() + value.size();
+
+        auto parsed = parser.parse_view(key);
+        if (parsed) {
+            ++matched;
+            value_bytes += value.size();
+
+            // Keys of one identity are contiguous, so a change means a new row
+            if (!same_identity(last_identity, parsed->capture_values)) {
+                ++identities;
+                last_identity.clear();
+                for (const auto& sv : parsed->capture_values) {
+                    last_identity.emplace_back(sv);
+                    identity_bytes += sv.size();
+                }
+            }
+        }
+
+        iter.next();
+    }
+
+    if (matched > 0) {
+        est.keys_per_row = static_cast<double>(matched) / identities;
+        est.avg_value_width = static_cast<double>(value_bytes) / matched;
+        est.avg_identity_width = static_cast<double>(identity_bytes) / identities;
+    }
+
+    if (exhausted) {
+        est.exact = true;
+        est.keys = static_cast<double>(scanned);
+        est.rows = static_cast<double>(identities);
+        return est;
+    }
+
+    double bytes_per_key = static_cast<double>(entry_bytes) / scanned;
+    double total_keys = std::max(static_cast<double>(scanned),
+                                 est.approximate_bytes / bytes_per_key);
+    double match_ratio = static_cast<double>(matched) / scanned;
+
+    est.keys = total_keys;
+    est.rows = total_keys * match_ratio / est.keys_per_row;
+    return est;
+}
+
+/**
+ * Raw tables have one row per key, so only the key count matters.
+ * Exact-key lookups are a single Get and always estimate one row.
+ */
+SizeEstimate SizeEstimator::estimate_raw(const RawScanBounds& bounds,
+                                         const SamplingOptions& options) {
+    SizeEstimate est;
+
+    if (bounds.is_exact_match()) {
+        est.rows = 1;
+        est.keys = 1;
+        return est;
+    }
+
+    std::string start = bounds.lower_bound.value_or("");
+    std::string limit;
+    if (bounds.upper_bound.has_value()) {
+        limit = *bounds.upper_bound;
+        if (bounds.upper_inclusive) {
+            limit.push_back('\0');
+        }
+    }
+    est.approximate_bytes = connection_->approximate_size(start, limit);
+
+    auto iter = connection_->iterator();
+    if (start.empty()) {
+        iter.seek_to_first();
+    } else {
+        iter.seek(start);
+    }
+
+    size_t scanned = 0;
+    uint64_t entry_bytes = 0;
+    uint64_t value_bytes = 0;
+    bool exhausted = true;
+
+    while (iter.valid()) {
+        std::string_view key = iter.key_view();
+        if (bounds.is_past_upper_bound(key)) {
+            break;
+        }
+        if (scanned >= options.max_sample_keys) {
+            exhausted = false;
+            break;
+        }
+        if (bounds.is_within_bounds(key)) {
+            std::string_view value = iter.value_view();
+            ++scanned;
+            entry_bytes += key.size() + value.size();
+            value_bytes += value.size();
+        }
+        iter.next();
+    }
+
+    if (scanned > 0) {
+        est.avg_value_width = static_cast<double>(value_bytes) / scanned;
+        est.avg_identity_width = static_cast<double>(entry_bytes - value_bytes) / scanned;
+    }
+
+    if (exhausted) {
+        est.exact = true;
+        est.rows = static_cast<double>(scanned);
+        est.keys = est.rows;
+        return est;
+    }
+
+    double bytes_per_key = static_cast<double>(entry_bytes) / scanned;
+    est.keys = std::max(static_cast<double>(scanned),
+                        est.approximate_bytes / bytes_per_key);
+    est.rows = est.keys;
+    return est;
+}
+
+// KeyspaceSampler implementation
+
+KeyspaceSampler::KeyspaceSampler(std::shared_ptr<LevelDBConnection> connection,
+                                 std::string first, std::string last)
+    : connection_(std::move(connection))
+    , first_(std::move(first))
+    , last_(std::move(last))
+    , total_bytes_(connection_->approximate_size(first_, last_ + '\0')) {}
+
+/**
+ * The last key in a prefix range is the one just before the prefix's
+ * successor, or the last key in the database if it has none.
+ */
+std::optional<KeyspaceSampler> KeyspaceSampler::for_prefix(
+    std::shared_ptr<LevelDBConnection> connection, const std::string& prefix) {
+    auto iter = connection->iterator();
+
+    if (prefix.empty()) {
+        iter.seek_to_first();
+    } else {
+        iter.seek(prefix);
+    }
+    if (!iter.valid() || !has_prefix(iter.key_view(), prefix)) {
+        return std::nullopt;
+    }
+    std::string first = iter.key();
+
+    std::string limit = KeyParser::prefix_successor(prefix);
+    if (limit.empty()) {
+        iter.seek_to_last();
+    } else {
+        iter.seek(limit);
+        if (iter.valid()) {
+            iter.prev();
+        } else {
+            iter.seek_to_last();
+        }
+    }
+    std::string last = iter.key();
+
+    return KeyspaceSampler(std::move(connection), std::move(first), std::move(last));
+}
+
+/**
+ * Bisects on the interpolation fraction until the approximate size of
+ * [first, key) reaches the requested share of the range. ~20 steps pin the
+ * key down well below LevelDB's block-level size granularity.
+ */
+std::string KeyspaceSampler::key_at(double fraction) const {
+    if (fraction <= 0) {
+        return first_;
+    }
+    if (total_bytes_ == 0) {
+        return interpolate(first_, last_, fraction);
+    }
+
+    double target = std::min(fraction, 1.0) * total_bytes_;
+    double lo = 0;
+    double hi = 1;
+    for (int i = 0; i < 20; ++i) {
+        double mid = (lo + hi) / 2;
+        std::string key = interpolate(first_, last_, mid);
+        if (connection_->approximate_size(first_, key) < target) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return interpolate(first_, last_, hi);
+}
+
+std::string KeyspaceSampler::interpolate(const std::string& lo, const std::string& hi,
+                                         double fraction) {
+    size_t common = 0;
+    while (common < lo.size() && common < hi.size() && lo[common] == hi[common]) {
+        ++common;
+    }
+
+    auto load = [common](const std::string& s) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            v <<= 8;
+            if (common + i < s.size()) {
+                v |= static_cast<unsigned char>(s[common + i]);
+            }
+        }
+        return v;
+    };
+
+    uint64_t a = load(lo);
+    uint64_t b = load(hi);
+    if (b < a) {
+        std::swap(a, b);
+    }
+
+    fraction = std::clamp(fraction, 0.0, 1.0);
+    uint64_t v = a + static_cast<uint64_t>(static_cast<long double>(b - a) * fraction);
+
+    std::string result = lo.substr(0, common);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        result.push_back(static_cast<char>((v >> shift) & 0xFF));
+    }
+    while (result.size() > common && result.back() == '\0') {
+        result.pop_back();
+    }
+
+    // Truncating to 8 bytes can drop just below lo; keep within [lo, hi]
+    return std::clamp(result, std::min(lo, hi), std::max(lo, hi));
+}
+
+/**
+ * An identity's keys all start with build_prefix(identity), and no other
+ * identity's keys do, so that prefix is a boundary no row straddles.
+ */
+std::vector<std::string> compute_shard_boundaries(
+    std::shared_ptr<LevelDBConnection> connection,
+    const KeyParser& parser,
+    const std::vector<std::string>& prefix_values,
+    size_t shard_count) {
+    std::vector<std::string> bounds;
+    if (shard_count < 2) {
+        return bounds;
+    }
+
+    std::string prefix = parser.build_prefix(prefix_values);
+    auto sampler = KeyspaceSampler::for_prefix(connection, prefix);
+    if (!sampler) {
+        return bounds;
+    }
+
+    auto iter = connection->iterator();
+    std::vector<std::string> identity;
+
+    for (size_t i = 1; i < shard_count; ++i) {
+        iter.seek(sampler->key_at(static_cast<double>(i) / shard_count));
+
+        for (; iter.valid() && has_prefix(iter.key_view(), prefix); iter.next()) {
+            auto parsed = parser.parse_view(iter.key_view());
+            if (!parsed) {
+                continue;
+            }
+
+            identity.clear();
+            for (const auto& sv : parsed->capture_values) {
+                identity.emplace_back(sv);
+            }
+            std::string boundary = parser.build_prefix(identity);
+
+            // The first identity's boundary sorts before the first key;
+            // it and repeats would only produce empty shards
+            if (boundary > sampler->first() &&
+                (bounds.empty() || boundary > bounds.back())) {
+                bounds.push_back(std::move(boundary));
+            }
+            break;
+        }
+    }
+
+    return bounds;
+}
+
+// SizeEstimateCache implementation
+
+SizeEstimateCache::SizeEstimateCache(std::chrono::seconds ttl) : ttl_(ttl) {}
+
+/**
+ * One cache per backend, like ConnectionManager. The mutex is only there
+ * for parity with ConnectionManager; backends are single-threaded.
+ */
+SizeEstimateCache& SizeEstimateCache::instance() {
+    static SizeEstimateCache cache;
+    return cache;
+}
+
+std::optional<SizeEstimate> SizeEstimateCache::lookup(unsigned int relid,
+                                                      const std::string& range_key,
+                                                      Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto rel_it = entries_.find(relid);
+    if (rel_it == entries_.end()) {
+        return std::nullopt;
+    }
+
+    auto it = rel_it->second.find(range_key);
+    if (it == rel_it->second.end()) {
+        return std::nullopt;
+    }
+
+    if (now - it->second.stored_at > ttl_) {
+        rel_it->second.erase(it);
+        return std::nullopt;
+    }
+
+    return it->second.estimate;
+}
+
+void SizeEstimateCache::store(unsigned int relid, const std::string& range_key,
+                              const SizeEstimate& estimate, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[relid][range_key] = Entry{estimate, now};
+}
+
+void SizeEstimateCache::invalidate(unsigned int relid) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(relid);
+}
+
+void SizeEstimateCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+} // namespace level_pivot
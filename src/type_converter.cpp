@@ -5,8 +5,14 @@
  *   - string_to_datum: Parses strings from LevelDB into PostgreSQL values
  *   - datum_to_string: Serializes PostgreSQL values for LevelDB storage
  *
- * Supported types: TEXT, INTEGER, BIGINT, BOOLEAN, NUMERIC, TIMESTAMP,
- * TIMESTAMPTZ, DATE, JSONB, BYTEA. Unknown types fall back to TEXT.
+ * Supported types: TEXT, INTEGER, BIGINT, BOOLEAN, FLOAT8, NUMERIC,
+ * TIMESTAMP, TIMESTAMPTZ, DATE, JSONB, BYTEA. Unknown types fall back to
+ * TEXT.
+ *
+ * Reads are the hot direction: every needed cell of every row goes
+ * through a converter. TEXT, INTEGER, BIGINT, BOOLEAN and FLOAT8 have
+ * converters that work on the stored bytes in place; the rest copy the
+ * value into a cstring for PostgreSQL's input function.
  *
  * Memory: All allocations use palloc (PostgreSQL's memory allocator) so
  * they're automatically freed when the current memory context is reset.
@@ -26,6 +32,8 @@ extern "C" {
 #include "level_pivot/type_converter.hpp"
 
 #include <charconv>
+#include <cmath>
+#include <cstring>
 
 namespace level_pivot {
 
@@ -37,114 +45,262 @@ TypeConversionError::TypeConversionError(const std::string& value,
       value_(value),
       target_type_(target_type) {}
 
-/**
- * Converts a string from LevelDB to a PostgreSQL Datum.
- *
- * Uses PostgreSQL's input functions (int4in, boolin, etc.) which handle
- * the same formats as SQL literals. This means LevelDB values can use
- * familiar formats like "true"/"false" for booleans, ISO dates, etc.
- *
- * BYTEA uses hex format with optional \x prefix for binary data.
+namespace {
+
+/*
+ * Runs a one-argument PostgreSQL input function on a NUL-terminated copy
+ * of the value. The copy is palloc'd, so an ereport from the input
+ * function leaves it to the memory context.
  */
-Datum TypeConverter::string_to_datum(const std::string& value, PgType type,
-                                     bool& is_null) {
-    is_null = false;
+Datum call_input(PGFunction input, std::string_view value) {
+    char* str = pnstrdup(value.data(), value.size());
+    Datum result = DirectFunctionCall1(input, CStringGetDatum(str));
+    pfree(str);
+    return result;
+}
 
-    // Check for explicit NULL marker
-    if (is_null_string(value)) {
-        is_null = true;
-        return (Datum)0;
+/* As call_input, for input functions that also take a type OID and typmod */
+Datum call_typmod_input(PGFunction input, std::string_view value) {
+    char* str = pnstrdup(value.data(), value.size());
+    Datum result = DirectFunctionCall3(input,
+        CStringGetDatum(str),
+        ObjectIdGetDatum(InvalidOid),
+        Int32GetDatum(-1));
+    pfree(str);
+    return result;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool SWAR_DIGITS = true;
+#else
+constexpr bool SWAR_DIGITS = false;
+#endif
+
+/*
+ * Whether the 8 bytes at chars are all ASCII digits: each byte's high
+ * nibble must be 3 and its low nibble must not carry past 9 when 6 is
+ * added.
+ */
+inline bool eight_digits(const char* chars) {
+    uint64_t word;
+    std::memcpy(&word, chars, sizeof(word));
+    return ((word & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+/*
+ * Value of 8 ASCII digits in one word (little-endian load, so the first
+ * digit is the low byte): adjacent digits are combined into pairs, then
+ * pairs into the two 4-digit halves, with a multiply per step.
+ */
+inline uint64_t parse_eight_digits(const char* chars) {
+    uint64_t word;
+    std::memcpy(&word, chars, sizeof(word));
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return word;
+}
+
+/*
+ * Parses an optionally signed run of decimal digits, the form int4out and
+ * int8out produce. Anything else (whitespace, more than 19 digits, junk)
+ * is left to the input function, which also owns the error messages.
+ */
+bool parse_plain_integer(std::string_view value, bool& negative, uint64_t& magnitude) {
+    const char* p = value.data();
+    const char* end = p + value.size();
+    negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == end || end - p > 19) {
+        return false;
     }
 
-    switch (type) {
-        case PgType::TEXT: {
-            // cstring_to_text_with_len handles non-null-terminated strings correctly
-            text* result = cstring_to_text_with_len(value.c_str(), value.size());
-            return PointerGetDatum(result);
+    uint64_t result = 0;
+    if (SWAR_DIGITS) {
+        while (end - p >= 8 && eight_digits(p)) {
+            result = result * 100000000 + parse_eight_digits(p);
+            p += 8;
         }
-
-        case PgType::INTEGER: {
-            Datum result = DirectFunctionCall1(int4in, CStringGetDatum(value.c_str()));
-            return result;
+    }
+    for (; p < end; ++p) {
+        unsigned int digit = static_cast<unsigned char>(*p) - '0';
+        if (digit > 9) {
+            return false;
         }
+        result = result * 10 + digit;
+    }
+    magnitude = result;
+    return true;
+}
 
-        case PgType::BIGINT: {
-            Datum result = DirectFunctionCall1(int8in, CStringGetDatum(value.c_str()));
-            return result;
-        }
+Datum convert_text(std::string_view value) {
+    // Values need no terminator, so the varlena is filled straight from
+    // the stored bytes
+    text* result = (text*)palloc(VARHDRSZ + value.size());
+    SET_VARSIZE(result, VARHDRSZ + value.size());
+    std::memcpy(VARDATA(result), value.data(), value.size());
+    return PointerGetDatum(result);
+}
 
-        case PgType::BOOLEAN: {
-            Datum result = DirectFunctionCall1(boolin, CStringGetDatum(value.c_str()));
-            return result;
-        }
+Datum convert_integer(std::string_view value) {
+    bool negative;
+    uint64_t magnitude;
+    if (parse_plain_integer(value, negative, magnitude) &&
+        magnitude <= (negative ? 2147483648ULL : 2147483647ULL)) {
+        int64_t signed_value = negative ? -static_cast<int64_t>(magnitude)
+                                        : static_cast<int64_t>(magnitude);
+        return Int32GetDatum(static_cast<int32>(signed_value));
+    }
+    return call_input(int4in, value);
+}
 
-        case PgType::NUMERIC: {
-            Datum result = DirectFunctionCall3(numeric_in,
-                CStringGetDatum(value.c_str()),
-                ObjectIdGetDatum(InvalidOid),
-                Int32GetDatum(-1));
-            return result;
-        }
+Datum convert_bigint(std::string_view value) {
+    bool negative;
+    uint64_t magnitude;
+    if (parse_plain_integer(value, negative, magnitude) &&
+        magnitude <= (negative ? 9223372036854775808ULL : 9223372036854775807ULL)) {
+        // Negated in unsigned arithmetic so INT64_MIN doesn't overflow
+        uint64_t bits = negative ? 0 - magnitude : magnitude;
+        return Int64GetDatum(static_cast<int64>(bits));
+    }
+    return call_input(int8in, value);
+}
 
-        case PgType::TIMESTAMP: {
-            Datum result = DirectFunctionCall3(timestamp_in,
-                CStringGetDatum(value.c_str()),
-                ObjectIdGetDatum(InvalidOid),
-                Int32GetDatum(-1));
-            return result;
-        }
+Datum convert_boolean(std::string_view value) {
+    // boolout's spellings and the long forms; boolin takes the rest
+    // (case, whitespace, yes/no/on/off, prefixes)
+    if (value == "t" || value == "true" || value == "1") {
+        return BoolGetDatum(true);
+    }
+    if (value == "f" || value == "false" || value == "0") {
+        return BoolGetDatum(false);
+    }
+    return call_input(boolin, value);
+}
 
-        case PgType::TIMESTAMPTZ: {
-            Datum result = DirectFunctionCall3(timestamptz_in,
-                CStringGetDatum(value.c_str()),
-                ObjectIdGetDatum(InvalidOid),
-                Int32GetDatum(-1));
-            return result;
-        }
+Datum convert_float8(std::string_view value) {
+    // from_chars rounds the same way strtod does; values it doesn't fully
+    // consume or that aren't finite (Infinity, NaN, out of range, a
+    // leading '+') go through float8in for its exact rules and errors
+    double result;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec == std::errc{} && ptr == value.data() + value.size() && std::isfinite(result)) {
+        return Float8GetDatum(result);
+    }
+    return call_input(float8in, value);
+}
 
-        case PgType::DATE: {
-            Datum result = DirectFunctionCall1(date_in, CStringGetDatum(value.c_str()));
-            return result;
-        }
+Datum convert_numeric(std::string_view value) {
+    return call_typmod_input(numeric_in, value);
+}
 
-        case PgType::JSONB: {
-            Datum result = DirectFunctionCall1(jsonb_in,
-                CStringGetDatum(value.c_str()));
-            return result;
-        }
+Datum convert_timestamp(std::string_view value) {
+    return call_typmod_input(timestamp_in, value);
+}
 
-        case PgType::BYTEA: {
-            // BYTEA uses hex encoding for safe string representation.
-            // Accept with or without \x prefix for flexibility.
-            std::string hex_value = value;
-            if (hex_value.substr(0, 2) == "\\x") {
-                hex_value = hex_value.substr(2);
-            }
+Datum convert_timestamptz(std::string_view value) {
+    return call_typmod_input(timestamptz_in, value);
+}
 
-            // Each byte is 2 hex chars; allocate PostgreSQL varlena structure
-            size_t len = hex_value.size() / 2;
-            bytea* result = (bytea*)palloc(VARHDRSZ + len);
-            SET_VARSIZE(result, VARHDRSZ + len);
+Datum convert_date(std::string_view value) {
+    return call_input(date_in, value);
+}
 
-            // Decode hex pairs to bytes using C++17 from_chars for speed
-            unsigned char* data = (unsigned char*)VARDATA(result);
-            for (size_t i = 0; i < len; ++i) {
-                unsigned int byte = 0;
-                auto [ptr, ec] = std::from_chars(hex_value.data() + i * 2,
-                                                  hex_value.data() + i * 2 + 2,
-                                                  byte, 16);
-                if (ec != std::errc{}) {
-                    throw TypeConversionError(value, PgType::BYTEA, "invalid hex format");
-                }
-                data[i] = static_cast<unsigned char>(byte);
-            }
-            return PointerGetDatum(result);
+Datum convert_jsonb(std::string_view value) {
+    return call_input(jsonb_in, value);
+}
+
+Datum convert_bytea(std::string_view value) {
+    // BYTEA uses hex encoding for safe string representation.
+    // Accept with or without \x prefix for flexibility.
+    std::string_view hex_value = value;
+    if (hex_value.substr(0, 2) == "\\x") {
+        hex_value.remove_prefix(2);
+    }
+
+    // Each byte is 2 hex chars; allocate PostgreSQL varlena structure
+    size_t len = hex_value.size() / 2;
+    bytea* result = (bytea*)palloc(VARHDRSZ + len);
+    SET_VARSIZE(result, VARHDRSZ + len);
+
+    // Decode hex pairs to bytes using C++17 from_chars for speed
+    unsigned char* data = (unsigned char*)VARDATA(result);
+    for (size_t i = 0; i < len; ++i) {
+        unsigned int byte = 0;
+        auto [ptr, ec] = std::from_chars(hex_value.data() + i * 2,
+                                          hex_value.data() + i * 2 + 2,
+                                          byte, 16);
+        if (ec != std::errc{} || ptr != hex_value.data() + i * 2 + 2) {
+            throw TypeConversionError(std::string(value), PgType::BYTEA,
+                                      "invalid hex format");
         }
+        data[i] = static_cast<unsigned char>(byte);
+    }
+    return PointerGetDatum(result);
+}
+
+} // namespace
+
+/**
+ * Picks the converter for a type.
+ *
+ * The input functions (int4in, boolin, etc.) handle the same formats as
+ * SQL literals, so LevelDB values can use familiar formats like
+ * "true"/"false" for booleans, ISO dates, etc. The in-place converters
+ * accept the common forms themselves and hand anything else to the input
+ * function, so they parse exactly the same set of strings.
+ *
+ * BYTEA uses hex format with optional \x prefix for binary data.
+ */
+DatumConverter TypeConverter::converter_for(PgType type) {
+    switch (type) {
+        case PgType::TEXT: return convert_text;
+        case PgType::INTEGER: return convert_integer;
+        case PgType::BIGINT: return convert_bigint;
+        case PgType::BOOLEAN: return convert_boolean;
+        case PgType::FLOAT8: return convert_float8;
+        case PgType::NUMERIC: return convert_numeric;
+        case PgType::TIMESTAMP: return convert_timestamp;
+        case PgType::TIMESTAMPTZ: return convert_timestamptz;
+        case PgType::DATE: return convert_date;
+        case PgType::JSONB: return convert_jsonb;
+        case PgType::BYTEA: return convert_bytea;
     }
+    return convert_text;
+}
 
-    // Should never reach here
-    is_null = true;
-    return (Datum)0;
+std::vector<DatumConverter> TypeConverter::converters_for(const Projection& projection) {
+    std::vector<DatumConverter> converters;
+    converters.reserve(projection.column_count());
+    for (const auto& col : projection.columns()) {
+        converters.push_back(converter_for(col.type));
+    }
+    return converters;
+}
+
+/**
+ * Converts a string from LevelDB to a PostgreSQL Datum.
+ *
+ * For one-off conversions; scans use the projection's converters instead
+ * of picking one per cell.
+ */
+Datum TypeConverter::string_to_datum(std::string_view value, PgType type,
+                                     bool& is_null) {
+    is_null = false;
+
+    // Check for explicit NULL marker
+    if (is_null_string(value)) {
+        is_null = true;
+        return (Datum)0;
+    }
+
+    return converter_for(type)(value);
 }
 
 /**
@@ -190,6 +346,13 @@ std::string TypeConverter::datum_to_string(Datum datum, PgType type, bool is_nul
             return result;
         }
 
+        case PgType::FLOAT8: {
+            char* str = DatumGetCString(DirectFunctionCall1(float8out, datum));
+            std::string result(str);
+            pfree(str);
+            return result;
+        }
+
         case PgType::NUMERIC: {
             char* str = DatumGetCString(DirectFunctionCall1(numeric_out, datum));
             std::string result(str);
@@ -252,7 +415,7 @@ std::string TypeConverter::datum_to_string(Datum datum, PgType type, bool is_nul
  * represented by the absence of a key in LevelDB, not by a special
  * value. If a key exists, it has a non-NULL value.
  */
-bool TypeConverter::is_null_string(const std::string& value) {
+bool TypeConverter::is_null_string(std::string_view value) {
     (void)value;
     return false;
 }
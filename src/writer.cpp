@@ -9,9 +9,15 @@
  * Operations can be batched for atomicity and performance. When using a
  * WriteBatch, all operations are held in memory until commit_batch() is
  * called, then applied atomically to LevelDB.
+ *
+ * Secondary index entries (see secondary_index.hpp) follow the attr keys
+ * they point back from: an entry is put with each indexed attr value
+ * written and deleted with each one removed or replaced, always through
+ * the same batch as the attr key itself.
  */
 
 #include "level_pivot/writer.hpp"
+#include <optional>
 #include <string_view>
 
 namespace level_pivot {
@@ -75,6 +81,9 @@ WriteResult Writer::insert(Datum* values, bool* nulls) {
             throw LevelPivotError("Cannot insert row with NULL identity column");
         }
     }
+    if (changes_) {
+        changes_->add(identity);
+    }
 
     // Extract non-null attrs and write a key for each one.
     // NULL attrs are simply not written - they'll read back as NULL.
@@ -84,6 +93,59 @@ WriteResult Writer::insert(Datum* values, bool* nulls) {
         std::string key = projection_.parser().build(identity, attr_name);
         do_put(key, attr_value);
         ++result.keys_written;
+        put_index_entry(attr_name, attr_value, identity, nullptr, result);
+    }
+
+    return result;
+}
+
+/**
+ * Batched INSERT: every attr key of every row goes into one WriteBatch.
+ * Identity values and key strings are built into buffers that live across
+ * rows, so per-row cost is just the datum conversions and the puts.
+ */
+WriteResult Writer::insert_batch(Datum* const* values, bool* const* nulls, size_t count) {
+    WriteResult result;
+
+    // Without a statement-level batch, group just these rows
+    std::optional<LevelDBWriteBatch> local_batch;
+    if (!batch_) {
+        local_batch.emplace(connection_->create_batch());
+    }
+    LevelDBWriteBatch& batch = batch_ ? *batch_ : *local_batch;
+
+    const auto& parser = projection_.parser();
+    std::vector<std::string> identity;
+    std::string key;
+
+    for (size_t row = 0; row < count; ++row) {
+        extract_identity_into(values[row], nulls[row], identity);
+
+        for (const auto& val : identity) {
+            if (val.empty()) {
+                throw LevelPivotError("Cannot insert row with NULL identity column");
+            }
+        }
+        if (changes_) {
+            changes_->add(identity);
+        }
+
+        for (const auto* col : projection_.attr_columns()) {
+            int idx = col->attnum - 1;
+            if (nulls[row][idx]) {
+                continue;
+            }
+            parser.build_into(key, identity, col->name);
+            std::string value = TypeConverter::datum_to_string(
+                values[row][idx], col->type, false);
+            batch.put(key, value);
+            ++result.keys_written;
+            put_index_entry(col->name, value, identity, &batch, result);
+        }
+    }
+
+    if (local_batch) {
+        local_batch->commit();
     }
 
     return result;
@@ -120,13 +182,47 @@ WriteResult Writer::update(Datum* old_values, bool* old_nulls,
     }
 
     // Identity unchanged - update in place
+    if (changes_) {
+        changes_->add(new_identity);
+    }
     auto extracted = extract_all_attrs(new_values, new_nulls);
 
+    // Index entries of values that change move from the old value to the
+    // new one; unchanged values keep theirs
+    std::optional<ExtractedAttrs> old_attrs;
+    if (index_) {
+        old_attrs = extract_all_attrs(old_values, old_nulls);
+    }
+    auto index_changed = [&](const std::string& attr_name) {
+        if (!old_attrs || !index_->indexes(attr_name)) {
+            return false;
+        }
+        auto old_value = old_attrs->values.find(attr_name);
+        auto new_value = extracted.values.find(attr_name);
+        if (old_value == old_attrs->values.end() || new_value == extracted.values.end()) {
+            return old_value != old_attrs->values.end() || new_value != extracted.values.end();
+        }
+        return old_value->second != new_value->second;
+    };
+    auto move_index_entry = [&](const std::string& attr_name) {
+        auto old_value = old_attrs->values.find(attr_name);
+        if (old_value != old_attrs->values.end()) {
+            del_index_entry(attr_name, old_value->second, new_identity, nullptr, result);
+        }
+        auto new_value = extracted.values.find(attr_name);
+        if (new_value != extracted.values.end()) {
+            put_index_entry(attr_name, new_value->second, new_identity, nullptr, result);
+        }
+    };
+
     // Write keys for non-null attrs (creates or updates)
     for (const auto& [attr_name, attr_value] : extracted.values) {
         std::string key = projection_.parser().build(new_identity, attr_name);
         do_put(key, attr_value);
         ++result.keys_written;
+        if (index_changed(attr_name)) {
+            move_index_entry(attr_name);
+        }
     }
 
     // Delete keys for attrs that are now NULL.
@@ -135,6 +231,9 @@ WriteResult Writer::update(Datum* old_values, bool* old_nulls,
         std::string key = projection_.parser().build(new_identity, attr_name);
         do_del(key);
         ++result.keys_deleted;
+        if (index_changed(attr_name)) {
+            move_index_entry(attr_name);
+        }
     }
 
     return result;
@@ -153,13 +252,133 @@ WriteResult Writer::remove(Datum* values, bool* nulls) {
 WriteResult Writer::remove_by_identity(const std::vector<std::string>& identity_values) {
     WriteResult result;
 
-    // Scan LevelDB to find all keys with this identity
-    auto keys = find_keys_for_identity(identity_values);
+    // Scan LevelDB to find all keys with this identity, and the stored
+    // values whose index entries go with them
+    std::vector<IndexedValue> indexed;
+    auto keys = find_keys_for_identity(identity_values, index_ ? &indexed : nullptr);
+    if (changes_ && !keys.empty()) {
+        changes_->add(identity_values);
+    }
 
     for (const auto& key : keys) {
         do_del(key);
         ++result.keys_deleted;
     }
+    for (const auto& entry : indexed) {
+        del_index_entry(entry.attr, entry.value, identity_values, nullptr, result);
+    }
+
+    return result;
+}
+
+WriteResult Writer::remove_ranges(const std::vector<KeyRange>& ranges,
+                                  const ScanOptions& scan) {
+    return modify_ranges(ranges, nullptr, scan);
+}
+
+WriteResult Writer::update_ranges(const std::vector<KeyRange>& ranges,
+                                  const std::vector<AttrAssignment>& assignments,
+                                  const ScanOptions& scan) {
+    return modify_ranges(ranges, &assignments, scan);
+}
+
+/**
+ * Set-based DELETE/UPDATE: instead of PostgreSQL fetching each row and
+ * handing it back one at a time, walk the key ranges once. Keys of a row
+ * are adjacent, so a change in the parsed identity marks a new row.
+ * DELETE drops every key as it goes; UPDATE writes each row's assigned
+ * attr keys when the row starts. All writes share one WriteBatch.
+ */
+WriteResult Writer::modify_ranges(const std::vector<KeyRange>& ranges,
+                                  const std::vector<AttrAssignment>* assignments,
+                                  const ScanOptions& scan) {
+    const auto& parser = projection_.parser();
+    if (captures_before_attr(parser.pattern()) != parser.pattern().capture_names().size()) {
+        throw LevelPivotError("Range writes need every capture before {attr}");
+    }
+
+    WriteResult result;
+
+    std::optional<LevelDBWriteBatch> local_batch;
+    if (!batch_) {
+        local_batch.emplace(connection_->create_batch());
+    }
+    LevelDBWriteBatch& batch = batch_ ? *batch_ : *local_batch;
+
+    auto iter = connection_->iterator(scan);
+    ParsedKeyView parsed;
+    std::vector<std::string> identity;
+    bool in_row = false;
+    std::string key;
+
+    for (const auto& range : ranges) {
+        if (range.start.empty()) {
+            iter.seek_to_first();
+        } else {
+            iter.seek(range.start);
+        }
+
+        for (; iter.valid(); iter.next()) {
+            std::string_view key_sv = iter.key_view();
+            if (!range.end.empty() && key_sv >= range.end) {
+                break;
+            }
+            if (!parser.parse_view_into(key_sv, parsed)) {
+                continue;
+            }
+
+            if (!in_row || !identity_matches_views(identity, parsed.capture_values)) {
+                identity.assign(parsed.capture_values.begin(), parsed.capture_values.end());
+                in_row = true;
+                ++result.rows;
+                if (changes_) {
+                    changes_->add(identity);
+                }
+
+                if (assignments) {
+                    for (const auto& assignment : *assignments) {
+                        parser.build_into(key, identity, assignment.attr_name);
+                        if (assignment.value) {
+                            batch.put(key, *assignment.value);
+                            ++result.keys_written;
+                            put_index_entry(assignment.attr_name, *assignment.value,
+                                            identity, &batch, result);
+                        } else {
+                            batch.del(key);
+                            ++result.keys_deleted;
+                        }
+                    }
+                }
+            }
+
+            // The entry of the value being deleted or replaced goes too
+            if (index_ && index_->indexes(parsed.attr_name)) {
+                const AttrAssignment* assigned = nullptr;
+                if (assignments) {
+                    for (const auto& assignment : *assignments) {
+                        if (assignment.attr_name == parsed.attr_name) {
+                            assigned = &assignment;
+                        }
+                    }
+                }
+                std::string_view old_value = iter.value_view();
+                if (!assignments ||
+                    (assigned && (!assigned->value || *assigned->value != old_value))) {
+                    del_index_entry(parsed.attr_name, old_value, identity, &batch, result);
+                }
+            }
+
+            if (!assignments) {
+                key.assign(key_sv);
+                batch.del(key);
+                ++result.keys_deleted;
+            }
+        }
+    }
+
+    if (local_batch) {
+        local_batch->commit();
+    }
 
     return result;
 }
@@ -171,6 +390,13 @@ WriteResult Writer::remove_by_identity(const std::vector<std::string>& identity_
  */
 std::vector<std::string> Writer::extract_identity(Datum* values, bool* nulls) const {
     std::vector<std::string> identity;
+    extract_identity_into(values, nulls, identity);
+    return identity;
+}
+
+void Writer::extract_identity_into(Datum* values, bool* nulls,
+                                   std::vector<std::string>& identity) const {
+    identity.clear();
     identity.reserve(projection_.identity_columns().size());
 
     const auto& capture_names = projection_.parser().pattern().capture_names();
@@ -190,8 +416,6 @@ std::vector<std::string> Writer::extract_identity(Datum* values, bool* nulls) co
                 values[idx], col->type, false));
         }
     }
-
-    return identity;
 }
 
 /**
@@ -223,7 +447,8 @@ Writer::ExtractedAttrs Writer::extract_all_attrs(Datum* values, bool* nulls) con
  * possible key with this identity, then scan until identity changes.
  */
 std::vector<std::string> Writer::find_keys_for_identity(
-    const std::vector<std::string>& identity_values) const {
+    const std::vector<std::string>& identity_values,
+    std::vector<IndexedValue>* indexed) const {
 
     std::vector<std::string> keys;
 
@@ -253,6 +478,10 @@ std::vector<std::string> Writer::find_keys_for_identity(
         if (parsed && identity_matches_views(identity_values, parsed->capture_values)) {
             // Only materialize string when we have a confirmed match
             keys.emplace_back(key_sv);
+            if (indexed && index_->indexes(parsed->attr_name)) {
+                indexed->push_back({std::string(parsed->attr_name),
+                                    std::string(iter.value_view())});
+            }
         }
 
         iter.next();
@@ -261,6 +490,38 @@ std::vector<std::string> Writer::find_keys_for_identity(
     return keys;
 }
 
+void Writer::put_index_entry(std::string_view attr, std::string_view value,
+                             const std::vector<std::string>& identity,
+                             LevelDBWriteBatch* batch, WriteResult& result) {
+    if (!index_ || !index_->indexes(attr)) {
+        return;
+    }
+    std::string key;
+    std::string entry_value;
+    index_->build_entry(attr, value, identity, key, entry_value);
+    if (batch) {
+        batch->put(key, entry_value);
+    } else {
+        do_put(key, entry_value);
+    }
+    ++result.keys_written;
+}
+
+void Writer::del_index_entry(std::string_view attr, std::string_view value,
+                             const std::vector<std::string>& identity,
+                             LevelDBWriteBatch* batch, WriteResult& result) {
+    if (!index_ || !index_->indexes(attr)) {
+        return;
+    }
+    std::string key = index_->entry_key(attr, value, identity);
+    if (batch) {
+        batch->del(key);
+    } else {
+        do_del(key);
+    }
+    ++result.keys_deleted;
+}
+
 /**
  * Writes a key-value pair, either to batch or directly to LevelDB.
  * When batched, operations are held in memory until commit_batch().
@@ -0,0 +1,33 @@
+/**
+ * bench_datum_stubs.cpp - Datum conversions for the end-to-end benchmarks
+ *
+ * The real conversions in type_converter.cpp call PostgreSQL's type input
+ * and output functions and are built into the FDW module only. These
+ * stand-ins treat a Datum as a pointer to a std::string_view instead.
+ */
+
+#include "level_pivot/type_converter.hpp"
+
+namespace level_pivot {
+
+/**
+ * Hands out pointers into a small ring of views, which outlive a row's
+ * worth of conversions
+ */
+Datum TypeConverter::string_to_datum(std::string_view value, PgType, bool& is_null) {
+    static thread_local std::string_view slots[256];
+    static thread_local size_t next = 0;
+    std::string_view& slot = slots[next++ % 256];
+    slot = value;
+    is_null = false;
+    return reinterpret_cast<Datum>(&slot);
+}
+
+std::string TypeConverter::datum_to_string(Datum datum, PgType, bool is_null) {
+    if (is_null) {
+        return std::string();
+    }
+    return std::string(*reinterpret_cast<const std::string_view*>(datum));
+}
+
+} // namespace level_pivot
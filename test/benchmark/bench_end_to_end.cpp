@@ -0,0 +1,446 @@
+/**
+ * bench_end_to_end.cpp - Scanner, writer and discovery throughput on real databases
+ *
+ * Each benchmark runs against a temporary LevelDB database filled with
+ * a table of a given shape: identities x attrs per identity x value
+ * bytes, under the pattern "bench##{group}##{id}##{attr}". Shapes come
+ * from LEVEL_PIVOT_BENCH_SHAPES ("10000x8x32,1000x64x256"), or the
+ * defaults below. Every benchmark reports keys/sec (items_per_second)
+ * and bytes/sec of keys and values, so JSON output from different runs
+ * can be compared directly; check_baseline.py does that against
+ * baseline.json.
+ *
+ * There is no PostgreSQL here, so the two Datum conversions come from
+ * bench_datum_stubs.cpp, whose stand-ins treat a Datum as a pointer to a
+ * std::string_view.
+ * DatumBuilder and Writer timings therefore cover level_pivot's own work
+ * but not PostgreSQL's type input and output functions.
+ */
+
+#include <benchmark/benchmark.h>
+#include "level_pivot/connection_manager.hpp"
+#include "level_pivot/pivot_scanner.hpp"
+#include "level_pivot/raw_scanner.hpp"
+#include "level_pivot/schema_discovery.hpp"
+#include "level_pivot/type_converter.hpp"
+#include "level_pivot/writer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+using namespace level_pivot;
+
+namespace {
+
+// ============================================================================
+// Table shapes and databases
+// ============================================================================
+
+constexpr size_t GROUPS = 16;
+const char PATTERN[] = "bench##{group}##{id}##{attr}";
+
+struct Shape {
+    size_t identities;
+    size_t attrs;
+    size_t value_size;
+
+    std::string name() const {
+        return std::to_string(identities) + "x" + std::to_string(attrs) + "x" +
+               std::to_string(value_size);
+    }
+
+    size_t keys() const { return identities * attrs; }
+};
+
+const std::vector<Shape> DEFAULT_SHAPES = {
+    {10000, 8, 32},    // Narrow rows, small values
+    {1000, 64, 32},    // Wide rows
+    {10000, 8, 1024},  // Large values
+};
+
+/**
+ * Parses LEVEL_PIVOT_BENCH_SHAPES, falling back to the defaults
+ */
+std::vector<Shape> configured_shapes() {
+    const char* env = std::getenv("LEVEL_PIVOT_BENCH_SHAPES");
+    if (env == nullptr || *env == '\0') {
+        return DEFAULT_SHAPES;
+    }
+
+    std::vector<Shape> shapes;
+    std::string spec(env);
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        Shape shape{};
+        if (std::sscanf(spec.substr(pos, end - pos).c_str(), "%zux%zux%zu",
+                        &shape.identities, &shape.attrs, &shape.value_size) == 3 &&
+            shape.identities > 0 && shape.attrs > 0) {
+            shapes.push_back(shape);
+        } else {
+            std::fprintf(stderr, "ignoring bad shape \"%s\"\n",
+                         spec.substr(pos, end - pos).c_str());
+        }
+        pos = end + 1;
+    }
+    return shapes;
+}
+
+std::string group_name(size_t identity) {
+    return "g" + std::to_string(identity % GROUPS);
+}
+
+std::string id_name(size_t identity) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "id%08zu", identity);
+    return buf;
+}
+
+std::string attr_name(size_t attr) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "attr%03zu", attr);
+    return buf;
+}
+
+/**
+ * Printable values, different per key so compression sees realistic data
+ */
+std::string make_value(std::mt19937& rng, size_t size) {
+    static const char chars[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string value(size, ' ');
+    for (char& c : value) {
+        c = chars[rng() % (sizeof(chars) - 1)];
+    }
+    return value;
+}
+
+/**
+ * The table over a shape: identity columns group and id, then one text
+ * column per attr
+ */
+std::unique_ptr<Projection> make_projection(const Shape& shape) {
+    std::vector<ColumnDef> columns = {
+        {"group", PgType::TEXT, 1, true},
+        {"id", PgType::TEXT, 2, true},
+    };
+    for (size_t a = 0; a < shape.attrs; ++a) {
+        columns.push_back({attr_name(a), PgType::TEXT, static_cast<int>(a) + 3, false});
+    }
+    return std::make_unique<Projection>(KeyPattern(PATTERN), std::move(columns));
+}
+
+/**
+ * Temporary databases, closed and deleted at exit
+ */
+class Databases {
+public:
+    ~Databases() {
+        reading_.clear();
+        for (auto& [path, connection] : open_) {
+            connection.reset();
+            std::filesystem::remove_all(path);
+        }
+    }
+
+    /**
+     * A fresh database for tag and shape, filled with the table unless
+     * empty is set
+     */
+    std::shared_ptr<LevelDBConnection> create(const std::string& tag, const Shape& shape,
+                                              bool empty = false) {
+        std::string path = (std::filesystem::temp_directory_path() /
+            ("level_pivot_bench_" + std::to_string(getpid()) + "_" + tag + "_" +
+             shape.name())).string();
+        auto& connection = open_[path];
+        connection.reset();
+        std::filesystem::remove_all(path);
+
+        ConnectionOptions opts;
+        opts.db_path = path;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection = std::make_shared<LevelDBConnection>(opts);
+        if (!empty) {
+            fill(*connection, shape);
+        }
+        return connection;
+    }
+
+    /**
+     * The shared read-only copy of shape's table, made on first use
+     */
+    std::shared_ptr<LevelDBConnection> reading(const Shape& shape) {
+        auto it = reading_.find(shape.name());
+        if (it == reading_.end()) {
+            it = reading_.emplace(shape.name(), create("read", shape)).first;
+        }
+        return it->second;
+    }
+
+    static void fill(LevelDBConnection& connection, const Shape& shape) {
+        std::mt19937 rng(42);
+        auto batch = connection.create_batch();
+        for (size_t i = 0; i < shape.identities; ++i) {
+            std::string prefix = "bench##" + group_name(i) + "##" + id_name(i) + "##";
+            for (size_t a = 0; a < shape.attrs; ++a) {
+                batch.put(prefix + attr_name(a), make_value(rng, shape.value_size));
+            }
+            if (batch.pending_count() >= 10000) {
+                batch.commit();
+                batch = connection.create_batch();
+            }
+        }
+        batch.commit();
+    }
+
+private:
+    std::map<std::string, std::shared_ptr<LevelDBConnection>> open_;
+    std::map<std::string, std::shared_ptr<LevelDBConnection>> reading_;
+};
+
+Databases& databases() {
+    static Databases instance;
+    return instance;
+}
+
+/**
+ * Bytes of keys and values in shape's table
+ */
+size_t table_bytes(const Shape& shape) {
+    size_t key_size = std::string("bench##g0##id00000000##attr000").size();
+    return shape.keys() * (key_size + shape.value_size);
+}
+
+void report(benchmark::State& state, const Shape& shape, size_t keys_per_iteration) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys_per_iteration));
+    state.SetBytesProcessed(static_cast<int64_t>(
+        state.iterations() * table_bytes(shape) / shape.keys() * keys_per_iteration));
+}
+
+/**
+ * One row's Datums: text views over values, as the stand-in conversion
+ * expects. Views point into text, so rows stay where they were built.
+ */
+struct RowDatums {
+    std::vector<std::string> text;
+    std::vector<std::string_view> views;
+    std::vector<Datum> values;
+    std::unique_ptr<bool[]> nulls;
+
+    RowDatums(const Shape& shape, size_t identity, std::mt19937& rng) {
+        text.push_back(group_name(identity));
+        text.push_back(id_name(identity));
+        for (size_t a = 0; a < shape.attrs; ++a) {
+            text.push_back(make_value(rng, shape.value_size));
+        }
+        views.assign(text.begin(), text.end());
+        for (auto& view : views) {
+            values.push_back(reinterpret_cast<Datum>(&view));
+        }
+        nulls = std::make_unique<bool[]>(text.size());
+        std::fill(nulls.get(), nulls.get() + text.size(), false);
+    }
+};
+
+using Rows = std::vector<std::unique_ptr<RowDatums>>;
+
+Rows make_rows(const Shape& shape, uint32_t seed) {
+    std::mt19937 rng(seed);
+    Rows rows;
+    rows.reserve(shape.identities);
+    for (size_t i = 0; i < shape.identities; ++i) {
+        rows.push_back(std::make_unique<RowDatums>(shape, i, rng));
+    }
+    return rows;
+}
+
+// ============================================================================
+// Scans
+// ============================================================================
+
+void BM_PivotScanner_NextRow(benchmark::State& state, Shape shape, size_t prefetch) {
+    auto connection = databases().reading(shape);
+    auto projection = make_projection(shape);
+    PivotScanner scanner(*projection, connection);
+    ScanOptions scan;
+    scan.prefetch_batch = prefetch;
+    scanner.set_scan_options(scan);
+
+    for (auto _ : state) {
+        scanner.begin_scan();
+        while (const PivotRow* row = scanner.next_row()) {
+            benchmark::DoNotOptimize(row);
+        }
+    }
+    report(state, shape, shape.keys());
+    state.counters["rows_per_second"] = benchmark::Counter(
+        static_cast<double>(shape.identities), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_PivotScanner_BuildDatums(benchmark::State& state, Shape shape) {
+    auto connection = databases().reading(shape);
+    auto projection = make_projection(shape);
+    PivotScanner scanner(*projection, connection);
+    size_t columns = projection->columns().size();
+    std::vector<Datum> values(columns);
+    auto nulls = std::make_unique<bool[]>(columns);
+
+    for (auto _ : state) {
+        scanner.begin_scan();
+        while (const PivotRow* row = scanner.next_row()) {
+            DatumBuilder::build_datums(*row, *projection, values.data(), nulls.get());
+            benchmark::DoNotOptimize(values.data());
+        }
+    }
+    report(state, shape, shape.keys());
+}
+
+void BM_RawScanner_NextRow(benchmark::State& state, Shape shape) {
+    auto connection = databases().reading(shape);
+    RawScanner scanner(connection);
+
+    for (auto _ : state) {
+        scanner.begin_scan(RawScanBounds{});
+        while (const RawRow* row = scanner.next_row()) {
+            benchmark::DoNotOptimize(row);
+        }
+    }
+    report(state, shape, shape.keys());
+}
+
+// ============================================================================
+// Writes (one WriteBatch per pass over the table, as batched DML does)
+// ============================================================================
+
+void BM_Writer_Insert(benchmark::State& state, Shape shape) {
+    auto connection = databases().create("insert", shape, true);
+    auto projection = make_projection(shape);
+    auto rows = make_rows(shape, 1);
+
+    for (auto _ : state) {
+        Writer writer(*projection, connection,
+                      std::make_unique<LevelDBWriteBatch>(connection->create_batch()));
+        for (auto& row : rows) {
+            writer.insert(row->values.data(), row->nulls.get());
+        }
+        writer.commit_batch();
+    }
+    report(state, shape, shape.keys());
+}
+
+void BM_Writer_Update(benchmark::State& state, Shape shape) {
+    auto connection = databases().create("update", shape);
+    auto projection = make_projection(shape);
+    auto old_rows = make_rows(shape, 42);
+    auto new_rows = make_rows(shape, 7);
+
+    for (auto _ : state) {
+        Writer writer(*projection, connection,
+                      std::make_unique<LevelDBWriteBatch>(connection->create_batch()));
+        for (size_t i = 0; i < shape.identities; ++i) {
+            writer.update(old_rows[i]->values.data(), old_rows[i]->nulls.get(),
+                          new_rows[i]->values.data(), new_rows[i]->nulls.get());
+        }
+        writer.commit_batch();
+        std::swap(old_rows, new_rows);
+    }
+    report(state, shape, shape.keys());
+}
+
+void BM_Writer_Remove(benchmark::State& state, Shape shape) {
+    auto connection = databases().create("remove", shape, true);
+    auto projection = make_projection(shape);
+    auto rows = make_rows(shape, 42);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Databases::fill(*connection, shape);
+        state.ResumeTiming();
+
+        Writer writer(*projection, connection,
+                      std::make_unique<LevelDBWriteBatch>(connection->create_batch()));
+        for (auto& row : rows) {
+            writer.remove(row->values.data(), row->nulls.get());
+        }
+        writer.commit_batch();
+    }
+    report(state, shape, shape.keys());
+}
+
+// ============================================================================
+// Schema discovery
+// ============================================================================
+
+void BM_SchemaDiscovery_Discover(benchmark::State& state, Shape shape,
+                                 size_t probes, size_t threads) {
+    auto connection = databases().reading(shape);
+    SchemaDiscovery discovery(connection);
+    DiscoveryOptions options;
+    options.max_keys = std::min<size_t>(shape.keys(), 100000);
+    options.probes = probes;
+    options.threads = threads;
+
+    size_t scanned = 0;
+    for (auto _ : state) {
+        auto result = discovery.discover(KeyPattern(PATTERN), options);
+        scanned += result.keys_scanned;
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(scanned));
+    state.SetBytesProcessed(static_cast<int64_t>(scanned * (table_bytes(shape) / shape.keys())));
+}
+
+void register_benchmarks(const Shape& shape) {
+    const std::string suffix = "/" + shape.name();
+    auto timed = [](benchmark::internal::Benchmark* bench) {
+        bench->Unit(benchmark::kMillisecond)->UseRealTime();
+    };
+
+    timed(benchmark::RegisterBenchmark(("PivotScanner/NextRow" + suffix).c_str(),
+                                       BM_PivotScanner_NextRow, shape, size_t(0)));
+    timed(benchmark::RegisterBenchmark(("PivotScanner/NextRowPrefetch" + suffix).c_str(),
+                                       BM_PivotScanner_NextRow, shape, size_t(256)));
+    timed(benchmark::RegisterBenchmark(("PivotScanner/BuildDatums" + suffix).c_str(),
+                                       BM_PivotScanner_BuildDatums, shape));
+    timed(benchmark::RegisterBenchmark(("RawScanner/NextRow" + suffix).c_str(),
+                                       BM_RawScanner_NextRow, shape));
+    timed(benchmark::RegisterBenchmark(("Writer/Insert" + suffix).c_str(),
+                                       BM_Writer_Insert, shape));
+    timed(benchmark::RegisterBenchmark(("Writer/Update" + suffix).c_str(),
+                                       BM_Writer_Update, shape));
+    timed(benchmark::RegisterBenchmark(("Writer/Remove" + suffix).c_str(),
+                                       BM_Writer_Remove, shape));
+    timed(benchmark::RegisterBenchmark(("SchemaDiscovery/Discover" + suffix).c_str(),
+                                       BM_SchemaDiscovery_Discover, shape,
+                                       size_t(1), size_t(1)));
+    timed(benchmark::RegisterBenchmark(("SchemaDiscovery/DiscoverSampled" + suffix).c_str(),
+                                       BM_SchemaDiscovery_Discover, shape,
+                                       size_t(64), size_t(4)));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    for (const Shape& shape : configured_shapes()) {
+        register_benchmarks(shape);
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
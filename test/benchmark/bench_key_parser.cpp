@@ -1,6 +1,8 @@
 #include <benchmark/benchmark.h>
+#include "level_pivot/attr_lookup.hpp"
 #include "level_pivot/key_parser.hpp"
 #include "level_pivot/simd_parser.hpp"
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -541,4 +543,182 @@ static void BM_SimdParser_Fast_NoMatch(benchmark::State& state) {
 }
 BENCHMARK(BM_SimdParser_Fast_NoMatch);
 
+// Mixed separators: SimdKeyParser searches for each in turn
+static void BM_SimdParser_Fast_MixedSeparators(benchmark::State& state) {
+    SimdKeyParser parser("", {":", "/", "/"});
+    std::string key = "acme:production/users/name";
+    std::string_view captures[3];
+    std::string_view attr;
+
+    for (auto _ : state) {
+        bool ok = parser.parse_fast(key, captures, attr);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(captures);
+        benchmark::DoNotOptimize(attr);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SimdParser_Fast_MixedSeparators);
+
+static std::vector<std::string> make_short_keys(size_t count) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back("users##g" + std::to_string(i % 4) + "##u" + std::to_string(i) + "##name");
+    }
+    return keys;
+}
+
+// One parse_fast() call per key
+static void BM_SimdParser_Fast_ShortKeyLoop(benchmark::State& state) {
+    SimdKeyParser parser("users", "##", 2);
+    auto keys = make_short_keys(64);
+    std::string_view captures[2];
+    std::string_view attr;
+
+    for (auto _ : state) {
+        for (const auto& key : keys) {
+            bool ok = parser.parse_fast(key, captures, attr);
+            benchmark::DoNotOptimize(ok);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_SimdParser_Fast_ShortKeyLoop);
+
+// The same keys through parse_batch()
+static void BM_SimdParser_Batch_ShortKeys(benchmark::State& state) {
+    SimdKeyParser parser("users", "##", 2);
+    auto keys = make_short_keys(64);
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::vector<std::string_view> captures(views.size() * 2);
+    std::vector<std::string_view> attrs(views.size());
+    std::unique_ptr<bool[]> matched(new bool[views.size()]);
+
+    for (auto _ : state) {
+        size_t parsed = parser.parse_batch(views.data(), views.size(), captures.data(),
+                                           attrs.data(), matched.get());
+        benchmark::DoNotOptimize(parsed);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * views.size());
+}
+BENCHMARK(BM_SimdParser_Batch_ShortKeys);
+
+// ============================================================================
+// Delimiter Kernel Benchmarks (one per kernel this CPU can run)
+// ============================================================================
+
+static void BM_FindDelimiters(benchmark::State& state, detail::FindDelimitersFn find,
+                              std::string key, std::string delim) {
+    size_t positions[16];
+    size_t count = 0;
+
+    for (auto _ : state) {
+        find(key.data(), key.size(), 0, delim.data(), delim.size(), positions, count, 16);
+        benchmark::DoNotOptimize(count);
+        benchmark::DoNotOptimize(positions);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * key.size());
+}
+
+static void BM_FindDelimitersBatch(benchmark::State& state, detail::FindDelimitersBatchFn find_batch) {
+    auto keys = make_short_keys(64);
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::vector<size_t> positions(views.size() * 4);
+    std::vector<size_t> counts(views.size());
+
+    for (auto _ : state) {
+        find_batch(views.data(), views.size(), 5, "##", 2, positions.data(), counts.data(), 4);
+        benchmark::DoNotOptimize(counts.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * views.size());
+}
+
+static const bool kernel_benchmarks_registered = [] {
+    const std::string long_key = "data##" + std::string(200, 'x') + "##" + std::string(100, 'y');
+    const std::string mixed_key = "acme::/prod::/" + std::string(60, ':') + "::/users::/name";
+
+    for (const auto& kernel : detail::available_delimiter_kernels()) {
+        std::string suffix = std::string("/") + kernel.name;
+        benchmark::RegisterBenchmark(("BM_FindDelimiters_Short" + suffix).c_str(),
+                                     BM_FindDelimiters, kernel.find,
+                                     std::string("users##admins##user001##email"), std::string("##"));
+        benchmark::RegisterBenchmark(("BM_FindDelimiters_Long" + suffix).c_str(),
+                                     BM_FindDelimiters, kernel.find, long_key, std::string("##"));
+        benchmark::RegisterBenchmark(("BM_FindDelimiters_MultiByte" + suffix).c_str(),
+                                     BM_FindDelimiters, kernel.find, mixed_key, std::string("::/"));
+        benchmark::RegisterBenchmark(("BM_FindDelimitersBatch_Short" + suffix).c_str(),
+                                     BM_FindDelimitersBatch, kernel.find_batch);
+    }
+    return true;
+}();
+
+// ============================================================================
+// Attr Name Lookup Benchmarks
+// ============================================================================
+
+// Attr names like a wide table's columns; keys are probed round-robin
+// with one miss in every eight, as when scanning keys for undeclared attrs
+static std::vector<std::string> make_attr_names(int count) {
+    static const char* stems[] = {"name", "email", "created_at", "status",
+                                  "region", "score", "last_login", "plan"};
+    std::vector<std::string> names;
+    for (int i = 0; i < count; ++i) {
+        names.push_back(std::string(stems[i % 8]) + "_" + std::to_string(i / 8));
+    }
+    return names;
+}
+
+static std::vector<std::string> make_attr_probes(const std::vector<std::string>& names) {
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < names.size(); ++i) {
+        probes.push_back(i % 8 == 7 ? "unknown_attr_" + std::to_string(i) : names[i]);
+    }
+    return probes;
+}
+
+// Before: string-keyed map, with a temporary std::string per probe
+static void BM_AttrLookup_UnorderedMap(benchmark::State& state) {
+    auto names = make_attr_names(static_cast<int>(state.range(0)));
+    auto probes = make_attr_probes(names);
+    std::unordered_map<std::string, int> map;
+    for (size_t i = 0; i < names.size(); ++i) {
+        map[names[i]] = static_cast<int>(i);
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        std::string_view probe = probes[i];
+        if (++i == probes.size()) {
+            i = 0;
+        }
+        auto it = map.find(std::string(probe));
+        int slot = it != map.end() ? it->second : -1;
+        benchmark::DoNotOptimize(slot);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AttrLookup_UnorderedMap)->Arg(4)->Arg(20)->Arg(100);
+
+static void BM_AttrLookup_Specialized(benchmark::State& state) {
+    auto names = make_attr_names(static_cast<int>(state.range(0)));
+    auto probes = make_attr_probes(names);
+    AttrLookup lookup(names);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        std::string_view probe = probes[i];
+        if (++i == probes.size()) {
+            i = 0;
+        }
+        int slot = lookup.find(probe);
+        benchmark::DoNotOptimize(slot);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AttrLookup_Specialized)->Arg(4)->Arg(20)->Arg(100);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Compare Google Benchmark JSON output against a stored baseline.
+
+Each benchmark's keys/sec (items_per_second) must stay within the
+tolerance of its baseline value; a slower result is a regression and
+makes the check fail. Benchmarks missing from the baseline are listed
+but don't fail, so new ones can land before their numbers are recorded;
+an empty baseline fails, since it would pass any result.
+With repetitions, the median of each benchmark is compared.
+
+Throughput depends on the machine, so the baseline should be recorded
+on the machine that checks it (e.g. the CI runner) with --update.
+
+Usage:
+  check_baseline.py RESULTS.json --baseline baseline.json [--tolerance 0.5]
+  check_baseline.py --run ./level_pivot_e2e_benchmarks --baseline baseline.json
+  check_baseline.py RESULTS.json --baseline baseline.json --update
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+METRICS = ("items_per_second", "bytes_per_second")
+
+
+def load_results(path):
+    """Map benchmark name -> metrics, preferring medians of repetitions."""
+    with open(path) as f:
+        data = json.load(f)
+
+    results = {}
+    medians = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        metrics = {m: bench[m] for m in METRICS if m in bench}
+        if not metrics:
+            continue
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = metrics
+        else:
+            results.setdefault(bench.get("run_name", bench["name"]), metrics)
+    results.update(medians)
+    return results, data.get("context", {})
+
+
+def run_benchmarks(binary, out, extra):
+    cmd = [binary, "--benchmark_out=" + out, "--benchmark_out_format=json",
+           "--benchmark_repetitions=3", "--benchmark_report_aggregates_only=true"]
+    subprocess.run(cmd + extra, check=True)
+
+
+def format_rate(value):
+    for unit in ("", "k", "M", "G"):
+        if abs(value) < 1000:
+            return "%.1f%s" % (value, unit)
+        value /= 1000.0
+    return "%.1fT" % value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("results", nargs="?", help="benchmark JSON output")
+    parser.add_argument("--baseline", required=True, help="baseline JSON file")
+    parser.add_argument("--run", metavar="BINARY", help="run this benchmark binary first")
+    parser.add_argument("--out", default="benchmark_results.json",
+                        help="where --run writes its JSON output")
+    parser.add_argument("--tolerance", type=float,
+                        help="allowed slowdown as a fraction (default: baseline's, else 0.5)")
+    parser.add_argument("--update", action="store_true",
+                        help="write the results as the new baseline instead of checking")
+    args, extra = parser.parse_known_args()
+
+    results_path = args.results
+    if args.run:
+        results_path = args.out
+        run_benchmarks(args.run, results_path, extra)
+    elif extra:
+        parser.error("unrecognized arguments: " + " ".join(extra))
+    if not results_path:
+        parser.error("give a results file or --run")
+
+    results, context = load_results(results_path)
+
+    try:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    except FileNotFoundError:
+        baseline = {}
+
+    if args.update:
+        baseline["benchmarks"] = results
+        baseline["context"] = {k: context[k] for k in
+                               ("host_name", "num_cpus", "mhz_per_cpu", "library_build_type")
+                               if k in context}
+        baseline.setdefault("tolerance", args.tolerance or 0.5)
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Recorded %d benchmarks in %s" % (len(results), args.baseline))
+        return 0
+
+    tolerance = args.tolerance or baseline.get("tolerance", 0.5)
+    expected = baseline.get("benchmarks", {})
+    regressions = []
+    width = max([len(name) for name in results] + [9])
+
+    print("%-*s %12s %12s %8s" % (width, "benchmark", "keys/s", "baseline", "change"))
+    for name in sorted(results):
+        current = results[name].get("items_per_second")
+        base = expected.get(name, {}).get("items_per_second")
+        if current is None:
+            continue
+        if not base:
+            print("%-*s %12s %12s %8s" % (width, name, format_rate(current), "-", "new"))
+            continue
+        change = current / base - 1.0
+        flag = ""
+        if change < -tolerance:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print("%-*s %12s %12s %+7.1f%%%s" % (width, name, format_rate(current),
+                                             format_rate(base), change * 100, flag))
+
+    missing = sorted(set(expected) - set(results))
+    for name in missing:
+        print("%-*s %12s %12s %8s" % (width, name, "-",
+                                       format_rate(expected[name].get("items_per_second", 0)),
+                                       "not run"))
+
+    if not expected:
+        print("\nNo baseline recorded in %s; record one on the machine that runs"
+              " this check with --update (CI uploads its results as the"
+              " benchmark-results artifact)." % args.baseline)
+        return 1
+    if regressions:
+        print("\n%d benchmark(s) more than %.0f%% slower than baseline:"
+              % (len(regressions), tolerance * 100))
+        for name in regressions:
+            print("  " + name)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,11 @@
+#!/bin/bash
+# Point lookup benchmark
+# Tests the fast path taken when every identity column is bound by equality
+
+# Run benchmark: SELECT a few rows fully specified by tenant, service and metric_id
+# Each row should be read with one short seek, not a scan of the service's prefix
+# Returns: duration_ms,rows_affected
+run_point_lookup() {
+    local size="$1"
+    time_sql_cmd "SELECT value FROM bench_metrics WHERE tenant = 'tenant_1' AND service = 'service_1' AND metric_id IN ('metric_1', 'metric_21', 'metric_41')"
+}
@@ -16,7 +16,7 @@ SQL_DIR="${PROJECT_DIR}/sql"
 # Configuration
 SIZES="${SIZES:-1000,10000,100000}"
 ITERATIONS="${ITERATIONS:-3}"
-BENCHMARKS="${BENCHMARKS:-full_scan,filtered_scan,prefix_scan,single_insert,batch_insert,update_same_identity,update_new_identity,delete_single,delete_batch}"
+BENCHMARKS="${BENCHMARKS:-full_scan,filtered_scan,prefix_scan,point_lookup,single_insert,batch_insert,update_same_identity,update_new_identity,delete_single,delete_batch}"
 
 # Source the embedded postgres functions
 source "${SCRIPT_DIR}/../embedded_postgres.sh"
@@ -171,6 +171,21 @@ stop_postgres() {
     fi
 }
 
+# Restart PostgreSQL with the level_pivot broker preloaded
+enable_broker() {
+    local pg_dir="$1"
+    local data_dir="$2"
+    local port="$3"
+
+    echo "Restarting PostgreSQL with the level_pivot broker..." >&2
+    cat >> "${data_dir}/postgresql.conf" <<CONF
+shared_preload_libraries = 'level_pivot'
+level_pivot.broker = on
+CONF
+    stop_postgres "${pg_dir}" "${data_dir}"
+    start_postgres "${pg_dir}" "${data_dir}" "${port}"
+}
+
 create_test_database() {
     local pg_dir="$1"
     local data_dir="$2"
@@ -85,13 +85,34 @@ if [[ $FAILED -eq 0 ]]; then
         run_test "${SCRIPT_DIR}/test_raw.sql" || FAILED=1
     fi
 
+    # Run ANALYZE tests
+    if [[ -f "${SCRIPT_DIR}/test_analyze.sql" ]]; then
+        run_test "${SCRIPT_DIR}/test_analyze.sql" || FAILED=1
+    fi
+
     # Run NOTIFY tests
     if [[ -f "${SCRIPT_DIR}/test_notify.sql" ]]; then
         run_test "${SCRIPT_DIR}/test_notify.sql" || FAILED=1
     fi
 
+    # Run monitoring tests
+    if [[ -f "${SCRIPT_DIR}/test_monitoring.sql" ]]; then
+        run_test "${SCRIPT_DIR}/test_monitoring.sql" || FAILED=1
+    fi
+
+    # Run secondary index tests
+    if [[ -f "${SCRIPT_DIR}/test_secondary_index.sql" ]]; then
+        run_test "${SCRIPT_DIR}/test_secondary_index.sql" || FAILED=1
+    fi
+
     # Run cleanup
     run_test "${SCRIPT_DIR}/cleanup.sql" || FAILED=1
+
+    # Run parallel scan tests, which need the broker preloaded
+    if [[ $FAILED -eq 0 && -f "${SCRIPT_DIR}/test_parallel.sql" ]]; then
+        enable_broker "${PG_DIR}" "${DATA_DIR}" "${PG_PORT}"
+        run_test "${SCRIPT_DIR}/test_parallel.sql" || FAILED=1
+    fi
 fi
 
 echo ""
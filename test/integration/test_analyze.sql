@@ -0,0 +1,42 @@
+-- Test ANALYZE support for level_pivot FDW
+-- ANALYZE samples rows through AcquireSampleRows and fills pg_statistic
+
+-- Setup: Clean state
+DELETE FROM users WHERE group_name = 'analyze_test';
+
+INSERT INTO users (group_name, id, name, email)
+SELECT 'analyze_test', 'user' || lpad(i::text, 4, '0'),
+       CASE WHEN i % 2 = 0 THEN 'Even' ELSE 'Odd' END,
+       'user' || i || '@test.com'
+FROM generate_series(1, 200) AS i;
+
+-- ============================================
+-- Test 1: ANALYZE populates pg_stats for pivoted columns
+-- ============================================
+SELECT '=== Test 1: ANALYZE on pivot table ===' AS test;
+
+ANALYZE users;
+
+SELECT attname, null_frac IS NOT NULL AS has_stats
+FROM pg_stats
+WHERE tablename = 'users' AND attname IN ('group_name', 'name')
+ORDER BY attname;
+
+-- 'name' only has two distinct values among the sampled rows
+SELECT most_common_vals::text::text[] @> ARRAY['Even', 'Odd'] AS name_mcvs
+FROM pg_stats
+WHERE tablename = 'users' AND attname = 'name';
+
+-- ============================================
+-- Test 2: reltuples reflects the row count
+-- ============================================
+SELECT '=== Test 2: reltuples after ANALYZE ===' AS test;
+
+SELECT reltuples >= 200 AS reltuples_ok
+FROM pg_class
+WHERE relname = 'users';
+
+-- Cleanup
+DELETE FROM users WHERE group_name = 'analyze_test';
+
+SELECT 'ANALYZE tests completed successfully' AS status;
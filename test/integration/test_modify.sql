@@ -52,4 +52,137 @@ DELETE FROM users WHERE group_name = 'batch';
 -- Should return no rows
 SELECT COUNT(*) AS batch_count FROM users WHERE group_name = 'batch';
 
+-- Test direct (set-based) UPDATE and DELETE
+SELECT '=== Test Direct UPDATE/DELETE ===' AS test;
+
+INSERT INTO users (group_name, id, name, email)
+VALUES
+    ('direct', 'user1', 'Direct User 1', 'direct1@test.com'),
+    ('direct', 'user2', 'Direct User 2', 'direct2@test.com'),
+    ('direct', 'other', 'Direct Other', 'other@test.com'),
+    ('directory', 'user9', 'Not Direct', 'nine@test.com');
+
+-- Quals the key ranges settle run as "Foreign Update"/"Foreign Delete"
+EXPLAIN (VERBOSE, COSTS OFF)
+UPDATE users SET email = 'team@test.com' WHERE group_name = 'direct';
+EXPLAIN (VERBOSE, COSTS OFF)
+DELETE FROM users WHERE group_name = 'direct' AND id LIKE 'user%';
+-- A non-constant value or an attr qual keeps the per-row path
+EXPLAIN (VERBOSE, COSTS OFF)
+UPDATE users SET email = email || '.x' WHERE group_name = 'direct';
+EXPLAIN (VERBOSE, COSTS OFF)
+DELETE FROM users WHERE group_name = 'direct' AND name = 'Direct Other';
+
+DO $$
+DECLARE
+    n bigint;
+BEGIN
+    UPDATE users SET email = 'team@test.com', name = NULL
+    WHERE group_name = 'direct' AND id IN ('user1', 'user2');
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 2 THEN
+        RAISE EXCEPTION 'Direct UPDATE reported % rows, expected 2', n;
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name = 'direct'
+        AND email = 'team@test.com' AND name IS NULL) <> 2 THEN
+        RAISE EXCEPTION 'Direct UPDATE did not write every row';
+    END IF;
+
+    DELETE FROM users WHERE group_name = 'direct' AND id LIKE 'user%';
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 2 THEN
+        RAISE EXCEPTION 'Direct DELETE reported % rows, expected 2', n;
+    END IF;
+
+    DELETE FROM users WHERE group_name LIKE 'direct%';
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 2 THEN
+        RAISE EXCEPTION 'Prefix DELETE reported % rows, expected 2', n;
+    END IF;
+END $$;
+
+SELECT COUNT(*) AS direct_count FROM users WHERE group_name LIKE 'direct%';
+
+-- A value holding the delimiter reaches other rows' keys: 'dl##victim'
+-- as a group's range covers group dl, id victim
+INSERT INTO users (group_name, id, name) VALUES ('dl', 'victim', 'Kept');
+
+CREATE TEMP TABLE modify_plan (line text);
+DO $$
+DECLARE
+    line text;
+    n bigint;
+BEGIN
+    FOR line IN EXPLAIN (COSTS OFF) DELETE FROM users WHERE group_name = 'dl##victim'
+    LOOP
+        INSERT INTO modify_plan VALUES (line);
+    END LOOP;
+    IF EXISTS (SELECT 1 FROM modify_plan WHERE line LIKE '%Foreign Delete%') THEN
+        RAISE EXCEPTION 'DELETE on a value holding the delimiter was pushed down';
+    END IF;
+
+    UPDATE users SET name = 'Hit' WHERE group_name IN ('dl##victim', 'nobody');
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 0 THEN
+        RAISE EXCEPTION 'UPDATE on a value holding the delimiter hit % rows', n;
+    END IF;
+    DELETE FROM users WHERE group_name = 'dl##victim';
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 0 THEN
+        RAISE EXCEPTION 'DELETE on a value holding the delimiter hit % rows', n;
+    END IF;
+    IF (SELECT name FROM users WHERE group_name = 'dl' AND id = 'victim')
+       IS DISTINCT FROM 'Kept' THEN
+        RAISE EXCEPTION 'row dl/victim was modified';
+    END IF;
+END $$;
+
+DELETE FROM users WHERE group_name = 'dl';
+
+-- With a capture after {attr}, a row's keys aren't adjacent, so UPDATE and
+-- DELETE keep the per-row path and count each row once
+DROP FOREIGN TABLE IF EXISTS tagged;
+CREATE FOREIGN TABLE tagged (
+    kind   TEXT,
+    id     TEXT,
+    name   TEXT,
+    email  TEXT
+)
+SERVER test_leveldb
+OPTIONS (key_pattern 'tagged##{kind}##{attr}##{id}');
+
+INSERT INTO tagged (kind, id, name, email) VALUES
+    ('a', '1', 'One', 'one@test.com'),
+    ('a', '2', 'Two', 'two@test.com');
+
+TRUNCATE modify_plan;
+DO $$
+DECLARE
+    line text;
+    n bigint;
+BEGIN
+    FOR line IN EXPLAIN (COSTS OFF) DELETE FROM tagged WHERE kind = 'a'
+    LOOP
+        INSERT INTO modify_plan VALUES (line);
+    END LOOP;
+    IF EXISTS (SELECT 1 FROM modify_plan WHERE line LIKE '%Foreign Delete%') THEN
+        RAISE EXCEPTION 'DELETE with a capture after {attr} was pushed down';
+    END IF;
+
+    UPDATE tagged SET name = 'Same' WHERE kind = 'a';
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 2 THEN
+        RAISE EXCEPTION 'UPDATE with a capture after {attr} reported % rows, expected 2', n;
+    END IF;
+    DELETE FROM tagged WHERE kind = 'a';
+    GET DIAGNOSTICS n = ROW_COUNT;
+    IF n <> 2 THEN
+        RAISE EXCEPTION 'DELETE with a capture after {attr} reported % rows, expected 2', n;
+    END IF;
+END $$;
+
+SELECT COUNT(*) AS tagged_count FROM tagged;
+DROP FOREIGN TABLE tagged;
+DROP TABLE modify_plan;
+
 SELECT 'MODIFY tests completed successfully' AS status;
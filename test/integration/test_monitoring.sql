@@ -0,0 +1,107 @@
+-- Test the monitoring functions and EXPLAIN ANALYZE phase timings
+-- level_pivot_stats() sums per-table counters over all backends
+
+-- Setup: Clean state
+DELETE FROM users WHERE group_name = 'monitor_test';
+SELECT level_pivot_stats_reset();
+
+-- ============================================
+-- Test 1: writes are counted per table
+-- ============================================
+SELECT '=== Test 1: write counters ===' AS test;
+
+INSERT INTO users (group_name, id, name, email)
+SELECT 'monitor_test', 'user' || i, 'Name ' || i, 'user' || i || '@test.com'
+FROM generate_series(1, 20) AS i;
+
+UPDATE users SET email = 'changed@test.com'
+WHERE group_name = 'monitor_test' AND id = 'user1';
+
+SELECT rows_inserted = 20 AS inserted_ok,
+       rows_updated = 1 AS updated_ok,
+       keys_written >= 40 AS keys_written_ok,
+       write_batches >= 1 AS batches_ok
+FROM level_pivot_table_stats
+WHERE relname = 'users';
+
+-- ============================================
+-- Test 2: scans are counted per table
+-- ============================================
+SELECT '=== Test 2: scan counters ===' AS test;
+
+-- OFFSET 0 keeps the count from being pushed down as a key count
+SELECT count(*) FROM (
+    SELECT * FROM users WHERE group_name = 'monitor_test' OFFSET 0
+) s;
+
+SELECT scans >= 1 AS scans_ok,
+       rows_returned >= 20 AS rows_ok,
+       keys_scanned >= 40 AS keys_ok,
+       bytes_read > 0 AS bytes_ok
+FROM level_pivot_table_stats
+WHERE relname = 'users';
+
+-- ============================================
+-- Test 3: EXPLAIN ANALYZE shows the phase breakdown
+-- ============================================
+SELECT '=== Test 3: EXPLAIN ANALYZE timings ===' AS test;
+
+CREATE TEMP TABLE explain_out (line text);
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (ANALYZE, TIMING, COSTS OFF)
+        SELECT * FROM users WHERE group_name = 'monitor_test'
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+END $$;
+
+SELECT bool_or(line LIKE '%LevelDB Bytes Read%') AS has_bytes_read,
+       bool_or(line LIKE '%LevelDB Read Time%') AS has_read_time,
+       bool_or(line LIKE '%Key Parse Time%') AS has_parse_time,
+       bool_or(line LIKE '%Datum Conversion Time%') AS has_convert_time
+FROM explain_out;
+
+-- Timings are skipped with TIMING off
+TRUNCATE explain_out;
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (ANALYZE, TIMING OFF, COSTS OFF)
+        SELECT * FROM users WHERE group_name = 'monitor_test'
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+END $$;
+
+SELECT NOT bool_or(line LIKE '%Read Time%') AS no_read_time
+FROM explain_out;
+
+-- ============================================
+-- Test 4: reset zeroes the counters
+-- ============================================
+SELECT '=== Test 4: stats reset ===' AS test;
+
+SELECT level_pivot_stats_reset();
+SELECT coalesce(sum(scans + rows_inserted), 0) = 0 AS reset_ok
+FROM level_pivot_stats();
+
+-- ============================================
+-- Test 5: LevelDB properties
+-- ============================================
+SELECT '=== Test 5: LevelDB properties ===' AS test;
+
+SELECT property
+FROM level_pivot_db_properties('test_leveldb')
+WHERE property IN ('leveldb.stats', 'leveldb.sstables',
+                   'leveldb.approximate-memory-usage')
+ORDER BY property;
+
+-- Cleanup
+DELETE FROM users WHERE group_name = 'monitor_test';
+DROP TABLE explain_out;
+
+SELECT 'Monitoring tests completed successfully' AS status;
@@ -66,6 +66,27 @@ DELETE FROM raw_test WHERE key = 'notify_key_1';
 
 UNLISTEN public_raw_test_changed;
 
+-- Test 8: One notification per table per transaction, naming the rows
+\echo '--- Test 8: Coalesced notification with payload ---'
+LISTEN public_users_changed;
+BEGIN;
+SET LOCAL level_pivot.notify_payload = on;
+INSERT INTO users (group_name, id, name) VALUES ('notify_test', 'n4', 'Dana');
+UPDATE users SET name = 'Dana Updated' WHERE group_name = 'notify_test' AND id = 'n4';
+INSERT INTO users (group_name, id, name) VALUES ('notify_test', 'n5', 'Eve');
+COMMIT;
+\echo 'Expect one notification: {"rows":[["notify_test","n4"],["notify_test","n5"]]}'
+
+-- Test 9: Past notify_max_rows, rows are summarized by prefix
+\echo '--- Test 9: Summarized payload ---'
+BEGIN;
+SET LOCAL level_pivot.notify_payload = on;
+SET LOCAL level_pivot.notify_max_rows = 1;
+DELETE FROM users WHERE group_name = 'notify_test';
+COMMIT;
+\echo 'Expect one notification: {"rows":[["notify_test"]]}'
+UNLISTEN public_users_changed;
+
 \echo ''
 \echo '=== NOTIFY Tests Completed Successfully ==='
 \echo 'Note: Actual notification delivery requires checking via LISTEN in separate connection'
@@ -0,0 +1,134 @@
+-- Test parallel pivot scans (needs shared_preload_libraries = 'level_pivot'
+-- and level_pivot.broker = on; run_tests.sh restarts the server with them)
+
+CREATE EXTENSION IF NOT EXISTS level_pivot;
+
+CREATE SERVER parallel_leveldb
+    FOREIGN DATA WRAPPER level_pivot
+    OPTIONS (
+        db_path '/tmp/level_pivot_test',
+        read_only 'false',
+        create_if_missing 'true'
+    );
+
+CREATE FOREIGN TABLE parallel_items (
+    grp   TEXT,
+    id    TEXT,
+    score INTEGER,
+    label TEXT
+)
+SERVER parallel_leveldb
+OPTIONS (key_pattern 'par##{grp}##{id}##{attr}');
+
+INSERT INTO parallel_items (grp, id, score, label)
+SELECT 'g' || (i % 8), lpad(i::text, 6, '0'), i, 'item ' || i
+FROM generate_series(1, 20000) AS i;
+
+-- Make any parallel plan look cheap
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+-- ============================================
+-- Test 1: full scans get a parallel plan
+-- ============================================
+SELECT '=== Test 1: parallel plan ===' AS test;
+
+CREATE TEMP TABLE explain_out (line text);
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF)
+        SELECT sum(score) FROM parallel_items
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+    IF NOT EXISTS (SELECT 1 FROM explain_out
+                   WHERE line LIKE '%Parallel Foreign Scan on parallel_items%') THEN
+        RAISE EXCEPTION 'Expected a parallel foreign scan';
+    END IF;
+END $$;
+
+SELECT line FROM explain_out WHERE line LIKE '%Workers Launched%';
+
+-- ============================================
+-- Test 2: parallel scans return the rows a serial scan does
+-- ============================================
+SELECT '=== Test 2: parallel results match serial ===' AS test;
+
+CREATE TEMP TABLE parallel_results AS
+SELECT 'all' AS query, count(score) AS n, sum(score) AS total, count(DISTINCT id) AS ids
+FROM parallel_items
+UNION ALL
+SELECT 'in_list', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp IN ('g1', 'g6')
+UNION ALL
+SELECT 'range', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp = 'g3' AND id BETWEEN '005000' AND '012000'
+UNION ALL
+SELECT 'point', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp = 'g2' AND id IN ('000010', '000018');
+
+SET max_parallel_workers_per_gather = 0;
+
+CREATE TEMP TABLE serial_results AS
+SELECT 'all' AS query, count(score) AS n, sum(score) AS total, count(DISTINCT id) AS ids
+FROM parallel_items
+UNION ALL
+SELECT 'in_list', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp IN ('g1', 'g6')
+UNION ALL
+SELECT 'range', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp = 'g3' AND id BETWEEN '005000' AND '012000'
+UNION ALL
+SELECT 'point', count(score), sum(score), count(DISTINCT id)
+FROM parallel_items WHERE grp = 'g2' AND id IN ('000010', '000018');
+
+SELECT * FROM parallel_results ORDER BY query;
+
+DO $$
+BEGIN
+    IF EXISTS (SELECT * FROM parallel_results EXCEPT SELECT * FROM serial_results) OR
+       EXISTS (SELECT * FROM serial_results EXCEPT SELECT * FROM parallel_results) THEN
+        RAISE EXCEPTION 'Parallel and serial scans returned different rows';
+    END IF;
+    IF (SELECT n FROM serial_results WHERE query = 'all') <> 20000 THEN
+        RAISE EXCEPTION 'Expected 20000 rows';
+    END IF;
+END $$;
+
+-- ============================================
+-- Test 3: no parallel plan under transaction write scope
+-- ============================================
+SELECT '=== Test 3: transaction writes stay serial ===' AS test;
+
+SET max_parallel_workers_per_gather = 2;
+SET level_pivot.write_scope = transaction;
+
+TRUNCATE explain_out;
+BEGIN;
+INSERT INTO parallel_items (grp, id, score) VALUES ('g9', '999999', 1);
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (COSTS OFF) SELECT sum(score) FROM parallel_items
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+    IF EXISTS (SELECT 1 FROM explain_out WHERE line LIKE '%Parallel%') THEN
+        RAISE EXCEPTION 'Pending writes must not be scanned in parallel';
+    END IF;
+END $$;
+SELECT count(score) AS with_pending_write FROM parallel_items;
+ROLLBACK;
+
+RESET level_pivot.write_scope;
+
+-- Cleanup
+DROP FOREIGN TABLE parallel_items;
+DROP SERVER parallel_leveldb CASCADE;
+
+SELECT 'Parallel scan tests completed' AS status;
@@ -45,11 +45,59 @@ SELECT * FROM raw_test WHERE key > 'raw:001' AND key <= 'raw:003' ORDER BY key;
 \echo '--- Testing prefix scan pattern ---'
 SELECT * FROM raw_test WHERE key >= 'raw:' AND key < 'raw:\xFF' ORDER BY key;
 
+-- Test anchored LIKE, starts_with and ^@ become key bounds
+\echo '--- Testing prefix pushdown ---'
+SELECT * FROM raw_test WHERE key LIKE 'raw:00%' ORDER BY key;
+SELECT * FROM raw_test WHERE starts_with(key, 'raw:00') ORDER BY key;
+SELECT * FROM raw_test WHERE key ^@ 'raw:00' ORDER BY key;
+-- The part after the first wildcard is left to the recheck
+SELECT * FROM raw_test WHERE key LIKE 'raw:%2' ORDER BY key;
+EXPLAIN (COSTS OFF) SELECT * FROM raw_test WHERE key LIKE 'raw:00%';
+EXPLAIN (COSTS OFF) SELECT * FROM raw_test WHERE key LIKE 'raw:%2' ORDER BY key LIMIT 1;
+
+-- Test descending order is read backwards, without a Sort
+\echo '--- Testing reverse scan ---'
+SELECT * FROM raw_test WHERE key > 'raw:001' AND key <= 'raw:010' ORDER BY key DESC LIMIT 2;
+EXPLAIN (COSTS OFF) SELECT * FROM raw_test ORDER BY key DESC LIMIT 2;
+
+-- Test LIMIT and OFFSET are applied by the scan
+\echo '--- Testing LIMIT pushdown ---'
+SELECT * FROM raw_test WHERE key >= 'raw:' ORDER BY key LIMIT 2 OFFSET 1;
+EXPLAIN (COSTS OFF) SELECT * FROM raw_test WHERE key >= 'raw:' ORDER BY key LIMIT 2 OFFSET 1;
+
 -- Test EXPLAIN shows key bounds
 \echo '--- Testing EXPLAIN output ---'
 EXPLAIN (COSTS OFF) SELECT * FROM raw_test WHERE key = 'raw:002';
 EXPLAIN (COSTS OFF) SELECT * FROM raw_test WHERE key >= 'raw:' AND key < 'raw:\xFF';
 
+-- Test a BYTEA value column stores and returns raw bytes
+\echo '--- Testing BYTEA values ---'
+DROP FOREIGN TABLE IF EXISTS raw_bytes_test;
+CREATE FOREIGN TABLE raw_bytes_test (
+    key   TEXT,
+    value BYTEA
+)
+SERVER test_leveldb
+OPTIONS (table_mode 'raw');
+
+INSERT INTO raw_bytes_test VALUES ('raw:bin', '\x00ff0041'::bytea);
+DO $$
+BEGIN
+    IF (SELECT value FROM raw_bytes_test WHERE key = 'raw:bin') <> '\x00ff0041'::bytea THEN
+        RAISE EXCEPTION 'BYTEA value did not round-trip';
+    END IF;
+    -- Stored as the bytes themselves, not their hex text
+    IF (SELECT length(value) FROM raw_bytes_test WHERE key = 'raw:bin') <> 4 THEN
+        RAISE EXCEPTION 'BYTEA value stored with the wrong length';
+    END IF;
+    UPDATE raw_bytes_test SET value = '\x0000'::bytea WHERE key = 'raw:bin';
+    IF (SELECT value FROM raw_bytes_test WHERE key = 'raw:bin') <> '\x0000'::bytea THEN
+        RAISE EXCEPTION 'BYTEA update with NULs did not round-trip';
+    END IF;
+END $$;
+DELETE FROM raw_bytes_test WHERE key = 'raw:bin';
+DROP FOREIGN TABLE raw_bytes_test;
+
 -- Test UPDATE
 \echo '--- Testing UPDATE ---'
 UPDATE raw_test SET value = 'updated_value2' WHERE key = 'raw:002';
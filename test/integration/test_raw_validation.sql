@@ -99,4 +99,83 @@ OPTIONS (key_pattern 'test##{id}##{attr}');
 \echo 'Successfully created pivot table'
 DROP FOREIGN TABLE valid_pivot_test;
 
+-- Test: invalid fill_cache value
+\echo '--- Test: invalid fill_cache value ---'
+DO $$
+BEGIN
+    EXECUTE '
+        CREATE FOREIGN TABLE invalid_fill_cache (
+            key   TEXT,
+            value TEXT
+        )
+        SERVER test_leveldb
+        OPTIONS (table_mode ''raw'', fill_cache ''sometimes'')
+    ';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: invalid fill_cache value';
+END $$;
+
+-- Test: scan with caching off and checksums verified
+\echo '--- Test: fill_cache and verify_checksums ---'
+DROP FOREIGN TABLE IF EXISTS raw_no_cache_test;
+CREATE FOREIGN TABLE raw_no_cache_test (
+    key   TEXT,
+    value TEXT
+)
+SERVER test_leveldb
+OPTIONS (table_mode 'raw', fill_cache 'false', verify_checksums 'true');
+SELECT count(*) >= 0 AS scanned FROM raw_no_cache_test;
+ALTER FOREIGN TABLE raw_no_cache_test OPTIONS (SET fill_cache 'auto');
+SET level_pivot.fill_cache = off;
+SELECT count(*) >= 0 AS scanned FROM raw_no_cache_test;
+RESET level_pivot.fill_cache;
+DROP FOREIGN TABLE raw_no_cache_test;
+
+-- Test: invalid prefetch_batch_size value
+\echo '--- Test: invalid prefetch_batch_size value ---'
+DO $$
+BEGIN
+    EXECUTE '
+        CREATE FOREIGN TABLE invalid_prefetch (
+            key   TEXT,
+            value TEXT
+        )
+        SERVER test_leveldb
+        OPTIONS (table_mode ''raw'', prefetch ''true'', prefetch_batch_size ''0'')
+    ';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: invalid prefetch_batch_size value';
+END $$;
+
+-- Test: prefetching scans return the same rows, forwards and backwards
+\echo '--- Test: prefetch ---'
+DROP FOREIGN TABLE IF EXISTS raw_prefetch_test;
+CREATE FOREIGN TABLE raw_prefetch_test (
+    key   TEXT,
+    value TEXT
+)
+SERVER test_leveldb
+OPTIONS (table_mode 'raw', prefetch 'true', prefetch_batch_size '8');
+CREATE TEMP TABLE raw_prefetch_expected AS
+    SELECT key, value FROM raw_prefetch_test WHERE false;
+SET level_pivot.prefetch = off;
+ALTER FOREIGN TABLE raw_prefetch_test OPTIONS (DROP prefetch);
+INSERT INTO raw_prefetch_expected SELECT key, value FROM raw_prefetch_test;
+ALTER FOREIGN TABLE raw_prefetch_test OPTIONS (ADD prefetch 'true');
+SELECT (SELECT array_agg(key || '=' || value ORDER BY key) FROM raw_prefetch_test) IS NOT DISTINCT FROM
+       (SELECT array_agg(key || '=' || value ORDER BY key) FROM raw_prefetch_expected) AS prefetch_matches;
+SELECT array(SELECT key FROM raw_prefetch_test ORDER BY key DESC LIMIT 20) =
+       array(SELECT key FROM raw_prefetch_expected ORDER BY key DESC LIMIT 20) AS reverse_matches;
+ALTER FOREIGN TABLE raw_prefetch_test OPTIONS (SET prefetch 'auto');
+SET level_pivot.prefetch_batch_size = 1;
+SELECT count(*) = (SELECT count(*) FROM raw_prefetch_expected) AS auto_matches FROM raw_prefetch_test;
+RESET level_pivot.prefetch_batch_size;
+RESET level_pivot.prefetch;
+DROP TABLE raw_prefetch_expected;
+DROP FOREIGN TABLE raw_prefetch_test;
+
 \echo '=== Raw Table Validation Tests Complete ==='
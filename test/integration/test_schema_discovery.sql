@@ -78,6 +78,39 @@ BEGIN
     END IF;
 END $$;
 
+-- Import again, sampling with probes on threads and typing columns
+\echo '--- Testing sampled IMPORT with inferred types ---'
+DROP SCHEMA IF EXISTS discovered CASCADE;
+CREATE SCHEMA discovered;
+
+INSERT INTO discovery_raw VALUES ('discover##acme##user001##age', '34');
+INSERT INTO discovery_raw VALUES ('discover##acme##user002##age', '41');
+
+IMPORT FOREIGN SCHEMA leveldb_schema
+FROM SERVER test_leveldb
+INTO discovered
+OPTIONS (sample_keys '1000', sample_probes '8', sample_threads '2');
+
+SELECT column_name, data_type
+FROM information_schema.columns
+WHERE table_schema = 'discovered' AND column_name IN ('age', 'name')
+ORDER BY column_name;
+
+\echo '--- Invalid IMPORT option ---'
+DO $$
+BEGIN
+    EXECUTE '
+        IMPORT FOREIGN SCHEMA leveldb_schema
+        FROM SERVER test_leveldb
+        INTO discovered
+        OPTIONS (sample_probes ''0'')
+    ';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: sample_probes 0';
+END $$;
+
 -- Clean up test data
 \echo '--- Cleanup ---'
 DELETE FROM discovery_raw WHERE key LIKE 'discover##%';
@@ -0,0 +1,202 @@
+-- Test writer-maintained secondary indexes (index_attrs)
+-- Index entries live under idx##<table>##<attr>##<value>##<identity>
+
+-- Setup: a table whose email and name columns are indexed
+DROP FOREIGN TABLE IF EXISTS indexed_users;
+CREATE FOREIGN TABLE indexed_users (
+    group_name  TEXT,
+    id          TEXT,
+    name        TEXT COLLATE "C",
+    email       TEXT
+)
+SERVER test_leveldb
+OPTIONS (
+    key_pattern 'iusers##{group_name}##{id}##{attr}',
+    index_attrs 'email, name'
+);
+
+-- The same keys without the index, to see the entries
+DROP FOREIGN TABLE IF EXISTS index_entries;
+CREATE FOREIGN TABLE index_entries (
+    key   TEXT,
+    value BYTEA
+)
+SERVER test_leveldb
+OPTIONS (table_mode 'raw');
+
+-- ============================================
+-- Test 1: INSERT writes an entry per indexed value
+-- ============================================
+SELECT '=== Test 1: INSERT writes entries ===' AS test;
+
+INSERT INTO indexed_users (group_name, id, name, email) VALUES
+    ('admins', 'u1', 'Ann', 'ann@test.com'),
+    ('admins', 'u2', 'Ann Lee', NULL),
+    ('staff', 'u3', 'Bob', 'bob@test.com');
+
+SELECT key FROM index_entries
+WHERE key LIKE 'idx##indexed_users##%'
+ORDER BY key;
+
+-- Enough other rows that a lookup beats reading the table
+INSERT INTO indexed_users (group_name, id, name, email)
+SELECT 'filler', 'f' || i, 'Filler ' || i, 'f' || i || '@test.com'
+FROM generate_series(1, 500) AS i;
+
+-- ============================================
+-- Test 2: equality, IN, range and prefix quals use the index
+-- ============================================
+SELECT '=== Test 2: lookups ===' AS test;
+
+CREATE TEMP TABLE explain_out (line text);
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF)
+        SELECT * FROM indexed_users WHERE email = 'bob@test.com'
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+END $$;
+
+SELECT bool_or(line LIKE '%LevelDB Index Lookup: email%') AS uses_index,
+       bool_or(line LIKE '%LevelDB Index Matches: 1%') AS one_match
+FROM explain_out;
+
+SELECT group_name, id FROM indexed_users WHERE email = 'bob@test.com';
+SELECT id FROM indexed_users WHERE email IN ('ann@test.com', 'bob@test.com') ORDER BY id;
+SELECT id FROM indexed_users WHERE name <= 'Ann Lee' ORDER BY id;
+SELECT id FROM indexed_users WHERE name LIKE 'Ann%' ORDER BY id;
+SELECT count(*) AS no_match FROM indexed_users WHERE email = 'nobody@test.com';
+
+-- ============================================
+-- Test 3: UPDATE moves entries, DELETE removes them
+-- ============================================
+SELECT '=== Test 3: UPDATE and DELETE ===' AS test;
+
+UPDATE indexed_users SET email = 'ann@new.com' WHERE id = 'u1';
+SELECT count(*) AS old_email FROM indexed_users WHERE email = 'ann@test.com';
+SELECT id FROM indexed_users WHERE email = 'ann@new.com';
+
+UPDATE indexed_users SET name = NULL WHERE group_name = 'admins';
+SELECT count(*) AS cleared_names FROM indexed_users WHERE name LIKE 'Ann%';
+
+DELETE FROM indexed_users WHERE group_name IN ('staff', 'filler');
+SELECT key FROM index_entries
+WHERE key LIKE 'idx##indexed_users##%'
+ORDER BY key;
+
+-- ============================================
+-- Test 4: level_pivot_rebuild_index() indexes existing rows
+-- ============================================
+SELECT '=== Test 4: rebuild ===' AS test;
+
+-- Rows written around the index: no entries
+INSERT INTO index_entries (key, value) VALUES
+    ('iusers##staff##u4##name', 'Cy'),
+    ('iusers##staff##u4##email', 'cy@test.com');
+INSERT INTO index_entries (key, value) VALUES
+    ('idx##indexed_users##email##stale@test.com##staff##u9', '\x050000007374616666020000007539'::bytea);
+
+SELECT count(*) AS before_rebuild FROM indexed_users WHERE email = 'cy@test.com';
+SELECT level_pivot_rebuild_index('indexed_users') AS entries_written;
+SELECT id FROM indexed_users WHERE email = 'cy@test.com';
+SELECT count(*) AS stale_gone FROM index_entries
+WHERE key LIKE 'idx##indexed_users##email##stale%';
+
+-- ============================================
+-- Test 5: non-text columns read the table
+-- ============================================
+SELECT '=== Test 5: integer column ===' AS test;
+
+-- Entries hold the stored text, so "007" has none under "7"
+DROP FOREIGN TABLE IF EXISTS indexed_scores;
+CREATE FOREIGN TABLE indexed_scores (
+    id     TEXT,
+    score  INTEGER
+)
+SERVER test_leveldb
+OPTIONS (
+    key_pattern 'iscores##{id}##{attr}',
+    index_attrs 'score'
+);
+
+INSERT INTO index_entries (key, value) VALUES ('iscores##s1##score', '007');
+SELECT level_pivot_rebuild_index('indexed_scores') AS entries_written;
+
+TRUNCATE explain_out;
+DO $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXPLAIN (COSTS OFF) SELECT * FROM indexed_scores WHERE score = 7
+    LOOP
+        INSERT INTO explain_out VALUES (line);
+    END LOOP;
+    IF EXISTS (SELECT 1 FROM explain_out WHERE line LIKE '%LevelDB Index Lookup%') THEN
+        RAISE EXCEPTION 'integer column used the index';
+    END IF;
+    IF (SELECT count(*) FROM indexed_scores WHERE score = 7) <> 1 THEN
+        RAISE EXCEPTION 'score = 7 missed the row stored as 007';
+    END IF;
+    IF (SELECT count(*) FROM indexed_scores WHERE score IN (7, 8)) <> 1 THEN
+        RAISE EXCEPTION 'score IN (7, 8) missed the row stored as 007';
+    END IF;
+END $$;
+
+SELECT id, score FROM indexed_scores WHERE score = 7;
+
+DELETE FROM index_entries WHERE key LIKE 'iscores##%' OR key LIKE 'idx##indexed_scores##%';
+DROP FOREIGN TABLE indexed_scores;
+
+-- ============================================
+-- Test 6: options are checked
+-- ============================================
+SELECT '=== Test 6: option validation ===' AS test;
+
+DO $$
+BEGIN
+    ALTER FOREIGN TABLE indexed_users OPTIONS (SET index_attrs 'email,,name');
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: empty name in index_attrs';
+END $$;
+
+DO $$
+BEGIN
+    ALTER FOREIGN TABLE indexed_users OPTIONS (ADD index_name 'a##b');
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: index_name with a delimiter';
+END $$;
+
+-- Identity columns are part of the keys already
+DO $$
+BEGIN
+    ALTER FOREIGN TABLE indexed_users OPTIONS (SET index_attrs 'id');
+    PERFORM * FROM indexed_users WHERE id = 'u1';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_error THEN
+        RAISE NOTICE 'Correctly rejected: identity column in index_attrs';
+END $$;
+
+DO $$
+BEGIN
+    PERFORM level_pivot_rebuild_index('users');
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN object_not_in_prerequisite_state THEN
+        RAISE NOTICE 'Correctly rejected: rebuild without index_attrs';
+END $$;
+
+-- Cleanup
+DELETE FROM indexed_users;
+DELETE FROM index_entries WHERE key LIKE 'idx##indexed_users##%';
+DROP FOREIGN TABLE indexed_users;
+DROP FOREIGN TABLE index_entries;
+
+SELECT 'Secondary index tests completed' AS status;
@@ -49,4 +49,344 @@ SELECT tenant, service, requests, latency_p99
 FROM metrics
 WHERE env = 'prod';
 
+-- Test 4: Attr predicates are checked by the scanner before tuples are built
+SELECT '=== Attr Filters ===' AS test;
+SELECT id, name FROM users WHERE name = 'Bob';
+SELECT id FROM users WHERE name IN ('Alice', 'Charlie') ORDER BY id;
+SELECT id FROM users WHERE created_at IS NULL ORDER BY id;
+SELECT id FROM users WHERE email IS NOT NULL AND name >= 'B' COLLATE "C" ORDER BY id;
+
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM users WHERE name = 'Bob') <> 1 THEN
+        RAISE EXCEPTION 'attr equality filter returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE name IN ('Alice', 'Charlie', 'Nobody')) <> 2 THEN
+        RAISE EXCEPTION 'attr IN filter returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE created_at IS NULL) <> 3 THEN
+        RAISE EXCEPTION 'attr IS NULL filter returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE name < 'Bob' COLLATE "C") <> 1 THEN
+        RAISE EXCEPTION 'attr range filter returned wrong rows';
+    END IF;
+END $$;
+
+-- Test 5: IN lists and ranges on identity columns become key ranges
+SELECT '=== Identity Ranges ===' AS test;
+SELECT group_name, id FROM users WHERE group_name IN ('staff', 'admins', 'nobody') ORDER BY id;
+SELECT id FROM users WHERE group_name = 'admins' AND id IN ('user002', 'user003') ORDER BY id;
+SELECT id FROM users WHERE group_name > 'admins' COLLATE "C" ORDER BY id;
+
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM users WHERE group_name IN ('staff', 'nobody')) <> 1 THEN
+        RAISE EXCEPTION 'identity IN range returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name = 'admins' AND id IN ('user001', 'user003')) <> 1 THEN
+        RAISE EXCEPTION 'identity IN-list product returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name >= 'admins' COLLATE "C" AND group_name < 'staff' COLLATE "C") <> 2 THEN
+        RAISE EXCEPTION 'identity range returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name = 'admins' AND id > 'user001' COLLATE "C") <> 1 THEN
+        RAISE EXCEPTION 'strict identity bound returned wrong rows';
+    END IF;
+END $$;
+
+-- Test 6: fully bound identities are looked up row by row
+SELECT '=== Point Lookups ===' AS test;
+SELECT id, name FROM users WHERE group_name = 'admins' AND id IN ('user001', 'user002', 'nobody') ORDER BY id;
+
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM users WHERE group_name = 'admins' AND id IN ('user001', 'nobody')) <> 1 THEN
+        RAISE EXCEPTION 'seek point lookup returned wrong rows';
+    END IF;
+END $$;
+
+ALTER FOREIGN TABLE users OPTIONS (ADD fixed_attrs 'true');
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM users WHERE group_name = 'admins' AND id IN ('user001', 'nobody')) <> 1 THEN
+        RAISE EXCEPTION 'get point lookup returned wrong rows';
+    END IF;
+END $$;
+ALTER FOREIGN TABLE users OPTIONS (DROP fixed_attrs);
+
+-- Test 7: joins on identity columns seek once per outer row
+SELECT '=== Parameterized Joins ===' AS test;
+CREATE TEMP TABLE wanted_users (grp TEXT, uid TEXT);
+INSERT INTO wanted_users VALUES ('admins', 'user001'), ('admins', 'nobody'), (NULL, 'user002');
+ANALYZE wanted_users;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SELECT u.id, u.name FROM wanted_users w
+JOIN users u ON u.group_name = w.grp AND u.id = w.uid ORDER BY u.id;
+
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM wanted_users w
+        JOIN users u ON u.group_name = w.grp AND u.id = w.uid) <> 1 THEN
+        RAISE EXCEPTION 'parameterized join returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM wanted_users w
+        JOIN users u ON u.group_name = 'admins' AND u.id = w.uid) <> 2 THEN
+        RAISE EXCEPTION 'parameterized join on the second capture returned wrong rows';
+    END IF;
+END $$;
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+DROP TABLE wanted_users;
+
+-- Test 8: count(*) and GROUP BY on leading identities are counted from keys
+SELECT '=== Aggregate Pushdown ===' AS test;
+SELECT group_name, count(*) FROM users GROUP BY group_name ORDER BY group_name;
+
+DO $$
+BEGIN
+    -- OFFSET 0 keeps the subquery, so its aggregate isn't pushed down
+    IF (SELECT count(*) FROM users) <>
+       (SELECT count(*) FROM (SELECT id FROM users OFFSET 0) s) THEN
+        RAISE EXCEPTION 'pushed-down count(*) differs from a plain scan';
+    END IF;
+    IF EXISTS (
+        (SELECT group_name, count(*), count(id) FROM users GROUP BY group_name)
+        EXCEPT
+        (SELECT group_name, count(*), count(*)
+         FROM (SELECT group_name FROM users OFFSET 0) s GROUP BY group_name)) THEN
+        RAISE EXCEPTION 'pushed-down GROUP BY differs from a plain scan';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name = 'admins') <>
+       (SELECT count(*) FROM (SELECT id FROM users WHERE group_name = 'admins' OFFSET 0) s) THEN
+        RAISE EXCEPTION 'pushed-down count(*) with an identity filter is wrong';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name = 'nobody') <> 0 THEN
+        RAISE EXCEPTION 'pushed-down count(*) over no rows is not 0';
+    END IF;
+    IF EXISTS (SELECT 1 FROM users WHERE group_name = 'nobody' GROUP BY group_name) THEN
+        RAISE EXCEPTION 'pushed-down GROUP BY over no rows returned a group';
+    END IF;
+END $$;
+
+-- 'agg##a1' as a group's key range covers group agg, id a1; the count
+-- has to come from a scan that rechecks the qual
+INSERT INTO users (group_name, id, name) VALUES ('agg', 'a1', 'Agg One');
+DO $$
+BEGIN
+    IF (SELECT count(*) FROM users WHERE group_name = 'agg##a1') <> 0 THEN
+        RAISE EXCEPTION 'count(*) on a value holding the delimiter counted other rows';
+    END IF;
+    IF (SELECT count(*) FROM users WHERE group_name IN ('agg', 'agg##a1')) <> 1 THEN
+        RAISE EXCEPTION 'count(*) over IN with a delimiter value is wrong';
+    END IF;
+END $$;
+DELETE FROM users WHERE group_name = 'agg';
+
+-- Test 9: scans are ordered by the leading identities, so ORDER BY needs no Sort
+SELECT '=== Identity Order ===' AS test;
+
+-- Only once the table promises its values sort like their keys
+DO $$
+DECLARE
+    plan_line TEXT;
+    sorted BOOLEAN := false;
+BEGIN
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users ORDER BY group_name, id LIMIT 2
+    LOOP
+        sorted := sorted OR plan_line LIKE '%Sort%';
+    END LOOP;
+    IF NOT sorted THEN
+        RAISE EXCEPTION 'scan counted as ordered without sorted_identities';
+    END IF;
+END $$;
+
+ALTER FOREIGN TABLE users OPTIONS (ADD sorted_identities 'true');
+SELECT group_name, id FROM users ORDER BY group_name, id LIMIT 2;
+
+DO $$
+DECLARE
+    plan_line TEXT;
+BEGIN
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users ORDER BY group_name, id LIMIT 2
+    LOOP
+        IF plan_line LIKE '%Sort%' THEN
+            RAISE EXCEPTION 'identity-ordered scan is sorted again: %', plan_line;
+        END IF;
+    END LOOP;
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users WHERE group_name = 'admins' ORDER BY id
+    LOOP
+        IF plan_line LIKE '%Sort%' THEN
+            RAISE EXCEPTION 'scan within one group is sorted again: %', plan_line;
+        END IF;
+    END LOOP;
+    IF (SELECT string_agg(id, ',') FROM
+        (SELECT id FROM users ORDER BY group_name, id LIMIT 2) s) <> 'user001,user002' THEN
+        RAISE EXCEPTION 'identity-ordered scan returned rows out of order';
+    END IF;
+END $$;
+
+-- Test 10: descending orders scan backwards
+SELECT '=== Reverse Scans ===' AS test;
+SELECT group_name, id, name FROM users ORDER BY group_name DESC, id DESC LIMIT 2;
+
+DO $$
+DECLARE
+    plan_line TEXT;
+BEGIN
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users ORDER BY group_name DESC, id DESC LIMIT 2
+    LOOP
+        IF plan_line LIKE '%Sort%' THEN
+            RAISE EXCEPTION 'descending scan is sorted: %', plan_line;
+        END IF;
+    END LOOP;
+    IF (SELECT string_agg(id || '=' || name, ',') FROM
+        (SELECT id, name FROM users ORDER BY group_name DESC, id DESC) s) <>
+       'user003=Charlie,user002=Bob,user001=Alice' THEN
+        RAISE EXCEPTION 'reverse scan returned wrong rows';
+    END IF;
+    IF (SELECT string_agg(id, ',') FROM
+        (SELECT id FROM users WHERE group_name = 'admins' AND id IN ('user001', 'user002')
+         ORDER BY id DESC) s) <> 'user002,user001' THEN
+        RAISE EXCEPTION 'reverse point lookups returned wrong rows';
+    END IF;
+END $$;
+
+-- Test 11: LIMIT and OFFSET are applied by the scan when it settles every qual
+SELECT '=== Limit Pushdown ===' AS test;
+SELECT group_name, id FROM users ORDER BY group_name, id LIMIT 1 OFFSET 1;
+
+PREPARE limited_users(int, int) AS
+    SELECT id FROM users ORDER BY group_name, id LIMIT $1 OFFSET $2;
+
+DO $$
+DECLARE
+    plan_line TEXT;
+    found_limit BOOLEAN := false;
+BEGIN
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users WHERE group_name = 'admins' ORDER BY id LIMIT 1 OFFSET 1
+    LOOP
+        IF plan_line LIKE '%Limit%' AND plan_line NOT LIKE '%LevelDB Limit%' THEN
+            RAISE EXCEPTION 'pushed-down LIMIT still has a Limit node: %', plan_line;
+        END IF;
+        IF plan_line LIKE '%LevelDB Limit: 1%' THEN
+            found_limit := true;
+        END IF;
+    END LOOP;
+    IF NOT found_limit THEN
+        RAISE EXCEPTION 'EXPLAIN does not show the pushed-down LIMIT';
+    END IF;
+
+    -- A qual the scan can't settle leaves the Limit to PostgreSQL
+    FOR plan_line IN EXPLAIN (COSTS OFF)
+        SELECT * FROM users WHERE name <> 'Bob' ORDER BY group_name, id LIMIT 1
+    LOOP
+        IF plan_line LIKE '%LevelDB Limit%' THEN
+            RAISE EXCEPTION 'LIMIT pushed below a qual: %', plan_line;
+        END IF;
+    END LOOP;
+
+    IF (SELECT string_agg(id, ',') FROM
+        (SELECT id FROM users WHERE group_name = 'admins' ORDER BY id LIMIT 1 OFFSET 1) s)
+       <> 'user002' THEN
+        RAISE EXCEPTION 'pushed-down OFFSET returned wrong rows';
+    END IF;
+    IF (SELECT string_agg(id, ',') FROM
+        (SELECT id FROM users ORDER BY group_name DESC, id DESC LIMIT 2) s)
+       <> 'user003,user002' THEN
+        RAISE EXCEPTION 'pushed-down LIMIT on a reverse scan returned wrong rows';
+    END IF;
+    IF (SELECT count(*) FROM (SELECT id FROM users LIMIT 0) s) <> 0 OR
+       (SELECT count(*) FROM (SELECT id FROM users OFFSET 5) s) <> 0 OR
+       (SELECT count(*) FROM (SELECT id FROM users LIMIT NULL OFFSET 1) s) <> 2 THEN
+        RAISE EXCEPTION 'LIMIT 0, OFFSET past the end or LIMIT NULL went wrong';
+    END IF;
+    IF (SELECT name FROM users WHERE name <> 'Bob' ORDER BY group_name, id LIMIT 1 OFFSET 1)
+       <> 'Charlie' THEN
+        RAISE EXCEPTION 'LIMIT above a qual returned the wrong row';
+    END IF;
+
+    BEGIN
+        PERFORM id FROM users LIMIT -1;
+        RAISE EXCEPTION 'negative LIMIT was accepted';
+    EXCEPTION WHEN invalid_row_count_in_limit_clause THEN
+        NULL;
+    END;
+END $$;
+
+EXECUTE limited_users(2, 1);
+DEALLOCATE limited_users;
+
+-- Test 12: cached projections are rebuilt after ALTER FOREIGN TABLE
+SELECT '=== Projection Cache ===' AS test;
+DO $$
+BEGIN
+    IF (SELECT name FROM users WHERE group_name = 'admins' AND id = 'user001') <> 'Alice' THEN
+        RAISE EXCEPTION 'point query returned the wrong name';
+    END IF;
+
+    -- The renamed column reads attr "full_name", which no row has
+    ALTER FOREIGN TABLE users RENAME COLUMN name TO full_name;
+    IF (SELECT full_name FROM users WHERE group_name = 'admins' AND id = 'user001')
+       IS NOT NULL THEN
+        RAISE EXCEPTION 'scan used a projection from before the rename';
+    END IF;
+
+    ALTER FOREIGN TABLE users RENAME COLUMN full_name TO name;
+    IF (SELECT name FROM users WHERE group_name = 'admins' AND id = 'user001') <> 'Alice' THEN
+        RAISE EXCEPTION 'scan used a projection from before renaming back';
+    END IF;
+END $$;
+
+-- Test 13: typed columns parse stored values, unusual forms included
+SELECT '=== Typed Reads ===' AS test;
+CREATE FOREIGN TABLE metrics_typed (
+    tenant      TEXT,
+    env         TEXT,
+    service     TEXT,
+    requests    BIGINT,
+    latency_p99 INTEGER,
+    error_rate  FLOAT8
+)
+SERVER test_leveldb
+OPTIONS (
+    key_pattern '{tenant}:{env}/{service}/{attr}'
+);
+
+INSERT INTO metrics (tenant, env, service, requests, latency_p99, error_rate)
+VALUES ('typed', 'prod', 'edge', ' -9223372036854775808 ', '+2147483647', '1e-3'),
+       ('typed', 'prod', 'web', '12345678901', '-17', 'Infinity');
+
+SELECT * FROM metrics_typed WHERE tenant IN ('acme', 'typed')
+ORDER BY tenant, env, service;
+
+DO $$
+BEGIN
+    IF (SELECT requests FROM metrics_typed WHERE tenant = 'typed' AND service = 'edge')
+       <> -9223372036854775808 THEN
+        RAISE EXCEPTION 'BIGINT with surrounding spaces read back wrong';
+    END IF;
+    IF (SELECT latency_p99 FROM metrics_typed WHERE tenant = 'typed' AND service = 'edge')
+       <> 2147483647 THEN
+        RAISE EXCEPTION 'INTEGER with a plus sign read back wrong';
+    END IF;
+    IF (SELECT error_rate FROM metrics_typed WHERE tenant = 'typed' AND service = 'web')
+       <> 'Infinity'::float8 THEN
+        RAISE EXCEPTION 'FLOAT8 Infinity read back wrong';
+    END IF;
+    IF (SELECT sum(error_rate) FROM metrics_typed WHERE tenant = 'acme') <> 0.001 THEN
+        RAISE EXCEPTION 'FLOAT8 values read back wrong';
+    END IF;
+END $$;
+
+DELETE FROM metrics WHERE tenant = 'typed';
+DROP FOREIGN TABLE metrics_typed;
+
+ALTER FOREIGN TABLE users OPTIONS (DROP sorted_identities);
+
 SELECT 'SELECT tests completed successfully' AS status;
@@ -3,7 +3,7 @@
 -- for atomic writes
 
 -- Setup: Clean state
-DELETE FROM users WHERE group_name IN ('wb_test', 'wb_atomic');
+DELETE FROM users WHERE group_name IN ('wb_test', 'wb_atomic', 'wb_bulk', 'wb_txn');
 
 -- ============================================
 -- Test 1: Multi-row INSERT uses WriteBatch
@@ -100,16 +100,169 @@ WHERE group_name = 'wb_atomic' AND name = 'Modified User';
 -- Verify deletion
 SELECT COUNT(*) AS after_delete_count FROM users WHERE group_name = 'wb_atomic';
 
+-- ============================================
+-- Test 7: Batched INSERT with batch_size
+-- ============================================
+SELECT '=== Test 7: INSERT with batch_size ===' AS test;
+
+ALTER FOREIGN TABLE users OPTIONS (ADD batch_size '100');
+
+-- 250 rows = two full batches plus a partial one; some emails are NULL
+INSERT INTO users (group_name, id, name, email)
+SELECT
+    'wb_bulk',
+    'user' || lpad(g::text, 4, '0'),
+    'Bulk User ' || g,
+    CASE WHEN g % 10 = 0 THEN NULL ELSE 'bulk' || g || '@test.com' END
+FROM generate_series(1, 250) AS g;
+
+SELECT COUNT(*) AS bulk_count,
+       COUNT(email) AS bulk_email_count
+FROM users WHERE group_name = 'wb_bulk';
+
+SELECT * FROM users
+WHERE group_name = 'wb_bulk' AND id IN ('user0001', 'user0100', 'user0250')
+ORDER BY id;
+
+-- RETURNING needs each row back, so it must still work (one row per call)
+INSERT INTO users (group_name, id, name)
+VALUES ('wb_bulk', 'returning1', 'Returned'), ('wb_bulk', 'returning2', 'Returned')
+RETURNING group_name, id, name;
+
+ALTER FOREIGN TABLE users OPTIONS (DROP batch_size);
+
+-- ============================================
+-- Test 8: Batched INSERT on a raw table
+-- ============================================
+SELECT '=== Test 8: Raw table INSERT with batch_size ===' AS test;
+
+DROP FOREIGN TABLE IF EXISTS raw_batch_test;
+CREATE FOREIGN TABLE raw_batch_test (
+    key   TEXT,
+    value TEXT
+)
+SERVER test_leveldb
+OPTIONS (table_mode 'raw', batch_size '64');
+
+INSERT INTO raw_batch_test
+SELECT 'wb_raw:' || lpad(g::text, 4, '0'), 'v' || g
+FROM generate_series(1, 150) AS g;
+
+SELECT COUNT(*) AS raw_batch_count FROM raw_batch_test WHERE key LIKE 'wb_raw:%';
+SELECT * FROM raw_batch_test WHERE key IN ('wb_raw:0001', 'wb_raw:0150') ORDER BY key;
+
+DELETE FROM raw_batch_test WHERE key LIKE 'wb_raw:%';
+DROP FOREIGN TABLE raw_batch_test;
+
+-- ============================================
+-- Test 9: Invalid batch_size is rejected
+-- ============================================
+SELECT '=== Test 9: Invalid batch_size ===' AS test;
+
+DO $$
+BEGIN
+    EXECUTE 'ALTER FOREIGN TABLE users OPTIONS (ADD batch_size ''0'')';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: batch_size 0';
+END $$;
+
+DO $$
+BEGIN
+    EXECUTE 'ALTER FOREIGN TABLE users OPTIONS (ADD batch_size ''ten'')';
+    RAISE EXCEPTION 'Expected error was not raised';
+EXCEPTION
+    WHEN fdw_invalid_attribute_value THEN
+        RAISE NOTICE 'Correctly rejected: batch_size ten';
+END $$;
+
+-- ============================================
+-- Test 10: Transaction-scope writes
+-- ============================================
+SELECT '=== Test 10: Transaction-scope writes ===' AS test;
+
+-- Rolled back: nothing reaches LevelDB, though the transaction saw it
+BEGIN;
+SET LOCAL level_pivot.write_scope = transaction;
+INSERT INTO users (group_name, id, name) VALUES ('wb_txn', 'user1', 'Pending');
+UPDATE users SET email = 'pending@test.com' WHERE group_name = 'wb_txn';
+SELECT id, name, email FROM users WHERE group_name = 'wb_txn';
+ROLLBACK;
+
+SELECT COUNT(*) AS after_rollback FROM users WHERE group_name = 'wb_txn';
+
+-- Committed: every statement's writes land together
+BEGIN;
+SET LOCAL level_pivot.write_scope = transaction;
+INSERT INTO users (group_name, id, name) VALUES ('wb_txn', 'user1', 'Kept 1');
+INSERT INTO users (group_name, id, name) VALUES ('wb_txn', 'user2', 'Kept 2');
+DELETE FROM users WHERE group_name = 'wb_txn' AND id = 'user2';
+COMMIT;
+
+SELECT id, name FROM users WHERE group_name = 'wb_txn' ORDER BY id;
+
+-- ROLLBACK TO SAVEPOINT drops only the writes made after the savepoint
+BEGIN;
+SET LOCAL level_pivot.write_scope = transaction;
+INSERT INTO users (group_name, id, name) VALUES ('wb_txn', 'user3', 'Before savepoint');
+SAVEPOINT sp;
+INSERT INTO users (group_name, id, name) VALUES ('wb_txn', 'user4', 'Rolled back');
+UPDATE users SET name = 'Rolled back' WHERE group_name = 'wb_txn' AND id = 'user1';
+ROLLBACK TO SAVEPOINT sp;
+SAVEPOINT sp2;
+UPDATE users SET email = 'kept@test.com' WHERE group_name = 'wb_txn' AND id = 'user3';
+RELEASE SAVEPOINT sp2;
+COMMIT;
+
+SELECT id, name, email FROM users WHERE group_name = 'wb_txn' ORDER BY id;
+
+DO $$
+BEGIN
+    IF EXISTS (SELECT 1 FROM users WHERE group_name = 'wb_txn' AND
+               (id = 'user4' OR name = 'Rolled back')) THEN
+        RAISE EXCEPTION 'Writes rolled back to a savepoint were committed';
+    END IF;
+    IF NOT EXISTS (SELECT 1 FROM users WHERE group_name = 'wb_txn' AND
+                   id = 'user3' AND email = 'kept@test.com') THEN
+        RAISE EXCEPTION 'Writes around the savepoint were lost';
+    END IF;
+END $$;
+
+-- Past the limit, error fails the transaction and spill keeps going
+BEGIN;
+SET LOCAL level_pivot.write_scope = transaction;
+SET LOCAL level_pivot.pending_write_limit = 1;
+SET LOCAL level_pivot.pending_write_overflow = spill;
+INSERT INTO users (group_name, id, name)
+SELECT 'wb_txn', 'spill' || i, repeat('x', 600) FROM generate_series(1, 5) i;
+COMMIT;
+
+SELECT COUNT(*) AS spilled_count FROM users WHERE group_name = 'wb_txn' AND id LIKE 'spill%';
+
+DO $$
+BEGIN
+    SET LOCAL level_pivot.write_scope = transaction;
+    SET LOCAL level_pivot.pending_write_limit = 1;
+    BEGIN
+        INSERT INTO users (group_name, id, name)
+        SELECT 'wb_txn', 'over' || i, repeat('x', 600) FROM generate_series(1, 5) i;
+        RAISE EXCEPTION 'Write past pending_write_limit was not rejected';
+    EXCEPTION WHEN fdw_error THEN
+        NULL;
+    END;
+END $$;
+
 -- ============================================
 -- Cleanup
 -- ============================================
 SELECT '=== Cleanup ===' AS test;
 
-DELETE FROM users WHERE group_name IN ('wb_test', 'wb_atomic');
+DELETE FROM users WHERE group_name IN ('wb_test', 'wb_atomic', 'wb_bulk', 'wb_txn');
 
 -- Verify cleanup
 SELECT COUNT(*) AS final_count
 FROM users
-WHERE group_name IN ('wb_test', 'wb_atomic');
+WHERE group_name IN ('wb_test', 'wb_atomic', 'wb_bulk', 'wb_txn');
 
 SELECT 'WriteBatch tests completed successfully' AS status;
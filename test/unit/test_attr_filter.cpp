@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include "level_pivot/attr_filter.hpp"
+#include "level_pivot/pivot_scanner.hpp"
+
+using namespace level_pivot;
+
+// AttrFilter unit tests (no LevelDB needed)
+
+class AttrFilterTest : public ::testing::Test {
+protected:
+    // Slot 0: status (text), slot 1: count (integer), slot 2: unset
+    PivotRow row(const char* status, const char* count) {
+        PivotRow r(1, 3);
+        r.set_identity(0, "id");
+        if (status) r.set_attr(0, status);
+        if (count) r.set_attr(1, count);
+        return r;
+    }
+};
+
+TEST_F(AttrFilterTest, EmptyFilterMatchesEverything) {
+    AttrFilter filter;
+    EXPECT_TRUE(filter.empty());
+    EXPECT_TRUE(filter.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, TextEquality) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::EQ, {"active"}));
+    EXPECT_TRUE(filter.matches(row("active", nullptr)));
+    EXPECT_FALSE(filter.matches(row("inactive", nullptr)));
+    EXPECT_FALSE(filter.matches(row("Active", nullptr)));
+    // A missing key is NULL, which never equals anything
+    EXPECT_FALSE(filter.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, TextRangeComparesBytes) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::GE, {"b"}));
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::LT, {"d"}));
+    EXPECT_FALSE(filter.matches(row("a", nullptr)));
+    EXPECT_TRUE(filter.matches(row("b", nullptr)));
+    EXPECT_TRUE(filter.matches(row("cz", nullptr)));
+    EXPECT_FALSE(filter.matches(row("d", nullptr)));
+    // High bytes sort after ASCII, as in the C collation
+    EXPECT_FALSE(filter.matches(row("\xC3\xA9", nullptr)));
+}
+
+TEST_F(AttrFilterTest, TextInList) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::IN, {"pending", "active"}));
+    EXPECT_TRUE(filter.matches(row("active", nullptr)));
+    EXPECT_TRUE(filter.matches(row("pending", nullptr)));
+    EXPECT_FALSE(filter.matches(row("closed", nullptr)));
+    EXPECT_FALSE(filter.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, TextPrefix) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::PREFIX, {"act"}));
+    EXPECT_TRUE(filter.matches(row("active", nullptr)));
+    EXPECT_TRUE(filter.matches(row("act", nullptr)));
+    EXPECT_FALSE(filter.matches(row("ac", nullptr)));
+    EXPECT_FALSE(filter.matches(row("inactive", nullptr)));
+    EXPECT_FALSE(filter.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, IntegerComparesNumerically) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(1, PgType::INTEGER, AttrFilterOp::GT, {"9"}));
+    EXPECT_TRUE(filter.matches(row(nullptr, "10")));
+    EXPECT_FALSE(filter.matches(row(nullptr, "9")));
+    EXPECT_FALSE(filter.matches(row(nullptr, "-100")));
+    EXPECT_TRUE(filter.matches(row(nullptr, "0010")));
+    EXPECT_FALSE(filter.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, IntegerInList) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(1, PgType::BIGINT, AttrFilterOp::IN, {"3", "1", "5000000000"}));
+    EXPECT_TRUE(filter.matches(row(nullptr, "1")));
+    EXPECT_TRUE(filter.matches(row(nullptr, "5000000000")));
+    EXPECT_FALSE(filter.matches(row(nullptr, "2")));
+}
+
+TEST_F(AttrFilterTest, UnparsableIntegerIsLeftToPostgres) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(1, PgType::INTEGER, AttrFilterOp::EQ, {"1"}));
+    // int4in accepts (or rejects) these itself; the filter must not drop them
+    EXPECT_TRUE(filter.matches(row(nullptr, " 1")));
+    EXPECT_TRUE(filter.matches(row(nullptr, "+1")));
+    EXPECT_TRUE(filter.matches(row(nullptr, "abc")));
+    EXPECT_TRUE(filter.matches(row(nullptr, "5000000000")));
+}
+
+TEST_F(AttrFilterTest, NullTests) {
+    AttrFilter is_null;
+    ASSERT_TRUE(is_null.add(2, PgType::JSONB, AttrFilterOp::IS_NULL, {}));
+    EXPECT_TRUE(is_null.matches(row("x", "1")));
+
+    AttrFilter not_null;
+    ASSERT_TRUE(not_null.add(0, PgType::TEXT, AttrFilterOp::IS_NOT_NULL, {}));
+    EXPECT_TRUE(not_null.matches(row("", nullptr)));
+    EXPECT_FALSE(not_null.matches(row(nullptr, nullptr)));
+}
+
+TEST_F(AttrFilterTest, PredicatesAreAnded) {
+    AttrFilter filter;
+    ASSERT_TRUE(filter.add(0, PgType::TEXT, AttrFilterOp::EQ, {"active"}));
+    ASSERT_TRUE(filter.add(1, PgType::INTEGER, AttrFilterOp::LE, {"5"}));
+    EXPECT_EQ(filter.size(), 2u);
+    EXPECT_TRUE(filter.matches(row("active", "5")));
+    EXPECT_FALSE(filter.matches(row("active", "6")));
+    EXPECT_FALSE(filter.matches(row("closed", "5")));
+}
+
+TEST_F(AttrFilterTest, RejectsUncheckablePredicates) {
+    AttrFilter filter;
+    EXPECT_FALSE(filter.add(0, PgType::NUMERIC, AttrFilterOp::EQ, {"1.5"}));
+    EXPECT_FALSE(filter.add(1, PgType::INTEGER, AttrFilterOp::EQ, {"1.5"}));
+    EXPECT_FALSE(filter.add(0, PgType::TEXT, AttrFilterOp::EQ, {}));
+    EXPECT_FALSE(filter.add(0, PgType::TEXT, AttrFilterOp::IN, {}));
+    EXPECT_FALSE(filter.add(0, PgType::TEXT, AttrFilterOp::IS_NULL, {"x"}));
+    EXPECT_FALSE(filter.add(1, PgType::INTEGER, AttrFilterOp::PREFIX, {"1"}));
+    EXPECT_TRUE(filter.empty());
+}
+
+TEST_F(AttrFilterTest, ParseFilterInteger) {
+    int64_t v;
+    EXPECT_TRUE(parse_filter_integer("-42", PgType::INTEGER, v));
+    EXPECT_EQ(v, -42);
+    EXPECT_TRUE(parse_filter_integer("2147483647", PgType::INTEGER, v));
+    EXPECT_FALSE(parse_filter_integer("2147483648", PgType::INTEGER, v));
+    EXPECT_TRUE(parse_filter_integer("2147483648", PgType::BIGINT, v));
+    EXPECT_FALSE(parse_filter_integer("", PgType::BIGINT, v));
+    EXPECT_FALSE(parse_filter_integer("1e3", PgType::BIGINT, v));
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "level_pivot/attr_lookup.hpp"
+#include <string>
+#include <vector>
+
+using namespace level_pivot;
+
+class AttrLookupTest : public ::testing::Test {
+protected:
+    static std::vector<std::string> numbered(const std::string& stem, int count) {
+        std::vector<std::string> names;
+        for (int i = 0; i < count; ++i) {
+            names.push_back(stem + std::to_string(i));
+        }
+        return names;
+    }
+
+    static void expect_all_found(const AttrLookup& lookup,
+                                 const std::vector<std::string>& names) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            EXPECT_EQ(lookup.find(names[i]), static_cast<int>(i)) << names[i];
+        }
+    }
+};
+
+TEST_F(AttrLookupTest, EmptySetFindsNothing) {
+    AttrLookup lookup;
+    EXPECT_EQ(lookup.find("name"), -1);
+    EXPECT_EQ(lookup.find(""), -1);
+
+    AttrLookup built(std::vector<std::string>{});
+    EXPECT_EQ(built.find("name"), -1);
+}
+
+TEST_F(AttrLookupTest, SmallSetUsesLengthBuckets) {
+    std::vector<std::string> names = {"name", "email", "age", "role"};
+    AttrLookup lookup(names);
+
+    EXPECT_FALSE(lookup.is_hashed());
+    expect_all_found(lookup, names);
+    EXPECT_EQ(lookup.find("nam"), -1);
+    EXPECT_EQ(lookup.find("names"), -1);
+    EXPECT_EQ(lookup.find("rolf"), -1);
+    EXPECT_EQ(lookup.find("a_much_longer_name"), -1);
+}
+
+TEST_F(AttrLookupTest, LargeSetUsesPerfectHash) {
+    auto names = numbered("metric_", 40);
+    AttrLookup lookup(names);
+
+    EXPECT_TRUE(lookup.is_hashed());
+    expect_all_found(lookup, names);
+    EXPECT_EQ(lookup.find("metric_40"), -1);
+    EXPECT_EQ(lookup.find("metric_"), -1);
+    EXPECT_EQ(lookup.find("Metric_1"), -1);
+}
+
+TEST_F(AttrLookupTest, HashHandlesManyColumns) {
+    auto names = numbered("c", 1000);
+    AttrLookup lookup(names);
+
+    EXPECT_TRUE(lookup.is_hashed());
+    expect_all_found(lookup, names);
+    EXPECT_EQ(lookup.find("c1000"), -1);
+}
+
+TEST_F(AttrLookupTest, ThresholdBoundary) {
+    for (size_t count : {AttrLookup::LINEAR_MAX, AttrLookup::LINEAR_MAX + 1}) {
+        auto names = numbered("attr", static_cast<int>(count));
+        AttrLookup lookup(names);
+        EXPECT_EQ(lookup.is_hashed(), count > AttrLookup::LINEAR_MAX);
+        expect_all_found(lookup, names);
+    }
+}
+
+TEST_F(AttrLookupTest, LookupTakesUnterminatedView) {
+    std::vector<std::string> names = {"email", "name"};
+    AttrLookup lookup(names);
+
+    std::string key = "users##admins##user001##email##trailing";
+    std::string_view attr(key.data() + 24, 5);
+    EXPECT_EQ(lookup.find(attr), 0);
+}
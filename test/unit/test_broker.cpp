@@ -0,0 +1,334 @@
+#include <gtest/gtest.h>
+#include "level_pivot/broker.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <filesystem>
+#include <unistd.h>
+
+using namespace level_pivot;
+
+// Broker message codec tests (no LevelDB needed)
+
+TEST(BrokerMessageTest, RoundTrip) {
+    BrokerMessageWriter out;
+    out.put_u8(7);
+    size_t count = out.reserve_u32();
+    out.put_u64(1ull << 40);
+    out.put_string("key");
+    out.put_string(std::string("a\0b", 3));
+    out.patch_u32(count, 2);
+
+    BrokerMessageReader in(out.data());
+    EXPECT_EQ(in.get_u8(), 7);
+    EXPECT_EQ(in.get_u32(), 2u);
+    EXPECT_EQ(in.get_u64(), 1ull << 40);
+    EXPECT_EQ(in.get_string(), "key");
+    EXPECT_EQ(in.get_string(), std::string_view("a\0b", 3));
+    EXPECT_TRUE(in.at_end());
+}
+
+TEST(BrokerMessageTest, TruncatedMessageThrows) {
+    BrokerMessageWriter out;
+    out.put_u32(100);  // String length with no bytes behind it
+    BrokerMessageReader in(out.data());
+    EXPECT_THROW(in.get_string(), LevelDBError);
+}
+
+TEST(BrokerMessageTest, ParseCompression) {
+    EXPECT_EQ(parse_compression("none"), Compression::NONE);
+    EXPECT_EQ(parse_compression("snappy"), Compression::SNAPPY);
+    EXPECT_EQ(parse_compression("zstd"), Compression::ZSTD);
+    EXPECT_FALSE(parse_compression("lz4").has_value());
+    EXPECT_TRUE(compression_supported(Compression::SNAPPY));
+}
+
+// Broker client/service tests over an in-process transport (need LevelDB)
+
+/**
+ * Hands requests straight to a BrokerService, as the worker would
+ */
+class LoopbackTransport : public BrokerTransport {
+public:
+    explicit LoopbackTransport(BrokerService& service) : service_(service) {}
+
+    uint64_t connect() override { return session_id_; }
+
+    std::string call(const std::string& request) override {
+        ++calls;
+        return service_.handle(*session_, request);
+    }
+
+    // Drop the session, as after a broker restart
+    void reset() {
+        session_ = std::make_unique<BrokerService::Session>();
+        ++session_id_;
+    }
+
+    size_t calls = 0;
+
+private:
+    BrokerService& service_;
+    std::unique_ptr<BrokerService::Session> session_ =
+        std::make_unique<BrokerService::Session>();
+    uint64_t session_id_ = 1;
+};
+
+class BrokerTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    ConnectionOptions opts_;
+    BrokerService service_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_broker_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        opts_.db_path = test_db_path_;
+        opts_.read_only = false;
+        opts_.create_if_missing = true;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    std::shared_ptr<LevelDBConnection> connect(std::shared_ptr<LoopbackTransport> transport) {
+        return std::make_shared<LevelDBConnection>(opts_, std::move(transport));
+    }
+
+    static std::string key(int i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "k%05d", i);
+        return buf;
+    }
+
+    void populate(LevelDBConnection& conn, int count) {
+        auto batch = conn.create_batch();
+        for (int i = 0; i < count; ++i) {
+            batch.put(key(i), "v" + std::to_string(i));
+        }
+        batch.commit();
+    }
+};
+
+TEST_F(BrokerTest, GetPutDelete) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    EXPECT_TRUE(conn->is_brokered());
+
+    conn->put("a", "1");
+    EXPECT_EQ(conn->get("a"), std::optional<std::string>("1"));
+    conn->del("a");
+    EXPECT_FALSE(conn->get("a").has_value());
+}
+
+TEST_F(BrokerTest, BackendsShareOneDatabase) {
+    auto first = connect(std::make_shared<LoopbackTransport>(service_));
+    auto second = connect(std::make_shared<LoopbackTransport>(service_));
+
+    first->put("shared", "yes");
+    EXPECT_EQ(second->get("shared"), std::optional<std::string>("yes"));
+    EXPECT_EQ(service_.database_count(), 1u);
+}
+
+TEST_F(BrokerTest, ForwardScanStreamsInChunks) {
+    auto transport = std::make_shared<LoopbackTransport>(service_);
+    auto conn = connect(transport);
+    const int count = 10000;
+    populate(*conn, count);
+
+    size_t calls_before = transport->calls;
+    auto iter = conn->iterator();
+    int seen = 0;
+    for (iter.seek_to_first(); iter.valid(); iter.next(), ++seen) {
+        ASSERT_EQ(iter.key(), key(seen));
+        ASSERT_EQ(iter.value_view(), "v" + std::to_string(seen));
+    }
+    EXPECT_EQ(seen, count);
+
+    // Chunks grow, so far fewer requests than entries
+    size_t calls = transport->calls - calls_before;
+    EXPECT_GT(calls, 2u);
+    EXPECT_LT(calls, 20u);
+}
+
+TEST_F(BrokerTest, SeekAndChangeDirection) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 100);
+
+    auto iter = conn->iterator();
+    iter.seek("k00050x");
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(51));
+
+    // Back past the start of the fetched chunk
+    for (int i = 50; i >= 30; --i) {
+        iter.prev();
+        ASSERT_TRUE(iter.valid());
+        ASSERT_EQ(iter.key(), key(i));
+    }
+    // And forward again past the start of the backward chunk
+    for (int i = 31; i <= 60; ++i) {
+        iter.next();
+        ASSERT_TRUE(iter.valid());
+        ASSERT_EQ(iter.key(), key(i));
+    }
+
+    iter.seek_to_last();
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(99));
+    iter.next();
+    EXPECT_FALSE(iter.valid());
+
+    iter.seek("zzz");
+    EXPECT_FALSE(iter.valid());
+}
+
+TEST_F(BrokerTest, WriteBatchIsOneRequest) {
+    auto transport = std::make_shared<LoopbackTransport>(service_);
+    auto conn = connect(transport);
+    conn->put("old", "x");
+
+    size_t calls_before = transport->calls;
+    auto batch = conn->create_batch();
+    batch.put("a", "1");
+    batch.put("b", "2");
+    batch.del("old");
+    batch.commit();
+    EXPECT_EQ(transport->calls - calls_before, 1u);
+
+    EXPECT_EQ(conn->get("b"), std::optional<std::string>("2"));
+    EXPECT_FALSE(conn->get("old").has_value());
+}
+
+TEST_F(BrokerTest, ApproximateSize) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 10);
+    // Data is still in the memtable; only checks the call goes through
+    EXPECT_GE(conn->approximate_size("", ""), 0u);
+}
+
+TEST_F(BrokerTest, PropertiesComeFromTheBrokersDatabase) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 10);
+    auto stats = conn->property("leveldb.stats");
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_FALSE(stats->empty());
+    EXPECT_TRUE(conn->property("leveldb.approximate-memory-usage").has_value());
+    EXPECT_FALSE(conn->property("leveldb.no-such-property").has_value());
+}
+
+TEST_F(BrokerTest, ErrorsComeBackAsLevelDBError) {
+    opts_.db_path = test_db_path_ + "/missing/nested";
+    opts_.create_if_missing = false;
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    EXPECT_THROW(conn->get("a"), LevelDBError);
+}
+
+TEST_F(BrokerTest, ReadOnlyIsEnforcedByTheBackend) {
+    auto writer = connect(std::make_shared<LoopbackTransport>(service_));
+    writer->put("a", "1");
+
+    opts_.read_only = true;
+    auto reader = connect(std::make_shared<LoopbackTransport>(service_));
+    EXPECT_EQ(reader->get("a"), std::optional<std::string>("1"));
+    EXPECT_THROW(reader->put("a", "2"), LevelDBError);
+}
+
+TEST_F(BrokerTest, SessionResetReopensDatabase) {
+    auto transport = std::make_shared<LoopbackTransport>(service_);
+    auto conn = connect(transport);
+    populate(*conn, 100);
+
+    auto iter = conn->iterator();
+    iter.seek_to_first();
+    ASSERT_TRUE(iter.valid());
+
+    transport->reset();
+
+    // The old cursor is gone with its session...
+    EXPECT_THROW({
+        for (int i = 0; i < 100; ++i) iter.next();
+    }, LevelDBError);
+
+    // ...but the connection reopens the database transparently
+    EXPECT_EQ(conn->get(key(5)), std::optional<std::string>("v5"));
+}
+
+TEST_F(BrokerTest, ClosedCursorsAreReleased) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 10);
+
+    for (int i = 0; i < 3; ++i) {
+        auto iter = conn->iterator();
+        iter.seek_to_first();
+        EXPECT_TRUE(iter.valid());
+    }
+    // Releases ride along with the next request
+    EXPECT_EQ(conn->get(key(1)), std::optional<std::string>("v1"));
+}
+
+TEST_F(BrokerTest, PinnedSnapshotCoversGetsAndCursors) {
+    auto writer = connect(std::make_shared<LoopbackTransport>(service_));
+    auto reader = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*writer, 10);
+
+    reader->acquire_snapshot();
+    writer->put(key(0), "changed");
+    writer->put("new", "row");
+
+    EXPECT_EQ(reader->get(key(0)), std::optional<std::string>("v0"));
+    EXPECT_FALSE(reader->get("new").has_value());
+
+    auto iter = reader->iterator();
+    int seen = 0;
+    for (iter.seek_to_first(); iter.valid(); iter.next(), ++seen) {
+        ASSERT_EQ(iter.value_view(), "v" + std::to_string(seen));
+    }
+    EXPECT_EQ(seen, 10);
+
+    reader->release_snapshot();
+    EXPECT_EQ(reader->get(key(0)), std::optional<std::string>("changed"));
+    EXPECT_EQ(reader->get("new"), std::optional<std::string>("row"));
+}
+
+TEST_F(BrokerTest, SnapshotLostWithSessionThrows) {
+    auto transport = std::make_shared<LoopbackTransport>(service_);
+    auto conn = connect(transport);
+    populate(*conn, 10);
+
+    conn->acquire_snapshot();
+    transport->reset();
+
+    // Reading newer data instead would break the statement's consistency
+    EXPECT_THROW(conn->get(key(1)), LevelDBError);
+    EXPECT_THROW(conn->iterator(), LevelDBError);
+
+    conn->release_snapshot();
+    EXPECT_EQ(conn->get(key(1)), std::optional<std::string>("v1"));
+}
+
+TEST_F(BrokerTest, ScanOptionsGoWithTheCursor) {
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 10);
+
+    ScanOptions scan;
+    scan.fill_cache = false;
+    scan.verify_checksums = true;
+    auto iter = conn->iterator(scan);
+    int seen = 0;
+    for (iter.seek_to_first(); iter.valid(); iter.next()) {
+        ++seen;
+    }
+    EXPECT_EQ(seen, 10);
+}
+
+TEST_F(BrokerTest, TuningOptionsOpenTheDatabase) {
+    opts_.bloom_bits_per_key = 0;
+    opts_.block_size = 16 * 1024;
+    opts_.max_open_files = 200;
+    opts_.compression = Compression::NONE;
+    opts_.max_file_size = 8 * 1024 * 1024;
+
+    auto conn = connect(std::make_shared<LoopbackTransport>(service_));
+    populate(*conn, 10);
+    EXPECT_EQ(conn->get(key(3)), std::optional<std::string>("v3"));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "level_pivot/change_set.hpp"
+
+using namespace level_pivot;
+
+// ChangeSet unit tests (no LevelDB needed)
+
+class ChangeSetTest : public ::testing::Test {};
+
+TEST_F(ChangeSetTest, RowsAreDeduplicated) {
+    ChangeSet changes;
+    EXPECT_TRUE(changes.empty());
+    changes.add({"admins", "u2"});
+    changes.add({"admins", "u1"});
+    changes.add({"admins", "u2"});
+
+    EXPECT_EQ(changes.entries().size(), 2u);
+    EXPECT_EQ(changes.payload(8000), R"({"rows":[["admins","u1"],["admins","u2"]]})");
+}
+
+TEST_F(ChangeSetTest, PastMaxRowsEntriesAreCutToPrefixes) {
+    ChangeSet changes(3);
+    changes.add({"admins", "u1"});
+    changes.add({"admins", "u2"});
+    changes.add({"staff", "u3"});
+    EXPECT_EQ(changes.entries().size(), 3u);
+
+    changes.add({"staff", "u4"});
+    EXPECT_EQ(changes.payload(8000), R"({"rows":[["admins"],["staff"]]})");
+
+    // Later rows are cut to the same depth
+    changes.add({"guests", "u5"});
+    EXPECT_EQ(changes.payload(8000), R"({"rows":[["admins"],["guests"],["staff"]]})");
+    EXPECT_FALSE(changes.whole_table());
+}
+
+TEST_F(ChangeSetTest, CollapsesToWholeTable) {
+    ChangeSet changes(2);
+    changes.add({"a", "1"});
+    changes.add({"b", "1"});
+    changes.add({"c", "1"});
+    EXPECT_TRUE(changes.whole_table());
+    EXPECT_EQ(changes.payload(8000), R"({"all":true})");
+
+    changes.add({"d", "1"});
+    EXPECT_TRUE(changes.whole_table());
+    EXPECT_FALSE(changes.empty());
+}
+
+TEST_F(ChangeSetTest, RawKeysCollapseStraightToWholeTable) {
+    ChangeSet changes(2);
+    changes.add_key("k1");
+    changes.add_key("k2");
+    EXPECT_EQ(changes.payload(8000), R"({"rows":[["k1"],["k2"]]})");
+    changes.add_key("k3");
+    EXPECT_TRUE(changes.whole_table());
+}
+
+TEST_F(ChangeSetTest, MergeCombinesStatements) {
+    ChangeSet transaction;
+    ChangeSet first;
+    first.add({"admins", "u1"});
+    ChangeSet second;
+    second.add({"admins", "u1"});
+    second.add({"staff", "u2"});
+
+    transaction.merge(first);
+    transaction.merge(second);
+    EXPECT_EQ(transaction.entries().size(), 2u);
+
+    ChangeSet everything;
+    everything.add_all();
+    transaction.merge(everything);
+    EXPECT_TRUE(transaction.whole_table());
+}
+
+TEST_F(ChangeSetTest, PayloadEscapesJson) {
+    ChangeSet changes;
+    changes.add_key(std::string("a\"b\\c\n\0d", 8));
+    EXPECT_EQ(changes.payload(8000), R"({"rows":[["a\"b\\c\u000a\u0000d"]]})");
+}
+
+TEST_F(ChangeSetTest, PayloadIsSummarizedToFit) {
+    ChangeSet changes(1000);
+    for (int i = 0; i < 50; ++i) {
+        changes.add({"group" + std::to_string(i % 2), "user" + std::to_string(i)});
+    }
+    EXPECT_GT(changes.payload(8000).size(), 100u);
+
+    std::string payload = changes.payload(100);
+    EXPECT_EQ(payload, R"({"rows":[["group0"],["group1"]]})");
+    EXPECT_EQ(changes.payload(10), R"({"all":true})");
+
+    // Summarizing for the payload leaves the set itself alone
+    EXPECT_EQ(changes.entries().size(), 50u);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "level_pivot/group_counter.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <filesystem>
+#include <unistd.h>
+
+using namespace level_pivot;
+
+class GroupCounterTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+    KeyParser parser_{"users##{group}##{id}##{attr}"};
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_group_counter_test_" +
+                        std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+
+        // admins: 2 rows, staff: 3 rows; rows have 1 to 3 attrs
+        connection_->put("users##admins##u1##email", "a@x");
+        connection_->put("users##admins##u1##name", "Alice");
+        connection_->put("users##admins##u2##name", "Bob");
+        connection_->put("users##staff##u3##a", "1");
+        connection_->put("users##staff##u3##b", "2");
+        connection_->put("users##staff##u3##c", "3");
+        connection_->put("users##staff##u4##name", "Dan");
+        connection_->put("users##staff##u5##name", "Eve");
+        connection_->put("users##bad", "not a row");
+        connection_->put("other##x##y##z", "other table");
+    }
+
+    void TearDown() override {
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    std::vector<std::pair<std::string, int64_t>> count(
+            size_t group_captures, const std::vector<KeyRange>& ranges) {
+        GroupCounter counter(parser_, connection_, group_captures);
+        counter.begin_scan(ranges);
+        std::vector<std::pair<std::string, int64_t>> groups;
+        while (const GroupCount* group = counter.next_group()) {
+            std::string name;
+            for (const auto& value : group->group_values) {
+                name += value + "/";
+            }
+            groups.emplace_back(name, group->count);
+        }
+        return groups;
+    }
+};
+
+TEST_F(GroupCounterTest, CountsRowsNotKeys) {
+    auto groups = count(0, build_identity_ranges(parser_, {}));
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0].second, 5);
+}
+
+TEST_F(GroupCounterTest, GroupsByLeadingCapture) {
+    auto groups = count(1, build_identity_ranges(parser_, {}));
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0], std::make_pair(std::string("admins/"), int64_t(2)));
+    EXPECT_EQ(groups[1], std::make_pair(std::string("staff/"), int64_t(3)));
+}
+
+TEST_F(GroupCounterTest, GroupsByEveryCapture) {
+    auto groups = count(2, build_identity_ranges(parser_, {}));
+    ASSERT_EQ(groups.size(), 5u);
+    EXPECT_EQ(groups[2], std::make_pair(std::string("staff/u3/"), int64_t(1)));
+}
+
+TEST_F(GroupCounterTest, CountsWithinRanges) {
+    IdentityConstraint staff;
+    staff.values = {"staff"};
+    auto groups = count(0, build_identity_ranges(parser_, {staff}));
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0].second, 3);
+
+    IdentityConstraint ids;
+    ids.values = {"u1", "u4", "u9"};
+    IdentityConstraint both;
+    both.values = {"admins", "staff"};
+    groups = count(1, build_identity_ranges(parser_, {both, ids}));
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].second, 1);
+    EXPECT_EQ(groups[1].second, 1);
+}
+
+TEST_F(GroupCounterTest, EmptyScanStillHasTheUngroupedRow) {
+    IdentityConstraint nobody;
+    nobody.values = {"nobody"};
+    auto ranges = build_identity_ranges(parser_, {nobody});
+
+    auto groups = count(0, ranges);
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0].second, 0);
+
+    EXPECT_TRUE(count(1, ranges).empty());
+}
+
+TEST_F(GroupCounterTest, SeeksPastWideRows) {
+    GroupCounter counter(parser_, connection_, 0);
+    counter.begin_scan(build_identity_ranges(parser_, {}));
+    ASSERT_NE(counter.next_group(), nullptr);
+    EXPECT_EQ(counter.stats().rows_counted, 5u);
+    // u1 and u3 are still inside the row after one next()
+    EXPECT_EQ(counter.stats().seeks, 2u);
+    EXPECT_EQ(counter.next_group(), nullptr);
+}
+
+TEST_F(GroupCounterTest, TrailingCapturesStepThroughKeys) {
+    KeyParser trailing("t##{attr}##{id}");
+    connection_->put("t##name##1", "a");
+    connection_->put("t##name##2", "b");
+
+    GroupCounter counter(trailing, connection_, 0);
+    counter.begin_scan({prefix_range("t##")});
+    const GroupCount* group = counter.next_group();
+    ASSERT_NE(group, nullptr);
+    EXPECT_EQ(group->count, 2);
+    EXPECT_EQ(counter.stats().seeks, 0u);
+}
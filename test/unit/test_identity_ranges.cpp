@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "level_pivot/identity_ranges.hpp"
+
+using namespace level_pivot;
+
+// build_identity_ranges unit tests (no LevelDB needed)
+
+class IdentityRangesTest : public ::testing::Test {
+protected:
+    KeyParser parser{"users##{group}##{id}##{attr}"};
+
+    static IdentityConstraint values(std::vector<std::string> v) {
+        IdentityConstraint c;
+        c.values = std::move(v);
+        return c;
+    }
+
+    static IdentityConstraint bounds(std::optional<std::string> lower,
+                                     std::optional<std::string> upper) {
+        IdentityConstraint c;
+        c.lower = std::move(lower);
+        c.upper = std::move(upper);
+        return c;
+    }
+
+    // True if some range contains key
+    static bool covered(const std::vector<KeyRange>& ranges, const std::string& key) {
+        for (const auto& r : ranges) {
+            if (key >= r.start && (r.end.empty() || key < r.end)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+TEST_F(IdentityRangesTest, NoConstraintsScansPatternPrefix) {
+    auto ranges = build_identity_ranges(parser, {});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], (KeyRange{"users##", "users#$"}));
+}
+
+TEST_F(IdentityRangesTest, EqualityMatchesPrefixScan) {
+    auto ranges = build_identity_ranges(parser, {values({"admins"})});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], prefix_range("users##admins##"));
+}
+
+TEST_F(IdentityRangesTest, InListBecomesSortedPointRanges) {
+    auto ranges = build_identity_ranges(parser, {values({"staff", "admins", "staff"})});
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0], prefix_range("users##admins##"));
+    EXPECT_EQ(ranges[1], prefix_range("users##staff##"));
+}
+
+TEST_F(IdentityRangesTest, InListsMultiply) {
+    auto ranges = build_identity_ranges(parser, {values({"a", "b"}), values({"1", "2"})});
+    ASSERT_EQ(ranges.size(), 4u);
+    EXPECT_EQ(ranges[0], prefix_range("users##a##1##"));
+    EXPECT_EQ(ranges[3], prefix_range("users##b##2##"));
+}
+
+TEST_F(IdentityRangesTest, RangeCapFallsBackToShorterPrefixes) {
+    auto ranges = build_identity_ranges(parser, {values({"a", "b"}), values({"1", "2"})}, 3);
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0], prefix_range("users##a##"));
+    EXPECT_EQ(ranges[1], prefix_range("users##b##"));
+}
+
+TEST_F(IdentityRangesTest, NonLeadingEqualityUsesPatternPrefix) {
+    auto ranges = build_identity_ranges(parser, {IdentityConstraint{}, values({"user001"})});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], prefix_range("users##"));
+}
+
+TEST_F(IdentityRangesTest, BoundsNarrowAfterEquality) {
+    auto ranges = build_identity_ranges(parser, {values({"admins"}), bounds("u2", "u5")});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].start, "users##admins##u2");
+
+    EXPECT_TRUE(covered(ranges, "users##admins##u2##name"));
+    EXPECT_TRUE(covered(ranges, "users##admins##u3##name"));
+    EXPECT_TRUE(covered(ranges, "users##admins##u5##zzz"));
+    EXPECT_FALSE(covered(ranges, "users##admins##u1##name"));
+    EXPECT_FALSE(covered(ranges, "users##admins##u6##name"));
+    EXPECT_FALSE(covered(ranges, "users##staff##u3##name"));
+}
+
+TEST_F(IdentityRangesTest, UpperBoundCoversPrefixesOfBound) {
+    // "a" <= "a!" but its keys ("a##...") sort after "a!"
+    auto ranges = build_identity_ranges(parser, {bounds(std::nullopt, std::string("a!"))});
+    EXPECT_TRUE(covered(ranges, "users##a##name"));
+    EXPECT_TRUE(covered(ranges, "users##a!##name"));
+    EXPECT_TRUE(covered(ranges, "users##A##name"));
+    EXPECT_FALSE(covered(ranges, "users##b##name"));
+}
+
+TEST_F(IdentityRangesTest, ValuesFilteredByBounds) {
+    IdentityConstraint c = values({"a", "m", "z"});
+    c.lower = "b";
+    auto ranges = build_identity_ranges(parser, {c});
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0], prefix_range("users##m##"));
+    EXPECT_EQ(ranges[1], prefix_range("users##z##"));
+}
+
+TEST_F(IdentityRangesTest, ContradictionScansNothing) {
+    EXPECT_TRUE(build_identity_ranges(parser, {bounds("m", "c")}).empty());
+
+    IdentityConstraint c = values({"a"});
+    c.lower = "b";
+    EXPECT_TRUE(build_identity_ranges(parser, {c}).empty());
+}
+
+TEST_F(IdentityRangesTest, PrefixNarrowsToValueRange) {
+    IdentityConstraint c;
+    c.prefix = "adm";
+    auto ranges = build_identity_ranges(parser, {c});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], (KeyRange{"users##adm", "users##adn"}));
+    EXPECT_TRUE(covered(ranges, "users##adm##u1##name"));
+    EXPECT_TRUE(covered(ranges, "users##admins##u1##name"));
+    EXPECT_FALSE(covered(ranges, "users##ad##u1##name"));
+    EXPECT_FALSE(covered(ranges, "users##staff##u1##name"));
+}
+
+TEST_F(IdentityRangesTest, PrefixCombinesWithBoundsAndValues) {
+    IdentityConstraint id;
+    id.prefix = "u";
+    id.lower = "u5";
+    auto ranges = build_identity_ranges(parser, {values({"a"}), id});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], (KeyRange{"users##a##u5", "users##a##v"}));
+
+    IdentityConstraint group = values({"admins", "staff", "adm"});
+    group.prefix = "adm";
+    ranges = build_identity_ranges(parser, {group});
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0], prefix_range("users##adm##"));
+    EXPECT_EQ(ranges[1], prefix_range("users##admins##"));
+}
+
+TEST_F(IdentityRangesTest, PrefixSelectsExactlyUnlessItHoldsTheDelimiter) {
+    EXPECT_TRUE(prefix_selects_exactly(parser.pattern(), 0, "adm"));
+    EXPECT_TRUE(prefix_selects_exactly(parser.pattern(), 1, ""));
+    // "a#" also covers the keys of value "a", whose "##" follows right away
+    EXPECT_FALSE(prefix_selects_exactly(parser.pattern(), 0, "a#"));
+    EXPECT_FALSE(prefix_selects_exactly(parser.pattern(), 2, "a"));
+
+    KeyParser trailing("{attr}##{id}");
+    EXPECT_FALSE(prefix_selects_exactly(trailing.pattern(), 0, "a"));
+}
+
+TEST_F(IdentityRangesTest, CapturesAfterAttrAreIgnored) {
+    KeyParser trailing("{attr}##{id}");
+    auto ranges = build_identity_ranges(trailing, {values({"x"})});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0], (KeyRange{"", ""}));
+}
+
+TEST_F(IdentityRangesTest, PointIdentitiesNeedEveryCapture) {
+    EXPECT_FALSE(build_point_identities(parser, {values({"a"})}).has_value());
+    EXPECT_FALSE(build_point_identities(parser, {values({"a"}), bounds("x", "y")}).has_value());
+
+    auto identities = build_point_identities(parser, {values({"b", "a"}), values({"1", "1"})});
+    ASSERT_TRUE(identities.has_value());
+    ASSERT_EQ(identities->size(), 2u);
+    EXPECT_EQ((*identities)[0], (std::vector<std::string>{"a", "1"}));
+    EXPECT_EQ((*identities)[1], (std::vector<std::string>{"b", "1"}));
+}
+
+TEST_F(IdentityRangesTest, PointIdentitiesRespectBoundsAndCap) {
+    IdentityConstraint id = values({"1", "5", "9"});
+    id.upper = "5";
+    auto identities = build_point_identities(parser, {values({"a"}), id});
+    ASSERT_TRUE(identities.has_value());
+    EXPECT_EQ(identities->size(), 2u);
+
+    EXPECT_FALSE(build_point_identities(parser, {values({"a", "b"}), values({"1", "2"})}, 3)
+                     .has_value());
+}
+
+TEST_F(IdentityRangesTest, ClipKeepsOnlyTheShardsPart) {
+    std::vector<KeyRange> ranges = {{"a", "c"}, {"e", "g"}, {"x", ""}};
+
+    EXPECT_EQ(clip_key_ranges(ranges, "", ""), ranges);
+    EXPECT_EQ(clip_key_ranges(ranges, "b", "f"),
+              (std::vector<KeyRange>{{"b", "c"}, {"e", "f"}}));
+    EXPECT_EQ(clip_key_ranges(ranges, "c", "e"), std::vector<KeyRange>{});
+    EXPECT_EQ(clip_key_ranges(ranges, "f", ""),
+              (std::vector<KeyRange>{{"f", "g"}, {"x", ""}}));
+    EXPECT_EQ(clip_key_ranges(ranges, "", "b"), (std::vector<KeyRange>{{"a", "b"}}));
+    EXPECT_TRUE(clip_key_ranges({}, "a", "b").empty());
+}
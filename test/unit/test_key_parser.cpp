@@ -109,6 +109,17 @@ TEST_F(KeyParserTest, BuildKeyWithMap) {
     EXPECT_EQ(key, "users##admins##user001##name");
 }
 
+TEST_F(KeyParserTest, BuildIntoReusesBuffer) {
+    KeyParser parser("users##{group}##{id}##{attr}");
+
+    std::string key = "leftover contents from a previous, much longer key";
+    parser.build_into(key, {"admins", "user001"}, "email");
+    EXPECT_EQ(key, "users##admins##user001##email");
+
+    parser.build_into(key, {"guests", "user002"}, "name");
+    EXPECT_EQ(key, "users##guests##user002##name");
+}
+
 TEST_F(KeyParserTest, BuildKeyErrorWrongCount) {
     KeyParser parser("users##{group}##{id}##{attr}");
 
@@ -211,3 +222,80 @@ TEST_F(KeyParserTest, CaptureWithSpecialChars) {
     EXPECT_EQ(result->capture_values[0], "admin/special");
     EXPECT_EQ(result->capture_values[1], "user:001");
 }
+
+TEST_F(KeyParserTest, ParseViewMatchesParse) {
+    // parse_view takes the SIMD path for uniform delimiters
+    KeyParser parser("users##{group}##{id}##{attr}");
+
+    auto view = parser.parse_view("users##admins##user001##name");
+    ASSERT_TRUE(view.has_value());
+    EXPECT_EQ(view->capture_values[0], "admins");
+    EXPECT_EQ(view->capture_values[1], "user001");
+    EXPECT_EQ(view->attr_name, "name");
+
+    EXPECT_FALSE(parser.parse_view("users##admins##name").has_value());
+    EXPECT_FALSE(parser.parse_view("groups##admins##user001##name").has_value());
+}
+
+TEST_F(KeyParserTest, ParseViewIntoReusesResult) {
+    // Both the SIMD and generic paths fill the caller's result
+    for (const char* pattern : {"users##{group}##{id}##{attr}",
+                                "this###{arg}__{sub_arg}##pat##{attr}"}) {
+        KeyParser parser(pattern);
+        std::string first = parser.build(std::vector<std::string>{"a", "b"}, "x");
+        std::string second = parser.build(std::vector<std::string>{"ccc", "ddd"}, "yy");
+
+        ParsedKeyView out;
+        ASSERT_TRUE(parser.parse_view_into(first, out));
+        ASSERT_TRUE(parser.parse_view_into(second, out));
+        ASSERT_EQ(out.capture_values.size(), 2u);
+        EXPECT_EQ(out.capture_values[0], "ccc");
+        EXPECT_EQ(out.capture_values[1], "ddd");
+        EXPECT_EQ(out.attr_name, "yy");
+
+        EXPECT_FALSE(parser.parse_view_into("nope", out));
+    }
+}
+
+TEST_F(KeyParserTest, ParseViewNoLiteralPrefix) {
+    KeyParser parser("{tenant}##{id}##{attr}");
+
+    auto view = parser.parse_view("acme##42##status");
+    ASSERT_TRUE(view.has_value());
+    EXPECT_EQ(view->capture_values[0], "acme");
+    EXPECT_EQ(view->capture_values[1], "42");
+    EXPECT_EQ(view->attr_name, "status");
+}
+
+TEST_F(KeyParserTest, PrefixSuccessor) {
+    EXPECT_EQ(KeyParser::prefix_successor("users##"), "users#$");
+    EXPECT_EQ(KeyParser::prefix_successor(std::string("ab\xFF", 3)), "ac");
+    EXPECT_EQ(KeyParser::prefix_successor(std::string("\xFF\xFF", 2)), "");
+    EXPECT_EQ(KeyParser::prefix_successor(""), "");
+}
+
+TEST_F(KeyParserTest, AttrBeforeCapturesParsesInOrder) {
+    KeyParser parser("t##{attr}##{id}");
+    auto result = parser.parse("t##name##1");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->attr_name, "name");
+    EXPECT_EQ(result->capture_values[0], "1");
+}
+
+TEST_F(KeyParserTest, ParseAttrViewChecksRestOfPattern) {
+    KeyParser parser("users##{id}##{attr}##v1");
+    std::string key = "users##42##name##v1";
+    ParsedKeyView full;
+    ASSERT_TRUE(parser.parse_view_into(key, full));
+    size_t attr_pos = static_cast<size_t>(full.attr_name.data() - key.data());
+
+    std::string_view attr;
+    ASSERT_TRUE(parser.parse_attr_view(key, attr_pos, attr));
+    EXPECT_EQ(attr, "name");
+    ASSERT_TRUE(parser.parse_attr_view("users##42##email##v1", attr_pos, attr));
+    EXPECT_EQ(attr, "email");
+
+    EXPECT_FALSE(parser.parse_attr_view("users##42##email##v2", attr_pos, attr));
+    EXPECT_FALSE(parser.parse_attr_view("users##42####v1", attr_pos, attr));
+    EXPECT_FALSE(parser.parse_attr_view("users##4", attr_pos, attr));
+}
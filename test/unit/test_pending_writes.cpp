@@ -0,0 +1,356 @@
+#include <gtest/gtest.h>
+#include "level_pivot/pending_writes.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include "level_pivot/pivot_scanner.hpp"
+#include <leveldb/write_batch.h>
+#include <algorithm>
+#include <filesystem>
+
+using namespace level_pivot;
+
+// Transaction write buffering tests (need LevelDB)
+
+class PendingWritesTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_pending_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+
+        connection_->put("b", "db-b");
+        connection_->put("d", "db-d");
+        connection_->put("f", "db-f");
+    }
+
+    void TearDown() override {
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    std::vector<std::string> forward() {
+        std::vector<std::string> out;
+        auto iter = connection_->iterator();
+        for (iter.seek_to_first(); iter.valid(); iter.next()) {
+            out.push_back(iter.key() + "=" + iter.value());
+        }
+        return out;
+    }
+
+    std::vector<std::string> backward() {
+        std::vector<std::string> out;
+        auto iter = connection_->iterator();
+        for (iter.seek_to_last(); iter.valid(); iter.prev()) {
+            out.push_back(iter.key() + "=" + iter.value());
+        }
+        return out;
+    }
+};
+
+TEST_F(PendingWritesTest, LaterWritesReplaceEarlierOnes) {
+    PendingWrites pending;
+    pending.put("k", "v1");
+    pending.put("k", "longer");
+    EXPECT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending.bytes(), 1 + 6 + PendingWrites::ENTRY_OVERHEAD);
+
+    pending.del("k");
+    ASSERT_NE(pending.find("k"), nullptr);
+    EXPECT_FALSE(pending.find("k")->has_value());
+    EXPECT_EQ(pending.bytes(), 1 + PendingWrites::ENTRY_OVERHEAD);
+    EXPECT_EQ(pending.find("other"), nullptr);
+
+    leveldb::WriteBatch batch;
+    batch.Put("a", "1");
+    batch.Delete("b");
+    EXPECT_EQ(PendingWrites::batch_bytes(batch), 3 + 2 * PendingWrites::ENTRY_OVERHEAD);
+    pending.apply(batch);
+    EXPECT_EQ(pending.size(), 3u);
+
+    pending.clear();
+    EXPECT_TRUE(pending.empty());
+    EXPECT_EQ(pending.bytes(), 0u);
+}
+
+TEST_F(PendingWritesTest, ReadsSeePendingWritesBeforeCommit) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    ASSERT_TRUE(connection_->buffering_writes());
+
+    connection_->put("a", "new-a");
+    connection_->put("d", "new-d");
+    connection_->del("f");
+    connection_->del("z");
+
+    EXPECT_EQ(connection_->get("a"), "new-a");
+    EXPECT_EQ(connection_->get("b"), "db-b");
+    EXPECT_EQ(connection_->get("d"), "new-d");
+    EXPECT_FALSE(connection_->get("f").has_value());
+
+    std::vector<std::string> expected = {"a=new-a", "b=db-b", "d=new-d"};
+    EXPECT_EQ(forward(), expected);
+    std::reverse(expected.begin(), expected.end());
+    EXPECT_EQ(backward(), expected);
+
+    // Nothing reached LevelDB yet
+    EXPECT_FALSE(connection_->get("a", nullptr).has_value());
+    EXPECT_EQ(connection_->get("f", nullptr), "db-f");
+}
+
+TEST_F(PendingWritesTest, IteratorSeeksAndTurnsAround) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->put("c", "new-c");
+    connection_->del("d");
+
+    auto iter = connection_->iterator();
+    iter.seek("c");
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "c");
+    iter.next();
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "f");
+    iter.prev();
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "c");
+    iter.prev();
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "b");
+    iter.next();
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "c");
+
+    iter.seek("d");
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), "f");
+}
+
+TEST_F(PendingWritesTest, OpenIteratorsKeepTheirView) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->put("a", "new-a");
+
+    auto iter = connection_->iterator();
+    connection_->put("c", "new-c");
+    connection_->del("a");
+
+    std::vector<std::string> keys;
+    for (iter.seek_to_first(); iter.valid(); iter.next()) {
+        keys.push_back(iter.key());
+    }
+    EXPECT_EQ(keys, (std::vector<std::string>{"a", "b", "d", "f"}));
+    EXPECT_EQ(forward(), (std::vector<std::string>{"b=db-b", "c=new-c", "d=db-d", "f=db-f"}));
+}
+
+TEST_F(PendingWritesTest, CommitWritesOnceAndStopsBuffering) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    auto batch = connection_->create_batch();
+    batch.put("a", "new-a");
+    batch.del("b");
+    batch.commit();
+    connection_->put("a", "newer-a");
+
+    EXPECT_EQ(connection_->commit_pending_writes(), 2u);
+    EXPECT_FALSE(connection_->buffering_writes());
+    EXPECT_EQ(connection_->get("a", nullptr), "newer-a");
+    EXPECT_FALSE(connection_->get("b", nullptr).has_value());
+
+    connection_->put("z", "direct");
+    EXPECT_EQ(connection_->get("z", nullptr), "direct");
+}
+
+TEST_F(PendingWritesTest, DiscardDropsEverything) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->put("a", "new-a");
+    connection_->del("b");
+    connection_->discard_pending_writes();
+
+    EXPECT_FALSE(connection_->buffering_writes());
+    EXPECT_EQ(forward(), (std::vector<std::string>{"b=db-b", "d=db-d", "f=db-f"}));
+    EXPECT_EQ(connection_->commit_pending_writes(), 0u);
+}
+
+TEST_F(PendingWritesTest, FailRejectsWritesPastTheLimit) {
+    size_t one_write = 1 + 3 + PendingWrites::ENTRY_OVERHEAD;
+    connection_->buffer_writes(2 * one_write, OverflowAction::FAIL);
+    connection_->put("x", "111");
+    connection_->put("y", "222");
+    EXPECT_THROW(connection_->put("z", "333"), LevelPivotError);
+
+    // The rejected write left the pending writes alone
+    EXPECT_FALSE(connection_->get("z").has_value());
+    EXPECT_EQ(connection_->commit_pending_writes(), 2u);
+    EXPECT_EQ(connection_->spill_count(), 0u);
+}
+
+TEST_F(PendingWritesTest, SpillWritesThroughAndKeepsBuffering) {
+    size_t one_write = 1 + 3 + PendingWrites::ENTRY_OVERHEAD;
+    connection_->buffer_writes(2 * one_write, OverflowAction::SPILL);
+    connection_->put("x", "111");
+    connection_->put("y", "222");
+    connection_->put("z", "333");
+
+    EXPECT_EQ(connection_->spill_count(), 1u);
+    EXPECT_EQ(connection_->get("x", nullptr), "111");
+    EXPECT_EQ(connection_->get("y", nullptr), "222");
+    EXPECT_FALSE(connection_->get("z", nullptr).has_value());
+    EXPECT_EQ(connection_->get("z"), "333");
+
+    // Too big to buffer at all: straight to LevelDB
+    connection_->put("big", std::string(3 * one_write, 'v'));
+    EXPECT_TRUE(connection_->get("big", nullptr).has_value());
+    EXPECT_EQ(connection_->commit_pending_writes(), 0u);
+    EXPECT_EQ(connection_->get("z", nullptr), "333");
+}
+
+TEST_F(PendingWritesTest, BufferedWriteMovesSnapshotEpoch) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->acquire_snapshot();
+    uint64_t epoch = connection_->snapshot_epoch();
+    connection_->put("a", "new-a");
+    EXPECT_NE(connection_->snapshot_epoch(), epoch);
+    EXPECT_NE(connection_->snapshot_epoch(), 0u);
+
+    // A pinned snapshot hides LevelDB's later writes but not pending ones
+    EXPECT_EQ(connection_->get("a"), "new-a");
+    connection_->release_snapshot();
+    connection_->discard_pending_writes();
+}
+
+TEST_F(PendingWritesTest, SpillKeepsWritesVisibleUnderPinnedSnapshot) {
+    size_t one_write = 1 + 3 + PendingWrites::ENTRY_OVERHEAD;
+    connection_->buffer_writes(2 * one_write, OverflowAction::SPILL);
+    connection_->acquire_snapshot();
+    connection_->put("x", "111");
+    connection_->put("y", "222");
+    connection_->put("z", "333");
+    ASSERT_EQ(connection_->spill_count(), 1u);
+
+    // x and y left the overlay for LevelDB; the snapshot was retaken
+    EXPECT_EQ(connection_->get("x"), "111");
+    EXPECT_EQ(connection_->get("y"), "222");
+    EXPECT_EQ(connection_->get("z"), "333");
+    EXPECT_EQ(forward(), (std::vector<std::string>{
+        "b=db-b", "d=db-d", "f=db-f", "x=111", "y=222", "z=333"}));
+    connection_->release_snapshot();
+    connection_->discard_pending_writes();
+}
+
+TEST_F(PendingWritesTest, RollbackRestoresKeysAsOfTheSavepoint) {
+    PendingWrites pending;
+    pending.put("a", "1");
+    pending.del("b");
+    size_t bytes = pending.bytes();
+
+    pending.savepoint(2);
+    pending.put("a", "changed");
+    pending.put("b", "back");
+    pending.put("c", "new");
+    pending.put("c", "newer");
+    pending.rollback_savepoint(2);
+
+    EXPECT_EQ(pending.size(), 2u);
+    EXPECT_EQ(*pending.find("a"), std::optional<std::string>("1"));
+    EXPECT_EQ(*pending.find("b"), std::nullopt);
+    EXPECT_EQ(pending.find("c"), nullptr);
+    EXPECT_EQ(pending.bytes(), bytes);
+    EXPECT_EQ(pending.savepoint_count(), 0u);
+}
+
+TEST_F(PendingWritesTest, ReleasedSavepointsJoinTheEnclosingLevel) {
+    PendingWrites pending;
+    pending.put("a", "1");
+
+    // Level 2 wrote nothing before level 3 began
+    pending.savepoint(3);
+    pending.put("a", "3");
+    pending.release_savepoint(3);
+    EXPECT_EQ(pending.savepoint_count(), 1u);
+
+    pending.put("b", "2");
+    pending.savepoint(3);
+    pending.put("b", "3");
+    pending.release_savepoint(3);
+    EXPECT_EQ(pending.savepoint_count(), 1u);
+
+    // Rolling back level 2 undoes what level 3 kept, to level 2's start
+    pending.rollback_savepoint(2);
+    EXPECT_EQ(pending.size(), 1u);
+    EXPECT_EQ(*pending.find("a"), std::optional<std::string>("1"));
+
+    // Released into the transaction itself, writes just stay
+    pending.savepoint(2);
+    pending.put("c", "2");
+    pending.release_savepoint(2);
+    EXPECT_EQ(pending.savepoint_count(), 0u);
+    pending.rollback_savepoint(2);
+    EXPECT_EQ(pending.size(), 2u);
+}
+
+TEST_F(PendingWritesTest, ConnectionRollsBackSavepoints) {
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->put("b", "pending-b");
+
+    connection_->savepoint(2);
+    connection_->put("b", "sub-b");
+    connection_->del("d");
+    connection_->put("e", "sub-e");
+    EXPECT_FALSE(connection_->get("d").has_value());
+    connection_->rollback_savepoint(2);
+
+    EXPECT_EQ(forward(), (std::vector<std::string>{"b=pending-b", "d=db-d", "f=db-f"}));
+    EXPECT_EQ(connection_->commit_pending_writes(), 1u);
+    EXPECT_EQ(connection_->get("b", nullptr), "pending-b");
+
+    // Not buffering: savepoints are no-ops
+    connection_->savepoint(2);
+    connection_->rollback_savepoint(2);
+    EXPECT_FALSE(connection_->buffering_writes());
+}
+
+TEST_F(PendingWritesTest, RollbackAfterSpillRestoresEarlierPendingValues) {
+    size_t one_write = 1 + 3 + PendingWrites::ENTRY_OVERHEAD;
+    connection_->buffer_writes(2 * one_write, OverflowAction::SPILL);
+    connection_->put("x", "111");
+
+    connection_->savepoint(2);
+    connection_->put("x", "222");
+    connection_->put("y", "222");
+    connection_->put("z", "333");  // Spills x=222 and y
+    ASSERT_EQ(connection_->spill_count(), 1u);
+    connection_->rollback_savepoint(2);
+
+    // x goes back to its pending value; y was spilled and stays
+    EXPECT_EQ(connection_->get("x"), "111");
+    EXPECT_FALSE(connection_->get("z").has_value());
+    EXPECT_EQ(connection_->get("y"), "222");
+    connection_->commit_pending_writes();
+    EXPECT_EQ(connection_->get("x", nullptr), "111");
+}
+
+TEST_F(PendingWritesTest, PivotScanSeesPendingRows) {
+    std::vector<ColumnDef> columns = {
+        {"id", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+    };
+    Projection projection(KeyPattern("users##{id}##{attr}"), std::move(columns));
+    connection_->put("users##1##name", "Alice");
+    connection_->put("users##2##name", "Bob");
+
+    connection_->buffer_writes(1 << 20, OverflowAction::FAIL);
+    connection_->del("users##1##name");
+    connection_->put("users##3##name", "Carol");
+
+    PivotScanner scanner(projection, connection_);
+    scanner.begin_scan();
+    std::vector<std::string> names;
+    while (auto row = scanner.next_row()) {
+        names.emplace_back(row->attr_value(0));
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"Bob", "Carol"}));
+    connection_->discard_pending_writes();
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "level_pivot/pivot_scanner.hpp"
+#include "level_pivot/projection.hpp"
+
+using namespace level_pivot;
+
+// PivotRow unit tests (header-only, no LevelDB needed)
+
+class PivotRowTest : public ::testing::Test {};
+
+TEST_F(PivotRowTest, ResetLeavesAttrsAbsent) {
+    PivotRow row(2, 3);
+    EXPECT_EQ(row.identity_count(), 2u);
+    EXPECT_EQ(row.attr_slot_count(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_FALSE(row.has_attr(i));
+    }
+}
+
+TEST_F(PivotRowTest, StoresIdentityAndAttrs) {
+    PivotRow row(2, 3);
+    row.set_identity(0, "admins");
+    row.set_identity(1, "user001");
+    row.set_attr(2, "alice@example.com");
+
+    EXPECT_EQ(row.identity_value(0), "admins");
+    EXPECT_EQ(row.identity_value(1), "user001");
+    EXPECT_FALSE(row.has_attr(0));
+    EXPECT_TRUE(row.has_attr(2));
+    EXPECT_EQ(row.attr_value(2), "alice@example.com");
+}
+
+TEST_F(PivotRowTest, EmptyValueIsPresent) {
+    PivotRow row(1, 1);
+    row.set_attr(0, "");
+    EXPECT_TRUE(row.has_attr(0));
+    EXPECT_EQ(row.attr_value(0), "");
+}
+
+TEST_F(PivotRowTest, ValuesSurviveArenaGrowth) {
+    PivotRow row(1, 20);
+    row.set_identity(0, "id");
+    for (size_t i = 0; i < 20; ++i) {
+        row.set_attr(i, std::string(100, static_cast<char>('a' + i)));
+    }
+    EXPECT_EQ(row.identity_value(0), "id");
+    for (size_t i = 0; i < 20; ++i) {
+        EXPECT_EQ(row.attr_value(i), std::string(100, static_cast<char>('a' + i)));
+    }
+}
+
+TEST_F(PivotRowTest, ResetClearsPreviousRow) {
+    PivotRow row(1, 2);
+    row.set_identity(0, "first");
+    row.set_attr(0, "x");
+
+    row.reset(1, 2);
+    row.set_identity(0, "second");
+    EXPECT_EQ(row.identity_value(0), "second");
+    EXPECT_FALSE(row.has_attr(0));
+}
+
+TEST_F(PivotRowTest, IdentityMatchesCaptures) {
+    PivotRow row(2, 0);
+    row.set_identity(0, "admins");
+    row.set_identity(1, "user001");
+
+    std::vector<std::string_view> same = {"admins", "user001"};
+    std::vector<std::string_view> other = {"admins", "user002"};
+    std::vector<std::string_view> shorter = {"admins"};
+    EXPECT_TRUE(row.identity_matches(same));
+    EXPECT_FALSE(row.identity_matches(other));
+    EXPECT_FALSE(row.identity_matches(shorter));
+}
+
+TEST_F(PivotRowTest, EqualityDistinguishesAbsentFromEmpty) {
+    PivotRow a(1, 1);
+    PivotRow b(1, 1);
+    a.set_identity(0, "id");
+    b.set_identity(0, "id");
+    EXPECT_EQ(a, b);
+
+    a.set_attr(0, "");
+    EXPECT_FALSE(a == b);
+}
+
+// Projection attr slot mapping
+
+TEST_F(PivotRowTest, ProjectionMapsColumnsToAttrSlots) {
+    KeyPattern pattern("users##{group}##{id}##{attr}");
+    std::vector<ColumnDef> columns = {
+        {"group", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"id", PgType::TEXT, 3, true},
+        {"email", PgType::TEXT, 4, false},
+    };
+    Projection projection(pattern, columns);
+
+    EXPECT_EQ(projection.column_to_attr_index(0), -1);
+    EXPECT_EQ(projection.column_to_attr_index(1), 0);
+    EXPECT_EQ(projection.column_to_attr_index(2), -1);
+    EXPECT_EQ(projection.column_to_attr_index(3), 1);
+
+    EXPECT_EQ(projection.attr_column_index(std::string_view("name")), 0);
+    EXPECT_EQ(projection.attr_column_index(std::string_view("email")), 1);
+    EXPECT_EQ(projection.attr_column_index(std::string_view("group")), -1);
+    EXPECT_EQ(projection.attr_column_index(std::string_view("missing")), -1);
+}
+
+TEST_F(PivotRowTest, ProjectionNeededColumns) {
+    KeyPattern pattern("users##{group}##{id}##{attr}");
+    std::vector<ColumnDef> columns = {
+        {"group", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"id", PgType::TEXT, 3, true},
+        {"email", PgType::TEXT, 4, false},
+    };
+    Projection projection(pattern, columns);
+
+    // Everything is needed until the scan says otherwise
+    for (size_t i = 0; i < columns.size(); ++i) {
+        EXPECT_TRUE(projection.column_needed(i));
+    }
+    EXPECT_TRUE(projection.attr_slot_needed(0));
+    EXPECT_TRUE(projection.attr_slot_needed(1));
+
+    // Unknown attnums (system or dropped columns) are ignored
+    projection.set_needed_columns({1, 4, 99});
+    EXPECT_TRUE(projection.column_needed(0));
+    EXPECT_FALSE(projection.column_needed(1));
+    EXPECT_FALSE(projection.column_needed(2));
+    EXPECT_TRUE(projection.column_needed(3));
+    EXPECT_FALSE(projection.attr_slot_needed(0));
+    EXPECT_TRUE(projection.attr_slot_needed(1));
+
+    projection.set_needed_columns({});
+    EXPECT_FALSE(projection.column_needed(0));
+    EXPECT_FALSE(projection.attr_slot_needed(1));
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "level_pivot/pivot_scanner.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <algorithm>
+#include <filesystem>
+
+using namespace level_pivot;
+
+// PivotScanner row assembly tests (need LevelDB)
+
+class PivotScannerTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_scanner_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+    }
+
+    void TearDown() override {
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    // Rows as "identity,...|attr,..." with absent attrs as "-"
+    static std::vector<std::string> scan(PivotScanner& scanner) {
+        std::vector<std::string> rows;
+        while (const PivotRow* row = scanner.next_row()) {
+            std::string text;
+            for (size_t i = 0; i < row->identity_count(); ++i) {
+                text += std::string(row->identity_value(i)) + ",";
+            }
+            text += "|";
+            for (size_t i = 0; i < row->attr_slot_count(); ++i) {
+                text += row->has_attr(i) ? std::string(row->attr_value(i)) : "-";
+                text += ",";
+            }
+            rows.push_back(text);
+        }
+        return rows;
+    }
+};
+
+TEST_F(PivotScannerTest, RowsEndWhereKeyPrefixChanges) {
+    std::vector<ColumnDef> columns = {
+        {"group", PgType::TEXT, 1, true},
+        {"id", PgType::TEXT, 2, true},
+        {"name", PgType::TEXT, 3, false},
+        {"email", PgType::TEXT, 4, false},
+    };
+    Projection projection(KeyPattern("users##{group}##{id}##{attr}"), std::move(columns));
+
+    // "u1" is a byte prefix of "u10", and the attr "x##y" holds the
+    // separator; neither may merge or split rows
+    connection_->put("users##a##u1##email", "e1");
+    connection_->put("users##a##u1##name", "n1");
+    connection_->put("users##a##u1##x##y", "extra");
+    connection_->put("users##a##u10##name", "n10");
+    connection_->put("users##a##u2##email", "e2");
+    connection_->put("users##b##u2##name", "n2");
+
+    PivotScanner scanner(projection, connection_);
+    std::vector<std::string> expected = {
+        "a,u1,|n1,e1,", "a,u10,|n10,-,", "a,u2,|-,e2,", "b,u2,|n2,-,"};
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner), expected);
+    EXPECT_EQ(scanner.stats().keys_scanned, 6u);
+    EXPECT_EQ(scanner.stats().keys_skipped, 0u);
+
+    std::reverse(expected.begin(), expected.end());
+    scanner.set_reverse(true);
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner), expected);
+}
+
+TEST_F(PivotScannerTest, KeysSharingThePrefixMustMatchTheRest) {
+    std::vector<ColumnDef> columns = {
+        {"id", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"email", PgType::TEXT, 3, false},
+    };
+    Projection projection(KeyPattern("t##{id}##{attr}##v1"), std::move(columns));
+
+    connection_->put("t##1##email##v1", "e1");
+    connection_->put("t##1##email##v2", "stale");
+    connection_->put("t##1##name##v1", "n1");
+    connection_->put("t##2##name##v1", "n2");
+
+    PivotScanner scanner(projection, connection_);
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner), (std::vector<std::string>{"1,|n1,e1,", "2,|n2,-,"}));
+    EXPECT_EQ(scanner.stats().keys_skipped, 1u);
+}
+
+TEST_F(PivotScannerTest, CapturesAfterAttrCompareValues) {
+    std::vector<ColumnDef> columns = {
+        {"id", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+    };
+    Projection projection(KeyPattern("t##{attr}##{id}"), std::move(columns));
+
+    connection_->put("t##name##1", "n1");
+    connection_->put("t##name##2", "n2");
+
+    PivotScanner scanner(projection, connection_);
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner), (std::vector<std::string>{"1,|n1,", "2,|n2,"}));
+}
+
+TEST_F(PivotScannerTest, TimingAndBytesRead) {
+    std::vector<ColumnDef> columns = {
+        {"id", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"email", PgType::TEXT, 3, false},
+    };
+    Projection projection(KeyPattern("users##{id}##{attr}"), std::move(columns));
+    connection_->put("users##u1##email", "e1");
+    connection_->put("users##u1##name", "n1");
+    connection_->put("other##u1##name", "x");
+
+    PivotScanner scanner(projection, connection_);
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner).size(), 1u);
+    // Both keys and both values; the other table's key sorts before the range
+    EXPECT_EQ(scanner.stats().bytes_read,
+              std::string("users##u1##email").size() + 2 +
+              std::string("users##u1##name").size() + 2);
+    EXPECT_EQ(scanner.stats().read_ns, 0u);
+    EXPECT_EQ(scanner.stats().parse_ns, 0u);
+
+    scanner.set_timing(true);
+    scanner.begin_scan();
+    EXPECT_EQ(scan(scanner).size(), 1u);
+    EXPECT_GT(scanner.stats().read_ns, 0u);
+    EXPECT_GT(scanner.stats().parse_ns, 0u);
+
+    // Point gets count as reads too
+    scanner.begin_point_lookups({{"u1"}}, PivotScanner::PointLookup::GET);
+    EXPECT_EQ(scan(scanner).size(), 1u);
+    EXPECT_EQ(scanner.stats().gets, 2u);
+    EXPECT_GT(scanner.stats().read_ns, 0u);
+}
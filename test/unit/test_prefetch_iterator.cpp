@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include "level_pivot/connection_manager.hpp"
+#include "level_pivot/pivot_scanner.hpp"
+#include "level_pivot/prefetch_iterator.hpp"
+#include <leveldb/iterator.h>
+#include <cstdio>
+#include <filesystem>
+#include <new>
+#include <vector>
+
+using namespace level_pivot;
+
+// Prefetching iterator tests (need LevelDB)
+
+class PrefetchIteratorTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_prefetch_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+
+        for (int i = 0; i < 500; ++i) {
+            connection_->put(key(i), "v" + std::to_string(i));
+        }
+    }
+
+    void TearDown() override {
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    static std::string key(int i) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "k%04d", i);
+        return buf;
+    }
+
+    static ScanOptions prefetch(size_t batch) {
+        ScanOptions scan;
+        scan.prefetch_batch = batch;
+        return scan;
+    }
+};
+
+TEST_F(PrefetchIteratorTest, ForwardAndBackwardMatchPlainIterator) {
+    for (size_t batch : {1u, 7u, 64u, 1000u}) {
+        auto iter = connection_->iterator(prefetch(batch));
+        int i = 0;
+        for (iter.seek_to_first(); iter.valid(); iter.next(), ++i) {
+            ASSERT_EQ(iter.key(), key(i));
+            ASSERT_EQ(iter.value(), "v" + std::to_string(i));
+        }
+        EXPECT_EQ(i, 500);
+
+        for (iter.seek_to_last(); iter.valid(); iter.prev()) {
+            ASSERT_EQ(iter.key(), key(--i));
+        }
+        EXPECT_EQ(i, 0);
+    }
+}
+
+TEST_F(PrefetchIteratorTest, SeeksInsideAndPastReadBatches) {
+    auto iter = connection_->iterator(prefetch(32));
+    iter.seek(key(10));
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(10));
+
+    // Within what the reader has likely fetched, then far past it
+    iter.seek(key(12) + "x");
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(13));
+    iter.seek(key(400));
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(400));
+
+    // Backwards seeks reposition too
+    iter.seek(key(5));
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(5));
+
+    iter.seek("z");
+    EXPECT_FALSE(iter.valid());
+    iter.seek("");
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key(), key(0));
+}
+
+TEST_F(PrefetchIteratorTest, ChangingDirectionStepsToNeighbour) {
+    auto iter = connection_->iterator(prefetch(16));
+    iter.seek(key(100));
+    for (int i = 0; i < 40; ++i) {
+        iter.next();
+    }
+    ASSERT_EQ(iter.key(), key(140));
+    iter.prev();
+    EXPECT_EQ(iter.key(), key(139));
+    iter.prev();
+    EXPECT_EQ(iter.key(), key(138));
+    iter.next();
+    EXPECT_EQ(iter.key(), key(139));
+
+    iter.seek_to_last();
+    iter.prev();
+    EXPECT_EQ(iter.key(), key(498));
+    iter.next();
+    EXPECT_EQ(iter.key(), key(499));
+    iter.next();
+    EXPECT_FALSE(iter.valid());
+}
+
+TEST_F(PrefetchIteratorTest, ReadsFromIteratorSnapshot) {
+    auto iter = connection_->iterator(prefetch(8));
+    iter.seek_to_first();
+    connection_->put(key(0) + "a", "late");
+
+    int count = 0;
+    for (; iter.valid(); iter.next()) {
+        ++count;
+    }
+    EXPECT_EQ(count, 500);
+}
+
+TEST_F(PrefetchIteratorTest, PivotScanIsUnchanged) {
+    std::vector<ColumnDef> columns = {
+        {"id", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"email", PgType::TEXT, 3, false},
+    };
+    Projection projection(KeyPattern("users##{id}##{attr}"), std::move(columns));
+    for (int i = 0; i < 300; ++i) {
+        connection_->put("users##" + key(i) + "##email", "e" + std::to_string(i));
+        connection_->put("users##" + key(i) + "##name", "n" + std::to_string(i));
+    }
+
+    auto scan_all = [&](const ScanOptions& scan, bool reverse) {
+        PivotScanner scanner(projection, connection_);
+        scanner.set_scan_options(scan);
+        scanner.set_reverse(reverse);
+        scanner.begin_scan();
+        std::vector<std::string> rows;
+        while (const PivotRow* row = scanner.next_row()) {
+            rows.push_back(std::string(row->identity_value(0)) + "=" +
+                           std::string(row->attr_value(0)) + "," +
+                           std::string(row->attr_value(1)));
+        }
+        return rows;
+    };
+
+    for (bool reverse : {false, true}) {
+        auto plain = scan_all(ScanOptions(), reverse);
+        EXPECT_EQ(plain.size(), 300u);
+        EXPECT_EQ(scan_all(prefetch(50), reverse), plain);
+    }
+}
+
+namespace {
+
+/**
+ * Iterates over keys "k0", "k1", ...; reading the value of key fail_at
+ * throws std::bad_alloc, as a batch growing out of memory would
+ */
+class FailingIterator : public leveldb::Iterator {
+public:
+    FailingIterator(int count, int fail_at) : count_(count), fail_at_(fail_at) {}
+
+    bool Valid() const override { return pos_ >= 0 && pos_ < count_; }
+    void SeekToFirst() override { pos_ = 0; key_ = "k0"; }
+    void SeekToLast() override { pos_ = count_ - 1; key_ = "k" + std::to_string(pos_); }
+    void Seek(const leveldb::Slice&) override { SeekToFirst(); }
+    void Next() override { ++pos_; key_ = "k" + std::to_string(pos_); }
+    void Prev() override { --pos_; key_ = "k" + std::to_string(pos_); }
+    leveldb::Slice key() const override { return key_; }
+    leveldb::Slice value() const override {
+        if (pos_ == fail_at_) {
+            throw std::bad_alloc();
+        }
+        return key_;
+    }
+    leveldb::Status status() const override { return leveldb::Status(); }
+
+private:
+    int count_;
+    int fail_at_;
+    int pos_ = -1;
+    std::string key_;
+};
+
+} // namespace
+
+TEST(PrefetchIteratorErrors, ReaderExceptionReachesTheCaller) {
+    // The first batch (16 keys) reads fine; the reader fails in a later one
+    auto iter = make_prefetch_iterator(std::make_unique<FailingIterator>(1000, 100), 64);
+    iter->SeekToFirst();
+    int seen = 0;
+    EXPECT_THROW({
+        for (; iter->Valid(); iter->Next()) {
+            ++seen;
+        }
+    }, std::bad_alloc);
+    EXPECT_GE(seen, 16);
+    EXPECT_LE(seen, 100);
+    EXPECT_FALSE(iter->Valid());
+
+    // The reader stopped cleanly, so the iterator can still be destroyed,
+    // or repositioned
+    iter->SeekToLast();
+    ASSERT_TRUE(iter->Valid());
+    EXPECT_EQ(iter->key().ToString(), "k999");
+}
+
+TEST(PrefetchIteratorErrors, FailureInFirstBatchThrowsFromSeek) {
+    auto iter = make_prefetch_iterator(std::make_unique<FailingIterator>(10, 0), 8);
+    EXPECT_THROW(iter->SeekToFirst(), std::bad_alloc);
+    EXPECT_FALSE(iter->Valid());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "level_pivot/projection_cache.hpp"
+
+using namespace level_pivot;
+
+class ProjectionCacheTest : public ::testing::Test {
+protected:
+    ProjectionCache cache_;
+    int builds_ = 0;
+
+    ProjectionCache::Builder builder() {
+        return [this] {
+            ++builds_;
+            std::vector<ColumnDef> columns = {
+                {"group", PgType::TEXT, 1, true},
+                {"id", PgType::TEXT, 2, true},
+                {"name", PgType::TEXT, 3, false},
+            };
+            return std::make_unique<Projection>(
+                KeyPattern("users##{group}##{id}##{attr}"), std::move(columns));
+        };
+    }
+};
+
+TEST_F(ProjectionCacheTest, ReusesReleasedProjections) {
+    CachedProjection first = cache_.acquire(100, builder());
+    const Projection* built = first.projection.get();
+    cache_.release(100, std::move(first));
+    EXPECT_EQ(cache_.idle_count(100), 1u);
+
+    CachedProjection second = cache_.acquire(100, builder());
+    EXPECT_EQ(second.projection.get(), built);
+    EXPECT_EQ(builds_, 1);
+    EXPECT_EQ(cache_.idle_count(100), 0u);
+}
+
+TEST_F(ProjectionCacheTest, ConcurrentScansGetTheirOwn) {
+    CachedProjection a = cache_.acquire(100, builder());
+    CachedProjection b = cache_.acquire(100, builder());
+    EXPECT_NE(a.projection.get(), b.projection.get());
+    EXPECT_EQ(builds_, 2);
+
+    // Other tables are kept apart
+    CachedProjection other = cache_.acquire(200, builder());
+    cache_.release(200, std::move(other));
+    EXPECT_EQ(cache_.idle_count(100), 0u);
+    EXPECT_EQ(cache_.idle_count(200), 1u);
+}
+
+TEST_F(ProjectionCacheTest, ReleaseRestoresNeededColumns) {
+    CachedProjection cached = cache_.acquire(100, builder());
+    cached.projection->set_needed_columns({1});
+    EXPECT_FALSE(cached.projection->attr_slot_needed(0));
+    cache_.release(100, std::move(cached));
+
+    cached = cache_.acquire(100, builder());
+    EXPECT_TRUE(cached.projection->attr_slot_needed(0));
+}
+
+TEST_F(ProjectionCacheTest, InvalidationDropsStaleProjections) {
+    CachedProjection idle = cache_.acquire(100, builder());
+    CachedProjection in_use = cache_.acquire(100, builder());
+    cache_.release(100, std::move(idle));
+
+    cache_.invalidate(100);
+    EXPECT_EQ(cache_.idle_count(100), 0u);
+
+    // Checked out before the invalidation: not reused
+    cache_.release(100, std::move(in_use));
+    EXPECT_EQ(cache_.idle_count(100), 0u);
+
+    CachedProjection fresh = cache_.acquire(100, builder());
+    EXPECT_EQ(builds_, 3);
+    cache_.release(100, std::move(fresh));
+
+    cache_.clear();
+    EXPECT_EQ(cache_.idle_count(100), 0u);
+}
+
+TEST_F(ProjectionCacheTest, KeepsABoundedNumberIdle) {
+    std::vector<CachedProjection> checked_out;
+    for (size_t i = 0; i < ProjectionCache::MAX_IDLE_PER_TABLE + 2; ++i) {
+        checked_out.push_back(cache_.acquire(100, builder()));
+    }
+    for (auto& cached : checked_out) {
+        cache_.release(100, std::move(cached));
+    }
+    EXPECT_EQ(cache_.idle_count(100), ProjectionCache::MAX_IDLE_PER_TABLE);
+}
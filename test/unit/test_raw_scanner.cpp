@@ -133,6 +133,47 @@ TEST_F(RawScanBoundsTest, IsPastUpperBoundInclusive) {
     EXPECT_TRUE(bounds.is_past_upper_bound("user:201"));
 }
 
+TEST_F(RawScanBoundsTest, AddedBoundsKeepTheTightest) {
+    RawScanBounds bounds;
+    bounds.add_lower_bound("b", true);
+    bounds.add_lower_bound("a", false);
+    EXPECT_EQ(*bounds.lower_bound, "b");
+    bounds.add_lower_bound("b", false);
+    EXPECT_FALSE(bounds.lower_inclusive);
+    bounds.add_lower_bound("b", true);
+    EXPECT_FALSE(bounds.lower_inclusive);
+
+    bounds.add_upper_bound("y", false);
+    bounds.add_upper_bound("z", true);
+    EXPECT_EQ(*bounds.upper_bound, "y");
+    bounds.add_upper_bound("x", true);
+    EXPECT_EQ(*bounds.upper_bound, "x");
+    EXPECT_TRUE(bounds.upper_inclusive);
+}
+
+TEST_F(RawScanBoundsTest, PrefixBounds) {
+    RawScanBounds bounds;
+    bounds.add_prefix("users##admins##");
+    EXPECT_EQ(bounds.seek_start(), "users##admins##");
+    EXPECT_TRUE(bounds.is_within_bounds("users##admins##u1"));
+    EXPECT_TRUE(bounds.is_within_bounds("users##admins##\xFF"));
+    EXPECT_FALSE(bounds.is_within_bounds("users##admins#"));
+    EXPECT_FALSE(bounds.is_within_bounds("users##admins$"));
+    EXPECT_TRUE(bounds.is_past_upper_bound("users##admins#$"));
+
+    // Narrower than an existing range on one side only
+    bounds = RawScanBounds{};
+    bounds.add_upper_bound("users##b", false);
+    bounds.add_prefix("users##");
+    EXPECT_EQ(*bounds.upper_bound, "users##b");
+
+    // Nothing sorts after a 0xFF run, so there is no upper bound
+    bounds = RawScanBounds{};
+    bounds.add_prefix(std::string(2, '\xFF'));
+    EXPECT_FALSE(bounds.upper_bound.has_value());
+    EXPECT_TRUE(bounds.is_within_bounds(std::string(3, '\xFF')));
+}
+
 // RawScanner integration tests (need LevelDB)
 
 class RawScannerTest : public ::testing::Test {
@@ -178,7 +219,7 @@ TEST_F(RawScannerTest, UnboundedScan) {
 
     std::vector<std::string> keys;
     while (auto row = scanner.next_row()) {
-        keys.push_back(row->key);
+        keys.emplace_back(row->key);
     }
 
     ASSERT_EQ(keys.size(), 7);
@@ -195,12 +236,12 @@ TEST_F(RawScannerTest, ExactMatchFound) {
     scanner.begin_scan(bounds);
 
     auto row = scanner.next_row();
-    ASSERT_TRUE(row.has_value());
+    ASSERT_NE(row, nullptr);
     EXPECT_EQ(row->key, "user:002");
     EXPECT_EQ(row->value, "Bob");
 
     // Should return no more rows
-    EXPECT_FALSE(scanner.next_row().has_value());
+    EXPECT_EQ(scanner.next_row(), nullptr);
 }
 
 TEST_F(RawScannerTest, ExactMatchNotFound) {
@@ -210,7 +251,7 @@ TEST_F(RawScannerTest, ExactMatchNotFound) {
 
     scanner.begin_scan(bounds);
 
-    EXPECT_FALSE(scanner.next_row().has_value());
+    EXPECT_EQ(scanner.next_row(), nullptr);
 }
 
 TEST_F(RawScannerTest, RangeScanInclusive) {
@@ -225,7 +266,7 @@ TEST_F(RawScannerTest, RangeScanInclusive) {
 
     std::vector<std::string> keys;
     while (auto row = scanner.next_row()) {
-        keys.push_back(row->key);
+        keys.emplace_back(row->key);
     }
 
     ASSERT_EQ(keys.size(), 3);
@@ -246,7 +287,7 @@ TEST_F(RawScannerTest, RangeScanExclusive) {
 
     std::vector<std::string> keys;
     while (auto row = scanner.next_row()) {
-        keys.push_back(row->key);
+        keys.emplace_back(row->key);
     }
 
     ASSERT_EQ(keys.size(), 1);
@@ -265,7 +306,7 @@ TEST_F(RawScannerTest, PrefixScan) {
 
     std::vector<std::string> keys;
     while (auto row = scanner.next_row()) {
-        keys.push_back(row->key);
+        keys.emplace_back(row->key);
     }
 
     ASSERT_EQ(keys.size(), 5);
@@ -282,19 +323,73 @@ TEST_F(RawScannerTest, Rescan) {
     scanner.begin_scan(bounds);
 
     auto row1 = scanner.next_row();
-    ASSERT_TRUE(row1.has_value());
+    ASSERT_NE(row1, nullptr);
     EXPECT_EQ(row1->key, "user:001");
 
-    EXPECT_FALSE(scanner.next_row().has_value());
+    EXPECT_EQ(scanner.next_row(), nullptr);
 
     // Rescan should restart
     scanner.rescan();
 
     auto row2 = scanner.next_row();
-    ASSERT_TRUE(row2.has_value());
+    ASSERT_NE(row2, nullptr);
     EXPECT_EQ(row2->key, "user:001");
 }
 
+TEST_F(RawScannerTest, PinnedSnapshotHidesLaterWrites) {
+    RawScanner scanner(connection_);
+    RawScanBounds bounds;
+    bounds.exact_key = "user:001";
+
+    connection_->acquire_snapshot();
+    scanner.begin_scan(bounds);
+
+    connection_->put("user:001", "Changed");
+    connection_->del("user:002");
+
+    auto row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->value, "Alice");
+    EXPECT_EQ(connection_->get("user:002"), std::optional<std::string>("Bob"));
+
+    // A rescan under the same snapshot still sees the old data
+    scanner.rescan();
+    row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->value, "Alice");
+
+    connection_->release_snapshot();
+    EXPECT_EQ(connection_->snapshot_epoch(), 0u);
+
+    scanner.rescan();
+    row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->value, "Changed");
+    EXPECT_FALSE(connection_->get("user:002").has_value());
+}
+
+TEST_F(RawScannerTest, SnapshotPinsNest) {
+    connection_->acquire_snapshot();
+    uint64_t epoch = connection_->snapshot_epoch();
+    EXPECT_NE(epoch, 0u);
+
+    connection_->acquire_snapshot();
+    EXPECT_EQ(connection_->snapshot_epoch(), epoch);
+    connection_->put("user:001", "Changed");
+
+    // Still pinned after the inner release
+    connection_->release_snapshot();
+    EXPECT_EQ(connection_->get("user:001"), std::optional<std::string>("Alice"));
+
+    connection_->release_snapshot();
+    EXPECT_EQ(connection_->get("user:001"), std::optional<std::string>("Changed"));
+
+    // A new pin is a new epoch
+    connection_->acquire_snapshot();
+    EXPECT_NE(connection_->snapshot_epoch(), epoch);
+    connection_->release_snapshot();
+}
+
 TEST_F(RawScannerTest, StatsTracking) {
     RawScanner scanner(connection_);
     RawScanBounds bounds;
@@ -312,3 +407,73 @@ TEST_F(RawScannerTest, StatsTracking) {
     const auto& stats = scanner.stats();
     EXPECT_EQ(stats.keys_scanned, 5);
 }
+
+TEST_F(RawScannerTest, ReverseUnboundedScan) {
+    RawScanner scanner(connection_);
+    scanner.set_reverse(true);
+    scanner.begin_scan(RawScanBounds{});
+
+    std::vector<std::string> keys;
+    while (auto row = scanner.next_row()) {
+        keys.emplace_back(row->key);
+    }
+
+    ASSERT_EQ(keys.size(), 7);
+    EXPECT_EQ(keys[0], "zzz:end");
+    EXPECT_EQ(keys[6], "other:001");
+}
+
+TEST_F(RawScannerTest, ReverseRangeScan) {
+    RawScanner scanner(connection_);
+    scanner.set_reverse(true);
+
+    RawScanBounds bounds;
+    bounds.lower_bound = "user:001";
+    bounds.lower_inclusive = false;
+    bounds.upper_bound = "user:010";
+    bounds.upper_inclusive = true;
+    scanner.begin_scan(bounds);
+
+    std::vector<std::string> keys;
+    while (auto row = scanner.next_row()) {
+        keys.emplace_back(row->key);
+    }
+    EXPECT_EQ(keys, (std::vector<std::string>{"user:010", "user:003", "user:002"}));
+
+    // Exclusive upper bound that isn't a key, and one past every key
+    bounds.upper_bound = "user:0100";
+    bounds.upper_inclusive = false;
+    scanner.begin_scan(bounds);
+    ASSERT_NE(scanner.next_row(), nullptr);
+
+    bounds.lower_bound = "zzz:";
+    bounds.upper_bound = "zzzz";
+    scanner.begin_scan(bounds);
+    auto row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->key, "zzz:end");
+    EXPECT_EQ(scanner.next_row(), nullptr);
+}
+
+TEST_F(RawScannerTest, RowsViewBinaryValuesUntilTheNextCall) {
+    const std::string binary("\x00\x01\xff\x00", 4);
+    connection_->put("user:004", binary);
+
+    RawScanner scanner(connection_);
+    RawScanBounds bounds;
+    bounds.lower_bound = "user:003";
+    bounds.upper_bound = "user:005";
+    scanner.begin_scan(bounds);
+
+    const RawRow* row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->key, "user:003");
+
+    // The iterator only moves on here, so no key is skipped
+    row = scanner.next_row();
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->key, "user:004");
+    EXPECT_EQ(row->value, binary);
+
+    EXPECT_EQ(scanner.next_row(), nullptr);
+}
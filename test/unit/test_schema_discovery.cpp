@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "level_pivot/schema_discovery.hpp"
 #include "level_pivot/connection_manager.hpp"
+#include <algorithm>
 #include <filesystem>
 
 using namespace level_pivot;
@@ -256,3 +257,169 @@ TEST_F(SchemaDiscoveryTest, SampleValueCollection) {
 
     EXPECT_TRUE(has_sample);
 }
+
+// Probes spread the scan over the range instead of its first keys
+TEST_F(SchemaDiscoveryTest, ProbesSampleWholeKeyRange) {
+    for (int i = 0; i < 1000; ++i) {
+        char id[8];
+        snprintf(id, sizeof(id), "%04d", i);
+        connection_->put(std::string("events##") + id + "##kind", "click");
+        if (i >= 900) {
+            connection_->put(std::string("events##") + id + "##late_attr", "1");
+        }
+    }
+
+    SchemaDiscovery discovery(connection_);
+    KeyPattern pattern("events##{id}##{attr}");
+
+    DiscoveryOptions opts;
+    opts.max_keys = 200;
+    auto first_keys = discovery.discover(pattern, opts);
+    EXPECT_EQ(first_keys.attrs.size(), 1u);
+
+    opts.probes = 10;
+    auto sampled = discovery.discover(pattern, opts);
+    EXPECT_LE(sampled.keys_scanned, 200u);
+    ASSERT_EQ(sampled.attrs.size(), 2u);
+    EXPECT_EQ(sampled.attrs[1].name, "late_attr");
+}
+
+// Threads read the same probes, so give the same result
+TEST_F(SchemaDiscoveryTest, ParallelProbesMatchSequential) {
+    for (int i = 0; i < 500; ++i) {
+        std::string id = std::to_string(1000 + i);
+        connection_->put("users##g" + std::to_string(i % 7) + "##" + id + "##name", "n" + id);
+        connection_->put("users##g" + std::to_string(i % 7) + "##" + id + "##score", id);
+    }
+
+    SchemaDiscovery discovery(connection_);
+    KeyPattern pattern("users##{group}##{id}##{attr}");
+
+    DiscoveryOptions opts;
+    opts.max_keys = 300;
+    opts.probes = 12;
+    auto sequential = discovery.discover(pattern, opts);
+    opts.threads = 4;
+    auto parallel = discovery.discover(pattern, opts);
+
+    EXPECT_EQ(parallel.keys_scanned, sequential.keys_scanned);
+    EXPECT_EQ(parallel.keys_matched, sequential.keys_matched);
+    ASSERT_EQ(parallel.attrs.size(), sequential.attrs.size());
+    for (size_t i = 0; i < parallel.attrs.size(); ++i) {
+        EXPECT_EQ(parallel.attrs[i].name, sequential.attrs[i].name);
+        EXPECT_EQ(parallel.attrs[i].sample_count, sequential.attrs[i].sample_count);
+        EXPECT_EQ(parallel.attrs[i].samples, sequential.attrs[i].samples);
+    }
+}
+
+// More probes than are opened at once are read in several rounds
+TEST_F(SchemaDiscoveryTest, ManyProbesReadInRounds) {
+    for (int i = 0; i < 2000; ++i) {
+        char id[8];
+        snprintf(id, sizeof(id), "%04d", i);
+        connection_->put(std::string("events##") + id + "##kind", "click");
+        if (i >= 1990) {
+            connection_->put(std::string("events##") + id + "##late_attr", "1");
+        }
+    }
+
+    SchemaDiscovery discovery(connection_);
+    KeyPattern pattern("events##{id}##{attr}");
+    ASSERT_GT(discovery.split_points("events##", "events#$", 200).size(), 128u);
+
+    DiscoveryOptions opts;
+    opts.max_keys = 400;
+    opts.probes = 200;
+    auto sequential = discovery.discover(pattern, opts);
+    opts.threads = 4;
+    auto parallel = discovery.discover(pattern, opts);
+
+    EXPECT_LE(sequential.keys_scanned, 400u);
+    ASSERT_EQ(sequential.attrs.size(), 2u);
+    EXPECT_EQ(sequential.attrs[1].name, "late_attr");
+    EXPECT_EQ(parallel.keys_scanned, sequential.keys_scanned);
+    EXPECT_EQ(parallel.attrs.size(), sequential.attrs.size());
+}
+
+// Split points are ascending, start at the range start and stay in it
+TEST_F(SchemaDiscoveryTest, SplitPointsCutRangeEvenly) {
+    for (int i = 0; i < 400; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "logs##%05d##msg", i * 7);
+        connection_->put(key, std::string(100, 'x'));
+    }
+    connection_->put("other##1##msg", "x");
+
+    SchemaDiscovery discovery(connection_);
+    std::string start = "logs##";
+    std::string limit = KeyParser::prefix_successor(start);
+    auto points = discovery.split_points(start, limit, 4);
+
+    ASSERT_EQ(points.size(), 4u);
+    EXPECT_EQ(points[0], start);
+    EXPECT_TRUE(std::is_sorted(points.begin(), points.end()));
+    EXPECT_LT(points.back(), limit);
+
+    // Each part holds about a quarter of the data
+    uint64_t total = connection_->approximate_size(start, limit);
+    for (size_t i = 0; i < points.size(); ++i) {
+        std::string end = i + 1 < points.size() ? points[i + 1] : limit;
+        uint64_t part = connection_->approximate_size(points[i], end);
+        EXPECT_NEAR(static_cast<double>(part) / total, 0.25, 0.05);
+    }
+
+    EXPECT_EQ(discovery.split_points("none##", "none#$", 4).size(), 1u);
+}
+
+// infer_pattern() follows the structure most sampled keys share
+TEST_F(SchemaDiscoveryTest, InferPatternFromProbes) {
+    connection_->put("aaa", "x");
+    for (int i = 0; i < 300; ++i) {
+        connection_->put("orders##" + std::to_string(1000 + i) + "##total", "1");
+    }
+
+    SchemaDiscovery discovery(connection_);
+    auto pattern = discovery.infer_pattern(100, 10, 2);
+
+    ASSERT_TRUE(pattern.has_value());
+    EXPECT_EQ(*pattern, "orders##{col1}##total");
+}
+
+// infer_type() picks the narrowest type all samples fit
+TEST_F(SchemaDiscoveryTest, InferTypeFromSamples) {
+    EXPECT_EQ(infer_type({}), PgType::TEXT);
+    EXPECT_EQ(infer_type({"1", "-42", "7"}), PgType::INTEGER);
+    EXPECT_EQ(infer_type({"1", "9000000000"}), PgType::BIGINT);
+    EXPECT_EQ(infer_type({"1", "2.5", "1e3"}), PgType::NUMERIC);
+    EXPECT_EQ(infer_type({"true", "FALSE"}), PgType::BOOLEAN);
+    EXPECT_EQ(infer_type({"2024-01-31"}), PgType::DATE);
+    EXPECT_EQ(infer_type({"2024-01-31", "2024-01-31 10:00:00.5"}), PgType::TIMESTAMP);
+    EXPECT_EQ(infer_type({"2024-01-31T10:00:00Z", "2024-01-31 10:00:00"}), PgType::TIMESTAMPTZ);
+    EXPECT_EQ(infer_type({"{\"a\": [1, \"}\"]}", "[1,2]"}), PgType::JSONB);
+    EXPECT_EQ(infer_type({"{\"a\": 1} {}"}), PgType::TEXT);
+    EXPECT_EQ(infer_type({"1", "n/a"}), PgType::TEXT);
+    EXPECT_EQ(infer_type({"."}), PgType::TEXT);
+}
+
+// Inferred types appear in the generated SQL unless TEXT is asked for
+TEST_F(SchemaDiscoveryTest, GenerateForeignTableSqlWithInferredTypes) {
+    connection_->put("items##1##price", "9.99");
+    connection_->put("items##1##stock", "12");
+    connection_->put("items##1##title", "Lamp");
+    connection_->put("items##2##price", "15");
+    connection_->put("items##2##stock", "0");
+
+    SchemaDiscovery discovery(connection_);
+    KeyPattern pattern("items##{id}##{attr}");
+    auto result = discovery.discover(pattern);
+
+    std::string sql = generate_foreign_table_sql(
+        "items", "srv", "items##{id}##{attr}", result, false);
+    EXPECT_NE(sql.find("id TEXT"), std::string::npos);
+    EXPECT_NE(sql.find("price NUMERIC"), std::string::npos);
+    EXPECT_NE(sql.find("stock INTEGER"), std::string::npos);
+    EXPECT_NE(sql.find("title TEXT"), std::string::npos);
+
+    sql = generate_foreign_table_sql("items", "srv", "items##{id}##{attr}", result);
+    EXPECT_NE(sql.find("price TEXT"), std::string::npos);
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include "level_pivot/secondary_index.hpp"
+#include "level_pivot/writer.hpp"
+#include <filesystem>
+
+using namespace level_pivot;
+
+using Identities = std::vector<std::vector<std::string>>;
+
+TEST(IndexLookupTest, EqualityAndInIntersect) {
+    IndexLookup lookup;
+    EXPECT_TRUE(lookup.empty());
+    EXPECT_TRUE(lookup.add(AttrFilterOp::IN, {"c", "a", "b", "a"}));
+    EXPECT_EQ(*lookup.values, (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_TRUE(lookup.add(AttrFilterOp::EQ, {"b"}));
+    EXPECT_EQ(*lookup.values, (std::vector<std::string>{"b"}));
+    EXPECT_TRUE(lookup.matches("b"));
+    EXPECT_FALSE(lookup.matches("a"));
+
+    EXPECT_TRUE(lookup.add(AttrFilterOp::EQ, {"z"}));
+    EXPECT_TRUE(lookup.values->empty());
+}
+
+TEST(IndexLookupTest, RangesKeepTheTighterBound) {
+    IndexLookup lookup;
+    EXPECT_TRUE(lookup.add(AttrFilterOp::GE, {"b"}));
+    EXPECT_TRUE(lookup.add(AttrFilterOp::GT, {"b"}));
+    EXPECT_TRUE(lookup.add(AttrFilterOp::GT, {"a"}));
+    EXPECT_TRUE(lookup.add(AttrFilterOp::LE, {"m"}));
+    EXPECT_EQ(*lookup.lower, "b");
+    EXPECT_FALSE(lookup.lower_inclusive);
+
+    EXPECT_FALSE(lookup.matches("b"));
+    EXPECT_TRUE(lookup.matches("ba"));
+    EXPECT_TRUE(lookup.matches("m"));
+    EXPECT_FALSE(lookup.matches("ma"));
+}
+
+TEST(IndexLookupTest, PrefixesAndUnsupportedOperators) {
+    IndexLookup lookup;
+    EXPECT_FALSE(lookup.add(AttrFilterOp::IS_NULL, {}));
+    EXPECT_FALSE(lookup.add(AttrFilterOp::EQ, {}));
+    EXPECT_TRUE(lookup.empty());
+
+    EXPECT_TRUE(lookup.add(AttrFilterOp::PREFIX, {"ab"}));
+    EXPECT_TRUE(lookup.add(AttrFilterOp::PREFIX, {"abc"}));
+    EXPECT_EQ(*lookup.prefix, "abc");
+    EXPECT_TRUE(lookup.matches("abcd"));
+    EXPECT_FALSE(lookup.matches("abd"));
+
+    EXPECT_TRUE(lookup.add(AttrFilterOp::PREFIX, {"x"}));
+    EXPECT_TRUE(lookup.values && lookup.values->empty());
+}
+
+TEST(SecondaryIndexTest, ParseAttrList) {
+    EXPECT_EQ(SecondaryIndex::parse_attr_list("email"),
+              (std::vector<std::string>{"email"}));
+    EXPECT_EQ(SecondaryIndex::parse_attr_list(" email , name,email"),
+              (std::vector<std::string>{"email", "name"}));
+    EXPECT_TRUE(SecondaryIndex::parse_attr_list("").empty());
+    EXPECT_TRUE(SecondaryIndex::parse_attr_list("email,,name").empty());
+    EXPECT_THROW(SecondaryIndex("", {"email"}), LevelPivotError);
+}
+
+TEST(SecondaryIndexTest, EntryLayout) {
+    SecondaryIndex index("users", {"email"});
+    EXPECT_TRUE(index.indexes("email"));
+    EXPECT_FALSE(index.indexes("name"));
+    EXPECT_EQ(index.table_prefix(), "idx##users##");
+    EXPECT_EQ(index.attr_prefix("email"), "idx##users##email##");
+
+    std::string key;
+    std::string value;
+    index.build_entry("email", "a@x.com", {"admins", "u1"}, key, value);
+    EXPECT_EQ(key, "idx##users##email##a@x.com##admins##u1");
+    EXPECT_EQ(key, index.entry_key("email", "a@x.com", {"admins", "u1"}));
+    EXPECT_EQ(value, std::string("\x06\0\0\0admins\x02\0\0\0u1", 16));
+}
+
+class SecondaryIndexDbTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+    std::unique_ptr<Projection> projection_;
+    SecondaryIndex index_{"users", {"email", "name"}};
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_index_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+
+        std::vector<ColumnDef> columns = {
+            {"group", PgType::TEXT, 1, true},
+            {"id", PgType::TEXT, 2, true},
+            {"name", PgType::TEXT, 3, false},
+            {"email", PgType::TEXT, 4, false},
+        };
+        projection_ = std::make_unique<Projection>(
+            KeyPattern("users##{group}##{id}##{attr}"), std::move(columns));
+
+        connection_->put("users##admins##u1##name", "Ann");
+        connection_->put("users##admins##u1##email", "ann@x.com");
+        connection_->put("users##admins##u2##name", "Ann Lee");
+        connection_->put("users##admins##u2##role", "owner");
+        connection_->put("users##staff##u3##name", "Bob");
+        connection_->put("users##staff##u3##email", "bob##x.com");
+    }
+
+    void TearDown() override {
+        projection_.reset();
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    Identities find(std::string_view attr, AttrFilterOp op,
+                    const std::vector<std::string>& operands) {
+        IndexLookup lookup;
+        lookup.add(op, operands);
+        return index_.lookup(*connection_, attr, lookup);
+    }
+
+    size_t entry_count() {
+        size_t count = 0;
+        auto iter = connection_->iterator();
+        for (iter.seek(index_.table_prefix()); iter.valid(); iter.next()) {
+            if (iter.key_view().substr(0, 5) != "idx##") {
+                break;
+            }
+            ++count;
+        }
+        return count;
+    }
+};
+
+TEST_F(SecondaryIndexDbTest, RebuildIndexesExistingRows) {
+    connection_->put(index_.entry_key("email", "gone@x.com", {"old", "u9"}), "");
+
+    auto result = index_.rebuild(*connection_, projection_->parser(), 2);
+    EXPECT_EQ(result.entries_deleted, 1u);
+    EXPECT_EQ(result.entries_written, 5u);
+    EXPECT_EQ(entry_count(), 5u);
+
+    EXPECT_EQ(find("email", AttrFilterOp::EQ, {"ann@x.com"}),
+              (Identities{{"admins", "u1"}}));
+    EXPECT_TRUE(find("email", AttrFilterOp::EQ, {"gone@x.com"}).empty());
+    EXPECT_TRUE(find("role", AttrFilterOp::EQ, {"owner"}).empty());
+}
+
+TEST_F(SecondaryIndexDbTest, ValuesContainingSeparators) {
+    index_.rebuild(*connection_, projection_->parser());
+
+    EXPECT_EQ(find("email", AttrFilterOp::EQ, {"bob##x.com"}),
+              (Identities{{"staff", "u3"}}));
+    EXPECT_TRUE(find("email", AttrFilterOp::EQ, {"bob"}).empty());
+}
+
+TEST_F(SecondaryIndexDbTest, RangeLookupsCheckEachValue) {
+    index_.rebuild(*connection_, projection_->parser());
+
+    // "Ann Lee##..." sorts before "Ann##...", both are found
+    EXPECT_EQ(find("name", AttrFilterOp::LE, {"Ann Lee"}),
+              (Identities{{"admins", "u1"}, {"admins", "u2"}}));
+    EXPECT_EQ(find("name", AttrFilterOp::LT, {"Ann Lee"}),
+              (Identities{{"admins", "u1"}}));
+    EXPECT_EQ(find("name", AttrFilterOp::GT, {"Ann"}),
+              (Identities{{"admins", "u2"}, {"staff", "u3"}}));
+    EXPECT_EQ(find("name", AttrFilterOp::PREFIX, {"Ann"}),
+              (Identities{{"admins", "u1"}, {"admins", "u2"}}));
+    EXPECT_EQ(find("name", AttrFilterOp::IN, {"Bob", "Ann", "Cy"}),
+              (Identities{{"admins", "u1"}, {"staff", "u3"}}));
+}
+
+TEST_F(SecondaryIndexDbTest, RangeWritesKeepEntriesInStep) {
+    index_.rebuild(*connection_, projection_->parser());
+    Writer writer(*projection_, connection_);
+    writer.set_index(&index_);
+
+    auto updated = writer.update_ranges({prefix_range("users##admins##")},
+                                        {{"email", std::string("team@x.com")},
+                                         {"name", std::nullopt}});
+    // Two attr keys and two entries put; two names and their entries
+    // and u1's old email entry deleted
+    EXPECT_EQ(updated.keys_written, 4u);
+    EXPECT_EQ(updated.keys_deleted, 5u);
+    EXPECT_EQ(find("email", AttrFilterOp::EQ, {"team@x.com"}),
+              (Identities{{"admins", "u1"}, {"admins", "u2"}}));
+    EXPECT_TRUE(find("email", AttrFilterOp::EQ, {"ann@x.com"}).empty());
+    EXPECT_TRUE(find("name", AttrFilterOp::PREFIX, {"Ann"}).empty());
+
+    // Assigning the value a row already has leaves its entry alone
+    writer.update_ranges({prefix_range("users##admins##u1##")},
+                         {{"email", std::string("team@x.com")}});
+    EXPECT_EQ(find("email", AttrFilterOp::EQ, {"team@x.com"}).size(), 2u);
+
+    auto removed = writer.remove_ranges({prefix_range("users##staff##")});
+    EXPECT_EQ(removed.keys_deleted, 4u);
+    EXPECT_TRUE(find("name", AttrFilterOp::EQ, {"Bob"}).empty());
+    EXPECT_EQ(entry_count(), 2u);
+}
+
+TEST_F(SecondaryIndexDbTest, BatchedWritesCommitEntriesTogether) {
+    index_.rebuild(*connection_, projection_->parser());
+    Writer writer(*projection_, connection_,
+                  std::make_unique<LevelDBWriteBatch>(connection_->create_batch()));
+    writer.set_index(&index_);
+
+    writer.remove_ranges({prefix_range("users##")});
+    EXPECT_EQ(entry_count(), 5u);
+
+    writer.commit_batch();
+    EXPECT_EQ(entry_count(), 0u);
+}
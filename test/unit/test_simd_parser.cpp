@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "level_pivot/simd_parser.hpp"
+#include "level_pivot/key_parser.hpp"
+#include <random>
+
+using namespace level_pivot;
+
+// SIMD delimiter kernel and SimdKeyParser tests (no LevelDB needed)
+
+class SimdParserTest : public ::testing::Test {
+protected:
+    // Non-overlapping occurrences, as a find() loop returns them
+    static std::vector<size_t> reference(std::string_view key, size_t start,
+                                         std::string_view delim, size_t max_count) {
+        std::vector<size_t> out;
+        size_t pos = start;
+        while (out.size() < max_count &&
+               (pos = key.find(delim, pos)) != std::string_view::npos) {
+            out.push_back(pos);
+            pos += delim.size();
+        }
+        return out;
+    }
+
+    // Keys over a small alphabet, so delimiters and near misses are common
+    static std::vector<std::string> random_keys(size_t count) {
+        std::mt19937 rng(42);
+        const char alphabet[] = "#_:ab/#";
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < count; ++i) {
+            std::string key(rng() % 150, ' ');
+            for (char& c : key) {
+                c = alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+            keys.push_back(std::move(key));
+        }
+        return keys;
+    }
+};
+
+TEST_F(SimdParserTest, KernelsAgreeWithFind) {
+    auto keys = random_keys(400);
+    keys.push_back(std::string(130, '#'));
+    keys.push_back("");
+
+    for (const auto& kernel : detail::available_delimiter_kernels()) {
+        SCOPED_TRACE(kernel.name);
+        for (std::string_view delim : {"#", "##", "#_", "##:", "#_##a", "###"}) {
+            for (size_t start : {0, 3, 17}) {
+                for (size_t max_count : {1, 4, 64}) {
+                    for (const auto& key : keys) {
+                        std::vector<size_t> positions(max_count);
+                        size_t count = 99;
+                        kernel.find(key.data(), key.size(), start, delim.data(), delim.size(),
+                                    positions.data(), count, max_count);
+                        positions.resize(count);
+                        ASSERT_EQ(positions, reference(key, start, delim, max_count))
+                            << "key=" << key << " delim=" << delim;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(SimdParserTest, BatchKernelsAgreeWithSingleKeyKernels) {
+    auto keys = random_keys(150);
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    const size_t max_count = 5;
+
+    for (const auto& kernel : detail::available_delimiter_kernels()) {
+        SCOPED_TRACE(kernel.name);
+        for (std::string_view delim : {"##", "#_##a"}) {
+            std::vector<size_t> positions(views.size() * max_count);
+            std::vector<size_t> counts(views.size());
+            kernel.find_batch(views.data(), views.size(), 2, delim.data(), delim.size(),
+                              positions.data(), counts.data(), max_count);
+
+            for (size_t k = 0; k < views.size(); ++k) {
+                std::vector<size_t> found(positions.begin() + k * max_count,
+                                          positions.begin() + k * max_count + counts[k]);
+                ASSERT_EQ(found, reference(views[k], 2, delim, max_count)) << views[k];
+            }
+        }
+    }
+}
+
+TEST_F(SimdParserTest, ImplementationIsTheBestAvailable) {
+    auto kernels = detail::available_delimiter_kernels();
+    EXPECT_STREQ(kernels.front().name, "scalar");
+    EXPECT_STREQ(SimdKeyParser::implementation_name(), kernels.back().name);
+}
+
+TEST_F(SimdParserTest, ParsesMixedMultiByteSeparators) {
+    SimdKeyParser parser("this###", {"__", "##pat##"});
+
+    std::string_view captures[2];
+    std::string_view attr;
+    ASSERT_TRUE(parser.parse_fast("this###a_b__c##d##pat##name", captures, attr));
+    EXPECT_EQ(captures[0], "a_b");
+    EXPECT_EQ(captures[1], "c##d");
+    EXPECT_EQ(attr, "name");
+
+    EXPECT_FALSE(parser.parse_fast("this###__c##pat##name", captures, attr));
+    EXPECT_FALSE(parser.parse_fast("this###a__c##pat##", captures, attr));
+    EXPECT_FALSE(parser.parse_fast("this###a__c##name", captures, attr));
+    EXPECT_FALSE(parser.parse_fast("that###a__c##pat##name", captures, attr));
+}
+
+TEST_F(SimdParserTest, AttrTakesTheRestOfTheKey) {
+    SimdKeyParser parser("users", "##", 2);
+    auto result = parser.parse("users##admins##user001##name##extra");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->prefix, "users##");
+    EXPECT_EQ(result->captures, (std::vector<std::string_view>{"admins", "user001"}));
+    EXPECT_EQ(result->attr, "name##extra");
+}
+
+TEST_F(SimdParserTest, ParseBatchMatchesParseFast) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 150; ++i) {
+        keys.push_back("users##g" + std::to_string(i % 3) + "##u" + std::to_string(i) + "##name");
+    }
+    keys[5] = "groups##g##u##name";
+    keys[77] = "users##g####name";
+    keys[149] = "users##g##u";
+
+    for (auto parser : {SimdKeyParser("users", "##", 2),
+                        SimdKeyParser("users##", {"##", "##"}),
+                        SimdKeyParser("users##", {"##", "#"})}) {
+        std::vector<std::string_view> views(keys.begin(), keys.end());
+        std::vector<std::string_view> captures(views.size() * 2);
+        std::vector<std::string_view> attrs(views.size());
+        std::unique_ptr<bool[]> matched(new bool[views.size()]);
+
+        size_t parsed = parser.parse_batch(views.data(), views.size(), captures.data(),
+                                           attrs.data(), matched.get());
+
+        size_t expected = 0;
+        for (size_t k = 0; k < views.size(); ++k) {
+            std::string_view one[2];
+            std::string_view attr;
+            bool ok = parser.parse_fast(views[k], one, attr);
+            expected += ok;
+            ASSERT_EQ(matched[k], ok) << views[k];
+            if (ok) {
+                EXPECT_EQ(captures[k * 2], one[0]);
+                EXPECT_EQ(captures[k * 2 + 1], one[1]);
+                EXPECT_EQ(attrs[k], attr);
+            }
+        }
+        EXPECT_EQ(parsed, expected);
+        EXPECT_GT(parsed, 100u);
+    }
+}
+
+// The SIMD path behind parse_view agrees with the generic parse
+TEST_F(SimdParserTest, KeyParserPathsAgree) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> cases = {
+        {"users##{group}##{id}##{attr}",
+         {"users##admins##u1##name", "users##admins##u1##name##extra", "users####u1##name",
+          "users##admins##u1##", "users##admins##name", "user##admins##u1##name"}},
+        {"{tenant}:{env}/{service}/{attr}",
+         {"acme:prod/users/name", "acme:prod/users/name/x", "acme:/users/name", ":prod/a/b",
+          "acme:prod:x/users/name"}},
+        {"this###{arg}__{sub_arg}##pat##{attr}",
+         {"this###a__b##pat##x", "this###a__b##pat##", "this###a__b##x"}},
+        {"t##{attr}", {"t##name", "t##", "t##a##b"}},
+    };
+
+    for (const auto& [pattern, keys] : cases) {
+        KeyParser parser(pattern);
+        for (const auto& key : keys) {
+            auto owned = parser.parse(key);
+            auto view = parser.parse_view(key);
+            ASSERT_EQ(owned.has_value(), view.has_value()) << pattern << " " << key;
+            if (owned) {
+                EXPECT_EQ(std::string(view->attr_name), owned->attr_name);
+                ASSERT_EQ(view->capture_values.size(), owned->capture_values.size());
+                for (size_t i = 0; i < owned->capture_values.size(); ++i) {
+                    EXPECT_EQ(std::string(view->capture_values[i]), owned->capture_values[i]);
+                }
+            }
+        }
+    }
+}
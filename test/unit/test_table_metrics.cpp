@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "level_pivot/table_metrics.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace level_pivot;
+
+class TableMetricsTest : public ::testing::Test {
+protected:
+    std::unique_ptr<uint64_t[]> memory_;
+
+    TableMetrics* make(size_t capacity) {
+        size_t words = (TableMetrics::memory_size(capacity) + sizeof(uint64_t) - 1) /
+                       sizeof(uint64_t);
+        memory_ = std::make_unique<uint64_t[]>(words);
+        return TableMetrics::create(memory_.get(), capacity);
+    }
+
+    static TableCounters scan(uint64_t keys, uint64_t rows) {
+        TableCounters counters;
+        counters.scans = 1;
+        counters.keys_scanned = keys;
+        counters.rows_returned = rows;
+        return counters;
+    }
+};
+
+TEST_F(TableMetricsTest, CountersAddFieldByField) {
+    TableCounters total;
+    EXPECT_TRUE(total.empty());
+
+    TableCounters write;
+    write.rows_inserted = 2;
+    write.write_batches = 1;
+    write.batch_keys = 6;
+    total += scan(10, 3);
+    total += write;
+    total += scan(5, 1);
+
+    EXPECT_FALSE(total.empty());
+    EXPECT_EQ(total.scans, 2u);
+    EXPECT_EQ(total.keys_scanned, 15u);
+    EXPECT_EQ(total.rows_returned, 4u);
+    EXPECT_EQ(total.rows_inserted, 2u);
+    EXPECT_EQ(total.batch_keys, 6u);
+    EXPECT_EQ(total.keys_deleted, 0u);
+}
+
+TEST_F(TableMetricsTest, AccumulatesPerTable) {
+    TableMetrics* metrics = make(16);
+    EXPECT_TRUE(metrics->read().empty());
+
+    EXPECT_TRUE(metrics->add(7, scan(100, 10)));
+    EXPECT_TRUE(metrics->add(9, scan(4, 1)));
+    EXPECT_TRUE(metrics->add(7, scan(50, 5)));
+
+    auto tables = metrics->read();
+    ASSERT_EQ(tables.size(), 2u);
+    for (const auto& [table, counters] : tables) {
+        if (table == 7) {
+            EXPECT_EQ(counters.scans, 2u);
+            EXPECT_EQ(counters.keys_scanned, 150u);
+            EXPECT_EQ(counters.rows_returned, 15u);
+        } else {
+            EXPECT_EQ(table, 9u);
+            EXPECT_EQ(counters.keys_scanned, 4u);
+        }
+    }
+}
+
+TEST_F(TableMetricsTest, FullTableDropsNewTables) {
+    TableMetrics* metrics = make(3);
+    for (uint64_t table = 1; table <= 3; ++table) {
+        EXPECT_TRUE(metrics->add(table, scan(1, 1)));
+    }
+    EXPECT_FALSE(metrics->add(4, scan(1, 1)));
+    EXPECT_FALSE(metrics->add(0, scan(1, 1)));
+
+    // Tables that have a slot keep counting
+    EXPECT_TRUE(metrics->add(2, scan(1, 1)));
+    EXPECT_EQ(metrics->read().size(), 3u);
+}
+
+TEST_F(TableMetricsTest, ResetKeepsSlots) {
+    TableMetrics* metrics = make(4);
+    metrics->add(5, scan(10, 2));
+    metrics->reset();
+
+    auto tables = metrics->read();
+    ASSERT_EQ(tables.size(), 1u);
+    EXPECT_EQ(tables[0].first, 5u);
+    EXPECT_TRUE(tables[0].second.empty());
+
+    metrics->add(5, scan(3, 1));
+    EXPECT_EQ(metrics->read()[0].second.keys_scanned, 3u);
+}
+
+TEST_F(TableMetricsTest, ConcurrentAddsAreAllCounted) {
+    TableMetrics* metrics = make(64);
+    constexpr int THREADS = 4;
+    constexpr int ADDS = 10000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([metrics] {
+            for (int i = 0; i < ADDS; ++i) {
+                // Every thread claims the same new tables at once
+                metrics->add(100 + i % 8, scan(2, 1));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto tables = metrics->read();
+    ASSERT_EQ(tables.size(), 8u);
+    uint64_t scans = 0;
+    uint64_t keys = 0;
+    for (const auto& entry : tables) {
+        scans += entry.second.scans;
+        keys += entry.second.keys_scanned;
+    }
+    EXPECT_EQ(scans, static_cast<uint64_t>(THREADS * ADDS));
+    EXPECT_EQ(keys, static_cast<uint64_t>(2 * THREADS * ADDS));
+}
@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+#include "level_pivot/table_stats.hpp"
+#include "level_pivot/connection_manager.hpp"
+#include <filesystem>
+#include <unistd.h>
+
+using namespace level_pivot;
+
+// SizeEstimateCache unit tests (no LevelDB needed)
+
+class SizeEstimateCacheTest : public ::testing::Test {};
+
+TEST_F(SizeEstimateCacheTest, MissOnEmpty) {
+    SizeEstimateCache cache;
+    EXPECT_FALSE(cache.lookup(1, "").has_value());
+}
+
+TEST_F(SizeEstimateCacheTest, StoreAndLookup) {
+    SizeEstimateCache cache;
+    SizeEstimate est;
+    est.rows = 42;
+    cache.store(1, "users##", est);
+
+    auto hit = cache.lookup(1, "users##");
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_DOUBLE_EQ(hit->rows, 42);
+    EXPECT_FALSE(cache.lookup(1, "other##").has_value());
+    EXPECT_FALSE(cache.lookup(2, "users##").has_value());
+}
+
+TEST_F(SizeEstimateCacheTest, ExpiresAfterTtl) {
+    SizeEstimateCache cache(std::chrono::seconds(10));
+    auto now = SizeEstimateCache::Clock::now();
+    cache.store(1, "", SizeEstimate{}, now);
+
+    EXPECT_TRUE(cache.lookup(1, "", now + std::chrono::seconds(5)).has_value());
+    EXPECT_FALSE(cache.lookup(1, "", now + std::chrono::seconds(11)).has_value());
+}
+
+TEST_F(SizeEstimateCacheTest, InvalidateRelation) {
+    SizeEstimateCache cache;
+    cache.store(1, "a", SizeEstimate{});
+    cache.store(1, "b", SizeEstimate{});
+    cache.store(2, "a", SizeEstimate{});
+
+    cache.invalidate(1);
+
+    EXPECT_FALSE(cache.lookup(1, "a").has_value());
+    EXPECT_FALSE(cache.lookup(1, "b").has_value());
+    EXPECT_TRUE(cache.lookup(2, "a").has_value());
+}
+
+// SizeEstimator tests (need LevelDB)
+
+class SizeEstimatorTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_table_stats_test_" +
+                        std::to_string(getpid());
+
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+    }
+
+    void TearDown() override {
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    // Each user gets three attrs: name, email, age
+    void populate_users(const std::string& group, int count) {
+        for (int i = 0; i < count; ++i) {
+            char id[16];
+            snprintf(id, sizeof(id), "%05d", i);
+            std::string base = "users##" + group + "##" + id + "##";
+            connection_->put(base + "age", "30");
+            connection_->put(base + "email", "user@example.com");
+            connection_->put(base + "name", "User");
+        }
+    }
+};
+
+TEST_F(SizeEstimatorTest, EmptyDatabase) {
+    KeyParser parser("users##{group}##{id}##{attr}");
+    SizeEstimator estimator(connection_);
+
+    auto est = estimator.estimate_pivot(parser, {});
+    EXPECT_TRUE(est.exact);
+    EXPECT_DOUBLE_EQ(est.rows, 0);
+    EXPECT_DOUBLE_EQ(est.keys, 0);
+}
+
+TEST_F(SizeEstimatorTest, ExactWhenRangeFitsInSample) {
+    populate_users("admin", 10);
+    KeyParser parser("users##{group}##{id}##{attr}");
+    SizeEstimator estimator(connection_);
+
+    auto est = estimator.estimate_pivot(parser, {});
+    EXPECT_TRUE(est.exact);
+    EXPECT_DOUBLE_EQ(est.rows, 10);
+    EXPECT_DOUBLE_EQ(est.keys, 30);
+    EXPECT_DOUBLE_EQ(est.keys_per_row, 3);
+    EXPECT_DOUBLE_EQ(est.avg_identity_width, 10);  // "admin" + "00000"
+}
+
+TEST_F(SizeEstimatorTest, PrefixNarrowsEstimate) {
+    populate_users("admin", 5);
+    populate_users("guest", 20);
+    KeyParser parser("users##{group}##{id}##{attr}");
+    SizeEstimator estimator(connection_);
+
+    auto all = estimator.estimate_pivot(parser, {});
+    auto admins = estimator.estimate_pivot(parser, {"admin"});
+    EXPECT_DOUBLE_EQ(all.rows, 25);
+    EXPECT_DOUBLE_EQ(admins.rows, 5);
+}
+
+TEST_F(SizeEstimatorTest, NonMatchingKeysCountAsVisited) {
+    populate_users("admin", 4);
+    connection_->put("users##bogus", "x");
+    KeyParser parser("users##{group}##{id}##{attr}");
+    SizeEstimator estimator(connection_);
+
+    auto est = estimator.estimate_pivot(parser, {});
+    EXPECT_DOUBLE_EQ(est.rows, 4);
+    EXPECT_DOUBLE_EQ(est.keys, 13);
+}
+
+TEST_F(SizeEstimatorTest, ExtrapolatesBeyondSample) {
+    populate_users("admin", 100);
+    KeyParser parser("users##{group}##{id}##{attr}");
+    SizeEstimator estimator(connection_);
+
+    SamplingOptions opts;
+    opts.max_sample_keys = 30;
+    auto est = estimator.estimate_pivot(parser, {}, opts);
+
+    EXPECT_FALSE(est.exact);
+    EXPECT_DOUBLE_EQ(est.keys_per_row, 3);
+    // Never below what was actually sampled
+    EXPECT_GE(est.keys, 30);
+    EXPECT_GE(est.rows, 10);
+}
+
+TEST_F(SizeEstimatorTest, RawExactKeyIsOneRow) {
+    SizeEstimator estimator(connection_);
+    RawScanBounds bounds;
+    bounds.exact_key = "anything";
+
+    auto est = estimator.estimate_raw(bounds);
+    EXPECT_DOUBLE_EQ(est.rows, 1);
+}
+
+TEST_F(SizeEstimatorTest, RawRangeCountsKeysInBounds) {
+    connection_->put("a:1", "x");
+    connection_->put("b:1", "x");
+    connection_->put("b:2", "x");
+    connection_->put("b:3", "x");
+    connection_->put("c:1", "x");
+    SizeEstimator estimator(connection_);
+
+    RawScanBounds bounds;
+    bounds.lower_bound = "b:1";
+    bounds.lower_inclusive = false;
+    bounds.upper_bound = "b:3";
+    bounds.upper_inclusive = true;
+
+    auto est = estimator.estimate_raw(bounds);
+    EXPECT_TRUE(est.exact);
+    EXPECT_DOUBLE_EQ(est.rows, 2);
+}
+
+// KeyspaceSampler tests
+
+class KeyspaceSamplerTest : public SizeEstimatorTest {};
+
+TEST_F(KeyspaceSamplerTest, InterpolateMidpoint) {
+    EXPECT_EQ(KeyspaceSampler::interpolate("a", "c", 0.5), "b");
+    EXPECT_EQ(KeyspaceSampler::interpolate("user:a", "user:c", 0.5), "user:b");
+    EXPECT_EQ(KeyspaceSampler::interpolate("a", "c", 0.0), "a");
+    EXPECT_EQ(KeyspaceSampler::interpolate("a", "c", 1.0), "c");
+}
+
+TEST_F(KeyspaceSamplerTest, InterpolateIsMonotonic) {
+    std::string prev;
+    for (int i = 0; i <= 20; ++i) {
+        std::string key = KeyspaceSampler::interpolate("users##admin##00000",
+                                                       "users##guest##99999", i / 20.0);
+        EXPECT_GE(key, prev);
+        EXPECT_GE(key, "users##admin##00000");
+        EXPECT_LE(key, "users##guest##99999");
+        prev = key;
+    }
+}
+
+TEST_F(KeyspaceSamplerTest, EmptyPrefixRange) {
+    populate_users("admin", 3);
+    EXPECT_FALSE(KeyspaceSampler::for_prefix(connection_, "groups##").has_value());
+}
+
+TEST_F(KeyspaceSamplerTest, FindsFirstAndLastInPrefix) {
+    connection_->put("a:1", "x");
+    populate_users("admin", 3);
+    connection_->put("z:1", "x");
+
+    auto sampler = KeyspaceSampler::for_prefix(connection_, "users##");
+    ASSERT_TRUE(sampler.has_value());
+    EXPECT_EQ(sampler->first(), "users##admin##00000##age");
+    EXPECT_EQ(sampler->last(), "users##admin##00002##name");
+}
+
+TEST_F(KeyspaceSamplerTest, KeysStayWithinRange) {
+    populate_users("admin", 50);
+    auto sampler = KeyspaceSampler::for_prefix(connection_, "users##");
+    ASSERT_TRUE(sampler.has_value());
+
+    std::string prev;
+    for (int i = 0; i <= 10; ++i) {
+        std::string key = sampler->key_at(i / 10.0);
+        EXPECT_GE(key, sampler->first());
+        EXPECT_LE(key, sampler->last());
+        EXPECT_GE(key, prev);
+        prev = key;
+    }
+}
+
+// compute_shard_boundaries tests
+
+class ShardBoundaryTest : public SizeEstimatorTest {};
+
+TEST_F(ShardBoundaryTest, SingleShardHasNoBoundaries) {
+    populate_users("admin", 10);
+    KeyParser parser("users##{group}##{id}##{attr}");
+    EXPECT_TRUE(compute_shard_boundaries(connection_, parser, {}, 1).empty());
+}
+
+TEST_F(ShardBoundaryTest, BoundariesAreIdentityPrefixes) {
+    populate_users("admin", 100);
+    KeyParser parser("users##{group}##{id}##{attr}");
+
+    auto bounds = compute_shard_boundaries(connection_, parser, {}, 4);
+    ASSERT_FALSE(bounds.empty());
+    EXPECT_LE(bounds.size(), 3u);
+
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        // "users##admin##NNNNN##" - a whole identity, ready for its attrs
+        EXPECT_EQ(bounds[i].size(), std::string("users##admin##00000##").size());
+        EXPECT_EQ(bounds[i].substr(bounds[i].size() - 2), "##");
+        if (i > 0) {
+            EXPECT_GT(bounds[i], bounds[i - 1]);
+        }
+    }
+}
+
+TEST_F(ShardBoundaryTest, ShardsPartitionRowsExactly) {
+    populate_users("admin", 60);
+    KeyParser parser("users##{group}##{id}##{attr}");
+    auto bounds = compute_shard_boundaries(connection_, parser, {}, 5);
+
+    // Count distinct identities per shard by walking keys
+    std::vector<std::string> shard_starts = {"users##"};
+    shard_starts.insert(shard_starts.end(), bounds.begin(), bounds.end());
+
+    size_t total_rows = 0;
+    for (size_t s = 0; s < shard_starts.size(); ++s) {
+        std::string end = s + 1 < shard_starts.size() ? shard_starts[s + 1] : "users#$";
+        std::string last_identity;
+        auto iter = connection_->iterator();
+        for (iter.seek(shard_starts[s]); iter.valid() && iter.key() < end; iter.next()) {
+            auto parsed = parser.parse(iter.key());
+            ASSERT_TRUE(parsed.has_value());
+            std::string identity = parsed->capture_values[0] + "/" + parsed->capture_values[1];
+            if (identity != last_identity) {
+                ++total_rows;
+                last_identity = identity;
+            }
+        }
+    }
+    EXPECT_EQ(total_rows, 60u);
+}
+
+TEST_F(ShardBoundaryTest, EmptyRange) {
+    KeyParser parser("users##{group}##{id}##{attr}");
+    EXPECT_TRUE(compute_shard_boundaries(connection_, parser, {}, 4).empty());
+}
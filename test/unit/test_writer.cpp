@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "level_pivot/writer.hpp"
+#include "level_pivot/raw_writer.hpp"
+#include <filesystem>
+
+using namespace level_pivot;
+
+// Range DELETE/UPDATE tests for Writer and RawWriter (need LevelDB)
+
+class RangeWriterTest : public ::testing::Test {
+protected:
+    std::string test_db_path_;
+    std::shared_ptr<LevelDBConnection> connection_;
+    std::unique_ptr<Projection> projection_;
+
+    void SetUp() override {
+        test_db_path_ = "/tmp/level_pivot_writer_test_" + std::to_string(getpid());
+        std::filesystem::remove_all(test_db_path_);
+
+        ConnectionOptions opts;
+        opts.db_path = test_db_path_;
+        opts.read_only = false;
+        opts.create_if_missing = true;
+        connection_ = std::make_shared<LevelDBConnection>(opts);
+
+        std::vector<ColumnDef> columns = {
+            {"group", PgType::TEXT, 1, true},
+            {"id", PgType::TEXT, 2, true},
+            {"name", PgType::TEXT, 3, false},
+            {"email", PgType::TEXT, 4, false},
+        };
+        projection_ = std::make_unique<Projection>(
+            KeyPattern("users##{group}##{id}##{attr}"), std::move(columns));
+
+        connection_->put("users##admins##u1##name", "Alice");
+        connection_->put("users##admins##u1##email", "alice@x.com");
+        connection_->put("users##admins##u2##name", "Bob");
+        connection_->put("users##admins##u2##role", "owner");
+        connection_->put("users##staff##u3##name", "Carol");
+        connection_->put("users##admins", "not a row");
+        connection_->put("other##1", "x");
+    }
+
+    void TearDown() override {
+        projection_.reset();
+        connection_.reset();
+        std::filesystem::remove_all(test_db_path_);
+    }
+
+    std::vector<std::string> keys() {
+        std::vector<std::string> out;
+        auto iter = connection_->iterator();
+        for (iter.seek_to_first(); iter.valid(); iter.next()) {
+            out.emplace_back(iter.key_view());
+        }
+        return out;
+    }
+};
+
+TEST_F(RangeWriterTest, RemoveRangesDeletesEveryKeyOfMatchingRows) {
+    Writer writer(*projection_, connection_);
+    auto result = writer.remove_ranges({prefix_range("users##admins##")});
+
+    EXPECT_EQ(result.rows, 2u);
+    // Attrs outside the projection go too, as with remove_by_identity
+    EXPECT_EQ(result.keys_deleted, 4u);
+    EXPECT_EQ(keys(), (std::vector<std::string>{
+        "other##1", "users##admins", "users##staff##u3##name"}));
+}
+
+TEST_F(RangeWriterTest, RemoveRangesCoversSeveralRanges) {
+    Writer writer(*projection_, connection_);
+    auto result = writer.remove_ranges({prefix_range("users##admins##u2##"),
+                                        prefix_range("users##staff##")});
+    EXPECT_EQ(result.rows, 2u);
+    EXPECT_EQ(result.keys_deleted, 3u);
+    EXPECT_EQ(keys().size(), 4u);
+}
+
+TEST_F(RangeWriterTest, UpdateRangesWritesAssignmentsOncePerRow) {
+    Writer writer(*projection_, connection_);
+    auto result = writer.update_ranges({prefix_range("users##admins##")},
+                                       {{"email", std::string("team@x.com")},
+                                        {"name", std::nullopt}});
+
+    EXPECT_EQ(result.rows, 2u);
+    EXPECT_EQ(result.keys_written, 2u);
+    EXPECT_EQ(result.keys_deleted, 2u);
+    EXPECT_EQ(connection_->get("users##admins##u1##email"), "team@x.com");
+    EXPECT_EQ(connection_->get("users##admins##u2##email"), "team@x.com");
+    EXPECT_FALSE(connection_->get("users##admins##u1##name").has_value());
+    EXPECT_EQ(connection_->get("users##admins##u2##role"), "owner");
+    EXPECT_EQ(connection_->get("users##staff##u3##name"), "Carol");
+}
+
+TEST_F(RangeWriterTest, BatchedRangeWritesWaitForCommit) {
+    Writer writer(*projection_, connection_,
+                  std::make_unique<LevelDBWriteBatch>(connection_->create_batch()));
+    auto result = writer.remove_ranges({prefix_range("users##")});
+    EXPECT_EQ(result.rows, 3u);
+    EXPECT_EQ(keys().size(), 7u);
+
+    writer.commit_batch();
+    EXPECT_EQ(keys(), (std::vector<std::string>{"other##1", "users##admins"}));
+}
+
+TEST_F(RangeWriterTest, EmptyRangesTouchNothing) {
+    Writer writer(*projection_, connection_);
+    auto result = writer.remove_ranges({});
+    EXPECT_EQ(result.rows, 0u);
+    EXPECT_EQ(keys().size(), 7u);
+}
+
+TEST_F(RangeWriterTest, RawRangeDeleteAndUpdate) {
+    RawWriter writer(connection_, false);
+
+    RawScanBounds users;
+    users.add_prefix("users##admins##u1");
+    auto updated = writer.update_range(users, "hidden");
+    EXPECT_EQ(updated.rows, 2u);
+    EXPECT_EQ(updated.keys_written, 2u);
+    EXPECT_EQ(connection_->get("users##admins##u1##name"), "hidden");
+
+    RawScanBounds exact;
+    exact.exact_key = "other##1";
+    auto removed = writer.remove_range(exact);
+    EXPECT_EQ(removed.keys_deleted, 1u);
+    EXPECT_FALSE(connection_->get("other##1").has_value());
+
+    RawScanBounds range;
+    range.add_lower_bound("users##admins##u2", true);
+    range.add_upper_bound("users##staff", false);
+    removed = writer.remove_range(range);
+    EXPECT_EQ(removed.keys_deleted, 2u);
+    EXPECT_EQ(keys().size(), 4u);
+}
+
+TEST_F(RangeWriterTest, ValueHoldingTheDelimiterIsNotAnExactRange) {
+    // group = 'admins##u1' as a range reaches group admins, id u1, so
+    // direct DELETE and count(*) must not use it as an exact match
+    const KeyPattern& pattern = projection_->parser().pattern();
+    IdentityConstraint group;
+    group.values = {"admins##u1"};
+    auto ranges = build_identity_ranges(projection_->parser(), {group});
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_LE(ranges[0].start, "users##admins##u1##name");
+    EXPECT_GT(ranges[0].end, "users##admins##u1##name");
+
+    EXPECT_FALSE(prefix_selects_exactly(pattern, 0, "admins##u1"));
+    EXPECT_FALSE(prefix_selects_exactly(pattern, 0, "a#"));
+    EXPECT_TRUE(prefix_selects_exactly(pattern, 0, "admins"));
+    EXPECT_TRUE(prefix_selects_exactly(pattern, 1, "u1"));
+}
+
+TEST_F(RangeWriterTest, RangeWritesNeedCapturesBeforeAttr) {
+    // Each identity's keys are spread across the range, one run per attr
+    std::vector<ColumnDef> columns = {
+        {"kind", PgType::TEXT, 1, true},
+        {"name", PgType::TEXT, 2, false},
+        {"id", PgType::TEXT, 3, true},
+    };
+    Projection tagged(KeyPattern("tagged##{kind}##{attr}##{id}"), std::move(columns));
+    connection_->put("tagged##a##email##1", "x");
+    connection_->put("tagged##a##name##1", "y");
+
+    Writer writer(tagged, connection_);
+    EXPECT_THROW(writer.remove_ranges({prefix_range("tagged##a##")}), LevelPivotError);
+    EXPECT_THROW(writer.update_ranges({prefix_range("tagged##a##")},
+                                      {{"name", std::string("z")}}),
+                 LevelPivotError);
+    EXPECT_EQ(keys().size(), 9u);
+}
+
+TEST_F(RangeWriterTest, TrackedChangesNameWrittenRows) {
+    ChangeSet changes;
+    Writer writer(*projection_, connection_);
+    writer.track_changes(&changes);
+    writer.remove_by_identity({"staff", "u3"});
+    writer.remove_by_identity({"staff", "missing"});
+    writer.update_ranges({prefix_range("users##admins##")}, {{"email", std::string("x")}});
+
+    EXPECT_EQ(changes.entries(), (std::set<std::vector<std::string>>{
+        {"admins", "u1"}, {"admins", "u2"}, {"staff", "u3"}}));
+
+    ChangeSet keys;
+    RawWriter raw(connection_, false);
+    raw.track_changes(&keys);
+    raw.insert("k1", "v");
+    RawScanBounds bounds;
+    bounds.add_prefix("users##admins##u2");
+    raw.remove_range(bounds);
+    EXPECT_EQ(keys.entries(), (std::set<std::vector<std::string>>{
+        {"k1"}, {"users##admins##u2##email"}, {"users##admins##u2##name"},
+        {"users##admins##u2##role"}}));
+}